@@ -57,6 +57,7 @@ struct t_inputrec;
 
 namespace gmx
 {
+class HardwareTopology;
 class MDLogger;
 class LocalAtomSetManager;
 struct DomdecOptions;
@@ -75,15 +76,16 @@ class DomainDecompositionBuilder
 {
 public:
     //! Constructor
-    DomainDecompositionBuilder(const MDLogger&      mdlog,
-                               t_commrec*           cr,
-                               const DomdecOptions& options,
-                               const MdrunOptions&  mdrunOptions,
-                               bool                 prefer1D,
-                               const gmx_mtop_t&    mtop,
-                               const t_inputrec&    ir,
-                               const matrix         box,
-                               ArrayRef<const RVec> xGlobal);
+    DomainDecompositionBuilder(const MDLogger&         mdlog,
+                               t_commrec*              cr,
+                               const DomdecOptions&    options,
+                               const MdrunOptions&     mdrunOptions,
+                               bool                    prefer1D,
+                               const gmx_mtop_t&       mtop,
+                               const t_inputrec&       ir,
+                               const HardwareTopology& hardwareTopology,
+                               const matrix            box,
+                               ArrayRef<const RVec>    xGlobal);
     //! Destructor
     ~DomainDecompositionBuilder();
     //! Build the resulting DD manager
@@ -46,10 +46,15 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 #include "gromacs/domdec/domdec_network.h"
+#include "gromacs/fileio/xtcio.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/state.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
 
 #include "atomdistribution.h"
 #include "distribute.h"
@@ -301,3 +306,139 @@ void dd_collect_state(gmx_domdec_t* dd, const t_state* state_local, t_state* sta
         dd_collect_vec(dd, state_local, state_local->cg_p, globalCgpRef);
     }
 }
+
+namespace
+{
+
+//! A position with its index in the compressed output
+struct IndexedPosition
+{
+    //! The index in the compressed output
+    int index;
+    //! The position
+    rvec x;
+};
+
+} // namespace
+
+bool dd_collect_compressed_positions(gmx_domdec_t*                  dd,
+                                     gmx::ArrayRef<const gmx::RVec> localX,
+                                     gmx::ArrayRef<const int>       compressedIndex,
+                                     int                            numCompressedAtoms,
+                                     real                           precision,
+                                     std::vector<char>*             compressedChunks)
+{
+    const int numRanks = dd->nnodes;
+
+    /* Chunk c contains compressed atoms chunkStart(c) to chunkStart(c + 1) */
+    auto chunkStart = [numRanks, numCompressedAtoms](int chunk) {
+        return static_cast<int>((static_cast<int64_t>(numCompressedAtoms) * chunk) / numRanks);
+    };
+    /* Returns the chunk containing compressed atom index, the inverse of chunkStart */
+    auto chunkOfIndex = [numRanks, numCompressedAtoms](int index) {
+        return static_cast<int>((static_cast<int64_t>(index + 1) * numRanks - 1)
+                                / numCompressedAtoms);
+    };
+
+    /* Sort our home atoms in the compressed output by destination rank */
+    const int        numHomeAtoms = dd->comm->atomRanges.numHomeAtoms();
+    std::vector<int> sendCounts(numRanks, 0);
+    std::vector<int> destinationIndex(numHomeAtoms, -1);
+    for (int a = 0; a < numHomeAtoms; a++)
+    {
+        const int globalAtom = dd->globalAtomIndices[a];
+        const int index = compressedIndex.empty() ? globalAtom : compressedIndex[globalAtom];
+        if (index >= 0)
+        {
+            destinationIndex[a] = index;
+            sendCounts[chunkOfIndex(index)]++;
+        }
+    }
+    std::vector<int> sendDisplacements(numRanks + 1, 0);
+    for (int rank = 0; rank < numRanks; rank++)
+    {
+        sendDisplacements[rank + 1] = sendDisplacements[rank] + sendCounts[rank];
+    }
+    std::vector<IndexedPosition> sendBuffer(sendDisplacements[numRanks]);
+    std::vector<int> sendPositions(sendDisplacements.begin(), sendDisplacements.end() - 1);
+    for (int a = 0; a < numHomeAtoms; a++)
+    {
+        const int index = destinationIndex[a];
+        if (index >= 0)
+        {
+            IndexedPosition& entry = sendBuffer[sendPositions[chunkOfIndex(index)]++];
+            entry.index            = index;
+            copy_rvec(localX[a], entry.x);
+        }
+    }
+
+    /* Exchange the positions, we communicate bytes */
+    std::vector<int> receiveCounts(numRanks);
+    dd_alltoall(dd, sizeof(int), sendCounts.data(), receiveCounts.data());
+    std::vector<int> receiveDisplacements(numRanks + 1, 0);
+    for (int rank = 0; rank < numRanks; rank++)
+    {
+        receiveDisplacements[rank + 1] = receiveDisplacements[rank] + receiveCounts[rank];
+    }
+    const int numChunkAtoms = chunkStart(dd->rank + 1) - chunkStart(dd->rank);
+    GMX_RELEASE_ASSERT(receiveDisplacements[numRanks] == numChunkAtoms,
+                       "We should receive all atoms in our chunk");
+
+    constexpr int c_entrySize = sizeof(IndexedPosition);
+    for (int rank = 0; rank <= numRanks; rank++)
+    {
+        sendDisplacements[rank] *= c_entrySize;
+        receiveDisplacements[rank] *= c_entrySize;
+        if (rank < numRanks)
+        {
+            sendCounts[rank] *= c_entrySize;
+            receiveCounts[rank] *= c_entrySize;
+        }
+    }
+    std::vector<IndexedPosition> receiveBuffer(numChunkAtoms);
+    dd_alltoallv(dd, sendCounts.data(), sendDisplacements.data(), sendBuffer.data(),
+                 receiveCounts.data(), receiveDisplacements.data(), receiveBuffer.data());
+
+    /* Put the positions of our chunk in order and compress them */
+    std::vector<gmx::RVec> chunkX(numChunkAtoms);
+    const int              chunkOffset = chunkStart(dd->rank);
+    for (const IndexedPosition& entry : receiveBuffer)
+    {
+        copy_rvec(entry.x, chunkX[entry.index - chunkOffset]);
+    }
+    std::vector<char> chunk;
+    /* A size of -1 signals a compression failure to the master rank */
+    int chunkSize = -1;
+    if (xtc_compress_positions(numChunkAtoms, as_rvec_array(chunkX.data()), precision, &chunk))
+    {
+        chunkSize = static_cast<int>(chunk.size());
+    }
+
+    /* Gather the compressed chunks on the master rank */
+    std::vector<int> chunkSizes;
+    std::vector<int> chunkDisplacements;
+    bool             success = true;
+    if (DDMASTER(dd))
+    {
+        chunkSizes.resize(numRanks);
+    }
+    dd_gather(dd, sizeof(int), &chunkSize, chunkSizes.data());
+    if (DDMASTER(dd))
+    {
+        chunkDisplacements.resize(numRanks + 1, 0);
+        for (int rank = 0; rank < numRanks; rank++)
+        {
+            if (chunkSizes[rank] < 0)
+            {
+                success          = false;
+                chunkSizes[rank] = 0;
+            }
+            chunkDisplacements[rank + 1] = chunkDisplacements[rank] + chunkSizes[rank];
+        }
+        compressedChunks->resize(chunkDisplacements[numRanks]);
+    }
+    dd_gatherv(dd, std::max(chunkSize, 0), chunk.data(), chunkSizes.data(),
+               chunkDisplacements.data(), DDMASTER(dd) ? compressedChunks->data() : nullptr);
+
+    return success;
+}
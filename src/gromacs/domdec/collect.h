@@ -43,7 +43,10 @@
 #ifndef GMX_DOMDEC_COLLECT_H
 #define GMX_DOMDEC_COLLECT_H
 
+#include <vector>
+
 #include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
 
 namespace gmx
 {
@@ -62,4 +65,30 @@ void dd_collect_vec(gmx_domdec_t*                  dd,
 /*! \brief Gathers state \p localState to \p globalState on the master rank */
 void dd_collect_state(gmx_domdec_t* dd, const t_state* localState, t_state* globalState);
 
+/*! \brief Compresses the compressed-output positions in parallel and gathers them on the master
+ *
+ * The compressed-output atoms are divided into one chunk of consecutive
+ * atoms per PP rank. Each rank receives the positions of the atoms in its
+ * chunk from the other ranks, compresses them using XTC compression and
+ * sends only the compressed bytes to the master rank. This avoids gathering
+ * all positions and compressing them serially on the master rank.
+ *
+ * This is a collective call on all PP ranks.
+ *
+ * \param[in]  dd                  The domain decomposition
+ * \param[in]  localX              The local positions
+ * \param[in]  compressedIndex     The index of each global atom in the compressed output,
+ *                                 or -1 when not output, empty when all atoms are output
+ * \param[in]  numCompressedAtoms  The number of atoms in the compressed output
+ * \param[in]  precision           The compression precision
+ * \param[out] compressedChunks    The concatenated compressed chunks, set on the master rank
+ * \returns Whether the compression succeeded on all ranks, only valid on the master rank
+ */
+bool dd_collect_compressed_positions(gmx_domdec_t*                  dd,
+                                     gmx::ArrayRef<const gmx::RVec> localX,
+                                     gmx::ArrayRef<const int>       compressedIndex,
+                                     int                            numCompressedAtoms,
+                                     real                           precision,
+                                     std::vector<char>*             compressedChunks);
+
 #endif
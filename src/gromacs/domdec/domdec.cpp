@@ -66,6 +66,7 @@
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/gpu_utils/device_stream_manager.h"
 #include "gromacs/gpu_utils/gpu_utils.h"
+#include "gromacs/hardware/hardwaretopology.h"
 #include "gromacs/hardware/hw_info.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/math/vectypes.h"
@@ -257,69 +258,94 @@ void dd_get_constraint_range(const gmx_domdec_t* dd, int* at_start, int* at_end)
     *at_end   = dd->comm->atomRanges.end(DDAtomRanges::Type::Constraints);
 }
 
+/*! \brief Copies the coordinates to send in pulse \p ind along DD dimension index \p d
+ * to \p sendBuffer, with PBC applied when needed
+ */
+static void packHaloCoordinates(const gmx_domdec_t*            dd,
+                                const int                      d,
+                                const gmx_domdec_ind_t&        ind,
+                                const matrix                   box,
+                                gmx::ArrayRef<const gmx::RVec> x,
+                                gmx::ArrayRef<gmx::RVec>       sendBuffer)
+{
+    const bool bPBC   = (dd->ci[dd->dim[d]] == 0);
+    const bool bScrew = (bPBC && dd->unitCellInfo.haveScrewPBC && dd->dim[d] == XX);
+    rvec       shift  = { 0, 0, 0 };
+    if (bPBC)
+    {
+        copy_rvec(box[dd->dim[d]], shift);
+    }
+
+    int n = 0;
+    if (!bPBC)
+    {
+        for (int j : ind.index)
+        {
+            sendBuffer[n] = x[j];
+            n++;
+        }
+    }
+    else if (!bScrew)
+    {
+        for (int j : ind.index)
+        {
+            /* We need to shift the coordinates */
+            for (int m = 0; m < DIM; m++)
+            {
+                sendBuffer[n][m] = x[j][m] + shift[m];
+            }
+            n++;
+        }
+    }
+    else
+    {
+        for (int j : ind.index)
+        {
+            /* Shift x */
+            sendBuffer[n][XX] = x[j][XX] + shift[XX];
+            /* Rotate y and z.
+             * This operation requires a special shift force
+             * treatment, which is performed in calc_vir.
+             */
+            sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
+            sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+            n++;
+        }
+    }
+}
+
+/*! \brief Copies coordinates that were not received in place to the \p nzone zones of pulse \p ind */
+static void unpackHaloCoordinates(const gmx_domdec_ind_t&        ind,
+                                  const int                      nzone,
+                                  gmx::ArrayRef<const gmx::RVec> receiveBuffer,
+                                  gmx::ArrayRef<gmx::RVec>       x)
+{
+    int j = 0;
+    for (int zone = 0; zone < nzone; zone++)
+    {
+        for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
+        {
+            x[i] = receiveBuffer[j++];
+        }
+    }
+}
+
 void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
 {
     wallcycle_start(wcycle, ewcMOVEX);
 
-    int                    nzone, nat_tot;
-    gmx_domdec_comm_t*     comm;
-    gmx_domdec_comm_dim_t* cd;
-    rvec                   shift = { 0, 0, 0 };
-    gmx_bool               bPBC, bScrew;
-
-    comm = dd->comm;
+    gmx_domdec_comm_t* comm = dd->comm;
 
-    nzone   = 1;
-    nat_tot = comm->atomRanges.numHomeAtoms();
+    int nzone   = 1;
+    int nat_tot = comm->atomRanges.numHomeAtoms();
     for (int d = 0; d < dd->ndim; d++)
     {
-        bPBC   = (dd->ci[dd->dim[d]] == 0);
-        bScrew = (bPBC && dd->unitCellInfo.haveScrewPBC && dd->dim[d] == XX);
-        if (bPBC)
-        {
-            copy_rvec(box[dd->dim[d]], shift);
-        }
-        cd = &comm->cd[d];
+        const gmx_domdec_comm_dim_t* cd = &comm->cd[d];
         for (const gmx_domdec_ind_t& ind : cd->ind)
         {
             DDBufferAccess<gmx::RVec> sendBufferAccess(comm->rvecBuffer, ind.nsend[nzone + 1]);
             gmx::ArrayRef<gmx::RVec>& sendBuffer = sendBufferAccess.buffer;
-            int                       n          = 0;
-            if (!bPBC)
-            {
-                for (int j : ind.index)
-                {
-                    sendBuffer[n] = x[j];
-                    n++;
-                }
-            }
-            else if (!bScrew)
-            {
-                for (int j : ind.index)
-                {
-                    /* We need to shift the coordinates */
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        sendBuffer[n][d] = x[j][d] + shift[d];
-                    }
-                    n++;
-                }
-            }
-            else
-            {
-                for (int j : ind.index)
-                {
-                    /* Shift x */
-                    sendBuffer[n][XX] = x[j][XX] + shift[XX];
-                    /* Rotate y and z.
-                     * This operation requires a special shift force
-                     * treatment, which is performed in calc_vir.
-                     */
-                    sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
-                    sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                    n++;
-                }
-            }
+            packHaloCoordinates(dd, d, ind, box, x, sendBuffer);
 
             DDBufferAccess<gmx::RVec> receiveBufferAccess(
                     comm->rvecBuffer2, cd->receiveInPlace ? 0 : ind.nrecv[nzone + 1]);
@@ -338,14 +364,7 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
 
             if (!cd->receiveInPlace)
             {
-                int j = 0;
-                for (int zone = 0; zone < nzone; zone++)
-                {
-                    for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
-                    {
-                        x[i] = receiveBuffer[j++];
-                    }
-                }
+                unpackHaloCoordinates(ind, nzone, receiveBuffer, x);
             }
             nat_tot += ind.nrecv[nzone + 1];
         }
@@ -355,6 +374,174 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
     wallcycle_stop(wcycle, ewcMOVEX);
 }
 
+bool ddUsesNonBlockingMoveX(const gmx_domdec_t& dd)
+{
+    return dd.comm->ddSettings.useNonBlockingMoveX;
+}
+
+#if GMX_MPI
+//! Returns the DD pulse for the pulse with index \p pulseIndex over all dimensions
+static const gmx_domdec_ind_t& ddPulse(const gmx_domdec_comm_t& comm, const int pulseIndex)
+{
+    const int d = comm.nonBlockingMoveX.pulseDimIndex[pulseIndex];
+    int       p = pulseIndex;
+    for (int dPrev = 0; dPrev < d; dPrev++)
+    {
+        p -= comm.cd[dPrev].numPulses();
+    }
+    return comm.cd[d].ind[p];
+}
+
+//! Packs and posts the non-blocking send of the coordinates for pulse \p pulseIndex
+static void sendHaloCoordinates(gmx_domdec_t*                  dd,
+                                const int                      pulseIndex,
+                                const matrix                   box,
+                                gmx::ArrayRef<const gmx::RVec> x)
+{
+    DDNonBlockingMoveX&     state = dd->comm->nonBlockingMoveX;
+    const int               d     = state.pulseDimIndex[pulseIndex];
+    const gmx_domdec_ind_t& ind   = ddPulse(*dd->comm, pulseIndex);
+    const int               numToSend = ind.nsend[state.pulseNumZones[pulseIndex] + 1];
+
+    std::vector<gmx::RVec>& sendBuffer = state.sendBuffers[pulseIndex];
+    sendBuffer.resize(numToSend);
+    packHaloCoordinates(dd, d, ind, box, x, sendBuffer);
+
+    if (numToSend > 0)
+    {
+        state.sendRequests.emplace_back();
+        MPI_Isend(sendBuffer.data(), numToSend * sizeof(rvec), MPI_BYTE, dd->neighbor[d][1], 0,
+                  dd->mpi_comm_all, &state.sendRequests.back());
+    }
+}
+
+//! Waits for the coordinates of pulse \p pulseIndex to arrive and unpacks them when needed
+static void receiveHaloCoordinates(gmx_domdec_t* dd, const int pulseIndex, gmx::ArrayRef<gmx::RVec> x)
+{
+    DDNonBlockingMoveX& state = dd->comm->nonBlockingMoveX;
+
+    if (state.haveReceiveRequest[pulseIndex])
+    {
+        MPI_Wait(&state.receiveRequests[pulseIndex], MPI_STATUS_IGNORE);
+    }
+    if (!dd->comm->cd[state.pulseDimIndex[pulseIndex]].receiveInPlace)
+    {
+        unpackHaloCoordinates(ddPulse(*dd->comm, pulseIndex), state.pulseNumZones[pulseIndex],
+                              state.receiveBuffers[pulseIndex], x);
+    }
+}
+#endif
+
+void dd_move_x_start(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+{
+#if GMX_MPI
+    wallcycle_start(wcycle, ewcMOVEX);
+
+    gmx_domdec_comm_t&  comm  = *dd->comm;
+    DDNonBlockingMoveX& state = comm.nonBlockingMoveX;
+    GMX_ASSERT(!state.isActive, "Can not start a second non-blocking halo exchange");
+
+    state.pulseDimIndex.clear();
+    state.pulseNumZones.clear();
+    int nzone = 1;
+    for (int d = 0; d < dd->ndim; d++)
+    {
+        for (int p = 0; p < comm.cd[d].numPulses(); p++)
+        {
+            state.pulseDimIndex.push_back(d);
+            state.pulseNumZones.push_back(nzone);
+        }
+        nzone += nzone;
+    }
+    const int numPulses = state.pulseDimIndex.size();
+    state.sendBuffers.resize(numPulses);
+    state.receiveBuffers.resize(numPulses);
+    state.receiveRequests.resize(numPulses);
+    state.haveReceiveRequest.assign(numPulses, false);
+    state.sendRequests.clear();
+
+    /* Post the receives for all pulses, these only depend on the atom counts */
+    int nat_tot = comm.atomRanges.numHomeAtoms();
+    for (int pulseIndex = 0; pulseIndex < numPulses; pulseIndex++)
+    {
+        const int                    d   = state.pulseDimIndex[pulseIndex];
+        const gmx_domdec_comm_dim_t& cd  = comm.cd[d];
+        const gmx_domdec_ind_t&      ind = ddPulse(comm, pulseIndex);
+        const int numToReceive           = ind.nrecv[state.pulseNumZones[pulseIndex] + 1];
+
+        gmx::RVec* receivePointer;
+        if (cd.receiveInPlace)
+        {
+            receivePointer = x.data() + nat_tot;
+        }
+        else
+        {
+            state.receiveBuffers[pulseIndex].resize(numToReceive);
+            receivePointer = state.receiveBuffers[pulseIndex].data();
+        }
+        if (numToReceive > 0)
+        {
+            MPI_Irecv(receivePointer, numToReceive * sizeof(rvec), MPI_BYTE, dd->neighbor[d][0], 0,
+                      dd->mpi_comm_all, &state.receiveRequests[pulseIndex]);
+            state.haveReceiveRequest[pulseIndex] = true;
+        }
+        nat_tot += numToReceive;
+    }
+
+    /* The first pulse only sends home atoms, so it can be sent right away.
+     * Later pulses can send atoms received in earlier pulses.
+     */
+    if (numPulses > 0)
+    {
+        sendHaloCoordinates(dd, 0, box, x);
+    }
+
+    state.isActive = true;
+
+    wallcycle_stop(wcycle, ewcMOVEX);
+#else
+    GMX_UNUSED_VALUE(dd);
+    GMX_UNUSED_VALUE(box);
+    GMX_UNUSED_VALUE(x);
+    GMX_UNUSED_VALUE(wcycle);
+#endif
+}
+
+void dd_move_x_finish(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+{
+#if GMX_MPI
+    wallcycle_start(wcycle, ewcMOVEX);
+
+    DDNonBlockingMoveX& state = dd->comm->nonBlockingMoveX;
+    GMX_ASSERT(state.isActive, "A non-blocking halo exchange should have been started");
+
+    const int numPulses = state.pulseDimIndex.size();
+    for (int pulseIndex = 1; pulseIndex < numPulses; pulseIndex++)
+    {
+        /* The atoms to send can have been received in any earlier pulse */
+        receiveHaloCoordinates(dd, pulseIndex - 1, x);
+        sendHaloCoordinates(dd, pulseIndex, box, x);
+    }
+    if (numPulses > 0)
+    {
+        receiveHaloCoordinates(dd, numPulses - 1, x);
+    }
+    if (!state.sendRequests.empty())
+    {
+        MPI_Waitall(state.sendRequests.size(), state.sendRequests.data(), MPI_STATUSES_IGNORE);
+    }
+
+    state.isActive = false;
+
+    wallcycle_stop(wcycle, ewcMOVEX);
+#else
+    GMX_UNUSED_VALUE(dd);
+    GMX_UNUSED_VALUE(box);
+    GMX_UNUSED_VALUE(x);
+    GMX_UNUSED_VALUE(wcycle);
+#endif
+}
+
 void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle)
 {
     wallcycle_start(wcycle, ewcMOVEF);
@@ -1307,10 +1494,97 @@ static void setup_neighbor_relations(gmx_domdec_t* dd)
     }
 }
 
+#if GMX_MPI
+/*! \brief Returns the physical node identifier for each rank in \p communicator
+ *
+ * When \p numFakePhysicalNodes > 0, rank r returns r % numFakePhysicalNodes
+ * instead of its actual node, which is used for testing.
+ */
+static std::vector<int> gatherPhysicalNodeIds(MPI_Comm  communicator,
+                                              const int numRanks,
+                                              const int numFakePhysicalNodes)
+{
+    int rank;
+    MPI_Comm_rank(communicator, &rank);
+
+    /* Thread-MPI has no MPI_Allgather, so we sum buffers with one non-zero entry */
+    std::vector<int> buf(numRanks, 0);
+    buf[rank] = (numFakePhysicalNodes > 0 ? rank % numFakePhysicalNodes
+                                          : gmx_physicalnode_id_hash());
+    std::vector<int> physicalNodeIds(numRanks);
+    MPI_Allreduce(buf.data(), physicalNodeIds.data(), numRanks, MPI_INT, MPI_SUM, communicator);
+
+    return physicalNodeIds;
+}
+
+/*! \brief Renumbers the PP ranks such that blocks of neighboring DD cells share a node and socket
+ *
+ * Returns a new communicator for the DD ranks, split off \p ppCommunicator,
+ * where the rank equals the DD cell index assigned by
+ * topologyAwareDDCellIndices() and updates \p physicalNodeIds to the new order.
+ * The communicators and rank indices in the commrec are left unchanged.
+ * Returns MPI_COMM_NULL when the placement can not be used.
+ */
+static MPI_Comm placeDDCellsOnTopology(const gmx::MDLogger& mdlog,
+                                       gmx_domdec_t*        dd,
+                                       MPI_Comm             ppCommunicator,
+                                       const int            numSocketsPerNode,
+                                       std::vector<int>*    physicalNodeIds)
+{
+    const CartesianRankSetup& cartSetup = dd->comm->cartesianRankSetup;
+
+    if (cartSetup.bCartesianPP || dd->comm->ddRankSetup.usePmeOnlyRanks)
+    {
+        GMX_LOG(mdlog.info)
+                .appendText(
+                        "NOTE: Topology-aware DD rank placement is not supported with Cartesian "
+                        "rank ordering or separate PME ranks, using the default rank order");
+        return MPI_COMM_NULL;
+    }
+
+    const std::vector<int> ddCellIndices =
+            topologyAwareDDCellIndices(dd->numCells, *physicalNodeIds, numSocketsPerNode);
+    if (ddCellIndices.empty())
+    {
+        GMX_LOG(mdlog.info)
+                .appendText(
+                        "NOTE: Topology-aware DD rank placement requires the same number of PP "
+                        "ranks on each physical node, using the default rank order");
+        return MPI_COMM_NULL;
+    }
+
+    int rank;
+    MPI_Comm_rank(ppCommunicator, &rank);
+    GMX_RELEASE_ASSERT(rank != 0 || ddCellIndices[rank] == 0,
+                       "The master rank should keep DD cell index 0");
+
+    /* Only the DD communication uses the new order, the master rank
+     * of the simulation is rank 0 in both communicators.
+     */
+    MPI_Comm comm_placed;
+    MPI_Comm_split(ppCommunicator, 0, ddCellIndices[rank], &comm_placed);
+
+    std::vector<int> placedPhysicalNodeIds(physicalNodeIds->size());
+    for (size_t r = 0; r < physicalNodeIds->size(); r++)
+    {
+        placedPhysicalNodeIds[ddCellIndices[r]] = (*physicalNodeIds)[r];
+    }
+    *physicalNodeIds = placedPhysicalNodeIds;
+
+    GMX_LOG(mdlog.info)
+            .appendTextFormatted(
+                    "Placed blocks of neighboring DD cells on ranks sharing a node%s",
+                    numSocketsPerNode > 1 ? " and socket" : "");
+
+    return comm_placed;
+}
+#endif
+
 static void make_pp_communicator(const gmx::MDLogger& mdlog,
                                  gmx_domdec_t*        dd,
                                  t_commrec gmx_unused* cr,
-                                 bool gmx_unused reorder)
+                                 bool gmx_unused reorder,
+                                 int gmx_unused numSocketsPerNode)
 {
 #if GMX_MPI
     gmx_domdec_comm_t*  comm      = dd->comm;
@@ -1335,7 +1609,17 @@ static void make_pp_communicator(const gmx::MDLogger& mdlog,
         cr->mpi_comm_mygroup = comm_cart;
     }
 
-    dd->mpi_comm_all = cr->mpi_comm_mygroup;
+    std::vector<int> physicalNodeIds = gatherPhysicalNodeIds(
+            cr->mpi_comm_mygroup, dd->nnodes, comm->ddSettings.numFakePhysicalNodes);
+    MPI_Comm         comm_placed     = MPI_COMM_NULL;
+    if (comm->ddSettings.useTopologyAwarePlacement)
+    {
+        comm_placed = placeDDCellsOnTopology(mdlog, dd, cr->mpi_comm_mygroup, numSocketsPerNode,
+                                             &physicalNodeIds);
+    }
+    comm->physicalNodeIdOfRank = physicalNodeIds;
+
+    dd->mpi_comm_all = (comm_placed != MPI_COMM_NULL ? comm_placed : cr->mpi_comm_mygroup);
     MPI_Comm_rank(dd->mpi_comm_all, &dd->rank);
 
     if (cartSetup.bCartesianPP_PME)
@@ -1647,6 +1931,7 @@ static void setupGroupCommunication(const gmx::MDLogger&     mdlog,
                                     gmx::ArrayRef<const int> pmeRanks,
                                     t_commrec*               cr,
                                     const int                numAtomsInSystem,
+                                    const int                numSocketsPerNode,
                                     gmx_domdec_t*            dd)
 {
     const DDRankSetup&        ddRankSetup = dd->comm->ddRankSetup;
@@ -1661,7 +1946,7 @@ static void setupGroupCommunication(const gmx::MDLogger&     mdlog,
          */
         const bool useCartesianReorder = (ddSettings.useCartesianReorder && !cartSetup.bCartesianPP_PME);
 
-        make_pp_communicator(mdlog, dd, cr, useCartesianReorder);
+        make_pp_communicator(mdlog, dd, cr, useCartesianReorder, numSocketsPerNode);
     }
     else
     {
@@ -2874,6 +3159,10 @@ static DDSettings getDDSettings(const gmx::MDLogger&     mdlog,
     ddSettings.nstDDDumpGrid       = dd_getenv(mdlog, "GMX_DD_NST_DUMP_GRID", 0);
     ddSettings.DD_debug            = dd_getenv(mdlog, "GMX_DD_DEBUG", 0);
 
+    ddSettings.useTopologyAwarePlacement = bool(dd_getenv(mdlog, "GMX_DD_TOPOLOGY_PLACEMENT", 0));
+    ddSettings.useNonBlockingMoveX       = bool(dd_getenv(mdlog, "GMX_DD_NONBLOCKING_MOVEX", 0));
+    ddSettings.numFakePhysicalNodes      = dd_getenv(mdlog, "GMX_DD_FAKE_PHYSICAL_NODES", 0);
+
     if (ddSettings.useSendRecv2)
     {
         GMX_LOG(mdlog.info)
@@ -2971,15 +3260,16 @@ class DomainDecompositionBuilder::Impl
 {
 public:
     //! Constructor
-    Impl(const MDLogger&      mdlog,
-         t_commrec*           cr,
-         const DomdecOptions& options,
-         const MdrunOptions&  mdrunOptions,
-         bool                 prefer1D,
-         const gmx_mtop_t&    mtop,
-         const t_inputrec&    ir,
-         const matrix         box,
-         ArrayRef<const RVec> xGlobal);
+    Impl(const MDLogger&         mdlog,
+         t_commrec*              cr,
+         const DomdecOptions&    options,
+         const MdrunOptions&     mdrunOptions,
+         bool                    prefer1D,
+         const gmx_mtop_t&       mtop,
+         const t_inputrec&       ir,
+         const HardwareTopology& hardwareTopology,
+         const matrix            box,
+         ArrayRef<const RVec>    xGlobal);
 
     //! Build the resulting DD manager
     gmx_domdec_t* build(LocalAtomSetManager* atomSets);
@@ -2996,6 +3286,8 @@ public:
     const gmx_mtop_t& mtop_;
     //! User input values from the tpr file
     const t_inputrec& ir_;
+    //! Hardware topology of this node
+    const HardwareTopology& hardwareTopology_;
     //! }
 
     //! Internal objects used in constructing DD
@@ -3019,20 +3311,22 @@ public:
     //! }
 };
 
-DomainDecompositionBuilder::Impl::Impl(const MDLogger&      mdlog,
-                                       t_commrec*           cr,
-                                       const DomdecOptions& options,
-                                       const MdrunOptions&  mdrunOptions,
-                                       const bool           prefer1D,
-                                       const gmx_mtop_t&    mtop,
-                                       const t_inputrec&    ir,
-                                       const matrix         box,
-                                       ArrayRef<const RVec> xGlobal) :
+DomainDecompositionBuilder::Impl::Impl(const MDLogger&         mdlog,
+                                       t_commrec*              cr,
+                                       const DomdecOptions&    options,
+                                       const MdrunOptions&     mdrunOptions,
+                                       const bool              prefer1D,
+                                       const gmx_mtop_t&       mtop,
+                                       const t_inputrec&       ir,
+                                       const HardwareTopology& hardwareTopology,
+                                       const matrix            box,
+                                       ArrayRef<const RVec>    xGlobal) :
     mdlog_(mdlog),
     cr_(cr),
     options_(options),
     mtop_(mtop),
-    ir_(ir)
+    ir_(ir),
+    hardwareTopology_(hardwareTopology)
 {
     GMX_LOG(mdlog_.info).appendTextFormatted("\nInitializing Domain Decomposition on %d ranks", cr_->sizeOfDefaultCommunicator);
 
@@ -3097,7 +3391,13 @@ gmx_domdec_t* DomainDecompositionBuilder::Impl::build(LocalAtomSetManager* atomS
     set_dd_limits(mdlog_, MASTER(cr_) ? DDRole::Master : DDRole::Agent, dd, options_, ddSettings_,
                   systemInfo_, ddGridSetup_, ddRankSetup_.numPPRanks, &mtop_, &ir_, ddbox_);
 
-    setupGroupCommunication(mdlog_, ddSettings_, pmeRanks_, cr_, mtop_.natoms, dd);
+    /* We assume that all nodes have the same number of sockets as this one */
+    const int numSocketsPerNode =
+            (hardwareTopology_.supportLevel() >= HardwareTopology::SupportLevel::Basic)
+                    ? static_cast<int>(hardwareTopology_.machine().sockets.size())
+                    : 1;
+    setupGroupCommunication(mdlog_, ddSettings_, pmeRanks_, cr_, mtop_.natoms, numSocketsPerNode,
+                            dd);
 
     if (thisRankHasDuty(cr_, DUTY_PP))
     {
@@ -3114,16 +3414,18 @@ gmx_domdec_t* DomainDecompositionBuilder::Impl::build(LocalAtomSetManager* atomS
     return dd;
 }
 
-DomainDecompositionBuilder::DomainDecompositionBuilder(const MDLogger&      mdlog,
-                                                       t_commrec*           cr,
-                                                       const DomdecOptions& options,
-                                                       const MdrunOptions&  mdrunOptions,
-                                                       const bool           prefer1D,
-                                                       const gmx_mtop_t&    mtop,
-                                                       const t_inputrec&    ir,
-                                                       const matrix         box,
-                                                       ArrayRef<const RVec> xGlobal) :
-    impl_(new Impl(mdlog, cr, options, mdrunOptions, prefer1D, mtop, ir, box, xGlobal))
+DomainDecompositionBuilder::DomainDecompositionBuilder(const MDLogger&         mdlog,
+                                                       t_commrec*              cr,
+                                                       const DomdecOptions&    options,
+                                                       const MdrunOptions&     mdrunOptions,
+                                                       const bool              prefer1D,
+                                                       const gmx_mtop_t&       mtop,
+                                                       const t_inputrec&       ir,
+                                                       const HardwareTopology& hardwareTopology,
+                                                       const matrix            box,
+                                                       ArrayRef<const RVec>    xGlobal) :
+    impl_(new Impl(mdlog, cr, options, mdrunOptions, prefer1D, mtop, ir, hardwareTopology, box,
+                   xGlobal))
 {
 }
 
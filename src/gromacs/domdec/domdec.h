@@ -216,6 +216,24 @@ void dd_cycles_add(const gmx_domdec_t* dd, float cycles, int ddCycl);
 /*! \brief Communicate the coordinates to the neighboring cells and do pbc. */
 void dd_move_x(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
 
+/*! \brief Returns whether to use dd_move_x_start() and dd_move_x_finish() instead of dd_move_x() */
+bool ddUsesNonBlockingMoveX(const gmx_domdec_t& dd);
+
+/*! \brief Starts a non-blocking communication of the coordinates to the neighboring cells
+ *
+ * Posts the receives for all pulses and sends the first pulse, which only
+ * contains home atoms. Work on local atoms can be done before calling
+ * dd_move_x_finish(), the non-local coordinates can only be used after it.
+ * The result is identical to that of dd_move_x().
+ */
+void dd_move_x_start(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
+
+/*! \brief Completes the coordinate communication started with dd_move_x_start()
+ *
+ * Sends the remaining pulses as the data they depend on arrives.
+ */
+void dd_move_x_finish(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle);
+
 /*! \brief Sum the forces over the neighboring cells.
  *
  * When fshift!=NULL the shift forces are updated to obtain
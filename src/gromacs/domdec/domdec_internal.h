@@ -94,6 +94,31 @@ struct gmx_domdec_comm_dim_t
     bool receiveInPlace = false;
 };
 
+/*! \internal \brief State of a non-blocking coordinate halo exchange
+ *
+ * Each pulse has its own send and receive buffers, so all receives
+ * can be posted at the start of the exchange.
+ */
+struct DDNonBlockingMoveX
+{
+    //! Whether an exchange has been started and not yet finished
+    bool isActive = false;
+    //! The DD dimension index of each pulse, over all dimensions
+    std::vector<int> pulseDimIndex;
+    //! The number of zones before each pulse
+    std::vector<int> pulseNumZones;
+    //! The send buffer for each pulse
+    std::vector<std::vector<gmx::RVec>> sendBuffers;
+    //! The receive buffer for each pulse, only used when not receiving in place
+    std::vector<std::vector<gmx::RVec>> receiveBuffers;
+    //! The receive request for each pulse
+    std::vector<MPI_Request> receiveRequests;
+    //! Whether the pulse has a receive request
+    std::vector<bool> haveReceiveRequest;
+    //! The send requests posted
+    std::vector<MPI_Request> sendRequests;
+};
+
 /*! \brief Load balancing data along a dim used on the master rank of that dim */
 struct RowMaster
 {
@@ -482,6 +507,18 @@ struct DDSettings
     //! Whether to use MPI Cartesian reordering of communicators, when supported (almost never)
     bool useCartesianReorder = true;
 
+    //! Whether to place blocks of neighboring DD cells on ranks on the same node and socket
+    bool useTopologyAwarePlacement = false;
+
+    /*! \brief For testing, when > 0, rank r is treated as being on node r % numFakePhysicalNodes
+     *
+     * This allows testing topology-aware placement with all ranks on one physical node.
+     */
+    int numFakePhysicalNodes = 0;
+
+    //! Whether to overlap the CPU coordinate halo exchange with local non-bonded work
+    bool useNonBlockingMoveX = false;
+
     //! Whether we should record the load
     bool recordLoad = false;
 
@@ -664,6 +701,9 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
     /**< Another rvec comm. buffer */
     DDBuffer<gmx::RVec> rvecBuffer2;
 
+    /**< Buffers and requests for the non-blocking coordinate halo exchange */
+    DDNonBlockingMoveX nonBlockingMoveX;
+
     /* Communication buffers for local redistribution */
     /**< Charge group flag comm. buffers */
     std::array<std::vector<int>, DIM * 2> cggl_flag;
@@ -717,6 +757,12 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
     /* Statistics for atoms */
     /**< The atoms per range, summed over the steps */
     double sum_nat[static_cast<int>(DDAtomRanges::Type::Number)] = {};
+    /**< The halo bytes sent per step by this rank, summed over the steps */
+    double sum_haloBytes = 0;
+    /**< The part of \p sum_haloBytes sent to ranks on other physical nodes */
+    double sum_haloBytesInterNode = 0;
+    /**< The physical node identifier for each DD rank */
+    std::vector<int> physicalNodeIdOfRank;
 
     /* Statistics for calls and times */
     /**< The number of partioning calls */
@@ -311,3 +311,42 @@ void dd_gatherv(const gmx_domdec_t gmx_unused* dd,
                 DDMASTERRANK(dd), dd->mpi_comm_all);
 #endif
 }
+
+void dd_alltoall(const gmx_domdec_t gmx_unused* dd,
+                 int gmx_unused nbytes,
+                 const void gmx_unused* src,
+                 void gmx_unused* dest)
+{
+#if GMX_MPI
+    /* Some MPI implementions don't specify const */
+    MPI_Alltoall(const_cast<void*>(src), nbytes, MPI_BYTE, dest, nbytes, MPI_BYTE,
+                 dd->mpi_comm_all);
+#endif
+}
+
+void dd_alltoallv(const gmx_domdec_t gmx_unused* dd,
+                  int gmx_unused* scounts,
+                  int gmx_unused* sdisps,
+                  const void gmx_unused* sbuf,
+                  int gmx_unused* rcounts,
+                  int gmx_unused* rdisps,
+                  void gmx_unused* rbuf)
+{
+#if GMX_MPI
+    int sdum;
+    int rdum;
+
+    /* MPI does not allow NULL pointers */
+    if (sbuf == nullptr)
+    {
+        sbuf = &sdum;
+    }
+    if (rbuf == nullptr)
+    {
+        rbuf = &rdum;
+    }
+    /* Some MPI implementions don't specify const */
+    MPI_Alltoallv(const_cast<void*>(sbuf), scounts, sdisps, MPI_BYTE, rbuf, rcounts, rdisps,
+                  MPI_BYTE, dd->mpi_comm_all);
+#endif
+}
@@ -194,4 +194,19 @@ void dd_scatterv(const gmx_domdec_t* dd, int* scounts, int* disps, const void* s
  * If scount==0, sbuf is allowed to be NULL */
 void dd_gatherv(const gmx_domdec_t* dd, int scount, const void* sbuf, int* rcounts, int* disps, void* rbuf);
 
+/*! \brief Sends \p nbytes from \p src to each PP rank, receiving \p nbytes per rank in \p dest */
+void dd_alltoall(const gmx_domdec_t* dd, int nbytes, const void* src, void* dest);
+
+/*! \brief Sends \p scounts bytes from \p sbuf to all PP ranks, receives \p rcounts bytes in \p rbuf
+ *
+ * See man MPI_Alltoallv for details of how to construct the counts and displacements.
+ */
+void dd_alltoallv(const gmx_domdec_t* dd,
+                  int*                scounts,
+                  int*                sdisps,
+                  const void*         sbuf,
+                  int*                rcounts,
+                  int*                rdisps,
+                  void*               rbuf);
+
 #endif
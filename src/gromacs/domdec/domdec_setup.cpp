@@ -48,6 +48,7 @@
 
 #include "domdec_setup.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cinttypes>
 #include <cmath>
@@ -66,6 +67,7 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/logger.h"
 #include "gromacs/utility/stringutil.h"
@@ -956,3 +958,130 @@ DDGridSetup getDDGridSetup(const gmx::MDLogger&           mdlog,
 
     return ddGridSetup;
 }
+
+/*! \brief Finds the shape of a block of \p blockSize cells that tiles a grid of \p numCells
+ *
+ * Minimizes the number of faces of the block that are shared with other blocks.
+ * Returns false when no shape divides the grid, which can not happen when
+ * \p blockSize divides the number of cells.
+ */
+static bool findBlockShape(const ivec numCells, const int blockSize, ivec blockShape)
+{
+    int minNumFaces = -1;
+    for (int bx = 1; bx <= numCells[XX]; bx++)
+    {
+        for (int by = 1; by <= numCells[YY]; by++)
+        {
+            if (numCells[XX] % bx != 0 || numCells[YY] % by != 0 || blockSize % (bx * by) != 0)
+            {
+                continue;
+            }
+            const int bz = blockSize / (bx * by);
+            if (bz > numCells[ZZ] || numCells[ZZ] % bz != 0)
+            {
+                continue;
+            }
+            const ivec shape = { bx, by, bz };
+            /* The number of cell faces perpendicular to dimension d is
+             * blockSize/shape[d], when the block does not span the whole grid
+             */
+            int numFaces = 0;
+            for (int d = 0; d < DIM; d++)
+            {
+                if (shape[d] < numCells[d])
+                {
+                    numFaces += blockSize / shape[d];
+                }
+            }
+            if (minNumFaces < 0 || numFaces < minNumFaces)
+            {
+                minNumFaces = numFaces;
+                copy_ivec(shape, blockShape);
+            }
+        }
+    }
+
+    return minNumFaces >= 0;
+}
+
+//! Returns the coordinates of block \p index in a grid of \p numBlocks, in dd_index() order
+static void blockIndexToCoordinates(const ivec numBlocks, const int index, ivec coordinates)
+{
+    coordinates[XX] = index / (numBlocks[YY] * numBlocks[ZZ]);
+    coordinates[YY] = (index / numBlocks[ZZ]) % numBlocks[YY];
+    coordinates[ZZ] = index % numBlocks[ZZ];
+}
+
+std::vector<int> topologyAwareDDCellIndices(const ivec               numDomains,
+                                            gmx::ArrayRef<const int> physicalNodeIds,
+                                            int                      numSocketsPerNode)
+{
+    const int numRanks = physicalNodeIds.ssize();
+
+    /* Order the nodes by their lowest rank and get the rank index on the node */
+    std::vector<int> nodeIds;
+    std::vector<int> nodeIndex(numRanks);
+    std::vector<int> rankIndexOnNode(numRanks);
+    std::vector<int> numRanksOnNode;
+    for (int rank = 0; rank < numRanks; rank++)
+    {
+        auto node = std::find(nodeIds.begin(), nodeIds.end(), physicalNodeIds[rank]);
+        if (node == nodeIds.end())
+        {
+            nodeIds.push_back(physicalNodeIds[rank]);
+            numRanksOnNode.push_back(0);
+            node = nodeIds.end() - 1;
+        }
+        nodeIndex[rank]       = std::distance(nodeIds.begin(), node);
+        rankIndexOnNode[rank] = numRanksOnNode[nodeIndex[rank]]++;
+    }
+
+    const int numRanksPerNode = numRanks / nodeIds.size();
+    for (int numRanksOnThisNode : numRanksOnNode)
+    {
+        if (numRanksOnThisNode != numRanksPerNode)
+        {
+            return {};
+        }
+    }
+
+    ivec nodeBlockShape;
+    if (!findBlockShape(numDomains, numRanksPerNode, nodeBlockShape))
+    {
+        return {};
+    }
+    ivec socketBlockShape;
+    if (numSocketsPerNode <= 1 || numRanksPerNode % numSocketsPerNode != 0
+        || !findBlockShape(nodeBlockShape, numRanksPerNode / numSocketsPerNode, socketBlockShape))
+    {
+        numSocketsPerNode = 1;
+        copy_ivec(nodeBlockShape, socketBlockShape);
+    }
+    const int numRanksPerSocket = numRanksPerNode / numSocketsPerNode;
+
+    ivec numNodeBlocks, numSocketBlocks;
+    for (int d = 0; d < DIM; d++)
+    {
+        numNodeBlocks[d]   = numDomains[d] / nodeBlockShape[d];
+        numSocketBlocks[d] = nodeBlockShape[d] / socketBlockShape[d];
+    }
+
+    std::vector<int> ddCellIndices(numRanks);
+    for (int rank = 0; rank < numRanks; rank++)
+    {
+        ivec nodeCoords, socketCoords, cellCoords, coords;
+        blockIndexToCoordinates(numNodeBlocks, nodeIndex[rank], nodeCoords);
+        blockIndexToCoordinates(numSocketBlocks, rankIndexOnNode[rank] / numRanksPerSocket,
+                                socketCoords);
+        blockIndexToCoordinates(socketBlockShape, rankIndexOnNode[rank] % numRanksPerSocket,
+                                cellCoords);
+        for (int d = 0; d < DIM; d++)
+        {
+            coords[d] = nodeCoords[d] * nodeBlockShape[d] + socketCoords[d] * socketBlockShape[d]
+                        + cellCoords[d];
+        }
+        ddCellIndices[rank] = dd_index(numDomains, coords);
+    }
+
+    return ddCellIndices;
+}
@@ -42,6 +42,8 @@
 #ifndef GMX_DOMDEC_DOMDEC_SETUP_H
 #define GMX_DOMDEC_DOMDEC_SETUP_H
 
+#include <vector>
+
 #include "gromacs/math/vec.h"
 #include "gromacs/utility/gmxmpi.h"
 
@@ -119,4 +121,23 @@ DDGridSetup getDDGridSetup(const gmx::MDLogger&           mdlog,
                            gmx::ArrayRef<const gmx::RVec> xGlobal,
                            gmx_ddbox_t*                   ddbox);
 
+/*! \brief Returns DD cell indices for all PP ranks that place neighboring cells on the same node
+ *
+ * The DD grid is divided into equally shaped blocks of cells, one block
+ * per physical node, with block shapes that minimize the number of cell
+ * faces shared with other nodes. When there are multiple sockets per node,
+ * the blocks are divided in the same way over the sockets, assuming that
+ * the ranks on a node are placed on the sockets in rank order.
+ * The first rank on the node of rank 0 always gets cell index 0.
+ *
+ * \param[in] numDomains         The number of domains along each dimension
+ * \param[in] physicalNodeIds    An identifier of the physical node for each PP rank
+ * \param[in] numSocketsPerNode  The number of sockets per physical node
+ * \returns the DD cell index for each rank, or an empty vector when the
+ *          ranks are not distributed evenly over the nodes
+ */
+std::vector<int> topologyAwareDDCellIndices(const ivec               numDomains,
+                                            gmx::ArrayRef<const int> physicalNodeIds,
+                                            int                      numSocketsPerNode);
+
 #endif
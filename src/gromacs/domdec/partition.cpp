@@ -2553,6 +2553,29 @@ static void add_dd_statistics(gmx_domdec_t* dd)
         auto range = static_cast<DDAtomRanges::Type>(i);
         comm->sum_nat[i] += comm->atomRanges.end(range) - comm->atomRanges.start(range);
     }
+
+    /* Count the bytes sent per step in the coordinate and force halo exchange */
+    if (!comm->physicalNodeIdOfRank.empty())
+    {
+        const int thisNode = comm->physicalNodeIdOfRank[dd->rank];
+        int       nzone    = 1;
+        for (int d = 0; d < dd->ndim; d++)
+        {
+            /* Coordinates are sent backward, forces forward */
+            const bool xToOtherNode = (comm->physicalNodeIdOfRank[dd->neighbor[d][1]] != thisNode);
+            const bool fToOtherNode = (comm->physicalNodeIdOfRank[dd->neighbor[d][0]] != thisNode);
+            for (const gmx_domdec_ind_t& ind : comm->cd[d].ind)
+            {
+                const double xBytes = ind.nsend[nzone + 1] * sizeof(gmx::RVec);
+                const double fBytes = ind.nrecv[nzone + 1] * sizeof(gmx::RVec);
+                comm->sum_haloBytes += xBytes + fBytes;
+                comm->sum_haloBytesInterNode +=
+                        (xToOtherNode ? xBytes : 0) + (fToOtherNode ? fBytes : 0);
+            }
+            nzone += nzone;
+        }
+    }
+
     comm->ndecomp++;
 }
 
@@ -2565,7 +2588,9 @@ void reset_dd_statistics_counters(gmx_domdec_t* dd)
     {
         comm->sum_nat[i] = 0;
     }
-    comm->ndecomp   = 0;
+    comm->sum_haloBytes          = 0;
+    comm->sum_haloBytesInterNode = 0;
+    comm->ndecomp                = 0;
     comm->nload     = 0;
     comm->load_step = 0;
     comm->load_sum  = 0;
@@ -2581,6 +2606,8 @@ void print_dd_statistics(const t_commrec* cr, const t_inputrec* ir, FILE* fplog)
 
     const int numRanges = static_cast<int>(DDAtomRanges::Type::Number);
     gmx_sumd(numRanges, comm->sum_nat, cr);
+    double haloBytes[2] = { comm->sum_haloBytes, comm->sum_haloBytesInterNode };
+    gmx_sumd(2, haloBytes, cr);
 
     if (fplog == nullptr)
     {
@@ -2615,6 +2642,13 @@ void print_dd_statistics(const t_commrec* cr, const t_inputrec* ir, FILE* fplog)
             default: gmx_incons(" Unknown type for DD statistics");
         }
     }
+    const auto& nodeIds = comm->physicalNodeIdOfRank;
+    if (std::any_of(nodeIds.begin(), nodeIds.end(),
+                    [&nodeIds](int id) { return id != nodeIds[0]; }))
+    {
+        fprintf(fplog, " av. halo bytes communicated per step:        %.0f, %.1f%% between nodes\n",
+                haloBytes[0] / comm->ndecomp, 100 * haloBytes[1] / std::max(haloBytes[0], 1.0));
+    }
     fprintf(fplog, "\n");
 
     if (comm->ddSettings.recordLoad && EI_DYNAMICS(ir->eI))
@@ -0,0 +1,120 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2020, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the topology-aware placement of DD cells on ranks.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include "gromacs/domdec/domdec_setup.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/arrayref.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+TEST(TopologyAwareDDCellIndices, KeepsOrderWithConsecutiveRanksOnNodes)
+{
+    const ivec             numDomains      = { 4, 2, 1 };
+    const std::vector<int> physicalNodeIds = { 7, 7, 7, 7, 3, 3, 3, 3 };
+
+    const std::vector<int> cellIndices = topologyAwareDDCellIndices(numDomains, physicalNodeIds, 1);
+
+    const std::vector<int> expected = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    EXPECT_EQ(cellIndices, expected);
+}
+
+TEST(TopologyAwareDDCellIndices, GroupsInterleavedRanksByNode)
+{
+    const ivec             numDomains      = { 4, 2, 1 };
+    const std::vector<int> physicalNodeIds = { 7, 3, 7, 3, 7, 3, 7, 3 };
+
+    const std::vector<int> cellIndices = topologyAwareDDCellIndices(numDomains, physicalNodeIds, 1);
+
+    /* The 2x2 block with x < 2 is on the node of rank 0 */
+    const std::vector<int> expected = { 0, 4, 1, 5, 2, 6, 3, 7 };
+    EXPECT_EQ(cellIndices, expected);
+}
+
+TEST(TopologyAwareDDCellIndices, PlacesBlocksOnSockets)
+{
+    const ivec             numDomains      = { 2, 4, 1 };
+    const std::vector<int> physicalNodeIds = { 1, 1, 1, 1, 1, 1, 1, 1 };
+
+    const std::vector<int> cellIndices = topologyAwareDDCellIndices(numDomains, physicalNodeIds, 2);
+
+    /* Each socket gets a 2x2 block instead of a 1x4 row */
+    const std::vector<int> expected = { 0, 1, 4, 5, 2, 3, 6, 7 };
+    EXPECT_EQ(cellIndices, expected);
+}
+
+TEST(TopologyAwareDDCellIndices, AssignsEachCellOnce)
+{
+    const ivec       numDomains = { 6, 4, 3 };
+    std::vector<int> physicalNodeIds;
+    for (int rank = 0; rank < 72; rank++)
+    {
+        physicalNodeIds.push_back((rank * 5) % 6);
+    }
+
+    std::vector<int> cellIndices = topologyAwareDDCellIndices(numDomains, physicalNodeIds, 2);
+
+    ASSERT_EQ(cellIndices.size(), physicalNodeIds.size());
+    EXPECT_EQ(cellIndices[0], 0);
+    std::sort(cellIndices.begin(), cellIndices.end());
+    for (int i = 0; i < 72; i++)
+    {
+        EXPECT_EQ(cellIndices[i], i);
+    }
+}
+
+TEST(TopologyAwareDDCellIndices, ReturnsEmptyWithUnevenNodes)
+{
+    const ivec             numDomains      = { 4, 1, 1 };
+    const std::vector<int> physicalNodeIds = { 0, 0, 0, 1 };
+
+    EXPECT_TRUE(topologyAwareDDCellIndices(numDomains, physicalNodeIds, 1).empty());
+}
+
+} // namespace
@@ -40,7 +40,14 @@
 
 #include <cmath>
 
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "gromacs/math/invertmatrix.h"
 #include "gromacs/math/utilities.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/real.h"
 
 real calc_ewaldcoeff_q(real rc, real rtol)
@@ -113,3 +120,170 @@ real calc_ewaldcoeff_lj(real rc, real rtol)
     }
     return beta;
 }
+
+/* The two polynomials below are the ones of the original gmx pme_error
+ * implementation, including the order of the summation, so its output
+ * does not change. Note that with odd orders the signed terms with
+ * negative image indices cancel the central term at the Nyquist frequency.
+ */
+
+real pmeErrorEstimatePoly1(real m, real K, real n)
+{
+    real nom   = 0; /* nominator */
+    real denom = 0; /* denominator */
+    real tmp   = 0;
+
+    if (m == 0.0)
+    {
+        return 0.0;
+    }
+
+    for (int i = -c_pmeErrorSumOrder; i < 0; i++)
+    {
+        tmp = m / K + i;
+        tmp *= 2.0 * M_PI;
+        nom += std::pow(tmp, -n);
+    }
+
+    for (int i = c_pmeErrorSumOrder; i > 0; i--)
+    {
+        tmp = m / K + i;
+        tmp *= 2.0 * M_PI;
+        nom += std::pow(tmp, -n);
+    }
+
+    tmp = m / K;
+    tmp *= 2.0 * M_PI;
+    denom = std::pow(tmp, -n) + nom;
+
+    return -nom / denom;
+}
+
+real pmeErrorEstimatePoly2(real m, real K, real n)
+{
+    real nom   = 0; /* nominator */
+    real denom = 0; /* denominator */
+    real tmp   = 0;
+
+    if (m == 0.0)
+    {
+        return 0.0;
+    }
+
+    for (int i = -c_pmeErrorSumOrder; i < 0; i++)
+    {
+        tmp = m / K + i;
+        tmp *= 2.0 * M_PI;
+        nom += std::pow(tmp, -2 * n);
+    }
+
+    for (int i = c_pmeErrorSumOrder; i > 0; i--)
+    {
+        tmp = m / K + i;
+        tmp *= 2.0 * M_PI;
+        nom += std::pow(tmp, -2 * n);
+    }
+
+    for (int i = -c_pmeErrorSumOrder; i < c_pmeErrorSumOrder + 1; i++)
+    {
+        tmp = m / K + i;
+        tmp *= 2.0 * M_PI;
+        denom += std::pow(tmp, -n);
+    }
+    tmp = pmeErrorEstimatePoly1(m, K, n);
+    return nom / denom / denom + tmp * tmp;
+}
+
+double pmeReciprocalErrorMeasure(const matrix box,
+                                 const ivec   gridSize,
+                                 real         ewaldCoeff,
+                                 int          pmeOrder,
+                                 int          numThreads)
+{
+    GMX_RELEASE_ASSERT(pmeOrder % 2 == 0, "The error estimate is only valid for even PME orders");
+
+    matrix recipbox;
+    gmx::invertBoxMatrix(box, recipbox);
+    const double volume = det(box);
+
+    /* The polynomials only depend on the grid index along one dimension */
+    std::array<std::vector<double>, DIM> poly1;
+    std::array<std::vector<double>, DIM> poly2;
+    for (int d = 0; d < DIM; d++)
+    {
+        const int mMax = gridSize[d] / 2;
+        poly1[d].resize(2 * mMax + 1);
+        poly2[d].resize(2 * mMax + 1);
+        for (int m = -mMax; m <= mMax; m++)
+        {
+            poly1[d][m + mMax] = pmeErrorEstimatePoly1(m, gridSize[d], pmeOrder);
+            poly2[d][m + mMax] = pmeErrorEstimatePoly2(m, gridSize[d], pmeOrder);
+        }
+    }
+
+    /* The terms decay as exp(-2*factor*k^2) times polynomials that grow at most
+     * as (factor*k^2)^pmeOrder. With factor*k^2 > pmeOrder + c_exponentMargin,
+     * the terms are more than exp(-20) smaller than the largest term, so we only
+     * sum over the reciprocal vectors within a sphere of that radius. This makes
+     * the cost independent of the grid size, so it can be called on the master
+     * rank during tuning without noticeable overhead.
+     */
+    constexpr double c_exponentMargin = 15;
+    const double     factor           = M_PI * M_PI / (ewaldCoeff * ewaldCoeff);
+    const double     k2Max            = (pmeOrder + c_exponentMargin) / factor;
+
+    const int mxMax = gridSize[XX] / 2;
+    const int myMax = gridSize[YY] / 2;
+    const int mzMax = gridSize[ZZ] / 2;
+
+    /* The terms for m and -m are identical, so we only sum over the half space
+     * with mx > 0, or mx = 0 and my > 0, or mx = my = 0 and mz > 0, and double it.
+     */
+    const int mxEnd = std::min(mxMax, static_cast<int>(std::sqrt(k2Max) / recipbox[XX][XX]));
+
+    double sum = 0;
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic) reduction(+ : sum)
+    for (int mx = 0; mx <= mxEnd; mx++)
+    {
+        const double kx       = mx * recipbox[XX][XX];
+        const double kyMax    = std::sqrt(std::max(k2Max - kx * kx, 0.0));
+        const double kyOffset = mx * recipbox[YY][XX];
+        const int    myLow    = static_cast<int>(std::ceil((-kyMax - kyOffset) / recipbox[YY][YY]));
+        const int    myHigh   = static_cast<int>(std::floor((kyMax - kyOffset) / recipbox[YY][YY]));
+        const int    myBegin  = (mx == 0 ? 0 : std::max(-myMax, myLow));
+        const int    myEnd    = std::min(myMax, myHigh);
+        for (int my = myBegin; my <= myEnd; my++)
+        {
+            const double ky       = kyOffset + my * recipbox[YY][YY];
+            const double kzMax    = std::sqrt(std::max(k2Max - kx * kx - ky * ky, 0.0));
+            const double kzOffset = mx * recipbox[ZZ][XX] + my * recipbox[ZZ][YY];
+            const int mzLow   = static_cast<int>(std::ceil((-kzMax - kzOffset) / recipbox[ZZ][ZZ]));
+            const int mzHigh  = static_cast<int>(std::floor((kzMax - kzOffset) / recipbox[ZZ][ZZ]));
+            const int mzBegin = (mx == 0 && my == 0 ? 1 : std::max(-mzMax, mzLow));
+            const int mzEnd   = std::min(mzMax, mzHigh);
+            for (int mz = mzBegin; mz <= mzEnd; mz++)
+            {
+                /* The reciprocal vector, with the same convention as pme_solve */
+                const double kz = kzOffset + mz * recipbox[ZZ][ZZ];
+                const double k2 = kx * kx + ky * ky + kz * kz;
+                if (k2 > k2Max)
+                {
+                    continue;
+                }
+                const double coeff = std::exp(-factor * k2) / (2.0 * M_PI * volume * k2);
+
+                const double p1x = poly1[XX][mx + mxMax];
+                const double p1y = poly1[YY][my + myMax];
+                const double p1z = poly1[ZZ][mz + mzMax];
+
+                double tmp = poly2[XX][mx + mxMax] + poly2[YY][my + myMax] + poly2[ZZ][mz + mzMax];
+                tmp += 2.0 * (p1x * p1y + p1z * p1y + p1z * p1x);
+                tmp += gmx::square(p1x + p1y + p1z);
+
+                sum += 2 * 32.0 * M_PI * M_PI * coeff * coeff * k2 * tmp;
+            }
+        }
+    }
+
+    return sum;
+}
@@ -81,6 +81,48 @@ real calc_ewaldcoeff_q(real rc, real rtol);
  */
 real calc_ewaldcoeff_lj(real rc, real rtol);
 
+//! The number of aliasing images summed over in the SPME reciprocal-space error estimate
+static constexpr int c_pmeErrorSumOrder = 6;
+
+/*! \brief Returns the first polynomial of the SPME reciprocal-space error estimate
+ *
+ * \param[in] m  Grid coordinate along a dimension
+ * \param[in] K  Grid size along the same dimension
+ * \param[in] n  PME interpolation order
+ */
+real pmeErrorEstimatePoly1(real m, real K, real n);
+
+/*! \brief Returns the second polynomial of the SPME reciprocal-space error estimate
+ *
+ * \param[in] m  Grid coordinate along a dimension
+ * \param[in] K  Grid size along the same dimension
+ * \param[in] n  PME interpolation order
+ */
+real pmeErrorEstimatePoly2(real m, real K, real n);
+
+/*! \brief Returns a charge-independent measure of the SPME reciprocal-space force error
+ *
+ * This is the first, aliasing, term of the reciprocal-space error estimate
+ * of gmx pme_error without the charge dependent prefactor, which is
+ * a constant for a given system. It can be used to compare the accuracy of
+ * setups with different grid sizes and interpolation orders at the same
+ * Ewald coefficient. Only reciprocal vectors within the sphere where
+ * the Gaussian factor is not negligible are summed over, so the cost does
+ * not grow with the grid size. The estimate is only valid for even orders,
+ * since for odd orders the aliasing terms cancel at the Nyquist frequency.
+ *
+ * \param[in] box         The, possibly scaled, PME box
+ * \param[in] gridSize    The number of PME grid points along each dimension
+ * \param[in] ewaldCoeff  The Ewald splitting coefficient
+ * \param[in] pmeOrder    The PME interpolation order, has to be even
+ * \param[in] numThreads  The number of OpenMP threads to use
+ */
+double pmeReciprocalErrorMeasure(const matrix box,
+                                 const ivec   gridSize,
+                                 real         ewaldCoeff,
+                                 int          pmeOrder,
+                                 int          numThreads);
+
 
 /*! \libinternal \brief Class to handle box scaling for Ewald and PME.
  *
@@ -208,6 +208,10 @@ bool pme_gpu_supports_input(const t_inputrec& ir, const gmx_mtop_t& mtop, std::s
                 "Cannot compute PME interactions on a GPU, because PME GPU requires a dynamical "
                 "integrator (md, sd, etc).");
     }
+    if (ir.useMts)
+    {
+        errorReasons.emplace_back("multiple time stepping");
+    }
     return addMessageIfNotSupported(errorReasons, error);
 }
 
@@ -854,6 +858,32 @@ gmx_pme_t* gmx_pme_init(const t_commrec*     cr,
         }
     }
 
+    /* Colored spreading avoids the thread-local grids and their reduction.
+     * It is only supported with a single PME rank, since with multiple
+     * ranks all ranks need to use the same overlap communication.
+     */
+    pme->useColoredSpread = (getenv("GMX_PME_COLORED_SPREAD") != nullptr && pme->nnodes == 1
+                             && pme->nthread > 1);
+    for (i = 0; i < pme->ngrids; ++i)
+    {
+        if (pme->useColoredSpread && pme->pmegrid[i].grid_th != nullptr)
+        {
+            pme->useColoredSpread = pmeGridsSupportColoredSpread(pme->pmegrid[i]);
+        }
+    }
+    if (pme->useColoredSpread)
+    {
+        /* Only the geometry of the thread-local grids is used, free their data */
+        for (i = 0; i < pme->ngrids; ++i)
+        {
+            pmegrids_free_thread_grid_data(&pme->pmegrid[i]);
+        }
+    }
+    if (debug && getenv("GMX_PME_COLORED_SPREAD") != nullptr)
+    {
+        fprintf(debug, "PME colored spreading: %s\n", pme->useColoredSpread ? "yes" : "no");
+    }
+
     if (!pme->bP3M)
     {
         /* Use plain SPME B-spline interpolation */
@@ -905,6 +935,7 @@ void gmx_pme_reinit(struct gmx_pme_t** pmedata,
                     struct gmx_pme_t*  pme_src,
                     const t_inputrec*  ir,
                     const ivec         grid_size,
+                    int                pmeOrder,
                     real               ewaldcoeff_q,
                     real               ewaldcoeff_lj)
 {
@@ -916,7 +947,7 @@ void gmx_pme_reinit(struct gmx_pme_t** pmedata,
     irc.coulombtype            = ir->coulombtype;
     irc.vdwtype                = ir->vdwtype;
     irc.efep                   = ir->efep;
-    irc.pme_order              = ir->pme_order;
+    irc.pme_order              = pmeOrder;
     irc.epsilon_r              = ir->epsilon_r;
     irc.ljpme_combination_rule = ir->ljpme_combination_rule;
     irc.nkx                    = grid_size[XX];
@@ -926,7 +957,7 @@ void gmx_pme_reinit(struct gmx_pme_t** pmedata,
     try
     {
         const gmx::MDLogger dummyLogger;
-        // This is reinit which is currently only changing grid size/coefficients,
+        // This is reinit which is currently only changing grid size/order/coefficients,
         // so we don't expect the actual logging.
         // TODO: when PME is an object, it should take reference to mdlog on construction and save it.
         GMX_ASSERT(pmedata, "Invalid PME pointer");
@@ -1716,7 +1747,8 @@ void gmx_pme_reinit_atoms(gmx_pme_t* pme, const int numAtoms, const real* charge
     }
 }
 
-bool gmx_pme_grid_matches(const gmx_pme_t& pme, const ivec grid_size)
+bool gmx_pme_grid_matches(const gmx_pme_t& pme, const ivec grid_size, int pmeOrder)
 {
-    return (pme.nkx == grid_size[XX] && pme.nky == grid_size[YY] && pme.nkz == grid_size[ZZ]);
+    return (pme.nkx == grid_size[XX] && pme.nky == grid_size[YY] && pme.nkz == grid_size[ZZ]
+            && pme.pme_order == pmeOrder);
 }
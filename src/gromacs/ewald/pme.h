@@ -105,8 +105,8 @@ enum class PmeRunMode
 /*! \brief Return the smallest allowed PME grid size for \p pmeOrder */
 int minimalPmeGridSize(int pmeOrder);
 
-//! Return whether the grid of \c pme is identical to \c grid_size.
-bool gmx_pme_grid_matches(const gmx_pme_t& pme, const ivec grid_size);
+//! Return whether the grid of \c pme is identical to \c grid_size and uses order \c pmeOrder.
+bool gmx_pme_grid_matches(const gmx_pme_t& pme, const ivec grid_size, int pmeOrder);
 
 /*! \brief Check restrictions on pme_order and the PME grid nkx,nky,nkz.
  *
@@ -153,14 +153,15 @@ gmx_pme_t* gmx_pme_init(const t_commrec*     cr,
                         const PmeGpuProgram* pmeGpuProgram,
                         const gmx::MDLogger& mdlog);
 
-/*! \brief As gmx_pme_init, but takes most settings, except the grid/Ewald coefficients, from
- * pme_src. This is only called when the PME cut-off/grid size changes.
+/*! \brief As gmx_pme_init, but takes most settings, except the grid/order/Ewald coefficients,
+ * from pme_src. This is only called when the PME cut-off/grid size/order changes.
  */
 void gmx_pme_reinit(gmx_pme_t**       pmedata,
                     const t_commrec*  cr,
                     gmx_pme_t*        pme_src,
                     const t_inputrec* ir,
                     const ivec        grid_size,
+                    int               pmeOrder,
                     real              ewaldcoeff_q,
                     real              ewaldcoeff_lj);
 
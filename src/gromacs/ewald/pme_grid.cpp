@@ -776,6 +776,21 @@ void pmegrids_destroy(pmegrids_t* grids)
     }
 }
 
+void pmegrids_free_thread_grid_data(pmegrids_t* grids)
+{
+    if (grids->grid_th == nullptr)
+    {
+        return;
+    }
+
+    sfree_aligned(grids->grid_all);
+    grids->grid_all = nullptr;
+    for (int t = 0; t < grids->nthread; t++)
+    {
+        grids->grid_th[t].grid = nullptr;
+    }
+}
+
 void make_gridindex_to_localindex(int n, int local_start, int local_range, int** global_to_local, real** fraction_shift)
 {
     /* Here we construct array for looking up the grid line index and
@@ -849,7 +864,20 @@ void reuse_pmegrids(const pmegrids_t* oldgrid, pmegrids_t* newgrid)
     sfree_aligned(newgrid->grid.grid);
     newgrid->grid.grid = oldgrid->grid.grid;
 
-    if (newgrid->grid_th != nullptr && newgrid->nthread == oldgrid->nthread)
+    /* Without thread-local grid data, e.g. with colored spreading, there is nothing to share */
+    bool threadGridsFit = (newgrid->grid_all != nullptr && oldgrid->grid_all != nullptr
+                           && newgrid->nthread == oldgrid->nthread);
+    /* With a higher PME order, the thread-local grids can be larger
+     * than the old ones, even when the full grid is not.
+     */
+    for (t = 0; t < newgrid->nthread && threadGridsFit; t++)
+    {
+        const ivec& sNew = newgrid->grid_th[t].s;
+        const ivec& sOld = oldgrid->grid_th[t].s;
+        threadGridsFit   = (sNew[XX] * sNew[YY] * sNew[ZZ] <= sOld[XX] * sOld[YY] * sOld[ZZ]);
+    }
+
+    if (threadGridsFit)
     {
         sfree_aligned(newgrid->grid_all);
         newgrid->grid_all = oldgrid->grid_all;
@@ -94,6 +94,14 @@ void pmegrids_init(pmegrids_t* grids,
 
 void pmegrids_destroy(pmegrids_t* grids);
 
+/*! \brief Frees the data of the thread-local grids of \p grids
+ *
+ * The thread-local grid geometry is kept, as this is also used for
+ * the thread decomposition with colored spreading, which spreads
+ * directly on the full node grid.
+ */
+void pmegrids_free_thread_grid_data(pmegrids_t* grids);
+
 void make_gridindex_to_localindex(int n, int local_start, int local_range, int** global_to_local, real** fraction_shift);
 
 void set_grid_alignment(int* pmegrid_nz, int pme_order);
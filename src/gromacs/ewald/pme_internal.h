@@ -321,6 +321,10 @@ struct gmx_pme_t
 
     gmx_bool bUseThreads; /* Does any of the PME ranks have nthread>1 ?  */
     int      nthread;     /* The number of threads doing PME on our rank */
+    /* Spread with all threads directly on the full node grid, using
+     * colored thread sub-blocks, instead of on thread-local grids
+     */
+    bool useColoredSpread;
 
     gmx_bool bPPnode;   /* Node also does particle-particle forces */
     bool     doCoulomb; /* Apply PME to electrostatics */
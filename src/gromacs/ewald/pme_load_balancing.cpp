@@ -48,6 +48,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 
 #include <algorithm>
 
@@ -64,6 +65,7 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/dispersioncorrection.h"
 #include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/mdtypes/forcerec.h"
 #include "gromacs/mdtypes/inputrec.h"
@@ -93,6 +95,7 @@ struct pme_setup_t
     real rlistInner;           /**< cut-off for the inner pair-list              */
     real spacing;              /**< (largest) PME grid spacing                   */
     ivec grid;                 /**< the PME grid dimensions                      */
+    int  pmeOrder;             /**< the PME interpolation order                  */
     real grid_efficiency;      /**< ineffiency factor for non-uniform grids <= 1 */
     real ewaldcoeff_q;         /**< Electrostatic Ewald coefficient            */
     real ewaldcoeff_lj;        /**< LJ Ewald coefficient, only for the call to send_switchgrid */
@@ -128,6 +131,13 @@ const real maxRelativeSlowdownAccepted = 1.12;
  * choosing a slower setup due to acceleration or fluctuations.
  */
 const real maxFluctuationAccepted = 1.02;
+/*! \brief The maximum increase of the PME order tried when tuning the order */
+const int c_maxPmeOrderIncrease = 2;
+/*! \brief The step in PME order when tuning the order
+ *
+ * Only even orders are tried, as the error estimate cannot be used for odd orders.
+ */
+const int c_pmeOrderTuningStep = 2;
 
 //! \brief Number of nstlist long tuning intervals to skip before starting
 //         load-balancing at the beginning of the run.
@@ -164,6 +174,8 @@ struct pme_load_balancing_t
     int64_t  step_rel_stop; /**< stop the tuning after this value of step_rel */
     gmx_bool bTriggerOnDLB; /**< trigger balancing only on DD DLB */
     gmx_bool bBalance;      /**< are we in the balancing phase, i.e. trying different setups? */
+    bool     tunePmeOrder;  /**< should we also try higher PME orders on coarser grids? */
+    bool     pmeOrderSetupsAdded; /**< have the higher PME order setups been generated? */
     int      nstage;        /**< the current maximum number of stages */
     bool     startupTimeDelayElapsed; /**< Has the c_startupTimeDelay elapsed indicating that the balancing can start. */
 
@@ -207,7 +219,8 @@ void pme_loadbal_init(pme_load_balancing_t**     pme_lb_p,
                       const interaction_const_t& ic,
                       const nonbonded_verlet_t&  nbv,
                       gmx_pme_t*                 pmedata,
-                      gmx_bool                   bUseGPU)
+                      gmx_bool                   bUseGPU,
+                      bool                       useGpuForPme)
 {
 
     pme_load_balancing_t* pme_lb;
@@ -257,6 +270,7 @@ void pme_loadbal_init(pme_load_balancing_t**     pme_lb_p,
     pme_lb->setup[0].grid[XX]      = ir.nkx;
     pme_lb->setup[0].grid[YY]      = ir.nky;
     pme_lb->setup[0].grid[ZZ]      = ir.nkz;
+    pme_lb->setup[0].pmeOrder      = ir.pme_order;
     pme_lb->setup[0].ewaldcoeff_q  = ic.ewaldcoeff_q;
     pme_lb->setup[0].ewaldcoeff_lj = ic.ewaldcoeff_lj;
 
@@ -324,6 +338,24 @@ void pme_loadbal_init(pme_load_balancing_t**     pme_lb_p,
      */
     pme_lb->bBalance = (pme_lb->bActive && (bUseGPU && !pme_lb->bSepPMERanks));
 
+    /* Trading a coarser grid for a higher interpolation order is only
+     * supported with CPU PME and only for electrostatics, since the error
+     * estimate we use to match the accuracy is for Coulomb only.
+     * That estimate is only valid for even orders.
+     */
+    pme_lb->tunePmeOrder =
+            (getenv("GMX_PME_TUNE_ORDER") != nullptr && !useGpuForPme && !EVDW_PME(ir.vdwtype)
+             && ir.pme_order % 2 == 0 && ir.pme_order + c_pmeOrderTuningStep <= PME_ORDER_MAX);
+    pme_lb->pmeOrderSetupsAdded = false;
+    if (pme_lb->tunePmeOrder)
+    {
+        GMX_LOG(mdlog.info)
+                .asParagraph()
+                .appendText(
+                        "The PME load balancing will also try higher PME orders on coarser grids, "
+                        "as requested by GMX_PME_TUNE_ORDER");
+    }
+
     pme_lb->step_rel_stop = PMETunePeriod * ir.nstlist;
 
     /* Delay DD load balancing when GPUs are used */
@@ -389,6 +421,7 @@ static gmx_bool pme_loadbal_increase_cutoff(pme_load_balancing_t* pme_lb, int pm
                                              numPmeDomains.x, true, false);
     } while (sp <= 1.001 * pme_lb->setup[pme_lb->cur].spacing || !grid_ok);
 
+    set.pmeOrder     = pme_order;
     set.rcut_coulomb = pme_lb->cut_spacing * sp;
     if (set.rcut_coulomb < pme_lb->rcut_coulomb_start)
     {
@@ -445,11 +478,105 @@ static gmx_bool pme_loadbal_increase_cutoff(pme_load_balancing_t* pme_lb, int pm
     return TRUE;
 }
 
-/*! \brief Print the PME grid */
-static void print_grid(FILE* fp_err, FILE* fp_log, const char* pre, const char* desc, const pme_setup_t* set, double cycles)
+/*! \brief Add setups with higher PME orders on coarser grids
+ *
+ * Starting from the fastest setup, for each higher order the coarsest grid
+ * is selected for which the estimated reciprocal-space error is not larger
+ * than that of the fastest setup. The cut-off and Ewald coefficient are not
+ * changed, so the real-space error stays the same as well.
+ * The new setups are inserted directly after the fastest setup, so the setups
+ * stay sorted by cut-off. Returns the number of setups added.
+ */
+static int pme_loadbal_add_order_setups(pme_load_balancing_t* pme_lb, const gmx_domdec_t* dd)
+{
+    const pme_setup_t base = pme_lb->setup[pme_lb->fastest];
+
+    const int    numThreads = gmx_omp_nthreads_get(emntPME);
+    const double baseError  = pmeReciprocalErrorMeasure(
+            pme_lb->box_start, base.grid, base.ewaldcoeff_q, base.pmeOrder, numThreads);
+
+    NumPmeDomains numPmeDomains = getNumPmeDomains(dd);
+
+    std::vector<pme_setup_t> orderSetups;
+    const int maxOrder = std::min(base.pmeOrder + c_maxPmeOrderIncrease, PME_ORDER_MAX);
+    for (int pmeOrder = base.pmeOrder + c_pmeOrderTuningStep; pmeOrder <= maxOrder;
+         pmeOrder += c_pmeOrderTuningStep)
+    {
+        pme_setup_t set = base;
+        set.pmeOrder    = pmeOrder;
+        set.pmedata     = nullptr;
+        set.count       = 0;
+        set.cycles      = 0;
+
+        /* Coarsen the grid until the error gets larger than the base error.
+         * As many scaling factors give the same grid, we only evaluate
+         * the (expensive) error estimate when the grid changed.
+         */
+        bool setupFound = false;
+        ivec prevGrid   = { 0, 0, 0 };
+        for (real fac = 1.01; fac <= 2.1; fac *= 1.01)
+        {
+            ivec grid = { 0, 0, 0 };
+            real sp   = calcFftGrid(nullptr, pme_lb->box_start, fac * base.spacing,
+                                  minimalPmeGridSize(pmeOrder), &grid[XX], &grid[YY], &grid[ZZ]);
+            if ((grid[XX] == prevGrid[XX] && grid[YY] == prevGrid[YY] && grid[ZZ] == prevGrid[ZZ])
+                || !gmx_pme_check_restrictions(pmeOrder, grid[XX], grid[YY], grid[ZZ],
+                                               numPmeDomains.x, true, false))
+            {
+                continue;
+            }
+            copy_ivec(grid, prevGrid);
+
+            if (pmeReciprocalErrorMeasure(pme_lb->box_start, grid, base.ewaldcoeff_q, pmeOrder,
+                                          numThreads)
+                > baseError)
+            {
+                break;
+            }
+            copy_ivec(grid, set.grid);
+            set.spacing = sp;
+            setupFound  = true;
+        }
+
+        if (setupFound
+            && set.grid[XX] * set.grid[YY] * set.grid[ZZ] < base.grid[XX] * base.grid[YY] * base.grid[ZZ])
+        {
+            set.grid_efficiency = 1;
+            for (int d = 0; d < DIM; d++)
+            {
+                set.grid_efficiency *= (set.grid[d] * set.spacing) / norm(pme_lb->box_start[d]);
+            }
+
+            if (debug)
+            {
+                fprintf(debug, "PME loadbal: grid %d %d %d, pme order %d, coulomb cutoff %f\n",
+                        set.grid[XX], set.grid[YY], set.grid[ZZ], set.pmeOrder, set.rcut_coulomb);
+            }
+            orderSetups.push_back(set);
+        }
+    }
+
+    pme_lb->setup.insert(pme_lb->setup.begin() + pme_lb->fastest + 1, orderSetups.begin(),
+                         orderSetups.end());
+
+    return orderSetups.size();
+}
+
+/*! \brief Print the PME grid, and the PME order when \p printOrder is true */
+static void print_grid(FILE*              fp_err,
+                       FILE*              fp_log,
+                       const char*        pre,
+                       const char*        desc,
+                       const pme_setup_t* set,
+                       double             cycles,
+                       bool               printOrder)
 {
     auto buf = gmx::formatString("%-11s%10s pme grid %d %d %d, coulomb cutoff %.3f", pre, desc,
                                  set->grid[XX], set->grid[YY], set->grid[ZZ], set->rcut_coulomb);
+    if (printOrder)
+    {
+        buf += gmx::formatString(", pme order %d", set->pmeOrder);
+    }
     if (cycles >= 0)
     {
         buf += gmx::formatString(": %.1f M-cycles", cycles * 1e-6);
@@ -499,8 +626,11 @@ static void print_loadbal_limited(FILE* fp_err, FILE* fp_log, int64_t step, pme_
 
 /*! \brief Switch load balancing to stage 1
  *
- * In this stage, only reasonably fast setups are run again. */
-static void switch_to_stage1(pme_load_balancing_t* pme_lb)
+ * In this stage, only reasonably fast setups are run again.
+ * When requested, setups with higher PME order are added here,
+ * as these are derived from the fastest setup of stage 0.
+ */
+static void switch_to_stage1(pme_load_balancing_t* pme_lb, const gmx_domdec_t* dd)
 {
     /* Increase start until we find a setup that is not slower than
      * maxRelativeSlowdownAccepted times the fastest setup.
@@ -532,6 +662,15 @@ static void switch_to_stage1(pme_load_balancing_t* pme_lb)
         pme_lb->end--;
     }
 
+    if (pme_lb->tunePmeOrder && !pme_lb->pmeOrderSetupsAdded)
+    {
+        pme_lb->pmeOrderSetupsAdded = true;
+        /* The new, untimed, setups are inserted after the fastest setup,
+         * which lies in the range [start, end), so we extend the range.
+         */
+        pme_lb->end += pme_loadbal_add_order_setups(pme_lb, dd);
+    }
+
     pme_lb->stage = 1;
 
     /* Next we want to choose setup pme_lb->end-1, but as we will decrease
@@ -589,7 +728,7 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
     }
 
     sprintf(buf, "step %4s: ", gmx_step_str(step, sbuf));
-    print_grid(fp_err, fp_log, buf, "timed with", set, cycles);
+    print_grid(fp_err, fp_log, buf, "timed with", set, cycles, pme_lb->tunePmeOrder);
 
     GMX_RELEASE_ASSERT(set->count > c_numPostSwitchTuningIntervalSkip, "We should skip cycles");
     if (set->count == (c_numPostSwitchTuningIntervalSkip + 1))
@@ -650,7 +789,7 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
     {
         pme_lb->setup.resize(pme_lb->cur + 1);
         /* Done with scanning, go to stage 1 */
-        switch_to_stage1(pme_lb);
+        switch_to_stage1(pme_lb, cr->dd);
     }
 
     if (pme_lb->stage == 0)
@@ -717,7 +856,7 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
                 pme_lb->setup.resize(pme_lb->cur + 1);
                 print_loadbal_limited(fp_err, fp_log, step, pme_lb);
                 /* Switch to the next stage */
-                switch_to_stage1(pme_lb);
+                switch_to_stage1(pme_lb, cr->dd);
             }
         } while (OK
                  && !(pme_lb->setup[pme_lb->cur].grid[XX] * pme_lb->setup[pme_lb->cur].grid[YY]
@@ -853,24 +992,24 @@ static void pme_load_balance(pme_load_balancing_t*          pme_lb,
              * copying part of the old pointers.
              */
             gmx_pme_reinit(&set->pmedata, cr, pme_lb->setup[0].pmedata, &ir, set->grid,
-                           set->ewaldcoeff_q, set->ewaldcoeff_lj);
+                           set->pmeOrder, set->ewaldcoeff_q, set->ewaldcoeff_lj);
         }
         *pmedata = set->pmedata;
     }
     else
     {
         /* Tell our PME-only rank to switch grid */
-        gmx_pme_send_switchgrid(cr, set->grid, set->ewaldcoeff_q, set->ewaldcoeff_lj);
+        gmx_pme_send_switchgrid(cr, set->grid, set->pmeOrder, set->ewaldcoeff_q, set->ewaldcoeff_lj);
     }
 
     if (debug)
     {
-        print_grid(nullptr, debug, "", "switched to", set, -1);
+        print_grid(nullptr, debug, "", "switched to", set, -1, pme_lb->tunePmeOrder);
     }
 
     if (pme_lb->stage == pme_lb->nstage)
     {
-        print_grid(fp_err, fp_log, "", "optimal", set, -1);
+        print_grid(fp_err, fp_log, "", "optimal", set, -1, pme_lb->tunePmeOrder);
     }
 }
 
@@ -1117,6 +1256,11 @@ static void print_pme_loadbal_settings(pme_load_balancing_t* pme_lb,
     fprintf(fplog, "            rcoulomb  rlist            grid      spacing   1/beta\n");
     print_pme_loadbal_setting(fplog, "initial", &pme_lb->setup[0]);
     print_pme_loadbal_setting(fplog, "final", &pme_lb->setup[pme_lb->cur]);
+    if (pme_lb->setup[pme_lb->cur].pmeOrder != pme_lb->setup[0].pmeOrder)
+    {
+        fprintf(fplog, " PME order changed from %d to %d\n", pme_lb->setup[0].pmeOrder,
+                pme_lb->setup[pme_lb->cur].pmeOrder);
+    }
     fprintf(fplog, " cost-ratio           %4.2f             %4.2f\n", pp_ratio, grid_ratio);
     fprintf(fplog, " (note that these numbers concern only part of the total PP and PME load)\n");
 
@@ -86,7 +86,8 @@ void pme_loadbal_init(pme_load_balancing_t**     pme_lb_p,
                       const interaction_const_t& ic,
                       const nonbonded_verlet_t&  nbv,
                       gmx_pme_t*                 pmedata,
-                      gmx_bool                   bUseGPU);
+                      gmx_bool                   bUseGPU,
+                      bool                       useGpuForPme);
 
 /*! \brief Process cycles and PME load balance when necessary
  *
@@ -188,6 +188,7 @@ static void reset_pmeonly_counters(gmx_wallcycle_t           wcycle,
 
 static gmx_pme_t* gmx_pmeonly_switch(std::vector<gmx_pme_t*>* pmedata,
                                      const ivec               grid_size,
+                                     int                      pmeOrder,
                                      real                     ewaldcoeff_q,
                                      real                     ewaldcoeff_lj,
                                      const t_commrec*         cr,
@@ -197,7 +198,7 @@ static gmx_pme_t* gmx_pmeonly_switch(std::vector<gmx_pme_t*>* pmedata,
     for (auto& pme : *pmedata)
     {
         GMX_ASSERT(pme, "Bad PME tuning list element pointer");
-        if (gmx_pme_grid_matches(*pme, grid_size))
+        if (gmx_pme_grid_matches(*pme, grid_size, pmeOrder))
         {
             /* Here we have found an existing PME data structure that suits us.
              * However, in the GPU case, we have to reinitialize it - there's only one GPU structure.
@@ -205,7 +206,7 @@ static gmx_pme_t* gmx_pmeonly_switch(std::vector<gmx_pme_t*>* pmedata,
              * So, just some grid size updates in the GPU kernel parameters.
              * TODO: this should be something like gmx_pme_update_split_params()
              */
-            gmx_pme_reinit(&pme, cr, pme, ir, grid_size, ewaldcoeff_q, ewaldcoeff_lj);
+            gmx_pme_reinit(&pme, cr, pme, ir, grid_size, pmeOrder, ewaldcoeff_q, ewaldcoeff_lj);
             return pme;
         }
     }
@@ -213,7 +214,7 @@ static gmx_pme_t* gmx_pmeonly_switch(std::vector<gmx_pme_t*>* pmedata,
     const auto& pme          = pmedata->back();
     gmx_pme_t*  newStructure = nullptr;
     // Copy last structure with new grid params
-    gmx_pme_reinit(&newStructure, cr, pme, ir, grid_size, ewaldcoeff_q, ewaldcoeff_lj);
+    gmx_pme_reinit(&newStructure, cr, pme, ir, grid_size, pmeOrder, ewaldcoeff_q, ewaldcoeff_lj);
     pmedata->push_back(newStructure);
     return newStructure;
 }
@@ -232,6 +233,7 @@ static gmx_pme_t* gmx_pmeonly_switch(std::vector<gmx_pme_t*>* pmedata,
  *                                    step, otherwise set to false.
  * \param[out] step                   MD integration step number.
  * \param[out] grid_size              PME grid size, if received.
+ * \param[out] pmeOrder               PME interpolation order, if received.
  * \param[out] ewaldcoeff_q           Ewald cut-off parameter for electrostatics, if received.
  * \param[out] ewaldcoeff_lj          Ewald cut-off parameter for Lennard-Jones, if received.
  * \param[in]  useGpuForPme           Flag on whether PME is on GPU.
@@ -240,7 +242,7 @@ static gmx_pme_t* gmx_pmeonly_switch(std::vector<gmx_pme_t*>* pmedata,
  *
  * \retval pmerecvqxX                 All parameters were set, chargeA and chargeB can be NULL.
  * \retval pmerecvqxFINISH            No parameters were set.
- * \retval pmerecvqxSWITCHGRID        Only grid_size and *ewaldcoeff were set.
+ * \retval pmerecvqxSWITCHGRID        Only grid_size, *pmeOrder and *ewaldcoeff were set.
  * \retval pmerecvqxRESETCOUNTERS     *step was set.
  */
 static int gmx_pme_recv_coeffs_coords(struct gmx_pme_t*            pme,
@@ -254,6 +256,7 @@ static int gmx_pme_recv_coeffs_coords(struct gmx_pme_t*            pme,
                                       gmx_bool*                    computeEnergyAndVirial,
                                       int64_t*                     step,
                                       ivec*                        grid_size,
+                                      int*                         pmeOrder,
                                       real*                        ewaldcoeff_q,
                                       real*                        ewaldcoeff_lj,
                                       bool                         useGpuForPme,
@@ -306,6 +309,7 @@ static int gmx_pme_recv_coeffs_coords(struct gmx_pme_t*            pme,
         {
             /* Special case, receive the new parameters and return */
             copy_ivec(cnb.grid_size, *grid_size);
+            *pmeOrder      = cnb.pme_order;
             *ewaldcoeff_q  = cnb.ewaldcoeff_q;
             *ewaldcoeff_lj = cnb.ewaldcoeff_lj;
 
@@ -497,6 +501,7 @@ static int gmx_pme_recv_coeffs_coords(struct gmx_pme_t*            pme,
     GMX_UNUSED_VALUE(computeEnergyAndVirial);
     GMX_UNUSED_VALUE(step);
     GMX_UNUSED_VALUE(grid_size);
+    GMX_UNUSED_VALUE(pmeOrder);
     GMX_UNUSED_VALUE(ewaldcoeff_q);
     GMX_UNUSED_VALUE(ewaldcoeff_lj);
     GMX_UNUSED_VALUE(useGpuForPme);
@@ -663,16 +668,18 @@ int gmx_pmeonly(struct gmx_pme_t*               pme,
         {
             /* Domain decomposition */
             ivec newGridSize;
+            int  newPmeOrder  = 0;
             real ewaldcoeff_q = 0, ewaldcoeff_lj = 0;
             ret = gmx_pme_recv_coeffs_coords(pme, pme_pp.get(), &natoms, box, &maxshift_x, &maxshift_y,
                                              &lambda_q, &lambda_lj, &computeEnergyAndVirial, &step,
-                                             &newGridSize, &ewaldcoeff_q, &ewaldcoeff_lj,
-                                             useGpuForPme, stateGpu.get(), runMode);
+                                             &newGridSize, &newPmeOrder, &ewaldcoeff_q,
+                                             &ewaldcoeff_lj, useGpuForPme, stateGpu.get(), runMode);
 
             if (ret == pmerecvqxSWITCHGRID)
             {
-                /* Switch the PME grid to newGridSize */
-                pme = gmx_pmeonly_switch(&pmedata, newGridSize, ewaldcoeff_q, ewaldcoeff_lj, cr, ir);
+                /* Switch the PME grid to newGridSize and the order to newPmeOrder */
+                pme = gmx_pmeonly_switch(&pmedata, newGridSize, newPmeOrder, ewaldcoeff_q,
+                                         ewaldcoeff_lj, cr, ir);
             }
 
             if (ret == pmerecvqxRESETCOUNTERS)
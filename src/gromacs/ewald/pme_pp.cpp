@@ -320,7 +320,7 @@ void gmx_pme_send_finish(const t_commrec* cr)
                                nullptr, nullptr, 0, 0, 0, 0, -1, false, false, false, nullptr);
 }
 
-void gmx_pme_send_switchgrid(const t_commrec* cr, ivec grid_size, real ewaldcoeff_q, real ewaldcoeff_lj)
+void gmx_pme_send_switchgrid(const t_commrec* cr, ivec grid_size, int pmeOrder, real ewaldcoeff_q, real ewaldcoeff_lj)
 {
 #if GMX_MPI
     gmx_pme_comm_n_box_t cnb;
@@ -330,6 +330,7 @@ void gmx_pme_send_switchgrid(const t_commrec* cr, ivec grid_size, real ewaldcoef
     {
         cnb.flags = PP_PME_SWITCHGRID;
         copy_ivec(grid_size, cnb.grid_size);
+        cnb.pme_order     = pmeOrder;
         cnb.ewaldcoeff_q  = ewaldcoeff_q;
         cnb.ewaldcoeff_lj = ewaldcoeff_lj;
 
@@ -339,6 +340,7 @@ void gmx_pme_send_switchgrid(const t_commrec* cr, ivec grid_size, real ewaldcoef
 #else
     GMX_UNUSED_VALUE(cr);
     GMX_UNUSED_VALUE(grid_size);
+    GMX_UNUSED_VALUE(pmeOrder);
     GMX_UNUSED_VALUE(ewaldcoeff_q);
     GMX_UNUSED_VALUE(ewaldcoeff_lj);
 #endif
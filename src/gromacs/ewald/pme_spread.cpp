@@ -44,6 +44,7 @@
 #include <cassert>
 
 #include <algorithm>
+#include <limits>
 
 #include "gromacs/ewald/pme.h"
 #include "gromacs/fft/parallel_3dfft.h"
@@ -322,10 +323,46 @@ static void make_bsplines(splinevec  theta,
     }
 
 
-static void spread_coefficients_bsplines_thread(const pmegrid_t*       pmegrid,
-                                                const PmeAtomComm*     atc,
-                                                splinedata_t*          spline,
-                                                struct pme_spline_work gmx_unused* work)
+/*! \brief Selects the atoms in one color of thread sub-blocks for colored spreading
+ *
+ * Each thread-local domain is split in a lower and upper half along
+ * each dimension which is decomposed over threads.
+ */
+struct SpreadColorSelection
+{
+    //! The offset of the thread-local domain in the full node grid
+    ivec offset;
+    //! The number of grid lines in the lower half, max int along dimensions not decomposed
+    ivec halfSize;
+    //! The color to spread, bit d is set for the upper half along dimension d
+    int color;
+};
+
+//! Returns the color of the sub-block that grid index \p idx belongs to
+static inline int spreadColor(const int* idx, const SpreadColorSelection& colorSelection)
+{
+    int color = 0;
+    for (int d = 0; d < DIM; d++)
+    {
+        if (idx[d] - colorSelection.offset[d] >= colorSelection.halfSize[d])
+        {
+            color |= (1 << d);
+        }
+    }
+
+    return color;
+}
+
+/* Spreads the coefficients of the atoms in spline on pmegrid.
+ * Without colorSelection the thread-local grid pmegrid is cleared first.
+ * With colorSelection only the atoms in the selected color are spread,
+ * on the full node grid pmegrid, which should not be cleared.
+ */
+static void spread_coefficients_bsplines_thread(const pmegrid_t*            pmegrid,
+                                                const PmeAtomComm*          atc,
+                                                splinedata_t*               spline,
+                                                struct pme_spline_work gmx_unused* work,
+                                                const SpreadColorSelection* colorSelection = nullptr)
 {
 
     /* spread coefficients from home atoms to local grid */
@@ -352,9 +389,12 @@ static void spread_coefficients_bsplines_thread(const pmegrid_t*       pmegrid,
 
     ndatatot = pnx * pny * pnz;
     grid     = pmegrid->grid;
-    for (i = 0; i < ndatatot; i++)
+    if (colorSelection == nullptr)
     {
-        grid[i] = 0;
+        for (i = 0; i < ndatatot; i++)
+        {
+            grid[i] = 0;
+        }
     }
 
     order = pmegrid->order;
@@ -364,7 +404,9 @@ static void spread_coefficients_bsplines_thread(const pmegrid_t*       pmegrid,
         n           = spline->ind[nn];
         coefficient = atc->coefficient[n];
 
-        if (coefficient != 0)
+        if (coefficient != 0
+            && (colorSelection == nullptr
+                || spreadColor(atc->idx[n], *colorSelection) == colorSelection->color))
         {
             idxptr = atc->idx[n];
             norder = nn * order;
@@ -407,6 +449,150 @@ static void spread_coefficients_bsplines_thread(const pmegrid_t*       pmegrid,
     }
 }
 
+/* Returns the number of grid lines along z, in addition to the pme_order - 1
+ * lines of the spline footprints, that the spreading kernel used for
+ * \p pmeOrder needs to separate the atoms of two threads with the same color.
+ */
+static int coloredSpreadSimdMarginZ(int pmeOrder)
+{
+#ifdef PME_SIMD4_SPREAD_GATHER
+#    ifdef PME_SIMD4_UNALIGNED
+    const bool useAlignedKernel = (pmeOrder == 5);
+#    else
+    const bool useAlignedKernel = (pmeOrder == 4 || pmeOrder == 5);
+#    endif
+    if (useAlignedKernel)
+    {
+        /* The aligned kernel loads and stores two SIMD4 registers starting at
+         * the first line of the footprint rounded down to a multiple of 4.
+         * This reaches up to GMX_SIMD4_WIDTH - 1 lines below and
+         * 2*GMX_SIMD4_WIDTH - pmeOrder lines above the footprint.
+         */
+        return (GMX_SIMD4_WIDTH - 1) + (2 * GMX_SIMD4_WIDTH - pmeOrder);
+    }
+#endif
+    /* The plain C and unaligned SIMD4 kernels only access the footprint */
+    GMX_UNUSED_VALUE(pmeOrder);
+    return 0;
+}
+
+bool pmeGridsSupportColoredSpread(const pmegrids_t& grids)
+{
+    if (grids.grid_th == nullptr)
+    {
+        return false;
+    }
+
+    for (int thread = 0; thread < grids.nthread; thread++)
+    {
+        const pmegrid_t& threadGrid = grids.grid_th[thread];
+        for (int d = 0; d < DIM; d++)
+        {
+            if (grids.nc[d] > 1)
+            {
+                /* The halves of other threads with the same color should not be
+                 * within reach of the spline footprint, including the SIMD4
+                 * loads and stores along z, which might access more elements.
+                 */
+                const int margin   = (d == ZZ ? coloredSpreadSimdMarginZ(threadGrid.order) : 0);
+                const int halfSize = (threadGrid.n[d] - (threadGrid.order - 1)) / 2;
+                if (halfSize < threadGrid.order - 1 + margin)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Spreads the coefficients of all threads directly on the full node grid
+ * using colored sub-blocks of the thread-local domains, then wraps the
+ * periodic overlap and copies the result to fftgrid.
+ *
+ * This avoids clearing, copying and reducing the thread-local grids,
+ * which limits the scaling with many threads.
+ */
+static void spread_on_grid_colored(const gmx_pme_t*  pme,
+                                   PmeAtomComm*      atc,
+                                   const pmegrids_t* grids,
+                                   real*             fftgrid,
+                                   int               grid_index)
+{
+    const pmegrid_t& grid     = grids->grid;
+    const int        nthread  = grids->nthread;
+    const int        gridSize = grid.s[XX] * grid.s[YY] * grid.s[ZZ];
+
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        std::fill(grid.grid + (gridSize * thread) / nthread,
+                  grid.grid + (gridSize * (thread + 1)) / nthread, 0.0_real);
+    }
+
+    /* Spread one color at a time, the end of each parallel loop
+     * acts as the barrier between the colors.
+     */
+    for (int color = 0; color < (1 << DIM); color++)
+    {
+        bool colorIsUsed = true;
+        for (int d = 0; d < DIM; d++)
+        {
+            if (grids->nc[d] == 1 && (color & (1 << d)))
+            {
+                colorIsUsed = false;
+            }
+        }
+        if (!colorIsUsed)
+        {
+            continue;
+        }
+
+#pragma omp parallel for num_threads(nthread) schedule(static)
+        for (int thread = 0; thread < nthread; thread++)
+        {
+            try
+            {
+                const pmegrid_t&     threadGrid = grids->grid_th[thread];
+                SpreadColorSelection colorSelection;
+                for (int d = 0; d < DIM; d++)
+                {
+                    colorSelection.offset[d] = threadGrid.offset[d];
+                    colorSelection.halfSize[d] =
+                            (grids->nc[d] > 1 ? (threadGrid.n[d] - (threadGrid.order - 1)) / 2
+                                              : std::numeric_limits<int>::max());
+                }
+                colorSelection.color = color;
+
+                spread_coefficients_bsplines_thread(&grid, atc, &atc->spline[thread],
+                                                    pme->spline_work, &colorSelection);
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+    }
+
+    wrap_periodic_pmegrid(pme, grid.grid);
+
+    ivec local_fft_ndata, local_fft_offset, local_fft_size;
+    gmx_parallel_3dfft_real_limits(pme->pfft_setup[grid_index], local_fft_ndata, local_fft_offset,
+                                   local_fft_size);
+
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int ix = 0; ix < local_fft_ndata[XX]; ix++)
+    {
+        for (int iy = 0; iy < local_fft_ndata[YY]; iy++)
+        {
+            const real* gmx_restrict gridLine = grid.grid + (ix * grid.s[YY] + iy) * grid.s[ZZ];
+            real* gmx_restrict fftLine = fftgrid + (ix * local_fft_size[YY] + iy) * local_fft_size[ZZ];
+            for (int iz = 0; iz < local_fft_ndata[ZZ]; iz++)
+            {
+                fftLine[iz] = gridLine[iz];
+            }
+        }
+    }
+}
+
 static void copy_local_grid(const gmx_pme_t* pme, const pmegrids_t* pmegrids, int grid_index, int thread, real* fftgrid)
 {
     ivec  local_fft_ndata, local_fft_offset, local_fft_size;
@@ -930,7 +1116,7 @@ void spread_on_grid(const gmx_pme_t*  pme,
                               spline->ind.data(), atc->coefficient.data(), bDoSplines);
             }
 
-            if (bSpread)
+            if (bSpread && !pme->useColoredSpread)
             {
                 /* put local atoms on grid. */
                 const pmegrid_t* grid = pme->bUseThreads ? &grids->grid_th[thread] : &grids->grid;
@@ -957,7 +1143,18 @@ void spread_on_grid(const gmx_pme_t*  pme,
     cs2 += (double)c2;
 #endif
 
-    if (bSpread && pme->bUseThreads)
+    if (bSpread && pme->useColoredSpread)
+    {
+#ifdef PME_TIME_THREADS
+        c3 = omp_cyc_start();
+#endif
+        spread_on_grid_colored(pme, atc, grids, fftgrid, grid_index);
+#ifdef PME_TIME_THREADS
+        c3 = omp_cyc_end(c3);
+        cs3 += (double)c3;
+#endif
+    }
+    else if (bSpread && pme->bUseThreads)
     {
 #ifdef PME_TIME_THREADS
         c3 = omp_cyc_start();
@@ -41,6 +41,19 @@
 
 #include "pme_internal.h"
 
+/*! \brief Returns whether the thread decomposition of \p grids allows colored spreading
+ *
+ * With colored spreading all threads spread directly on the full node grid.
+ * Each thread-local domain is split in two halves along each dimension
+ * which is decomposed over threads. Halves with the same color, i.e.
+ * the same lower/upper selection along all dimensions, of different threads
+ * are separated by at least one other half, so they can be spread on
+ * concurrently when the halves are at least pme_order - 1 grid lines wide.
+ * Along z the halves need to be wider with the aligned SIMD4 kernels,
+ * which access more grid lines than the footprint of the spline.
+ */
+bool pmeGridsSupportColoredSpread(const pmegrids_t& grids);
+
 void spread_on_grid(const gmx_pme_t*  pme,
                     PmeAtomComm*      atc,
                     const pmegrids_t* grids,
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the PME reciprocal-space error estimate used for tuning the PME order.
+ *
+ * \ingroup module_ewald
+ */
+
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/invertmatrix.h"
+#include "gromacs/math/utilities.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Returns the error measure for a cubic box with edge 5 nm and a 1 nm cut-off
+double errorMeasureForCubicBox(int gridSize, int pmeOrder)
+{
+    const matrix box         = { { 5, 0, 0 }, { 0, 5, 0 }, { 0, 0, 5 } };
+    const ivec   grid        = { gridSize, gridSize, gridSize };
+    const real   ewaldCoeffQ = calc_ewaldcoeff_q(1.0, 1e-5);
+
+    return pmeReciprocalErrorMeasure(box, grid, ewaldCoeffQ, pmeOrder, 1);
+}
+
+//! Returns the error measure summed over all grid vectors, without using symmetry or cut-offs
+double referenceErrorMeasure(const matrix box, const ivec gridSize, real ewaldCoeff, int pmeOrder)
+{
+    matrix recipbox;
+    gmx::invertBoxMatrix(box, recipbox);
+    const double volume = det(box);
+    const double factor = M_PI * M_PI / (ewaldCoeff * ewaldCoeff);
+
+    double sum = 0;
+    for (int mx = -gridSize[XX] / 2; mx <= gridSize[XX] / 2; mx++)
+    {
+        for (int my = -gridSize[YY] / 2; my <= gridSize[YY] / 2; my++)
+        {
+            for (int mz = -gridSize[ZZ] / 2; mz <= gridSize[ZZ] / 2; mz++)
+            {
+                if (mx == 0 && my == 0 && mz == 0)
+                {
+                    continue;
+                }
+                const double kx = mx * recipbox[XX][XX];
+                const double ky = mx * recipbox[YY][XX] + my * recipbox[YY][YY];
+                const double kz =
+                        mx * recipbox[ZZ][XX] + my * recipbox[ZZ][YY] + mz * recipbox[ZZ][ZZ];
+                const double k2    = kx * kx + ky * ky + kz * kz;
+                const double coeff = std::exp(-factor * k2) / (2.0 * M_PI * volume * k2);
+
+                const double p1x = pmeErrorEstimatePoly1(mx, gridSize[XX], pmeOrder);
+                const double p1y = pmeErrorEstimatePoly1(my, gridSize[YY], pmeOrder);
+                const double p1z = pmeErrorEstimatePoly1(mz, gridSize[ZZ], pmeOrder);
+
+                double tmp = pmeErrorEstimatePoly2(mx, gridSize[XX], pmeOrder)
+                             + pmeErrorEstimatePoly2(my, gridSize[YY], pmeOrder)
+                             + pmeErrorEstimatePoly2(mz, gridSize[ZZ], pmeOrder);
+                tmp += 2.0 * (p1x * p1y + p1z * p1y + p1z * p1x);
+                tmp += gmx::square(p1x + p1y + p1z);
+
+                sum += 32.0 * M_PI * M_PI * coeff * coeff * k2 * tmp;
+            }
+        }
+    }
+
+    return sum;
+}
+
+TEST(PmeErrorEstimateTest, MatchesSumOverAllGridVectors)
+{
+    const matrix box         = { { 4, 0, 0 }, { 0.5, 3.5, 0 }, { -0.8, 0.6, 4.2 } };
+    const ivec   grid        = { 28, 24, 32 };
+    const real   ewaldCoeffQ = calc_ewaldcoeff_q(0.9, 1e-5);
+
+    for (int pmeOrder = 4; pmeOrder <= 8; pmeOrder += 2)
+    {
+        SCOPED_TRACE("PME order " + std::to_string(pmeOrder));
+        const double reference = referenceErrorMeasure(box, grid, ewaldCoeffQ, pmeOrder);
+        EXPECT_NEAR(pmeReciprocalErrorMeasure(box, grid, ewaldCoeffQ, pmeOrder, 1), reference,
+                    1e-6 * reference);
+        EXPECT_NEAR(pmeReciprocalErrorMeasure(box, grid, ewaldCoeffQ, pmeOrder, 2), reference,
+                    1e-6 * reference);
+    }
+}
+
+TEST(PmeErrorEstimateTest, DecreasesWithFinerGrid)
+{
+    for (int pmeOrder = 4; pmeOrder <= 8; pmeOrder += 2)
+    {
+        SCOPED_TRACE("PME order " + std::to_string(pmeOrder));
+        EXPECT_LT(errorMeasureForCubicBox(48, pmeOrder), errorMeasureForCubicBox(40, pmeOrder));
+        EXPECT_LT(errorMeasureForCubicBox(40, pmeOrder), errorMeasureForCubicBox(32, pmeOrder));
+    }
+}
+
+TEST(PmeErrorEstimateTest, DecreasesWithHigherOrder)
+{
+    EXPECT_LT(errorMeasureForCubicBox(36, 6), errorMeasureForCubicBox(36, 4));
+    EXPECT_LT(errorMeasureForCubicBox(36, 8), errorMeasureForCubicBox(36, 6));
+}
+
+TEST(PmeErrorEstimateTest, HigherOrderAllowsCoarserGrid)
+{
+    /* With spacing 0.104 nm and order 4, order 6 reaches the same
+     * accuracy with a spacing of 0.156 nm.
+     */
+    const double errorOrder4 = errorMeasureForCubicBox(48, 4);
+    EXPECT_LT(errorMeasureForCubicBox(32, 6), errorOrder4);
+    EXPECT_GT(errorMeasureForCubicBox(28, 6), errorOrder4);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
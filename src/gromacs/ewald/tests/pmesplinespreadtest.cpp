@@ -42,14 +42,22 @@
 
 #include "gmxpre.h"
 
+#include <cmath>
+
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
+#include "gromacs/ewald/pme_internal.h"
 #include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
 #include "gromacs/utility/stringutil.h"
 
 #include "testutils/refdata.h"
+#include "testutils/setenv.h"
 #include "testutils/testasserts.h"
 
 #include "pmetestcommon.h"
@@ -367,6 +375,97 @@ INSTANTIATE_TEST_CASE_P(SaneInput13,
                                            c_inputGridSizes,
                                            ::testing::Values(c_sampleCoordinates13),
                                            ::testing::Values(c_sampleCharges13)));
+
+/*! \brief Test that spreading with GMX_PME_COLORED_SPREAD on the full grid
+ * gives the same grid as the default spreading on thread-local grids.
+ *
+ * The thread divisions decompose each dimension, with a division along z only
+ * to check that the SIMD4 kernels do not access the halves of other threads.
+ */
+TEST(PmeColoredSpreadTest, MatchesDefaultSpread)
+{
+    const Matrix3x3 box      = { { 4.2F, 0.0F, 0.0F, 0.0F, 3.9F, 0.0F, 0.7F, -0.5F, 6.1F } };
+    const IVec      gridSize = { 40, 36, 64 };
+    const int       numAtoms = 500;
+
+    DefaultRandomEngine           rng(2021);
+    UniformRealDistribution<real> uniformDist(0, 1);
+    CoordinatesVector             coordinates(numAtoms);
+    std::vector<real>             chargesStorage(numAtoms);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            coordinates[a][d] = uniformDist(rng) * box[d * DIM + d];
+        }
+        // Positive charges avoid cancellation, so all grid values are of the same order
+        chargesStorage[a] = 0.1 + uniformDist(rng);
+    }
+    const ChargesVector charges(chargesStorage);
+
+    for (int pmeOrder = 4; pmeOrder <= 5; pmeOrder++)
+    {
+        for (const char* threadDivision : { "2 1 1", "1 1 3", "2 2 2" })
+        {
+            SCOPED_TRACE(
+                    formatString("PME order %d, thread division %s", pmeOrder, threadDivision));
+
+            t_inputrec inputRec;
+            inputRec.nkx         = gridSize[XX];
+            inputRec.nky         = gridSize[YY];
+            inputRec.nkz         = gridSize[ZZ];
+            inputRec.pme_order   = pmeOrder;
+            inputRec.coulombtype = eelPME;
+            inputRec.epsilon_r   = 1.0;
+
+            int numThreads = 1;
+            for (const std::string& numThreadsDim : splitString(threadDivision))
+            {
+                numThreads *= std::stoi(numThreadsDim);
+            }
+
+            gmxSetenv("GMX_PME_THREAD_DIVISION", threadDivision, 1);
+            PmeSafePointer pmeDefault = pmeInitWrapper(&inputRec, CodePath::CPU, nullptr, nullptr,
+                                                       nullptr, box, 1.0F, 1.0F, numThreads);
+            gmxSetenv("GMX_PME_COLORED_SPREAD", "1", 1);
+            PmeSafePointer pmeColored = pmeInitWrapper(&inputRec, CodePath::CPU, nullptr, nullptr,
+                                                       nullptr, box, 1.0F, 1.0F, numThreads);
+            gmxUnsetenv("GMX_PME_COLORED_SPREAD");
+            gmxUnsetenv("GMX_PME_THREAD_DIVISION");
+
+            ASSERT_FALSE(pmeDefault->useColoredSpread);
+            ASSERT_TRUE(pmeColored->useColoredSpread);
+            /* Colored spreading only uses the geometry of the thread-local grids */
+            EXPECT_NE(nullptr, pmeDefault->pmegrid[PME_GRID_QA].grid_all);
+            EXPECT_EQ(nullptr, pmeColored->pmegrid[PME_GRID_QA].grid_all);
+
+            SparseRealGridValuesOutput gridValues[2];
+            int                        index = 0;
+            for (gmx_pme_t* pme : { pmeDefault.get(), pmeColored.get() })
+            {
+                pmeInitAtoms(pme, nullptr, CodePath::CPU, coordinates, charges);
+                pmePerformSplineAndSpread(pme, CodePath::CPU, true, true);
+                gridValues[index++] = pmeGetRealGrid(pme, CodePath::CPU);
+            }
+
+            real maxValue = 0;
+            for (const auto& point : gridValues[0])
+            {
+                maxValue = std::max(maxValue, std::abs(point.second));
+            }
+            const FloatingPointTolerance tolerance =
+                    relativeToleranceAsFloatingPoint(maxValue, 100 * GMX_REAL_EPS);
+            ASSERT_EQ(gridValues[0].size(), gridValues[1].size());
+            for (const auto& point : gridValues[0])
+            {
+                SCOPED_TRACE("Grid point " + point.first);
+                ASSERT_EQ(1, gridValues[1].count(point.first));
+                EXPECT_REAL_EQ_TOL(point.second, gridValues[1].at(point.first), tolerance);
+            }
+        }
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
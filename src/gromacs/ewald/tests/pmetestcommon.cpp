@@ -114,14 +114,17 @@ PmeSafePointer pmeInitWrapper(const t_inputrec*    inputRec,
                               const PmeGpuProgram* pmeGpuProgram,
                               const Matrix3x3&     box,
                               const real           ewaldCoeff_q,
-                              const real           ewaldCoeff_lj)
+                              const real           ewaldCoeff_lj,
+                              const int            numThreads)
 {
+    GMX_RELEASE_ASSERT(numThreads == 1 || mode == CodePath::CPU,
+                       "Multiple threads are only supported on the CPU");
     const MDLogger dummyLogger;
     const auto     runMode       = (mode == CodePath::CPU) ? PmeRunMode::CPU : PmeRunMode::Mixed;
     t_commrec      dummyCommrec  = { 0 };
     NumPmeDomains  numPmeDomains = { 1, 1 };
     gmx_pme_t* pmeDataRaw = gmx_pme_init(&dummyCommrec, numPmeDomains, inputRec, false, false, true,
-                                         ewaldCoeff_q, ewaldCoeff_lj, 1, runMode, nullptr,
+                                         ewaldCoeff_q, ewaldCoeff_lj, numThreads, runMode, nullptr,
                                          deviceContext, deviceStream, pmeGpuProgram, dummyLogger);
     PmeSafePointer pme(pmeDataRaw); // taking ownership
 
@@ -354,10 +354,25 @@ void gmx_many_fft_destroy(gmx_fft_t setup);
  */
 int gmx_fft_transpose_2d(t_complex* in_data, t_complex* out_data, int nx, int ny);
 
+/*! \brief Returns whether two FFT setups execute the same library plans
+ *
+ *  This is the case when both setups were taken from the plan cache,
+ *  which only exists with FFTW.
+ */
+bool gmx_fft_shares_plans(gmx_fft_t fft1, gmx_fft_t fft2);
+
+/*! \brief Writes the FFTW wisdom to the file set with GMX_FFTW_WISDOM_FILE
+ *
+ *  Only writes when plans were measured since the last export, does
+ *  nothing with other FFT libraries. Also called by gmx_fft_cleanup().
+ */
+void gmx_fft_export_wisdom();
+
 /*! \brief Cleanup global data of FFT
  *
  *  Any plans are invalid after this function. Should be called
- *  after all plans have been destroyed.
+ *  after all plans have been destroyed. This also releases plans
+ *  that FFT libraries keep cached for reuse by later setups.
  */
 void gmx_fft_cleanup();
 
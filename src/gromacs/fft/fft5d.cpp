@@ -135,6 +135,18 @@ double MPI_Wtime()
 #    endif
 #endif
 
+/*returns whether the transpose after FFT step s swaps the major and minor (1 and 3) axes*/
+static bool transposeSwapsAxes13(int flags, int s)
+{
+    return (s == 0 && !(flags & FFT5D_ORDER_YZ)) || (s == 1 && (flags & FFT5D_ORDER_YZ));
+}
+
+/*returns the first plane of chunk c out of numChunks chunks of numPlanes planes*/
+static int pipelineChunkStart(int numPlanes, int numChunks, int c)
+{
+    return (c * numPlanes) / numChunks;
+}
+
 static int vmax(const int* a, int s)
 {
     int i, max = 0;
@@ -165,7 +177,8 @@ fft5d_plan fft5d_plan_3d(int                NG,
                          t_complex**        rlout2,
                          t_complex**        rlout3,
                          int                nthreads,
-                         gmx::PinningPolicy realGridAllocationPinningPolicy)
+                         gmx::PinningPolicy realGridAllocationPinningPolicy,
+                         int                numPipelineChunks)
 {
 
     int  P[2], prank[2], i;
@@ -177,6 +190,7 @@ fft5d_plan fft5d_plan_3d(int                NG,
             *iNin[3] = { nullptr }, *oNin[3] = { nullptr }, *iNout[3] = { nullptr },
             *oNout[3] = { nullptr };
     int        C[3], rC[3], nP[2];
+    int        pipelineChunks[2] = { 0, 0 };
     int        lsize;
     t_complex *lin = nullptr, *lout = nullptr, *lout2 = nullptr, *lout3 = nullptr;
     fft5d_plan plan;
@@ -420,6 +434,24 @@ fft5d_plan fft5d_plan_3d(int                NG,
     }
     N[2] = pN[2] = -1; /*not used*/
 
+    /* The transposes can be pipelined in chunks of planes along the major axis of the split
+       data, overlapping the FFTs and split of one chunk with the transfer of earlier chunks.
+       The planes are contiguous within the block for each rank, since M[s]=pM[s]
+       when the transpose swaps axes 1 and 3.
+     */
+    for (s = 0; s < 2; s++)
+    {
+        const int numPlanes = transposeSwapsAxes13(flags, s) ? K[s] : pK[s];
+        GMX_ASSERT(!transposeSwapsAxes13(flags, s) || M[s] == pM[s],
+                   "Pipelined transposes require contiguous planes");
+        if (numPipelineChunks > 1 && nP[s] > 1)
+        {
+            pipelineChunks[s] = std::min(numPipelineChunks, numPlanes);
+        }
+    }
+    /* Pipelining needs separate buffers, since FFT input and split output can not be shared */
+    const bool separateTransposeBuffers = (nthreads > 1 || pipelineChunks[0] > 1 || pipelineChunks[1] > 1);
+
     /*
        Difference between x-y-z regarding 2d decomposition is whether they are
        distributed along axis 1, 2 or both
@@ -442,7 +474,7 @@ fft5d_plan fft5d_plan_3d(int                NG,
             snew_aligned(lin, lsize, 32);
         }
         snew_aligned(lout, lsize, 32);
-        if (nthreads > 1)
+        if (separateTransposeBuffers)
         {
             /* We need extra transpose buffers to avoid OpenMP barriers */
             snew_aligned(lout2, lsize, 32);
@@ -459,7 +491,7 @@ fft5d_plan fft5d_plan_3d(int                NG,
     {
         lin  = *rlin;
         lout = *rlout;
-        if (nthreads > 1)
+        if (separateTransposeBuffers)
         {
             lout2 = *rlout2;
             lout3 = *rlout3;
@@ -473,6 +505,18 @@ fft5d_plan fft5d_plan_3d(int                NG,
 
     plan = static_cast<fft5d_plan>(calloc(1, sizeof(struct fft5d_plan_t)));
 
+    for (s = 0; s < 2; s++)
+    {
+        plan->numPipelineChunks[s] = pipelineChunks[s];
+        if (pipelineChunks[s] > 1)
+        {
+            plan->p1dPipeline[s] = static_cast<gmx_fft_t*>(
+                    calloc(pipelineChunks[s] * nthreads, sizeof(gmx_fft_t)));
+            plan->pipelineRequests[s] = static_cast<MPI_Request*>(
+                    malloc(2 * pipelineChunks[s] * nP[s] * sizeof(MPI_Request)));
+        }
+    }
+
 
     if (debug)
     {
@@ -648,6 +692,35 @@ fft5d_plan fft5d_plan_3d(int                NG,
                             gmx_fft_init_many_1d(&plan->p1d[s][t], C[s], tsize,
                                                  (flags & FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
                         }
+
+                        /* Plans for the FFTs of this thread within each pipeline chunk */
+                        const int numChunks = (s < 2 ? pipelineChunks[s] : 0);
+                        const int numPlanes = (s < 2 && transposeSwapsAxes13(flags, s) ? K[s] : pK[s]);
+                        for (int c = 0; c < numChunks; c++)
+                        {
+                            const int z0 = std::min(pipelineChunkStart(numPlanes, numChunks, c), pK[s]);
+                            const int z1 =
+                                    std::min(pipelineChunkStart(numPlanes, numChunks, c + 1), pK[s]);
+                            const int numColumns = (z1 - z0) * pM[s];
+                            const int chunkTSize = ((t + 1) * numColumns / nthreads)
+                                                   - (t * numColumns / nthreads);
+                            if (chunkTSize == 0)
+                            {
+                                continue;
+                            }
+                            gmx_fft_t* chunkPlan = &plan->p1dPipeline[s][c * nthreads + t];
+                            if ((flags & FFT5D_REALCOMPLEX) && !(flags & FFT5D_BACKWARD) && s == 0)
+                            {
+                                gmx_fft_init_many_1d_real(
+                                        chunkPlan, rC[s], chunkTSize,
+                                        (flags & FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                            }
+                            else
+                            {
+                                gmx_fft_init_many_1d(chunkPlan, C[s], chunkTSize,
+                                                     (flags & FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                            }
+                        }
                     }
                     GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
                 }
@@ -1096,6 +1169,112 @@ static void print_localdata(const t_complex* lin, const char* txt, int s, fft5d_
     }
 }
 
+/*FFT step s, split and transpose, with the transpose pipelined in chunks.
+   Each chunk consists of planes along the major axis of the split data.
+   The transfer of a chunk is started as soon as all threads have split it,
+   so it overlaps with the FFTs and split of the following chunks.
+   All receives are posted before the first FFT.
+   The data is transposed into lout3 as with MPI_Alltoall.*/
+static void fftAndTransposePipelined(fft5d_plan plan, int s, int thread, fft5d_time times)
+{
+#if GMX_MPI
+    const int *N = plan->N, *M = plan->M, *K = plan->K, *pM = plan->pM, *pK = plan->pK, *C = plan->C;
+    const int  numChunks = plan->numPipelineChunks[s];
+    const int  numPlanes = transposeSwapsAxes13(plan->flags, s) ? K[s] : pK[s];
+    const int  planeSize = N[s] * M[s];
+    const int  blockSize = numPlanes * planeSize;
+    const int  P         = plan->P[s];
+    MPI_Request* requests = plan->pipelineRequests[s];
+
+    /* The input has been joined, or filled by the caller, in a different order
+       over the threads than we use for the chunks */
+#    pragma omp barrier
+
+    if (thread == 0)
+    {
+#    ifndef NOGMX
+        wallcycle_start(times, ewcPME_FFTCOMM);
+#    endif
+        for (int c = 0; c < numChunks; c++)
+        {
+            const int z0 = pipelineChunkStart(numPlanes, numChunks, c);
+            const int z1 = pipelineChunkStart(numPlanes, numChunks, c + 1);
+            for (int i = 0; i < P; i++)
+            {
+                MPI_Irecv(reinterpret_cast<real*>(plan->lout3 + i * blockSize + z0 * planeSize),
+                          (z1 - z0) * planeSize * sizeof(t_complex) / sizeof(real), GMX_MPI_REAL, i,
+                          c, plan->cart[s], &requests[2 * c * P + i]);
+            }
+        }
+#    ifndef NOGMX
+        wallcycle_stop(times, ewcPME_FFTCOMM);
+#    endif
+    }
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        const int z0 = pipelineChunkStart(numPlanes, numChunks, c);
+        const int z1 = pipelineChunkStart(numPlanes, numChunks, c + 1);
+
+        /* The columns of this chunk for which we have local data */
+        const int numColumns = (std::min(z1, pK[s]) - std::min(z0, pK[s])) * pM[s];
+        const int tstart     = std::min(z0, pK[s]) * pM[s] + thread * numColumns / plan->nthreads;
+        const int tend = std::min(z0, pK[s]) * pM[s] + (thread + 1) * numColumns / plan->nthreads;
+
+        if (tend > tstart)
+        {
+            gmx_fft_t fftPlan = plan->p1dPipeline[s][c * plan->nthreads + thread];
+            if ((plan->flags & FFT5D_REALCOMPLEX) && !(plan->flags & FFT5D_BACKWARD) && s == 0)
+            {
+                gmx_fft_many_1d_real(fftPlan, GMX_FFT_REAL_TO_COMPLEX, plan->lin + tstart * C[s],
+                                     plan->lout + tstart * C[s]);
+            }
+            else
+            {
+                gmx_fft_many_1d(fftPlan, (plan->flags & FFT5D_BACKWARD) ? GMX_FFT_BACKWARD : GMX_FFT_FORWARD,
+                                plan->lin + tstart * C[s], plan->lout + tstart * C[s]);
+            }
+            splitaxes(plan->lout2, plan->lout, N[s], M[s], K[s], pM[s], P, C[s], plan->iNout[s],
+                      plan->oNout[s], tstart % pM[s], tstart / pM[s], tend % pM[s], tend / pM[s]);
+        }
+#    pragma omp barrier /*the whole chunk has to be split before sending*/
+
+        if (thread == 0)
+        {
+#    ifndef NOGMX
+            wallcycle_start(times, ewcPME_FFTCOMM);
+#    endif
+            for (int i = 0; i < P; i++)
+            {
+                MPI_Isend(reinterpret_cast<real*>(plan->lout2 + i * blockSize + z0 * planeSize),
+                          (z1 - z0) * planeSize * sizeof(t_complex) / sizeof(real), GMX_MPI_REAL, i,
+                          c, plan->cart[s], &requests[(2 * c + 1) * P + i]);
+            }
+#    ifndef NOGMX
+            wallcycle_stop(times, ewcPME_FFTCOMM);
+#    endif
+        }
+    }
+
+    if (thread == 0)
+    {
+#    ifndef NOGMX
+        wallcycle_start(times, ewcPME_FFTCOMM);
+#    endif
+        MPI_Waitall(2 * numChunks * P, requests, MPI_STATUSES_IGNORE);
+#    ifndef NOGMX
+        wallcycle_stop(times, ewcPME_FFTCOMM);
+#    endif
+    }
+#else
+    GMX_UNUSED_VALUE(plan);
+    GMX_UNUSED_VALUE(s);
+    GMX_UNUSED_VALUE(thread);
+    GMX_UNUSED_VALUE(times);
+    GMX_RELEASE_ASSERT(false, "Invalid call to fftAndTransposePipelined");
+#endif
+}
+
 void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
 {
     t_complex* lin   = plan->lin;
@@ -1117,7 +1296,7 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
     int *N = plan->N, *M = plan->M, *K = plan->K, *pN = plan->pN, *pM = plan->pM, *pK = plan->pK,
         *C = plan->C, *P = plan->P, **iNin = plan->iNin, **oNin = plan->oNin, **iNout = plan->iNout,
         **oNout = plan->oNout;
-    int s       = 0, tstart, tend, bParallelDim;
+    int s       = 0, tstart = 0, tend, bParallelDim;
 
 
 #if GMX_FFT_FFTW3
@@ -1165,6 +1344,13 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
             bParallelDim = 0;
         }
 
+        /* With pipelining, the FFT, split and transpose are interleaved */
+        const bool pipelineTranspose = (bParallelDim && plan->numPipelineChunks[s] > 1);
+        if (pipelineTranspose)
+        {
+            fftAndTransposePipelined(plan, s, thread, times);
+        }
+
         /* ---------- START FFT ------------ */
 #ifdef NOGMX
         if (times != 0 && thread == 0)
@@ -1190,7 +1376,11 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         }
 
         tstart = (thread * pM[s] * pK[s] / plan->nthreads) * C[s];
-        if ((plan->flags & FFT5D_REALCOMPLEX) && !(plan->flags & FFT5D_BACKWARD) && s == 0)
+        if (pipelineTranspose)
+        {
+            /* Done above */
+        }
+        else if ((plan->flags & FFT5D_REALCOMPLEX) && !(plan->flags & FFT5D_BACKWARD) && s == 0)
         {
             gmx_fft_many_1d_real(p1d[s][thread],
                                  (plan->flags & FFT5D_BACKWARD) ? GMX_FFT_COMPLEX_TO_REAL
@@ -1217,7 +1407,7 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         /* ---------- END FFT ------------ */
 
         /* ---------- START SPLIT + TRANSPOSE------------ (if parallel in in this dimension)*/
-        if (bParallelDim)
+        if (bParallelDim && !pipelineTranspose)
         {
 #ifdef NOGMX
             if (times != NULL && thread == 0)
@@ -1409,6 +1599,15 @@ void fft5d_destroy(fft5d_plan plan)
             }
             free(plan->p1d[s]);
         }
+        if (s < 2 && plan->p1dPipeline[s])
+        {
+            for (t = 0; t < plan->numPipelineChunks[s] * plan->nthreads; t++)
+            {
+                gmx_many_fft_destroy(plan->p1dPipeline[s][t]);
+            }
+            free(plan->p1dPipeline[s]);
+            free(plan->pipelineRequests[s]);
+        }
         if (plan->iNin[s])
         {
             free(plan->iNin[s]);
@@ -1454,7 +1653,7 @@ void fft5d_destroy(fft5d_plan plan)
         }
         sfree_aligned(plan->lin);
         sfree_aligned(plan->lout);
-        if (plan->nthreads > 1)
+        if (plan->lout2 != plan->lin)
         {
             sfree_aligned(plan->lout2);
             sfree_aligned(plan->lout3);
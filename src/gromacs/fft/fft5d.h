@@ -97,6 +97,9 @@ struct fft5d_plan_t
     t_complex* lin;
     t_complex *lout, *lout2, *lout3;
     gmx_fft_t* p1d[3]; /*1D plans*/
+    int numPipelineChunks[2]; /*number of chunks for pipelined transposes, <=1: single MPI_Alltoall*/
+    gmx_fft_t*   p1dPipeline[2];      /*1D plans per chunk and thread for pipelined transposes*/
+    MPI_Request* pipelineRequests[2]; /*send and receive requests for pipelined transposes*/
 #if GMX_FFT_FFTW3
     FFTW(plan) p2d; /*2D plan: used for 1D decomposition if FFT supports transposed output*/
     FFTW(plan) p3d; /*3D plan: used for 0D decomposition if FFT supports transposed output*/
@@ -138,7 +141,8 @@ fft5d_plan fft5d_plan_3d(int         N,
                          t_complex** lout2,
                          t_complex** lout3,
                          int         nthreads,
-                         gmx::PinningPolicy realGridAllocationPinningPolicy = gmx::PinningPolicy::CannotBePinned);
+                         gmx::PinningPolicy realGridAllocationPinningPolicy = gmx::PinningPolicy::CannotBePinned,
+                         int                numPipelineChunks               = 0);
 void       fft5d_local_size(fft5d_plan plan, int* N1, int* M0, int* K0, int* K1, int** coor);
 void       fft5d_destroy(fft5d_plan plan);
 fft5d_plan fft5d_plan_3d_cart(int         N,
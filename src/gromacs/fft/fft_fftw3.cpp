@@ -39,14 +39,20 @@
 #include "config.h"
 
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 
+#include <map>
+#include <string>
+#include <tuple>
+
 #include <fftw3.h>
 
 #include "gromacs/fft/fft.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/mutex.h"
+#include "gromacs/utility/sysinfo.h"
 
 #if GMX_DOUBLE
 #    define FFTWPREFIX(name) fftw_##name
@@ -102,8 +108,158 @@ struct gmx_fft
     int real_transform;
     /** Number of dimensions in the FFT */
     int ndim;
+    /** Whether the plans are owned by the plan cache instead of this object */
+    bool plansAreCached;
 };
 
+namespace
+{
+
+/*! \brief Key identifying a set of plans in the plan cache
+ *
+ * Tuple of: number of dimensions, whether the transform is real,
+ * nx, ny (or howmany for 1D transforms) and the FFTW planner flags.
+ */
+using FftPlanCacheKey = std::tuple<int, int, int, int, int>;
+
+//! Entry in the plan cache, the plans with the same indexing as gmx_fft::plan
+struct FftPlanCacheEntry
+{
+    //! The plans
+    FFTWPREFIX(plan) plan[2][2][2];
+};
+
+/*! \brief Process-wide cache of FFTW plans, protected by big_fftw_mutex
+ *
+ * Creating plans with FFTW_MEASURE takes significant time, and the same
+ * transforms are set up repeatedly, e.g. for every OpenMP thread in fft5d,
+ * for every grid the PME tuning tries and for every simulation in a process.
+ * All plans are executed with the new-array execute functions, which are
+ * thread-safe, so a set of plans can be shared between gmx_fft objects.
+ * Plans are kept until gmx_fft_cleanup() is called, so they can also be
+ * reused when switching back to an earlier grid.
+ */
+std::map<FftPlanCacheKey, FftPlanCacheEntry> g_fftPlanCache;
+
+//! Whether we have tried to import wisdom from the file set by the user
+bool g_fftwWisdomImported = false;
+
+//! Whether measured plans were created since the wisdom was last exported
+bool g_fftwHaveNewWisdom = false;
+
+//! Returns the name of the FFTW wisdom file set by the user, nullptr when not set
+const char* fftwWisdomFileName()
+{
+    const char* fileName = std::getenv("GMX_FFTW_WISDOM_FILE");
+
+    return (fileName != nullptr && fileName[0] != '\0') ? fileName : nullptr;
+}
+
+/*! \brief Imports FFTW wisdom from the user file, once per process
+ *
+ * Should be called with big_fftw_mutex locked. A missing or unreadable
+ * file is not an error, the file will be (re)written after planning.
+ */
+void importFftwWisdom()
+{
+    if (g_fftwWisdomImported)
+    {
+        return;
+    }
+    g_fftwWisdomImported = true;
+
+    const char* fileName = fftwWisdomFileName();
+    if (fileName != nullptr)
+    {
+        FFTWPREFIX(import_wisdom_from_filename)(fileName);
+    }
+}
+
+/*! \brief Exports the accumulated FFTW wisdom to the user file
+ *
+ * Should be called with big_fftw_mutex locked. Only writes the file when
+ * measured plans were created since the last export. The wisdom is written
+ * to a temporary file which is then renamed, so multiple processes
+ * sharing a wisdom file never leave it partially written.
+ */
+void exportFftwWisdom()
+{
+    const char* fileName = fftwWisdomFileName();
+    if (fileName == nullptr || !g_fftwHaveNewWisdom)
+    {
+        return;
+    }
+    g_fftwHaveNewWisdom = false;
+
+    std::string tmpFileName = std::string(fileName) + "." + std::to_string(gmx_getpid()) + ".tmp";
+    if (FFTWPREFIX(export_wisdom_to_filename)(tmpFileName.c_str()) == 0
+        || std::rename(tmpFileName.c_str(), fileName) != 0)
+    {
+        std::remove(tmpFileName.c_str());
+    }
+}
+
+/*! \brief Sets up \p fft with cached plans for \p key, returns whether these were present
+ *
+ * Should be called with big_fftw_mutex locked.
+ */
+bool useCachedPlans(gmx_fft_t fft, const FftPlanCacheKey& key)
+{
+    auto entry = g_fftPlanCache.find(key);
+    if (entry == g_fftPlanCache.end())
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            for (int k = 0; k < 2; k++)
+            {
+                fft->plan[i][j][k] = entry->second.plan[i][j][k];
+            }
+        }
+    }
+    fft->real_transform = std::get<1>(key);
+    fft->ndim           = std::get<0>(key);
+    fft->plansAreCached = true;
+
+    return true;
+}
+
+/*! \brief Hands the plans of \p fft over to the plan cache under \p key
+ *
+ * Should be called with big_fftw_mutex locked.
+ */
+void addPlansToCache(gmx_fft_t fft, const FftPlanCacheKey& key)
+{
+    FftPlanCacheEntry entry;
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            for (int k = 0; k < 2; k++)
+            {
+                entry.plan[i][j][k] = fft->plan[i][j][k];
+            }
+        }
+    }
+    g_fftPlanCache[key] = entry;
+    fft->plansAreCached = true;
+
+    /* Only measured plans produce wisdom worth saving, which is written
+     * by gmx_fft_export_wisdom() instead of after every plan, as PME tuning
+     * can create many plans.
+     */
+    if ((std::get<4>(key) & FFTW_ESTIMATE) == 0)
+    {
+        g_fftwHaveNewWisdom = true;
+    }
+}
+
+} // namespace
+
 int gmx_fft_init_1d(gmx_fft_t* pfft, int nx, gmx_fft_flag flags)
 {
     return gmx_fft_init_many_1d(pfft, nx, 1, flags);
@@ -137,6 +293,16 @@ int gmx_fft_init_many_1d(gmx_fft_t* pfft, int nx, int howmany, gmx_fft_flag flag
         FFTW_UNLOCK
         return ENOMEM;
     }
+    fft->plansAreCached = false;
+
+    const FftPlanCacheKey cacheKey = FftPlanCacheKey(1, 0, nx, howmany, fftw_flags);
+    if (useCachedPlans(fft, cacheKey))
+    {
+        *pfft = fft;
+        FFTW_UNLOCK
+        return 0;
+    }
+    importFftwWisdom();
 
     /* allocate aligned, and extra memory to make it unaligned */
     p1 = static_cast<FFTWPREFIX(complex)*>(
@@ -220,6 +386,8 @@ int gmx_fft_init_many_1d(gmx_fft_t* pfft, int nx, int howmany, gmx_fft_flag flag
     fft->real_transform = 0;
     fft->ndim           = 1;
 
+    addPlansToCache(fft, cacheKey);
+
     *pfft = fft;
     FFTW_UNLOCK
     return 0;
@@ -257,6 +425,16 @@ int gmx_fft_init_many_1d_real(gmx_fft_t* pfft, int nx, int howmany, gmx_fft_flag
         FFTW_UNLOCK
         return ENOMEM;
     }
+    fft->plansAreCached = false;
+
+    const FftPlanCacheKey cacheKey = FftPlanCacheKey(1, 1, nx, howmany, fftw_flags);
+    if (useCachedPlans(fft, cacheKey))
+    {
+        *pfft = fft;
+        FFTW_UNLOCK
+        return 0;
+    }
+    importFftwWisdom();
 
     /* allocate aligned, and extra memory to make it unaligned */
     p1 = static_cast<real*>(FFTWPREFIX(malloc)(sizeof(real) * (nx / 2 + 1) * 2 * howmany + 8));
@@ -347,6 +525,8 @@ int gmx_fft_init_many_1d_real(gmx_fft_t* pfft, int nx, int howmany, gmx_fft_flag
     fft->real_transform = 1;
     fft->ndim           = 1;
 
+    addPlansToCache(fft, cacheKey);
+
     *pfft = fft;
     FFTW_UNLOCK
     return 0;
@@ -380,6 +560,16 @@ int gmx_fft_init_2d_real(gmx_fft_t* pfft, int nx, int ny, gmx_fft_flag flags)
         FFTW_UNLOCK
         return ENOMEM;
     }
+    fft->plansAreCached = false;
+
+    const FftPlanCacheKey cacheKey = FftPlanCacheKey(2, 1, nx, ny, fftw_flags);
+    if (useCachedPlans(fft, cacheKey))
+    {
+        *pfft = fft;
+        FFTW_UNLOCK
+        return 0;
+    }
+    importFftwWisdom();
 
     /* allocate aligned, and extra memory to make it unaligned */
     p1 = static_cast<real*>(FFTWPREFIX(malloc)(sizeof(real) * (nx * (ny / 2 + 1) * 2 + 2)));
@@ -458,6 +648,8 @@ int gmx_fft_init_2d_real(gmx_fft_t* pfft, int nx, int ny, gmx_fft_flag flags)
     fft->real_transform = 1;
     fft->ndim           = 2;
 
+    addPlansToCache(fft, cacheKey);
+
     *pfft = fft;
     FFTW_UNLOCK
     return 0;
@@ -561,7 +753,8 @@ void gmx_fft_destroy(gmx_fft_t fft)
 
     if (fft != nullptr)
     {
-        for (i = 0; i < 2; i++)
+        /* Cached plans are only destroyed by gmx_fft_cleanup() */
+        for (i = 0; i < 2 && !fft->plansAreCached; i++)
         {
             for (j = 0; j < 2; j++)
             {
@@ -588,7 +781,40 @@ void gmx_many_fft_destroy(gmx_fft_t fft)
     gmx_fft_destroy(fft);
 }
 
+bool gmx_fft_shares_plans(gmx_fft_t fft1, gmx_fft_t fft2)
+{
+    return fft1->plansAreCached && fft2->plansAreCached
+           && fft1->plan[0][0][0] == fft2->plan[0][0][0];
+}
+
+void gmx_fft_export_wisdom()
+{
+    FFTW_LOCK
+    exportFftwWisdom();
+    FFTW_UNLOCK
+}
+
 void gmx_fft_cleanup()
 {
+    FFTW_LOCK
+    exportFftwWisdom();
+    for (auto& entry : g_fftPlanCache)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            for (int j = 0; j < 2; j++)
+            {
+                for (int k = 0; k < 2; k++)
+                {
+                    FFTWPREFIX(destroy_plan)(entry.second.plan[i][j][k]);
+                }
+            }
+        }
+    }
+    g_fftPlanCache.clear();
+    g_fftwWisdomImported = false;
+    g_fftwHaveNewWisdom  = false;
+    FFTW_UNLOCK
+
     FFTWPREFIX(cleanup)();
 }
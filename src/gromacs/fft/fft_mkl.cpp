@@ -587,6 +587,13 @@ void gmx_fft_destroy(gmx_fft_t fft)
     }
 }
 
+bool gmx_fft_shares_plans(gmx_fft_t /*fft1*/, gmx_fft_t /*fft2*/)
+{
+    return false;
+}
+
+void gmx_fft_export_wisdom() {}
+
 void gmx_fft_cleanup()
 {
     mkl_free_buffers();
@@ -74,6 +74,22 @@ int gmx_parallel_3dfft_init(gmx_parallel_3dfft_t* pfft_setup,
         flags |= FFT5D_NOMEASURE;
     }
 
+    /* Optionally pipeline the transposes, to overlap communication with FFTs */
+    int numPipelineChunks = 0;
+    if (const char* env = getenv("GMX_FFT5D_PIPELINE_CHUNKS"))
+    {
+        char* end;
+
+        numPipelineChunks = strtol(env, &end, 10);
+        if (!end || (*end != 0) || numPipelineChunks < 1)
+        {
+            gmx_fatal(FARGS,
+                      "Invalid value passed in GMX_FFT5D_PIPELINE_CHUNKS=%s, positive integer "
+                      "required",
+                      env);
+        }
+    }
+
     if (!(flags & FFT5D_ORDER_YZ))
     {
         Nb = M;
@@ -88,11 +104,13 @@ int gmx_parallel_3dfft_init(gmx_parallel_3dfft_t* pfft_setup,
     }
 
     (*pfft_setup)->p1 = fft5d_plan_3d(rN, M, K, rcomm, flags, reinterpret_cast<t_complex**>(real_data),
-                                      complex_data, &buf1, &buf2, nthreads, realGridAllocation);
+                                      complex_data, &buf1, &buf2, nthreads, realGridAllocation,
+                                      numPipelineChunks);
 
     (*pfft_setup)->p2 = fft5d_plan_3d(
             Nb, Mb, Kb, rcomm, (flags | FFT5D_BACKWARD | FFT5D_NOMALLOC) ^ FFT5D_ORDER_YZ,
-            complex_data, reinterpret_cast<t_complex**>(real_data), &buf1, &buf2, nthreads);
+            complex_data, reinterpret_cast<t_complex**>(real_data), &buf1, &buf2, nthreads,
+            gmx::PinningPolicy::CannotBePinned, numPipelineChunks);
 
     return static_cast<int>((*pfft_setup)->p1 != nullptr && (*pfft_setup)->p2 != nullptr);
 }
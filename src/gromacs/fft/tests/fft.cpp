@@ -47,16 +47,26 @@
 
 #include "gromacs/fft/fft.h"
 
+#include "config.h"
+
+#include <cmath>
+#include <cstdio>
+
 #include <algorithm>
+#include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
 
 #include "gromacs/fft/parallel_3dfft.h"
+#include "gromacs/utility/futil.h"
 #include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
 
 #include "testutils/refdata.h"
+#include "testutils/setenv.h"
 #include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
 
 namespace
 {
@@ -138,6 +148,28 @@ public:
     gmx_fft_t fft_;
 };
 
+/*! \brief Test fixture for FFT setups without reference data
+ *
+ * Used for tests that compare results between setups or against a
+ * directly computed DFT.
+ */
+class FFTSetupTest : public ::testing::Test
+{
+public:
+    FFTSetupTest() : fft_(nullptr), flags_(GMX_FFT_FLAG_CONSERVATIVE) {}
+    ~FFTSetupTest() override
+    {
+        if (fft_)
+        {
+            gmx_fft_destroy(fft_);
+        }
+        gmx_fft_cleanup();
+    }
+    gmx_fft_t         fft_;
+    std::vector<real> in_;
+    int               flags_;
+};
+
 class ManyFFTTest : public BaseFFTTest
 {
 public:
@@ -276,6 +308,113 @@ TEST_F(FFTTest, Real2DLength18_15Test)
     //    _checker.checkSequenceArray(rx*ny, out, "backward");
 }
 
+/*! \brief Returns the DFT in direction \p sign of the \p nx complex values in \p in
+ *
+ * Computed directly in double precision, as a reference for setups
+ * of which no reference data is stored.
+ */
+std::vector<double> referenceComplexDft(const std::vector<real>& in, int nx, int sign)
+{
+    std::vector<double> out(2 * nx, 0.0);
+    for (int k = 0; k < nx; k++)
+    {
+        for (int j = 0; j < nx; j++)
+        {
+            const double angle = sign * 2 * M_PI * k * j / nx;
+            out[2 * k] += in[2 * j] * std::cos(angle) - in[2 * j + 1] * std::sin(angle);
+            out[2 * k + 1] += in[2 * j] * std::sin(angle) + in[2 * j + 1] * std::cos(angle);
+        }
+    }
+    return out;
+}
+
+TEST_F(FFTSetupTest, SetupsWithSameDimensionsShareCachedPlans)
+{
+    const int nx = 36;
+
+    in_ = std::vector<real>(nx * 2);
+    std::copy(inputdata, inputdata + nx * 2, in_.begin());
+    std::vector<real> out1(nx * 2);
+    std::vector<real> out2(nx * 2);
+
+    gmx_fft_t fft2 = nullptr;
+    gmx_fft_init_1d(&fft_, nx, flags_);
+    gmx_fft_init_1d(&fft2, nx, flags_);
+#if GMX_FFT_FFTW3
+    EXPECT_TRUE(gmx_fft_shares_plans(fft_, fft2));
+#endif
+
+    const auto tolerance = gmx::test::relativeToleranceAsFloatingPoint(100, 1e-5);
+    for (int direction : { GMX_FFT_FORWARD, GMX_FFT_BACKWARD })
+    {
+        SCOPED_TRACE(direction == GMX_FFT_FORWARD ? "forward" : "backward");
+        gmx_fft_1d(fft_, static_cast<gmx_fft_direction>(direction), in_.data(), out1.data());
+        gmx_fft_1d(fft2, static_cast<gmx_fft_direction>(direction), in_.data(), out2.data());
+        const std::vector<double> reference =
+                referenceComplexDft(in_, nx, direction == GMX_FFT_FORWARD ? -1 : 1);
+        for (int i = 0; i < nx * 2; i++)
+        {
+            EXPECT_REAL_EQ_TOL(reference[i], out1[i], tolerance);
+            EXPECT_REAL_EQ_TOL(reference[i], out2[i], tolerance);
+        }
+    }
+
+    // The plans of the remaining setup should stay usable
+    gmx_fft_destroy(fft2);
+    gmx_fft_1d(fft_, GMX_FFT_FORWARD, in_.data(), out1.data());
+    const std::vector<double> reference = referenceComplexDft(in_, nx, -1);
+    for (int i = 0; i < nx * 2; i++)
+    {
+        EXPECT_REAL_EQ_TOL(reference[i], out1[i], tolerance);
+    }
+}
+
+#if GMX_FFT_FFTW3
+//! Returns the lines of \p wisdom sorted, since FFTW exports wisdom in hash table order
+std::vector<std::string> sortedWisdomLines(const std::string& wisdom)
+{
+    std::vector<std::string> lines = gmx::splitDelimitedString(wisdom, '\n');
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
+
+TEST_F(FFTSetupTest, WisdomFileRoundTrips)
+{
+    gmx::test::TestFileManager fileManager;
+    const std::string          wisdomFile = fileManager.getTemporaryFilePath("wisdom");
+    const std::string          otherFile  = fileManager.getTemporaryFilePath("otherwisdom");
+    const int                  nx         = 60;
+
+    // Measured plans produce wisdom, which is exported on request
+    gmx::test::gmxSetenv("GMX_FFTW_WISDOM_FILE", wisdomFile.c_str(), 1);
+    gmx_fft_init_1d(&fft_, nx, GMX_FFT_FLAG_NONE);
+    gmx_fft_export_wisdom();
+    ASSERT_TRUE(gmx_fexist(wisdomFile));
+    const std::string wisdom = gmx::TextReader::readFileToString(wisdomFile);
+    EXPECT_NE(std::string::npos, wisdom.find("fftw"));
+
+    // Without newly measured plans, the wisdom is not written again
+    gmx::test::gmxSetenv("GMX_FFTW_WISDOM_FILE", otherFile.c_str(), 1);
+    gmx_fft_export_wisdom();
+    EXPECT_FALSE(gmx_fexist(otherFile));
+
+    // After forgetting all wisdom, a new setup imports it from the file,
+    // so the wisdom exported after planning again is the same
+    gmx_fft_destroy(fft_);
+    fft_ = nullptr;
+    gmx_fft_cleanup();
+    gmx::test::gmxSetenv("GMX_FFTW_WISDOM_FILE", wisdomFile.c_str(), 1);
+    gmx_fft_init_1d(&fft_, nx, GMX_FFT_FLAG_NONE);
+    gmx::test::gmxSetenv("GMX_FFTW_WISDOM_FILE", otherFile.c_str(), 1);
+    gmx_fft_export_wisdom();
+    ASSERT_TRUE(gmx_fexist(otherFile));
+    EXPECT_EQ(sortedWisdomLines(wisdom),
+              sortedWisdomLines(gmx::TextReader::readFileToString(otherFile)));
+
+    gmx::test::gmxUnsetenv("GMX_FFTW_WISDOM_FILE");
+}
+#endif
+
 // TODO: test with threads and more than 1 MPI ranks
 TEST_F(FFFTest3D, Real5_6_9)
 {
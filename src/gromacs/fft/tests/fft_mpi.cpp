@@ -0,0 +1,198 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the parallel 3D FFT over multiple MPI ranks.
+ *
+ * \ingroup module_fft
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fft/fft.h"
+#include "gromacs/fft/parallel_3dfft.h"
+#include "gromacs/gpu_utils/pinning.h"
+#include "gromacs/math/gmxcomplex.h"
+#include "gromacs/utility/basenetwork.h"
+#include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/setenv.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+/*! \brief Runs a forward and backward real-complex 3D FFT of size \p gridSize over \p comm
+ *
+ * Returns the local part of the complex grid, followed by that of the real grid
+ * after the backward transform.
+ */
+std::vector<real> runParallelFft(const ivec gridSize, MPI_Comm comm[2])
+{
+    gmx_parallel_3dfft_t setup;
+    real*                realGrid;
+    t_complex*           complexGrid;
+    gmx_parallel_3dfft_init(&setup, gridSize, &realGrid, &complexGrid, comm, TRUE, 1,
+                            PinningPolicy::CannotBePinned);
+
+    ivec localNData, localOffset, localSize;
+    gmx_parallel_3dfft_real_limits(setup, localNData, localOffset, localSize);
+    for (int x = 0; x < localNData[XX]; x++)
+    {
+        for (int y = 0; y < localNData[YY]; y++)
+        {
+            for (int z = 0; z < localNData[ZZ]; z++)
+            {
+                const int globalIndex =
+                        ((localOffset[XX] + x) * gridSize[YY] + localOffset[YY] + y) * gridSize[ZZ]
+                        + localOffset[ZZ] + z;
+                realGrid[(x * localSize[YY] + y) * localSize[ZZ] + z] = std::sin(0.1 * globalIndex);
+            }
+        }
+    }
+
+    gmx_parallel_3dfft_execute(setup, GMX_FFT_REAL_TO_COMPLEX, 0, nullptr);
+
+    std::vector<real> result;
+    ivec              complexOrder;
+    gmx_parallel_3dfft_complex_limits(setup, complexOrder, localNData, localOffset, localSize);
+    for (int x = 0; x < localNData[XX]; x++)
+    {
+        for (int y = 0; y < localNData[YY]; y++)
+        {
+            for (int z = 0; z < localNData[ZZ]; z++)
+            {
+                const t_complex& value = complexGrid[(x * localSize[YY] + y) * localSize[ZZ] + z];
+                result.push_back(value.re);
+                result.push_back(value.im);
+            }
+        }
+    }
+
+    gmx_parallel_3dfft_execute(setup, GMX_FFT_COMPLEX_TO_REAL, 0, nullptr);
+
+    gmx_parallel_3dfft_real_limits(setup, localNData, localOffset, localSize);
+    for (int x = 0; x < localNData[XX]; x++)
+    {
+        for (int y = 0; y < localNData[YY]; y++)
+        {
+            for (int z = 0; z < localNData[ZZ]; z++)
+            {
+                result.push_back(realGrid[(x * localSize[YY] + y) * localSize[ZZ] + z]);
+            }
+        }
+    }
+
+    gmx_parallel_3dfft_destroy(setup);
+
+    return result;
+}
+
+TEST(ParallelFftTest, PipelinedTransposesGiveIdenticalResults)
+{
+    GMX_MPI_TEST(4);
+
+    const int rank = gmx_node_rank();
+    // Grid sizes that are not multiples of the number of ranks
+    const ivec gridSize = { 13, 11, 10 };
+
+    for (const int numRanksMinor : { 1, 2 })
+    {
+        SCOPED_TRACE(formatString("Decomposition %d x %d", 4 / numRanksMinor, numRanksMinor));
+
+        MPI_Comm comm[2];
+        if (numRanksMinor == 1)
+        {
+            comm[0] = MPI_COMM_WORLD;
+            comm[1] = MPI_COMM_NULL;
+        }
+        else
+        {
+            MPI_Comm_split(MPI_COMM_WORLD, rank % numRanksMinor, rank, &comm[0]);
+            MPI_Comm_split(MPI_COMM_WORLD, rank / numRanksMinor, rank, &comm[1]);
+        }
+
+        const std::vector<real> reference = runParallelFft(gridSize, comm);
+
+        /* All ranks are threads with thread-MPI, so only one of them
+         * modifies the environment, while the others wait.
+         */
+        for (const char* numChunks : { "2", "3", "20" })
+        {
+            SCOPED_TRACE(formatString("%s pipeline chunks", numChunks));
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            if (rank == 0)
+            {
+                gmxSetenv("GMX_FFT5D_PIPELINE_CHUNKS", numChunks, 1);
+            }
+            MPI_Barrier(MPI_COMM_WORLD);
+            const std::vector<real> result = runParallelFft(gridSize, comm);
+            MPI_Barrier(MPI_COMM_WORLD);
+            if (rank == 0)
+            {
+                gmxUnsetenv("GMX_FFT5D_PIPELINE_CHUNKS");
+            }
+
+            // The same operations are done on the same data, so the results should be identical
+            ASSERT_EQ(reference.size(), result.size());
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                EXPECT_REAL_EQ_TOL(reference[i], result[i], ulpTolerance(0));
+            }
+        }
+
+        if (numRanksMinor > 1)
+        {
+            MPI_Comm_free(&comm[0]);
+            MPI_Comm_free(&comm[1]);
+        }
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -240,6 +240,7 @@ bool_t xdr_vector(XDR* __xdrs, char* __basep, unsigned int __nelem, unsigned int
 bool_t xdr_float(XDR* __xdrs, float* __fp);
 bool_t xdr_double(XDR* __xdrs, double* __dp);
 void   xdrstdio_create(XDR* __xdrs, FILE* __file, enum xdr_op __xop);
+void   xdrmem_create(XDR* __xdrs, char* __addr, unsigned int __size, enum xdr_op __xop);
 
 /* free memory buffers for xdr */
 void xdr_free(xdrproc_t __proc, char* __objp);
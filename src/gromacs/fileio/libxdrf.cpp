@@ -37,8 +37,10 @@
  */
 #include "gmxpre.h"
 
+#include <cfloat>
 #include <climits>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -47,8 +49,11 @@
 
 #include "gromacs/fileio/xdr_datatype.h"
 #include "gromacs/fileio/xdrf.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/utility/futil.h"
 
+using namespace gmx; // TODO: Remove when this file is moved into gmx namespace
+
 /* This is just for clarity - it can never be anything but 4! */
 #define XDR_INT_SIZE 4
 
@@ -137,6 +142,53 @@ static void sendbits(int buf[], int num_of_bits, int num)
     }
 }
 
+/*____________________________________________________________________________
+ |
+ | sendbits64 - encode num into buf using up to 64 bits
+ |
+ | This does exactly the same as sendbits(), but accepts numbers of up
+ | to 64 bits, so several numbers can be sent with one call.
+ |
+ */
+
+static void sendbits64(int buf[], int num_of_bits, uint64_t num)
+{
+
+    unsigned int   cnt, lastbyte;
+    int            lastbits;
+    unsigned char* cbuf;
+
+    cbuf     = (reinterpret_cast<unsigned char*>(buf)) + 3 * sizeof(*buf);
+    cnt      = static_cast<unsigned int>(buf[0]);
+    lastbits = buf[1];
+    lastbyte = static_cast<unsigned int>(buf[2]);
+    while (num_of_bits >= 8)
+    {
+        const auto byte = static_cast<unsigned int>((num >> (num_of_bits - 8)) & 0xff);
+        lastbyte        = (lastbyte << 8) | byte;
+        cbuf[cnt++]     = lastbyte >> lastbits;
+        num_of_bits -= 8;
+    }
+    if (num_of_bits > 0)
+    {
+        lastbyte = (lastbyte << num_of_bits)
+                   | static_cast<unsigned int>(num & ((1U << num_of_bits) - 1));
+        lastbits += num_of_bits;
+        if (lastbits >= 8)
+        {
+            lastbits -= 8;
+            cbuf[cnt++] = lastbyte >> lastbits;
+        }
+    }
+    buf[0] = cnt;
+    buf[1] = lastbits;
+    buf[2] = lastbyte;
+    if (lastbits > 0)
+    {
+        cbuf[cnt] = lastbyte << (8 - lastbits);
+    }
+}
+
 /*_________________________________________________________________________
  |
  | sizeofint - calculate bitsize of an integer
@@ -229,6 +281,35 @@ static void sendints(int          buf[],
     int          i, num_of_bytes, bytecnt;
     unsigned int bytes[32], tmp;
 
+    /* Fast path for three integers that combine to at most 64 bits, which
+     * is the common case. The combined integer is smaller than the product
+     * of the sizes, which fits in num_of_bits, both for sizes from
+     * sizeofints() and for magicints[smallidx] with num_of_bits=smallidx.
+     * The bytes are sent starting with the least significant one and the
+     * last byte only with the bits remaining of num_of_bits, which gives
+     * exactly the same bits as the general code below.
+     */
+    if (num_of_ints == 3 && num_of_bits <= 64 && nums[0] < sizes[0] && nums[1] < sizes[1]
+        && nums[2] < sizes[2])
+    {
+        const uint64_t value =
+                (static_cast<uint64_t>(nums[0]) * sizes[1] + nums[1]) * sizes[2] + nums[2];
+        const int numFullBytes = num_of_bits / 8;
+        const int numLastBits  = num_of_bits % 8;
+        uint64_t  bits         = 0;
+        for (i = 0; i < numFullBytes; i++)
+        {
+            bits = (bits << 8) | ((value >> (8 * i)) & 0xff);
+        }
+        if (numLastBits > 0)
+        {
+            bits = (bits << numLastBits) | (value >> (8 * numFullBytes));
+        }
+        sendbits64(buf, num_of_bits, bits);
+
+        return;
+    }
+
     tmp          = nums[0];
     num_of_bytes = 0;
     do
@@ -327,6 +408,51 @@ static int receivebits(int buf[], int num_of_bits)
     return num;
 }
 
+/*____________________________________________________________________________
+ |
+ | receivebits64 - decode number from buf using up to 64 bits
+ |
+ | This does exactly the same as receivebits(), but returns numbers of
+ | up to 64 bits, so several numbers can be received with one call.
+ |
+ */
+
+static uint64_t receivebits64(int buf[], int num_of_bits)
+{
+
+    int            cnt, lastbits;
+    unsigned int   lastbyte;
+    unsigned char* cbuf;
+    uint64_t       num;
+
+    cbuf     = reinterpret_cast<unsigned char*>(buf) + 3 * sizeof(*buf);
+    cnt      = buf[0];
+    lastbits = static_cast<unsigned int>(buf[1]);
+    lastbyte = static_cast<unsigned int>(buf[2]);
+
+    num = 0;
+    while (num_of_bits >= 8)
+    {
+        lastbyte = (lastbyte << 8) | cbuf[cnt++];
+        num      = (num << 8) | ((lastbyte >> lastbits) & 0xff);
+        num_of_bits -= 8;
+    }
+    if (num_of_bits > 0)
+    {
+        if (lastbits < num_of_bits)
+        {
+            lastbits += 8;
+            lastbyte = (lastbyte << 8) | cbuf[cnt++];
+        }
+        lastbits -= num_of_bits;
+        num = (num << num_of_bits) | ((lastbyte >> lastbits) & ((1U << num_of_bits) - 1));
+    }
+    buf[0] = cnt;
+    buf[1] = lastbits;
+    buf[2] = lastbyte;
+    return num;
+}
+
 /*____________________________________________________________________________
  |
  | receiveints - decode 'small' integers from the buf array
@@ -343,6 +469,43 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits, const
     int bytes[32];
     int i, j, num_of_bytes, p, num;
 
+    /* Fast path for three integers that combine to at most 64 bits,
+     * the inverse of the fast path in sendints()
+     */
+    if (num_of_ints == 3 && num_of_bits <= 64)
+    {
+        /* As below, all bytes but the last are read with 8 bits */
+        const int      numFullBytes = (num_of_bits - 1) / 8;
+        const int      numLastBits  = num_of_bits - 8 * numFullBytes;
+        const uint64_t bits         = receivebits64(buf, num_of_bits);
+        const uint64_t lastByte     = bits & ((1U << numLastBits) - 1);
+        uint64_t       value        = lastByte << (8 * numFullBytes);
+        for (i = 0; i < numFullBytes; i++)
+        {
+            value |= ((bits >> (numLastBits + 8 * i)) & 0xff) << (8 * (numFullBytes - 1 - i));
+        }
+        if (value <= UINT32_MAX)
+        {
+            /* 32-bit division is significantly faster */
+            auto value32 = static_cast<uint32_t>(value);
+            nums[2]      = value32 % sizes[2];
+            value32 /= sizes[2];
+            nums[1] = value32 % sizes[1];
+            nums[0] = value32 / sizes[1];
+        }
+        else
+        {
+            nums[2] = value % sizes[2];
+            value /= sizes[2];
+            nums[1] = value % sizes[1];
+            value /= sizes[1];
+            /* Only the lowest 4 bytes are returned below */
+            nums[0] = static_cast<uint32_t>(value);
+        }
+
+        return;
+    }
+
     bytes[0] = bytes[1] = bytes[2] = bytes[3] = 0;
     num_of_bytes                              = 0;
     while (num_of_bits > 8)
@@ -369,6 +532,124 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits, const
     nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
 }
 
+/*____________________________________________________________________________
+ |
+ | quantizecoords - convert coordinates to integers and determine their ranges
+ |
+ | this is the first step of compressing coordinates in xdr3dfcoord(), which
+ | converts the size3 floats in fp to the integers in ip by multiplication
+ | with precision and rounding to the nearest integer, returns the minimum
+ | and maximum integer per dimension in minint and maxint and the minimum
+ | over all atoms but the first of the summed absolute integer differences
+ | with the previous atom in mindiff.
+ | The conversion and the ranges are computed with SIMD, giving exactly
+ | the same results as the reference loop in xdr3dfcoord(). When an
+ | integer is too large for the differences to be summed without overflow
+ | or when a float is not a number, 0 is returned and the reference loop
+ | should be used instead, as that handles this in the reference manner.
+ |
+ */
+
+static int quantizecoords(const float* fp,
+                          const int    size3,
+                          const float  precision,
+                          int*         ip,
+                          int          minint[],
+                          int          maxint[],
+                          int*         mindiff)
+{
+    /* With this limit for the integers, the sum of three differences fits in an int */
+    const float maxquant = 268435456.0F;
+    float       minf[3]  = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float       maxf[3]  = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    int         i        = 0;
+
+#if GMX_SIMD_HAVE_FLOAT && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+    /* We process the coordinates of GMX_SIMD_FLOAT_WIDTH atoms at a time
+     * with three SIMD registers, so the dimension of each element only
+     * depends on the register and the element index.
+     */
+    const SimdFloat prec(precision);
+    const SimdFloat half(0.5F);
+    const SimdFloat minushalf(-0.5F);
+    const SimdFloat maxquantS(maxquant);
+    const SimdFloat zero = setZero();
+    SimdFloat       minS[3], maxS[3];
+    for (int j = 0; j < 3; j++)
+    {
+        minS[j] = SimdFloat(FLT_MAX);
+        maxS[j] = SimdFloat(-FLT_MAX);
+    }
+    for (; i + 3 * GMX_SIMD_FLOAT_WIDTH <= size3; i += 3 * GMX_SIMD_FLOAT_WIDTH)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            const SimdFloat x = simdLoadU(fp + i + j * GMX_SIMD_FLOAT_WIDTH);
+            /* The product needs to be rounded before adding 0.5, as in the
+             * reference loop. Adding zero ensures this also when the compiler
+             * contracts multiplications and additions to FMA instructions.
+             */
+            const SimdFloat product = x * prec + zero;
+            const SimdFloat lf      = product + blend(minushalf, half, zero <= x);
+            if (anyTrue(maxquantS < abs(lf) || lf != lf))
+            {
+                return 0;
+            }
+            storeU(ip + i + j * GMX_SIMD_FLOAT_WIDTH, cvttR2I(lf));
+            /* Converting to integer is monotonic, so the minimum and maximum
+             * of the floats convert to those of the integers
+             */
+            minS[j] = min(minS[j], lf);
+            maxS[j] = max(maxS[j], lf);
+        }
+    }
+    alignas(GMX_SIMD_ALIGNMENT) float buf[GMX_SIMD_FLOAT_WIDTH];
+    for (int j = 0; j < 3; j++)
+    {
+        store(buf, minS[j]);
+        for (int k = 0; k < GMX_SIMD_FLOAT_WIDTH; k++)
+        {
+            const int d = (j * GMX_SIMD_FLOAT_WIDTH + k) % 3;
+            minf[d]     = std::min(minf[d], buf[k]);
+        }
+        store(buf, maxS[j]);
+        for (int k = 0; k < GMX_SIMD_FLOAT_WIDTH; k++)
+        {
+            const int d = (j * GMX_SIMD_FLOAT_WIDTH + k) % 3;
+            maxf[d]     = std::max(maxf[d], buf[k]);
+        }
+    }
+#endif
+    /* i is a multiple of 3 here */
+    for (; i < size3; i++)
+    {
+        /* Adding 0.5 in double, as the reference loop, avoids contraction to FMA */
+        const float lf = (fp[i] >= 0.0 ? fp[i] * precision + 0.5 : fp[i] * precision - 0.5);
+        if (!(std::fabs(lf) <= maxquant))
+        {
+            return 0;
+        }
+        ip[i]       = static_cast<int>(lf);
+        minf[i % 3] = std::min(minf[i % 3], lf);
+        maxf[i % 3] = std::max(maxf[i % 3], lf);
+    }
+    for (int d = 0; d < 3; d++)
+    {
+        minint[d] = static_cast<int>(minf[d]);
+        maxint[d] = static_cast<int>(maxf[d]);
+    }
+
+    *mindiff = INT_MAX;
+    for (i = 3; i < size3; i += 3)
+    {
+        const int diff = std::abs(ip[i] - ip[i - 3]) + std::abs(ip[i + 1] - ip[i - 2])
+                         + std::abs(ip[i + 2] - ip[i - 1]);
+        *mindiff = std::min(*mindiff, diff);
+    }
+
+    return 1;
+}
+
 /*____________________________________________________________________________
  |
  | xdr3dfcoord - read or write compressed 3d coordinates to xdr file.
@@ -396,7 +677,10 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits, const
  |
  */
 
-int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
+/* Implements xdr3dfcoord, on read at most maxSize coordinate triplets are
+ * accepted when maxSize >= 0
+ */
+static int xdr3dfcoordImpl(XDR* xdrs, float* fp, int* size, int maxSize, float* precision)
 {
     int*     ip  = nullptr;
     int*     buf = nullptr;
@@ -486,89 +770,94 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
         lip                               = ip;
         mindiff                           = INT_MAX;
         oldlint1 = oldlint2 = oldlint3 = 0;
-        while (lfp < fp + size3)
+        /* Use the reference loop only when the fast version can not be used */
+        if (quantizecoords(fp, size3, *precision, ip, minint, maxint, &mindiff) == 0)
         {
-            /* find nearest integer */
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (std::fabs(lf) > maxAbsoluteInt)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint1 = static_cast<int>(lf);
-            if (lint1 < minint[0])
-            {
-                minint[0] = lint1;
-            }
-            if (lint1 > maxint[0])
+            while (lfp < fp + size3)
             {
-                maxint[0] = lint1;
-            }
-            *lip++ = lint1;
-            lfp++;
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (std::fabs(lf) > maxAbsoluteInt)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint2 = static_cast<int>(lf);
-            if (lint2 < minint[1])
-            {
-                minint[1] = lint2;
-            }
-            if (lint2 > maxint[1])
-            {
-                maxint[1] = lint2;
-            }
-            *lip++ = lint2;
-            lfp++;
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (std::abs(lf) > maxAbsoluteInt)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint3 = static_cast<int>(lf);
-            if (lint3 < minint[2])
-            {
-                minint[2] = lint3;
-            }
-            if (lint3 > maxint[2])
-            {
-                maxint[2] = lint3;
-            }
-            *lip++ = lint3;
-            lfp++;
-            diff = std::abs(oldlint1 - lint1) + std::abs(oldlint2 - lint2) + std::abs(oldlint3 - lint3);
-            if (diff < mindiff && lfp > fp + 3)
-            {
-                mindiff = diff;
+                /* find nearest integer */
+                if (*lfp >= 0.0)
+                {
+                    lf = *lfp * *precision + 0.5;
+                }
+                else
+                {
+                    lf = *lfp * *precision - 0.5;
+                }
+                if (std::fabs(lf) > maxAbsoluteInt)
+                {
+                    /* scaling would cause overflow */
+                    errval = 0;
+                }
+                lint1 = static_cast<int>(lf);
+                if (lint1 < minint[0])
+                {
+                    minint[0] = lint1;
+                }
+                if (lint1 > maxint[0])
+                {
+                    maxint[0] = lint1;
+                }
+                *lip++ = lint1;
+                lfp++;
+                if (*lfp >= 0.0)
+                {
+                    lf = *lfp * *precision + 0.5;
+                }
+                else
+                {
+                    lf = *lfp * *precision - 0.5;
+                }
+                if (std::fabs(lf) > maxAbsoluteInt)
+                {
+                    /* scaling would cause overflow */
+                    errval = 0;
+                }
+                lint2 = static_cast<int>(lf);
+                if (lint2 < minint[1])
+                {
+                    minint[1] = lint2;
+                }
+                if (lint2 > maxint[1])
+                {
+                    maxint[1] = lint2;
+                }
+                *lip++ = lint2;
+                lfp++;
+                if (*lfp >= 0.0)
+                {
+                    lf = *lfp * *precision + 0.5;
+                }
+                else
+                {
+                    lf = *lfp * *precision - 0.5;
+                }
+                if (std::abs(lf) > maxAbsoluteInt)
+                {
+                    /* scaling would cause overflow */
+                    errval = 0;
+                }
+                lint3 = static_cast<int>(lf);
+                if (lint3 < minint[2])
+                {
+                    minint[2] = lint3;
+                }
+                if (lint3 > maxint[2])
+                {
+                    maxint[2] = lint3;
+                }
+                *lip++ = lint3;
+                lfp++;
+                diff = std::abs(oldlint1 - lint1) + std::abs(oldlint2 - lint2)
+                       + std::abs(oldlint3 - lint3);
+                if (diff < mindiff && lfp > fp + 3)
+                {
+                    mindiff = diff;
+                }
+                oldlint1 = lint1;
+                oldlint2 = lint2;
+                oldlint3 = lint3;
             }
-            oldlint1 = lint1;
-            oldlint2 = lint2;
-            oldlint3 = lint3;
         }
         if ((xdr_int(xdrs, &(minint[0])) == 0) || (xdr_int(xdrs, &(minint[1])) == 0)
             || (xdr_int(xdrs, &(minint[2])) == 0) || (xdr_int(xdrs, &(maxint[0])) == 0)
@@ -785,6 +1074,10 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
         {
             return 0;
         }
+        if (maxSize >= 0 && (lsize < 0 || lsize > maxSize))
+        {
+            return 0;
+        }
         if (*size != 0 && lsize != *size)
         {
             fprintf(stderr,
@@ -1008,6 +1301,18 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
     return 1;
 }
 
+int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
+{
+    return xdr3dfcoordImpl(xdrs, fp, size, -1, precision);
+}
+
+int xdr3dfcoord_read_at_most(XDR* xdrs, float* fp, int maxSize, int* size, float* precision)
+{
+    *size = 0;
+
+    return xdr3dfcoordImpl(xdrs, fp, size, maxSize, precision);
+}
+
 
 /******************************************************************
 
@@ -1021,6 +1326,8 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
    The second 4 bytes are the number of atoms in the frame, and is
    assumed to be constant. The third 4 bytes are the frame number.
    The last 4 bytes are a floating point representation of the time.
+   Frames with the coordinates compressed in chunks have magic
+   number 2021 (0x000007E5) instead.
 
  ********************************************************************/
 
@@ -1028,6 +1335,9 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
 #ifndef XTC_MAGIC
 #    define XTC_MAGIC 1995
 #endif
+#ifndef XTC_CHUNKED_MAGIC
+#    define XTC_CHUNKED_MAGIC 2021
+#endif
 
 static const int header_size = 16;
 
@@ -1055,7 +1365,7 @@ static int xtc_at_header_start(FILE* fp, XDR* xdrs, int natoms, int* timestep, f
         }
     }
     /* quick return */
-    if (i_inp[0] != XTC_MAGIC)
+    if (i_inp[0] != XTC_MAGIC && i_inp[0] != XTC_CHUNKED_MAGIC)
     {
         if (gmx_fseek(fp, off + XDR_INT_SIZE, SEEK_SET))
         {
@@ -0,0 +1,420 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the frame index of XTC and TRR trajectory files
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trajectoryframeindex.h"
+
+#include "config.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/filetypes.h"
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/timecontrol.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/setenv.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms in the test frames
+constexpr int c_numAtoms = 20;
+//! The number of frames in the test trajectories
+constexpr int c_numFrames = 12;
+
+//! Returns the step of frame \p frame in the test trajectories
+int64_t stepOfFrame(int frame)
+{
+    return 10 * frame;
+}
+
+//! Returns the time of frame \p frame in the test trajectories
+real timeOfFrame(int frame)
+{
+    return 0.5_real * frame;
+}
+
+//! Returns whether frame \p frame in the test TRR trajectories has velocities
+bool frameHasVelocities(int frame)
+{
+    return frame % 2 == 0;
+}
+
+//! Returns whether frame \p frame in the test TRR trajectories has forces
+bool frameHasForces(int frame)
+{
+    return frame % 3 == 0;
+}
+
+/*! \brief Writes frames \p firstFrame up to \p lastFrame to trajectory \p filename
+ *
+ * When \p recorder is not nullptr, the frames are recorded in it.
+ */
+void writeFrames(const std::string&            filename,
+                 const char*                   mode,
+                 int                           firstFrame,
+                 int                           lastFrame,
+                 TrajectoryFrameIndexRecorder* recorder = nullptr)
+{
+    const bool isXtc = (fn2ftp(filename.c_str()) == efXTC);
+
+    std::vector<RVec> x(c_numAtoms);
+    matrix            box = { { 3, 0, 0 }, { 0, 3, 0 }, { 0, 0, 3 } };
+
+    t_fileio* fio = isXtc ? open_xtc(filename.c_str(), mode) : gmx_trr_open(filename.c_str(), mode);
+    for (int frame = firstFrame; frame < lastFrame; frame++)
+    {
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                x[i][d] = 1.5_real + 1.4_real * std::sin(0.37_real * (i + frame) + 1.1_real * d);
+            }
+        }
+        const rvec* xPtr = as_rvec_array(x.data());
+        if (isXtc)
+        {
+            ASSERT_EQ(1, write_xtc(fio, c_numAtoms, stepOfFrame(frame), timeOfFrame(frame), box,
+                                   xPtr, 1000));
+        }
+        else
+        {
+            gmx_trr_write_frame(fio, stepOfFrame(frame), timeOfFrame(frame), 0, box, c_numAtoms,
+                                xPtr, frameHasVelocities(frame) ? xPtr : nullptr,
+                                frameHasForces(frame) ? xPtr : nullptr);
+        }
+        if (recorder)
+        {
+            recorder->addFrame({ 0, stepOfFrame(frame), timeOfFrame(frame), true,
+                                 !isXtc && frameHasVelocities(frame),
+                                 !isXtc && frameHasForces(frame), !isXtc && GMX_DOUBLE },
+                               gmx_fio_ftell(fio));
+        }
+    }
+    if (isXtc)
+    {
+        close_xtc(fio);
+    }
+    else
+    {
+        gmx_trr_close(fio);
+    }
+}
+
+//! Builds the index of \p filename without using an existing index file
+std::unique_ptr<TrajectoryFrameIndex> buildIndex(const std::string& filename)
+{
+    std::remove(frameIndexFileName(filename).c_str());
+
+    return loadTrajectoryFrameIndex(filename);
+}
+
+//! Checks that the offsets, steps and times of \p index and \p reference are equal
+void compareIndices(const TrajectoryFrameIndex& reference, const TrajectoryFrameIndex& index)
+{
+    ASSERT_EQ(reference.numFrames(), index.numFrames());
+    for (int64_t frame = 0; frame <= reference.numFrames(); frame++)
+    {
+        EXPECT_EQ(reference.frameOffset(frame), index.frameOffset(frame));
+    }
+    for (int64_t frame = 0; frame < reference.numFrames(); frame++)
+    {
+        EXPECT_EQ(reference.frames()[frame].step, index.frames()[frame].step);
+        EXPECT_EQ(static_cast<real>(reference.frames()[frame].time),
+                  static_cast<real>(index.frames()[frame].time));
+    }
+}
+
+//! The steps and times of frames
+using FrameList = std::vector<std::pair<int64_t, real>>;
+
+//! Returns the steps and times of the frames that read_next_frame returns for \p filename
+FrameList readFrames(const std::string& filename, int flags)
+{
+    gmx_output_env_t* oenv;
+    output_env_init_default(&oenv);
+    FrameList    frames;
+    t_trxstatus* status;
+    t_trxframe   fr;
+    bool         haveFrame = read_first_frame(oenv, &status, filename.c_str(), &fr, flags);
+    while (haveFrame)
+    {
+        frames.emplace_back(fr.step, fr.time);
+        haveFrame = read_next_frame(oenv, status, &fr);
+    }
+    close_trx(status);
+    done_frame(&fr);
+    output_env_done(oenv);
+
+    return frames;
+}
+
+//! Tests the frame index, parametrized by the trajectory file extension
+class TrajectoryFrameIndexTest : public ::testing::TestWithParam<const char*>
+{
+public:
+    TrajectoryFrameIndexTest() : filename_(fileManager_.getTemporaryFilePath(GetParam()))
+    {
+        // Register the index file, so it is removed after the test
+        fileManager_.getTemporaryFilePath(frameIndexFileName(GetParam()));
+    }
+
+    ~TrajectoryFrameIndexTest() override
+    {
+        unsetTimeValue(TBEGIN);
+        unsetTimeValue(TEND);
+        unsetTimeValue(TDELTA);
+    }
+
+    //! Returns whether the test trajectory is an XTC file
+    bool isXtc() const { return fn2ftp(filename_.c_str()) == efXTC; }
+
+    //! Manages the temporary files
+    TestFileManager fileManager_;
+    //! The test trajectory
+    std::string filename_;
+};
+
+TEST_P(TrajectoryFrameIndexTest, IndexesAllFrames)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+    const auto index = buildIndex(filename_);
+    ASSERT_TRUE(index);
+    ASSERT_EQ(c_numFrames, index->numFrames());
+    EXPECT_EQ(0, index->frameOffset(0));
+    EXPECT_EQ(index->fileSize(), index->frameOffset(c_numFrames));
+    for (int frame = 0; frame < c_numFrames; frame++)
+    {
+        const TrajectoryFrameIndexEntry& entry = index->frames()[frame];
+        EXPECT_EQ(frame, index->frameAtOffset(entry.offset));
+        EXPECT_EQ(stepOfFrame(frame), entry.step);
+        EXPECT_EQ(timeOfFrame(frame), static_cast<real>(entry.time));
+        EXPECT_TRUE(entry.haveX);
+        EXPECT_EQ(!isXtc() && frameHasVelocities(frame), entry.haveV);
+        EXPECT_EQ(!isXtc() && frameHasForces(frame), entry.haveF);
+    }
+    EXPECT_EQ(-1, index->frameAtOffset(1));
+}
+
+TEST_P(TrajectoryFrameIndexTest, WritesAndReusesIndexFile)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+    const auto index = buildIndex(filename_);
+    ASSERT_TRUE(index);
+    EXPECT_TRUE(gmx_fexist(frameIndexFileName(filename_)));
+    const auto reusedIndex = loadTrajectoryFrameIndex(filename_);
+    ASSERT_TRUE(reusedIndex);
+    compareIndices(*index, *reusedIndex);
+    EXPECT_EQ(index->fileSize(), reusedIndex->fileSize());
+    EXPECT_EQ(index->modificationTime(), reusedIndex->modificationTime());
+}
+
+TEST_P(TrajectoryFrameIndexTest, ExtendsIndexOfAppendedTrajectory)
+{
+    writeFrames(filename_, "w", 0, c_numFrames / 2);
+    ASSERT_TRUE(buildIndex(filename_));
+    writeFrames(filename_, "a", c_numFrames / 2, c_numFrames);
+    const auto index = loadTrajectoryFrameIndex(filename_);
+    ASSERT_TRUE(index);
+    EXPECT_EQ(c_numFrames, index->numFrames());
+    compareIndices(*buildIndex(filename_), *index);
+}
+
+TEST_P(TrajectoryFrameIndexTest, IgnoresIncompleteLastFrame)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+    const auto completeIndex = buildIndex(filename_);
+    ASSERT_TRUE(completeIndex);
+    // Cut off the end of the last frame, as happens when mdrun is killed while writing
+    ASSERT_EQ(0, gmx_truncate(filename_, completeIndex->frameOffset(c_numFrames) - 10));
+
+    const auto index = buildIndex(filename_);
+    ASSERT_TRUE(index);
+    EXPECT_EQ(c_numFrames - 1, index->numFrames());
+    EXPECT_EQ(completeIndex->frameOffset(c_numFrames - 1), index->frameOffset(c_numFrames - 1));
+}
+
+TEST_P(TrajectoryFrameIndexTest, RecorderWritesTheSameIndex)
+{
+    {
+        TrajectoryFrameIndexRecorder recorder(filename_, false);
+        writeFrames(filename_, "w", 0, c_numFrames, &recorder);
+        recorder.writeIndexFile();
+    }
+    const auto recordedIndex = loadTrajectoryFrameIndex(filename_);
+    ASSERT_TRUE(recordedIndex);
+    compareIndices(*buildIndex(filename_), *recordedIndex);
+}
+
+TEST_P(TrajectoryFrameIndexTest, RecorderKeepsFramesWhenAppending)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+    const auto index = buildIndex(filename_);
+    ASSERT_TRUE(index);
+
+    // Truncate the file as mdrun does when restarting from a checkpoint
+    constexpr int c_numFramesToKeep = c_numFrames / 3;
+    ASSERT_EQ(0, gmx_truncate(filename_, index->frameOffset(c_numFramesToKeep)));
+    {
+        TrajectoryFrameIndexRecorder recorder(filename_, true);
+        writeFrames(filename_, "a", c_numFramesToKeep, c_numFrames, &recorder);
+        recorder.writeIndexFile();
+    }
+    const auto recordedIndex = loadTrajectoryFrameIndex(filename_);
+    ASSERT_TRUE(recordedIndex);
+    compareIndices(*index, *recordedIndex);
+}
+
+TEST_P(TrajectoryFrameIndexTest, SelectsTheSameFramesAsSequentialReading)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+    const std::vector<int> flagsToTest = { TRX_READ_X, TRX_NEED_V, TRX_READ_X | TRX_DONT_SKIP };
+    // The begin, end and delta times to set, in the order of TBEGIN, TEND and TDELTA,
+    // with negative values for times that should not be set
+    const std::vector<std::array<real, TNR>> timesToTest = {
+        { 2, -1, -1 }, { -1, -1, 1 }, { 1.5, 4.5, 1 }, { 0, 3, 1.5 }, { 20, -1, -1 }
+    };
+    for (int flags : flagsToTest)
+    {
+        for (const auto& times : timesToTest)
+        {
+            SCOPED_TRACE(formatString("flags %d, begin %g, end %g, delta %g", flags, times[TBEGIN],
+                                      times[TEND], times[TDELTA]));
+            for (int tcontrol = 0; tcontrol < TNR; tcontrol++)
+            {
+                if (times[tcontrol] >= 0)
+                {
+                    setTimeValue(tcontrol, times[tcontrol]);
+                }
+                else
+                {
+                    unsetTimeValue(tcontrol);
+                }
+            }
+            if (isXtc() && times[TBEGIN] > timeOfFrame(c_numFrames - 1))
+            {
+                // The xtc reader does not accept begin times after the last frame
+                continue;
+            }
+            buildIndex(filename_);
+            const FrameList framesWithIndex = readFrames(filename_, flags);
+            gmxSetenv("GMX_NO_TRAJECTORY_FRAME_INDEX", "1", 1);
+            const FrameList framesWithoutIndex = readFrames(filename_, flags);
+            gmxUnsetenv("GMX_NO_TRAJECTORY_FRAME_INDEX");
+            EXPECT_EQ(framesWithoutIndex, framesWithIndex);
+        }
+    }
+}
+
+TEST_P(TrajectoryFrameIndexTest, SeeksToFrames)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+
+    gmx_output_env_t* oenv;
+    output_env_init_default(&oenv);
+    t_trxstatus* status;
+    t_trxframe   fr;
+    ASSERT_TRUE(read_first_frame(oenv, &status, filename_.c_str(), &fr, TRX_READ_X));
+    EXPECT_EQ(c_numFrames, trx_get_number_of_frames(status));
+    for (int frame : { 7, 2, c_numFrames - 1, 0 })
+    {
+        ASSERT_TRUE(trx_seek_frame(status, frame));
+        ASSERT_TRUE(read_next_frame(oenv, status, &fr));
+        EXPECT_EQ(stepOfFrame(frame), fr.step);
+        EXPECT_EQ(timeOfFrame(frame), fr.time);
+    }
+    // Sequential reading continues after the frame sought
+    ASSERT_TRUE(read_next_frame(oenv, status, &fr));
+    EXPECT_EQ(stepOfFrame(1), fr.step);
+    EXPECT_FALSE(trx_seek_frame(status, c_numFrames));
+    EXPECT_FALSE(trx_seek_frame(status, -1));
+    close_trx(status);
+    done_frame(&fr);
+    output_env_done(oenv);
+}
+
+INSTANTIATE_TEST_CASE_P(WithFormats,
+                        TrajectoryFrameIndexTest,
+                        ::testing::Values("frames.xtc", "frames.trr"));
+
+TEST(TrajectoryFrameIndexPartTest, DividesFramesOverParts)
+{
+    for (int numParts : { 1, 3, 4, 7 })
+    {
+        for (int64_t numFrames : { 0, 1, 5, 12, 100 })
+        {
+            int64_t end = 0;
+            for (int part = 0; part < numParts; part++)
+            {
+                const auto range = frameRangeOfPart(numFrames, part, numParts);
+                EXPECT_EQ(end, range.first);
+                EXPECT_LE(range.first, range.second);
+                EXPECT_LE(range.second - range.first, numFrames / numParts + 1);
+                end = range.second;
+            }
+            EXPECT_EQ(numFrames, end);
+        }
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
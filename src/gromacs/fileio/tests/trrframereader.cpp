@@ -0,0 +1,431 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for reading TRR frames from a memory-mapped file
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trrframereader.h"
+
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms in the test frames
+constexpr int c_numAtoms = 37;
+//! The number of frames in the test trajectories
+constexpr int c_numFrames = 6;
+
+//! Returns arbitrary values for frame \p frame and array \p array
+std::vector<RVec> makeValues(int frame, int array)
+{
+    std::vector<RVec> values(c_numAtoms);
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            values[i][d] =
+                    1.5_real + 1.4_real * std::sin(0.37_real * (i + frame) + 1.1_real * d + array);
+        }
+    }
+    return values;
+}
+
+//! Writes frames \p firstFrame up to \p lastFrame, with varying contents, to \p filename
+void writeFrames(const std::string& filename, const char* mode, int firstFrame, int lastFrame)
+{
+    t_fileio* fio = gmx_trr_open(filename.c_str(), mode);
+    for (int frame = firstFrame; frame < lastFrame; frame++)
+    {
+        const std::vector<RVec> x = makeValues(frame, 0);
+        const std::vector<RVec> v = makeValues(frame, 1);
+        const std::vector<RVec> f = makeValues(frame, 2);
+        matrix box = { { 3, 0, 0 }, { 0, 3.5_real + frame, 0 }, { 0.5_real, 0, 4 } };
+        gmx_trr_write_frame(fio, 100 * frame, 0.25_real * frame, 0.1_real * frame,
+                            frame % 4 != 3 ? box : nullptr, c_numAtoms,
+                            frame % 3 != 1 ? as_rvec_array(x.data()) : nullptr,
+                            frame % 2 == 0 ? as_rvec_array(v.data()) : nullptr,
+                            frame % 3 != 2 ? as_rvec_array(f.data()) : nullptr);
+    }
+    gmx_trr_close(fio);
+}
+
+//! The result of reading a frame
+struct FrameReadResult
+{
+    //! The return value of reading the header
+    gmx_bool haveHeader = FALSE;
+    //! Whether reading the header was OK
+    gmx_bool headerOK = FALSE;
+    //! The return value of reading the data
+    gmx_bool haveData = FALSE;
+    //! The header
+    gmx_trr_header_t header;
+    //! The box
+    matrix box = { { 0 } };
+    //! The positions
+    std::vector<RVec> x;
+    //! The velocities
+    std::vector<RVec> v;
+    //! The forces
+    std::vector<RVec> f;
+};
+
+/*! \brief Reads the frames in \p fio until reading fails
+ *
+ * Reads through \p reader when not nullptr, otherwise through XDR.
+ */
+std::vector<FrameReadResult> readFrames(t_fileio* fio, TrrFrameReader* reader)
+{
+    std::vector<FrameReadResult> frames;
+    do
+    {
+        frames.emplace_back();
+        FrameReadResult& frame = frames.back();
+        std::memset(&frame.header, 0, sizeof(frame.header));
+        frame.haveHeader = reader ? reader->readFrameHeader(&frame.header, &frame.headerOK)
+                                  : gmx_trr_read_frame_header(fio, &frame.header, &frame.headerOK);
+        if (frame.haveHeader)
+        {
+            frame.x.resize(frame.header.x_size ? frame.header.natoms : 0);
+            frame.v.resize(frame.header.v_size ? frame.header.natoms : 0);
+            frame.f.resize(frame.header.f_size ? frame.header.natoms : 0);
+            rvec* x = frame.x.empty() ? nullptr : as_rvec_array(frame.x.data());
+            rvec* v = frame.v.empty() ? nullptr : as_rvec_array(frame.v.data());
+            rvec* f = frame.f.empty() ? nullptr : as_rvec_array(frame.f.data());
+            frame.haveData =
+                    reader ? reader->readFrameData(frame.header, frame.box, x, v, f)
+                           : gmx_trr_read_frame_data(fio, &frame.header, frame.box, x, v, f);
+        }
+    } while (frames.back().haveHeader && frames.back().haveData);
+
+    return frames;
+}
+
+//! Checks that \p reference and \p frames are identical
+void compareFrames(const std::vector<FrameReadResult>& reference,
+                   const std::vector<FrameReadResult>& frames)
+{
+    ASSERT_EQ(reference.size(), frames.size());
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        SCOPED_TRACE(formatString("Frame %zu", i));
+        const FrameReadResult& ref   = reference[i];
+        const FrameReadResult& frame = frames[i];
+        ASSERT_EQ(ref.haveHeader, frame.haveHeader);
+        EXPECT_EQ(ref.headerOK, frame.headerOK);
+        if (!ref.haveHeader)
+        {
+            continue;
+        }
+        EXPECT_EQ(ref.header.bDouble, frame.header.bDouble);
+        EXPECT_EQ(ref.header.box_size, frame.header.box_size);
+        EXPECT_EQ(ref.header.x_size, frame.header.x_size);
+        EXPECT_EQ(ref.header.v_size, frame.header.v_size);
+        EXPECT_EQ(ref.header.f_size, frame.header.f_size);
+        EXPECT_EQ(ref.header.natoms, frame.header.natoms);
+        EXPECT_EQ(ref.header.step, frame.header.step);
+        EXPECT_EQ(ref.header.t, frame.header.t);
+        EXPECT_EQ(ref.header.lambda, frame.header.lambda);
+        EXPECT_EQ(ref.haveData, frame.haveData);
+        if (!ref.haveData)
+        {
+            continue;
+        }
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                EXPECT_EQ(ref.box[d][e], frame.box[d][e]);
+            }
+        }
+        for (const auto& arrays : { std::make_pair(&ref.x, &frame.x),
+                                    std::make_pair(&ref.v, &frame.v),
+                                    std::make_pair(&ref.f, &frame.f) })
+        {
+            ASSERT_EQ(arrays.first->size(), arrays.second->size());
+            for (size_t a = 0; a < arrays.first->size(); a++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_EQ((*arrays.first)[a][d], (*arrays.second)[a][d]);
+                }
+            }
+        }
+    }
+}
+
+//! Returns the frames in \p filename read through XDR
+std::vector<FrameReadResult> readFramesWithXdr(const std::string& filename)
+{
+    t_fileio*  fio    = gmx_trr_open(filename.c_str(), "r");
+    const auto frames = readFrames(fio, nullptr);
+    gmx_trr_close(fio);
+
+    return frames;
+}
+
+//! Test fixture for reading TRR frames from a mapping
+class TrrFrameReaderTest : public ::testing::Test
+{
+public:
+    TrrFrameReaderTest() : filename_(fileManager_.getTemporaryFilePath("frames.trr")) {}
+
+    //! Manages the temporary files
+    TestFileManager fileManager_;
+    //! The test trajectory
+    std::string filename_;
+};
+
+TEST_F(TrrFrameReaderTest, ReadsTheSameAsXdr)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+
+    t_fileio* fio    = gmx_trr_open(filename_.c_str(), "r");
+    auto      reader = TrrFrameReader::create(fio);
+    if (!HAVE_MMAP)
+    {
+        EXPECT_FALSE(reader);
+        gmx_trr_close(fio);
+        return;
+    }
+    ASSERT_TRUE(reader);
+    const auto frames = readFrames(fio, reader.get());
+    reader.reset();
+    gmx_trr_close(fio);
+
+    EXPECT_EQ(c_numFrames + 1, frames.size());
+    compareFrames(readFramesWithXdr(filename_), frames);
+}
+
+TEST_F(TrrFrameReaderTest, ReadsIncompleteLastFrameTheSameAsXdr)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+
+    /* Cut off parts of the last frame, as happens when mdrun is killed while writing.
+     * The cuts are ordered by decreasing size, since truncating to a larger size pads with zeros.
+     */
+    t_fileio* fio = gmx_trr_open(filename_.c_str(), "r");
+    for (int frame = 0; frame < c_numFrames - 1; frame++)
+    {
+        gmx_trr_header_t header;
+        gmx_bool         bOK;
+        ASSERT_TRUE(gmx_trr_read_frame_header(fio, &header, &bOK));
+        ASSERT_TRUE(gmx_trr_skip_frame_data(fio, &header));
+    }
+    const gmx_off_t lastFrameOffset = gmx_fio_ftell(fio);
+    gmx_trr_close(fio);
+    for (gmx_off_t cutOffset : { lastFrameOffset + 300, lastFrameOffset + 100, lastFrameOffset + 40 })
+    {
+        SCOPED_TRACE(formatString("Truncated at offset %ld", static_cast<long>(cutOffset)));
+        ASSERT_EQ(0, gmx_truncate(filename_, cutOffset));
+
+        fio                                    = gmx_trr_open(filename_.c_str(), "r");
+        std::unique_ptr<TrrFrameReader> reader = TrrFrameReader::create(fio);
+        const auto                      frames = readFrames(fio, reader.get());
+        reader.reset();
+        gmx_trr_close(fio);
+        compareFrames(readFramesWithXdr(filename_), frames);
+    }
+}
+
+TEST_F(TrrFrameReaderTest, ReadsFramesTruncatedAfterMapping)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+
+    /* Cut the file in the second frame, so the rest of the mapping, which
+     * spans multiple pages, is no longer backed by the file.
+     */
+    t_fileio*        fio = gmx_trr_open(filename_.c_str(), "r");
+    gmx_trr_header_t header;
+    gmx_bool         bOK;
+    ASSERT_TRUE(gmx_trr_read_frame_header(fio, &header, &bOK));
+    ASSERT_TRUE(gmx_trr_skip_frame_data(fio, &header));
+    const gmx_off_t secondFrameOffset = gmx_fio_ftell(fio);
+    gmx_trr_close(fio);
+
+    fio                                    = gmx_trr_open(filename_.c_str(), "r");
+    std::unique_ptr<TrrFrameReader> reader = TrrFrameReader::create(fio);
+    ASSERT_EQ(0, gmx_truncate(filename_, secondFrameOffset + 100));
+    const auto frames = readFrames(fio, reader.get());
+    reader.reset();
+    gmx_trr_close(fio);
+
+    EXPECT_EQ(2, frames.size());
+    compareFrames(readFramesWithXdr(filename_), frames);
+}
+
+TEST_F(TrrFrameReaderTest, ReadsFramesAppendedAfterMapping)
+{
+    writeFrames(filename_, "w", 0, c_numFrames / 2);
+
+    t_fileio*                       fio    = gmx_trr_open(filename_.c_str(), "r");
+    std::unique_ptr<TrrFrameReader> reader = TrrFrameReader::create(fio);
+    writeFrames(filename_, "a", c_numFrames / 2, c_numFrames);
+    const auto frames = readFrames(fio, reader.get());
+    reader.reset();
+    gmx_trr_close(fio);
+
+    EXPECT_EQ(c_numFrames + 1, frames.size());
+    compareFrames(readFramesWithXdr(filename_), frames);
+}
+
+TEST_F(TrrFrameReaderTest, SeeksToFrames)
+{
+    writeFrames(filename_, "w", 0, c_numFrames);
+    const auto referenceFrames = readFramesWithXdr(filename_);
+
+    t_fileio*                       fio    = gmx_trr_open(filename_.c_str(), "r");
+    std::unique_ptr<TrrFrameReader> reader = TrrFrameReader::create(fio);
+    if (!reader)
+    {
+        gmx_trr_close(fio);
+        return;
+    }
+    std::vector<gmx_off_t> frameOffsets;
+    for (int frame = 0; frame < c_numFrames; frame++)
+    {
+        frameOffsets.push_back(reader->fileOffset());
+        gmx_trr_header_t header;
+        gmx_bool         bOK;
+        ASSERT_TRUE(reader->readFrameHeader(&header, &bOK));
+        ASSERT_TRUE(reader->readFrameData(header, nullptr, nullptr, nullptr, nullptr));
+    }
+    reader->seek(frameOffsets[2]);
+    const auto frames = readFrames(fio, reader.get());
+    const std::vector<FrameReadResult> expectedFrames(referenceFrames.begin() + 2,
+                                                      referenceFrames.end());
+    compareFrames(expectedFrames, frames);
+
+    // After destroying the reader, XDR reading continues at the same offset
+    reader->seek(frameOffsets[4]);
+    const gmx_off_t offset = reader->fileOffset();
+    reader.reset();
+    ASSERT_EQ(0, gmx_fio_seek(fio, offset));
+    gmx_trr_header_t header;
+    gmx_bool         bOK;
+    ASSERT_TRUE(gmx_trr_read_frame_header(fio, &header, &bOK));
+    EXPECT_EQ(referenceFrames[4].header.step, header.step);
+    gmx_trr_close(fio);
+}
+
+//! Appends \p value to \p buffer in big-endian byte order
+template<typename T>
+void appendBigEndian(std::vector<char>* buffer, T value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+#if !GMX_INTEGER_BIG_ENDIAN
+    std::reverse(bytes, bytes + sizeof(T));
+#endif
+    buffer->insert(buffer->end(), bytes, bytes + sizeof(T));
+}
+
+TEST_F(TrrFrameReaderTest, ReadsDoublePrecisionFrames)
+{
+    // Double precision files can not be written by mixed precision
+    // builds, so we write the frames byte by byte
+    std::vector<char> buffer;
+    for (int frame = 0; frame < c_numFrames; frame++)
+    {
+        const bool haveV = (frame % 2 == 0);
+        appendBigEndian<int32_t>(&buffer, 1993);
+        appendBigEndian<int32_t>(&buffer, 13);
+        appendBigEndian<int32_t>(&buffer, 12);
+        const char version[] = "GMX_trn_file";
+        buffer.insert(buffer.end(), version, version + 12);
+        // The ir, e, box, vir, pres, top, sym, x, v, f and natoms fields
+        const int32_t vectorsSize = c_numAtoms * DIM * sizeof(double);
+        const int32_t boxSize     = DIM * DIM * sizeof(double);
+        const int32_t vSize       = haveV ? vectorsSize : 0;
+        const int32_t sizes[] = { 0, 0, boxSize, 0, 0, 0, 0, vectorsSize, vSize, 0, c_numAtoms };
+        for (int32_t size : sizes)
+        {
+            appendBigEndian<int32_t>(&buffer, size);
+        }
+        appendBigEndian<int32_t>(&buffer, 10 * frame);
+        appendBigEndian<int32_t>(&buffer, 0);
+        appendBigEndian<double>(&buffer, 0.1 * frame);
+        appendBigEndian<double>(&buffer, 0.3);
+        for (int i = 0; i < DIM * DIM + (haveV ? 2 : 1) * c_numAtoms * DIM; i++)
+        {
+            appendBigEndian<double>(&buffer, std::sqrt(3.0 + i + frame));
+        }
+    }
+    FILE* fp = std::fopen(filename_.c_str(), "wb");
+    ASSERT_NE(nullptr, fp);
+    ASSERT_EQ(buffer.size(), std::fwrite(buffer.data(), 1, buffer.size(), fp));
+    std::fclose(fp);
+
+    t_fileio*                       fio    = gmx_trr_open(filename_.c_str(), "r");
+    std::unique_ptr<TrrFrameReader> reader = TrrFrameReader::create(fio);
+    const auto                      frames = readFrames(fio, reader.get());
+    reader.reset();
+    gmx_trr_close(fio);
+
+    ASSERT_EQ(c_numFrames + 1, frames.size());
+    EXPECT_TRUE(frames[0].header.bDouble);
+    compareFrames(readFramesWithXdr(filename_), frames);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,563 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for XTC position compression, for frames with positions
+ * compressed in chunks and for decoding frames in parallel
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcio.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/xtcframereader.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/refdata.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms in the test frames
+constexpr int c_numAtoms = 1000;
+//! The compression precision
+constexpr real c_precision = 1000;
+//! The maximum deviation of positions after compression
+constexpr real c_tolerance = 0.51 / c_precision;
+
+//! Returns arbitrary positions inside a 3 nm box that depend on \p seed
+std::vector<RVec> makePositions(int seed)
+{
+    std::vector<RVec> x(c_numAtoms);
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            x[i][d] = 1.5_real + 1.4_real * std::sin(0.37_real * (i + seed) + 1.1_real * d);
+        }
+    }
+    return x;
+}
+
+//! The kinds of systems to test compression with
+enum class CompressionSystem
+{
+    Water,         //!< Water molecules, which use the run-length encoding and atom swapping
+    NegativeWater, //!< Water molecules centered at the origin
+    Chain,         //!< A chain of atoms with fixed bond lengths
+    Sparse,        //!< Random positions, so no run-length encoding can be used
+    WideRange,     //!< Ranges that are too large to be multiplied, with some close pairs
+    LargeRange,    //!< Ranges close to the limit for multiplying, with some close pairs
+};
+
+//! Parameters of the compression tests
+struct CompressionTestParameters
+{
+    //! The kind of system
+    CompressionSystem system;
+    //! The number of atoms
+    int numAtoms;
+    //! The compression precision
+    float precision;
+};
+
+//! Returns positions for \p parameters, generated in single precision
+std::vector<RVec> makeSystem(const CompressionTestParameters& parameters)
+{
+    DefaultRandomEngine            rng(2021);
+    UniformRealDistribution<float> dist(0, 1);
+
+    std::vector<RVec> x(parameters.numAtoms);
+    for (int i = 0; i < parameters.numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            float value = 0;
+            switch (parameters.system)
+            {
+                case CompressionSystem::Water:
+                case CompressionSystem::NegativeWater:
+                    if (i % 3 == 0)
+                    {
+                        value = 3 * dist(rng);
+                        if (parameters.system == CompressionSystem::NegativeWater)
+                        {
+                            value -= 1.5F;
+                        }
+                    }
+                    else
+                    {
+                        value = static_cast<float>(x[i - i % 3][d]) + 0.1F * (dist(rng) - 0.5F);
+                    }
+                    break;
+                case CompressionSystem::Chain:
+                    value = (i == 0 ? 1.0F : static_cast<float>(x[i - 1][d]))
+                            + 0.087F * (2 * dist(rng) - 1);
+                    break;
+                case CompressionSystem::Sparse: value = 50 * dist(rng); break;
+                case CompressionSystem::WideRange:
+                case CompressionSystem::LargeRange:
+                    if (i % 10 == 9)
+                    {
+                        value = static_cast<float>(x[i - 1][d]) + 0.002F * (dist(rng) - 0.5F);
+                    }
+                    else if (parameters.system == CompressionSystem::WideRange)
+                    {
+                        value = 100 * dist(rng) - 20;
+                    }
+                    else
+                    {
+                        value = 0.5F + 14 * dist(rng);
+                    }
+                    break;
+            }
+            x[i][d] = value;
+        }
+    }
+
+    return x;
+}
+
+//! Returns \p data as hexadecimal text, in lines of 32 bytes
+std::string toHexText(const std::vector<char>& data)
+{
+    std::string text;
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        text += formatString("%02x", static_cast<unsigned char>(data[i]));
+        if (i % 32 == 31 || i + 1 == data.size())
+        {
+            text += "\n";
+        }
+    }
+    return text;
+}
+
+class XtcCompressionTest : public ::testing::TestWithParam<CompressionTestParameters>
+{
+};
+
+TEST_P(XtcCompressionTest, EncodingIsUnchanged)
+{
+    const CompressionTestParameters parameters = GetParam();
+    const std::vector<RVec>         x          = makeSystem(parameters);
+
+    std::vector<char> compressed;
+    ASSERT_EQ(1, xtc_compress_positions(parameters.numAtoms, as_rvec_array(x.data()),
+                                        parameters.precision, &compressed));
+
+    // The compressed data has been checked against the encoder before
+    // it was optimized, which XTC readers elsewhere should expect
+    TestReferenceData    refData;
+    TestReferenceChecker checker(refData.rootChecker());
+    checker.checkInteger(compressed.size(), "Size");
+    checker.checkTextBlock(toHexText(compressed), "Compressed");
+
+    // Check the decoder
+    TestFileManager   fileManager;
+    const std::string filename = fileManager.getTemporaryFilePath("compressed.xtc");
+    matrix    box = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+    t_fileio* fio = open_xtc(filename.c_str(), "w");
+    ASSERT_EQ(1, write_xtc_chunked(fio, parameters.numAtoms, 0, 0, box, 1, compressed.data(),
+                                   compressed.size()));
+    close_xtc(fio);
+
+    int      natoms;
+    int64_t  step;
+    real     time;
+    rvec*    xRead;
+    real     precision;
+    gmx_bool bOK;
+    fio = open_xtc(filename.c_str(), "r");
+    ASSERT_EQ(1, read_first_xtc(fio, &natoms, &step, &time, box, &xRead, &precision, &bOK));
+    EXPECT_EQ(parameters.precision, precision);
+    for (int i = 0; i < parameters.numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            // Allow for rounding of the decoded positions to float
+            const real tolerance = 0.51 / precision + 2 * std::abs(x[i][d]) * GMX_FLOAT_EPS;
+            EXPECT_NEAR(x[i][d], xRead[i][d], tolerance) << "atom " << i << " dim " << d;
+        }
+    }
+    sfree(xRead);
+    close_xtc(fio);
+}
+
+//! The systems to test compression with
+const CompressionTestParameters c_compressionSystems[] = {
+    { CompressionSystem::Water, 300, 1000 },   { CompressionSystem::NegativeWater, 300, 1000 },
+    { CompressionSystem::Chain, 200, 1000 },   { CompressionSystem::Sparse, 100, 10000 },
+    { CompressionSystem::WideRange, 100, 1e6 }, { CompressionSystem::LargeRange, 100, 1e6 }
+};
+
+INSTANTIATE_TEST_CASE_P(WithSystems, XtcCompressionTest, ::testing::ValuesIn(c_compressionSystems));
+
+
+//! Writes \p x as a chunked frame, with chunks of the sizes in \p chunkSizes
+void writeChunkedFrame(t_fileio*                fio,
+                       int64_t                  step,
+                       const matrix             box,
+                       const std::vector<RVec>& x,
+                       const std::vector<int>&  chunkSizes)
+{
+    std::vector<char> chunkData;
+    int               offset = 0;
+    for (int chunkSize : chunkSizes)
+    {
+        std::vector<char> chunk;
+        ASSERT_EQ(1, xtc_compress_positions(chunkSize, as_rvec_array(x.data()) + offset,
+                                            c_precision, &chunk));
+        chunkData.insert(chunkData.end(), chunk.begin(), chunk.end());
+        offset += chunkSize;
+    }
+    ASSERT_EQ(c_numAtoms, offset);
+    ASSERT_EQ(1, write_xtc_chunked(fio, c_numAtoms, step, step * 0.1_real, box, chunkSizes.size(),
+                                   chunkData.data(), chunkData.size()));
+}
+
+class XtcChunkedFrameTest : public ::testing::Test
+{
+public:
+    TestFileManager fileManager_;
+    //! A box, the values matter only for comparing
+    matrix box_ = { { 3, 0, 0 }, { 0, 3.1, 0 }, { 0.2, 0.3, 3.2 } };
+};
+
+TEST_F(XtcChunkedFrameTest, ReadsTheSameAsNormalFrame)
+{
+    const std::vector<RVec> x = makePositions(0);
+
+    const std::string normalFilename  = fileManager_.getTemporaryFilePath("normal.xtc");
+    const std::string chunkedFilename = fileManager_.getTemporaryFilePath("chunked.xtc");
+
+    t_fileio* fio = open_xtc(normalFilename.c_str(), "w");
+    ASSERT_EQ(1, write_xtc(fio, c_numAtoms, 3, 0.3_real, box_, as_rvec_array(x.data()),
+                           c_precision));
+    close_xtc(fio);
+    fio = open_xtc(chunkedFilename.c_str(), "w");
+    // Chunks of up to 9 atoms are stored uncompressed, so we avoid those here
+    writeChunkedFrame(fio, 3, box_, x, { 0, 400, 600 });
+    close_xtc(fio);
+
+    std::vector<std::vector<RVec>> xRead;
+    for (const std::string& filename : { normalFilename, chunkedFilename })
+    {
+        int      natoms;
+        int64_t  step;
+        real     time;
+        matrix   box;
+        rvec*    xTmp;
+        real     precision;
+        gmx_bool bOK;
+
+        fio = open_xtc(filename.c_str(), "r");
+        ASSERT_EQ(1, read_first_xtc(fio, &natoms, &step, &time, box, &xTmp, &precision, &bOK));
+        EXPECT_TRUE(bOK);
+        EXPECT_EQ(c_numAtoms, natoms);
+        EXPECT_EQ(3, step);
+        EXPECT_FLOAT_EQ(0.3, time);
+        EXPECT_FLOAT_EQ(c_precision, precision);
+        for (int d1 = 0; d1 < DIM; d1++)
+        {
+            for (int d2 = 0; d2 < DIM; d2++)
+            {
+                EXPECT_EQ(box_[d1][d2], box[d1][d2]);
+            }
+        }
+        xRead.emplace_back(xTmp, xTmp + natoms);
+        sfree(xTmp);
+        close_xtc(fio);
+    }
+
+    // Compression quantizes each position independently of the others
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_EQ(xRead[0][i][d], xRead[1][i][d]) << "atom " << i << " dim " << d;
+            EXPECT_NEAR(x[i][d], xRead[1][i][d], c_tolerance);
+        }
+    }
+}
+
+TEST_F(XtcChunkedFrameTest, ReadsMixedFrames)
+{
+    const std::string filename = fileManager_.getTemporaryFilePath("mixed.xtc");
+
+    t_fileio* fio = open_xtc(filename.c_str(), "w");
+    for (int step = 0; step < 4; step++)
+    {
+        const std::vector<RVec> x = makePositions(step);
+        if (step % 2 == 0)
+        {
+            ASSERT_EQ(1, write_xtc(fio, c_numAtoms, step, step * 0.1_real, box_,
+                                   as_rvec_array(x.data()), c_precision));
+        }
+        else
+        {
+            // Include a chunk small enough to be stored uncompressed
+            writeChunkedFrame(fio, step, box_, x, { 5, 333, 662 });
+        }
+    }
+    close_xtc(fio);
+
+    int      natoms;
+    int64_t  step;
+    real     time;
+    matrix   box;
+    rvec*    x;
+    real     precision;
+    gmx_bool bOK;
+
+    fio = open_xtc(filename.c_str(), "r");
+    int numFrames = read_first_xtc(fio, &natoms, &step, &time, box, &x, &precision, &bOK);
+    ASSERT_EQ(1, numFrames);
+    bool haveFrame = true;
+    while (haveFrame)
+    {
+        EXPECT_TRUE(bOK);
+        EXPECT_EQ(numFrames - 1, step);
+        const std::vector<RVec> xRef = makePositions(step);
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_NEAR(xRef[i][d], x[i][d], c_tolerance);
+            }
+        }
+        haveFrame = (read_next_xtc(fio, natoms, &step, &time, box, x, &precision, &bOK) != 0);
+        numFrames += haveFrame ? 1 : 0;
+    }
+    EXPECT_EQ(4, numFrames);
+    sfree(x);
+    close_xtc(fio);
+}
+
+TEST_F(XtcChunkedFrameTest, RejectsChunkWithTooManyAtoms)
+{
+    const std::vector<RVec> x = makePositions(0);
+
+    // The second chunk claims more atoms than remain in the frame
+    for (int corruptNatoms : { 601, 100000, -1 })
+    {
+        SCOPED_TRACE(formatString("Second chunk with %d atoms", corruptNatoms));
+
+        std::vector<char> firstChunk;
+        std::vector<char> secondChunk;
+        ASSERT_EQ(1,
+                  xtc_compress_positions(400, as_rvec_array(x.data()), c_precision, &firstChunk));
+        ASSERT_EQ(1, xtc_compress_positions(600, as_rvec_array(x.data()) + 400, c_precision,
+                                            &secondChunk));
+        // The number of atoms is the first, big-endian, integer of a chunk
+        const auto value = static_cast<uint32_t>(corruptNatoms);
+        for (int i = 0; i < 4; i++)
+        {
+            secondChunk[i] = static_cast<char>((value >> (8 * (3 - i))) & 0xff);
+        }
+        std::vector<char> chunkData = firstChunk;
+        chunkData.insert(chunkData.end(), secondChunk.begin(), secondChunk.end());
+
+        const std::string filename = fileManager_.getTemporaryFilePath("corrupt.xtc");
+        t_fileio*         fio      = open_xtc(filename.c_str(), "w");
+        ASSERT_EQ(1, write_xtc_chunked(fio, c_numAtoms, 0, 0, box_, 2, chunkData.data(),
+                                       chunkData.size()));
+        close_xtc(fio);
+
+        int      natoms;
+        int64_t  step;
+        real     time;
+        matrix   box;
+        rvec*    xRead;
+        real     precision;
+        gmx_bool bOK;
+
+        fio = open_xtc(filename.c_str(), "r");
+        EXPECT_EQ(0, read_first_xtc(fio, &natoms, &step, &time, box, &xRead, &precision, &bOK));
+        EXPECT_FALSE(bOK);
+        sfree(xRead);
+        close_xtc(fio);
+    }
+}
+
+class XtcFrameReaderTest : public ::testing::TestWithParam<int>
+{
+public:
+    //! Writes a file with \p numFrames alternating normal and chunked frames
+    void writeMixedFrames(const std::string& filename, int numFrames)
+    {
+        t_fileio* fio = open_xtc(filename.c_str(), "w");
+        for (int step = 0; step < numFrames; step++)
+        {
+            const std::vector<RVec> x = makePositions(step);
+            if (step % 2 == 0)
+            {
+                ASSERT_EQ(1, write_xtc(fio, c_numAtoms, step, step * 0.1_real, box_,
+                                       as_rvec_array(x.data()), c_precision));
+            }
+            else
+            {
+                writeChunkedFrame(fio, step, box_, x, { 5, 333, 662 });
+            }
+        }
+        close_xtc(fio);
+    }
+
+    TestFileManager fileManager_;
+    //! A box, the values matter only for comparing
+    matrix box_ = { { 3, 0, 0 }, { 0, 3.1, 0 }, { 0.2, 0.3, 3.2 } };
+};
+
+TEST_P(XtcFrameReaderTest, ReadsTheSameAsSerialReading)
+{
+    const int         numThreads = GetParam();
+    const int         numFrames  = 11;
+    const std::string filename   = fileManager_.getTemporaryFilePath("frames.xtc");
+    writeMixedFrames(filename, numFrames);
+
+    int      natoms;
+    int64_t  step;
+    real     time;
+    matrix   box;
+    rvec*    x;
+    real     precision;
+    gmx_bool bOK;
+
+    // Read all frames serially as reference
+    std::vector<int64_t>           stepsRef;
+    std::vector<std::vector<RVec>> xRef;
+    t_fileio*                      fio = open_xtc(filename.c_str(), "r");
+    bool haveFrame = (read_first_xtc(fio, &natoms, &step, &time, box, &x, &precision, &bOK) != 0);
+    while (haveFrame)
+    {
+        stepsRef.push_back(step);
+        xRef.emplace_back(x, x + natoms);
+        haveFrame = (read_next_xtc(fio, natoms, &step, &time, box, x, &precision, &bOK) != 0);
+    }
+    close_xtc(fio);
+    ASSERT_EQ(numFrames, static_cast<int>(stepsRef.size()));
+
+    fio = open_xtc(filename.c_str(), "r");
+    ASSERT_EQ(1, read_first_xtc(fio, &natoms, &step, &time, box, &x, &precision, &bOK));
+    int numFramesRead = 1;
+    {
+        XtcFrameReader reader(fio, natoms, numThreads);
+        // Read part of the frames, so other frames are still being decoded
+        for (; numFramesRead < numFrames / 2; numFramesRead++)
+        {
+            ASSERT_EQ(1, reader.readNextFrame(&step, &time, box, x, &precision, &bOK));
+            EXPECT_TRUE(bOK);
+            EXPECT_EQ(stepsRef[numFramesRead], step);
+            EXPECT_FLOAT_EQ(step * 0.1_real, time);
+            EXPECT_FLOAT_EQ(c_precision, precision);
+            for (int d1 = 0; d1 < DIM; d1++)
+            {
+                for (int d2 = 0; d2 < DIM; d2++)
+                {
+                    EXPECT_EQ(box_[d1][d2], box[d1][d2]);
+                }
+            }
+            for (int i = 0; i < c_numAtoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_EQ(xRef[numFramesRead][i][d], x[i][d]);
+                }
+            }
+        }
+        ASSERT_EQ(0, gmx_fio_seek(fio, reader.fileOffset()));
+    }
+
+    // Continue reading serially after the last frame returned by the reader
+    while (read_next_xtc(fio, natoms, &step, &time, box, x, &precision, &bOK) != 0)
+    {
+        EXPECT_EQ(stepsRef[numFramesRead], step);
+        numFramesRead++;
+    }
+    EXPECT_TRUE(bOK);
+    EXPECT_EQ(numFrames, numFramesRead);
+    sfree(x);
+    close_xtc(fio);
+
+    // Read all frames with a reader until the end of the file
+    fio = open_xtc(filename.c_str(), "r");
+    {
+        XtcFrameReader reader(fio, natoms, numThreads);
+        numFramesRead = 0;
+        snew(x, natoms);
+        while (reader.readNextFrame(&step, &time, box, x, &precision, &bOK) != 0)
+        {
+            EXPECT_EQ(stepsRef[numFramesRead], step);
+            for (int i = 0; i < c_numAtoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_EQ(xRef[numFramesRead][i][d], x[i][d]);
+                }
+            }
+            numFramesRead++;
+        }
+        EXPECT_TRUE(bOK);
+        EXPECT_EQ(numFrames, numFramesRead);
+        sfree(x);
+    }
+    close_xtc(fio);
+}
+
+INSTANTIATE_TEST_CASE_P(WithThreads, XtcFrameReaderTest, ::testing::Values(1, 3));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -132,6 +132,7 @@ enum tpxv
     tpxv_AddSizeField, /**< Added field with information about the size of the serialized tpr file in bytes, excluding the header */
     tpxv_StoreNonBondedInteractionExclusionGroup, /**< Store the non bonded interaction exclusion group in the topology */
     tpxv_VSite1,                                  /**< Added 1 type virtual site */
+    tpxv_MultipleTimeStepping,                    /**< Added multiple time stepping settings */
     tpxv_Count                                    /**< the total number of tpxv versions */
 };
 
@@ -1082,6 +1083,29 @@ static void do_inputrec(gmx::ISerializer* serializer, t_inputrec* ir, int file_v
 
     serializer->doInt(&ir->simulation_part);
 
+    if (file_version >= tpxv_MultipleTimeStepping)
+    {
+        serializer->doBool(&ir->useMts);
+        int numMtsLevels = gmx::c_numMtsLevels;
+        serializer->doInt(&numMtsLevels);
+        if (numMtsLevels != gmx::c_numMtsLevels)
+        {
+            gmx_fatal(FARGS, "This version of GROMACS only supports %d MTS levels, tpr file has %d",
+                      gmx::c_numMtsLevels, numMtsLevels);
+        }
+        for (gmx::MtsLevel& mtsLevel : ir->mtsLevels)
+        {
+            int forceGroups = static_cast<int>(mtsLevel.forceGroups.to_ulong());
+            serializer->doInt(&forceGroups);
+            mtsLevel.forceGroups = forceGroups;
+            serializer->doInt(&mtsLevel.stepFactor);
+        }
+    }
+    else
+    {
+        ir->useMts = false;
+    }
+
     if (file_version >= 67)
     {
         serializer->doInt(&ir->nstcalcenergy);
@@ -0,0 +1,470 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Implements the frame index of XTC and TRR trajectory files
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "trajectoryframeindex.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "gromacs/fileio/filetypes.h"
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/utility/fileptr.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/inmemoryserializer.h"
+#include "gromacs/utility/sysinfo.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The identifier at the start of frame index files
+const char c_indexFileMagic[] = "GMXFIDX";
+//! The version of the frame index file format
+constexpr int32_t c_indexFileVersion = 1;
+//! The size of the index file header in bytes
+constexpr size_t c_indexFileHeaderSize =
+        sizeof(c_indexFileMagic) + sizeof(int32_t) + 4 * sizeof(int64_t);
+//! The size of an entry in the index file in bytes
+constexpr size_t c_indexFileEntrySize = 3 * sizeof(int64_t) + sizeof(int32_t);
+
+//! Flags for the contents of frames stored in index files
+enum : int32_t
+{
+    c_frameHasX     = 1 << 0,
+    c_frameHasV     = 1 << 1,
+    c_frameHasF     = 1 << 2,
+    c_frameIsDouble = 1 << 3
+};
+
+/*! \brief Determines the size and modification time of \p filename
+ *
+ * Returns whether this succeeded.
+ */
+bool getFileSizeAndModificationTime(const std::string& filename, gmx_off_t* size,
+                                    int64_t* modificationTime)
+{
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0)
+    {
+        return false;
+    }
+    *size             = info.st_size;
+    *modificationTime = static_cast<int64_t>(info.st_mtime);
+
+    return true;
+}
+
+//! Reads the index file \p indexFilename, returns nullptr when it does not exist or is invalid
+std::unique_ptr<TrajectoryFrameIndex> readIndexFile(const std::string& indexFilename)
+{
+    FilePtr fp(std::fopen(indexFilename.c_str(), "rb"));
+    if (!fp)
+    {
+        return nullptr;
+    }
+    std::vector<char> buffer;
+    char              block[4096];
+    size_t            numRead;
+    while ((numRead = std::fread(block, 1, sizeof(block), fp.get())) > 0)
+    {
+        buffer.insert(buffer.end(), block, block + numRead);
+    }
+    if (buffer.size() < c_indexFileHeaderSize)
+    {
+        return nullptr;
+    }
+
+    InMemoryDeserializer deserializer(buffer, false, EndianSwapBehavior::SwapIfHostIsBigEndian);
+    char                 magic[sizeof(c_indexFileMagic)];
+    int32_t              version;
+    int64_t              fileSize, modificationTime, endOffset, numFrames;
+    deserializer.doOpaque(magic, sizeof(magic));
+    deserializer.doInt32(&version);
+    deserializer.doInt64(&fileSize);
+    deserializer.doInt64(&modificationTime);
+    deserializer.doInt64(&endOffset);
+    deserializer.doInt64(&numFrames);
+    if (std::memcmp(magic, c_indexFileMagic, sizeof(magic)) != 0 || version != c_indexFileVersion
+        || numFrames < 0
+        || buffer.size() != c_indexFileHeaderSize + numFrames * c_indexFileEntrySize)
+    {
+        return nullptr;
+    }
+
+    std::vector<TrajectoryFrameIndexEntry> frames(numFrames);
+    gmx_off_t                              previousOffset = -1;
+    for (TrajectoryFrameIndexEntry& frame : frames)
+    {
+        int64_t offset;
+        int32_t flags;
+        deserializer.doInt64(&offset);
+        deserializer.doInt64(&frame.step);
+        deserializer.doDouble(&frame.time);
+        deserializer.doInt32(&flags);
+        if (offset <= previousOffset)
+        {
+            return nullptr;
+        }
+        frame.offset   = offset;
+        frame.haveX    = (flags & c_frameHasX) != 0;
+        frame.haveV    = (flags & c_frameHasV) != 0;
+        frame.haveF    = (flags & c_frameHasF) != 0;
+        frame.isDouble = (flags & c_frameIsDouble) != 0;
+        previousOffset = offset;
+    }
+    if (endOffset <= previousOffset || endOffset > fileSize)
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<TrajectoryFrameIndex>(std::move(frames), endOffset, fileSize,
+                                                  modificationTime);
+}
+
+/*! \brief Writes \p index to the index file \p indexFilename
+ *
+ * The file is first written under a temporary name, so other processes
+ * never read a partially written index. As the index can always be
+ * rebuilt, failure to write, e.g. in a read-only directory, is ignored.
+ */
+void writeIndexFile(const std::string& indexFilename, const TrajectoryFrameIndex& index)
+{
+    InMemorySerializer serializer(EndianSwapBehavior::SwapIfHostIsBigEndian);
+    char               magic[sizeof(c_indexFileMagic)];
+    std::memcpy(magic, c_indexFileMagic, sizeof(magic));
+    int32_t version          = c_indexFileVersion;
+    int64_t fileSize         = index.fileSize();
+    int64_t modificationTime = index.modificationTime();
+    int64_t endOffset        = index.frameOffset(index.numFrames());
+    int64_t numFrames        = index.numFrames();
+    serializer.doOpaque(magic, sizeof(magic));
+    serializer.doInt32(&version);
+    serializer.doInt64(&fileSize);
+    serializer.doInt64(&modificationTime);
+    serializer.doInt64(&endOffset);
+    serializer.doInt64(&numFrames);
+    for (TrajectoryFrameIndexEntry frame : index.frames())
+    {
+        int64_t offset = frame.offset;
+        int32_t flags  = (frame.haveX ? c_frameHasX : 0) | (frame.haveV ? c_frameHasV : 0)
+                        | (frame.haveF ? c_frameHasF : 0) | (frame.isDouble ? c_frameIsDouble : 0);
+        serializer.doInt64(&offset);
+        serializer.doInt64(&frame.step);
+        serializer.doDouble(&frame.time);
+        serializer.doInt32(&flags);
+    }
+    const std::vector<char> buffer = serializer.finishAndGetBuffer();
+
+    const std::string tmpFilename = indexFilename + "." + std::to_string(gmx_getpid()) + ".tmp";
+    bool              written     = false;
+    {
+        FilePtr fp(std::fopen(tmpFilename.c_str(), "wb"));
+        if (fp)
+        {
+            written = (std::fwrite(buffer.data(), 1, buffer.size(), fp.get()) == buffer.size());
+            written = (std::fclose(fp.release()) == 0) && written;
+        }
+    }
+    if (!written || gmx_file_rename(tmpFilename.c_str(), indexFilename.c_str()) != 0)
+    {
+        std::remove(tmpFilename.c_str());
+    }
+}
+
+/*! \brief Reads the header of the frame at the current position in \p fio and skips its data
+ *
+ * Returns whether a complete frame was found, with the end of the frame
+ * before \p fileSize, and the frame and the offset after it.
+ */
+bool skipFrame(t_fileio*                  fio,
+               int                        fileType,
+               gmx_off_t                  fileSize,
+               TrajectoryFrameIndexEntry* frame,
+               gmx_off_t*                 endOffset)
+{
+    gmx_bool bOK;
+
+    frame->offset = gmx_fio_ftell(fio);
+    if (fileType == efXTC)
+    {
+        int  natoms;
+        real time;
+        if (!xtc_skip_frame(fio, &natoms, &frame->step, &time, &bOK))
+        {
+            return false;
+        }
+        frame->time     = time;
+        frame->haveX    = true;
+        frame->haveV    = false;
+        frame->haveF    = false;
+        frame->isDouble = false;
+    }
+    else
+    {
+        gmx_trr_header_t header;
+        if (!gmx_trr_read_frame_header(fio, &header, &bOK)
+            || !gmx_trr_skip_frame_data(fio, &header))
+        {
+            return false;
+        }
+        frame->step     = header.step;
+        frame->time     = header.t;
+        frame->haveX    = (header.x_size > 0);
+        frame->haveV    = (header.v_size > 0);
+        frame->haveF    = (header.f_size > 0);
+        frame->isDouble = header.bDouble;
+    }
+    *endOffset = gmx_fio_ftell(fio);
+
+    return *endOffset <= fileSize;
+}
+
+/*! \brief Adds the frames of \p filename starting at \p startOffset to \p frames
+ *
+ * Returns the offset after the last complete frame.
+ */
+gmx_off_t scanFrames(const std::string&                      filename,
+                     gmx_off_t                               startOffset,
+                     gmx_off_t                               fileSize,
+                     std::vector<TrajectoryFrameIndexEntry>* frames)
+{
+    const int fileType  = fn2ftp(filename.c_str());
+    t_fileio* fio       = gmx_fio_open(filename.c_str(), "r");
+    gmx_off_t endOffset = startOffset;
+    if (gmx_fio_seek(fio, startOffset) == 0)
+    {
+        TrajectoryFrameIndexEntry frame;
+        gmx_off_t                 frameEndOffset;
+        while (skipFrame(fio, fileType, fileSize, &frame, &frameEndOffset))
+        {
+            frames->push_back(frame);
+            endOffset = frameEndOffset;
+        }
+    }
+    gmx_fio_close(fio);
+
+    return endOffset;
+}
+
+/*! \brief Returns whether the last frame of \p index is still present unchanged in \p filename
+ *
+ * This is used to check that frames have only been appended to a trajectory.
+ */
+bool lastFrameIsUnchanged(const std::string&          filename,
+                          const TrajectoryFrameIndex& index,
+                          gmx_off_t                   fileSize)
+{
+    if (index.numFrames() == 0 || index.fileSize() > fileSize)
+    {
+        return false;
+    }
+    const TrajectoryFrameIndexEntry& lastFrame = index.frames().back();
+
+    const int fileType    = fn2ftp(filename.c_str());
+    t_fileio* fio         = gmx_fio_open(filename.c_str(), "r");
+    bool      isUnchanged = false;
+    if (gmx_fio_seek(fio, lastFrame.offset) == 0)
+    {
+        TrajectoryFrameIndexEntry frame;
+        gmx_off_t                 endOffset;
+        isUnchanged = (skipFrame(fio, fileType, fileSize, &frame, &endOffset)
+                       && frame.step == lastFrame.step && frame.time == lastFrame.time
+                       && endOffset == index.frameOffset(index.numFrames()));
+    }
+    gmx_fio_close(fio);
+
+    return isUnchanged;
+}
+
+} // namespace
+
+TrajectoryFrameIndex::TrajectoryFrameIndex(std::vector<TrajectoryFrameIndexEntry> frames,
+                                           gmx_off_t                              endOffset,
+                                           gmx_off_t                              fileSize,
+                                           int64_t modificationTime) :
+    frames_(std::move(frames)),
+    endOffset_(endOffset),
+    fileSize_(fileSize),
+    modificationTime_(modificationTime)
+{
+}
+
+gmx_off_t TrajectoryFrameIndex::frameOffset(int64_t frame) const
+{
+    GMX_ASSERT(frame >= 0 && frame <= numFrames(), "frame should be in range");
+
+    return (frame < numFrames() ? frames_[frame].offset : endOffset_);
+}
+
+int64_t TrajectoryFrameIndex::frameAtOffset(gmx_off_t offset) const
+{
+    if (offset == endOffset_)
+    {
+        return numFrames();
+    }
+    const auto startsBefore = [](const TrajectoryFrameIndexEntry& entry, gmx_off_t value) {
+        return entry.offset < value;
+    };
+    const auto frame = std::lower_bound(frames_.begin(), frames_.end(), offset, startsBefore);
+
+    return (frame != frames_.end() && frame->offset == offset) ? frame - frames_.begin() : -1;
+}
+
+bool frameIndexIsSupported(const std::string& filename)
+{
+    const int fileType = fn2ftp(filename.c_str());
+
+    return (fileType == efXTC || fileType == efTRR)
+           && std::getenv("GMX_NO_TRAJECTORY_FRAME_INDEX") == nullptr;
+}
+
+std::string frameIndexFileName(const std::string& filename)
+{
+    return filename + ".fidx";
+}
+
+std::unique_ptr<TrajectoryFrameIndex> loadTrajectoryFrameIndex(const std::string& filename)
+{
+    gmx_off_t fileSize;
+    int64_t   modificationTime;
+    if (!frameIndexIsSupported(filename)
+        || !getFileSizeAndModificationTime(filename, &fileSize, &modificationTime))
+    {
+        return nullptr;
+    }
+
+    const std::string indexFilename = frameIndexFileName(filename);
+
+    std::unique_ptr<TrajectoryFrameIndex> index = readIndexFile(indexFilename);
+    if (index && index->fileSize() == fileSize && index->modificationTime() == modificationTime)
+    {
+        return index;
+    }
+
+    std::vector<TrajectoryFrameIndexEntry> frames;
+    gmx_off_t                              startOffset = 0;
+    if (index && lastFrameIsUnchanged(filename, *index, fileSize))
+    {
+        // Frames have been appended, so we only need to index the new frames
+        frames.assign(index->frames().begin(), index->frames().end());
+        startOffset = index->frameOffset(index->numFrames());
+    }
+    const gmx_off_t endOffset = scanFrames(filename, startOffset, fileSize, &frames);
+
+    index = std::make_unique<TrajectoryFrameIndex>(std::move(frames), endOffset, fileSize,
+                                                   modificationTime);
+    writeIndexFile(indexFilename, *index);
+
+    return index;
+}
+
+std::pair<int64_t, int64_t> frameRangeOfPart(int64_t numFrames, int part, int numParts)
+{
+    GMX_RELEASE_ASSERT(numFrames >= 0 && numParts > 0 && part >= 0 && part < numParts,
+                       "Need a valid part");
+
+    return { (numFrames * part) / numParts, (numFrames * (part + 1)) / numParts };
+}
+
+TrajectoryFrameIndexRecorder::TrajectoryFrameIndexRecorder(const std::string& filename,
+                                                           bool               appending) :
+    filename_(filename)
+{
+    gmx_off_t fileSize;
+    int64_t   modificationTime;
+    if (!appending || !getFileSizeAndModificationTime(filename, &fileSize, &modificationTime)
+        || fileSize == 0)
+    {
+        return;
+    }
+
+    /* The index file describes the file before it was truncated for
+     * appending, the frames before the truncation point are unchanged.
+     * As the file is truncated at the end of a frame, the truncation
+     * point should be the start of an indexed frame or the end of the
+     * last indexed frame.
+     */
+    const std::unique_ptr<TrajectoryFrameIndex> index = readIndexFile(frameIndexFileName(filename));
+    const int64_t numFramesToKeep = (index ? index->frameAtOffset(fileSize) : -1);
+    if (numFramesToKeep >= 0)
+    {
+        frames_.assign(index->frames().begin(), index->frames().begin() + numFramesToKeep);
+        endOffset_ = fileSize;
+    }
+    else
+    {
+        haveAllFrames_ = false;
+    }
+}
+
+void TrajectoryFrameIndexRecorder::addFrame(const TrajectoryFrameIndexEntry& frame,
+                                            gmx_off_t                        endOffset)
+{
+    frames_.push_back(frame);
+    frames_.back().offset = endOffset_;
+    endOffset_            = endOffset;
+}
+
+void TrajectoryFrameIndexRecorder::writeIndexFile() const
+{
+    gmx_off_t fileSize;
+    int64_t   modificationTime;
+    if (!haveAllFrames_ || !getFileSizeAndModificationTime(filename_, &fileSize, &modificationTime)
+        || fileSize != endOffset_)
+    {
+        return;
+    }
+
+    gmx::writeIndexFile(frameIndexFileName(filename_),
+                        TrajectoryFrameIndex(frames_, endOffset_, fileSize, modificationTime));
+}
+
+} // namespace gmx
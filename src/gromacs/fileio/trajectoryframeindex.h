@@ -0,0 +1,209 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief Declares the frame index of XTC and TRR trajectory files
+ *
+ * The frame index stores the file offset, step and time of each frame
+ * of a trajectory, so frames can be accessed directly instead of by
+ * reading all preceding frames. The index is stored in a file next to
+ * the trajectory, which is valid as long as the size and modification
+ * time of the trajectory match those stored in the index file.
+ *
+ * \ingroup module_fileio
+ * \inlibraryapi
+ */
+#ifndef GMX_FILEIO_TRAJECTORYFRAMEINDEX_H
+#define GMX_FILEIO_TRAJECTORYFRAMEINDEX_H
+
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/futil.h"
+
+namespace gmx
+{
+
+//! The location and contents of a frame in a trajectory file
+struct TrajectoryFrameIndexEntry
+{
+    //! The file offset of the start of the frame
+    gmx_off_t offset;
+    //! The step
+    int64_t step;
+    //! The time, as stored in the file
+    double time;
+    //! Whether the frame contains positions
+    bool haveX;
+    //! Whether the frame contains velocities
+    bool haveV;
+    //! Whether the frame contains forces
+    bool haveF;
+    //! Whether the frame is stored in double precision
+    bool isDouble;
+};
+
+/*! \libinternal
+ * \brief The frame index of an XTC or TRR trajectory file
+ */
+class TrajectoryFrameIndex
+{
+public:
+    /*! \brief Constructs an index of \p frames, with the end of the last
+     * frame at \p endOffset, of a file with size \p fileSize and
+     * modification time \p modificationTime
+     */
+    TrajectoryFrameIndex(std::vector<TrajectoryFrameIndexEntry> frames,
+                         gmx_off_t                              endOffset,
+                         gmx_off_t                              fileSize,
+                         int64_t                                modificationTime);
+
+    //! Returns the frames in the order they are stored in the file
+    ArrayRef<const TrajectoryFrameIndexEntry> frames() const { return frames_; }
+
+    //! Returns the number of frames
+    int64_t numFrames() const { return static_cast<int64_t>(frames_.size()); }
+
+    /*! \brief Returns the file offset of frame \p frame
+     *
+     * For \p frame equal to the number of frames, returns the offset
+     * after the last frame.
+     */
+    gmx_off_t frameOffset(int64_t frame) const;
+
+    /*! \brief Returns the index of the frame starting at file offset \p offset
+     *
+     * Returns the number of frames for the offset after the last frame
+     * and -1 when no frame starts at \p offset.
+     */
+    int64_t frameAtOffset(gmx_off_t offset) const;
+
+    //! Returns the size of the trajectory file when it was indexed
+    gmx_off_t fileSize() const { return fileSize_; }
+
+    //! Returns the modification time of the trajectory file when it was indexed
+    int64_t modificationTime() const { return modificationTime_; }
+
+private:
+    //! The frames
+    std::vector<TrajectoryFrameIndexEntry> frames_;
+    //! The file offset after the last complete frame
+    gmx_off_t endOffset_;
+    //! The size of the trajectory file
+    gmx_off_t fileSize_;
+    //! The modification time of the trajectory file
+    int64_t modificationTime_;
+};
+
+/*! \brief Returns whether frame indices can be used for trajectory \p filename
+ *
+ * This is the case for XTC and TRR files, unless disabled with the
+ * environment variable GMX_NO_TRAJECTORY_FRAME_INDEX.
+ */
+bool frameIndexIsSupported(const std::string& filename);
+
+//! Returns the name of the frame index file of trajectory \p filename
+std::string frameIndexFileName(const std::string& filename);
+
+/*! \brief Returns the frame index of XTC or TRR trajectory \p filename
+ *
+ * The index is read from the index file when that is valid. Otherwise
+ * the index is built by reading the frame headers, starting after the
+ * last indexed frame when frames have only been appended to the
+ * trajectory, and the index file is written when possible.
+ * Returns nullptr when frameIndexIsSupported() returns false or
+ * the trajectory can not be accessed.
+ */
+std::unique_ptr<TrajectoryFrameIndex> loadTrajectoryFrameIndex(const std::string& filename);
+
+/*! \brief Returns the frames of part \p part out of \p numParts
+ * of \p numFrames frames, as the range [first, last)
+ *
+ * This can be used to divide the frames of a trajectory over
+ * processes or threads that each read a contiguous part of the frames.
+ */
+std::pair<int64_t, int64_t> frameRangeOfPart(int64_t numFrames, int part, int numParts);
+
+/*! \libinternal
+ * \brief Records the frames written to a trajectory file and writes its frame index
+ *
+ * This avoids building the index by reading the trajectory after it has
+ * been written, e.g. by mdrun.
+ */
+class TrajectoryFrameIndexRecorder
+{
+public:
+    /*! \brief Starts recording frames written to trajectory \p filename
+     *
+     * With \p appending, frames are written after those already in the
+     * file, which are taken from the existing index file when possible.
+     * The trajectory should have been truncated after the last frame
+     * to keep, before calling this constructor.
+     */
+    TrajectoryFrameIndexRecorder(const std::string& filename, bool appending);
+
+    /*! \brief Records a frame that has just been written
+     *
+     * \param[in] frame      The frame, the offset is ignored
+     * \param[in] endOffset  The file offset after the frame
+     */
+    void addFrame(const TrajectoryFrameIndexEntry& frame, gmx_off_t endOffset);
+
+    /*! \brief Writes the index file
+     *
+     * Should be called after the trajectory file has been closed. Nothing is
+     * written when the frames present in the file when appending are unknown.
+     */
+    void writeIndexFile() const;
+
+private:
+    //! The trajectory file name
+    std::string filename_;
+    //! The frames written
+    std::vector<TrajectoryFrameIndexEntry> frames_;
+    //! The file offset after the last frame
+    gmx_off_t endOffset_ = 0;
+    //! Whether all frames in the file are known
+    bool haveAllFrames_ = true;
+};
+
+} // namespace gmx
+
+#endif
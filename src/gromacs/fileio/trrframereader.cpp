@@ -0,0 +1,452 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Implements the reader for TRR frames from a memory-mapped file
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "trrframereader.h"
+
+#include "config.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+#if HAVE_MMAP
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The magic number at the start of each TRR frame
+constexpr int c_trrMagic = 1993;
+
+//! Reverses the byte order of \p value
+inline uint32_t byteSwap(uint32_t value)
+{
+    return ((value & 0x000000FFU) << 24U) | ((value & 0x0000FF00U) << 8U)
+           | ((value & 0x00FF0000U) >> 8U) | ((value & 0xFF000000U) >> 24U);
+}
+
+//! Reverses the byte order of \p value
+inline uint64_t byteSwap(uint64_t value)
+{
+    return (static_cast<uint64_t>(byteSwap(static_cast<uint32_t>(value))) << 32U)
+           | byteSwap(static_cast<uint32_t>(value >> 32U));
+}
+
+//! Returns the value of type \p T stored in big-endian (XDR) byte order at \p data
+template<typename T>
+inline T fromBigEndian(const char* data)
+{
+    using Bits = std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>;
+    static_assert(sizeof(T) == sizeof(Bits), "Only 4 and 8 byte values are supported");
+
+    Bits bits;
+    std::memcpy(&bits, data, sizeof(bits));
+#if !GMX_INTEGER_BIG_ENDIAN
+    bits = byteSwap(bits);
+#endif
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+/*! \brief Converts \p numValues big-endian values of type \p FileReal at \p data to \p values
+ *
+ * This simple loop over the whole block is vectorized by compilers.
+ */
+template<typename FileReal>
+void convertBlock(const char* data, std::size_t numValues, real* values)
+{
+    for (std::size_t i = 0; i < numValues; i++)
+    {
+        values[i] = fromBigEndian<FileReal>(data + i * sizeof(FileReal));
+    }
+}
+
+//! Converts the rvecs, present in the file when \p isPresent, at \p *data and advances \p *data
+void convertRvecs(const char** data, bool isPresent, bool isDouble, int numRvecs, rvec* values)
+{
+    if (!isPresent)
+    {
+        return;
+    }
+    const std::size_t numValues = static_cast<std::size_t>(numRvecs) * DIM;
+    if (values != nullptr)
+    {
+        if (isDouble)
+        {
+            convertBlock<double>(*data, numValues, values[0]);
+        }
+        else
+        {
+            convertBlock<float>(*data, numValues, values[0]);
+        }
+    }
+    *data += numValues * (isDouble ? sizeof(double) : sizeof(float));
+}
+
+/*! \brief Sequential parser of big-endian values in a memory block
+ *
+ * Reading past the end of the block is detected and makes isValid() return false.
+ */
+class BlockParser
+{
+public:
+    //! Constructor for parsing \p size bytes at \p data, starting at \p offset
+    BlockParser(const char* data, std::size_t size, std::size_t offset) :
+        data_(data),
+        size_(size),
+        offset_(offset),
+        isValid_(offset <= size)
+    {
+    }
+
+    //! Returns the next value of type \p T, or 0 when past the end
+    template<typename T>
+    T read()
+    {
+        if (!skip(sizeof(T)))
+        {
+            return 0;
+        }
+        return fromBigEndian<T>(data_ + offset_ - sizeof(T));
+    }
+
+    //! Skips \p numBytes bytes, returns whether they were present
+    bool skip(std::size_t numBytes)
+    {
+        isValid_ = isValid_ && numBytes <= size_ - offset_;
+        if (isValid_)
+        {
+            offset_ += numBytes;
+        }
+        return isValid_;
+    }
+
+    //! Returns whether all values read were present
+    bool isValid() const { return isValid_; }
+
+    //! Returns the offset of the next value
+    std::size_t offset() const { return offset_; }
+
+private:
+    //! The block
+    const char* data_;
+    //! The size of the block
+    std::size_t size_;
+    //! The offset of the next value
+    std::size_t offset_;
+    //! Whether all values read were present
+    bool isValid_;
+};
+
+/*! \brief Parses the TRR frame header at \p offset in \p data
+ *
+ * Returns whether the header and the data of the frame are present in
+ * \p data and consistent, and sets \p *dataOffset to the offset of
+ * the frame data. This checks the same properties as reading through
+ * XDR, which is used to report errors for frames that fail the checks.
+ */
+bool parseFrameHeader(const char*       data,
+                      std::size_t       size,
+                      std::size_t       offset,
+                      gmx_trr_header_t* header,
+                      std::size_t*      dataOffset)
+{
+    BlockParser parser(data, size, offset);
+    if (parser.read<int32_t>() != c_trrMagic)
+    {
+        return false;
+    }
+    // The version string is stored as its buffer size followed by an XDR string
+    const int32_t  bufferSize   = parser.read<int32_t>();
+    const uint32_t stringLength = parser.read<uint32_t>();
+    if (!parser.isValid() || bufferSize < 0 || stringLength > static_cast<uint32_t>(bufferSize)
+        || !parser.skip((stringLength + 3U) & ~3U))
+    {
+        return false;
+    }
+
+    gmx_trr_header_t sh = *header;
+    sh.ir_size          = parser.read<int32_t>();
+    sh.e_size           = parser.read<int32_t>();
+    sh.box_size         = parser.read<int32_t>();
+    sh.vir_size         = parser.read<int32_t>();
+    sh.pres_size        = parser.read<int32_t>();
+    sh.top_size         = parser.read<int32_t>();
+    sh.sym_size         = parser.read<int32_t>();
+    sh.x_size           = parser.read<int32_t>();
+    sh.v_size           = parser.read<int32_t>();
+    sh.f_size           = parser.read<int32_t>();
+    sh.natoms           = parser.read<int32_t>();
+    if (!parser.isValid() || sh.natoms < 0)
+    {
+        return false;
+    }
+
+    // Determine the precision in the same way as the XDR reader
+    int floatSize = 0;
+    if (sh.box_size)
+    {
+        floatSize = sh.box_size / (DIM * DIM);
+    }
+    else if (sh.natoms == 0)
+    {
+        return false;
+    }
+    else if (sh.x_size)
+    {
+        floatSize = sh.x_size / (sh.natoms * DIM);
+    }
+    else if (sh.v_size)
+    {
+        floatSize = sh.v_size / (sh.natoms * DIM);
+    }
+    else if (sh.f_size)
+    {
+        floatSize = sh.f_size / (sh.natoms * DIM);
+    }
+    if (floatSize != sizeof(float) && floatSize != sizeof(double))
+    {
+        return false;
+    }
+    sh.bDouble = (floatSize == sizeof(double));
+
+    sh.step = parser.read<int32_t>();
+    sh.nre  = parser.read<int32_t>();
+    if (sh.bDouble)
+    {
+        sh.t      = parser.read<double>();
+        sh.lambda = parser.read<double>();
+    }
+    else
+    {
+        sh.t      = parser.read<float>();
+        sh.lambda = parser.read<float>();
+    }
+
+    // The XDR reader reads full matrices and natoms rvecs for each block present
+    const std::size_t numMatrices = (sh.box_size != 0) + (sh.vir_size != 0) + (sh.pres_size != 0);
+    const std::size_t numVectorBlocks = (sh.x_size != 0) + (sh.v_size != 0) + (sh.f_size != 0);
+    const std::size_t numValues = DIM * (numMatrices * DIM + numVectorBlocks * sh.natoms);
+    if (!parser.isValid())
+    {
+        return false;
+    }
+    *dataOffset = parser.offset();
+    if (!parser.skip(numValues * floatSize))
+    {
+        return false;
+    }
+    *header = sh;
+
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<TrrFrameReader> TrrFrameReader::create(t_fileio* fio)
+{
+#if HAVE_MMAP
+    const int fd = open(gmx_fio_getname(fio), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat info;
+    std::size_t size = 0;
+    void*       data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0
+        && static_cast<uint64_t>(info.st_size) <= std::numeric_limits<std::size_t>::max())
+    {
+        size = info.st_size;
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+#    ifdef POSIX_MADV_SEQUENTIAL
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+#    endif
+
+    return std::unique_ptr<TrrFrameReader>(
+            new TrrFrameReader(fio, fd, static_cast<const char*>(data), size));
+#else
+    GMX_UNUSED_VALUE(fio);
+
+    return nullptr;
+#endif
+}
+
+TrrFrameReader::TrrFrameReader(t_fileio* fio, int fd, const char* data, std::size_t size) :
+    fio_(fio),
+    fd_(fd),
+    data_(data),
+    size_(size),
+    offset_(0),
+    readDirectly_(false)
+{
+    seek(gmx_fio_ftell(fio));
+}
+
+TrrFrameReader::~TrrFrameReader()
+{
+#if HAVE_MMAP
+    munmap(const_cast<char*>(data_), size_);
+    close(fd_);
+#endif
+}
+
+std::size_t TrrFrameReader::mappedSizeInFile() const
+{
+#if HAVE_MMAP
+    /* Accessing pages of the mapping beyond the end of the file raises
+     * SIGBUS, so we check the current size of the file, as it might have
+     * been truncated after mapping.
+     */
+    struct stat info;
+    if (fstat(fd_, &info) != 0)
+    {
+        return 0;
+    }
+    return info.st_size < 0 ? 0 : std::min(size_, static_cast<std::size_t>(info.st_size));
+#else
+    return 0;
+#endif
+}
+
+void TrrFrameReader::startReadingDirectly()
+{
+    if (gmx_fio_seek(fio_, offset_) != 0)
+    {
+        gmx_fatal(FARGS, "Could not seek in file %s", gmx_fio_getname(fio_));
+    }
+    readDirectly_ = true;
+}
+
+gmx_bool TrrFrameReader::readFrameHeader(gmx_trr_header_t* header, gmx_bool* bOK)
+{
+    std::size_t dataOffset = 0;
+    if (!readDirectly_
+        && !parseFrameHeader(data_, mappedSizeInFile(), offset_, header, &dataOffset))
+    {
+        startReadingDirectly();
+    }
+    if (readDirectly_)
+    {
+        return gmx_trr_read_frame_header(fio_, header, bOK);
+    }
+    offset_ = dataOffset;
+    *bOK    = TRUE;
+
+    return TRUE;
+}
+
+gmx_bool TrrFrameReader::readFrameData(const gmx_trr_header_t& header,
+                                       rvec*                   box,
+                                       rvec*                   x,
+                                       rvec*                   v,
+                                       rvec*                   f)
+{
+    if (readDirectly_)
+    {
+        return gmx_trr_read_frame_data(fio_, const_cast<gmx_trr_header_t*>(&header), box, x, v, f);
+    }
+
+    /* parseFrameHeader() has checked that all data is present */
+    const char* data = data_ + offset_;
+    convertRvecs(&data, header.box_size != 0, header.bDouble, DIM, box);
+    convertRvecs(&data, header.vir_size != 0, header.bDouble, DIM, nullptr);
+    convertRvecs(&data, header.pres_size != 0, header.bDouble, DIM, nullptr);
+    convertRvecs(&data, header.x_size != 0, header.bDouble, header.natoms, x);
+    convertRvecs(&data, header.v_size != 0, header.bDouble, header.natoms, v);
+    convertRvecs(&data, header.f_size != 0, header.bDouble, header.natoms, f);
+    offset_ = data - data_;
+
+    return TRUE;
+}
+
+gmx_off_t TrrFrameReader::fileOffset() const
+{
+    return readDirectly_ ? gmx_fio_ftell(fio_) : static_cast<gmx_off_t>(offset_);
+}
+
+void TrrFrameReader::seek(gmx_off_t fileOffset)
+{
+    GMX_RELEASE_ASSERT(fileOffset >= 0, "Can only seek to valid offsets");
+
+    if (static_cast<uint64_t>(fileOffset) <= size_)
+    {
+        offset_       = fileOffset;
+        readDirectly_ = false;
+    }
+    else
+    {
+        // The file has grown after mapping, offset_ is only used for seeking here
+        offset_ = fileOffset;
+        startReadingDirectly();
+    }
+}
+
+bool trrFileMappingIsEnabled()
+{
+    return HAVE_MMAP && std::getenv("GMX_NO_MAPPED_TRR_READING") == nullptr;
+}
+
+} // namespace gmx
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief Declares a reader for TRR frames from a memory-mapped file
+ *
+ * \ingroup module_fileio
+ * \inlibraryapi
+ */
+#ifndef GMX_FILEIO_TRRFRAMEREADER_H
+#define GMX_FILEIO_TRRFRAMEREADER_H
+
+#include <cstddef>
+
+#include <memory>
+
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/futil.h"
+
+struct t_fileio;
+
+namespace gmx
+{
+
+/*! \libinternal
+ * \brief Reads TRR frames from a read-only memory mapping of the file
+ *
+ * Reading through XDR converts every value with a separate call.
+ * This reader parses the frame headers in the mapping and converts
+ * whole blocks of big-endian values directly from the mapping into
+ * the arrays of the caller, without intermediate buffers.
+ *
+ * The mapping covers the file as it was when the reader was created.
+ * Frames that do not lie completely within the mapping, which are
+ * incomplete or written later, and frames with inconsistent headers are
+ * read through XDR from \p fio instead, so the results are identical
+ * to those of gmx_trr_read_frame_header() and gmx_trr_read_frame_data().
+ * Before each frame, the current size of the file is checked, so frames
+ * that have been cut off by truncating the file after mapping are also
+ * read through XDR. Truncating the file while a frame is being converted
+ * is not detected and terminates the program with SIGBUS, as with other
+ * programs that map files. The file should not be accessed by other means
+ * while the reader exists. After destroying the reader, the file can be positioned
+ * after the last frame read using fileOffset().
+ */
+class TrrFrameReader
+{
+public:
+    /*! \brief Returns a reader for the TRR file \p fio, starting at its current offset
+     *
+     * Returns nullptr when the file can not be mapped, e.g. because the
+     * platform does not support it or the file is empty.
+     */
+    static std::unique_ptr<TrrFrameReader> create(t_fileio* fio);
+
+    //! Destructor, unmaps the file
+    ~TrrFrameReader();
+
+    //! Reads the next frame header, as gmx_trr_read_frame_header()
+    gmx_bool readFrameHeader(gmx_trr_header_t* header, gmx_bool* bOK);
+
+    /*! \brief Reads the data of the frame with \p header, as gmx_trr_read_frame_data()
+     *
+     * Data for which a nullptr is passed is skipped.
+     */
+    gmx_bool readFrameData(const gmx_trr_header_t& header, rvec* box, rvec* x, rvec* v, rvec* f);
+
+    //! Returns the file offset of the next header or data to read
+    gmx_off_t fileOffset() const;
+
+    //! Positions the reader at \p fileOffset, which should be the start of a frame
+    void seek(gmx_off_t fileOffset);
+
+private:
+    //! Constructor for a file opened as \p fd of \p size bytes mapped at \p data
+    TrrFrameReader(t_fileio* fio, int fd, const char* data, std::size_t size);
+
+    //! Returns the size of the part of the mapping that is still backed by the file
+    std::size_t mappedSizeInFile() const;
+
+    //! Continues reading through XDR at the current offset
+    void startReadingDirectly();
+
+    //! The file
+    t_fileio* fio_;
+    //! The file descriptor of the mapped file, kept open for checking its size
+    int fd_;
+    //! The start of the mapping
+    const char* data_;
+    //! The size of the mapping
+    std::size_t size_;
+    //! The offset of the next header or data to read
+    std::size_t offset_;
+    //! Whether the frames are read through XDR instead of from the mapping
+    bool readDirectly_;
+
+    GMX_DISALLOW_COPY_AND_ASSIGN(TrrFrameReader);
+};
+
+/*! \brief Returns whether TRR files should be read from memory mappings
+ *
+ * This is the case when the platform supports it, unless disabled
+ * with the environment variable GMX_NO_MAPPED_TRR_READING.
+ */
+bool trrFileMappingIsEnabled();
+
+} // namespace gmx
+
+#endif
@@ -111,6 +111,12 @@ gmx_bool gmx_trr_read_frame_data(struct t_fileio* fio, gmx_trr_header_t* sh, rve
  * Return FALSE on error
  */
 
+gmx_bool gmx_trr_skip_frame_data(struct t_fileio* fio, const gmx_trr_header_t* header);
+/* Skip the data of a frame, of which the header should be pre-read, by
+ * seeking in the file, without reading the data. Skipping past the end
+ * of the file is not detected. Return FALSE on error
+ */
+
 gmx_bool gmx_trr_read_frame(struct t_fileio* fio,
                             int64_t*         step,
                             real*            t,
@@ -57,8 +57,11 @@
 #include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/tngio.h"
 #include "gromacs/fileio/tpxio.h"
+#include "gromacs/fileio/trajectoryframeindex.h"
+#include "gromacs/fileio/trrframereader.h"
 #include "gromacs/fileio/trrio.h"
 #include "gromacs/fileio/xdrf.h"
+#include "gromacs/fileio/xtcframereader.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/md_enums.h"
@@ -94,6 +97,12 @@ struct t_trxstatus
     double               DT, BOX[3];
     gmx_bool             bReadBox;
     char*                persistent_line; /* Persistent line for reading g96 trajectories */
+    int                  xtcDecodingThreads; /* Number of threads for decoding xtc frames */
+    gmx::XtcFrameReader* xtcReader; /* Decodes xtc frames in parallel, can be nullptr */
+    gmx::TrajectoryFrameIndex* frameIndex; /* Frame index of xtc/trr files, can be nullptr */
+    bool                 useTrrReader; /* Whether to create trrReader after the first frame */
+    gmx::TrrFrameReader* trrReader;    /* Reads trr frames from a mapping, can be nullptr */
+    int64_t frameIndexPosition; /* Index of the next frame in the file, -1 when unknown */
 #if GMX_USE_PLUGINS
     gmx_vmdplugin_t* vmdplugin;
 #endif
@@ -165,8 +174,92 @@ static void status_init(t_trxstatus* status)
     status->__frame         = -1;
     status->t0              = 0;
     status->tf              = 0;
-    status->persistent_line = nullptr;
-    status->tng             = nullptr;
+    status->persistent_line    = nullptr;
+    status->tng                = nullptr;
+    status->xtcDecodingThreads = 0;
+    status->xtcReader          = nullptr;
+    status->frameIndex         = nullptr;
+    status->frameIndexPosition = -1;
+    status->useTrrReader       = false;
+    status->trrReader          = nullptr;
+}
+
+/* Stops decoding xtc frames in parallel, which reads frames ahead,
+ * and positions the file after the last frame returned
+ */
+static void stopXtcReader(t_trxstatus* status)
+{
+    if (status->xtcReader)
+    {
+        const gmx_off_t fileOffset = status->xtcReader->fileOffset();
+        delete status->xtcReader;
+        status->xtcReader = nullptr;
+        if (gmx_fio_seek(status->fio, fileOffset) != 0)
+        {
+            gmx_fatal(FARGS, "Could not seek in file %s", gmx_fio_getname(status->fio));
+        }
+    }
+}
+
+/* Stops reading trr frames from a memory mapping and positions the file
+ * after the last frame read
+ */
+static void stopTrrReader(t_trxstatus* status)
+{
+    if (status->trrReader)
+    {
+        const gmx_off_t fileOffset = status->trrReader->fileOffset();
+        delete status->trrReader;
+        status->trrReader = nullptr;
+        if (gmx_fio_seek(status->fio, fileOffset) != 0)
+        {
+            gmx_fatal(FARGS, "Could not seek in file %s", gmx_fio_getname(status->fio));
+        }
+    }
+}
+
+/* Returns the file offset of the next frame to read */
+static gmx_off_t nextFrameOffset(t_trxstatus* status)
+{
+    if (status->trrReader)
+    {
+        return status->trrReader->fileOffset();
+    }
+    stopXtcReader(status);
+
+    return gmx_fio_ftell(status->fio);
+}
+
+/* Positions the file being read at fileOffset, which should be the start of a frame */
+static void seekToFrame(t_trxstatus* status, gmx_off_t fileOffset)
+{
+    stopXtcReader(status);
+    if (status->trrReader)
+    {
+        status->trrReader->seek(fileOffset);
+    }
+    else if (gmx_fio_seek(status->fio, fileOffset) != 0)
+    {
+        gmx_fatal(FARGS, "Could not seek in file %s", gmx_fio_getname(status->fio));
+    }
+}
+
+/* Loads the frame index of the xtc or trr file being read, when not loaded yet.
+ * Returns whether the index is available.
+ */
+static bool loadFrameIndex(t_trxstatus* status)
+{
+    if (status->frameIndex == nullptr && status->tng == nullptr && status->fio != nullptr
+        && gmx::frameIndexIsSupported(gmx_fio_getname(status->fio)))
+    {
+        status->frameIndex = gmx::loadTrajectoryFrameIndex(gmx_fio_getname(status->fio)).release();
+        if (status->frameIndex)
+        {
+            status->frameIndexPosition = status->frameIndex->frameAtOffset(nextFrameOffset(status));
+        }
+    }
+
+    return status->frameIndex != nullptr;
 }
 
 
@@ -230,6 +323,15 @@ real ndec2prec(int ndec)
 
 t_fileio* trx_get_fileio(t_trxstatus* status)
 {
+    /* The caller can access the file directly from now on,
+     * so we should no longer read ahead
+     */
+    stopXtcReader(status);
+    status->xtcDecodingThreads = 0;
+    stopTrrReader(status);
+    status->useTrrReader       = false;
+    status->frameIndexPosition = -1;
+
     return status->fio;
 }
 
@@ -265,6 +367,23 @@ float trx_get_time_of_final_frame(t_trxstatus* status)
     return lasttime;
 }
 
+int64_t trx_get_number_of_frames(t_trxstatus* status)
+{
+    return loadFrameIndex(status) ? status->frameIndex->numFrames() : -1;
+}
+
+gmx_bool trx_seek_frame(t_trxstatus* status, int64_t frame)
+{
+    if (!loadFrameIndex(status) || frame < 0 || frame >= status->frameIndex->numFrames())
+    {
+        return FALSE;
+    }
+    seekToFrame(status, status->frameIndex->frameOffset(frame));
+    status->frameIndexPosition = frame;
+
+    return TRUE;
+}
+
 void clear_trxframe(t_trxframe* fr, gmx_bool bFirst)
 {
     fr->not_ok    = 0;
@@ -599,6 +718,9 @@ void close_trx(t_trxstatus* status)
         return;
     }
     gmx_tng_close(&status->tng);
+    delete status->xtcReader;
+    delete status->trrReader;
+    delete status->frameIndex;
     if (status->fio)
     {
         gmx_fio_close(status->fio);
@@ -636,7 +758,9 @@ static gmx_bool gmx_next_frame(t_trxstatus* status, t_trxframe* fr)
 
     bRet = FALSE;
 
-    if (gmx_trr_read_frame_header(status->fio, &sh, &bOK))
+    gmx::TrrFrameReader* reader = status->trrReader;
+    if (reader ? reader->readFrameHeader(&sh, &bOK)
+               : gmx_trr_read_frame_header(status->fio, &sh, &bOK))
     {
         fr->bDouble   = sh.bDouble;
         fr->natoms    = sh.natoms;
@@ -672,7 +796,8 @@ static gmx_bool gmx_next_frame(t_trxstatus* status, t_trxframe* fr)
             }
             fr->bF = sh.f_size > 0;
         }
-        if (gmx_trr_read_frame_data(status->fio, &sh, fr->box, fr->x, fr->v, fr->f))
+        if (reader ? reader->readFrameData(sh, fr->box, fr->x, fr->v, fr->f)
+                   : gmx_trr_read_frame_data(status->fio, &sh, fr->box, fr->x, fr->v, fr->f))
         {
             bRet = TRUE;
         }
@@ -767,6 +892,58 @@ static int pdb_first_x(t_trxstatus* status, FILE* fp, t_trxframe* fr)
     return fr->natoms;
 }
 
+/* Uses the frame index to move the file to the next frame that read_next_frame
+ * should return, without reading the frames that would be skipped.
+ * Returns false when the begin time of an xtc file is not in the index,
+ * in which case nothing is done.
+ */
+static bool skipFramesUsingIndex(const gmx_output_env_t* oenv, t_trxstatus* status, int ftp)
+{
+    const gmx::TrajectoryFrameIndex&                   index  = *status->frameIndex;
+    gmx::ArrayRef<const gmx::TrajectoryFrameIndexEntry> frames = index.frames();
+
+    int64_t frame = status->frameIndexPosition;
+    if (ftp == efXTC && bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))
+    {
+        /* As with xtc_seek_time, move to the begin time and restart the frame count */
+        while (frame < index.numFrames()
+               && static_cast<real>(frames[frame].time) < rTimeValue(TBEGIN))
+        {
+            frame++;
+        }
+        if (frame == index.numFrames())
+        {
+            return false;
+        }
+        initcount(status);
+    }
+    for (; frame < index.numFrames(); frame++)
+    {
+        const gmx::TrajectoryFrameIndexEntry& entry = frames[frame];
+
+        const bool missingData = ((((status->flags & TRX_NEED_X) != 0) && !entry.haveX)
+                                  || (((status->flags & TRX_NEED_V) != 0) && !entry.haveV)
+                                  || (((status->flags & TRX_NEED_F) != 0) && !entry.haveF));
+        if (!missingData)
+        {
+            const real time = entry.time;
+            if (((status->flags & TRX_DONT_SKIP) != 0)
+                || check_times2(time, status->t0, entry.isDouble) >= 0)
+            {
+                break;
+            }
+            printcount(status, oenv, time, TRUE);
+        }
+    }
+    if (frame != status->frameIndexPosition)
+    {
+        seekToFrame(status, index.frameOffset(frame));
+        status->frameIndexPosition = frame;
+    }
+
+    return true;
+}
+
 bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxframe* fr)
 {
     real     pt;
@@ -790,9 +967,25 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
         {
             ftp = gmx_fio_getftp(status->fio);
         }
+        bool haveSkippedUsingIndex = false;
+        if ((ftp == efXTC || ftp == efTRR) && status->frameIndex != nullptr
+            && status->frameIndexPosition >= 0)
+        {
+            haveSkippedUsingIndex = skipFramesUsingIndex(oenv, status, ftp);
+        }
         switch (ftp)
         {
-            case efTRR: bRet = gmx_next_frame(status, fr); break;
+            case efTRR:
+                bRet = gmx_next_frame(status, fr);
+                if (bRet && status->useTrrReader)
+                {
+                    /* The first frame is read through XDR, which reports the trr version,
+                     * later frames are read from a memory mapping of the file
+                     */
+                    status->trrReader    = gmx::TrrFrameReader::create(status->fio).release();
+                    status->useTrrReader = false;
+                }
+                break;
             case efCPT:
                 /* Checkpoint files can not contain mulitple frames */
                 break;
@@ -805,8 +998,11 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
                 break;
             }
             case efXTC:
-                if (bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))
+                if (!haveSkippedUsingIndex && bTimeSet(TBEGIN)
+                    && (status->tf < rTimeValue(TBEGIN)))
                 {
+                    stopXtcReader(status);
+                    status->frameIndexPosition = -1;
                     if (xtc_seek_time(status->fio, rTimeValue(TBEGIN), fr->natoms, TRUE))
                     {
                         gmx_fatal(FARGS,
@@ -816,9 +1012,23 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
                     }
                     initcount(status);
                 }
-                bRet = (read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box, fr->x,
-                                      &fr->prec, &bOK)
-                        != 0);
+                if (status->xtcReader == nullptr && status->xtcDecodingThreads > 1)
+                {
+                    status->xtcReader = new gmx::XtcFrameReader(status->fio, fr->natoms,
+                                                                status->xtcDecodingThreads);
+                }
+                if (status->xtcReader)
+                {
+                    bRet = (status->xtcReader->readNextFrame(&fr->step, &fr->time, fr->box, fr->x,
+                                                             &fr->prec, &bOK)
+                            != 0);
+                }
+                else
+                {
+                    bRet = (read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box,
+                                          fr->x, &fr->prec, &bOK)
+                            != 0);
+                }
                 fr->bPrec = (bRet && fr->prec > 0);
                 fr->bStep = bRet;
                 fr->bTime = bRet;
@@ -843,6 +1053,15 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
 #endif
         }
         status->tf = fr->time;
+        if (status->frameIndex)
+        {
+            /* Frames beyond the index, e.g. written after indexing, have unknown positions */
+            const int64_t position = status->frameIndexPosition;
+            status->frameIndexPosition =
+                    (bRet && position >= 0 && position < status->frameIndex->numFrames())
+                            ? position + 1
+                            : -1;
+        }
 
         if (bRet)
         {
@@ -908,9 +1127,14 @@ bool read_first_frame(const gmx_output_env_t* oenv, t_trxstatus** status, const
     {
         fio = (*status)->fio = gmx_fio_open(fn, "r");
     }
+    if (bTimeSet(TBEGIN) || bTimeSet(TDELTA))
+    {
+        /* Use the frame index, when available, to avoid reading skipped frames */
+        loadFrameIndex(*status);
+    }
     switch (ftp)
     {
-        case efTRR: break;
+        case efTRR: (*status)->useTrrReader = gmx::trrFileMappingIsEnabled(); break;
         case efCPT:
             read_checkpoint_trxframe(fio, fr);
             bFirst = FALSE;
@@ -960,6 +1184,16 @@ bool read_first_frame(const gmx_output_env_t* oenv, t_trxstatus** status, const
                 fr->bBox  = TRUE;
                 printcount(*status, oenv, fr->time, FALSE);
             }
+            /* With -dt we jump over frames, which reading ahead would only slow down */
+            if (!((*status)->frameIndex && bTimeSet(TDELTA)))
+            {
+                (*status)->xtcDecodingThreads = gmx::xtcDecodingThreadCount();
+            }
+            if ((*status)->frameIndex)
+            {
+                (*status)->frameIndexPosition =
+                        (*status)->frameIndex->frameAtOffset(gmx_fio_ftell(fio));
+            }
             bFirst = FALSE;
             break;
         case efTNG:
@@ -1078,7 +1312,15 @@ void rewind_trj(t_trxstatus* status)
 {
     initcount(status);
 
+    delete status->xtcReader;
+    status->xtcReader = nullptr;
+
     gmx_fio_rewind(status->fio);
+    if (status->trrReader)
+    {
+        status->trrReader->seek(0);
+    }
+    status->frameIndexPosition = 0;
 }
 
 /***** T O P O L O G Y   S T U F F ******/
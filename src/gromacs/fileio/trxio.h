@@ -165,6 +165,21 @@ struct t_fileio* trx_get_fileio(t_trxstatus* status);
 float trx_get_time_of_final_frame(t_trxstatus* status);
 /* get time of final frame. Only supported for TNG and XTC */
 
+int64_t trx_get_number_of_frames(t_trxstatus* status);
+/* Returns the number of complete frames in a trajectory opened with
+ * read_first_frame, as given by the frame index of the file.
+ * Returns -1 when the format does not support frame indices,
+ * currently only XTC and TRR files are supported.
+ */
+
+gmx_bool trx_seek_frame(t_trxstatus* status, int64_t frame);
+/* Positions a trajectory opened with read_first_frame such that the next
+ * call to read_next_frame reads frame number frame, counting from 0 and
+ * subject to the usual begin/end time and flag selection.
+ * Returns FALSE when the format does not support frame indices or
+ * the frame is not present.
+ */
+
 gmx_bool bRmod_fd(double a, double b, double c, gmx_bool bDouble);
 /* Returns TRUE when (a - b) MOD c = 0, using a margin which is slightly
  * larger than the float/double precision.
@@ -59,6 +59,13 @@
 int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision);
 
 
+/* Read reduced precision *float* coordinates of at most maxSize atoms into fp,
+ * the number of atoms read is returned in *size. Returns 0 when the stream
+ * contains more atoms, so fp needs to have space for only maxSize atoms.
+ */
+int xdr3dfcoord_read_at_most(XDR* xdrs, float* fp, int maxSize, int* size, float* precision);
+
+
 /* Read or write a *real* value (stored as float) */
 int xdr_real(XDR* xdrs, real* r);
 
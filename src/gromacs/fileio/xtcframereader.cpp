@@ -0,0 +1,323 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Implements the reader that decodes XTC frames in parallel
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "xtcframereader.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The maximum number of decoding threads used by default
+constexpr int c_maxDefaultNumDecodingThreads = 4;
+
+//! A frame read from file, with the decoded contents once decoded
+struct XtcFrame
+{
+    //! The frame as stored in the file
+    std::vector<char> data;
+    //! The file offset after the frame
+    gmx_off_t fileOffset = 0;
+    //! Whether the frame has been decoded
+    bool isDecoded = false;
+    //! The return value of decoding
+    int result = 0;
+    //! The number of atoms in the frame
+    int natoms = 0;
+    //! The step
+    int64_t step = 0;
+    //! The time
+    real time = 0;
+    //! The box
+    matrix box = { { 0 } };
+    //! The precision
+    real prec = 0;
+    //! The positions
+    std::vector<RVec> x;
+};
+
+} // namespace
+
+class XtcFrameReader::Impl
+{
+public:
+    Impl(t_fileio* fio, int natoms, int numThreads);
+    ~Impl();
+
+    //! Reads frames and submits them for decoding until all frame buffers are in use
+    void readAhead();
+
+    //! The main loop of the worker threads
+    void runWorker();
+
+    //! The XTC file
+    t_fileio* fio_;
+    //! The number of atoms to read
+    int natoms_;
+    //! The frame buffers
+    std::vector<XtcFrame> frames_;
+    //! Frames that are not in use
+    std::vector<XtcFrame*> freeFrames_;
+    //! Frames that have been read and not yet returned, in file order
+    std::deque<XtcFrame*> framesInFileOrder_;
+    //! Whether the last read attempt failed, either at the end of the file or because of an error
+    bool readFailed_ = false;
+    /*! \brief Whether the remaining frames are read directly with read_next_xtc()
+     *
+     * This is the case after returning all frames before a failed read,
+     * so the contents returned for an incomplete frame are identical.
+     */
+    bool readDirectly_ = false;
+    //! The file offset after the last frame returned
+    gmx_off_t fileOffset_;
+
+    //! Frames that have been submitted for decoding, accessed by all threads
+    std::queue<XtcFrame*> framesToDecode_;
+    //! Whether the worker threads should finish
+    bool finish_ = false;
+    //! Mutex protecting the queue of frames to decode, isDecoded of the frames and \p finish_
+    std::mutex mutex_;
+    //! Condition variable for notifying of frames to decode and for finishing
+    std::condition_variable frameSubmitted_;
+    //! Condition variable for notifying of decoded frames
+    std::condition_variable frameDecoded_;
+    //! The worker threads
+    std::vector<std::thread> threads_;
+};
+
+XtcFrameReader::Impl::Impl(t_fileio* fio, const int natoms, const int numThreads) :
+    fio_(fio),
+    natoms_(natoms),
+    frames_(2 * numThreads),
+    fileOffset_(gmx_fio_ftell(fio))
+{
+    GMX_RELEASE_ASSERT(numThreads > 0, "Need at least one decoding thread");
+
+    for (auto& frame : frames_)
+    {
+        frame.x.resize(natoms);
+        freeFrames_.push_back(&frame);
+    }
+
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        threads_.emplace_back([this]() { runWorker(); });
+    }
+}
+
+XtcFrameReader::Impl::~Impl()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        finish_ = true;
+    }
+    frameSubmitted_.notify_all();
+
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void XtcFrameReader::Impl::readAhead()
+{
+    while (!readFailed_ && !freeFrames_.empty())
+    {
+        XtcFrame* frame = freeFrames_.back();
+        gmx_bool  bOK;
+
+        if (xtc_read_frame_data(fio_, natoms_, &frame->data, &bOK) == 0)
+        {
+            readFailed_ = true;
+            break;
+        }
+        frame->fileOffset = gmx_fio_ftell(fio_);
+
+        freeFrames_.pop_back();
+        framesInFileOrder_.push_back(frame);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            frame->isDecoded = false;
+            framesToDecode_.push(frame);
+        }
+        frameSubmitted_.notify_one();
+    }
+}
+
+void XtcFrameReader::Impl::runWorker()
+{
+    try
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (true)
+        {
+            frameSubmitted_.wait(lock, [this]() { return finish_ || !framesToDecode_.empty(); });
+
+            if (finish_)
+            {
+                // Frames that have not been decoded are no longer needed
+                break;
+            }
+
+            XtcFrame* frame = framesToDecode_.front();
+            framesToDecode_.pop();
+
+            // Decode without holding the lock, so other threads can continue
+            lock.unlock();
+            frame->result = xtc_decode_frame(&frame->data, natoms_, &frame->natoms, &frame->step,
+                                             &frame->time, frame->box,
+                                             as_rvec_array(frame->x.data()), &frame->prec);
+            lock.lock();
+
+            frame->isDecoded = true;
+            frameDecoded_.notify_all();
+        }
+    }
+    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+}
+
+XtcFrameReader::XtcFrameReader(t_fileio* fio, const int natoms, const int numThreads) :
+    impl_(new Impl(fio, natoms, numThreads))
+{
+}
+
+XtcFrameReader::~XtcFrameReader() = default;
+
+int XtcFrameReader::readNextFrame(int64_t*  step,
+                                  real*     time,
+                                  matrix    box,
+                                  rvec*     x,
+                                  real*     prec,
+                                  gmx_bool* bOK)
+{
+    if (!impl_->readDirectly_)
+    {
+        impl_->readAhead();
+
+        if (impl_->framesInFileOrder_.empty())
+        {
+            // Read again from after the last frame returned, so failures are reported as usual
+            if (gmx_fio_seek(impl_->fio_, impl_->fileOffset_) != 0)
+            {
+                gmx_fatal(FARGS, "Could not seek in file %s", gmx_fio_getname(impl_->fio_));
+            }
+            impl_->readDirectly_ = true;
+        }
+    }
+    if (impl_->readDirectly_)
+    {
+        const int result = read_next_xtc(impl_->fio_, impl_->natoms_, step, time, box, x, prec, bOK);
+        impl_->fileOffset_ = gmx_fio_ftell(impl_->fio_);
+
+        return result;
+    }
+
+    XtcFrame* frame = impl_->framesInFileOrder_.front();
+    {
+        std::unique_lock<std::mutex> lock(impl_->mutex_);
+
+        impl_->frameDecoded_.wait(lock, [frame]() { return frame->isDecoded; });
+    }
+
+    *step = frame->step;
+    *time = frame->time;
+    copy_mat(frame->box, box);
+    *prec = frame->prec;
+    copy_rvecn(as_rvec_array(frame->x.data()), x, 0, std::min(frame->natoms, impl_->natoms_));
+    *bOK = (frame->result != 0);
+
+    impl_->fileOffset_ = frame->fileOffset;
+    impl_->framesInFileOrder_.pop_front();
+    impl_->freeFrames_.push_back(frame);
+
+    return frame->result;
+}
+
+gmx_off_t XtcFrameReader::fileOffset() const
+{
+    return impl_->fileOffset_;
+}
+
+int xtcDecodingThreadCount()
+{
+    const char* env = getenv("GMX_XTC_DECODING_THREADS");
+    if (env != nullptr)
+    {
+        char*      end;
+        const long numThreads = std::strtol(env, &end, 10);
+        if (end == env || *end != '\0' || numThreads < 0)
+        {
+            gmx_fatal(FARGS,
+                      "Invalid value '%s' for environment variable GMX_XTC_DECODING_THREADS, "
+                      "should be a non-negative integer",
+                      env);
+        }
+        return static_cast<int>(numThreads);
+    }
+
+    return std::min(gmx_omp_get_max_threads(), c_maxDefaultNumDecodingThreads);
+}
+
+} // namespace gmx
@@ -0,0 +1,114 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief Declares a reader that decodes XTC frames in parallel
+ *
+ * \ingroup module_fileio
+ * \inlibraryapi
+ */
+#ifndef GMX_FILEIO_XTCFRAMEREADER_H
+#define GMX_FILEIO_XTCFRAMEREADER_H
+
+#include <cstdint>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/real.h"
+
+struct t_fileio;
+
+namespace gmx
+{
+
+/*! \libinternal
+ * \brief Reads XTC frames and decodes them in parallel on worker threads
+ *
+ * Decoding the compressed positions takes much more time than reading
+ * the frames from file. The reader reads frames on the calling thread
+ * and hands them to worker threads for decoding. Up to two frames per
+ * worker thread are read ahead, so consecutive frames are decoded
+ * simultaneously while the caller processes earlier frames. Frames are
+ * returned in the order they are stored in the file.
+ *
+ * Because frames are read ahead, the file should not be accessed
+ * by other means while the reader exists. After destroying the reader,
+ * the file can be positioned after the last frame returned using
+ * fileOffset().
+ */
+class XtcFrameReader
+{
+public:
+    /*! \brief Constructor, starts the worker threads
+     *
+     * \param[in] fio         The XTC file, positioned at the start of a frame
+     * \param[in] natoms      The number of atoms to read, as for read_next_xtc()
+     * \param[in] numThreads  The number of threads for decoding
+     */
+    XtcFrameReader(t_fileio* fio, int natoms, int numThreads);
+
+    //! Destructor, stops the worker threads
+    ~XtcFrameReader();
+
+    /*! \brief Returns the next frame
+     *
+     * The arguments and return value are as for read_next_xtc().
+     * Once reading ahead fails, the remaining frames are read with
+     * read_next_xtc(), so incomplete frames give identical results.
+     */
+    int readNextFrame(int64_t* step, real* time, matrix box, rvec* x, real* prec, gmx_bool* bOK);
+
+    //! Returns the file offset after the last frame returned by readNextFrame()
+    gmx_off_t fileOffset() const;
+
+private:
+    class Impl;
+
+    PrivateImplPointer<Impl> impl_;
+};
+
+/*! \brief Returns the number of threads to use for decoding XTC frames
+ *
+ * This is given by the environment variable GMX_XTC_DECODING_THREADS
+ * when set and otherwise by the number of OpenMP threads, at most 4.
+ * A value of 1 or less means that frames should not be decoded in parallel.
+ */
+int xtcDecodingThreadCount();
+
+} // namespace gmx
+
+#endif
@@ -39,17 +39,24 @@
 
 #include "xtcio.h"
 
+#include <cstdint>
 #include <cstring>
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
 #include "gromacs/fileio/xdrf.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/smalloc.h"
 
 #define XTC_MAGIC 1995
+/* Magic number of frames with the positions compressed in independent chunks */
+#define XTC_CHUNKED_MAGIC 2021
 
 
 static int xdr_r2f(XDR* xdrs, real* r, gmx_bool gmx_unused bRead)
@@ -87,9 +94,10 @@ void close_xtc(t_fileio* fio)
 
 static void check_xtc_magic(int magic)
 {
-    if (magic != XTC_MAGIC)
+    if (magic != XTC_MAGIC && magic != XTC_CHUNKED_MAGIC)
     {
-        gmx_fatal(FARGS, "Magic Number Error in XTC file (read %d, should be %d)", magic, XTC_MAGIC);
+        gmx_fatal(FARGS, "Magic Number Error in XTC file (read %d, should be %d or %d)", magic,
+                  XTC_MAGIC, XTC_CHUNKED_MAGIC);
     }
 }
 
@@ -138,15 +146,10 @@ static int xtc_header(XDR* xd, int* magic, int* natoms, int64_t* step, real* tim
     return result;
 }
 
-static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_bool bRead)
+static int xtc_box(XDR* xd, rvec* box, gmx_bool bRead)
 {
     int i, j, result;
-#if GMX_DOUBLE
-    float* ftmp;
-    float  fprec;
-#endif
 
-    /* box */
     result = 1;
     for (i = 0; ((i < DIM) && result); i++)
     {
@@ -156,12 +159,18 @@ static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_b
         }
     }
 
-    if (!result)
-    {
-        return result;
-    }
+    return result;
+}
+
+static int xtc_positions(XDR* xd, int* natoms, rvec* x, real* prec, gmx_bool gmx_unused bRead)
+{
+    int result;
 
 #if GMX_DOUBLE
+    int    i;
+    float* ftmp;
+    float  fprec;
+
     /* allocate temp. single-precision array */
     snew(ftmp, (*natoms) * DIM);
 
@@ -197,6 +206,71 @@ static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_b
     return result;
 }
 
+/* Reads the positions of a chunked frame with natoms atoms */
+static int xtc_read_chunked_positions(XDR* xd, int natoms, rvec* x, real* prec)
+{
+    int numChunks;
+
+    if (!XTC_CHECK("chunks", xdr_int(xd, &numChunks)) || numChunks < 0)
+    {
+        return 0;
+    }
+    /* Chunks with up to 9 atoms are stored uncompressed and return
+     * a precision of -1, so we return the largest precision read.
+     */
+    std::vector<float> xFloat(DIM * natoms);
+    float              fprec     = -1;
+    int                atomsRead = 0;
+    for (int chunk = 0; chunk < numChunks; chunk++)
+    {
+        /* The number of atoms is read from the chunk and checked against
+         * the remaining space in the buffer before decoding.
+         */
+        float  chunkPrec;
+        int    chunkNatoms;
+        float* xChunk = xFloat.data() + DIM * atomsRead;
+        if (!XTC_CHECK("x", xdr3dfcoord_read_at_most(xd, xChunk, natoms - atomsRead, &chunkNatoms,
+                                                     &chunkPrec)))
+        {
+            return 0;
+        }
+        atomsRead += chunkNatoms;
+        fprec = std::max(fprec, chunkPrec);
+    }
+    if (!XTC_CHECK("chunks", atomsRead == natoms))
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < natoms; i++)
+    {
+        x[i][XX] = xFloat[DIM * i + XX];
+        x[i][YY] = xFloat[DIM * i + YY];
+        x[i][ZZ] = xFloat[DIM * i + ZZ];
+    }
+    *prec = fprec;
+
+    return 1;
+}
+
+static int
+xtc_coord(XDR* xd, int magic, int* natoms, rvec* box, rvec* x, real* prec, gmx_bool bRead)
+{
+    if (!xtc_box(xd, box, bRead))
+    {
+        return 0;
+    }
+
+    if (magic == XTC_CHUNKED_MAGIC)
+    {
+        GMX_RELEASE_ASSERT(bRead, "Chunked XTC frames are written with write_xtc_chunked");
+
+        return xtc_read_chunked_positions(xd, *natoms, x, prec);
+    }
+
+    return xtc_positions(xd, natoms, x, prec, bRead);
+}
+
 
 int write_xtc(t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec)
 {
@@ -221,7 +295,7 @@ int write_xtc(t_fileio* fio, int natoms, int64_t step, real time, const rvec* bo
     }
 
     /* write data */
-    bOK = xtc_coord(xd, &natoms, const_cast<rvec*>(box), const_cast<rvec*>(x), &prec,
+    bOK = xtc_coord(xd, magic_number, &natoms, const_cast<rvec*>(box), const_cast<rvec*>(x), &prec,
                     FALSE); /* bOK will be 1 if writing went well */
 
     if (bOK)
@@ -253,7 +327,7 @@ int read_first_xtc(t_fileio* fio, int* natoms, int64_t* step, real* time, matrix
 
     snew(*x, *natoms);
 
-    *bOK = (xtc_coord(xd, natoms, box, *x, prec, TRUE) != 0);
+    *bOK = (xtc_coord(xd, magic, natoms, box, *x, prec, TRUE) != 0);
 
     return static_cast<int>(*bOK);
 }
@@ -281,7 +355,271 @@ int read_next_xtc(t_fileio* fio, int natoms, int64_t* step, real* time, matrix b
         gmx_fatal(FARGS, "Frame contains more atoms (%d) than expected (%d)", n, natoms);
     }
 
-    *bOK = (xtc_coord(xd, &natoms, box, x, prec, TRUE) != 0);
+    *bOK = (xtc_coord(xd, magic, &natoms, box, x, prec, TRUE) != 0);
 
     return static_cast<int>(*bOK);
 }
+
+/* Reads one XDR unit from xd and appends it to frameData, also returns
+ * the value as an integer. Floats are copied unmodified as integers.
+ */
+static int xtc_copy_unit(XDR* xd, std::vector<char>* frameData, int* value)
+{
+    if (xdr_int(xd, value) == 0)
+    {
+        return 0;
+    }
+    const auto unit = static_cast<uint32_t>(*value);
+    frameData->push_back(static_cast<char>(unit >> 24));
+    frameData->push_back(static_cast<char>(unit >> 16));
+    frameData->push_back(static_cast<char>(unit >> 8));
+    frameData->push_back(static_cast<char>(unit));
+
+    return 1;
+}
+
+/* Copies the positions written by xdr3dfcoord from xd to frameData */
+static int xtc_copy_positions(XDR* xd, std::vector<char>* frameData)
+{
+    int natoms;
+    int value;
+
+    if (!XTC_CHECK("natoms", xtc_copy_unit(xd, frameData, &natoms)) || natoms < 0)
+    {
+        return 0;
+    }
+    /* Up to 9 atoms are stored as floats, otherwise the precision, minimum
+     * and maximum integers and smallidx precede the compressed data
+     */
+    const int numUnits = (natoms <= 9 ? DIM * natoms : 2 + 2 * DIM);
+    for (int i = 0; i < numUnits; i++)
+    {
+        if (!XTC_CHECK("x", xtc_copy_unit(xd, frameData, &value)))
+        {
+            return 0;
+        }
+    }
+    if (natoms <= 9)
+    {
+        return 1;
+    }
+
+    /* The compressed size is less than 16 bytes per atom, larger sizes
+     * only occur with corrupted files
+     */
+    int numBytes;
+    if (!XTC_CHECK("x", xtc_copy_unit(xd, frameData, &numBytes)) || numBytes < 0
+        || numBytes > 16 * static_cast<int64_t>(natoms))
+    {
+        return 0;
+    }
+    /* The data is padded to whole XDR units */
+    const int    numDataUnits = (numBytes + BYTES_PER_XDR_UNIT - 1) / BYTES_PER_XDR_UNIT;
+    const size_t offset       = frameData->size();
+    frameData->resize(offset + numDataUnits * BYTES_PER_XDR_UNIT, 0);
+
+    return XTC_CHECK("x", xdr_opaque(xd, frameData->data() + offset, numBytes));
+}
+
+int xtc_read_frame_data(t_fileio* fio, int natoms, std::vector<char>* frameData, gmx_bool* bOK)
+{
+    int  magic, n, step, time, value;
+    XDR* xd;
+
+    frameData->clear();
+    *bOK = TRUE;
+    xd   = gmx_fio_getxdr(fio);
+
+    /* Read and check the header as read_next_xtc does */
+    if (xtc_copy_unit(xd, frameData, &magic) == 0)
+    {
+        return 0;
+    }
+    *bOK = (XTC_CHECK("natoms", xtc_copy_unit(xd, frameData, &n))
+            && XTC_CHECK("step", xtc_copy_unit(xd, frameData, &step))
+            && XTC_CHECK("time", xtc_copy_unit(xd, frameData, &time)));
+    if (!*bOK)
+    {
+        return 0;
+    }
+    check_xtc_magic(magic);
+    if (n > natoms)
+    {
+        gmx_fatal(FARGS, "Frame contains more atoms (%d) than expected (%d)", n, natoms);
+    }
+
+    for (int i = 0; i < DIM * DIM && *bOK; i++)
+    {
+        *bOK = XTC_CHECK("box", xtc_copy_unit(xd, frameData, &value));
+    }
+    if (*bOK && magic == XTC_CHUNKED_MAGIC)
+    {
+        int numChunks;
+        *bOK = (XTC_CHECK("chunks", xtc_copy_unit(xd, frameData, &numChunks)) && numChunks >= 0);
+        for (int chunk = 0; chunk < numChunks && *bOK; chunk++)
+        {
+            *bOK = xtc_copy_positions(xd, frameData);
+        }
+    }
+    else if (*bOK)
+    {
+        *bOK = xtc_copy_positions(xd, frameData);
+    }
+
+    return static_cast<int>(*bOK);
+}
+
+int xtc_decode_frame(std::vector<char>* frameData,
+                     int                natoms,
+                     int*               frameNatoms,
+                     int64_t*           step,
+                     real*              time,
+                     matrix             box,
+                     rvec*              x,
+                     real*              prec)
+{
+    int      magic;
+    XDR      xd;
+    gmx_bool bOK;
+
+    xdrmem_create(&xd, frameData->data(), static_cast<unsigned int>(frameData->size()), XDR_DECODE);
+    int result = xtc_header(&xd, &magic, frameNatoms, step, time, TRUE, &bOK);
+    if (result)
+    {
+        result = xtc_coord(&xd, magic, &natoms, box, x, prec, TRUE);
+    }
+    xdr_destroy(&xd);
+
+    return result;
+}
+
+/* Skips numBytes bytes of fio */
+static int xtc_skip_bytes(t_fileio* fio, gmx_off_t numBytes)
+{
+    return static_cast<int>(gmx_fio_seek(fio, gmx_fio_ftell(fio) + numBytes) == 0);
+}
+
+/* Skips the positions written by xdr3dfcoord in fio, without reading them */
+static int xtc_skip_positions(t_fileio* fio)
+{
+    XDR* xd = gmx_fio_getxdr(fio);
+    int  natoms;
+    int  value;
+
+    if (!XTC_CHECK("natoms", xdr_int(xd, &natoms)) || natoms < 0)
+    {
+        return 0;
+    }
+    if (natoms <= 9)
+    {
+        return XTC_CHECK("x", xtc_skip_bytes(fio, DIM * natoms * BYTES_PER_XDR_UNIT));
+    }
+    /* Skip the precision, the minimum and maximum integers and smallidx */
+    for (int i = 0; i < 2 + 2 * DIM; i++)
+    {
+        if (!XTC_CHECK("x", xdr_int(xd, &value)))
+        {
+            return 0;
+        }
+    }
+    int numBytes;
+    if (!XTC_CHECK("x", xdr_int(xd, &numBytes)) || numBytes < 0
+        || numBytes > 16 * static_cast<int64_t>(natoms))
+    {
+        return 0;
+    }
+    /* The data is padded to whole XDR units */
+    const int numDataUnits = (numBytes + BYTES_PER_XDR_UNIT - 1) / BYTES_PER_XDR_UNIT;
+
+    return XTC_CHECK("x", xtc_skip_bytes(fio, numDataUnits * BYTES_PER_XDR_UNIT));
+}
+
+int xtc_skip_frame(t_fileio* fio, int* natoms, int64_t* step, real* time, gmx_bool* bOK)
+{
+    int    magic;
+    matrix box;
+    XDR*   xd;
+
+    *bOK = TRUE;
+    xd   = gmx_fio_getxdr(fio);
+
+    if (!xtc_header(xd, &magic, natoms, step, time, TRUE, bOK))
+    {
+        return 0;
+    }
+    check_xtc_magic(magic);
+
+    *bOK = (xtc_box(xd, box, TRUE) != 0);
+    if (*bOK && magic == XTC_CHUNKED_MAGIC)
+    {
+        int numChunks;
+        *bOK = (XTC_CHECK("chunks", xdr_int(xd, &numChunks)) && numChunks >= 0);
+        for (int chunk = 0; chunk < numChunks && *bOK; chunk++)
+        {
+            *bOK = xtc_skip_positions(fio);
+        }
+    }
+    else if (*bOK)
+    {
+        *bOK = xtc_skip_positions(fio);
+    }
+
+    return static_cast<int>(*bOK);
+}
+
+int xtc_compress_positions(int natoms, const rvec* x, real prec, std::vector<char>* buffer)
+{
+    /* The compressed size is at most 12 bytes per atom plus some headers
+     * and bit flags, 16 bytes per atom leaves ample margin.
+     */
+    buffer->resize(64 + 16 * static_cast<size_t>(natoms));
+
+    XDR xd;
+    xdrmem_create(&xd, buffer->data(), static_cast<unsigned int>(buffer->size()), XDR_ENCODE);
+    int bOK = xtc_positions(&xd, &natoms, const_cast<rvec*>(x), &prec, FALSE);
+    buffer->resize(bOK ? xdr_getpos(&xd) : 0);
+    xdr_destroy(&xd);
+
+    return bOK;
+}
+
+int write_xtc_chunked(t_fileio*   fio,
+                      int         natoms,
+                      int64_t     step,
+                      real        time,
+                      const rvec* box,
+                      int         numChunks,
+                      const char* chunkData,
+                      int         numBytes)
+{
+    int      magic_number = XTC_CHUNKED_MAGIC;
+    XDR*     xd;
+    gmx_bool bDum;
+
+    if (!fio)
+    {
+        return 1;
+    }
+
+    xd = gmx_fio_getxdr(fio);
+    if (xtc_header(xd, &magic_number, &natoms, &step, &time, FALSE, &bDum) == 0)
+    {
+        return 0;
+    }
+    if (!xtc_box(xd, const_cast<rvec*>(box), FALSE)
+        || !XTC_CHECK("chunks", xdr_int(xd, &numChunks)))
+    {
+        return 0;
+    }
+    /* The chunks are complete XDR streams, so their size is a multiple of 4 bytes
+     * and xdr_opaque writes them without padding.
+     */
+    GMX_RELEASE_ASSERT(numBytes % BYTES_PER_XDR_UNIT == 0,
+                       "Compressed chunks should have a size that is a multiple of 4");
+    if (!XTC_CHECK("chunks", xdr_opaque(xd, const_cast<char*>(chunkData), numBytes)))
+    {
+        return 0;
+    }
+
+    return static_cast<int>(gmx_fio_flush(fio) == 0);
+}
@@ -39,6 +39,8 @@
 #ifndef GMX_FILEIO_XTCIO_H
 #define GMX_FILEIO_XTCIO_H
 
+#include <vector>
+
 #include "gromacs/math/vectypes.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/real.h"
@@ -78,4 +80,59 @@ int read_next_xtc(struct t_fileio* fio, int natoms, int64_t* step, real* time, m
 int write_xtc(struct t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec);
 /* Write a frame to xtc file */
 
+int xtc_read_frame_data(struct t_fileio*   fio,
+                        int                natoms,
+                        std::vector<char>* frameData,
+                        gmx_bool*          bOK);
+/* Read the next frame as it is stored in the file into frameData,
+ * without decompressing the positions, the return value and bOK are
+ * as for read_next_xtc
+ */
+
+int xtc_decode_frame(std::vector<char>* frameData,
+                     int                natoms,
+                     int*               frameNatoms,
+                     int64_t*           step,
+                     real*              time,
+                     matrix             box,
+                     rvec*              x,
+                     real*              prec);
+/* Decode a frame read with xtc_read_frame_data, with the same result as
+ * read_next_xtc, also returns the number of atoms in the frame in
+ * frameNatoms. Different frames can be decoded simultaneously by
+ * different threads.
+ */
+
+int xtc_skip_frame(struct t_fileio* fio, int* natoms, int64_t* step, real* time, gmx_bool* bOK);
+/* Read the header of the next frame and skip the positions without
+ * reading them, the return value and bOK are as for read_next_xtc.
+ * Skipping past the end of the file is not detected, so the caller
+ * should check that the file offset after the frame is within the file.
+ */
+
+/* Chunked frames store the positions as a sequence of independently
+ * compressed chunks of consecutive atoms, so the chunks can be compressed
+ * in parallel, e.g. by different ranks. They use a different magic number
+ * from normal frames. Reading files with chunked frames is only supported
+ * by GROMACS versions that write them.
+ */
+
+int xtc_compress_positions(int natoms, const rvec* x, real prec, std::vector<char>* buffer);
+/* Compress the natoms positions x with precision prec into buffer,
+ * for writing as one of the chunks of a chunked frame
+ */
+
+int write_xtc_chunked(struct t_fileio* fio,
+                      int              natoms,
+                      int64_t          step,
+                      real             time,
+                      const rvec*      box,
+                      int              numChunks,
+                      const char*      chunkData,
+                      int              numBytes);
+/* Write a chunked frame with natoms atoms to xtc file, chunkData should
+ * contain the numChunks concatenated outputs of xtc_compress_positions()
+ * of numBytes bytes in total
+ */
+
 #endif
@@ -56,6 +56,7 @@
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/mdtypes/mdatom.h"
 #include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/utility/fatalerror.h"
 
 
@@ -64,6 +65,7 @@ struct ScalarDataTypes
 {
     using RealType                     = real; //!< The data type to use as real.
     using IntType                      = int;  //!< The data type to use as int.
+    using BoolType                     = bool; //!< The data type to use as bool for real value comparison.
     static constexpr int simdRealWidth = 1;    //!< The width of the RealType.
     static constexpr int simdIntWidth  = 1;    //!< The width of the IntType.
 };
@@ -72,19 +74,24 @@ struct ScalarDataTypes
 //! SIMD data types.
 struct SimdDataTypes
 {
-    using RealType                     = gmx::SimdReal;         //!< The data type to use as real.
-    using IntType                      = gmx::SimdInt32;        //!< The data type to use as int.
-    static constexpr int simdRealWidth = GMX_SIMD_REAL_WIDTH;   //!< The width of the RealType.
-    static constexpr int simdIntWidth  = GMX_SIMD_FINT32_WIDTH; //!< The width of the IntType.
+    using RealType                     = gmx::SimdReal;       //!< The data type to use as real.
+    using IntType                      = gmx::SimdInt32;      //!< The data type to use as int.
+    using BoolType                     = gmx::SimdBool;       //!< The data type to use as bool for real value comparison.
+    static constexpr int simdRealWidth = GMX_SIMD_REAL_WIDTH; //!< The width of the RealType.
+#    if GMX_DOUBLE
+    static constexpr int simdIntWidth = GMX_SIMD_DINT32_WIDTH; //!< The width of the IntType.
+#    else
+    static constexpr int simdIntWidth = GMX_SIMD_FINT32_WIDTH; //!< The width of the IntType.
+#    endif
 };
 #endif
 
-//! Computes r^(1/p) and 1/r^(1/p) for the standard p=6
-template<class RealType>
-static inline void pthRoot(const RealType r, RealType* pthRoot, RealType* invPthRoot)
+//! Computes r^(1/p) and 1/r^(1/p) for the standard p=6, returns zero for masked out entries
+template<class RealType, class BoolType>
+static inline void pthRoot(const RealType r, RealType* pthRoot, RealType* invPthRoot, const BoolType mask)
 {
-    *invPthRoot = gmx::invsqrt(std::cbrt(r));
-    *pthRoot    = 1 / (*invPthRoot);
+    *invPthRoot = gmx::maskzInvsqrt(gmx::cbrt(r), mask);
+    *pthRoot    = gmx::maskzInv(*invPthRoot, mask);
 }
 
 template<class RealType>
@@ -158,41 +165,66 @@ static inline RealType lennardJonesPotential(const RealType v6,
 }
 
 /* Ewald LJ */
-static inline real ewaldLennardJonesGridSubtract(const real c6grid, const real potentialShift, const real onesixth)
+template<class RealType>
+static inline RealType ewaldLennardJonesGridSubtract(const RealType c6grid,
+                                                     const real     potentialShift,
+                                                     const real     onesixth)
 {
     return (c6grid * potentialShift * onesixth);
 }
 
-/* LJ Potential switch */
-template<class RealType>
+/* LJ Potential switch, the mask should select r < rVdw */
+template<class RealType, class BoolType>
 static inline RealType potSwitchScalarForceMod(const RealType fScalarInp,
                                                const RealType potential,
                                                const RealType sw,
                                                const RealType r,
-                                               const RealType rVdw,
                                                const RealType dsw,
-                                               const real     zero)
+                                               const BoolType mask)
 {
-    if (r < rVdw)
-    {
-        real fScalar = fScalarInp * sw - r * potential * dsw;
-        return (fScalar);
-    }
-    return (zero);
+    const RealType fScalar = fScalarInp * sw - r * potential * dsw;
+    return (gmx::selectByMask(fScalar, mask));
 }
-template<class RealType>
-static inline RealType potSwitchPotentialMod(const RealType potentialInp,
-                                             const RealType sw,
-                                             const RealType r,
-                                             const RealType rVdw,
-                                             const real     zero)
+template<class RealType, class BoolType>
+static inline RealType potSwitchPotentialMod(const RealType potentialInp, const RealType sw, const BoolType mask)
 {
-    if (r < rVdw)
+    const RealType potential = potentialInp * sw;
+    return (gmx::selectByMask(potential, mask));
+}
+
+/*! \brief Looks up the LJ-Ewald force and potential table entries at \p index
+ *
+ * The tables have no padding, so they do not fulfill the alignment requirements
+ * of the SIMD gather routines. As LJ-PME with perturbed atoms is rare, we simply
+ * look up the entries per element.
+ */
+template<class DataTypes>
+static inline void ljEwaldTableLookup(const real*                   tableF,
+                                      const real*                   tableV,
+                                      typename DataTypes::IntType   index,
+                                      typename DataTypes::RealType* fLow,
+                                      typename DataTypes::RealType* fHigh,
+                                      typename DataTypes::RealType* v)
+{
+    using RealType = typename DataTypes::RealType;
+
+    constexpr int simdRealWidth = DataTypes::simdRealWidth;
+
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t indexBuffer[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real         fLowBuffer[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real         fHighBuffer[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real         vBuffer[simdRealWidth];
+
+    gmx::store(indexBuffer, index);
+    for (int s = 0; s < simdRealWidth; s++)
     {
-        real potential = potentialInp * sw;
-        return (potential);
+        fLowBuffer[s]  = tableF[indexBuffer[s]];
+        fHighBuffer[s] = tableF[indexBuffer[s] + 1];
+        vBuffer[s]     = tableV[indexBuffer[s]];
     }
-    return (zero);
+    *fLow  = gmx::load<RealType>(fLowBuffer);
+    *fHigh = gmx::load<RealType>(fHighBuffer);
+    *v     = gmx::load<RealType>(vBuffer);
 }
 
 
@@ -212,26 +244,38 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
 
     using RealType = typename DataTypes::RealType;
     using IntType  = typename DataTypes::IntType;
+    using BoolType = typename DataTypes::BoolType;
+
+    constexpr int simdRealWidth = DataTypes::simdRealWidth;
+
+    static_assert(DataTypes::simdIntWidth == simdRealWidth,
+                  "The table lookups require equal real and int SIMD widths");
+    /* The preload buffers below are two-dimensional, the rows need to be aligned */
+    static_assert(simdRealWidth == 1 || (simdRealWidth * sizeof(real)) % GMX_SIMD_ALIGNMENT == 0,
+                  "A row of SIMD reals should be a multiple of the SIMD alignment");
 
-    /* FIXME: How should these be handled with SIMD? */
     constexpr real onetwelfth = 1.0 / 12.0;
     constexpr real onesixth   = 1.0 / 6.0;
     constexpr real zero       = 0.0;
     constexpr real half       = 0.5;
     constexpr real one        = 1.0;
     constexpr real two        = 2.0;
-    constexpr real six        = 6.0;
 
     /* Extract pointer to non-bonded interaction constants */
     const interaction_const_t* ic = fr->ic;
 
     // Extract pair list data
-    const int  nri    = nlist->nri;
-    const int* iinr   = nlist->iinr;
-    const int* jindex = nlist->jindex;
-    const int* jjnr   = nlist->jjnr;
-    const int* shift  = nlist->shift;
-    const int* gid    = nlist->gid;
+    const int   nri          = nlist->nri;
+    const int   iClusterSize = nlist->iClusterSize;
+    const int*  iinr         = nlist->iinr;
+    const int*  jindex       = nlist->jindex;
+    const int*  jjnr         = nlist->jjnr;
+    const char* excl_fep     = nlist->excl_fep;
+    const int*  shift        = nlist->shift;
+    const int*  gid          = nlist->gid;
+
+    GMX_RELEASE_ASSERT(iClusterSize >= 1 && iClusterSize <= c_fepListMaxIClusterSize,
+                       "The number of i-atoms per list entry should be in the supported range");
 
     const real* shiftvec      = fr->shift_vec[0];
     const real* chargeA       = mdatoms->chargeA;
@@ -343,8 +387,9 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
     GMX_RELEASE_ASSERT(!(vdwInteractionTypeIsEwald && vdwModifierIsPotSwitch),
                        "Can not apply soft-core to switched Ewald potentials");
 
-    real dvdl_coul = 0;
-    real dvdl_vdw  = 0;
+    RealType dvdl_coul = zero;
+    RealType dvdl_vdw  = zero;
+    int      numPairs  = 0;
 
     /* Lambda factor for state A, 1-lambda*/
     real LFC[NSTATES], LFV[NSTATES];
@@ -370,6 +415,35 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
         dlfac_vdw[i]  = DLF[i] * lam_power / sc_r_power * (lam_power == 2 ? (1 - LFV[i]) : 1);
     }
 
+    /* The j-particle data of simdRealWidth pairs is gathered into these
+     * buffers, so it can be loaded into SIMD registers. The j-atom data
+     * is gathered once per list entry and shared by all i-atoms in the entry.
+     * Masked-out entries (beyond the end of the list or absent for
+     * the i-atom) are marked as neither included nor excluded.
+     * The pair parameters that only depend on the atom types,
+     * including the soft-core sigma and alpha values, are computed
+     * per pair while gathering, this is cheap compared to the interactions.
+     */
+    int                              preloadTypeJ[NSTATES][simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadXj[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadYj[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadZj[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadPairIncluded[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadPairExcluded[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadSelfFactor[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadAlphaVdwEff[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadAlphaCoulEff[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real withinCutoffBuffer[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadQq[NSTATES][simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadC6[NSTATES][simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadC12[NSTATES][simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadSigma6[NSTATES][simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real preloadC6Grid[NSTATES][simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real forceBufferX[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real forceBufferY[simdRealWidth];
+    alignas(GMX_SIMD_ALIGNMENT) real forceBufferZ[simdRealWidth];
+    int                              preloadJnr[simdRealWidth];
+
     // TODO: We should get rid of using pointers to real
     const real* x             = xx[0];
     real* gmx_restrict f      = &(forceWithShiftForces->force()[0][0]);
@@ -377,468 +451,626 @@ static void nb_free_energy_kernel(const t_nblist* gmx_restrict nlist,
 
     for (int n = 0; n < nri; n++)
     {
-        int npair_within_cutoff = 0;
-
-        const int  is3   = 3 * shift[n];
-        const real shX   = shiftvec[is3];
-        const real shY   = shiftvec[is3 + 1];
-        const real shZ   = shiftvec[is3 + 2];
-        const int  nj0   = jindex[n];
-        const int  nj1   = jindex[n + 1];
-        const int  ii    = iinr[n];
-        const int  ii3   = 3 * ii;
-        const real ix    = shX + x[ii3 + 0];
-        const real iy    = shY + x[ii3 + 1];
-        const real iz    = shZ + x[ii3 + 2];
-        const real iqA   = facel * chargeA[ii];
-        const real iqB   = facel * chargeB[ii];
-        const int  ntiA  = 2 * ntype * typeA[ii];
-        const int  ntiB  = 2 * ntype * typeB[ii];
-        real       vctot = 0;
-        real       vvtot = 0;
-        real       fix   = 0;
-        real       fiy   = 0;
-        real       fiz   = 0;
-
-        for (int k = nj0; k < nj1; k++)
+        const int  is3 = 3 * shift[n];
+        const real shX = shiftvec[is3];
+        const real shY = shiftvec[is3 + 1];
+        const real shZ = shiftvec[is3 + 2];
+        const int  nj0 = jindex[n];
+        const int  nj1 = jindex[n + 1];
+
+        /* The data for the i-atoms in this entry, unused slots have index -1 */
+        int      iAtom[c_fepListMaxIClusterSize];
+        real     ix[c_fepListMaxIClusterSize];
+        real     iy[c_fepListMaxIClusterSize];
+        real     iz[c_fepListMaxIClusterSize];
+        real     iqA[c_fepListMaxIClusterSize];
+        real     iqB[c_fepListMaxIClusterSize];
+        int      ntiA[c_fepListMaxIClusterSize];
+        int      ntiB[c_fepListMaxIClusterSize];
+        int      npair_within_cutoff[c_fepListMaxIClusterSize];
+        RealType fix[c_fepListMaxIClusterSize];
+        RealType fiy[c_fepListMaxIClusterSize];
+        RealType fiz[c_fepListMaxIClusterSize];
+        for (int c = 0; c < iClusterSize; c++)
         {
-            int            tj[NSTATES];
-            const int      jnr = jjnr[k];
-            const int      j3  = 3 * jnr;
-            RealType       c6[NSTATES], c12[NSTATES], qq[NSTATES], Vcoul[NSTATES], Vvdw[NSTATES];
-            RealType       r, rinv, rp, rpm2;
-            RealType       alpha_vdw_eff, alpha_coul_eff, sigma6[NSTATES];
-            const RealType dx  = ix - x[j3];
-            const RealType dy  = iy - x[j3 + 1];
-            const RealType dz  = iz - x[j3 + 2];
-            const RealType rsq = dx * dx + dy * dy + dz * dz;
-            RealType       FscalC[NSTATES], FscalV[NSTATES];
-            /* Check if this pair on the exlusions list.*/
-            const bool bPairIncluded = nlist->excl_fep == nullptr || nlist->excl_fep[k];
-
-            if (rsq >= rcutoff_max2 && bPairIncluded)
-            {
-                /* We save significant time by skipping all code below.
-                 * Note that with soft-core interactions, the actual cut-off
-                 * check might be different. But since the soft-core distance
-                 * is always larger than r, checking on r here is safe.
-                 * Exclusions outside the cutoff can not be skipped as
-                 * when using Ewald: the reciprocal-space
-                 * Ewald component still needs to be subtracted.
-                 */
-
-                continue;
-            }
-            npair_within_cutoff++;
-
-            if (rsq > 0)
+            const int ii = iinr[n * iClusterSize + c];
+            iAtom[c]     = ii;
+            if (ii >= 0)
             {
-                /* Note that unlike in the nbnxn kernels, we do not need
-                 * to clamp the value of rsq before taking the invsqrt
-                 * to avoid NaN in the LJ calculation, since here we do
-                 * not calculate LJ interactions when C6 and C12 are zero.
-                 */
-
-                rinv = gmx::invsqrt(rsq);
-                r    = rsq * rinv;
-            }
-            else
-            {
-                /* The force at r=0 is zero, because of symmetry.
-                 * But note that the potential is in general non-zero,
-                 * since the soft-cored r will be non-zero.
-                 */
-                rinv = 0;
-                r    = 0;
+                const int ii3 = 3 * ii;
+                ix[c]         = shX + x[ii3 + 0];
+                iy[c]         = shY + x[ii3 + 1];
+                iz[c]         = shZ + x[ii3 + 2];
+                iqA[c]        = facel * chargeA[ii];
+                iqB[c]        = facel * chargeB[ii];
+                ntiA[c]       = 2 * ntype * typeA[ii];
+                ntiB[c]       = 2 * ntype * typeB[ii];
             }
+            npair_within_cutoff[c] = 0;
+            fix[c]                 = zero;
+            fiy[c]                 = zero;
+            fiz[c]                 = zero;
+        }
+        RealType vctot = zero;
+        RealType vvtot = zero;
 
-            if (useSoftCore)
-            {
-                rpm2 = rsq * rsq;  /* r4 */
-                rp   = rpm2 * rsq; /* r6 */
-            }
-            else
+        for (int k = nj0; k < nj1; k += simdRealWidth)
+        {
+            /* Gather the j-atom data, which is shared by all i-atoms */
+            for (int s = 0; s < simdRealWidth; s++)
             {
-                /* The soft-core power p will not affect the results
-                 * with not using soft-core, so we use power of 0 which gives
-                 * the simplest math and cheapest code.
-                 */
-                rpm2 = rinv * rinv;
-                rp   = 1;
+                /* Masked-out entries get the data of the first pair */
+                const int kPair = (k + s < nj1 ? k + s : k);
+                const int jnr   = jjnr[kPair];
+                const int j3    = 3 * jnr;
+
+                preloadJnr[s]            = jnr;
+                preloadXj[s]             = x[j3];
+                preloadYj[s]             = x[j3 + 1];
+                preloadZj[s]             = x[j3 + 2];
+                preloadTypeJ[STATE_A][s] = 2 * typeA[jnr];
+                preloadTypeJ[STATE_B][s] = 2 * typeB[jnr];
             }
+            const RealType xj = gmx::load<RealType>(preloadXj);
+            const RealType yj = gmx::load<RealType>(preloadYj);
+            const RealType zj = gmx::load<RealType>(preloadZj);
 
-            RealType Fscal = 0;
+            /* The j-force and the count of i-atoms within the cut-off per j-atom */
+            RealType fjx              = zero;
+            RealType fjy              = zero;
+            RealType fjz              = zero;
+            RealType numIWithinCutoff = zero;
 
-            qq[STATE_A] = iqA * chargeA[jnr];
-            qq[STATE_B] = iqB * chargeB[jnr];
-
-            tj[STATE_A] = ntiA + 2 * typeA[jnr];
-            tj[STATE_B] = ntiB + 2 * typeB[jnr];
-
-            if (bPairIncluded)
+            for (int c = 0; c < iClusterSize; c++)
             {
-                c6[STATE_A] = nbfp[tj[STATE_A]];
-                c6[STATE_B] = nbfp[tj[STATE_B]];
-
-                for (int i = 0; i < NSTATES; i++)
+                const int ii = iAtom[c];
+                if (ii < 0)
                 {
-                    c12[i] = nbfp[tj[i] + 1];
-                    if (useSoftCore)
-                    {
-                        if ((c6[i] > 0) && (c12[i] > 0))
-                        {
-                            /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
-                            sigma6[i] = half * c12[i] / c6[i];
-                            if (sigma6[i] < sigma6_min) /* for disappearing coul and vdw with soft core at the same time */
-                            {
-                                sigma6[i] = sigma6_min;
-                            }
-                        }
-                        else
-                        {
-                            sigma6[i] = sigma6_def;
-                        }
-                    }
+                    continue;
                 }
 
-                if (useSoftCore)
+                bool haveAnyPair = false;
+                for (int s = 0; s < simdRealWidth; s++)
                 {
-                    /* only use softcore if one of the states has a zero endstate - softcore is for avoiding infinities!*/
-                    if ((c12[STATE_A] > 0) && (c12[STATE_B] > 0))
-                    {
-                        alpha_vdw_eff  = 0;
-                        alpha_coul_eff = 0;
-                    }
-                    else
+                    const bool isValidPair = (k + s < nj1);
+                    const int  kPair       = (isValidPair ? k + s : k);
+                    /* Check if this pair is on the exclusions list, or absent for this i-atom */
+                    const int pairState = (excl_fep == nullptr ? static_cast<int>(efepPairIncluded)
+                                                               : excl_fep[kPair * iClusterSize + c]);
+
+                    preloadPairIncluded[s] = (isValidPair && pairState == efepPairIncluded) ? one : zero;
+                    preloadPairExcluded[s] = (isValidPair && pairState == efepPairExcluded) ? one : zero;
+                    if (isValidPair && pairState != efepPairAbsent)
                     {
-                        alpha_vdw_eff  = alpha_vdw;
-                        alpha_coul_eff = alpha_coul;
+                        haveAnyPair = true;
+                        numPairs++;
                     }
                 }
+                if (!haveAnyPair)
+                {
+                    continue;
+                }
 
-                for (int i = 0; i < NSTATES; i++)
+                for (int s = 0; s < simdRealWidth; s++)
                 {
-                    FscalC[i] = 0;
-                    FscalV[i] = 0;
-                    Vcoul[i]  = 0;
-                    Vvdw[i]   = 0;
+                    const int jnr = preloadJnr[s];
+
+                    /* A self-interaction, which can only occur with excluded pairs,
+                     * occurs twice. Scale it down by 50% to only include it once.
+                     */
+                    preloadSelfFactor[s] = (ii == jnr) ? half : one;
+
+                    preloadQq[STATE_A][s] = iqA[c] * chargeA[jnr];
+                    preloadQq[STATE_B][s] = iqB[c] * chargeB[jnr];
 
-                    RealType rinvC, rinvV, rC, rV, rpinvC, rpinvV;
+                    int tj[NSTATES];
+                    tj[STATE_A] = ntiA[c] + preloadTypeJ[STATE_A][s];
+                    tj[STATE_B] = ntiB[c] + preloadTypeJ[STATE_B][s];
 
-                    /* Only spend time on A or B state if it is non-zero */
-                    if ((qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0))
+                    for (int i = 0; i < NSTATES; i++)
                     {
-                        /* this section has to be inside the loop because of the dependence on sigma6 */
+                        const real c6  = nbfp[tj[i]];
+                        const real c12 = nbfp[tj[i] + 1];
+
+                        preloadC6[i][s]  = c6;
+                        preloadC12[i][s] = c12;
+                        if (vdwInteractionTypeIsEwald)
+                        {
+                            preloadC6Grid[i][s] = nbfp_grid[tj[i]];
+                        }
                         if (useSoftCore)
                         {
-                            rpinvC = one / (alpha_coul_eff * lfac_coul[i] * sigma6[i] + rp);
-                            pthRoot(rpinvC, &rinvC, &rC);
-                            if (scLambdasOrAlphasDiffer)
+                            if ((c6 > 0) && (c12 > 0))
                             {
-                                rpinvV = one / (alpha_vdw_eff * lfac_vdw[i] * sigma6[i] + rp);
-                                pthRoot(rpinvV, &rinvV, &rV);
+                                /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
+                                real sigma6 = half * c12 / c6;
+                                if (sigma6 < sigma6_min) /* for disappearing coul and vdw with soft core at the same time */
+                                {
+                                    sigma6 = sigma6_min;
+                                }
+                                preloadSigma6[i][s] = sigma6;
                             }
                             else
                             {
-                                /* We can avoid one expensive pow and one / operation */
-                                rpinvV = rpinvC;
-                                rinvV  = rinvC;
-                                rV     = rC;
+                                preloadSigma6[i][s] = sigma6_def;
                             }
                         }
+                    }
+
+                    if (useSoftCore)
+                    {
+                        /* only use softcore if one of the states has a zero endstate - softcore is for avoiding infinities!*/
+                        if ((preloadC12[STATE_A][s] > 0) && (preloadC12[STATE_B][s] > 0))
+                        {
+                            preloadAlphaVdwEff[s]  = 0;
+                            preloadAlphaCoulEff[s] = 0;
+                        }
                         else
                         {
-                            rpinvC = 1;
-                            rinvC  = rinv;
-                            rC     = r;
-
-                            rpinvV = 1;
-                            rinvV  = rinv;
-                            rV     = r;
+                            preloadAlphaVdwEff[s]  = alpha_vdw;
+                            preloadAlphaCoulEff[s] = alpha_coul;
                         }
+                    }
+                }
 
-                        /* Only process the coulomb interactions if we have charges,
-                         * and if we either include all entries in the list (no cutoff
-                         * used in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeElecInteraction = (elecInteractionTypeIsEwald && r < rcoulomb)
-                                                      || (!elecInteractionTypeIsEwald && rC < rcoulomb);
+                RealType       c6[NSTATES], c12[NSTATES], qq[NSTATES], Vcoul[NSTATES], Vvdw[NSTATES];
+                RealType       rp, rpm2;
+                RealType       alpha_vdw_eff, alpha_coul_eff, sigma6[NSTATES];
+                const RealType dx  = ix[c] - xj;
+                const RealType dy  = iy[c] - yj;
+                const RealType dz  = iz[c] - zj;
+                const RealType rsq = dx * dx + dy * dy + dz * dz;
+                RealType       FscalC[NSTATES], FscalV[NSTATES];
+
+                const BoolType bPairIncluded = (zero < gmx::load<RealType>(preloadPairIncluded));
+                const BoolType bPairExcluded = (zero < gmx::load<RealType>(preloadPairExcluded));
+
+                /* We save significant time by skipping all code below for pairs
+                 * beyond the cut-off. Note that with soft-core interactions,
+                 * the actual cut-off check might be different. But since the
+                 * soft-core distance is always larger than r, checking on r here
+                 * is safe. Exclusions outside the cutoff can not be skipped as
+                 * when using Ewald: the reciprocal-space Ewald component still
+                 * needs to be subtracted.
+                 */
+                const BoolType withinCutoffMask = (rsq < rcutoff_max2 && bPairIncluded) || bPairExcluded;
+                if (!gmx::anyTrue(withinCutoffMask))
+                {
+                    continue;
+                }
+                npair_within_cutoff[c]++;
+
+                /* Included pairs within the cut-off */
+                const BoolType computeInteractionMask = withinCutoffMask && bPairIncluded;
 
-                        if ((qq[i] != 0) && computeElecInteraction)
+                /* Note that unlike in the nbnxn kernels, we do not need
+                 * to clamp the value of rsq before taking the invsqrt
+                 * to avoid NaN in the LJ calculation, since here we do
+                 * not calculate LJ interactions when C6 and C12 are zero.
+                 *
+                 * The force at r=0 is zero, because of symmetry.
+                 * But note that the potential is in general non-zero,
+                 * since the soft-cored r will be non-zero.
+                 * Masked-out entries get r=0, which is safe for the table lookups.
+                 */
+                const RealType rinv = gmx::maskzInvsqrt(rsq, zero < rsq && withinCutoffMask);
+                const RealType r    = rsq * rinv;
+
+                if (useSoftCore)
+                {
+                    rpm2 = rsq * rsq;  /* r4 */
+                    rp   = rpm2 * rsq; /* r6 */
+                }
+                else
+                {
+                    /* The soft-core power p will not affect the results
+                     * with not using soft-core, so we use power of 0 which gives
+                     * the simplest math and cheapest code.
+                     */
+                    rpm2 = rinv * rinv;
+                    rp   = one;
+                }
+
+                RealType Fscal = zero;
+
+                for (int i = 0; i < NSTATES; i++)
+                {
+                    qq[i] = gmx::load<RealType>(preloadQq[i]);
+                }
+
+                if (gmx::anyTrue(computeInteractionMask))
+                {
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        c6[i]  = gmx::load<RealType>(preloadC6[i]);
+                        c12[i] = gmx::load<RealType>(preloadC12[i]);
+                        if (useSoftCore)
                         {
-                            if (elecInteractionTypeIsEwald)
-                            {
-                                Vcoul[i]  = ewaldPotential(qq[i], rinvC, sh_ewald);
-                                FscalC[i] = ewaldScalarForce(qq[i], rinvC);
-                            }
-                            else
-                            {
-                                Vcoul[i]  = reactionFieldPotential(qq[i], rinvC, rC, krf, crf);
-                                FscalC[i] = reactionFieldScalarForce(qq[i], rinvC, rC, krf, two);
-                            }
+                            sigma6[i] = gmx::load<RealType>(preloadSigma6[i]);
                         }
+                    }
 
-                        /* Only process the VDW interactions if we have
-                         * some non-zero parameters, and if we either
-                         * include all entries in the list (no cutoff used
-                         * in the kernel), or if we are within the cutoff.
-                         */
-                        bool computeVdwInteraction = (vdwInteractionTypeIsEwald && r < rvdw)
-                                                     || (!vdwInteractionTypeIsEwald && rV < rvdw);
-                        if ((c6[i] != 0 || c12[i] != 0) && computeVdwInteraction)
+                    if (useSoftCore)
+                    {
+                        alpha_vdw_eff  = gmx::load<RealType>(preloadAlphaVdwEff);
+                        alpha_coul_eff = gmx::load<RealType>(preloadAlphaCoulEff);
+                    }
+
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        FscalC[i] = zero;
+                        FscalV[i] = zero;
+                        Vcoul[i]  = zero;
+                        Vvdw[i]   = zero;
+
+                        RealType rinvC, rinvV, rC, rV, rpinvC, rpinvV;
+
+                        /* Only spend time on A or B state if it is non-zero */
+                        const BoolType nonZeroState =
+                                ((qq[i] != zero) || (c6[i] != zero) || (c12[i] != zero))
+                                && computeInteractionMask;
+                        if (gmx::anyTrue(nonZeroState))
                         {
-                            RealType rinv6;
+                            /* this section has to be inside the loop because of the dependence on sigma6 */
                             if (useSoftCore)
                             {
-                                rinv6 = rpinvV;
+                                rpinvC = gmx::maskzInv(alpha_coul_eff * lfac_coul[i] * sigma6[i] + rp,
+                                                       nonZeroState);
+                                pthRoot(rpinvC, &rinvC, &rC, nonZeroState);
+                                if (scLambdasOrAlphasDiffer)
+                                {
+                                    rpinvV = gmx::maskzInv(alpha_vdw_eff * lfac_vdw[i] * sigma6[i] + rp,
+                                                           nonZeroState);
+                                    pthRoot(rpinvV, &rinvV, &rV, nonZeroState);
+                                }
+                                else
+                                {
+                                    /* We can avoid one expensive pow and one / operation */
+                                    rpinvV = rpinvC;
+                                    rinvV  = rinvC;
+                                    rV     = rC;
+                                }
                             }
                             else
                             {
-                                rinv6 = calculateRinv6(rinvV);
+                                rpinvC = one;
+                                rinvC  = rinv;
+                                rC     = r;
+
+                                rpinvV = one;
+                                rinvV  = rinv;
+                                rV     = r;
                             }
-                            RealType Vvdw6  = calculateVdw6(c6[i], rinv6);
-                            RealType Vvdw12 = calculateVdw12(c12[i], rinv6);
 
-                            Vvdw[i] = lennardJonesPotential(Vvdw6, Vvdw12, c6[i], c12[i], repulsionShift,
-                                                            dispersionShift, onesixth, onetwelfth);
-                            FscalV[i] = lennardJonesScalarForce(Vvdw6, Vvdw12);
+                            /* Only process the coulomb interactions if we have charges,
+                             * and if we either include all entries in the list (no cutoff
+                             * used in the kernel), or if we are within the cutoff.
+                             */
+                            const BoolType computeElecInteraction =
+                                    (elecInteractionTypeIsEwald ? r : rC) < rcoulomb && qq[i] != zero
+                                    && nonZeroState;
 
-                            if (vdwInteractionTypeIsEwald)
+                            if (gmx::anyTrue(computeElecInteraction))
                             {
-                                /* Subtract the grid potential at the cut-off */
-                                Vvdw[i] += ewaldLennardJonesGridSubtract(nbfp_grid[tj[i]],
-                                                                         sh_lj_ewald, onesixth);
+                                if (elecInteractionTypeIsEwald)
+                                {
+                                    Vcoul[i]  = ewaldPotential(qq[i], rinvC, sh_ewald);
+                                    FscalC[i] = ewaldScalarForce(qq[i], rinvC);
+                                }
+                                else
+                                {
+                                    Vcoul[i]  = reactionFieldPotential(qq[i], rinvC, rC, krf, crf);
+                                    FscalC[i] = reactionFieldScalarForce(qq[i], rinvC, rC, krf, two);
+                                }
+
+                                Vcoul[i]  = gmx::selectByMask(Vcoul[i], computeElecInteraction);
+                                FscalC[i] = gmx::selectByMask(FscalC[i], computeElecInteraction);
                             }
 
-                            if (vdwModifierIsPotSwitch)
+                            /* Only process the VDW interactions if we have
+                             * some non-zero parameters, and if we either
+                             * include all entries in the list (no cutoff used
+                             * in the kernel), or if we are within the cutoff.
+                             */
+                            const BoolType computeVdwInteraction =
+                                    (vdwInteractionTypeIsEwald ? r : rV) < rvdw
+                                    && (c6[i] != zero || c12[i] != zero) && nonZeroState;
+                            if (gmx::anyTrue(computeVdwInteraction))
                             {
-                                RealType d        = rV - ic->rvdw_switch;
-                                d                 = (d > zero) ? d : zero;
-                                const RealType d2 = d * d;
-                                const RealType sw =
-                                        one + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
-                                const RealType dsw = d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
-
-                                FscalV[i] = potSwitchScalarForceMod(FscalV[i], Vvdw[i], sw, rV,
-                                                                    rvdw, dsw, zero);
-                                Vvdw[i]   = potSwitchPotentialMod(Vvdw[i], sw, rV, rvdw, zero);
+                                RealType rinv6;
+                                if (useSoftCore)
+                                {
+                                    rinv6 = rpinvV;
+                                }
+                                else
+                                {
+                                    rinv6 = calculateRinv6(rinvV);
+                                }
+                                RealType Vvdw6  = calculateVdw6(c6[i], rinv6);
+                                RealType Vvdw12 = calculateVdw12(c12[i], rinv6);
+
+                                Vvdw[i] = lennardJonesPotential(Vvdw6, Vvdw12, c6[i], c12[i], repulsionShift,
+                                                                dispersionShift, onesixth, onetwelfth);
+                                FscalV[i] = lennardJonesScalarForce(Vvdw6, Vvdw12);
+
+                                if (vdwInteractionTypeIsEwald)
+                                {
+                                    /* Subtract the grid potential at the cut-off */
+                                    Vvdw[i] = Vvdw[i]
+                                              + ewaldLennardJonesGridSubtract(
+                                                        gmx::load<RealType>(preloadC6Grid[i]),
+                                                        sh_lj_ewald, onesixth);
+                                }
+
+                                if (vdwModifierIsPotSwitch)
+                                {
+                                    RealType d        = rV - ic->rvdw_switch;
+                                    d                 = gmx::max(d, RealType(zero));
+                                    const RealType d2 = d * d;
+                                    const RealType sw =
+                                            one + d2 * d * (vdw_swV3 + d * (vdw_swV4 + d * vdw_swV5));
+                                    const RealType dsw = d2 * (vdw_swF2 + d * (vdw_swF3 + d * vdw_swF4));
+
+                                    FscalV[i] = potSwitchScalarForceMod(FscalV[i], Vvdw[i], sw, rV,
+                                                                        dsw, rV < rvdw);
+                                    Vvdw[i]   = potSwitchPotentialMod(Vvdw[i], sw, rV < rvdw);
+                                }
+
+                                Vvdw[i]   = gmx::selectByMask(Vvdw[i], computeVdwInteraction);
+                                FscalV[i] = gmx::selectByMask(FscalV[i], computeVdwInteraction);
                             }
+
+                            /* FscalC (and FscalV) now contain: dV/drC * rC
+                             * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
+                             * Further down we first multiply by r^p-2 and then by
+                             * the vector r, which in total gives: dV/drC * (r/rC)^1-p
+                             */
+                            FscalC[i] = FscalC[i] * rpinvC;
+                            FscalV[i] = FscalV[i] * rpinvV;
                         }
+                    } // end for (int i = 0; i < NSTATES; i++)
 
-                        /* FscalC (and FscalV) now contain: dV/drC * rC
-                         * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
-                         * Further down we first multiply by r^p-2 and then by
-                         * the vector r, which in total gives: dV/drC * (r/rC)^1-p
-                         */
-                        FscalC[i] *= rpinvC;
-                        FscalV[i] *= rpinvV;
+                    /* Assemble A and B states */
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vctot = vctot + LFC[i] * Vcoul[i];
+                        vvtot = vvtot + LFV[i] * Vvdw[i];
+
+                        Fscal = Fscal + LFC[i] * FscalC[i] * rpm2;
+                        Fscal = Fscal + LFV[i] * FscalV[i] * rpm2;
+
+                        if (useSoftCore)
+                        {
+                            dvdl_coul = dvdl_coul
+                                        + (Vcoul[i] * DLF[i]
+                                           + LFC[i] * alpha_coul_eff * dlfac_coul[i] * FscalC[i] * sigma6[i]);
+                            dvdl_vdw = dvdl_vdw
+                                       + (Vvdw[i] * DLF[i]
+                                          + LFV[i] * alpha_vdw_eff * dlfac_vdw[i] * FscalV[i] * sigma6[i]);
+                        }
+                        else
+                        {
+                            dvdl_coul = dvdl_coul + Vcoul[i] * DLF[i];
+                            dvdl_vdw  = dvdl_vdw + Vvdw[i] * DLF[i];
+                        }
                     }
-                } // end for (int i = 0; i < NSTATES; i++)
+                } // end if (gmx::anyTrue(computeInteractionMask))
 
-                /* Assemble A and B states */
-                for (int i = 0; i < NSTATES; i++)
+                if (icoul == GMX_NBKERNEL_ELEC_REACTIONFIELD && gmx::anyTrue(bPairExcluded))
                 {
-                    vctot += LFC[i] * Vcoul[i];
-                    vvtot += LFV[i] * Vvdw[i];
-
-                    Fscal += LFC[i] * FscalC[i] * rpm2;
-                    Fscal += LFV[i] * FscalV[i] * rpm2;
+                    /* For excluded pairs, which are only in this pair list when
+                     * using the Verlet scheme, we don't use soft-core.
+                     * As there is no singularity, there is no need for soft-core.
+                     */
+                    const RealType FF = gmx::selectByMask(RealType(-two * krf), bPairExcluded);
+                    const RealType VV = gmx::selectByMask(
+                            (krf * rsq - crf) * gmx::load<RealType>(preloadSelfFactor), bPairExcluded);
 
-                    if (useSoftCore)
+                    for (int i = 0; i < NSTATES; i++)
                     {
-                        dvdl_coul += Vcoul[i] * DLF[i]
-                                     + LFC[i] * alpha_coul_eff * dlfac_coul[i] * FscalC[i] * sigma6[i];
-                        dvdl_vdw += Vvdw[i] * DLF[i]
-                                    + LFV[i] * alpha_vdw_eff * dlfac_vdw[i] * FscalV[i] * sigma6[i];
-                    }
-                    else
-                    {
-                        dvdl_coul += Vcoul[i] * DLF[i];
-                        dvdl_vdw += Vvdw[i] * DLF[i];
+                        vctot     = vctot + LFC[i] * qq[i] * VV;
+                        Fscal     = Fscal + LFC[i] * qq[i] * FF;
+                        dvdl_coul = dvdl_coul + DLF[i] * qq[i] * VV;
                     }
                 }
-            } // end if (bPairIncluded)
-            else if (icoul == GMX_NBKERNEL_ELEC_REACTIONFIELD)
-            {
-                /* For excluded pairs, which are only in this pair list when
-                 * using the Verlet scheme, we don't use soft-core.
-                 * As there is no singularity, there is no need for soft-core.
-                 */
-                const real FF = -two * krf;
-                RealType   VV = krf * rsq - crf;
 
-                if (ii == jnr)
+                const BoolType computeElecEwaldCorrection =
+                        (r < rcoulomb && computeInteractionMask) || bPairExcluded;
+                if (elecInteractionTypeIsEwald && gmx::anyTrue(computeElecEwaldCorrection))
                 {
-                    VV *= half;
-                }
-
-                for (int i = 0; i < NSTATES; i++)
-                {
-                    vctot += LFC[i] * qq[i] * VV;
-                    Fscal += LFC[i] * qq[i] * FF;
-                    dvdl_coul += DLF[i] * qq[i] * VV;
-                }
-            }
-
-            if (elecInteractionTypeIsEwald && (r < rcoulomb || !bPairIncluded))
-            {
-                /* See comment in the preamble. When using Ewald interactions
-                 * (unless we use a switch modifier) we subtract the reciprocal-space
-                 * Ewald component here which made it possible to apply the free
-                 * energy interaction to 1/r (vanilla coulomb short-range part)
-                 * above. This gets us closer to the ideal case of applying
-                 * the softcore to the entire electrostatic interaction,
-                 * including the reciprocal-space component.
-                 */
-                real v_lr, f_lr;
-
-                const RealType ewrt   = r * coulombTableScale;
-                IntType        ewitab = static_cast<IntType>(ewrt);
-                const RealType eweps  = ewrt - ewitab;
-                ewitab                = 4 * ewitab;
-                f_lr                  = ewtab[ewitab] + eweps * ewtab[ewitab + 1];
-                v_lr = (ewtab[ewitab + 2] - coulombTableScaleInvHalf * eweps * (ewtab[ewitab] + f_lr));
-                f_lr *= rinv;
-
-                /* Note that any possible Ewald shift has already been applied in
-                 * the normal interaction part above.
-                 */
+                    /* See comment in the preamble. When using Ewald interactions
+                     * (unless we use a switch modifier) we subtract the reciprocal-space
+                     * Ewald component here which made it possible to apply the free
+                     * energy interaction to 1/r (vanilla coulomb short-range part)
+                     * above. This gets us closer to the ideal case of applying
+                     * the softcore to the entire electrostatic interaction,
+                     * including the reciprocal-space component.
+                     */
+                    const RealType ewrt   = gmx::selectByMask(r, computeElecEwaldCorrection) * coulombTableScale;
+                    const IntType  ewitab = gmx::cvttR2I(ewrt);
+                    const RealType eweps  = ewrt - gmx::cvtI2R(ewitab);
+                    RealType       ewtabF, ewtabFDiff, ewtabV, ewtabDummy;
+                    gmx::gatherLoadBySimdIntTranspose<4>(ewtab, ewitab, &ewtabF, &ewtabFDiff, &ewtabV,
+                                                         &ewtabDummy);
+                    RealType f_lr = ewtabF + eweps * ewtabFDiff;
+                    RealType v_lr = (ewtabV - coulombTableScaleInvHalf * eweps * (ewtabF + f_lr));
+                    f_lr          = f_lr * rinv;
+
+                    /* Note that any possible Ewald shift has already been applied in
+                     * the normal interaction part above.
+                     */
 
-                if (ii == jnr)
-                {
-                    /* If we get here, the i particle (ii) has itself (jnr)
-                     * in its neighborlist. This can only happen with the Verlet
-                     * scheme, and corresponds to a self-interaction that will
-                     * occur twice. Scale it down by 50% to only include it once.
+                    /* If the i particle (ii) has itself (jnr) in its neighborlist,
+                     * the self-interaction occurs twice, the factor halves it.
                      */
-                    v_lr *= half;
-                }
+                    v_lr = gmx::selectByMask(v_lr * gmx::load<RealType>(preloadSelfFactor),
+                                             computeElecEwaldCorrection);
+                    f_lr = gmx::selectByMask(f_lr, computeElecEwaldCorrection);
 
-                for (int i = 0; i < NSTATES; i++)
-                {
-                    vctot -= LFC[i] * qq[i] * v_lr;
-                    Fscal -= LFC[i] * qq[i] * f_lr;
-                    dvdl_coul -= (DLF[i] * qq[i]) * v_lr;
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        vctot     = vctot - LFC[i] * qq[i] * v_lr;
+                        Fscal     = Fscal - LFC[i] * qq[i] * f_lr;
+                        dvdl_coul = dvdl_coul - (DLF[i] * qq[i]) * v_lr;
+                    }
                 }
-            }
 
-            if (vdwInteractionTypeIsEwald && r < rvdw)
-            {
-                /* See comment in the preamble. When using LJ-Ewald interactions
-                 * (unless we use a switch modifier) we subtract the reciprocal-space
-                 * Ewald component here which made it possible to apply the free
-                 * energy interaction to r^-6 (vanilla LJ6 short-range part)
-                 * above. This gets us closer to the ideal case of applying
-                 * the softcore to the entire VdW interaction,
-                 * including the reciprocal-space component.
-                 */
-                /* We could also use the analytical form here
-                 * iso a table, but that can cause issues for
-                 * r close to 0 for non-interacting pairs.
-                 */
-
-                const RealType rs   = rsq * rinv * vdwTableScale;
-                const IntType  ri   = static_cast<IntType>(rs);
-                const RealType frac = rs - ri;
-                const RealType f_lr = (1 - frac) * tab_ewald_F_lj[ri] + frac * tab_ewald_F_lj[ri + 1];
-                /* TODO: Currently the Ewald LJ table does not contain
-                 * the factor 1/6, we should add this.
-                 */
-                const RealType FF = f_lr * rinv / six;
-                RealType       VV =
-                        (tab_ewald_V_lj[ri] - vdwTableScaleInvHalf * frac * (tab_ewald_F_lj[ri] + f_lr))
-                        / six;
-
-                if (ii == jnr)
+                const BoolType computeVdwEwaldCorrection = r < rvdw && withinCutoffMask;
+                if (vdwInteractionTypeIsEwald && gmx::anyTrue(computeVdwEwaldCorrection))
                 {
-                    /* If we get here, the i particle (ii) has itself (jnr)
-                     * in its neighborlist. This can only happen with the Verlet
-                     * scheme, and corresponds to a self-interaction that will
-                     * occur twice. Scale it down by 50% to only include it once.
+                    /* See comment in the preamble. When using LJ-Ewald interactions
+                     * (unless we use a switch modifier) we subtract the reciprocal-space
+                     * Ewald component here which made it possible to apply the free
+                     * energy interaction to r^-6 (vanilla LJ6 short-range part)
+                     * above. This gets us closer to the ideal case of applying
+                     * the softcore to the entire VdW interaction,
+                     * including the reciprocal-space component.
+                     */
+                    /* We could also use the analytical form here
+                     * iso a table, but that can cause issues for
+                     * r close to 0 for non-interacting pairs.
+                     */
+
+                    const RealType rs =
+                            gmx::selectByMask(rsq * rinv, computeVdwEwaldCorrection) * vdwTableScale;
+                    const IntType  ri   = gmx::cvttR2I(rs);
+                    const RealType frac = rs - gmx::cvtI2R(ri);
+                    RealType       tabFLow, tabFHigh, tabV;
+                    ljEwaldTableLookup<DataTypes>(tab_ewald_F_lj, tab_ewald_V_lj, ri, &tabFLow,
+                                                  &tabFHigh, &tabV);
+                    const RealType f_lr = (one - frac) * tabFLow + frac * tabFHigh;
+                    /* TODO: Currently the Ewald LJ table does not contain
+                     * the factor 1/6, we should add this.
                      */
-                    VV *= half;
+                    const RealType FF =
+                            gmx::selectByMask(f_lr * rinv * onesixth, computeVdwEwaldCorrection);
+                    const RealType VV = gmx::selectByMask(
+                            (tabV - vdwTableScaleInvHalf * frac * (tabFLow + f_lr)) * onesixth
+                                    * gmx::load<RealType>(preloadSelfFactor),
+                            computeVdwEwaldCorrection);
+
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        const RealType c6grid = gmx::load<RealType>(preloadC6Grid[i]);
+                        vvtot                 = vvtot + LFV[i] * c6grid * VV;
+                        Fscal                 = Fscal + LFV[i] * c6grid * FF;
+                        dvdl_vdw              = dvdl_vdw + (DLF[i] * c6grid) * VV;
+                    }
                 }
 
-                for (int i = 0; i < NSTATES; i++)
+                if (doForces)
                 {
-                    const real c6grid = nbfp_grid[tj[i]];
-                    vvtot += LFV[i] * c6grid * VV;
-                    Fscal += LFV[i] * c6grid * FF;
-                    dvdl_vdw += (DLF[i] * c6grid) * VV;
+                    const RealType tx = Fscal * dx;
+                    const RealType ty = Fscal * dy;
+                    const RealType tz = Fscal * dz;
+                    fix[c]            = fix[c] + tx;
+                    fiy[c]            = fiy[c] + ty;
+                    fiz[c]            = fiz[c] + tz;
+                    fjx               = fjx + tx;
+                    fjy               = fjy + ty;
+                    fjz               = fjz + tz;
+
+                    numIWithinCutoff =
+                            numIWithinCutoff + gmx::selectByMask(RealType(one), withinCutoffMask);
                 }
-            }
+            } // end for (int c = 0; c < iClusterSize; c++)
 
             if (doForces)
             {
-                const real tx = Fscal * dx;
-                const real ty = Fscal * dy;
-                const real tz = Fscal * dz;
-                fix           = fix + tx;
-                fiy           = fiy + ty;
-                fiz           = fiz + tz;
-                /* OpenMP atomics are expensive, but this kernels is also
-                 * expensive, so we can take this hit, instead of using
-                 * thread-local output buffers and extra reduction.
-                 *
-                 * All the OpenMP regions in this file are trivial and should
-                 * not throw, so no need for try/catch.
-                 */
+                gmx::store(forceBufferX, fjx);
+                gmx::store(forceBufferY, fjy);
+                gmx::store(forceBufferZ, fjz);
+                gmx::store(withinCutoffBuffer, numIWithinCutoff);
+                for (int s = 0; s < simdRealWidth; s++)
+                {
+                    if (withinCutoffBuffer[s] != zero)
+                    {
+                        const int j3 = 3 * preloadJnr[s];
+                        /* OpenMP atomics are expensive, but this kernels is also
+                         * expensive, so we can take this hit, instead of using
+                         * thread-local output buffers and extra reduction.
+                         * With i-cluster entries the j-force is reduced over
+                         * the i-atoms before the atomic update.
+                         *
+                         * All the OpenMP regions in this file are trivial and should
+                         * not throw, so no need for try/catch.
+                         */
 #pragma omp atomic
-                f[j3] -= tx;
+                        f[j3] -= forceBufferX[s];
 #pragma omp atomic
-                f[j3 + 1] -= ty;
+                        f[j3 + 1] -= forceBufferY[s];
 #pragma omp atomic
-                f[j3 + 2] -= tz;
+                        f[j3 + 2] -= forceBufferZ[s];
+                    }
+                }
             }
-        } // end for (int k = nj0; k < nj1; k++)
+        } // end for (int k = nj0; k < nj1; k += simdRealWidth)
 
         /* The atomics below are expensive with many OpenMP threads.
          * Here unperturbed i-particles will usually only have a few
          * (perturbed) j-particles in the list. Thus with a buffered list
          * we can skip a significant number of i-reductions with a check.
          */
-        if (npair_within_cutoff > 0)
+        bool haveAnyPairWithinCutoff = false;
+        for (int c = 0; c < iClusterSize; c++)
         {
+            if (npair_within_cutoff[c] == 0)
+            {
+                continue;
+            }
+            haveAnyPairWithinCutoff = true;
+
+            const int  ii3    = 3 * iAtom[c];
+            const real fixSum = gmx::reduce(fix[c]);
+            const real fiySum = gmx::reduce(fiy[c]);
+            const real fizSum = gmx::reduce(fiz[c]);
             if (doForces)
             {
 #pragma omp atomic
-                f[ii3] += fix;
+                f[ii3] += fixSum;
 #pragma omp atomic
-                f[ii3 + 1] += fiy;
+                f[ii3 + 1] += fiySum;
 #pragma omp atomic
-                f[ii3 + 2] += fiz;
+                f[ii3 + 2] += fizSum;
             }
             if (doShiftForces)
             {
 #pragma omp atomic
-                fshift[is3] += fix;
+                fshift[is3] += fixSum;
 #pragma omp atomic
-                fshift[is3 + 1] += fiy;
+                fshift[is3 + 1] += fiySum;
 #pragma omp atomic
-                fshift[is3 + 2] += fiz;
+                fshift[is3 + 2] += fizSum;
             }
+        }
+        if (haveAnyPairWithinCutoff)
+        {
             if (doPotential)
             {
-                int ggid = gid[n];
+                int        ggid     = gid[n];
+                const real vctotSum = gmx::reduce(vctot);
+                const real vvtotSum = gmx::reduce(vvtot);
 #pragma omp atomic
-                Vc[ggid] += vctot;
+                Vc[ggid] += vctotSum;
 #pragma omp atomic
-                Vv[ggid] += vvtot;
+                Vv[ggid] += vvtotSum;
             }
         }
     } // end for (int n = 0; n < nri; n++)
 
+    const real dvdlCoulSum = gmx::reduce(dvdl_coul);
+    const real dvdlVdwSum  = gmx::reduce(dvdl_vdw);
 #pragma omp atomic
-    dvdl[efptCOUL] += dvdl_coul;
+    dvdl[efptCOUL] += dvdlCoulSum;
 #pragma omp atomic
-    dvdl[efptVDW] += dvdl_vdw;
+    dvdl[efptVDW] += dvdlVdwSum;
 
     /* Estimate flops, average for free energy stuff:
      * 12  flops per outer iteration
      * 150 flops per inner iteration
      */
 #pragma omp atomic
-    inc_nrnb(nrnb, eNR_NBKERNEL_FREE_ENERGY, nlist->nri * 12 + nlist->jindex[nri] * 150);
+    inc_nrnb(nrnb, eNR_NBKERNEL_FREE_ENERGY, nlist->nri * 12 + numPairs * 150);
 }
 
 typedef void (*KernelFunction)(const t_nblist* gmx_restrict nlist,
@@ -855,8 +1087,7 @@ static KernelFunction dispatchKernelOnUseSimd(const bool useSimd)
     if (useSimd)
     {
 #if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_INT32_ARITHMETICS && GMX_USE_SIMD_KERNELS
-        /* FIXME: Here SimdDataTypes should be used to enable SIMD. So far, the code in nb_free_energy_kernel is not adapted to SIMD */
-        return (nb_free_energy_kernel<ScalarDataTypes, useSoftCore, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
+        return (nb_free_energy_kernel<SimdDataTypes, useSoftCore, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
                                       elecInteractionTypeIsEwald, vdwModifierIsPotSwitch>);
 #else
         return (nb_free_energy_kernel<ScalarDataTypes, useSoftCore, scLambdasOrAlphasDiffer, vdwInteractionTypeIsEwald,
@@ -0,0 +1,560 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the free-energy non-bonded kernel
+ *
+ * Compares the SIMD kernel with the scalar kernel for different
+ * interaction types, with and without soft-core, and pairlists with
+ * i-cluster entries with pairlists with one i-atom per entry.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/gmxlib/nonbonded/nb_free_energy.h"
+#include "gromacs/gmxlib/nonbonded/nb_kernel.h"
+#include "gromacs/gmxlib/nonbonded/nonbonded.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdtypes/forceoutput.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/nblist.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of atoms in the test system
+constexpr int c_numAtoms = 48;
+//! The number of atom types
+constexpr int c_numAtomTypes = 3;
+//! The size of the cubic unit-cell
+constexpr real c_boxSize = 2.5;
+//! The interaction cut-off
+constexpr real c_cutoff = 1.0;
+//! The pairlist cut-off, pairs between the two cut-offs should not contribute
+constexpr real c_pairlistCutoff = 1.1;
+//! The relative tolerance for comparing kernel outputs that differ in summation order and rounding
+constexpr real c_relativeTolerance = (GMX_DOUBLE ? 1e-10 : 1e-4);
+
+//! An atom pair in a free-energy pairlist
+struct FepPair
+{
+    //! The i-atom
+    int i;
+    //! The j-atom
+    int j;
+    //! The shift index of the i-atom
+    int shift;
+    //! Whether the pair is excluded
+    bool isExcluded;
+};
+
+//! A small system with perturbed charges and types and its free-energy pairs
+struct FepTestSystem
+{
+    //! Generates the system
+    FepTestSystem();
+
+    //! The unit-cell
+    matrix box = { { c_boxSize, 0, 0 }, { 0, c_boxSize, 0 }, { 0, 0, c_boxSize } };
+    //! The coordinates
+    std::vector<RVec> x;
+    //! The charges in state A
+    std::vector<real> chargeA;
+    //! The charges in state B
+    std::vector<real> chargeB;
+    //! The atom types in state A
+    std::vector<int> typeA;
+    //! The atom types in state B
+    std::vector<int> typeB;
+    //! The LJ parameters, multiplied by 6 and 12, as in t_forcerec
+    std::vector<real> nbfp;
+    //! The C6 parameters for the LJ-PME grid, multiplied by 6
+    std::vector<real> nbfpGrid;
+    //! The pairs that involve a perturbed atom, sorted on i-atom
+    std::vector<FepPair> pairs;
+};
+
+FepTestSystem::FepTestSystem()
+{
+    t_pbc pbc;
+    set_pbc(&pbc, PbcType::Xyz, box);
+
+    /* Atoms 2k and 2k+1 are bonded, the other atoms are kept at least 0.2 nm apart */
+    DefaultRandomEngine           rng(1234);
+    UniformRealDistribution<real> position(0, c_boxSize);
+    UniformRealDistribution<real> unit(-1, 1);
+    while (static_cast<int>(x.size()) < c_numAtoms)
+    {
+        RVec xNew;
+        if (x.size() % 2 == 0)
+        {
+            xNew = { position(rng), position(rng), position(rng) };
+        }
+        else
+        {
+            RVec direction = { unit(rng), unit(rng), unit(rng) };
+            xNew           = x.back() + direction * (0.12_real / norm(direction));
+            for (int d = 0; d < DIM; d++)
+            {
+                xNew[d] -= std::floor(xNew[d] / c_boxSize) * c_boxSize;
+            }
+        }
+        bool isFarEnough = true;
+        for (size_t a = 0; a < x.size() - (x.size() % 2); a++)
+        {
+            rvec dx;
+            pbc_dx_aiuc(&pbc, x[a], xNew, dx);
+            isFarEnough = isFarEnough && norm2(dx) >= 0.2_real * 0.2_real;
+        }
+        if (isFarEnough)
+        {
+            x.push_back(xNew);
+        }
+    }
+
+    /* Every third atom is perturbed, its charge is turned off and its type changes.
+     * Type 2 has no LJ interactions, which uses the soft-core default sigma.
+     */
+    const real c6[c_numAtomTypes]  = { 0.0026, 0.0015, 0 };
+    const real c12[c_numAtomTypes] = { 2.6e-6, 1.5e-6, 0 };
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        const bool isPerturbed = (a % 3 == 0);
+        chargeA.push_back(unit(rng) * 0.8_real);
+        chargeB.push_back(isPerturbed ? 0 : chargeA.back());
+        typeA.push_back(a % c_numAtomTypes);
+        typeB.push_back(isPerturbed ? (typeA.back() + 1) % c_numAtomTypes : typeA.back());
+    }
+    for (int ti = 0; ti < c_numAtomTypes; ti++)
+    {
+        for (int tj = 0; tj < c_numAtomTypes; tj++)
+        {
+            nbfp.push_back(6 * std::sqrt(c6[ti] * c6[tj]));
+            nbfp.push_back(12 * std::sqrt(c12[ti] * c12[tj]));
+            nbfpGrid.push_back(6 * std::sqrt(c6[ti] * c6[tj]));
+            nbfpGrid.push_back(0);
+        }
+    }
+
+    /* As in the nbnxm lists, perturbed atoms have an excluded self-pair */
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        for (int j = i; j < c_numAtoms; j++)
+        {
+            if (i % 3 != 0 && j % 3 != 0)
+            {
+                continue;
+            }
+            rvec      dx;
+            const int shift = pbc_dx_aiuc(&pbc, x[i], x[j], dx);
+            if (norm2(dx) < c_pairlistCutoff * c_pairlistCutoff)
+            {
+                const bool isExcluded = (j == i || (i % 2 == 0 && j == i + 1));
+                pairs.push_back({ i, j, shift, isExcluded });
+            }
+        }
+    }
+}
+
+//! A free-energy pairlist with storage for the t_nblist arrays
+class FepPairlist
+{
+public:
+    /*! \brief Constructs a list with entries for \p iClusterSize consecutive i-atoms
+     *
+     * All i-atoms in an entry share the j-atom list, the pairs that are not present
+     * for an i-atom are marked as absent, as in the nbnxm free-energy lists.
+     */
+    FepPairlist(const std::vector<FepPair>& pairs, int iClusterSize);
+
+    //! Returns the list in the format used by the kernel
+    const t_nblist& nblist() const { return nblist_; }
+
+private:
+    std::vector<int>  iinr_;
+    std::vector<int>  jindex_;
+    std::vector<int>  jjnr_;
+    std::vector<char> exclFep_;
+    std::vector<int>  shift_;
+    std::vector<int>  gid_;
+    t_nblist          nblist_;
+};
+
+FepPairlist::FepPairlist(const std::vector<FepPair>& pairs, const int iClusterSize) : nblist_()
+{
+    jindex_.push_back(0);
+    for (int iCluster = 0; iCluster * iClusterSize < c_numAtoms; iCluster++)
+    {
+        for (int shift = 0; shift < SHIFTS; shift++)
+        {
+            std::vector<int> jAtoms;
+            for (const FepPair& pair : pairs)
+            {
+                if (pair.i / iClusterSize == iCluster && pair.shift == shift)
+                {
+                    jAtoms.push_back(pair.j);
+                }
+            }
+            std::sort(jAtoms.begin(), jAtoms.end());
+            jAtoms.erase(std::unique(jAtoms.begin(), jAtoms.end()), jAtoms.end());
+            if (jAtoms.empty())
+            {
+                continue;
+            }
+
+            for (int c = 0; c < iClusterSize; c++)
+            {
+                const int i = iCluster * iClusterSize + c;
+                iinr_.push_back(i < c_numAtoms ? i : -1);
+            }
+            for (const int j : jAtoms)
+            {
+                jjnr_.push_back(j);
+                for (int c = 0; c < iClusterSize; c++)
+                {
+                    const int  i    = iCluster * iClusterSize + c;
+                    const auto pair =
+                            std::find_if(pairs.begin(), pairs.end(), [=](const FepPair& p) {
+                                return p.i == i && p.j == j && p.shift == shift;
+                            });
+                    char state = efepPairAbsent;
+                    if (pair != pairs.end())
+                    {
+                        state = (pair->isExcluded ? efepPairExcluded : efepPairIncluded);
+                    }
+                    exclFep_.push_back(state);
+                }
+            }
+            jindex_.push_back(jjnr_.size());
+            shift_.push_back(shift);
+            gid_.push_back(0);
+        }
+    }
+
+    nblist_.nri          = shift_.size();
+    nblist_.maxnri       = nblist_.nri;
+    nblist_.iClusterSize = iClusterSize;
+    nblist_.nrj          = jjnr_.size();
+    nblist_.maxnrj       = nblist_.nrj;
+    nblist_.iinr         = iinr_.data();
+    nblist_.jindex       = jindex_.data();
+    nblist_.jjnr         = jjnr_.data();
+    nblist_.excl_fep     = exclFep_.data();
+    nblist_.shift        = shift_.data();
+    nblist_.gid          = gid_.data();
+}
+
+//! The interaction setup for a kernel test
+struct FepKernelParameters
+{
+    //! Description of the setup
+    const char* description;
+    //! The Coulomb interaction type
+    int eeltype;
+    //! The VdW interaction type
+    int vdwtype;
+    //! The VdW modifier
+    int vdwModifier;
+    //! The soft-core alpha, 0 turns soft-core off
+    real scAlpha;
+    //! The soft-core lambda power
+    int scPower;
+    //! Lambda for Coulomb
+    real lambdaCoul;
+    //! Lambda for VdW
+    real lambdaVdw;
+};
+
+//! The setups to test, these cover all combinations of template parameters of the kernel
+const FepKernelParameters c_kernelParameters[] = {
+    { "RF, LJ potential-shift, soft-core with different lambdas", eelRF, evdwCUT, eintmodPOTSHIFT,
+      0.5, 1, 0.3, 0.7 },
+    { "PME, LJ potential-shift, soft-core", eelPME, evdwCUT, eintmodPOTSHIFT, 0.5, 2, 0.4, 0.4 },
+    { "PME, LJ potential-switch, soft-core", eelPME, evdwCUT, eintmodPOTSWITCH, 0.3, 1, 0.6, 0.6 },
+    { "PME, LJ-PME, soft-core", eelPME, evdwPME, eintmodPOTSHIFT, 0.5, 1, 0.2, 0.2 },
+    { "PME, LJ-PME, no soft-core", eelPME, evdwPME, eintmodPOTSHIFT, 0, 1, 0.5, 0.5 },
+    { "Plain cut-off, LJ potential-switch, no soft-core", eelCUT, evdwCUT, eintmodPOTSWITCH, 0, 1,
+      0.3, 0.7 },
+};
+
+//! The output of a kernel call
+struct FepKernelOutput
+{
+    //! The forces
+    std::vector<RVec> f;
+    //! The shift forces
+    std::vector<RVec> fShift;
+    //! The Coulomb and VdW energies
+    real energy[2] = { 0, 0 };
+    //! The derivatives with respect to lambda for all components
+    real dvdl[efptNR] = { 0 };
+};
+
+//! Runs the free-energy kernel with pairlist \p nlist for \p system and returns the output
+FepKernelOutput runKernel(const FepTestSystem&       system,
+                          const FepKernelParameters& params,
+                          const t_nblist&            nlist,
+                          const bool                 useSimd)
+{
+    t_lambda fepvals;
+    fepvals.sc_alpha     = params.scAlpha;
+    fepvals.sc_power     = params.scPower;
+    fepvals.sc_r_power   = 6.0;
+    fepvals.sc_sigma     = 0.3;
+    fepvals.sc_sigma_min = 0.3;
+    fepvals.bScCoul      = TRUE;
+
+    interaction_const_t ic;
+    ic.softCoreParameters = std::make_unique<interaction_const_t::SoftCoreParameters>(fepvals);
+    ic.eeltype            = params.eeltype;
+    ic.vdwtype            = params.vdwtype;
+    ic.vdw_modifier       = params.vdwModifier;
+    ic.rcoulomb           = c_cutoff;
+    ic.rvdw               = c_cutoff;
+    ic.rvdw_switch        = (params.vdwModifier == eintmodPOTSWITCH ? 0.8 : 0);
+    ic.epsfac             = ONE_4PI_EPS0;
+    if (EEL_PME_EWALD(params.eeltype))
+    {
+        ic.coulomb_modifier = eintmodPOTSHIFT;
+        ic.ewaldcoeff_q     = calc_ewaldcoeff_q(c_cutoff, 1e-5);
+        ic.sh_ewald         = std::erfc(ic.ewaldcoeff_q * c_cutoff) / c_cutoff;
+    }
+    else
+    {
+        /* Reaction-field with infinite dielectric, or a shifted plain cut-off */
+        ic.k_rf = (params.eeltype == eelRF ? 0.5 / gmx::power3(c_cutoff) : 0);
+        ic.c_rf = 1 / c_cutoff + ic.k_rf * c_cutoff * c_cutoff;
+    }
+    if (params.vdwModifier == eintmodPOTSHIFT)
+    {
+        ic.dispersion_shift.cpot = -1.0 / gmx::power6(c_cutoff);
+        ic.repulsion_shift.cpot  = -1.0 / gmx::power12(c_cutoff);
+    }
+    if (EVDW_PME(params.vdwtype))
+    {
+        ic.ewaldcoeff_lj = calc_ewaldcoeff_lj(c_cutoff, 1e-3);
+        const real crc2  = gmx::square(ic.ewaldcoeff_lj * c_cutoff);
+        ic.sh_lj_ewald =
+                (std::exp(-crc2) * (1 + crc2 + 0.5 * crc2 * crc2) - 1) / gmx::power6(c_cutoff);
+    }
+    ic.coulombEwaldTables = std::make_unique<EwaldCorrectionTables>();
+    ic.vdwEwaldTables     = std::make_unique<EwaldCorrectionTables>();
+    init_interaction_const_tables(nullptr, &ic, 0);
+
+    t_forcerec fr;
+    fr.ic               = &ic;
+    fr.use_simd_kernels = useSimd;
+    fr.ntype            = c_numAtomTypes;
+    fr.nbfp             = system.nbfp;
+    fr.ljpme_c6grid     = const_cast<real*>(system.nbfpGrid.data());
+    snew(fr.shift_vec, SHIFTS);
+    calc_shifts(system.box, fr.shift_vec);
+
+    t_mdatoms mdatoms = {};
+    mdatoms.nr        = c_numAtoms;
+    mdatoms.chargeA   = const_cast<real*>(system.chargeA.data());
+    mdatoms.chargeB   = const_cast<real*>(system.chargeB.data());
+    mdatoms.typeA     = const_cast<int*>(system.typeA.data());
+    mdatoms.typeB     = const_cast<int*>(system.typeB.data());
+
+    FepKernelOutput output;
+
+    real lambda[efptNR] = { 0 };
+    lambda[efptCOUL]    = params.lambdaCoul;
+    lambda[efptVDW]     = params.lambdaVdw;
+
+    nb_kernel_data_t kernelData = {};
+    kernelData.flags =
+            GMX_NONBONDED_DO_FORCE | GMX_NONBONDED_DO_SHIFTFORCE | GMX_NONBONDED_DO_POTENTIAL;
+    kernelData.lambda         = lambda;
+    kernelData.dvdl           = output.dvdl;
+    kernelData.energygrp_elec = &output.energy[0];
+    kernelData.energygrp_vdw  = &output.energy[1];
+
+    PaddedVector<RVec>   force(c_numAtoms, { 0, 0, 0 });
+    std::vector<RVec>    shiftForce(SHIFTS, { 0, 0, 0 });
+    ForceWithShiftForces forceWithShiftForces(force.arrayRefWithPadding(), true, shiftForce);
+
+    std::vector<RVec> x = system.x;
+    t_nrnb            nrnb;
+    gmx_nb_free_energy_kernel(&nlist, as_rvec_array(x.data()), &forceWithShiftForces, &fr,
+                              &mdatoms, &kernelData, &nrnb);
+
+    output.f.assign(force.begin(), force.begin() + c_numAtoms);
+    output.fShift = shiftForce;
+
+    return output;
+}
+
+//! Returns the largest absolute component of the vectors in \p v
+real maxAbsComponent(const std::vector<RVec>& v)
+{
+    real maxAbs = 0;
+    for (const RVec& elem : v)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            maxAbs = std::max(maxAbs, std::abs(elem[d]));
+        }
+    }
+    return maxAbs;
+}
+
+//! Expects that the kernel outputs agree within rounding and summation differences
+void expectOutputsAreEqual(const FepKernelOutput& reference, const FepKernelOutput& output)
+{
+    /* Forces of different atoms can have very different magnitude, because
+     * of the steep soft-core and LJ potentials. Use the maximum as scale.
+     */
+    const auto forceTolerance =
+            absoluteTolerance(maxAbsComponent(reference.f) * c_relativeTolerance);
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(reference.f[a][d], output.f[a][d], forceTolerance)
+                    << "for atom " << a << " dimension " << d;
+        }
+    }
+    const auto shiftForceTolerance =
+            absoluteTolerance(maxAbsComponent(reference.fShift) * c_relativeTolerance);
+    for (int s = 0; s < SHIFTS; s++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(reference.fShift[s][d], output.fShift[s][d], shiftForceTolerance)
+                    << "for shift " << s << " dimension " << d;
+        }
+    }
+    for (int e = 0; e < 2; e++)
+    {
+        EXPECT_REAL_EQ_TOL(
+                reference.energy[e], output.energy[e],
+                relativeToleranceAsFloatingPoint(reference.energy[e], c_relativeTolerance))
+                << (e == 0 ? "for the Coulomb energy" : "for the VdW energy");
+    }
+    for (int c : { efptCOUL, efptVDW })
+    {
+        EXPECT_REAL_EQ_TOL(reference.dvdl[c], output.dvdl[c],
+                           relativeToleranceAsFloatingPoint(reference.dvdl[c], c_relativeTolerance))
+                << "for dV/dlambda of " << efpt_names[c];
+    }
+}
+
+//! Test fixture for the free-energy kernel, parametrized on the interaction setup
+class FreeEnergyKernelTest : public ::testing::TestWithParam<FepKernelParameters>
+{
+protected:
+    //! The test system
+    const FepTestSystem system_;
+};
+
+TEST_P(FreeEnergyKernelTest, SimdMatchesScalar)
+{
+    const FepKernelParameters& params = GetParam();
+    SCOPED_TRACE(params.description);
+
+    const FepPairlist pairlist(system_.pairs, 1);
+
+    const FepKernelOutput scalar = runKernel(system_, params, pairlist.nblist(), false);
+    const FepKernelOutput simd   = runKernel(system_, params, pairlist.nblist(), true);
+
+    EXPECT_NE(0, maxAbsComponent(scalar.f));
+    EXPECT_NE(0, scalar.dvdl[efptVDW]);
+    expectOutputsAreEqual(scalar, simd);
+}
+
+TEST_P(FreeEnergyKernelTest, IClusterListMatchesAtomList)
+{
+    const FepKernelParameters& params = GetParam();
+    SCOPED_TRACE(params.description);
+
+    const FepPairlist atomList(system_.pairs, 1);
+    const FepPairlist clusterList(system_.pairs, c_fepListMaxIClusterSize);
+
+    /* The cluster list should have i-atoms without pairs with some j-atoms */
+    const t_nblist& nblist = clusterList.nblist();
+    ASSERT_NE(std::find(nblist.excl_fep, nblist.excl_fep + nblist.nrj * nblist.iClusterSize,
+                        static_cast<char>(efepPairAbsent)),
+              nblist.excl_fep + nblist.nrj * nblist.iClusterSize);
+
+    for (const bool useSimd : { false, true })
+    {
+        SCOPED_TRACE(useSimd ? "With SIMD" : "Without SIMD");
+
+        const FepKernelOutput reference = runKernel(system_, params, atomList.nblist(), useSimd);
+        const FepKernelOutput output = runKernel(system_, params, clusterList.nblist(), useSimd);
+
+        expectOutputsAreEqual(reference, output);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(AllInteractionTypes,
+                        FreeEnergyKernelTest,
+                        ::testing::ValuesIn(c_kernelParameters));
+
+} // namespace
+} // namespace test
+} // namespace gmx
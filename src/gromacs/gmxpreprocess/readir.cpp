@@ -103,7 +103,7 @@ struct gmx_inputrec_strings
             frdim[STRLEN], energy[STRLEN], user1[STRLEN], user2[STRLEN], vcm[STRLEN],
             x_compressed_groups[STRLEN], couple_moltype[STRLEN], orirefitgrp[STRLEN],
             egptable[STRLEN], egpexcl[STRLEN], wall_atomtype[STRLEN], wall_density[STRLEN],
-            deform[STRLEN], QMMM[STRLEN], imd_grp[STRLEN];
+            deform[STRLEN], QMMM[STRLEN], imd_grp[STRLEN], mtsLevel2Forces[STRLEN];
     char                     fep_lambda[efptNR][STRLEN];
     char                     lambda_weights[STRLEN];
     std::vector<std::string> pullGroupNames;
@@ -1400,6 +1400,11 @@ void check_ir(const char*                   mdparin,
     {
         gmx_fatal(FARGS, "AdResS simulations are no longer supported");
     }
+
+    for (const auto& mtsError : gmx::checkMtsRequirements(*ir))
+    {
+        warning_error(wi, mtsError);
+    }
 }
 
 /* interpret a number of doubles from a string and put them in an array,
@@ -1793,6 +1798,60 @@ private:
 
 } // namespace
 
+/*! \brief Sets up the MTS levels in \p ir from the mdp settings
+ *
+ * All force groups not listed in \p level2Forces are assigned to the first, fast, level.
+ */
+static void setupMtsLevels(t_inputrec* ir,
+                           int         numLevels,
+                           const char* level2Forces,
+                           int         level2Factor,
+                           warninp_t   wi)
+{
+    gmx::MtsLevel& mtsLevel1 = ir->mtsLevels[0];
+    gmx::MtsLevel& mtsLevel2 = ir->mtsLevels[1];
+
+    mtsLevel1.forceGroups.set();
+    mtsLevel1.stepFactor = 1;
+    mtsLevel2.forceGroups.reset();
+    mtsLevel2.stepFactor = 1;
+
+    if (!ir->useMts)
+    {
+        return;
+    }
+
+    if (numLevels != gmx::c_numMtsLevels)
+    {
+        auto message = gmx::formatString("Only %d MTS levels are supported, not %d",
+                                         gmx::c_numMtsLevels, numLevels);
+        warning_error(wi, message);
+    }
+
+    for (const auto& forceGroupName : gmx::splitString(level2Forces))
+    {
+        bool found = false;
+        for (const auto forceGroup : gmx::keysOf(gmx::mtsForceGroupNames))
+        {
+            if (gmx::equalCaseInsensitive(forceGroupName, gmx::mtsForceGroupNames[forceGroup]))
+            {
+                mtsLevel1.forceGroups.reset(static_cast<int>(forceGroup));
+                mtsLevel2.forceGroups.set(static_cast<int>(forceGroup));
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            auto message = gmx::formatString(
+                    "Unknown MTS force group '%s' in mts-level2-forces, should be one of: %s",
+                    forceGroupName.c_str(),
+                    gmx::joinStrings(gmx::mtsForceGroupNames, ", ").c_str());
+            warning_error(wi, message);
+        }
+    }
+    mtsLevel2.stepFactor = level2Factor;
+}
+
 void get_ir(const char*     mdparin,
             const char*     mdparout,
             gmx::MDModules* mdModules,
@@ -1889,6 +1948,13 @@ void get_ir(const char*     mdparin,
     ir->nstcomm = get_eint(&inp, "nstcomm", 100, wi);
     printStringNoNewline(&inp, "group(s) for center of mass motion removal");
     setStringEntry(&inp, "comm-grps", inputrecStrings->vcm, nullptr);
+    printStringNoNewline(&inp, "Multiple time stepping");
+    ir->useMts             = (get_eeenum(&inp, "mts", yesno_names, wi) != 0);
+    const int numMtsLevels = get_eint(&inp, "mts-levels", 2, wi);
+    setStringEntry(&inp, "mts-level2-forces", inputrecStrings->mtsLevel2Forces,
+                   "longrange-nonbonded");
+    const int mtsLevel2Factor = get_eint(&inp, "mts-level2-factor", 2, wi);
+    setupMtsLevels(ir, numMtsLevels, inputrecStrings->mtsLevel2Forces, mtsLevel2Factor, wi);
 
     printStringNewline(&inp, "LANGEVIN DYNAMICS OPTIONS");
     printStringNoNewline(&inp, "Friction coefficient (amu/ps) and random seed");
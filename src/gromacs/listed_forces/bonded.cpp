@@ -447,18 +447,19 @@ real harmonic(real kA, real kB, real xA, real xB, real x, real lambda, real* V,
 
 
 template<BondedKernelFlavor flavor>
-real bonds(int             nbonds,
-           const t_iatom   forceatoms[],
-           const t_iparams forceparams[],
-           const rvec      x[],
-           rvec4           f[],
-           rvec            fshift[],
-           const t_pbc*    pbc,
-           real            lambda,
-           real*           dvdlambda,
-           const t_mdatoms gmx_unused* md,
-           t_fcdata gmx_unused* fcd,
-           int gmx_unused* global_atom_index)
+std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
+bonds(int             nbonds,
+      const t_iatom   forceatoms[],
+      const t_iparams forceparams[],
+      const rvec      x[],
+      rvec4           f[],
+      rvec            fshift[],
+      const t_pbc*    pbc,
+      real            lambda,
+      real*           dvdlambda,
+      const t_mdatoms gmx_unused* md,
+      t_fcdata gmx_unused* fcd,
+      int gmx_unused* global_atom_index)
 {
     int  i, ki, ai, aj, type;
     real dr, dr2, fbond, vbond, vtot;
@@ -493,6 +494,108 @@ real bonds(int             nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Calculates harmonic bond forces, using SIMD
+ *
+ * Only the A-state parameters are used, as this flavor is never
+ * selected with perturbed interactions.
+ */
+template<BondedKernelFlavor flavor>
+std::enable_if_t<flavor == BondedKernelFlavor::ForcesSimdWhenAvailable, real>
+bonds(int             nbonds,
+      const t_iatom   forceatoms[],
+      const t_iparams forceparams[],
+      const rvec      x[],
+      rvec4           f[],
+      rvec gmx_unused fshift[],
+      const t_pbc*    pbc,
+      real gmx_unused lambda,
+      real gmx_unused* dvdlambda,
+      const t_mdatoms gmx_unused* md,
+      t_fcdata gmx_unused* fcd,
+      int gmx_unused* global_atom_index)
+{
+    const int                                nfa1 = 3;
+    int                                      i, iu, s;
+    int                                      type;
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         coeff[2 * GMX_SIMD_REAL_WIDTH];
+    SimdReal                                 xi_S, yi_S, zi_S;
+    SimdReal                                 xj_S, yj_S, zj_S;
+    SimdReal                                 dx_S, dy_S, dz_S;
+    SimdReal                                 k_S, r0_S;
+    SimdReal                                 dr2_S, invdr_S, fbond_S;
+    alignas(GMX_SIMD_ALIGNMENT) real         pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of bonds times nfa1, here we step GMX_SIMD_REAL_WIDTH bonds */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH * nfa1)
+    {
+        /* Collect atoms pairs for GMX_SIMD_REAL_WIDTH bonds.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu + 1];
+            aj[s] = forceatoms[iu + 2];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s * nfa1 < nbonds)
+            {
+                coeff[s]                       = forceparams[type].harmonic.krA;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                       = 0;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = 0;
+            }
+        }
+
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ai, &xi_S, &yi_S, &zi_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), aj, &xj_S, &yj_S, &zj_S);
+        dx_S = xi_S - xj_S;
+        dy_S = yi_S - yj_S;
+        dz_S = zi_S - zj_S;
+
+        pbc_correct_dx_simd(&dx_S, &dy_S, &dz_S, pbc_simd);
+
+        k_S  = load<SimdReal>(coeff);
+        r0_S = load<SimdReal>(coeff + GMX_SIMD_REAL_WIDTH);
+
+        dr2_S = norm2(dx_S, dy_S, dz_S);
+
+        /* As the plain-C code, we skip atoms on top of each other,
+         * here by zeroing the inverse distance.
+         */
+        invdr_S = maskzInvsqrt(dr2_S, setZero() < dr2_S);
+
+        /* This is -dV/dr / r */
+        fbond_S = k_S * fnma(dr2_S, invdr_S, r0_S) * invdr_S;
+
+        dx_S = fbond_S * dx_S;
+        dy_S = fbond_S * dy_S;
+        dz_S = fbond_S * dz_S;
+
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ai, dx_S, dy_S, dz_S);
+        transposeScatterDecrU<4>(reinterpret_cast<real*>(f), aj, dx_S, dy_S, dz_S);
+    }
+
+    return 0;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 template<BondedKernelFlavor flavor>
 real restraint_bonds(int             nbonds,
                      const t_iatom   forceatoms[],
@@ -1110,18 +1213,19 @@ angles(int             nbonds,
 #endif // GMX_SIMD_HAVE_REAL
 
 template<BondedKernelFlavor flavor>
-real linear_angles(int             nbonds,
-                   const t_iatom   forceatoms[],
-                   const t_iparams forceparams[],
-                   const rvec      x[],
-                   rvec4           f[],
-                   rvec            fshift[],
-                   const t_pbc*    pbc,
-                   real            lambda,
-                   real*           dvdlambda,
-                   const t_mdatoms gmx_unused* md,
-                   t_fcdata gmx_unused* fcd,
-                   int gmx_unused* global_atom_index)
+std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
+linear_angles(int             nbonds,
+              const t_iatom   forceatoms[],
+              const t_iparams forceparams[],
+              const rvec      x[],
+              rvec4           f[],
+              rvec            fshift[],
+              const t_pbc*    pbc,
+              real            lambda,
+              real*           dvdlambda,
+              const t_mdatoms gmx_unused* md,
+              t_fcdata gmx_unused* fcd,
+              int gmx_unused* global_atom_index)
 {
     int  i, m, ai, aj, ak, t1, t2, type;
     rvec f_i, f_j, f_k;
@@ -1178,6 +1282,118 @@ real linear_angles(int             nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Calculates linear angle forces, using SIMD
+ *
+ * Only the A-state parameters are used, as this flavor is never
+ * selected with perturbed interactions.
+ */
+template<BondedKernelFlavor flavor>
+std::enable_if_t<flavor == BondedKernelFlavor::ForcesSimdWhenAvailable, real>
+linear_angles(int             nbonds,
+              const t_iatom   forceatoms[],
+              const t_iparams forceparams[],
+              const rvec      x[],
+              rvec4           f[],
+              rvec gmx_unused fshift[],
+              const t_pbc*    pbc,
+              real gmx_unused lambda,
+              real gmx_unused* dvdlambda,
+              const t_mdatoms gmx_unused* md,
+              t_fcdata gmx_unused* fcd,
+              int gmx_unused* global_atom_index)
+{
+    const int                                nfa1 = 4;
+    int                                      i, iu, s;
+    int                                      type;
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ak[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         coeff[2 * GMX_SIMD_REAL_WIDTH];
+    SimdReal                                 xi_S, yi_S, zi_S;
+    SimdReal                                 xj_S, yj_S, zj_S;
+    SimdReal                                 xk_S, yk_S, zk_S;
+    SimdReal                                 rijx_S, rijy_S, rijz_S;
+    SimdReal                                 rkjx_S, rkjy_S, rkjz_S;
+    SimdReal                                 one_S(1.0);
+    SimdReal                                 klin_S, a_S, b_S;
+    SimdReal                                 drx_S, dry_S, drz_S;
+    SimdReal                                 fa_S, fb_S;
+    alignas(GMX_SIMD_ALIGNMENT) real         pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of angles times nfa1, here we step GMX_SIMD_REAL_WIDTH angles */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH * nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH angles.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu + 1];
+            aj[s] = forceatoms[iu + 2];
+            ak[s] = forceatoms[iu + 3];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s * nfa1 < nbonds)
+            {
+                coeff[s]                       = forceparams[type].linangle.klinA;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = forceparams[type].linangle.aA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                       = 0;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = 0;
+            }
+        }
+
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ai, &xi_S, &yi_S, &zi_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), aj, &xj_S, &yj_S, &zj_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ak, &xk_S, &yk_S, &zk_S);
+        rijx_S = xi_S - xj_S;
+        rijy_S = yi_S - yj_S;
+        rijz_S = zi_S - zj_S;
+        rkjx_S = xk_S - xj_S;
+        rkjy_S = yk_S - yj_S;
+        rkjz_S = zk_S - zj_S;
+
+        pbc_correct_dx_simd(&rijx_S, &rijy_S, &rijz_S, pbc_simd);
+        pbc_correct_dx_simd(&rkjx_S, &rkjy_S, &rkjz_S, pbc_simd);
+
+        klin_S = load<SimdReal>(coeff);
+        a_S    = load<SimdReal>(coeff + GMX_SIMD_REAL_WIDTH);
+        b_S    = one_S - a_S;
+
+        /* The deviation of the middle atom from the line through i and k */
+        drx_S = -(a_S * rijx_S + b_S * rkjx_S);
+        dry_S = -(a_S * rijy_S + b_S * rkjy_S);
+        drz_S = -(a_S * rijz_S + b_S * rkjz_S);
+
+        fa_S = a_S * klin_S;
+        fb_S = b_S * klin_S;
+
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ai, fa_S * drx_S, fa_S * dry_S,
+                                 fa_S * drz_S);
+        transposeScatterDecrU<4>(reinterpret_cast<real*>(f), aj, klin_S * drx_S, klin_S * dry_S,
+                                 klin_S * drz_S);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ak, fb_S * drx_S, fb_S * dry_S,
+                                 fb_S * drz_S);
+    }
+
+    return 0;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 template<BondedKernelFlavor flavor>
 std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
 urey_bradley(int             nbonds,
@@ -2092,18 +2308,19 @@ rbdihs(int             nbonds,
 
 
 template<BondedKernelFlavor flavor>
-real idihs(int             nbonds,
-           const t_iatom   forceatoms[],
-           const t_iparams forceparams[],
-           const rvec      x[],
-           rvec4           f[],
-           rvec            fshift[],
-           const t_pbc*    pbc,
-           real            lambda,
-           real*           dvdlambda,
-           const t_mdatoms gmx_unused* md,
-           t_fcdata gmx_unused* fcd,
-           int gmx_unused* global_atom_index)
+std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
+idihs(int             nbonds,
+      const t_iatom   forceatoms[],
+      const t_iparams forceparams[],
+      const rvec      x[],
+      rvec4           f[],
+      rvec            fshift[],
+      const t_pbc*    pbc,
+      real            lambda,
+      real*           dvdlambda,
+      const t_mdatoms gmx_unused* md,
+      t_fcdata gmx_unused* fcd,
+      int gmx_unused* global_atom_index)
 {
     int  i, type, ai, aj, ak, al;
     int  t1, t2, t3;
@@ -2160,6 +2377,116 @@ real idihs(int             nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Calculates improper dihedral forces, using SIMD
+ *
+ * Only the A-state parameters are used, as this flavor is never
+ * selected with perturbed interactions.
+ */
+template<BondedKernelFlavor flavor>
+std::enable_if_t<flavor == BondedKernelFlavor::ForcesSimdWhenAvailable, real>
+idihs(int             nbonds,
+      const t_iatom   forceatoms[],
+      const t_iparams forceparams[],
+      const rvec      x[],
+      rvec4           f[],
+      rvec gmx_unused fshift[],
+      const t_pbc*    pbc,
+      real gmx_unused lambda,
+      real gmx_unused* dvdlambda,
+      const t_mdatoms gmx_unused* md,
+      t_fcdata gmx_unused* fcd,
+      int gmx_unused* global_atom_index)
+{
+    const int                                nfa1 = 5;
+    int                                      i, iu, s;
+    int                                      type;
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ak[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t al[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         coeff[2 * GMX_SIMD_REAL_WIDTH];
+    SimdReal                                 deg2rad_S(DEG2RAD);
+    SimdReal                                 twopi_S(2 * M_PI);
+    SimdReal                                 inv_twopi_S(1 / (2 * M_PI));
+    SimdReal                                 p_S, q_S;
+    SimdReal                                 k_S, phi0_S, phi_S, dp_S;
+    SimdReal                                 mx_S, my_S, mz_S;
+    SimdReal                                 nx_S, ny_S, nz_S;
+    SimdReal                                 nrkj_m2_S, nrkj_n2_S;
+    SimdReal                                 mddphi_S;
+    SimdReal                                 sf_i_S, msf_l_S;
+    alignas(GMX_SIMD_ALIGNMENT) real         pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH * nfa1)
+    {
+        /* Collect atoms quadruplets for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu + 1];
+            aj[s] = forceatoms[iu + 2];
+            ak[s] = forceatoms[iu + 3];
+            al[s] = forceatoms[iu + 4];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s * nfa1 < nbonds)
+            {
+                coeff[s]                       = forceparams[type].harmonic.krA;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                       = 0;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = 0;
+            }
+        }
+
+        /* Calculate GMX_SIMD_REAL_WIDTH dihedral angles at once */
+        dih_angle_simd(x, ai, aj, ak, al, pbc_simd, &phi_S, &mx_S, &my_S, &mz_S, &nx_S, &ny_S,
+                       &nz_S, &nrkj_m2_S, &nrkj_n2_S, &p_S, &q_S);
+
+        k_S    = load<SimdReal>(coeff);
+        phi0_S = load<SimdReal>(coeff + GMX_SIMD_REAL_WIDTH) * deg2rad_S;
+
+        /* As make_dp_periodic, but without branches: put phi-phi0 in [-pi,pi] */
+        dp_S = phi_S - phi0_S;
+        dp_S = fnma(twopi_S, round(dp_S * inv_twopi_S), dp_S);
+
+        mddphi_S = -k_S * dp_S;
+        sf_i_S   = mddphi_S * nrkj_m2_S;
+        msf_l_S  = mddphi_S * nrkj_n2_S;
+
+        /* After this m?_S will contain f[i] */
+        mx_S = sf_i_S * mx_S;
+        my_S = sf_i_S * my_S;
+        mz_S = sf_i_S * mz_S;
+
+        /* After this m?_S will contain -f[l] */
+        nx_S = msf_l_S * nx_S;
+        ny_S = msf_l_S * ny_S;
+        nz_S = msf_l_S * nz_S;
+
+        do_dih_fup_noshiftf_simd(ai, aj, ak, al, p_S, q_S, mx_S, my_S, mz_S, nx_S, ny_S, nz_S, f);
+    }
+
+    return 0;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 /*! \brief Computes angle restraints of two different types */
 template<BondedKernelFlavor flavor>
 real low_angres(int             nbonds,
@@ -2397,18 +2724,19 @@ real unimplemented(int gmx_unused nbonds,
 }
 
 template<BondedKernelFlavor flavor>
-real restrangles(int             nbonds,
-                 const t_iatom   forceatoms[],
-                 const t_iparams forceparams[],
-                 const rvec      x[],
-                 rvec4           f[],
-                 rvec            fshift[],
-                 const t_pbc*    pbc,
-                 real gmx_unused lambda,
-                 real gmx_unused* dvdlambda,
-                 const t_mdatoms gmx_unused* md,
-                 t_fcdata gmx_unused* fcd,
-                 int gmx_unused* global_atom_index)
+std::enable_if_t<flavor != BondedKernelFlavor::ForcesSimdWhenAvailable || !GMX_SIMD_HAVE_REAL, real>
+restrangles(int             nbonds,
+            const t_iatom   forceatoms[],
+            const t_iparams forceparams[],
+            const rvec      x[],
+            rvec4           f[],
+            rvec            fshift[],
+            const t_pbc*    pbc,
+            real gmx_unused lambda,
+            real gmx_unused* dvdlambda,
+            const t_mdatoms gmx_unused* md,
+            t_fcdata gmx_unused* fcd,
+            int gmx_unused* global_atom_index)
 {
     int    i, d, ai, aj, ak, type, m;
     int    t1, t2;
@@ -2497,6 +2825,141 @@ real restrangles(int             nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Calculates restricted bending forces, using SIMD
+ *
+ * This computes the same factors as compute_factors_restangles(),
+ * but in real instead of double precision. To limit the loss of
+ * accuracy for angles close to 180 degrees, sin^2 is computed from
+ * the cross product instead of from 1 - cos^2.
+ */
+template<BondedKernelFlavor flavor>
+std::enable_if_t<flavor == BondedKernelFlavor::ForcesSimdWhenAvailable, real>
+restrangles(int             nbonds,
+            const t_iatom   forceatoms[],
+            const t_iparams forceparams[],
+            const rvec      x[],
+            rvec4           f[],
+            rvec gmx_unused fshift[],
+            const t_pbc*    pbc,
+            real gmx_unused lambda,
+            real gmx_unused* dvdlambda,
+            const t_mdatoms gmx_unused* md,
+            t_fcdata gmx_unused* fcd,
+            int gmx_unused* global_atom_index)
+{
+    const int                                nfa1 = 4;
+    int                                      i, iu, s;
+    int                                      type;
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ai[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t aj[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t ak[GMX_SIMD_REAL_WIDTH];
+    alignas(GMX_SIMD_ALIGNMENT) real         coeff[2 * GMX_SIMD_REAL_WIDTH];
+    SimdReal                                 deg2rad_S(DEG2RAD);
+    SimdReal                                 one_S(1.0);
+    SimdReal                                 xi_S, yi_S, zi_S;
+    SimdReal                                 xj_S, yj_S, zj_S;
+    SimdReal                                 xk_S, yk_S, zk_S;
+    SimdReal                                 dax_S, day_S, daz_S;
+    SimdReal                                 dpx_S, dpy_S, dpz_S;
+    SimdReal                                 cx_S, cy_S, cz_S;
+    SimdReal                                 k_S, cos0_S;
+    SimdReal                                 c_ante_S, c_cros_S, c_post_S;
+    SimdReal                                 norm2_S, norm_S, cos_S, sin2_S;
+    SimdReal                                 ratio_ante_S, ratio_post_S;
+    SimdReal                                 prefactor_S;
+    SimdReal                                 f_ix_S, f_iy_S, f_iz_S;
+    SimdReal                                 f_kx_S, f_ky_S, f_kz_S;
+    alignas(GMX_SIMD_ALIGNMENT) real         pbc_simd[9 * GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of angles times nfa1, here we step GMX_SIMD_REAL_WIDTH angles */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH * nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH angles.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu + 1];
+            aj[s] = forceatoms[iu + 2];
+            ak[s] = forceatoms[iu + 3];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s * nfa1 < nbonds)
+            {
+                coeff[s]                       = forceparams[type].harmonic.krA;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                       = 0;
+                coeff[GMX_SIMD_REAL_WIDTH + s] = 0;
+            }
+        }
+
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ai, &xi_S, &yi_S, &zi_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), aj, &xj_S, &yj_S, &zj_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real*>(x), ak, &xk_S, &yk_S, &zk_S);
+        dax_S = xj_S - xi_S;
+        day_S = yj_S - yi_S;
+        daz_S = zj_S - zi_S;
+        dpx_S = xk_S - xj_S;
+        dpy_S = yk_S - yj_S;
+        dpz_S = zk_S - zj_S;
+
+        pbc_correct_dx_simd(&dax_S, &day_S, &daz_S, pbc_simd);
+        pbc_correct_dx_simd(&dpx_S, &dpy_S, &dpz_S, pbc_simd);
+
+        k_S = load<SimdReal>(coeff);
+        /* cos(pi - theta0) */
+        cos0_S = -cos(load<SimdReal>(coeff + GMX_SIMD_REAL_WIDTH) * deg2rad_S);
+
+        c_ante_S = norm2(dax_S, day_S, daz_S);
+        c_cros_S = iprod(dax_S, day_S, daz_S, dpx_S, dpy_S, dpz_S);
+        c_post_S = norm2(dpx_S, dpy_S, dpz_S);
+
+        cprod(dax_S, day_S, daz_S, dpx_S, dpy_S, dpz_S, &cx_S, &cy_S, &cz_S);
+
+        norm_S  = invsqrt(c_ante_S * c_post_S);
+        norm2_S = norm_S * norm_S;
+        cos_S   = c_cros_S * norm_S;
+        sin2_S  = norm2(cx_S, cy_S, cz_S) * norm2_S;
+
+        ratio_ante_S = c_cros_S * inv(c_ante_S);
+        ratio_post_S = c_cros_S * inv(c_post_S);
+
+        prefactor_S = -k_S * (cos_S - cos0_S) * norm_S * fnma(cos_S, cos0_S, one_S)
+                      * inv(sin2_S * sin2_S);
+
+        f_ix_S = prefactor_S * fms(ratio_ante_S, dax_S, dpx_S);
+        f_iy_S = prefactor_S * fms(ratio_ante_S, day_S, dpy_S);
+        f_iz_S = prefactor_S * fms(ratio_ante_S, daz_S, dpz_S);
+        f_kx_S = prefactor_S * fnma(ratio_post_S, dpx_S, dax_S);
+        f_ky_S = prefactor_S * fnma(ratio_post_S, dpy_S, day_S);
+        f_kz_S = prefactor_S * fnma(ratio_post_S, dpz_S, daz_S);
+
+        /* f_j = -(f_i + f_k) */
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ai, f_ix_S, f_iy_S, f_iz_S);
+        transposeScatterDecrU<4>(reinterpret_cast<real*>(f), aj, f_ix_S + f_kx_S, f_iy_S + f_ky_S,
+                                 f_iz_S + f_kz_S);
+        transposeScatterIncrU<4>(reinterpret_cast<real*>(f), ak, f_kx_S, f_ky_S, f_kz_S);
+    }
+
+    return 0;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 
 template<BondedKernelFlavor flavor>
 real restrdihs(int             nbonds,
@@ -45,6 +45,9 @@
 #ifndef GMX_LISTED_FORCES_LISTED_INTERNAL_H
 #define GMX_LISTED_FORCES_LISTED_INTERNAL_H
 
+#include <cstdint>
+#include <cstdio>
+
 #include <memory>
 
 #include "gromacs/math/vectypes.h"
@@ -54,6 +57,7 @@
 #include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/bitmask.h"
 #include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/defaultinitializationallocator.h"
 
 /* We reduce the force array in blocks of 32 atoms. This is large enough
  * to not cause overhead and 32*sizeof(rvec) is a multiple of the cache-line
@@ -101,8 +105,13 @@ struct f_thread_t
 
     //! Force array pointer, equals fBuffer.data(), needed because rvec4 is not a C++ type
     rvec4* f = nullptr;
-    //! Force array buffer
-    std::vector<real, gmx::AlignedAllocator<real>> fBuffer;
+    /*! \brief Force array buffer, extends up to the last block touched by this thread
+     *
+     * The buffer is not initialized, only the blocks touched by this thread
+     * are cleared and written, so the memory of the other blocks is not used.
+     */
+    std::vector<real, gmx::DefaultInitializationAllocator<real, gmx::AlignedAllocator<real>>>
+            fBuffer;
     //! Mask for marking which parts of f are filled, working array for constructing mask in bonded_threading_t
     std::vector<gmx_bitmask_t> mask;
     //! Number of blocks touched by our thread
@@ -148,6 +157,15 @@ struct bonded_threading_t
      */
     //! Maximum thread count for uniform distribution of bondeds over threads
     int max_nthread_uniform = 0;
+    //! Whether the localized distribution shifts thread bounds to minimize shared force blocks
+    bool minimizeSharedBlocks = true;
+
+    //! The number of bytes of force buffers cleared and reduced per step
+    int64_t reductionBytesPerStep = 0;
+    //! Log file, used for reporting the reduction setup once, can be nullptr
+    FILE* fplog = nullptr;
+    //! Whether we reported the reduction setup to fplog
+    bool haveReportedReduction = false;
 
     //! The division of work in the t_list over threads.
     WorkDivision workDivision;
@@ -56,10 +56,12 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "gromacs/listed_forces/gpubonded.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
@@ -75,26 +77,111 @@ typedef struct
     int                    nat;   /**< nr of atoms involved in a single ftype interaction */
 } ilist_data_t;
 
+/*! \brief The fraction of the average thread load by which we may shift the bound between threads
+ *
+ * Shifting the bounds allows for reducing the number of force blocks
+ * touched by multiple threads, at the cost of some load imbalance.
+ */
+static constexpr double c_threadBoundShiftTolerance = 0.05;
+
+/*! \brief Returns the interaction index in the merged order at which to end thread \p t - 1
+ *
+ * Returns the exact division point when \p minimizeSharedBlocks is false.
+ * Otherwise returns the point with a cost within the tolerance of the exact
+ * point which minimizes the number of blocks touched by both thread t-1 and t.
+ *
+ * \param[in] costSum           The cost of all interactions before each index in the merged order
+ * \param[in] maxBlockBefore    The maximum block touched by all interactions before each index
+ * \param[in] minBlockFrom      The minimum block touched by all interactions from each index on
+ * \param[in] prevBound         The end bound of the previous thread
+ * \param[in] costTarget        The cost target for the end of thread t-1
+ * \param[in] costTolerance     The maximum deviation of the cost from \p costTarget
+ * \param[in] minimizeSharedBlocks  Whether to minimize the number of shared blocks
+ */
+static int threadEndBound(gmx::ArrayRef<const int> costSum,
+                          gmx::ArrayRef<const int> maxBlockBefore,
+                          gmx::ArrayRef<const int> minBlockFrom,
+                          int                      prevBound,
+                          int                      costTarget,
+                          int                      costTolerance,
+                          bool                     minimizeSharedBlocks)
+{
+    const int numInteractions = costSum.ssize() - 1;
+
+    int exactBound = prevBound;
+    while (exactBound < numInteractions && costSum[exactBound] < costTarget)
+    {
+        exactBound++;
+    }
+    if (!minimizeSharedBlocks)
+    {
+        return exactBound;
+    }
+
+    /* Returns the number of blocks touched by interactions on both sides of a bound */
+    auto numSharedBlocks = [&](int bound) {
+        if (bound == 0 || bound == numInteractions)
+        {
+            return 0;
+        }
+        return std::max(maxBlockBefore[bound] - minBlockFrom[bound] + 1, 0);
+    };
+
+    int bestBound     = exactBound;
+    int bestNumShared = numSharedBlocks(exactBound);
+    /* Search in both directions, we only accept strict improvements,
+     * so we prefer bounds closer to the exact bound.
+     */
+    for (int bound = exactBound - 1;
+         bestNumShared > 0 && bound >= prevBound && costSum[bound] >= costTarget - costTolerance; bound--)
+    {
+        if (numSharedBlocks(bound) < bestNumShared)
+        {
+            bestBound     = bound;
+            bestNumShared = numSharedBlocks(bound);
+        }
+    }
+    for (int bound = exactBound + 1; bestNumShared > 0 && bound <= numInteractions
+                                     && costSum[bound] <= costTarget + costTolerance;
+         bound++)
+    {
+        if (numSharedBlocks(bound) < bestNumShared
+            || (numSharedBlocks(bound) == bestNumShared && bestBound < exactBound
+                && bound - exactBound < exactBound - bestBound))
+        {
+            bestBound     = bound;
+            bestNumShared = numSharedBlocks(bound);
+        }
+    }
+
+    return bestBound;
+}
+
 /*! \brief Divides listed interactions over threads
  *
  * This routine attempts to divide all interactions of the numType bondeds
  * types stored in ild over the threads such that each thread has roughly
  * equal load and different threads avoid touching the same atoms as much
  * as possible.
+ * With bt->minimizeSharedBlocks, the bounds between threads are shifted,
+ * within a small tolerance of the load, such that the number of force
+ * reduction blocks touched by multiple threads is minimized.
  */
 static void divide_bondeds_by_locality(bonded_threading_t* bt, int numType, const ilist_data_t* ild)
 {
-    int nat_tot, nat_sum;
+    int nat_tot;
     int ind[F_NRE];    /* index into the ild[].il->iatoms */
     int at_ind[F_NRE]; /* index of the first atom of the interaction at ind */
     int f, t;
 
     assert(numType <= F_NRE);
 
-    nat_tot = 0;
+    int numInteractions = 0;
+    nat_tot             = 0;
     for (f = 0; f < numType; f++)
     {
         /* Sum #bondeds*#atoms_per_bond over all bonded types */
+        numInteractions += ild[f].il->size() / (ild[f].nat + 1);
         nat_tot += ild[f].il->size() / (ild[f].nat + 1) * ild[f].nat;
         /* The start bound for thread 0 is 0 for all interactions */
         ind[f] = 0;
@@ -103,76 +190,123 @@ static void divide_bondeds_by_locality(bonded_threading_t* bt, int numType, cons
         at_ind[f] = ild[f].il->iatoms[1];
     }
 
-    nat_sum = 0;
-    /* Loop over the end bounds of the nthreads threads to determine
-     * which interactions threads 0 to nthreads shall calculate.
+    /* Merge the interactions of all types in order of their first atom.
+     * For each position in this merged order we store the type index,
+     * the cost of all interactions before and the maximum block touched
+     * by all interactions before. Afterwards we compute the minimum block
+     * touched by all interactions from each position on.
      *
-     * NOTE: The cost of these combined loops is #interactions*numType.
+     * To divide bonds based on atom order, we compare
+     * the index of the first atom in the bonded interaction.
+     * This works well, since the domain decomposition generates
+     * bondeds in order of the atoms by looking up interactions
+     * which are linked to the first atom in each interaction.
+     * It usually also works well without DD, since than the atoms
+     * in bonded interactions are usually in increasing order.
+     * If they are not assigned in increasing order, the balancing
+     * is still good, but the memory access and reduction cost will
+     * be higher.
+     *
+     * Here we assume that the computational cost is proportional
+     * to the number of atoms in the interaction. This is a rough
+     * measure, but roughly correct. Usually there are very few
+     * interactions anyhow and there are distributed relatively
+     * uniformly. Proper and RB dihedrals are often distributed
+     * non-uniformly, but their cost is roughly equal.
+     *
+     * NOTE: The cost of this loop is #interactions*numType.
      * This code is running single threaded (difficult to parallelize
-     * over threads). So the relative cost of this function increases
-     * linearly with the number of threads. Since the inner-most loop
-     * is cheap and this is done only at DD repartitioning, the cost should
-     * be negligble. At high thread count many other parts of the code
-     * scale the same way, so it's (currently) not worth improving this.
+     * over threads). Since the inner-most loop is cheap and this is done
+     * only at DD repartitioning, the cost should be negligble.
      */
-    for (t = 1; t <= bt->nthreads; t++)
+    std::vector<int> order(numInteractions);
+    std::vector<int> costSum(numInteractions + 1);
+    std::vector<int> maxBlockBefore(numInteractions + 1);
+    std::vector<int> minBlockFrom(numInteractions + 1);
+    costSum[0]        = 0;
+    maxBlockBefore[0] = -1;
+    for (int i = 0; i < numInteractions; i++)
     {
-        int nat_thread;
-
-        /* Here we assume that the computational cost is proportional
-         * to the number of atoms in the interaction. This is a rough
-         * measure, but roughly correct. Usually there are very few
-         * interactions anyhow and there are distributed relatively
-         * uniformly. Proper and RB dihedrals are often distributed
-         * non-uniformly, but their cost is roughly equal.
-         */
-        nat_thread = (nat_tot * t) / bt->nthreads;
-
-        while (nat_sum < nat_thread)
-        {
-            /* To divide bonds based on atom order, we compare
-             * the index of the first atom in the bonded interaction.
-             * This works well, since the domain decomposition generates
-             * bondeds in order of the atoms by looking up interactions
-             * which are linked to the first atom in each interaction.
-             * It usually also works well without DD, since than the atoms
-             * in bonded interactions are usually in increasing order.
-             * If they are not assigned in increasing order, the balancing
-             * is still good, but the memory access and reduction cost will
-             * be higher.
-             */
-            int f_min;
+        int f_min;
 
-            /* Find out which of the types has the lowest atom index */
-            f_min = 0;
-            for (f = 1; f < numType; f++)
+        /* Find out which of the types has the lowest atom index */
+        f_min = 0;
+        for (f = 1; f < numType; f++)
+        {
+            if (at_ind[f] < at_ind[f_min])
             {
-                if (at_ind[f] < at_ind[f_min])
-                {
-                    f_min = f;
-                }
+                f_min = f;
             }
-            assert(f_min >= 0 && f_min < numType);
+        }
+        assert(f_min >= 0 && f_min < numType);
 
-            /* Assign the interaction with the lowest atom index (of type
-             * index f_min) to thread t-1 by increasing ind.
+        const int* iatoms = ild[f_min].il->iatoms.data() + ind[f_min] + 1;
+        int        minBlock = INT_MAX;
+        int        maxBlock = -1;
+        for (int a = 0; a < ild[f_min].nat; a++)
+        {
+            minBlock = std::min(minBlock, iatoms[a] >> reduction_block_bits);
+            maxBlock = std::max(maxBlock, iatoms[a] >> reduction_block_bits);
+        }
+        order[i]              = f_min;
+        costSum[i + 1]        = costSum[i] + ild[f_min].nat;
+        maxBlockBefore[i + 1] = std::max(maxBlockBefore[i], maxBlock);
+        minBlockFrom[i]       = minBlock;
+
+        /* Move to the next interaction of type index f_min */
+        ind[f_min] += ild[f_min].nat + 1;
+
+        /* Update the first unassigned atom index for this type */
+        if (ind[f_min] < ild[f_min].il->size())
+        {
+            at_ind[f_min] = ild[f_min].il->iatoms[ind[f_min] + 1];
+        }
+        else
+        {
+            /* We have assigned all interactions of this type.
+             * Setting at_ind to INT_MAX ensures this type will not be
+             * chosen in the for loop above during next iterations.
              */
-            ind[f_min] += ild[f_min].nat + 1;
-            nat_sum += ild[f_min].nat;
+            at_ind[f_min] = INT_MAX;
+        }
+    }
+    minBlockFrom[numInteractions] = INT_MAX;
+    for (int i = numInteractions - 1; i >= 0; i--)
+    {
+        minBlockFrom[i] = std::min(minBlockFrom[i], minBlockFrom[i + 1]);
+    }
 
-            /* Update the first unassigned atom index for this type */
-            if (ind[f_min] < ild[f_min].il->size())
-            {
-                at_ind[f_min] = ild[f_min].il->iatoms[ind[f_min] + 1];
-            }
-            else
-            {
-                /* We have assigned all interactions of this type.
-                 * Setting at_ind to INT_MAX ensures this type will not be
-                 * chosen in the for loop above during next iterations.
-                 */
-                at_ind[f_min] = INT_MAX;
-            }
+    for (f = 0; f < numType; f++)
+    {
+        ind[f] = 0;
+    }
+
+    const int costTolerance =
+            static_cast<int>(c_threadBoundShiftTolerance * nat_tot / bt->nthreads);
+
+    /* Loop over the end bounds of the nthreads threads to determine
+     * which interactions threads 0 to nthreads shall calculate.
+     */
+    int bound = 0;
+    for (t = 1; t <= bt->nthreads; t++)
+    {
+        const int prevBound = bound;
+        if (t < bt->nthreads)
+        {
+            const int nat_thread = (static_cast<int64_t>(nat_tot) * t) / bt->nthreads;
+
+            bound = threadEndBound(costSum, maxBlockBefore, minBlockFrom, prevBound, nat_thread,
+                                   costTolerance, bt->minimizeSharedBlocks);
+        }
+        else
+        {
+            bound = numInteractions;
+        }
+
+        /* Assign the interactions in the merged order up to bound to thread t-1 */
+        for (int i = prevBound; i < bound; i++)
+        {
+            ind[order[i]] += ild[order[i]].nat + 1;
         }
 
         /* Store the bonded end boundaries (at index t) for thread t-1 */
@@ -351,9 +485,6 @@ static void calc_bonded_reduction_mask(int                           natoms,
 
     f_thread->mask.resize(nblock);
     f_thread->block_index.resize(nblock);
-    // NOTE: It seems f_thread->f does not need to be aligned
-    f_thread->fBuffer.resize(nblock * reduction_block_size * sizeof(rvec4) / sizeof(real));
-    f_thread->f = reinterpret_cast<rvec4*>(f_thread->fBuffer.data());
 
     for (gmx_bitmask_t& mask : f_thread->mask)
     {
@@ -396,6 +527,20 @@ static void calc_bonded_reduction_mask(int                           natoms,
             f_thread->block_index[f_thread->nblock_used++] = b;
         }
     }
+
+    /* The force buffer only needs to extend up to the last block we touch.
+     * The buffer is not initialized and only the blocks we touch are cleared
+     * and written, so the memory pages of the other blocks are never used.
+     * With the locality based work division this is a small part of
+     * the system, which saves memory and improves cache usage.
+     * We clear before resizing to avoid copying the old contents.
+     */
+    const int numBufferBlocks =
+            (f_thread->nblock_used > 0 ? f_thread->block_index[f_thread->nblock_used - 1] + 1 : 1);
+    f_thread->fBuffer.clear();
+    // NOTE: It seems f_thread->f does not need to be aligned
+    f_thread->fBuffer.resize(numBufferBlocks * reduction_block_size * sizeof(rvec4) / sizeof(real));
+    f_thread->f = reinterpret_cast<rvec4*>(f_thread->fBuffer.data());
 }
 
 void setup_bonded_threading(bonded_threading_t*           bt,
@@ -478,8 +623,46 @@ void setup_bonded_threading(bonded_threading_t*           bt,
             }
         }
     }
+    /* Estimate the memory traffic for clearing the thread force buffers,
+     * reducing them and adding the result to the normal force buffer.
+     */
+    int64_t numThreadBlocksUsed = 0;
+    int64_t numThreadBlocksReduced = 0;
+    for (int t = 0; t < bt->nthreads; t++)
+    {
+        numThreadBlocksUsed += bt->f_t[t]->nblock_used;
+    }
+    for (int b = 0; b < bt->nblock_used; b++)
+    {
+        for (int t = 0; t < bt->nthreads; t++)
+        {
+            if (bitmask_is_set(bt->mask[bt->block_index[b]], t))
+            {
+                numThreadBlocksReduced++;
+            }
+        }
+    }
+    bt->reductionBytesPerStep = (numThreadBlocksUsed + numThreadBlocksReduced) * reduction_block_size
+                                        * sizeof(rvec4)
+                                + static_cast<int64_t>(bt->nblock_used) * reduction_block_size * 2
+                                          * sizeof(rvec);
+
+    if (bt->nthreads > 1 && bt->fplog != nullptr && !bt->haveReportedReduction)
+    {
+        fprintf(bt->fplog,
+                "\nListed force reduction over %d threads, %s work division:\n"
+                "  %d blocks of %d atoms, %.2f thread buffers per block, %.1f KB per step\n",
+                bt->nthreads, bt->minimizeSharedBlocks ? "block optimized" : "exact",
+                bt->nblock_used, reduction_block_size,
+                bt->nblock_used > 0 ? numThreadBlocksReduced / static_cast<double>(bt->nblock_used) : 0.0,
+                bt->reductionBytesPerStep / 1024.0);
+        bt->haveReportedReduction = true;
+    }
+
     if (debug)
     {
+        fprintf(debug, "Listed force reduction memory traffic %" PRId64 " bytes per step\n",
+                bt->reductionBytesPerStep);
         fprintf(debug, "Number of %d atom blocks to reduce: %d\n", reduction_block_size, bt->nblock_used);
         fprintf(debug, "Reduction density %.2f for touched blocks only %.2f\n",
                 ctot * reduction_block_size / static_cast<double>(numAtomsForce),
@@ -526,6 +709,17 @@ bonded_threading_t::bonded_threading_t(const int numThreads, const int numEnergy
     const int max_nthread_uniform_default = 4;
     char*     ptr;
 
+    this->fplog = fplog;
+
+    if (getenv("GMX_BONDED_EXACT_DIVISION") != nullptr)
+    {
+        minimizeSharedBlocks = false;
+        if (fplog != nullptr)
+        {
+            fprintf(fplog, "\nUsing exact bonded work division over threads, set by env.var.\n");
+        }
+    }
+
     if ((ptr = getenv("GMX_BONDED_NTHREAD_UNIFORM")) != nullptr)
     {
         sscanf(ptr, "%d", &max_nthread_uniform);
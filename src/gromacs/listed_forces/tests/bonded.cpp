@@ -45,6 +45,7 @@
 
 #include <cmath>
 
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 
@@ -84,8 +85,8 @@ struct OutputQuantities
     real dvdlambda = 0;
     //! Shift vectors
     rvec fshift[N_IVEC] = { { 0 } };
-    //! Forces
-    rvec4 f[c_numAtoms] = { { 0 } };
+    //! Forces, aligned for the SIMD kernels
+    alignas(4 * sizeof(real)) rvec4 f[c_numAtoms] = { { 0 } };
 };
 
 /*! \brief Utility to check the output from bonded tests
@@ -555,6 +556,60 @@ protected:
         // and bonded functions.
         EXPECT_TRUE((input_.fep || (output.dvdlambda == 0.0))) << "dvdlambda was " << output.dvdlambda;
         checkOutput(checker, output);
+        if (!input_.fep)
+        {
+            testForcesOnlyFlavors(iatoms, mdatoms, ddgatindex.data(), output);
+        }
+    }
+    /*! \brief Checks that the forces-only kernel flavors, which use SIMD
+     * for some interaction types, give the same forces as the reference
+     *
+     * These flavors only use the A-state parameters, so this should
+     * only be called for unperturbed input.
+     */
+    void testForcesOnlyFlavors(const std::vector<t_iatom>& iatoms,
+                               const t_mdatoms&            mdatoms,
+                               int*                        globalAtomIndex,
+                               const OutputQuantities&     reference)
+    {
+        real maxForce = 0;
+        for (const auto& f : reference.f)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                maxForce = std::max(maxForce, std::abs(f[d]));
+            }
+        }
+        // The SIMD math functions are less accurate than the libm ones.
+        // With (nearly) planar dihedrals the forces are only rounding noise
+        // of larger terms, so we use a lower bound on the force magnitude.
+        const test::FloatingPointTolerance tolerance = test::relativeToleranceAsFloatingPoint(
+                std::max(maxForce, real(10)), GMX_DOUBLE ? 1e-10 : 5e-5);
+
+        // SIMD loads may access one element beyond the last atom
+        std::vector<gmx::RVec> xPadded = x_;
+        xPadded.emplace_back(0, 0, 0);
+
+        for (const auto flavor : { BondedKernelFlavor::ForcesSimdWhenAvailable,
+                                   BondedKernelFlavor::ForcesNoSimd })
+        {
+            SCOPED_TRACE(std::string("Testing kernel flavor ")
+                         + (flavor == BondedKernelFlavor::ForcesSimdWhenAvailable
+                                    ? "ForcesSimdWhenAvailable"
+                                    : "ForcesNoSimd"));
+            OutputQuantities output;
+            calculateSimpleBond(input_.ftype, iatoms.size(), iatoms.data(), &input_.iparams,
+                                as_rvec_array(xPadded.data()), output.f, output.fshift, &pbc_, 0,
+                                &output.dvdlambda, &mdatoms, nullptr, globalAtomIndex, flavor);
+            for (int a = 0; a < c_numAtoms; a++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(reference.f[a][d], output.f[a][d], tolerance)
+                            << "for atom " << a << " dimension " << d;
+                }
+            }
+        }
     }
     void testIfunc()
     {
@@ -0,0 +1,191 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the division of listed interactions over threads
+ *
+ * \ingroup module_listed_forces
+ */
+#include "gmxpre.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/listed_forces/listed_internal.h"
+#include "gromacs/listed_forces/manage_threading.h"
+#include "gromacs/topology/forcefieldparameters.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/bitmask.h"
+
+namespace gmx
+{
+namespace
+{
+
+//! The number of atoms in the test system
+constexpr int c_numAtoms = 3000;
+//! The number of threads, above the limit for the uniform division
+constexpr int c_numThreads = 8;
+//! The function types in the test system
+constexpr std::array<int, 3> c_functionTypes = { F_BONDS, F_ANGLES, F_PDIHS };
+
+/*! \brief Fills \p idef with the bonded interactions of a linear chain
+ *
+ * Also adds bonds between atoms 70 apart every 50 atoms, these cause
+ * force blocks to be shared between threads when the chain is divided.
+ */
+void fillChainInteractions(InteractionDefinitions* idef)
+{
+    for (int a = 0; a < c_numAtoms; a++)
+    {
+        if (a + 1 < c_numAtoms)
+        {
+            idef->il[F_BONDS].push_back(0, std::array<int, 2>{ a, a + 1 });
+        }
+        if (a % 50 == 0 && a + 70 < c_numAtoms)
+        {
+            idef->il[F_BONDS].push_back(0, std::array<int, 2>{ a, a + 70 });
+        }
+        if (a + 2 < c_numAtoms)
+        {
+            idef->il[F_ANGLES].push_back(0, std::array<int, 3>{ a, a + 1, a + 2 });
+        }
+        if (a + 3 < c_numAtoms)
+        {
+            idef->il[F_PDIHS].push_back(0, std::array<int, 4>{ a, a + 1, a + 2, a + 3 });
+        }
+    }
+}
+
+//! Returns the number of force blocks that are touched by more than one thread
+int numSharedBlocks(const bonded_threading_t& bt)
+{
+    int numShared = 0;
+    for (int b = 0; b < bt.nblock_used; b++)
+    {
+        int numThreadsTouching = 0;
+        for (int t = 0; t < bt.nthreads; t++)
+        {
+            if (bitmask_is_set(bt.mask[bt.block_index[b]], t))
+            {
+                numThreadsTouching++;
+            }
+        }
+        if (numThreadsTouching > 1)
+        {
+            numShared++;
+        }
+    }
+    return numShared;
+}
+
+/*! \brief Checks the thread division of the interactions in \p idef
+ *
+ * \returns the number of force blocks shared between threads
+ */
+int checkDivision(const InteractionDefinitions& idef, const bool minimizeSharedBlocks)
+{
+    bonded_threading_t bt(c_numThreads, 1, nullptr);
+    bt.minimizeSharedBlocks = minimizeSharedBlocks;
+    setup_bonded_threading(&bt, c_numAtoms, false, idef);
+
+    /* All interactions should be assigned once, in order */
+    std::vector<int> threadCost(c_numThreads, 0);
+    int              totalCost = 0;
+    int              maxCost   = 0;
+    for (const int ftype : c_functionTypes)
+    {
+        const int stride = 1 + NRAL(ftype);
+        EXPECT_EQ(0, bt.workDivision.bound(ftype, 0));
+        EXPECT_EQ(idef.il[ftype].size(), bt.workDivision.end(ftype));
+        for (int t = 0; t < c_numThreads; t++)
+        {
+            const int numEntries =
+                    bt.workDivision.bound(ftype, t + 1) - bt.workDivision.bound(ftype, t);
+            EXPECT_GE(numEntries, 0);
+            EXPECT_EQ(0, numEntries % stride);
+            threadCost[t] += numEntries / stride * NRAL(ftype);
+        }
+        totalCost += idef.il[ftype].size() / stride * NRAL(ftype);
+        maxCost = std::max(maxCost, NRAL(ftype));
+    }
+
+    /* The load imbalance should be within the tolerance for shifting the bounds */
+    const double averageCost = totalCost / static_cast<double>(c_numThreads);
+    const double tolerance = (minimizeSharedBlocks ? 2 * 0.05 * averageCost : 0) + 2 * maxCost;
+    for (int t = 0; t < c_numThreads; t++)
+    {
+        EXPECT_NEAR(averageCost, threadCost[t], tolerance) << "for thread " << t;
+    }
+
+    /* The force buffers should cover all blocks the thread touches */
+    for (int t = 0; t < c_numThreads; t++)
+    {
+        const f_thread_t& fThread = *bt.f_t[t];
+        EXPECT_GT(fThread.nblock_used, 0) << "for thread " << t;
+        if (fThread.nblock_used == 0)
+        {
+            continue;
+        }
+        const size_t numTouchedReals =
+                (fThread.block_index[fThread.nblock_used - 1] + 1) * reduction_block_size * 4;
+        EXPECT_GE(fThread.fBuffer.size(), numTouchedReals) << "for thread " << t;
+    }
+
+    return numSharedBlocks(bt);
+}
+
+TEST(ListedForcesThreadingTest, LocalityDivisionIsBalancedAndMinimizesSharedBlocks)
+{
+    gmx_ffparams_t         ffparams;
+    InteractionDefinitions idef(ffparams);
+    fillChainInteractions(&idef);
+
+    const int numSharedExact     = checkDivision(idef, false);
+    const int numSharedOptimized = checkDivision(idef, true);
+
+    /* Between each pair of neighboring threads at least the block
+     * with the bound is shared.
+     */
+    EXPECT_GE(numSharedExact, c_numThreads - 1);
+    EXPECT_LE(numSharedOptimized, numSharedExact);
+}
+
+} // namespace
+} // namespace gmx
@@ -131,7 +131,12 @@ public:
                ArrayRefWithPadding<RVec> v,
                bool                      computeVirial,
                tensor                    constraintsVirial,
-               ConstraintVariable        econq);
+               ConstraintVariable        econq,
+               const FusedSettleOutput*  fusedSettleOutput = nullptr);
+    //! Sets up fusedSettleLayout_ for the current local topology
+    void setFusedSettleLayout();
+    //! Reports a SETTLE error at \p step, exits with a fatal error after too many warnings
+    void reportSettleError(int64_t step);
     //! The total number of constraints.
     int ncon_tot = 0;
     //! The number of flexible constraints.
@@ -180,6 +185,8 @@ public:
     unsigned short* cFREEZE_;
     //! Whether we need to do pbc for handling bonds.
     bool pbcHandlingRequired_ = false;
+    //! The SETTLE layout for fusing SETTLE with the update, when the topology allows it
+    std::optional<FusedSettleLayout> fusedSettleLayout_;
 
     //! Logging support.
     FILE* log = nullptr;
@@ -360,6 +367,27 @@ bool Constraints::apply(bool                      bLog,
                         computeVirial, constraintsVirial, econq);
 }
 
+void Constraints::Impl::reportSettleError(int64_t step)
+{
+    char buf[STRLEN];
+    sprintf(buf,
+            "\nstep "
+            "%" PRId64
+            ": One or more water molecules can not be settled.\n"
+            "Check for bad contacts and/or reduce the timestep if appropriate.\n",
+            step);
+    if (log)
+    {
+        fprintf(log, "%s", buf);
+    }
+    fprintf(stderr, "%s", buf);
+    warncount_settle++;
+    if (warncount_settle > maxwarn)
+    {
+        too_many_constraint_warnings(-1, warncount_settle);
+    }
+}
+
 bool Constraints::Impl::apply(bool                      bLog,
                               bool                      bEner,
                               int64_t                   step,
@@ -374,7 +402,8 @@ bool Constraints::Impl::apply(bool                      bLog,
                               ArrayRefWithPadding<RVec> v,
                               bool                      computeVirial,
                               tensor                    constraintsVirial,
-                              ConstraintVariable        econq)
+                              ConstraintVariable        econq,
+                              const FusedSettleOutput*  fusedSettleOutput)
 {
     bool  bOK, bDump;
     int   start;
@@ -428,7 +457,7 @@ bool Constraints::Impl::apply(bool                      bLog,
     const InteractionList& settle = idef->il[F_SETTLE];
     nsettle                       = settle.size() / (1 + NRAL(F_SETTLE));
 
-    if (nsettle > 0)
+    if (nsettle > 0 && fusedSettleOutput == nullptr)
     {
         nth = gmx_omp_nthreads_get(emntSETTLE);
     }
@@ -509,7 +538,33 @@ bool Constraints::Impl::apply(bool                      bLog,
         }
     }
 
-    if (nsettle > 0)
+    if (nsettle > 0 && fusedSettleOutput != nullptr)
+    {
+        GMX_ASSERT(econq == ConstraintVariable::Positions,
+                   "SETTLE can only be fused with the update for positions");
+
+        /* SETTLE has already been applied during the update */
+        if (computeVirial)
+        {
+            m_add(constraintsVirial, fusedSettleOutput->virial, constraintsVirial);
+        }
+        inc_nrnb(nrnb, eNR_SETTLE, nsettle);
+        if (!v.empty())
+        {
+            inc_nrnb(nrnb, eNR_CONSTR_V, nsettle * 3);
+        }
+        if (computeVirial)
+        {
+            inc_nrnb(nrnb, eNR_CONSTR_VIR, nsettle * 3);
+        }
+        if (fusedSettleOutput->errorHasOccurred)
+        {
+            reportSettleError(step);
+            bDump = TRUE;
+            bOK   = FALSE;
+        }
+    }
+    else if (nsettle > 0)
     {
         bool bSettleErrorHasOccurred0 = false;
 
@@ -608,23 +663,7 @@ bool Constraints::Impl::apply(bool                      bLog,
 
             if (bSettleErrorHasOccurred0)
             {
-                char buf[STRLEN];
-                sprintf(buf,
-                        "\nstep "
-                        "%" PRId64
-                        ": One or more water molecules can not be settled.\n"
-                        "Check for bad contacts and/or reduce the timestep if appropriate.\n",
-                        step);
-                if (log)
-                {
-                    fprintf(log, "%s", buf);
-                }
-                fprintf(stderr, "%s", buf);
-                warncount_settle++;
-                if (warncount_settle > maxwarn)
-                {
-                    too_many_constraint_warnings(-1, warncount_settle);
-                }
+                reportSettleError(step);
                 bDump = TRUE;
 
                 bOK = FALSE;
@@ -947,6 +986,89 @@ void Constraints::Impl::setConstraints(gmx_localtop_t* top,
     {
         dd_make_local_ed_indices(cr->dd, ed);
     }
+
+    setFusedSettleLayout();
+}
+
+void Constraints::Impl::setFusedSettleLayout()
+{
+    fusedSettleLayout_.reset();
+
+    const int nral1 = 1 + NRAL(F_SETTLE);
+
+    ArrayRef<const int> settleAtoms = idef->il[F_SETTLE].iatoms;
+    const int           numSettles  = settleAtoms.ssize() / nral1;
+    if (numSettles == 0 || cr->dd || shaked != nullptr || cFREEZE_ != nullptr)
+    {
+        return;
+    }
+
+    /* The SETTLE atoms should be contiguous and ordered, so blocks of atoms
+     * can be settled independently during the update.
+     */
+    const int firstAtom = settleAtoms[1];
+    for (int i = 0; i < numSettles; i++)
+    {
+        for (int j = 0; j < NRAL(F_SETTLE); j++)
+        {
+            if (settleAtoms[i * nral1 + 1 + j] != firstAtom + i * NRAL(F_SETTLE) + j)
+            {
+                return;
+            }
+        }
+    }
+    const int endAtom = firstAtom + numSettles * NRAL(F_SETTLE);
+    if (endAtom > numHomeAtoms_)
+    {
+        return;
+    }
+
+    /* The other constraints are applied after the SETTLE atoms have been
+     * copied back, so they should not involve these atoms.
+     */
+    bool haveOtherConstraints = false;
+    for (int ftype : { F_CONSTR, F_CONSTRNC })
+    {
+        ArrayRef<const int> iatoms = idef->il[ftype].iatoms;
+        for (int i = 0; i < iatoms.ssize(); i += 1 + NRAL(ftype))
+        {
+            for (int j = 1; j <= NRAL(ftype); j++)
+            {
+                if (iatoms[i + j] >= firstAtom && iatoms[i + j] < endAtom)
+                {
+                    return;
+                }
+            }
+            haveOtherConstraints = true;
+        }
+    }
+
+    /* The fused leap-frog update of the water molecules takes
+     * the inverse masses from the SETTLE parameters.
+     */
+    const SettleParameters& settleParameters  = settled->parametersMassWeighted();
+    bool                    haveUniformMasses = true;
+    for (int a = firstAtom; a < endAtom; a++)
+    {
+        const real invMass = ((a - firstAtom) % NRAL(F_SETTLE) == 0 ? settleParameters.imO
+                                                                     : settleParameters.imH);
+        haveUniformMasses  = haveUniformMasses && inverseMasses_[a] == invMass;
+    }
+
+    FusedSettleLayout layout;
+    layout.firstAtom            = firstAtom;
+    layout.numSettles           = numSettles;
+    layout.packSize             = settled->packSize();
+    layout.haveOtherConstraints = haveOtherConstraints;
+    layout.usePbc               = (ir.pbcType != PbcType::No && pbcHandlingRequired_);
+    layout.haveUniformMasses    = haveUniformMasses;
+    fusedSettleLayout_          = layout;
+
+    if (debug)
+    {
+        fprintf(debug, "SETTLE can be fused with the update: %d SETTLEs starting at atom %d\n",
+                numSettles, firstAtom);
+    }
 }
 
 void Constraints::setConstraints(gmx_localtop_t* top,
@@ -1143,6 +1265,75 @@ Constraints::Impl::~Impl()
     done_lincs(lincsd);
 }
 
+std::optional<FusedSettleLayout> Constraints::fusedSettleLayout() const
+{
+    if (impl_->ed != nullptr || (impl_->ir.bPull && pull_have_constraint(impl_->pull_work)))
+    {
+        return std::nullopt;
+    }
+
+    return impl_->fusedSettleLayout_;
+}
+
+void Constraints::settleForFusedUpdate(const int                       settleStart,
+                                       const int                       settleEnd,
+                                       const t_pbc*                    pbc,
+                                       ArrayRefWithPadding<const RVec> x,
+                                       ArrayRefWithPadding<RVec>       xprime,
+                                       ArrayRefWithPadding<RVec>       v,
+                                       const bool                      computeVirial,
+                                       FusedSettleOutput*              output) const
+{
+    GMX_ASSERT(impl_->fusedSettleLayout_, "Can only fuse SETTLE with a suitable SETTLE layout");
+
+    /* Compute 1/dt in the same way as apply() does */
+    const real deltaT = impl_->ir.delta_t;
+    const real invdt  = (impl_->ir.delta_t == 0 ? 0.0 : 1.0 / deltaT);
+
+    csettleRange(*impl_->settled, settleStart, settleEnd, pbc, std::move(x), std::move(xprime),
+                 invdt, std::move(v), computeVirial, output->virial, &output->errorHasOccurred);
+}
+
+void Constraints::updateAndSettleForFusedUpdate(const int                       settleStart,
+                                                const int                       settleEnd,
+                                                const t_pbc*                    pbc,
+                                                const real                      lambda,
+                                                ArrayRefWithPadding<RVec>       x,
+                                                ArrayRefWithPadding<RVec>       v,
+                                                ArrayRefWithPadding<const RVec> f,
+                                                const bool                      computeVirial,
+                                                FusedSettleOutput*              output) const
+{
+    GMX_ASSERT(impl_->fusedSettleLayout_ && impl_->fusedSettleLayout_->haveUniformMasses,
+               "Can only fuse the water update with SETTLE with uniform water masses");
+
+    const real deltaT = impl_->ir.delta_t;
+    const real invdt  = (impl_->ir.delta_t == 0 ? 0.0 : 1.0 / deltaT);
+
+    csettleWithLeapfrogUpdate(*impl_->settled, impl_->fusedSettleLayout_->firstAtom, settleStart,
+                              settleEnd, pbc, deltaT, lambda, invdt, std::move(x), std::move(v),
+                              std::move(f), computeVirial, output->virial,
+                              &output->errorHasOccurred);
+}
+
+bool Constraints::applyAfterFusedSettle(bool                      bLog,
+                                        bool                      bEner,
+                                        int64_t                   step,
+                                        ArrayRefWithPadding<RVec> x,
+                                        ArrayRefWithPadding<RVec> xprime,
+                                        const matrix              box,
+                                        real                      lambda,
+                                        real*                     dvdlambda,
+                                        ArrayRefWithPadding<RVec> v,
+                                        bool                      computeVirial,
+                                        tensor                    constraintsVirial,
+                                        const FusedSettleOutput&  settleOutput)
+{
+    return impl_->apply(bLog, bEner, step, 1, 1.0, std::move(x), std::move(xprime),
+                        ArrayRef<RVec>(), box, lambda, dvdlambda, std::move(v), computeVirial,
+                        constraintsVirial, ConstraintVariable::Positions, &settleOutput);
+}
+
 void Constraints::saveEdsamPointer(gmx_edsam* ed)
 {
     impl_->ed = ed;
@@ -49,6 +49,8 @@
 
 #include <cstdio>
 
+#include <optional>
+
 #include "gromacs/math/vectypes.h"
 #include "gromacs/topology/idef.h"
 #include "gromacs/utility/arrayref.h"
@@ -93,6 +95,38 @@ enum class ConstraintVariable : int
                 * 1 and frozen particles mass 0                   */
 };
 
+/*! \libinternal
+ * \brief Describes the atom layout of the SETTLEs for an update fused with SETTLE
+ *
+ * The SETTLE atoms form one contiguous range starting at \p firstAtom
+ * with three atoms per settle, in the order O, H, H.
+ */
+struct FusedSettleLayout
+{
+    //! The first atom of the first SETTLE
+    int firstAtom = 0;
+    //! The number of SETTLEs
+    int numSettles = 0;
+    //! The number of SETTLEs that are processed together, ranges should align to this
+    int packSize = 1;
+    //! Whether there are other constraints, which act on atoms outside the SETTLE range
+    bool haveOtherConstraints = false;
+    //! Whether SETTLE needs to use PBC
+    bool usePbc = false;
+    //! Whether all SETTLE atoms have the inverse masses of the SETTLE parameters
+    bool haveUniformMasses = false;
+};
+
+/*! \libinternal
+ * \brief The output of SETTLE applied during a fused update */
+struct FusedSettleOutput
+{
+    //! The constraint virial contribution, without the time step dependent prefactor
+    tensor virial = { { 0 } };
+    //! Whether a SETTLE error has occurred
+    bool errorHasOccurred = false;
+};
+
 /*! \libinternal
  * \brief Handles constraints */
 class Constraints
@@ -190,6 +224,69 @@ public:
                bool                      computeVirial,
                tensor                    constraintsVirial,
                ConstraintVariable        econq);
+    /*! \brief Returns the SETTLE layout when SETTLE can be applied inside a fused update
+     *
+     * This is possible without domain decomposition, SHAKE, pull constraints,
+     * essential dynamics and freeze groups, and when the SETTLE atoms are
+     * contiguous and not involved in other constraints. Otherwise returns
+     * an empty optional.
+     */
+    std::optional<FusedSettleLayout> fusedSettleLayout() const;
+
+    /*! \brief Applies SETTLE to coordinates for SETTLEs \p settleStart to \p settleEnd
+     *
+     * Used for fusing SETTLE with the update. Range boundaries should
+     * follow FusedSettleLayout::packSize, except that \p settleEnd can
+     * be the total number of SETTLEs. The results are accumulated
+     * into \p output. Can be called concurrently on disjoint ranges.
+     * \p pbc should be set when FusedSettleLayout::usePbc is true.
+     */
+    void settleForFusedUpdate(int                             settleStart,
+                              int                             settleEnd,
+                              const t_pbc*                    pbc,
+                              ArrayRefWithPadding<const RVec> x,
+                              ArrayRefWithPadding<RVec>       xprime,
+                              ArrayRefWithPadding<RVec>       v,
+                              bool                            computeVirial,
+                              FusedSettleOutput*              output) const;
+
+    /*! \brief Applies the leap-frog update and SETTLE for SETTLEs \p settleStart to \p settleEnd
+     *
+     * Stores the constrained coordinates and velocities directly in \p x
+     * and \p v. Requires FusedSettleLayout::haveUniformMasses and a simple
+     * leap-frog update with a single T-coupling scaling factor \p lambda.
+     * Range requirements and output are as for settleForFusedUpdate().
+     */
+    void updateAndSettleForFusedUpdate(int                             settleStart,
+                                       int                             settleEnd,
+                                       const t_pbc*                    pbc,
+                                       real                            lambda,
+                                       ArrayRefWithPadding<RVec>       x,
+                                       ArrayRefWithPadding<RVec>       v,
+                                       ArrayRefWithPadding<const RVec> f,
+                                       bool                            computeVirial,
+                                       FusedSettleOutput*              output) const;
+
+    /*! \brief Completes constraining coordinates after settleForFusedUpdate() settled all SETTLEs
+     *
+     * Applies the other constraints and accounts for the SETTLE virial,
+     * flop count and errors as apply() with ConstraintVariable::Positions,
+     * delta_step=1 and step_scaling=1 would.
+     *
+     * Return whether the application of constraints succeeded without error.
+     */
+    bool applyAfterFusedSettle(bool                      bLog,
+                               bool                      bEner,
+                               int64_t                   step,
+                               ArrayRefWithPadding<RVec> x,
+                               ArrayRefWithPadding<RVec> xprime,
+                               const matrix              box,
+                               real                      lambda,
+                               real*                     dvdlambda,
+                               ArrayRefWithPadding<RVec> v,
+                               bool                      computeVirial,
+                               tensor                    constraintsVirial,
+                               const FusedSettleOutput&  settleOutput);
     //! Links the essentialdynamics and constraint code.
     void saveEdsamPointer(gmx_edsam* ed);
     //! Getter for use by domain decomposition.
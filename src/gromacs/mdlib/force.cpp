@@ -65,6 +65,7 @@
 #include "gromacs/mdtypes/interaction_const.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/multipletimestepping.h"
 #include "gromacs/mdtypes/simulation_workload.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
@@ -112,6 +113,7 @@ void do_force_lowlevel(t_forcerec*                          fr,
                        ArrayRef<const RVec>                 xWholeMolecules,
                        history_t*                           hist,
                        gmx::ForceOutputs*                   forceOutputs,
+                       gmx::ForceWithVirial*                forceWithVirialMtsLevel1,
                        gmx_enerdata_t*                      enerd,
                        const matrix                         box,
                        const real*                          lambda,
@@ -165,11 +167,21 @@ void do_force_lowlevel(t_forcerec*                          fr,
 
     const bool haveEwaldSurfaceTerm = haveEwaldSurfaceContribution(*ir);
 
+    /* With MTS the long-range forces are only computed on slow steps */
+    const bool longRangeIsSlow =
+            (gmx::forceGroupMtsFactor(*ir, gmx::MtsForceGroups::LongrangeNonbonded) > 1);
+
     /* Do long-range electrostatics and/or LJ-PME
      * and compute PME surface terms when necessary.
      */
-    if (computePmeOnCpu || fr->ic->eeltype == eelEWALD || haveEwaldSurfaceTerm)
+    if ((computePmeOnCpu || fr->ic->eeltype == eelEWALD || haveEwaldSurfaceTerm)
+        && (!longRangeIsSlow || stepWork.computeSlowForces))
     {
+        GMX_ASSERT(!longRangeIsSlow || forceWithVirialMtsLevel1 != nullptr,
+                   "With MTS we need a separate buffer for the slow forces");
+        gmx::ForceWithVirial& forceWithVirialLongRange =
+                (longRangeIsSlow ? *forceWithVirialMtsLevel1 : forceOutputs->forceWithVirial());
+
         int  status = 0;
         real Vlr_q = 0, Vlr_lj = 0;
 
@@ -201,11 +213,11 @@ void do_force_lowlevel(t_forcerec*                          fr,
                         /* Threading is only supported with the Verlet cut-off
                          * scheme and then only single particle forces (no
                          * exclusion forces) are calculated, so we can store
-                         * the forces in the normal, single forceWithVirial->force_ array.
+                         * the forces in the single forceWithVirialLongRange.force_ array.
                          */
                         ewald_LRcorrection(md->homenr, cr, nthreads, t, *fr, *ir, md->chargeA,
                                            md->chargeB, (md->nChargePerturbed != 0), x, box, mu_tot,
-                                           as_rvec_array(forceWithVirial.force_.data()),
+                                           as_rvec_array(forceWithVirialLongRange.force_.data()),
                                            &ewc_t.Vcorr_q, lambda[efptCOUL], &ewc_t.dvdl[efptCOUL]);
                     }
                     GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
@@ -242,7 +254,7 @@ void do_force_lowlevel(t_forcerec*                          fr,
                             fr->pmedata,
                             gmx::constArrayRefFromArray(coordinates.unpaddedConstArrayRef().data(),
                                                         md->homenr - fr->n_tpi),
-                            forceWithVirial.force_, md->chargeA, md->chargeB, md->sqrt_c6A,
+                            forceWithVirialLongRange.force_, md->chargeA, md->chargeB, md->sqrt_c6A,
                             md->sqrt_c6B, md->sigmaA, md->sigmaB, box, cr,
                             DOMAINDECOMP(cr) ? dd_pme_maxshift_x(cr->dd) : 0,
                             DOMAINDECOMP(cr) ? dd_pme_maxshift_y(cr->dd) : 0, nrnb, wcycle,
@@ -279,16 +291,17 @@ void do_force_lowlevel(t_forcerec*                          fr,
 
         if (fr->ic->eeltype == eelEWALD)
         {
-            Vlr_q = do_ewald(ir, x, as_rvec_array(forceWithVirial.force_.data()), md->chargeA,
-                             md->chargeB, box, cr, md->homenr, ewaldOutput.vir_q, fr->ic->ewaldcoeff_q,
-                             lambda[efptCOUL], &ewaldOutput.dvdl[efptCOUL], fr->ewald_table);
+            Vlr_q = do_ewald(ir, x, as_rvec_array(forceWithVirialLongRange.force_.data()),
+                             md->chargeA, md->chargeB, box, cr, md->homenr, ewaldOutput.vir_q,
+                             fr->ic->ewaldcoeff_q, lambda[efptCOUL], &ewaldOutput.dvdl[efptCOUL],
+                             fr->ewald_table);
         }
 
         /* Note that with separate PME nodes we get the real energies later */
         // TODO it would be simpler if we just accumulated a single
         // long-range virial contribution.
-        forceWithVirial.addVirialContribution(ewaldOutput.vir_q);
-        forceWithVirial.addVirialContribution(ewaldOutput.vir_lj);
+        forceWithVirialLongRange.addVirialContribution(ewaldOutput.vir_q);
+        forceWithVirialLongRange.addVirialContribution(ewaldOutput.vir_lj);
         enerd->dvdl_lin[efptCOUL] += ewaldOutput.dvdl[efptCOUL];
         enerd->dvdl_lin[efptVDW] += ewaldOutput.dvdl[efptVDW];
         enerd->term[F_COUL_RECIP] = Vlr_q + ewaldOutput.Vcorr_q;
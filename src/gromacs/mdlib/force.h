@@ -115,6 +115,11 @@ void do_force(FILE*                               log,
  *
  * xWholeMolecules only needs to contain whole molecules when orientation
  * restraints need to be computed and can be empty otherwise.
+ *
+ * With multiple time stepping and long-range nonbonded interactions in
+ * the slow level, the long-range forces are only computed when
+ * stepWork.computeSlowForces is set and are then stored in
+ * forceWithVirialMtsLevel1, which should be nullptr otherwise.
  */
 void do_force_lowlevel(t_forcerec*                               fr,
                        const t_inputrec*                         ir,
@@ -127,6 +132,7 @@ void do_force_lowlevel(t_forcerec*                               fr,
                        gmx::ArrayRef<const gmx::RVec>            xWholeMolecules,
                        history_t*                                hist,
                        gmx::ForceOutputs*                        forceOutputs,
+                       gmx::ForceWithVirial*                     forceWithVirialMtsLevel1,
                        gmx_enerdata_t*                           enerd,
                        const matrix                              box,
                        const real*                               lambda,
@@ -53,6 +53,8 @@
 #include <cstdlib>
 
 #include <algorithm>
+#include <numeric>
+#include <utility>
 #include <vector>
 
 #include "gromacs/domdec/domdec.h"
@@ -117,7 +119,11 @@ struct Task
     std::vector<int> tri_bits;
     //! Constraint index for updating atom data.
     std::vector<int> ind;
-    //! Constraint index for updating atom data.
+    /*! \brief Constraint index for updating atoms of multiple tasks
+     *
+     * These constraints are updated by this task after a barrier,
+     * constraints that share atoms are always assigned to the same task.
+     */
     std::vector<int> ind_r;
     //! Temporary variable for virial calculation.
     tensor vir_r_m_dr = { { 0 } };
@@ -465,14 +471,13 @@ static void lincs_update_atoms(Lincs*                         li,
 
         if (!li->task[li->ntask].ind.empty())
         {
-            /* Update the constraints that operate on atoms
-             * in multiple thread atom blocks on the master thread.
+            /* Update the constraints that operate on atoms in multiple
+             * thread atom blocks. Sets of these constraints that share
+             * atoms are assigned to a single task, so all tasks can
+             * update in parallel.
              */
 #pragma omp barrier
-#pragma omp master
-            {
-                lincs_update_atoms_ind(li->task[li->ntask].ind, li->atoms, preFactor, fac, r, invmass, x);
-            }
+            lincs_update_atoms_ind(li->task[th].ind_r, li->atoms, preFactor, fac, r, invmass, x);
         }
     }
 }
@@ -1551,6 +1556,80 @@ void done_lincs(Lincs* li)
     delete li;
 }
 
+/*! \brief Distributes the constraints in task[ntask].ind over the ind_r lists of the tasks
+ *
+ * This colors the conflict graph of these constraints, where constraints
+ * conflict when they share an atom: all constraints in a connected set
+ * get the same color, i.e. task. The sets are distributed uniformly
+ * over the tasks in order of constraint index, which preserves locality.
+ */
+static void distributeCrossTaskConstraints(Lincs* li)
+{
+    gmx::ArrayRef<const int> crossTaskInd = li->task[li->ntask].ind;
+    const int                numCrossTask = crossTaskInd.ssize();
+
+    /* Union-find over the cross-task constraints, the root of a set is
+     * always the lowest index in the set, so roots come first in crossTaskInd.
+     */
+    std::vector<int> parent(numCrossTask);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto findRoot = [&parent](int i) {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i         = parent[i];
+        }
+        return i;
+    };
+
+    std::vector<std::pair<int, int>> atomAndIndex;
+    atomAndIndex.reserve(2 * numCrossTask);
+    for (int i = 0; i < numCrossTask; i++)
+    {
+        atomAndIndex.emplace_back(li->atoms[crossTaskInd[i]].index1, i);
+        atomAndIndex.emplace_back(li->atoms[crossTaskInd[i]].index2, i);
+    }
+    std::sort(atomAndIndex.begin(), atomAndIndex.end());
+    for (size_t k = 1; k < atomAndIndex.size(); k++)
+    {
+        if (atomAndIndex[k].first == atomAndIndex[k - 1].first)
+        {
+            const int root1 = findRoot(atomAndIndex[k - 1].second);
+            const int root2 = findRoot(atomAndIndex[k].second);
+            parent[std::max(root1, root2)] = std::min(root1, root2);
+        }
+    }
+
+    int numSets = 0;
+    for (int i = 0; i < numCrossTask; i++)
+    {
+        if (findRoot(i) == i)
+        {
+            numSets++;
+        }
+    }
+
+    /* Assign the sets to tasks, the task of a set is stored at its root */
+    std::vector<int> setTask(numCrossTask);
+    int              set = 0;
+    for (int i = 0; i < numCrossTask; i++)
+    {
+        const int root = findRoot(i);
+        if (root == i)
+        {
+            setTask[i] = (set * li->ntask) / numSets;
+            set++;
+        }
+        li->task[setTask[root]].ind_r.push_back(crossTaskInd[i]);
+    }
+
+    if (debug)
+    {
+        fprintf(debug, "LINCS: %d constraints in %d sets operate on atoms of multiple tasks\n",
+                numCrossTask, numSets);
+    }
+}
+
 /*! \brief Sets up the work division over the threads. */
 static void lincs_thread_setup(Lincs* li, int natoms)
 {
@@ -1618,19 +1697,21 @@ static void lincs_thread_setup(Lincs* li, int natoms)
     }
 
     /* We need to copy all constraints which have not be assigned
-     * to a thread to a separate list which will be handled by one thread.
+     * to a thread to a separate list, which is distributed over
+     * the threads below.
      */
     Task* li_m = &li->task[li->ntask];
 
     li_m->ind.clear();
     for (int th = 0; th < li->ntask; th++)
     {
-        const Task& li_task = li->task[th];
+        Task& li_task = li->task[th];
 
         for (int ind_r : li_task.ind_r)
         {
             li_m->ind.push_back(ind_r);
         }
+        li_task.ind_r.clear();
 
         if (debug)
         {
@@ -1638,6 +1719,8 @@ static void lincs_thread_setup(Lincs* li, int natoms)
         }
     }
 
+    distributeCrossTaskConstraints(li);
+
     if (debug)
     {
         fprintf(debug, "LINCS thread r: %zu constraints\n", li_m->ind.size());
@@ -1718,8 +1801,14 @@ static void check_assign_connected(Lincs*                        li,
 }
 
 /*! \brief Check if constraint with topology index constraint_index is involved
- * in a constraint triangle, and if so add the other two constraints
- * in the triangle to our task. */
+ * in constraint triangles, and if so add the other constraints in all
+ * these triangles to our task.
+ *
+ * Note that we do not apply this recursively to the added constraints,
+ * since with e.g. angle constraints a whole molecule might be a network
+ * of triangles. Triangles that still cross task borders are handled
+ * in lincs_matrix_expand with an extra barrier.
+ */
 static void check_assign_triangle(Lincs*                        li,
                                   gmx::ArrayRef<const int>      iatom,
                                   const InteractionDefinitions& idef,
@@ -1729,86 +1818,41 @@ static void check_assign_triangle(Lincs*                        li,
                                   int                           a2,
                                   const ListOfLists<int>&       at2con)
 {
-    int nca, cc[32], ca[32];
-    int c_triangle[2] = { -1, -1 };
-
-    nca = 0;
-    for (const int c : at2con[a1])
+    for (const int c1 : at2con[a1])
     {
-        if (c != constraint_index)
+        if (c1 == constraint_index)
         {
-            int aa1, aa2;
-
-            aa1 = iatom[c * 3 + 1];
-            aa2 = iatom[c * 3 + 2];
-            if (aa1 != a1)
-            {
-                cc[nca] = c;
-                ca[nca] = aa1;
-                nca++;
-            }
-            if (aa2 != a1)
-            {
-                cc[nca] = c;
-                ca[nca] = aa2;
-                nca++;
-            }
+            continue;
         }
-    }
+        const int end1 = (iatom[c1 * 3 + 1] == a1 ? iatom[c1 * 3 + 2] : iatom[c1 * 3 + 1]);
 
-    for (const int c : at2con[a2])
-    {
-        if (c != constraint_index)
+        for (const int c2 : at2con[a2])
         {
-            int aa1, aa2, i;
-
-            aa1 = iatom[c * 3 + 1];
-            aa2 = iatom[c * 3 + 2];
-            if (aa1 != a2)
+            if (c2 == constraint_index)
             {
-                for (i = 0; i < nca; i++)
-                {
-                    if (aa1 == ca[i])
-                    {
-                        c_triangle[0] = cc[i];
-                        c_triangle[1] = c;
-                    }
-                }
+                continue;
             }
-            if (aa2 != a2)
+            const int end2 = (iatom[c2 * 3 + 1] == a2 ? iatom[c2 * 3 + 2] : iatom[c2 * 3 + 1]);
+
+            if (end1 != end2)
             {
-                for (i = 0; i < nca; i++)
-                {
-                    if (aa2 == ca[i])
-                    {
-                        c_triangle[0] = cc[i];
-                        c_triangle[1] = c;
-                    }
-                }
+                continue;
             }
-        }
-    }
-
-    if (c_triangle[0] >= 0)
-    {
-        int end;
 
-        for (end = 0; end < 2; end++)
-        {
-            /* Check if constraint c_triangle[end] has not yet been assigned */
-            if (li->con_index[c_triangle[end]] == -1)
+            /* Constraints c1 and c2 form a triangle with our constraint */
+            for (const int c : { c1, c2 })
             {
-                int  i, type;
-                real lenA, lenB;
-
-                i    = c_triangle[end] * 3;
-                type = iatom[i];
-                lenA = idef.iparams[type].constr.dA;
-                lenB = idef.iparams[type].constr.dB;
-
-                if (bDynamics || lenA != 0 || lenB != 0)
+                /* Check if constraint c has not yet been assigned */
+                if (li->con_index[c] == -1)
                 {
-                    assign_constraint(li, c_triangle[end], iatom[i + 1], iatom[i + 2], lenA, lenB, at2con);
+                    const int  type = iatom[c * 3];
+                    const real lenA = idef.iparams[type].constr.dA;
+                    const real lenB = idef.iparams[type].constr.dB;
+
+                    if (bDynamics || lenA != 0 || lenB != 0)
+                    {
+                        assign_constraint(li, c, iatom[c * 3 + 1], iatom[c * 3 + 2], lenA, lenB, at2con);
+                    }
                 }
             }
         }
@@ -37,17 +37,25 @@
 
 #include "mdoutf.h"
 
+#include <cstdlib>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/collect.h"
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/tngio.h"
+#include "gromacs/fileio/trajectoryframeindex.h"
 #include "gromacs/fileio/trrio.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/trajectory_writing.h"
+#include "gromacs/mdlib/trajectorywriterthread.h"
 #include "gromacs/mdrunutility/handlerestart.h"
 #include "gromacs/mdrunutility/multisim.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -86,8 +94,135 @@ struct gmx_mdoutf
     const gmx::MdModulesNotifier* mdModulesNotifier;
     bool                          simulationsShareState;
     MPI_Comm                      mastersComm;
+    gmx::TrajectoryWriterThread*  writerThread; /* nullptr with synchronous output */
+    bool                          distributedXtcCompression;
+    std::vector<int>              xtcIndex; /* global to XTC atom index, empty when equal */
+    std::vector<char>             xtcChunks; /* compressed XTC positions, master only */
+    /* Frame indices of the trajectory files, nullptr when not recording */
+    std::unique_ptr<gmx::TrajectoryFrameIndexRecorder> xtcFrameIndex;
+    std::unique_ptr<gmx::TrajectoryFrameIndexRecorder> trrFrameIndex;
 };
 
+/*! \brief Records a frame that has just been written to \p fio in \p frameIndex, when present
+ *
+ * The time should be passed with the precision it is stored with in the file.
+ */
+static void recordFrameInIndex(gmx::TrajectoryFrameIndexRecorder* frameIndex,
+                               t_fileio*                          fio,
+                               int64_t                            step,
+                               double                             time,
+                               bool                               haveX,
+                               bool                               haveV,
+                               bool                               haveF,
+                               bool                               isDouble)
+{
+    if (frameIndex)
+    {
+        frameIndex->addFrame({ 0, step, time, haveX, haveV, haveF, isDouble }, gmx_fio_ftell(fio));
+    }
+}
+
+/*! \brief Writes the trajectory \p frame to the output files
+ *
+ * Can be called on a writer thread, so this should only access
+ * the output files and data in \p of that does not change.
+ */
+static void writeFrameToFiles(gmx_mdoutf* of, const gmx::TrajectoryOutputFrame& frame)
+{
+    const int   mdof_flags = frame.flags;
+    const int   natoms     = frame.numAtoms;
+    const auto  step       = frame.step;
+    const real  t          = frame.time;
+    const rvec* box        = frame.box;
+
+    if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+    {
+        const rvec* x = (mdof_flags & MDOF_X) ? as_rvec_array(frame.x.data()) : nullptr;
+        const rvec* v = (mdof_flags & MDOF_V) ? as_rvec_array(frame.v.data()) : nullptr;
+        const rvec* f = (mdof_flags & MDOF_F) ? as_rvec_array(frame.f.data()) : nullptr;
+
+        if (of->fp_trn)
+        {
+            gmx_trr_write_frame(of->fp_trn, step, t, frame.lambda, box, natoms, x, v, f);
+            if (gmx_fio_flush(of->fp_trn) != 0)
+            {
+                gmx_file("Cannot write trajectory; maybe you are out of disk space?");
+            }
+            recordFrameInIndex(of->trrFrameIndex.get(), of->fp_trn, step, t, x != nullptr,
+                               v != nullptr, f != nullptr, GMX_DOUBLE);
+        }
+
+        /* If a TNG file is open for uncompressed coordinate output also write
+           velocities and forces to it. */
+        else if (of->tng)
+        {
+            gmx_fwrite_tng(of->tng, FALSE, step, t, frame.lambda, box, natoms, x, v, f);
+        }
+        /* If only a TNG file is open for compressed coordinate output (no uncompressed
+           coordinate output) also write forces and velocities to it. */
+        else if (of->tng_low_prec)
+        {
+            gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, frame.lambda, box, natoms, x, v, f);
+        }
+    }
+    if (mdof_flags & MDOF_X_COMPRESSED)
+    {
+        const rvec* xxtc       = as_rvec_array(frame.x.data());
+        rvec*       xxtcSubset = nullptr;
+
+        if (of->natoms_x_compressed != of->natoms_global)
+        {
+            /* We are writing the positions of only a subset of
+               the atoms to the compressed output, so we have to
+               make a copy of the subset of coordinates. */
+            int i, j;
+
+            snew(xxtcSubset, of->natoms_x_compressed);
+            for (i = 0, j = 0; (i < of->natoms_global); i++)
+            {
+                if (getGroupType(*of->groups, SimulationAtomGroupType::CompressedPositionOutput, i) == 0)
+                {
+                    copy_rvec(frame.x[i], xxtcSubset[j++]);
+                }
+            }
+            xxtc = xxtcSubset;
+        }
+        if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t, box, xxtc,
+                      of->x_compression_precision)
+            == 0)
+        {
+            gmx_fatal(FARGS,
+                      "XTC error. This indicates you are out of disk space, or a "
+                      "simulation with major instabilities resulting in coordinates "
+                      "that are NaN or too large to be represented in the XTC format.\n");
+        }
+        recordFrameInIndex(of->xtcFrameIndex.get(), of->fp_xtc, step, static_cast<float>(t), true,
+                           false, false, false);
+        gmx_fwrite_tng(of->tng_low_prec, TRUE, step, t, frame.lambda, box,
+                       of->natoms_x_compressed, xxtc, nullptr, nullptr);
+        sfree(xxtcSubset);
+    }
+    if (mdof_flags & (MDOF_BOX | MDOF_LAMBDA) && !(mdof_flags & (MDOF_X | MDOF_V | MDOF_F)))
+    {
+        if (of->tng)
+        {
+            real lambda = (mdof_flags & MDOF_LAMBDA) ? frame.lambda : -1;
+            gmx_fwrite_tng(of->tng, FALSE, step, t, lambda, (mdof_flags & MDOF_BOX) ? box : nullptr,
+                           natoms, nullptr, nullptr, nullptr);
+        }
+    }
+    if (mdof_flags & (MDOF_BOX_COMPRESSED | MDOF_LAMBDA_COMPRESSED)
+        && !(mdof_flags & (MDOF_X_COMPRESSED)))
+    {
+        if (of->tng_low_prec)
+        {
+            real lambda = (mdof_flags & MDOF_LAMBDA_COMPRESSED) ? frame.lambda : -1;
+            gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, lambda,
+                           (mdof_flags & MDOF_BOX_COMPRESSED) ? box : nullptr, natoms, nullptr,
+                           nullptr, nullptr);
+        }
+    }
+}
 
 gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
                          int                           nfile,
@@ -110,7 +245,7 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
     int          i;
     bool restartWithAppending = (startingBehavior == gmx::StartingBehavior::RestartWithAppending);
 
-    snew(of, 1);
+    of = new gmx_mdoutf();
 
     of->fp_trn       = nullptr;
     of->fp_ene       = nullptr;
@@ -118,6 +253,7 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
     of->tng          = nullptr;
     of->tng_low_prec = nullptr;
     of->fp_dhdl      = nullptr;
+    of->writerThread = nullptr;
 
     of->eIntegrator             = ir->eI;
     of->bExpanded               = ir->bExpanded;
@@ -189,6 +325,19 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
                 default: gmx_incons("Invalid full precision file format");
             }
         }
+        /* Record the frame index while writing, so tools can access
+         * frames directly without first having to index the files.
+         */
+        if (of->fp_xtc && gmx::frameIndexIsSupported(gmx_fio_getname(of->fp_xtc)))
+        {
+            of->xtcFrameIndex = std::make_unique<gmx::TrajectoryFrameIndexRecorder>(
+                    gmx_fio_getname(of->fp_xtc), restartWithAppending);
+        }
+        if (of->fp_trn && gmx::frameIndexIsSupported(gmx_fio_getname(of->fp_trn)))
+        {
+            of->trrFrameIndex = std::make_unique<gmx::TrajectoryFrameIndexRecorder>(
+                    gmx_fio_getname(of->fp_trn), restartWithAppending);
+        }
         if (EI_DYNAMICS(ir->eI) || EI_ENERGY_MINIMIZATION(ir->eI))
         {
             of->fp_ene = open_enx(ftp2fn(efEDR, nfile, fnm), filemode);
@@ -230,6 +379,49 @@ gmx_mdoutf_t init_mdoutf(FILE*                         fplog,
         {
             snew(of->f_global, top_global->natoms);
         }
+
+        /* Compression and writing of trajectory frames is done on a separate
+         * thread, so the simulation only needs to wait for the file output
+         * when the writer thread falls behind by more than one frame.
+         */
+        if ((of->fp_trn || of->fp_xtc || of->tng || of->tng_low_prec)
+            && std::getenv("GMX_NO_ASYNC_TRAJECTORY_OUTPUT") == nullptr)
+        {
+            of->writerThread = new gmx::TrajectoryWriterThread(
+                    [of](const gmx::TrajectoryOutputFrame& frame) { writeFrameToFiles(of, frame); },
+                    wcycle);
+        }
+    }
+
+    /* With domain decomposition, each PP rank can compress a part of
+     * the XTC output, so only compressed data needs to be gathered.
+     * This writes a chunked frame format that only GROMACS can read.
+     */
+    of->distributedXtcCompression = false;
+    if (DOMAINDECOMP(cr) && cr->dd->nnodes > 1 && EI_DYNAMICS(ir->eI) && ir->nstxout_compressed > 0
+        && fn2ftp(ftp2fn(efCOMPRESSED, nfile, fnm)) == efXTC
+        && std::getenv("GMX_XTC_DISTRIBUTED_COMPRESSION") != nullptr)
+    {
+        of->distributedXtcCompression = true;
+
+        const SimulationGroups& groups = top_global->groups;
+        std::vector<int>        xtcIndex(top_global->natoms, -1);
+        of->natoms_x_compressed = 0;
+        for (i = 0; i < top_global->natoms; i++)
+        {
+            if (getGroupType(groups, SimulationAtomGroupType::CompressedPositionOutput, i) == 0)
+            {
+                xtcIndex[i] = of->natoms_x_compressed++;
+            }
+        }
+        if (of->natoms_x_compressed < top_global->natoms)
+        {
+            of->xtcIndex = std::move(xtcIndex);
+        }
+        if (fplog)
+        {
+            fprintf(fplog, "\nCompressing XTC output in parallel over %d ranks\n", cr->dd->nnodes);
+        }
     }
 
     if (bCiteTng)
@@ -268,6 +460,7 @@ void mdoutf_write_to_trajectory_files(FILE*                    fplog,
                                       gmx::ArrayRef<gmx::RVec> f_local)
 {
     rvec* f_global;
+    bool  xtcCompressionSucceeded = true;
 
     if (DOMAINDECOMP(cr))
     {
@@ -277,7 +470,10 @@ void mdoutf_write_to_trajectory_files(FILE*                    fplog,
         }
         else
         {
-            if (mdof_flags & (MDOF_X | MDOF_X_COMPRESSED))
+            /* With distributed XTC compression, only compressed data is collected */
+            const int collectXFlags =
+                    of->distributedXtcCompression ? MDOF_X : (MDOF_X | MDOF_X_COMPRESSED);
+            if (mdof_flags & collectXFlags)
             {
                 auto globalXRef = MASTER(cr) ? state_global->x : gmx::ArrayRef<gmx::RVec>();
                 dd_collect_vec(cr->dd, state_local, state_local->x, globalXRef);
@@ -294,6 +490,12 @@ void mdoutf_write_to_trajectory_files(FILE*                    fplog,
             dd_collect_vec(cr->dd, state_local, f_local,
                            gmx::arrayRefFromArray(reinterpret_cast<gmx::RVec*>(f_global), f_local.size()));
         }
+        if (of->distributedXtcCompression && (mdof_flags & MDOF_X_COMPRESSED))
+        {
+            xtcCompressionSucceeded = dd_collect_compressed_positions(
+                    cr->dd, state_local->x, of->xtcIndex, of->natoms_x_compressed,
+                    of->x_compression_precision, &of->xtcChunks);
+        }
     }
     else
     {
@@ -307,6 +509,13 @@ void mdoutf_write_to_trajectory_files(FILE*                    fplog,
     {
         if (mdof_flags & MDOF_CPT)
         {
+            /* The checkpoint stores the positions in the output files,
+             * so all earlier frames need to be written first.
+             */
+            if (of->writerThread)
+            {
+                of->writerThread->waitUntilAllFramesWritten();
+            }
             fflush_tng(of->tng);
             fflush_tng(of->tng_low_prec);
             /* Write the checkpoint file.
@@ -323,114 +532,74 @@ void mdoutf_write_to_trajectory_files(FILE*                    fplog,
                              of->simulationsShareState, of->mastersComm);
         }
 
-        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+        int frameFlags = mdof_flags
+                         & (MDOF_X | MDOF_V | MDOF_F | MDOF_X_COMPRESSED | MDOF_BOX | MDOF_LAMBDA
+                            | MDOF_BOX_COMPRESSED | MDOF_LAMBDA_COMPRESSED);
+        if (of->distributedXtcCompression && (frameFlags & MDOF_X_COMPRESSED))
         {
-            const rvec* x = (mdof_flags & MDOF_X) ? state_global->x.rvec_array() : nullptr;
-            const rvec* v = (mdof_flags & MDOF_V) ? state_global->v.rvec_array() : nullptr;
-            const rvec* f = (mdof_flags & MDOF_F) ? f_global : nullptr;
-
-            if (of->fp_trn)
-            {
-                gmx_trr_write_frame(of->fp_trn, step, t, state_local->lambda[efptFEP],
-                                    state_local->box, natoms, x, v, f);
-                if (gmx_fio_flush(of->fp_trn) != 0)
-                {
-                    gmx_file("Cannot write trajectory; maybe you are out of disk space?");
-                }
-            }
-
-            /* If a TNG file is open for uncompressed coordinate output also write
-               velocities and forces to it. */
-            else if (of->tng)
-            {
-                gmx_fwrite_tng(of->tng, FALSE, step, t, state_local->lambda[efptFEP],
-                               state_local->box, natoms, x, v, f);
-            }
-            /* If only a TNG file is open for compressed coordinate output (no uncompressed
-               coordinate output) also write forces and velocities to it. */
-            else if (of->tng_low_prec)
+            /* Writing the compressed data is cheap, so we do that here
+             * instead of on the writer thread, which never writes XTC
+             * frames in this case.
+             */
+            if (!xtcCompressionSucceeded
+                || write_xtc_chunked(of->fp_xtc, of->natoms_x_compressed, step, t, state_local->box,
+                                     cr->dd->nnodes, of->xtcChunks.data(),
+                                     static_cast<int>(of->xtcChunks.size()))
+                           == 0)
             {
-                gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, state_local->lambda[efptFEP],
-                               state_local->box, natoms, x, v, f);
+                gmx_fatal(FARGS,
+                          "XTC error. This indicates you are out of disk space, or a "
+                          "simulation with major instabilities resulting in coordinates "
+                          "that are NaN or too large to be represented in the XTC format.\n");
             }
+            recordFrameInIndex(of->xtcFrameIndex.get(), of->fp_xtc, step, static_cast<float>(t),
+                               true, false, false, false);
+            frameFlags &= ~MDOF_X_COMPRESSED;
         }
-        if (mdof_flags & MDOF_X_COMPRESSED)
+        if (frameFlags != 0)
         {
-            rvec* xxtc = nullptr;
-
-            if (of->natoms_x_compressed == of->natoms_global)
+            gmx::ArrayRef<const gmx::RVec> x;
+            gmx::ArrayRef<const gmx::RVec> v;
+            gmx::ArrayRef<const gmx::RVec> f;
+            if (frameFlags & (MDOF_X | MDOF_X_COMPRESSED))
             {
-                /* We are writing the positions of all of the atoms to
-                   the compressed output */
-                xxtc = state_global->x.rvec_array();
+                x = gmx::constArrayRefFromArray(state_global->x.data(), natoms);
             }
-            else
+            if (frameFlags & MDOF_V)
             {
-                /* We are writing the positions of only a subset of
-                   the atoms to the compressed output, so we have to
-                   make a copy of the subset of coordinates. */
-                int i, j;
-
-                snew(xxtc, of->natoms_x_compressed);
-                auto x = makeArrayRef(state_global->x);
-                for (i = 0, j = 0; (i < of->natoms_global); i++)
-                {
-                    if (getGroupType(*of->groups, SimulationAtomGroupType::CompressedPositionOutput, i) == 0)
-                    {
-                        copy_rvec(x[i], xxtc[j++]);
-                    }
-                }
-            }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t, state_local->box, xxtc,
-                          of->x_compression_precision)
-                == 0)
-            {
-                gmx_fatal(FARGS,
-                          "XTC error. This indicates you are out of disk space, or a "
-                          "simulation with major instabilities resulting in coordinates "
-                          "that are NaN or too large to be represented in the XTC format.\n");
+                v = gmx::constArrayRefFromArray(state_global->v.data(), natoms);
             }
-            gmx_fwrite_tng(of->tng_low_prec, TRUE, step, t, state_local->lambda[efptFEP],
-                           state_local->box, of->natoms_x_compressed, xxtc, nullptr, nullptr);
-            if (of->natoms_x_compressed != of->natoms_global)
+            if (frameFlags & MDOF_F)
             {
-                sfree(xxtc);
+                f = gmx::constArrayRefFromArray(reinterpret_cast<const gmx::RVec*>(f_global),
+                                                natoms);
             }
-        }
-        if (mdof_flags & (MDOF_BOX | MDOF_LAMBDA) && !(mdof_flags & (MDOF_X | MDOF_V | MDOF_F)))
-        {
-            if (of->tng)
+
+            /* With a writer thread we copy the frame, so the thread can
+             * write it while the simulation continues. Otherwise we write
+             * directly from the state.
+             */
+            gmx::TrajectoryOutputFrame  localFrame;
+            gmx::TrajectoryOutputFrame* frame =
+                    of->writerThread ? of->writerThread->getFreeFrame() : &localFrame;
+
+            frame->flags    = frameFlags;
+            frame->step     = step;
+            frame->time     = t;
+            frame->lambda   = state_local->lambda[efptFEP];
+            frame->numAtoms = natoms;
+            copy_mat(state_local->box, frame->box);
+            if (of->writerThread)
             {
-                real  lambda = -1;
-                rvec* box    = nullptr;
-                if (mdof_flags & MDOF_BOX)
-                {
-                    box = state_local->box;
-                }
-                if (mdof_flags & MDOF_LAMBDA)
-                {
-                    lambda = state_local->lambda[efptFEP];
-                }
-                gmx_fwrite_tng(of->tng, FALSE, step, t, lambda, box, natoms, nullptr, nullptr, nullptr);
+                frame->copyToBuffers(x, v, f);
+                of->writerThread->submitFrame(frame);
             }
-        }
-        if (mdof_flags & (MDOF_BOX_COMPRESSED | MDOF_LAMBDA_COMPRESSED)
-            && !(mdof_flags & (MDOF_X_COMPRESSED)))
-        {
-            if (of->tng_low_prec)
+            else
             {
-                real  lambda = -1;
-                rvec* box    = nullptr;
-                if (mdof_flags & MDOF_BOX_COMPRESSED)
-                {
-                    box = state_local->box;
-                }
-                if (mdof_flags & MDOF_LAMBDA_COMPRESSED)
-                {
-                    lambda = state_local->lambda[efptFEP];
-                }
-                gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, lambda, box, natoms, nullptr,
-                               nullptr, nullptr);
+                frame->x = x;
+                frame->v = v;
+                frame->f = f;
+                writeFrameToFiles(of, *frame);
             }
         }
     }
@@ -441,6 +610,10 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
     if (of->tng || of->tng_low_prec)
     {
         wallcycle_start(of->wcycle, ewcTRAJ);
+        if (of->writerThread)
+        {
+            of->writerThread->waitUntilAllFramesWritten();
+        }
         gmx_tng_close(&of->tng);
         gmx_tng_close(&of->tng_low_prec);
         wallcycle_stop(of->wcycle, ewcTRAJ);
@@ -449,6 +622,9 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
 
 void done_mdoutf(gmx_mdoutf_t of)
 {
+    /* Write the remaining frames and stop the writer thread */
+    delete of->writerThread;
+
     if (of->fp_ene != nullptr)
     {
         done_ener_file(of->fp_ene);
@@ -461,6 +637,14 @@ void done_mdoutf(gmx_mdoutf_t of)
     {
         gmx_trr_close(of->fp_trn);
     }
+    if (of->xtcFrameIndex)
+    {
+        of->xtcFrameIndex->writeIndexFile();
+    }
+    if (of->trrFrameIndex)
+    {
+        of->trrFrameIndex->writeIndexFile();
+    }
     if (of->fp_dhdl != nullptr)
     {
         gmx_fio_fclose(of->fp_dhdl);
@@ -474,7 +658,7 @@ void done_mdoutf(gmx_mdoutf_t of)
     gmx_tng_close(&of->tng);
     gmx_tng_close(&of->tng_low_prec);
 
-    sfree(of);
+    delete of;
 }
 
 int mdoutf_get_tng_box_output_interval(gmx_mdoutf_t of)
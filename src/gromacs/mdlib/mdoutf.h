@@ -95,11 +95,12 @@ gmx_wallcycle_t mdoutf_get_wcycle(gmx_mdoutf_t of);
 /*! \brief Close TNG files if they are open.
  *
  * This also measures the time it takes to close the TNG
- * files.
+ * files, including waiting for the writer thread to finish
+ * writing frames.
  */
 void mdoutf_tng_close(gmx_mdoutf_t of);
 
-/*! \brief Close all open output files and free the of pointer */
+/*! \brief Write all remaining frames, close all open output files and free the of pointer */
 void done_mdoutf(gmx_mdoutf_t of);
 
 /*! \brief Routine that writes trajectory-like frames.
@@ -109,6 +110,11 @@ void done_mdoutf(gmx_mdoutf_t of);
  * the master node only when necessary. Without domain decomposition
  * only data from state_local is used and state_global is ignored.
  *
+ * Unless GMX_NO_ASYNC_TRAJECTORY_OUTPUT is set, the master node copies
+ * trajectory frames and hands them to a writer thread, which compresses
+ * and writes them while the simulation continues. Checkpoints are written
+ * directly, after all earlier frames have been written.
+ *
  * \param[in] fplog              File handler to log file.
  * \param[in] cr                 Communication record.
  * \param[in] of                 File handler to trajectory file.
@@ -48,6 +48,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 
 #include <algorithm>
@@ -366,6 +367,244 @@ void settle_proj(const SettleData&    settled,
 }
 
 
+/*! \brief Computes the SETTLE corrections for a pack of water molecules
+ *
+ * Given the reference coordinates \p x_ow1, \p x_hw2, \p x_hw3 and the
+ * unconstrained coordinates \p xprime_ow1, \p xprime_hw2, \p xprime_hw3,
+ * returns the corrections to the unconstrained coordinates in \p dxOw1, \p dxHw2
+ * and \p dxHw3 and the reference O-H vectors in \p dist21 and \p dist31.
+ * Sets \p bError for severely distorted water molecules, never clears it.
+ */
+template<typename T, typename TypeBool, typename TypePbc>
+static inline void settleWaterPack(const SettleParameters& p,
+                                   const TypePbc           pbc,
+                                   const T                 x_ow1[DIM],
+                                   const T                 x_hw2[DIM],
+                                   const T                 x_hw3[DIM],
+                                   const T                 xprime_ow1[DIM],
+                                   const T                 xprime_hw2[DIM],
+                                   const T                 xprime_hw3[DIM],
+                                   T                       dxOw1[DIM],
+                                   T                       dxHw2[DIM],
+                                   T                       dxHw3[DIM],
+                                   T                       dist21[DIM],
+                                   T                       dist31[DIM],
+                                   TypeBool*               bError)
+{
+    T wh   = T(p.wh);
+    T rc   = T(p.rc);
+    T ra   = T(p.ra);
+    T rb   = T(p.rb);
+    T irc2 = T(p.irc2);
+
+    T almost_zero = T(1e-12);
+
+    T doh2[DIM], doh3[DIM];
+
+    pbc_dx_aiuc(pbc, x_hw2, x_ow1, dist21);
+
+    pbc_dx_aiuc(pbc, x_hw3, x_ow1, dist31);
+
+    pbc_dx_aiuc(pbc, xprime_hw2, xprime_ow1, doh2);
+
+    pbc_dx_aiuc(pbc, xprime_hw3, xprime_ow1, doh3);
+    /* 4 * 18 flops (would be 4 * 3 without PBC) */
+
+    /* Note that we completely avoid computing the center of mass and
+     * only use distances. This minimizes energy drift and also makes
+     * the computation slightly cheaper.
+     * Straightforward computation of the COM, as in the original algorithm,
+     * makes SETTLE the largest source of energy drift for simulations of water,
+     * as then the oxygen coordinate is multiplied by 0.89 at every step,
+     * which can then transfer a systematic rounding to the oxygen velocity.
+     * For some time we computed the COM using offsets from the oxygen, this
+     * significantly reduces the energy drift, but not using the COM at all,
+     * as we do now, is optimal.
+     */
+    T a1[DIM];
+    for (int d = 0; d < DIM; d++)
+    {
+        a1[d] = -(doh2[d] + doh3[d]) * wh;
+    }
+    T b1[DIM];
+    for (int d = 0; d < DIM; d++)
+    {
+        b1[d] = doh2[d] + a1[d];
+    }
+    T c1[DIM];
+    for (int d = 0; d < DIM; d++)
+    {
+        c1[d] = doh3[d] + a1[d];
+    }
+    /* 12 flops */
+
+    T xakszd = dist21[YY] * dist31[ZZ] - dist21[ZZ] * dist31[YY];
+    T yakszd = dist21[ZZ] * dist31[XX] - dist21[XX] * dist31[ZZ];
+    T zakszd = dist21[XX] * dist31[YY] - dist21[YY] * dist31[XX];
+    T xaksxd = a1[YY] * zakszd - a1[ZZ] * yakszd;
+    T yaksxd = a1[ZZ] * xakszd - a1[XX] * zakszd;
+    T zaksxd = a1[XX] * yakszd - a1[YY] * xakszd;
+    T xaksyd = yakszd * zaksxd - zakszd * yaksxd;
+    T yaksyd = zakszd * xaksxd - xakszd * zaksxd;
+    T zaksyd = xakszd * yaksxd - yakszd * xaksxd;
+    /* 27 flops */
+
+    T axlng = gmx::invsqrt(xaksxd * xaksxd + yaksxd * yaksxd + zaksxd * zaksxd);
+    T aylng = gmx::invsqrt(xaksyd * xaksyd + yaksyd * yaksyd + zaksyd * zaksyd);
+    T azlng = gmx::invsqrt(xakszd * xakszd + yakszd * yakszd + zakszd * zakszd);
+
+    T trns1[DIM], trns2[DIM], trns3[DIM];
+
+    trns1[XX] = xaksxd * axlng;
+    trns2[XX] = yaksxd * axlng;
+    trns3[XX] = zaksxd * axlng;
+    trns1[YY] = xaksyd * aylng;
+    trns2[YY] = yaksyd * aylng;
+    trns3[YY] = zaksyd * aylng;
+    trns1[ZZ] = xakszd * azlng;
+    trns2[ZZ] = yakszd * azlng;
+    trns3[ZZ] = zakszd * azlng;
+    /* 24 flops */
+
+    T b0d[2], c0d[2];
+
+    for (int d = 0; d < 2; d++)
+    {
+        b0d[d] = trns1[d] * dist21[XX] + trns2[d] * dist21[YY] + trns3[d] * dist21[ZZ];
+        c0d[d] = trns1[d] * dist31[XX] + trns2[d] * dist31[YY] + trns3[d] * dist31[ZZ];
+    }
+
+    T a1d_z, b1d[DIM], c1d[DIM];
+
+    a1d_z = trns1[ZZ] * a1[XX] + trns2[ZZ] * a1[YY] + trns3[ZZ] * a1[ZZ];
+    for (int d = 0; d < DIM; d++)
+    {
+        b1d[d] = trns1[d] * b1[XX] + trns2[d] * b1[YY] + trns3[d] * b1[ZZ];
+        c1d[d] = trns1[d] * c1[XX] + trns2[d] * c1[YY] + trns3[d] * c1[ZZ];
+    }
+    /* 65 flops */
+
+    T tmp, tmp2;
+
+    T sinphi = a1d_z * gmx::invsqrt(ra * ra);
+    tmp2     = 1.0 - sinphi * sinphi;
+
+    /* If tmp2 gets close to or beyond zero we have severly distorted
+     * water molecules and we should terminate the simulation.
+     * Below we take the max with almost_zero to continue the loop.
+     */
+    *bError = *bError || (tmp2 <= almost_zero);
+
+    tmp2     = max(tmp2, almost_zero);
+    tmp      = gmx::invsqrt(tmp2);
+    T cosphi = tmp2 * tmp;
+    T sinpsi = (b1d[ZZ] - c1d[ZZ]) * irc2 * tmp;
+    tmp2     = 1.0 - sinpsi * sinpsi;
+
+    T cospsi = tmp2 * gmx::invsqrt(tmp2);
+    /* 46 flops */
+
+    T a2d_y = ra * cosphi;
+    T b2d_x = -rc * cospsi;
+    T t1    = -rb * cosphi;
+    T t2    = rc * sinpsi * sinphi;
+    T b2d_y = t1 - t2;
+    T c2d_y = t1 + t2;
+    /* 7 flops */
+
+    /*     --- Step3  al,be,ga            --- */
+    T alpha  = b2d_x * (b0d[XX] - c0d[XX]) + b0d[YY] * b2d_y + c0d[YY] * c2d_y;
+    T beta   = b2d_x * (c0d[YY] - b0d[YY]) + b0d[XX] * b2d_y + c0d[XX] * c2d_y;
+    T gamma  = b0d[XX] * b1d[YY] - b1d[XX] * b0d[YY] + c0d[XX] * c1d[YY] - c1d[XX] * c0d[YY];
+    T al2be2 = alpha * alpha + beta * beta;
+    tmp2     = (al2be2 - gamma * gamma);
+    T sinthe = (alpha * gamma - beta * tmp2 * gmx::invsqrt(tmp2)) * gmx::invsqrt(al2be2 * al2be2);
+    /* 47 flops */
+
+    /*  --- Step4  A3' --- */
+    tmp2     = 1.0 - sinthe * sinthe;
+    T costhe = tmp2 * gmx::invsqrt(tmp2);
+
+    T a3d[DIM], b3d[DIM], c3d[DIM];
+
+    a3d[XX] = -a2d_y * sinthe;
+    a3d[YY] = a2d_y * costhe;
+    a3d[ZZ] = a1d_z;
+    b3d[XX] = b2d_x * costhe - b2d_y * sinthe;
+    b3d[YY] = b2d_x * sinthe + b2d_y * costhe;
+    b3d[ZZ] = b1d[ZZ];
+    c3d[XX] = -b2d_x * costhe - c2d_y * sinthe;
+    c3d[YY] = -b2d_x * sinthe + c2d_y * costhe;
+    c3d[ZZ] = c1d[ZZ];
+    /* 26 flops */
+
+    /*    --- Step5  A3 --- */
+    T a3[DIM], b3[DIM], c3[DIM];
+
+    a3[XX] = trns1[XX] * a3d[XX] + trns1[YY] * a3d[YY] + trns1[ZZ] * a3d[ZZ];
+    a3[YY] = trns2[XX] * a3d[XX] + trns2[YY] * a3d[YY] + trns2[ZZ] * a3d[ZZ];
+    a3[ZZ] = trns3[XX] * a3d[XX] + trns3[YY] * a3d[YY] + trns3[ZZ] * a3d[ZZ];
+    b3[XX] = trns1[XX] * b3d[XX] + trns1[YY] * b3d[YY] + trns1[ZZ] * b3d[ZZ];
+    b3[YY] = trns2[XX] * b3d[XX] + trns2[YY] * b3d[YY] + trns2[ZZ] * b3d[ZZ];
+    b3[ZZ] = trns3[XX] * b3d[XX] + trns3[YY] * b3d[YY] + trns3[ZZ] * b3d[ZZ];
+    c3[XX] = trns1[XX] * c3d[XX] + trns1[YY] * c3d[YY] + trns1[ZZ] * c3d[ZZ];
+    c3[YY] = trns2[XX] * c3d[XX] + trns2[YY] * c3d[YY] + trns2[ZZ] * c3d[ZZ];
+    c3[ZZ] = trns3[XX] * c3d[XX] + trns3[YY] * c3d[YY] + trns3[ZZ] * c3d[ZZ];
+    /* 45 flops */
+
+    /* Compute the corrections to the new coordinates */
+    for (int d = 0; d < DIM; d++)
+    {
+        dxOw1[d] = a3[d] - a1[d];
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        dxHw2[d] = b3[d] - b1[d];
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        dxHw3[d] = c3[d] - c1[d];
+    }
+    /* 9 flops */
+}
+
+/*! \brief Adds the virial contribution of a pack of settled water molecules to \p sum_r_m_dr */
+template<typename T>
+static inline void addSettleVirial(const T filter,
+                                   const T mO,
+                                   const T mH,
+                                   const T x_ow1[DIM],
+                                   const T dist21[DIM],
+                                   const T dist31[DIM],
+                                   const T dxOw1[DIM],
+                                   const T dxHw2[DIM],
+                                   const T dxHw3[DIM],
+                                   T       sum_r_m_dr[DIM][DIM])
+{
+    /* Filter out the non-local settles */
+    T mOf = filter * mO;
+    T mHf = filter * mH;
+
+    T mdo[DIM], mdb[DIM], mdc[DIM];
+
+    for (int d = 0; d < DIM; d++)
+    {
+        mdb[d] = mHf * dxHw2[d];
+        mdc[d] = mHf * dxHw3[d];
+        mdo[d] = mOf * dxOw1[d] + mdb[d] + mdc[d];
+    }
+
+    for (int d2 = 0; d2 < DIM; d2++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            sum_r_m_dr[d2][d] = sum_r_m_dr[d2][d]
+                                - (x_ow1[d2] * mdo[d] + dist21[d2] * mdb[d] + dist31[d2] * mdc[d]);
+        }
+    }
+    /* 71 flops */
+}
+
 /*! \brief The actual settle code, templated for real/SimdReal and for optimization */
 template<typename T, typename TypeBool, int packSize, typename TypePbc, bool bCorrectVelocity, bool bCalcVirial>
 static void settleTemplate(const SettleData& settled,
@@ -400,16 +639,9 @@ static void settleTemplate(const SettleData& settled,
 
     TypeBool bError = TypeBool(false);
 
-    const SettleParameters* p    = &settled.parametersMassWeighted();
-    T                       wh   = T(p->wh);
-    T                       rc   = T(p->rc);
-    T                       ra   = T(p->ra);
-    T                       rb   = T(p->rb);
-    T                       irc2 = T(p->irc2);
-    T                       mO   = T(p->mO);
-    T                       mH   = T(p->mH);
-
-    T almost_zero = T(1e-12);
+    const SettleParameters* p  = &settled.parametersMassWeighted();
+    T                       mO = T(p->mO);
+    T                       mH = T(p->mH);
 
     T sum_r_m_dr[DIM][DIM];
 
@@ -446,180 +678,20 @@ static void settleTemplate(const SettleData& settled,
         gatherLoadUTranspose<3>(xprime, hw2, &xprime_hw2[XX], &xprime_hw2[YY], &xprime_hw2[ZZ]);
         gatherLoadUTranspose<3>(xprime, hw3, &xprime_hw3[XX], &xprime_hw3[YY], &xprime_hw3[ZZ]);
 
+        T dxOw1[DIM], dxHw2[DIM], dxHw3[DIM];
         T dist21[DIM], dist31[DIM];
-        T doh2[DIM], doh3[DIM];
-
-        pbc_dx_aiuc(pbc, x_hw2, x_ow1, dist21);
-
-        pbc_dx_aiuc(pbc, x_hw3, x_ow1, dist31);
-
-        pbc_dx_aiuc(pbc, xprime_hw2, xprime_ow1, doh2);
-
-        pbc_dx_aiuc(pbc, xprime_hw3, xprime_ow1, doh3);
-        /* 4 * 18 flops (would be 4 * 3 without PBC) */
-
-        /* Note that we completely avoid computing the center of mass and
-         * only use distances. This minimizes energy drift and also makes
-         * the computation slightly cheaper.
-         * Straightforward computation of the COM, as in the original algorithm,
-         * makes SETTLE the largest source of energy drift for simulations of water,
-         * as then the oxygen coordinate is multiplied by 0.89 at every step,
-         * which can then transfer a systematic rounding to the oxygen velocity.
-         * For some time we computed the COM using offsets from the oxygen, this
-         * significantly reduces the energy drift, but not using the COM at all,
-         * as we do now, is optimal.
-         */
-        T a1[DIM];
-        for (int d = 0; d < DIM; d++)
-        {
-            a1[d] = -(doh2[d] + doh3[d]) * wh;
-        }
-        T b1[DIM];
-        for (int d = 0; d < DIM; d++)
-        {
-            b1[d] = doh2[d] + a1[d];
-        }
-        T c1[DIM];
-        for (int d = 0; d < DIM; d++)
-        {
-            c1[d] = doh3[d] + a1[d];
-        }
-        /* 12 flops */
-
-        T xakszd = dist21[YY] * dist31[ZZ] - dist21[ZZ] * dist31[YY];
-        T yakszd = dist21[ZZ] * dist31[XX] - dist21[XX] * dist31[ZZ];
-        T zakszd = dist21[XX] * dist31[YY] - dist21[YY] * dist31[XX];
-        T xaksxd = a1[YY] * zakszd - a1[ZZ] * yakszd;
-        T yaksxd = a1[ZZ] * xakszd - a1[XX] * zakszd;
-        T zaksxd = a1[XX] * yakszd - a1[YY] * xakszd;
-        T xaksyd = yakszd * zaksxd - zakszd * yaksxd;
-        T yaksyd = zakszd * xaksxd - xakszd * zaksxd;
-        T zaksyd = xakszd * yaksxd - yakszd * xaksxd;
-        /* 27 flops */
-
-        T axlng = gmx::invsqrt(xaksxd * xaksxd + yaksxd * yaksxd + zaksxd * zaksxd);
-        T aylng = gmx::invsqrt(xaksyd * xaksyd + yaksyd * yaksyd + zaksyd * zaksyd);
-        T azlng = gmx::invsqrt(xakszd * xakszd + yakszd * yakszd + zakszd * zakszd);
-
-        T trns1[DIM], trns2[DIM], trns3[DIM];
 
-        trns1[XX] = xaksxd * axlng;
-        trns2[XX] = yaksxd * axlng;
-        trns3[XX] = zaksxd * axlng;
-        trns1[YY] = xaksyd * aylng;
-        trns2[YY] = yaksyd * aylng;
-        trns3[YY] = zaksyd * aylng;
-        trns1[ZZ] = xakszd * azlng;
-        trns2[ZZ] = yakszd * azlng;
-        trns3[ZZ] = zakszd * azlng;
-        /* 24 flops */
-
-        T b0d[2], c0d[2];
-
-        for (int d = 0; d < 2; d++)
-        {
-            b0d[d] = trns1[d] * dist21[XX] + trns2[d] * dist21[YY] + trns3[d] * dist21[ZZ];
-            c0d[d] = trns1[d] * dist31[XX] + trns2[d] * dist31[YY] + trns3[d] * dist31[ZZ];
-        }
-
-        T a1d_z, b1d[DIM], c1d[DIM];
-
-        a1d_z = trns1[ZZ] * a1[XX] + trns2[ZZ] * a1[YY] + trns3[ZZ] * a1[ZZ];
-        for (int d = 0; d < DIM; d++)
-        {
-            b1d[d] = trns1[d] * b1[XX] + trns2[d] * b1[YY] + trns3[d] * b1[ZZ];
-            c1d[d] = trns1[d] * c1[XX] + trns2[d] * c1[YY] + trns3[d] * c1[ZZ];
-        }
-        /* 65 flops */
-
-        T tmp, tmp2;
-
-        T sinphi = a1d_z * gmx::invsqrt(ra * ra);
-        tmp2     = 1.0 - sinphi * sinphi;
-
-        /* If tmp2 gets close to or beyond zero we have severly distorted
-         * water molecules and we should terminate the simulation.
-         * Below we take the max with almost_zero to continue the loop.
-         */
-        bError = bError || (tmp2 <= almost_zero);
-
-        tmp2     = max(tmp2, almost_zero);
-        tmp      = gmx::invsqrt(tmp2);
-        T cosphi = tmp2 * tmp;
-        T sinpsi = (b1d[ZZ] - c1d[ZZ]) * irc2 * tmp;
-        tmp2     = 1.0 - sinpsi * sinpsi;
-
-        T cospsi = tmp2 * gmx::invsqrt(tmp2);
-        /* 46 flops */
-
-        T a2d_y = ra * cosphi;
-        T b2d_x = -rc * cospsi;
-        T t1    = -rb * cosphi;
-        T t2    = rc * sinpsi * sinphi;
-        T b2d_y = t1 - t2;
-        T c2d_y = t1 + t2;
-        /* 7 flops */
-
-        /*     --- Step3  al,be,ga            --- */
-        T alpha  = b2d_x * (b0d[XX] - c0d[XX]) + b0d[YY] * b2d_y + c0d[YY] * c2d_y;
-        T beta   = b2d_x * (c0d[YY] - b0d[YY]) + b0d[XX] * b2d_y + c0d[XX] * c2d_y;
-        T gamma  = b0d[XX] * b1d[YY] - b1d[XX] * b0d[YY] + c0d[XX] * c1d[YY] - c1d[XX] * c0d[YY];
-        T al2be2 = alpha * alpha + beta * beta;
-        tmp2     = (al2be2 - gamma * gamma);
-        T sinthe = (alpha * gamma - beta * tmp2 * gmx::invsqrt(tmp2)) * gmx::invsqrt(al2be2 * al2be2);
-        /* 47 flops */
-
-        /*  --- Step4  A3' --- */
-        tmp2     = 1.0 - sinthe * sinthe;
-        T costhe = tmp2 * gmx::invsqrt(tmp2);
-
-        T a3d[DIM], b3d[DIM], c3d[DIM];
-
-        a3d[XX] = -a2d_y * sinthe;
-        a3d[YY] = a2d_y * costhe;
-        a3d[ZZ] = a1d_z;
-        b3d[XX] = b2d_x * costhe - b2d_y * sinthe;
-        b3d[YY] = b2d_x * sinthe + b2d_y * costhe;
-        b3d[ZZ] = b1d[ZZ];
-        c3d[XX] = -b2d_x * costhe - c2d_y * sinthe;
-        c3d[YY] = -b2d_x * sinthe + c2d_y * costhe;
-        c3d[ZZ] = c1d[ZZ];
-        /* 26 flops */
-
-        /*    --- Step5  A3 --- */
-        T a3[DIM], b3[DIM], c3[DIM];
-
-        a3[XX] = trns1[XX] * a3d[XX] + trns1[YY] * a3d[YY] + trns1[ZZ] * a3d[ZZ];
-        a3[YY] = trns2[XX] * a3d[XX] + trns2[YY] * a3d[YY] + trns2[ZZ] * a3d[ZZ];
-        a3[ZZ] = trns3[XX] * a3d[XX] + trns3[YY] * a3d[YY] + trns3[ZZ] * a3d[ZZ];
-        b3[XX] = trns1[XX] * b3d[XX] + trns1[YY] * b3d[YY] + trns1[ZZ] * b3d[ZZ];
-        b3[YY] = trns2[XX] * b3d[XX] + trns2[YY] * b3d[YY] + trns2[ZZ] * b3d[ZZ];
-        b3[ZZ] = trns3[XX] * b3d[XX] + trns3[YY] * b3d[YY] + trns3[ZZ] * b3d[ZZ];
-        c3[XX] = trns1[XX] * c3d[XX] + trns1[YY] * c3d[YY] + trns1[ZZ] * c3d[ZZ];
-        c3[YY] = trns2[XX] * c3d[XX] + trns2[YY] * c3d[YY] + trns2[ZZ] * c3d[ZZ];
-        c3[ZZ] = trns3[XX] * c3d[XX] + trns3[YY] * c3d[YY] + trns3[ZZ] * c3d[ZZ];
-        /* 45 flops */
+        settleWaterPack(*p, pbc, x_ow1, x_hw2, x_hw3, xprime_ow1, xprime_hw2, xprime_hw3, dxOw1,
+                        dxHw2, dxHw3, dist21, dist31, &bError);
 
         /* Compute and store the corrected new coordinate */
-        T dxOw1[DIM];
         for (int d = 0; d < DIM; d++)
         {
-            dxOw1[d]      = a3[d] - a1[d];
             xprime_ow1[d] = xprime_ow1[d] + dxOw1[d];
-        }
-        T dxHw2[DIM];
-        for (int d = 0; d < DIM; d++)
-        {
-            dxHw2[d]      = b3[d] - b1[d];
             xprime_hw2[d] = xprime_hw2[d] + dxHw2[d];
-        }
-        T dxHw3[DIM];
-        for (int d = 0; d < DIM; d++)
-        {
-            dxHw3[d]      = c3[d] - c1[d];
             xprime_hw3[d] = xprime_hw3[d] + dxHw3[d];
         }
-        /* 9 + 9 flops */
+        /* 9 flops */
 
         transposeScatterStoreU<3>(xprime, ow1, xprime_ow1[XX], xprime_ow1[YY], xprime_ow1[ZZ]);
         transposeScatterStoreU<3>(xprime, hw2, xprime_hw2[XX], xprime_hw2[YY], xprime_hw2[ZZ]);
@@ -655,30 +727,8 @@ static void settleTemplate(const SettleData& settled,
 
         if (bCalcVirial)
         {
-            /* Filter out the non-local settles */
-            T filter = load<T>(settled.virfac() + i);
-            T mOf    = filter * mO;
-            T mHf    = filter * mH;
-
-            T mdo[DIM], mdb[DIM], mdc[DIM];
-
-            for (int d = 0; d < DIM; d++)
-            {
-                mdb[d] = mHf * dxHw2[d];
-                mdc[d] = mHf * dxHw3[d];
-                mdo[d] = mOf * dxOw1[d] + mdb[d] + mdc[d];
-            }
-
-            for (int d2 = 0; d2 < DIM; d2++)
-            {
-                for (int d = 0; d < DIM; d++)
-                {
-                    sum_r_m_dr[d2][d] =
-                            sum_r_m_dr[d2][d]
-                            - (x_ow1[d2] * mdo[d] + dist21[d2] * mdb[d] + dist31[d2] * mdc[d]);
-                }
-            }
-            /* 71 flops */
+            addSettleVirial(load<T>(settled.virfac() + i), mO, mH, x_ow1, dist21, dist31, dxOw1,
+                            dxHw2, dxHw3, sum_r_m_dr);
         }
     }
 
@@ -696,13 +746,13 @@ static void settleTemplate(const SettleData& settled,
     *bErrorHasOccurred = anyTrue(bError);
 }
 
-/*! \brief Wrapper template function that divides the settles over threads
- * and instantiates the core template with instantiated booleans.
+/*! \brief Wrapper template function that instantiates the core template
+ * with instantiated booleans for settles \p settleStart to \p settleEnd.
  */
 template<typename T, typename TypeBool, int packSize, typename TypePbc>
 static void settleTemplateWrapper(const SettleData& settled,
-                                  int               nthread,
-                                  int               thread,
+                                  int               settleStart,
+                                  int               settleEnd,
                                   TypePbc           pbc,
                                   const real        x[],
                                   real              xprime[],
@@ -712,12 +762,6 @@ static void settleTemplateWrapper(const SettleData& settled,
                                   tensor            vir_r_m_dr,
                                   bool*             bErrorHasOccurred)
 {
-    /* We need to assign settles to threads in groups of pack_size */
-    int numSettlePacks = (settled.numSettles() + packSize - 1) / packSize;
-    /* Round the end value up to give thread 0 more work */
-    int settleStart = ((numSettlePacks * thread + nthread - 1) / nthread) * packSize;
-    int settleEnd   = ((numSettlePacks * (thread + 1) + nthread - 1) / nthread) * packSize;
-
     if (v != nullptr)
     {
         if (!bCalcVirial)
@@ -746,6 +790,236 @@ static void settleTemplateWrapper(const SettleData& settled,
     }
 }
 
+/*! \brief Leap-frog update and SETTLE for contiguous water molecules, templated for real/SimdReal
+ *
+ * Water molecule \p i consists of atoms firstAtom + 3*i + {0, 1, 2}, so the atom
+ * offsets within a pack are implicit. The updated and settled coordinates
+ * and velocities are written directly to \p x and \p v.
+ */
+template<typename T, typename TypeBool, int packSize, typename TypePbc, bool bCalcVirial>
+static void settleWithUpdateTemplate(const SettleData& settled,
+                                     int               firstAtom,
+                                     int               settleStart,
+                                     int               settleEnd,
+                                     const TypePbc     pbc,
+                                     real              dt,
+                                     real              lambda,
+                                     real              invdt,
+                                     real* gmx_restrict x,
+                                     real* gmx_restrict v,
+                                     const real* gmx_restrict f,
+                                     tensor                   vir_r_m_dr,
+                                     bool*                    bErrorHasOccurred)
+{
+    assert(settleStart % packSize == 0);
+    assert(settleEnd % packSize == 0);
+
+    const int atomsPerSettle = NRAL(F_SETTLE);
+
+    TypeBool bError = TypeBool(false);
+
+    const SettleParameters& p = settled.parametersMassWeighted();
+    T                       mO(p.mO);
+    T                       mH(p.mH);
+    T                       invMassO(p.imO);
+    T                       invMassH(p.imH);
+    T                       timestep(dt);
+    T                       lambdaSystem(lambda);
+    T                       invTimestep(invdt);
+
+    T sum_r_m_dr[DIM][DIM];
+
+    if (bCalcVirial)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                sum_r_m_dr[d2][d] = T(0);
+            }
+        }
+    }
+
+    /* The atom offsets of the oxygens in a pack relative to the first oxygen */
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t offsets[packSize];
+
+    for (int i = settleStart; i < settleEnd; i += packSize)
+    {
+        /* As in settleTemplate, we pad the last pack with copies of the last water */
+        const int numValid = std::min(packSize, settled.numSettles() - i);
+        for (int j = 0; j < packSize; j++)
+        {
+            offsets[j] = atomsPerSettle * std::min(j, numValid - 1);
+        }
+
+        const int ow1 = DIM * (firstAtom + atomsPerSettle * i);
+        const int hw2 = ow1 + DIM;
+        const int hw3 = ow1 + 2 * DIM;
+
+        T x_ow1[DIM], x_hw2[DIM], x_hw3[DIM];
+        T v_ow1[DIM], v_hw2[DIM], v_hw3[DIM];
+        T f_ow1[DIM], f_hw2[DIM], f_hw3[DIM];
+
+        gatherLoadUTranspose<3>(x + ow1, offsets, &x_ow1[XX], &x_ow1[YY], &x_ow1[ZZ]);
+        gatherLoadUTranspose<3>(x + hw2, offsets, &x_hw2[XX], &x_hw2[YY], &x_hw2[ZZ]);
+        gatherLoadUTranspose<3>(x + hw3, offsets, &x_hw3[XX], &x_hw3[YY], &x_hw3[ZZ]);
+        gatherLoadUTranspose<3>(v + ow1, offsets, &v_ow1[XX], &v_ow1[YY], &v_ow1[ZZ]);
+        gatherLoadUTranspose<3>(v + hw2, offsets, &v_hw2[XX], &v_hw2[YY], &v_hw2[ZZ]);
+        gatherLoadUTranspose<3>(v + hw3, offsets, &v_hw3[XX], &v_hw3[YY], &v_hw3[ZZ]);
+        gatherLoadUTranspose<3>(f + ow1, offsets, &f_ow1[XX], &f_ow1[YY], &f_ow1[ZZ]);
+        gatherLoadUTranspose<3>(f + hw2, offsets, &f_hw2[XX], &f_hw2[YY], &f_hw2[ZZ]);
+        gatherLoadUTranspose<3>(f + hw3, offsets, &f_hw3[XX], &f_hw3[YY], &f_hw3[ZZ]);
+
+        /* The leap-frog update, with the same operations as updateMDLeapfrogSimpleSimd() */
+        T xprime_ow1[DIM], xprime_hw2[DIM], xprime_hw3[DIM];
+        for (int d = 0; d < DIM; d++)
+        {
+            v_ow1[d]      = fma(f_ow1[d] * invMassO, timestep, lambdaSystem * v_ow1[d]);
+            v_hw2[d]      = fma(f_hw2[d] * invMassH, timestep, lambdaSystem * v_hw2[d]);
+            v_hw3[d]      = fma(f_hw3[d] * invMassH, timestep, lambdaSystem * v_hw3[d]);
+            xprime_ow1[d] = fma(v_ow1[d], timestep, x_ow1[d]);
+            xprime_hw2[d] = fma(v_hw2[d], timestep, x_hw2[d]);
+            xprime_hw3[d] = fma(v_hw3[d], timestep, x_hw3[d]);
+        }
+
+        T dxOw1[DIM], dxHw2[DIM], dxHw3[DIM];
+        T dist21[DIM], dist31[DIM];
+
+        settleWaterPack(p, pbc, x_ow1, x_hw2, x_hw3, xprime_ow1, xprime_hw2, xprime_hw3, dxOw1,
+                        dxHw2, dxHw3, dist21, dist31, &bError);
+
+        /* Store the corrected coordinates and velocities, all reads of this pack are done */
+        for (int d = 0; d < DIM; d++)
+        {
+            xprime_ow1[d] = xprime_ow1[d] + dxOw1[d];
+            xprime_hw2[d] = xprime_hw2[d] + dxHw2[d];
+            xprime_hw3[d] = xprime_hw3[d] + dxHw3[d];
+            v_ow1[d]      = fma(dxOw1[d], invTimestep, v_ow1[d]);
+            v_hw2[d]      = fma(dxHw2[d], invTimestep, v_hw2[d]);
+            v_hw3[d]      = fma(dxHw3[d], invTimestep, v_hw3[d]);
+        }
+
+        transposeScatterStoreU<3>(x + ow1, offsets, xprime_ow1[XX], xprime_ow1[YY], xprime_ow1[ZZ]);
+        transposeScatterStoreU<3>(x + hw2, offsets, xprime_hw2[XX], xprime_hw2[YY], xprime_hw2[ZZ]);
+        transposeScatterStoreU<3>(x + hw3, offsets, xprime_hw3[XX], xprime_hw3[YY], xprime_hw3[ZZ]);
+        transposeScatterStoreU<3>(v + ow1, offsets, v_ow1[XX], v_ow1[YY], v_ow1[ZZ]);
+        transposeScatterStoreU<3>(v + hw2, offsets, v_hw2[XX], v_hw2[YY], v_hw2[ZZ]);
+        transposeScatterStoreU<3>(v + hw3, offsets, v_hw3[XX], v_hw3[YY], v_hw3[ZZ]);
+
+        if (bCalcVirial)
+        {
+            addSettleVirial(load<T>(settled.virfac() + i), mO, mH, x_ow1, dist21, dist31, dxOw1,
+                            dxHw2, dxHw3, sum_r_m_dr);
+        }
+    }
+
+    if (bCalcVirial)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                vir_r_m_dr[d2][d] += reduce(sum_r_m_dr[d2][d]);
+            }
+        }
+    }
+
+    *bErrorHasOccurred = anyTrue(bError);
+}
+
+//! Wrapper template function that divides the virial choice over templates
+template<typename T, typename TypeBool, int packSize, typename TypePbc>
+static void settleWithUpdateTemplateWrapper(const SettleData& settled,
+                                            int               firstAtom,
+                                            int               settleStart,
+                                            int               settleEnd,
+                                            TypePbc           pbc,
+                                            real              dt,
+                                            real              lambda,
+                                            real              invdt,
+                                            real*             x,
+                                            real*             v,
+                                            const real*       f,
+                                            bool              bCalcVirial,
+                                            tensor            vir_r_m_dr,
+                                            bool*             bErrorHasOccurred)
+{
+    if (!bCalcVirial)
+    {
+        settleWithUpdateTemplate<T, TypeBool, packSize, TypePbc, false>(
+                settled, firstAtom, settleStart, settleEnd, pbc, dt, lambda, invdt, x, v, f,
+                nullptr, bErrorHasOccurred);
+    }
+    else
+    {
+        settleWithUpdateTemplate<T, TypeBool, packSize, TypePbc, true>(
+                settled, firstAtom, settleStart, settleEnd, pbc, dt, lambda, invdt, x, v, f,
+                vir_r_m_dr, bErrorHasOccurred);
+    }
+}
+
+int SettleData::packSize() const
+{
+#if GMX_SIMD_HAVE_REAL
+    if (useSimd_)
+    {
+        return GMX_SIMD_REAL_WIDTH;
+    }
+#endif
+    return 1;
+}
+
+//! Settles \p settleStart to \p settleEnd, which should be multiples of the pack size
+static void settleRange(const SettleData&               settled,
+                        int                             settleStart,
+                        int                             settleEnd,
+                        const t_pbc*                    pbc,
+                        ArrayRefWithPadding<const RVec> x,
+                        ArrayRefWithPadding<RVec>       xprime,
+                        real                            invdt,
+                        ArrayRefWithPadding<RVec>       v,
+                        bool                            bCalcVirial,
+                        tensor                          vir_r_m_dr,
+                        bool*                           bErrorHasOccurred)
+{
+    const real* xPtr      = as_rvec_array(x.paddedArrayRef().data())[0];
+    real*       xprimePtr = as_rvec_array(xprime.paddedArrayRef().data())[0];
+    real*       vPtr      = as_rvec_array(v.paddedArrayRef().data())[0];
+
+#if GMX_SIMD_HAVE_REAL
+    if (settled.useSimd())
+    {
+        /* Convert the pbc struct for SIMD */
+        alignas(GMX_SIMD_ALIGNMENT) real pbcSimd[9 * GMX_SIMD_REAL_WIDTH];
+        set_pbc_simd(pbc, pbcSimd);
+
+        settleTemplateWrapper<SimdReal, SimdBool, GMX_SIMD_REAL_WIDTH, const real*>(
+                settled, settleStart, settleEnd, pbcSimd, xPtr, xprimePtr, invdt, vPtr, bCalcVirial,
+                vir_r_m_dr, bErrorHasOccurred);
+    }
+    else
+#endif
+    {
+        /* This construct is needed because pbc_dx_aiuc doesn't accept pbc=NULL */
+        t_pbc        pbcNo;
+        const t_pbc* pbcNonNull;
+
+        if (pbc != nullptr)
+        {
+            pbcNonNull = pbc;
+        }
+        else
+        {
+            set_pbc(&pbcNo, PbcType::No, nullptr);
+            pbcNonNull = &pbcNo;
+        }
+
+        settleTemplateWrapper<real, bool, 1, const t_pbc*>(
+                settled, settleStart, settleEnd, pbcNonNull, &xPtr[0], &xprimePtr[0], invdt,
+                &vPtr[0], bCalcVirial, vir_r_m_dr, bErrorHasOccurred);
+    }
+}
+
 void csettle(const SettleData&               settled,
              int                             nthread,
              int                             thread,
@@ -758,25 +1032,87 @@ void csettle(const SettleData&               settled,
              tensor                          vir_r_m_dr,
              bool*                           bErrorHasOccurred)
 {
-    const real* xPtr      = as_rvec_array(x.paddedArrayRef().data())[0];
-    real*       xprimePtr = as_rvec_array(xprime.paddedArrayRef().data())[0];
-    real*       vPtr      = as_rvec_array(v.paddedArrayRef().data())[0];
+    /* We need to assign settles to threads in groups of pack_size */
+    const int packSize       = settled.packSize();
+    const int numSettlePacks = (settled.numSettles() + packSize - 1) / packSize;
+    /* Round the end value up to give thread 0 more work */
+    const int settleStart = ((numSettlePacks * thread + nthread - 1) / nthread) * packSize;
+    const int settleEnd   = ((numSettlePacks * (thread + 1) + nthread - 1) / nthread) * packSize;
+
+    settleRange(settled, settleStart, settleEnd, pbc, x, xprime, invdt, v, bCalcVirial, vir_r_m_dr,
+                bErrorHasOccurred);
+}
+
+void csettleRange(const SettleData&               settled,
+                  int                             settleStart,
+                  int                             settleEnd,
+                  const t_pbc*                    pbc,
+                  ArrayRefWithPadding<const RVec> x,
+                  ArrayRefWithPadding<RVec>       xprime,
+                  real                            invdt,
+                  ArrayRefWithPadding<RVec>       v,
+                  bool                            bCalcVirial,
+                  tensor                          vir_r_m_dr,
+                  bool*                           bErrorHasOccurred)
+{
+    const int packSize = settled.packSize();
+
+    GMX_ASSERT(settleStart % packSize == 0, "The first settle should be at a pack boundary");
+    GMX_ASSERT(settleEnd % packSize == 0 || settleEnd == settled.numSettles(),
+               "The settle range should end at a pack boundary or at the last settle");
+
+    /* The last pack is padded with copies of the last settle without virial contribution */
+    settleEnd = ((settleEnd + packSize - 1) / packSize) * packSize;
+
+    bool errorHasOccurred = false;
+    settleRange(settled, settleStart, settleEnd, pbc, x, xprime, invdt, v, bCalcVirial, vir_r_m_dr,
+                &errorHasOccurred);
+    *bErrorHasOccurred = *bErrorHasOccurred || errorHasOccurred;
+}
+
+void csettleWithLeapfrogUpdate(const SettleData&               settled,
+                               int                             firstAtom,
+                               int                             settleStart,
+                               int                             settleEnd,
+                               const t_pbc*                    pbc,
+                               real                            dt,
+                               real                            lambda,
+                               real                            invdt,
+                               ArrayRefWithPadding<RVec>       x,
+                               ArrayRefWithPadding<RVec>       v,
+                               ArrayRefWithPadding<const RVec> f,
+                               bool                            bCalcVirial,
+                               tensor                          vir_r_m_dr,
+                               bool*                           bErrorHasOccurred)
+{
+    const int packSize = settled.packSize();
+
+    GMX_ASSERT(settleStart % packSize == 0, "The first settle should be at a pack boundary");
+    GMX_ASSERT(settleEnd % packSize == 0 || settleEnd == settled.numSettles(),
+               "The settle range should end at a pack boundary or at the last settle");
+    GMX_ASSERT(settleEnd <= settled.numSettles(), "Can not settle beyond the last settle");
+
+    settleEnd = ((settleEnd + packSize - 1) / packSize) * packSize;
+
+    real*       xPtr = as_rvec_array(x.paddedArrayRef().data())[0];
+    real*       vPtr = as_rvec_array(v.paddedArrayRef().data())[0];
+    const real* fPtr = as_rvec_array(f.paddedArrayRef().data())[0];
+
+    bool errorHasOccurred = false;
 
 #if GMX_SIMD_HAVE_REAL
     if (settled.useSimd())
     {
-        /* Convert the pbc struct for SIMD */
         alignas(GMX_SIMD_ALIGNMENT) real pbcSimd[9 * GMX_SIMD_REAL_WIDTH];
         set_pbc_simd(pbc, pbcSimd);
 
-        settleTemplateWrapper<SimdReal, SimdBool, GMX_SIMD_REAL_WIDTH, const real*>(
-                settled, nthread, thread, pbcSimd, xPtr, xprimePtr, invdt, vPtr, bCalcVirial,
-                vir_r_m_dr, bErrorHasOccurred);
+        settleWithUpdateTemplateWrapper<SimdReal, SimdBool, GMX_SIMD_REAL_WIDTH, const real*>(
+                settled, firstAtom, settleStart, settleEnd, pbcSimd, dt, lambda, invdt, xPtr, vPtr,
+                fPtr, bCalcVirial, vir_r_m_dr, &errorHasOccurred);
     }
     else
 #endif
     {
-        /* This construct is needed because pbc_dx_aiuc doesn't accept pbc=NULL */
         t_pbc        pbcNo;
         const t_pbc* pbcNonNull;
 
@@ -790,10 +1126,12 @@ void csettle(const SettleData&               settled,
             pbcNonNull = &pbcNo;
         }
 
-        settleTemplateWrapper<real, bool, 1, const t_pbc*>(settled, nthread, thread, pbcNonNull,
-                                                           &xPtr[0], &xprimePtr[0], invdt, &vPtr[0],
-                                                           bCalcVirial, vir_r_m_dr, bErrorHasOccurred);
+        settleWithUpdateTemplateWrapper<real, bool, 1, const t_pbc*>(
+                settled, firstAtom, settleStart, settleEnd, pbcNonNull, dt, lambda, invdt, xPtr,
+                vPtr, fPtr, bCalcVirial, vir_r_m_dr, &errorHasOccurred);
     }
+
+    *bErrorHasOccurred = *bErrorHasOccurred || errorHasOccurred;
 }
 
 } // namespace gmx
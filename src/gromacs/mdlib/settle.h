@@ -147,6 +147,9 @@ public:
     //! Returns whether we should use SIMD intrinsics code
     bool useSimd() const { return useSimd_; }
 
+    //! Returns the number of settles that are processed together, ranges should align to this
+    int packSize() const;
+
 private:
     //! Parameters for SETTLE for coordinates
     SettleParameters parametersMassWeighted_;
@@ -185,6 +188,52 @@ void csettle(const SettleData&               settled,     /* The SETTLE structur
              bool*                           bErrorHasOccurred /* True if a settle error occurred */
 );
 
+/*! \brief Constrain coordinates of settles \p settleStart to \p settleEnd using SETTLE.
+ *
+ * Settles a contiguous range instead of a thread's share of all settles,
+ * so callers can interleave SETTLE with other work on the same atoms.
+ * \p settleStart should be a multiple of SettleData::packSize(), \p settleEnd
+ * as well, unless it is the number of settles.
+ * The virial contribution is added to \p vir_r_m_dr and \p bErrorHasOccurred
+ * is only set, never cleared.
+ */
+void csettleRange(const SettleData&               settled,
+                  int                             settleStart,
+                  int                             settleEnd,
+                  const t_pbc*                    pbc, /* PBC data pointer, can be NULL */
+                  ArrayRefWithPadding<const RVec> x,
+                  ArrayRefWithPadding<RVec>       xprime,
+                  real                            invdt,
+                  ArrayRefWithPadding<RVec>       v,
+                  bool                            bCalcVirial,
+                  tensor                          vir_r_m_dr,
+                  bool*                           bErrorHasOccurred);
+
+/*! \brief Applies the leap-frog update and SETTLE to water molecules \p settleStart to \p settleEnd
+ *
+ * Requires that SETTLE \p i acts on atoms \p firstAtom + 3*i + {0, 1, 2}
+ * and that all waters have the inverse masses of the SETTLE parameters.
+ * The update is the simple leap-frog update with a single T-coupling
+ * scaling factor \p lambda. The constrained coordinates and velocities
+ * are stored directly in \p x and \p v, so the unconstrained coordinates
+ * never go through memory. Range requirements, virial and error
+ * handling are as for csettleRange().
+ */
+void csettleWithLeapfrogUpdate(const SettleData&               settled,
+                               int                             firstAtom,
+                               int                             settleStart,
+                               int                             settleEnd,
+                               const t_pbc*                    pbc, /* PBC data, can be NULL */
+                               real                            dt,
+                               real                            lambda,
+                               real                            invdt,
+                               ArrayRefWithPadding<RVec>       x,
+                               ArrayRefWithPadding<RVec>       v,
+                               ArrayRefWithPadding<const RVec> f,
+                               bool                            bCalcVirial,
+                               tensor                          vir_r_m_dr,
+                               bool*                           bErrorHasOccurred);
+
 /*! \brief Analytical algorithm to subtract the components of derivatives
  * of coordinates working on settle type constraint.
  */
@@ -47,6 +47,8 @@
 
 #include "shake.h"
 
+#include "config.h"
+
 #include <cmath>
 
 #include <algorithm>
@@ -55,17 +57,25 @@
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/constr.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/splitter.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/topology/invblock.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
 
 namespace gmx
 {
 
+//! The maximum number of SHAKE or RATTLE iterations
+static constexpr int c_shakeMaxIterations = 1000;
+
 typedef struct
 {
     int iatom[3];
@@ -121,6 +131,92 @@ static void resizeLagrangianData(shakedata* shaked, int ncons)
     shaked->scaled_lagrange_multiplier.resize(ncons);
 }
 
+//! Returns the number of constraints in SHAKE block \p block
+static int shakeBlockLength(const shakedata& shaked, int block)
+{
+    return (shaked.sblock[block + 1] - shaked.sblock[block]) / 3;
+}
+
+/*! \brief Divides the SHAKE blocks over the threads
+ *
+ * Each thread gets a contiguous range of blocks with approximately
+ * the same number of constraints, so the division only depends on
+ * the topology and the thread count. With SIMD, blocks of equal
+ * length within a thread are grouped into batches of
+ * GMX_SIMD_REAL_WIDTH blocks that are constrained simultaneously.
+ * When blocks share atoms, all blocks are processed in order by one thread.
+ */
+static void setShakeThreadDivision(shakedata* shaked)
+{
+    const int numBlocks      = shaked->numShakeBlocks();
+    const int numConstraints = shaked->sblock[numBlocks] / 3;
+    const int numThreads =
+            shaked->haveIndependentBlocks ? std::max(gmx_omp_nthreads_get(emntLINCS), 1) : 1;
+
+    shaked->threadData.resize(numThreads);
+
+    int block = 0;
+    for (int th = 0; th < numThreads; th++)
+    {
+        ShakeThreadData& threadData = shaked->threadData[th];
+        threadData.simdBatchBlocks.clear();
+        threadData.blocks.clear();
+
+        const int constraintEnd = ((th + 1) * numConstraints) / numThreads;
+        while (block < numBlocks
+               && (th == numThreads - 1 || shaked->sblock[block] / 3 < constraintEnd))
+        {
+            threadData.blocks.push_back(block);
+            block++;
+        }
+
+#if GMX_SIMD_HAVE_REAL
+        if (shaked->haveIndependentBlocks)
+        {
+            /* Sort on block length, with equal lengths the index order is kept */
+            std::vector<int> sortedBlocks = threadData.blocks;
+            std::stable_sort(sortedBlocks.begin(), sortedBlocks.end(), [shaked](int b1, int b2) {
+                return shakeBlockLength(*shaked, b1) < shakeBlockLength(*shaked, b2);
+            });
+
+            threadData.blocks.clear();
+            for (size_t runStart = 0; runStart < sortedBlocks.size();)
+            {
+                const int blockLength = shakeBlockLength(*shaked, sortedBlocks[runStart]);
+                size_t    runEnd      = runStart;
+                while (runEnd < sortedBlocks.size()
+                       && shakeBlockLength(*shaked, sortedBlocks[runEnd]) == blockLength)
+                {
+                    runEnd++;
+                }
+                const size_t numBatches = (runEnd - runStart) / GMX_SIMD_REAL_WIDTH;
+                const size_t batchEnd   = runStart + numBatches * GMX_SIMD_REAL_WIDTH;
+                threadData.simdBatchBlocks.insert(threadData.simdBatchBlocks.end(),
+                                                  sortedBlocks.begin() + runStart,
+                                                  sortedBlocks.begin() + batchEnd);
+                threadData.blocks.insert(threadData.blocks.end(), sortedBlocks.begin() + batchEnd,
+                                         sortedBlocks.begin() + runEnd);
+                runStart = runEnd;
+            }
+            std::sort(threadData.blocks.begin(), threadData.blocks.end());
+        }
+#endif
+    }
+
+    if (debug)
+    {
+        fprintf(debug, "SHAKE: %d blocks, %d constraints, %d threads, independent blocks: %s\n",
+                numBlocks, numConstraints, numThreads,
+                shaked->haveIndependentBlocks ? "yes" : "no");
+        for (int th = 0; th < numThreads; th++)
+        {
+            fprintf(debug, "SHAKE thread %d: %zu blocks in SIMD batches, %zu other blocks\n", th,
+                    shaked->threadData[th].simdBatchBlocks.size(),
+                    shaked->threadData[th].blocks.size());
+        }
+    }
+}
+
 void make_shake_sblock_serial(shakedata* shaked, InteractionDefinitions* idef, const int numAtoms)
 {
     int          i, m, ncons;
@@ -207,6 +303,10 @@ void make_shake_sblock_serial(shakedata* shaked, InteractionDefinitions* idef, c
     sfree(sb);
     sfree(inv_sblock);
     resizeLagrangianData(shaked, ncons);
+
+    /* The blocks are the connected components of the constraint graph */
+    shaked->haveIndependentBlocks = true;
+    setShakeThreadDivision(shaked);
 }
 
 void make_shake_sblock_dd(shakedata* shaked, const InteractionList& ilcon)
@@ -231,6 +331,34 @@ void make_shake_sblock_dd(shakedata* shaked, const InteractionList& ilcon)
     }
     shaked->sblock.push_back(3 * ncons);
     resizeLagrangianData(shaked, ncons);
+
+    /* Blocks here are not guaranteed to be connected components,
+     * check whether atoms occur in multiple blocks.
+     */
+    iatom = ilcon.iatoms.data();
+    int maxAtom = -1;
+    for (c = 0; c < ncons; c++)
+    {
+        maxAtom = std::max(maxAtom, std::max(iatom[3 * c + 1], iatom[3 * c + 2]));
+    }
+    std::vector<int> atomBlock(maxAtom + 1, -1);
+    shaked->haveIndependentBlocks = true;
+    for (int b = 0; b < shaked->numShakeBlocks() && shaked->haveIndependentBlocks; b++)
+    {
+        for (c = shaked->sblock[b] / 3; c < shaked->sblock[b + 1] / 3; c++)
+        {
+            for (int a = 1; a < 3; a++)
+            {
+                const int atom = iatom[3 * c + a];
+                if (atomBlock[atom] >= 0 && atomBlock[atom] != b)
+                {
+                    shaked->haveIndependentBlocks = false;
+                }
+                atomBlock[atom] = b;
+            }
+        }
+    }
+    setShakeThreadDivision(shaked);
 }
 
 /*! \brief Inner kernel for SHAKE constraints
@@ -431,61 +559,226 @@ static void crattle(const int            iatom[],
     *nerror = error;
 }
 
-//! Applies SHAKE
-static int vec_shakef(FILE*                     fplog,
-                      shakedata*                shaked,
-                      const real                invmass[],
-                      int                       ncon,
-                      ArrayRef<const t_iparams> ip,
-                      const int*                iatom,
-                      real                      tol,
-                      ArrayRef<const RVec>      x,
-                      ArrayRef<RVec>            prime,
-                      const t_pbc*              pbc,
-                      real                      omega,
-                      bool                      bFEP,
-                      real                      lambda,
-                      ArrayRef<real>            scaled_lagrange_multiplier,
-                      real                      invdt,
-                      ArrayRef<RVec>            v,
-                      bool                      bCalcVir,
-                      tensor                    vir_r_m_dr,
-                      ConstraintVariable        econq)
+#if GMX_SIMD_HAVE_REAL
+/*! \brief Applies SHAKE to GMX_SIMD_REAL_WIDTH blocks of equal length simultaneously
+ *
+ * Each SIMD lane handles one block, for which it performs exactly the
+ * same iterations as cshake() does. The blocks should not share atoms.
+ * No PBC is applied and the positions should be padded so they can
+ * be loaded in SIMD registers.
+ *
+ * \param[in]    blocks       GMX_SIMD_REAL_WIDTH block indices
+ * \param[in]    blockLength  The number of constraints in each block
+ * \param[in]    iatoms       The constraint iatoms of all blocks
+ * \param[in]    shaked       The SHAKE data, the per constraint setup should have been done
+ * \param[inout] positions    The positions of all atoms
+ * \param[in]    omega        SHAKE over-relaxation factor
+ * \param[in]    invmass      Inverse mass of each atom
+ * \param[inout] scaled_lagrange_multiplier  Scaled Lagrange multiplier for each constraint
+ * \param[inout] threadData   SIMD scratch data
+ * \param[out]   nnit         The number of iterations for each block
+ * \param[out]   nerror       Zero upon success, otherwise one more than the index
+ *                            within the block of the problematic constraint
+ */
+static void cshakeSimdBatch(const int            blocks[],
+                            int                  blockLength,
+                            const int            iatoms[],
+                            const shakedata&     shaked,
+                            ArrayRef<RVec>       positions,
+                            real                 omega,
+                            const real           invmass[],
+                            ArrayRef<real>       scaled_lagrange_multiplier,
+                            ShakeThreadData*     threadData,
+                            int                  nnit[],
+                            int                  nerror[])
 {
-    int  maxnit = 1000;
-    int  nit    = 0, ll, i, j, d, d2, type;
-    real L1;
-    int  error = 0;
-    real constraint_distance;
+    constexpr int c_width = GMX_SIMD_REAL_WIDTH;
+    /* The same tolerance as in cshake() */
+    const real mytol = 1e-10;
 
-    shaked->rij.resize(ncon);
-    shaked->half_of_reduced_mass.resize(ncon);
-    shaked->distance_squared_tolerance.resize(ncon);
-    shaked->constraint_distance_squared.resize(ncon);
+    /* Pack the constraint data in SIMD layout with one lane per block */
+    enum
+    {
+        RijX,
+        RijY,
+        RijZ,
+        HalfOfReducedMass,
+        Tolerance,
+        DistanceSquared,
+        InvMassI,
+        InvMassJ,
+        Lagrange,
+        NumFields
+    };
+    const int numSlots = blockLength * c_width;
+    threadData->simdBuffer.resize(NumFields * numSlots);
+    threadData->simdAtomIndices.resize(2 * numSlots);
+    real*         buffer = threadData->simdBuffer.data();
+    std::int32_t* atomI  = threadData->simdAtomIndices.data();
+    std::int32_t* atomJ  = atomI + numSlots;
+    for (int lane = 0; lane < c_width; lane++)
+    {
+        const int c0 = shaked.sblock[blocks[lane]] / 3;
+        for (int ll = 0; ll < blockLength; ll++)
+        {
+            const int c = c0 + ll;
+            const int s = ll * c_width + lane;
+
+            atomI[s]                                 = iatoms[3 * c + 1];
+            atomJ[s]                                 = iatoms[3 * c + 2];
+            buffer[RijX * numSlots + s]              = shaked.rij[c][XX];
+            buffer[RijY * numSlots + s]              = shaked.rij[c][YY];
+            buffer[RijZ * numSlots + s]              = shaked.rij[c][ZZ];
+            buffer[HalfOfReducedMass * numSlots + s] = shaked.half_of_reduced_mass[c];
+            buffer[Tolerance * numSlots + s]         = shaked.distance_squared_tolerance[c];
+            buffer[DistanceSquared * numSlots + s]   = shaked.constraint_distance_squared[c];
+            buffer[InvMassI * numSlots + s]          = invmass[atomI[s]];
+            buffer[InvMassJ * numSlots + s]          = invmass[atomJ[s]];
+            buffer[Lagrange * numSlots + s]          = 0;
+        }
+    }
+
+    alignas(GMX_SIMD_ALIGNMENT) real activeLanes[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real updatedLanes[c_width];
+    alignas(GMX_SIMD_ALIGNMENT) real errorLanes[c_width];
+    for (int lane = 0; lane < c_width; lane++)
+    {
+        nnit[lane]   = c_shakeMaxIterations;
+        nerror[lane] = 0;
+    }
+
+    real*          x = positions[0];
+    const SimdReal one(1.0_real);
+    const SimdReal zero(0.0_real);
+    const SimdReal omega_S(omega);
+    const SimdReal mytol_S(mytol);
+    SimdBool       active = (zero < one);
+
+    for (int nit = 0; nit < c_shakeMaxIterations && anyTrue(active); nit++)
+    {
+        SimdBool updated = (one < zero);
+        for (int ll = 0; ll < blockLength; ll++)
+        {
+            const int s = ll * c_width;
+
+            SimdReal xi, yi, zi, xj, yj, zj;
+            gatherLoadUTranspose<3>(x, atomI + s, &xi, &yi, &zi);
+            gatherLoadUTranspose<3>(x, atomJ + s, &xj, &yj, &zj);
 
+            const SimdReal rpx = xi - xj;
+            const SimdReal rpy = yi - yj;
+            const SimdReal rpz = zi - zj;
+
+            const SimdReal d2     = load<SimdReal>(buffer + DistanceSquared * numSlots + s);
+            const SimdReal diff   = d2 - norm2(rpx, rpy, rpz);
+            const SimdReal iconvf = abs(diff) * load<SimdReal>(buffer + Tolerance * numSlots + s);
+
+            const SimdReal rijx = load<SimdReal>(buffer + RijX * numSlots + s);
+            const SimdReal rijy = load<SimdReal>(buffer + RijY * numSlots + s);
+            const SimdReal rijz = load<SimdReal>(buffer + RijZ * numSlots + s);
+            const SimdReal rdot = iprod(rijx, rijy, rijz, rpx, rpy, rpz);
+
+            const SimdBool needsUpdate = active && (one < iconvf);
+            const SimdBool isError     = needsUpdate && (rdot < d2 * mytol_S);
+            if (anyTrue(isError))
+            {
+                /* Stop iterating the failing blocks, as cshake() does */
+                store(errorLanes, selectByMask(one, isError));
+                for (int lane = 0; lane < c_width; lane++)
+                {
+                    if (errorLanes[lane] != 0)
+                    {
+                        nerror[lane] = ll + 1;
+                        nnit[lane]   = nit + 1;
+                    }
+                }
+                active = active && ((iconvf <= one) || (d2 * mytol_S <= rdot));
+            }
+            const SimdBool doUpdate = needsUpdate && (d2 * mytol_S <= rdot);
+            updated                 = updated || doUpdate;
+
+            const SimdReal slm = omega_S * diff
+                                 * load<SimdReal>(buffer + HalfOfReducedMass * numSlots + s)
+                                 * maskzInv(rdot, doUpdate);
+            real* lagrange = buffer + Lagrange * numSlots + s;
+            store(lagrange, load<SimdReal>(lagrange) + slm);
+
+            const SimdReal xh = rijx * slm;
+            const SimdReal yh = rijy * slm;
+            const SimdReal zh = rijz * slm;
+            const SimdReal im = load<SimdReal>(buffer + InvMassI * numSlots + s);
+            const SimdReal jm = load<SimdReal>(buffer + InvMassJ * numSlots + s);
+            transposeScatterStoreU<3>(x, atomI + s, xi + xh * im, yi + yh * im, zi + zh * im);
+            transposeScatterStoreU<3>(x, atomJ + s, xj - xh * jm, yj - yh * jm, zj - zh * jm);
+        }
+
+        /* Blocks without updates in this sweep have converged */
+        store(activeLanes, selectByMask(one, active));
+        store(updatedLanes, selectByMask(one, updated));
+        for (int lane = 0; lane < c_width; lane++)
+        {
+            if (activeLanes[lane] != 0 && updatedLanes[lane] == 0)
+            {
+                nnit[lane]        = nit + 1;
+                activeLanes[lane] = 0;
+            }
+        }
+        active = (zero < load<SimdReal>(activeLanes));
+    }
+
+    for (int lane = 0; lane < c_width; lane++)
+    {
+        const int c0 = shaked.sblock[blocks[lane]] / 3;
+        for (int ll = 0; ll < blockLength; ll++)
+        {
+            const int s = ll * c_width + lane;
+            scaled_lagrange_multiplier[c0 + ll] += buffer[Lagrange * numSlots + s];
+        }
+    }
+}
+#endif // GMX_SIMD_HAVE_REAL
+
+/*! \brief Sets the reference vectors, masses and distances for \p ncon constraints
+ *
+ * The constraints start at index \p c0 in the per constraint arrays
+ * of \p shaked, \p iatom points to the first of these constraints.
+ */
+static void setupShakeConstraints(shakedata*                shaked,
+                                  const real                invmass[],
+                                  int                       c0,
+                                  int                       ncon,
+                                  ArrayRef<const t_iparams> ip,
+                                  const int*                iatom,
+                                  real                      tol,
+                                  ArrayRef<const RVec>      x,
+                                  const t_pbc*              pbc,
+                                  bool                      bFEP,
+                                  real                      lambda)
+{
     ArrayRef<RVec> rij                         = shaked->rij;
     ArrayRef<real> half_of_reduced_mass        = shaked->half_of_reduced_mass;
     ArrayRef<real> distance_squared_tolerance  = shaked->distance_squared_tolerance;
     ArrayRef<real> constraint_distance_squared = shaked->constraint_distance_squared;
 
-    L1            = 1.0_real - lambda;
+    const real L1 = 1.0_real - lambda;
     const int* ia = iatom;
-    for (ll = 0; (ll < ncon); ll++, ia += 3)
+    for (int c = c0; c < c0 + ncon; c++, ia += 3)
     {
-        type = ia[0];
-        i    = ia[1];
-        j    = ia[2];
+        const int type = ia[0];
+        const int i    = ia[1];
+        const int j    = ia[2];
 
         if (pbc)
         {
-            pbc_dx(pbc, x[i], x[j], rij[ll]);
+            pbc_dx(pbc, x[i], x[j], rij[c]);
         }
         else
         {
-            rvec_sub(x[i], x[j], rij[ll]);
+            rvec_sub(x[i], x[j], rij[c]);
         }
-        const real mm            = 2.0_real * (invmass[i] + invmass[j]);
-        half_of_reduced_mass[ll] = 1.0_real / mm;
+        const real mm           = 2.0_real * (invmass[i] + invmass[j]);
+        half_of_reduced_mass[c] = 1.0_real / mm;
+        real constraint_distance;
         if (bFEP)
         {
             constraint_distance = L1 * ip[type].constr.dA + lambda * ip[type].constr.dB;
@@ -494,32 +787,24 @@ static int vec_shakef(FILE*                     fplog,
         {
             constraint_distance = ip[type].constr.dA;
         }
-        constraint_distance_squared[ll] = gmx::square(constraint_distance);
-        distance_squared_tolerance[ll]  = 0.5 / (constraint_distance_squared[ll] * tol);
-    }
-
-    switch (econq)
-    {
-        case ConstraintVariable::Positions:
-            cshake(iatom, ncon, &nit, maxnit, constraint_distance_squared, prime, pbc, rij,
-                   half_of_reduced_mass, omega, invmass, distance_squared_tolerance,
-                   scaled_lagrange_multiplier, &error);
-            break;
-        case ConstraintVariable::Velocities:
-            crattle(iatom, ncon, &nit, maxnit, constraint_distance_squared, prime, rij,
-                    half_of_reduced_mass, omega, invmass, distance_squared_tolerance,
-                    scaled_lagrange_multiplier, &error, invdt);
-            break;
-        default: gmx_incons("Unknown constraint quantity for SHAKE");
+        constraint_distance_squared[c] = gmx::square(constraint_distance);
+        distance_squared_tolerance[c]  = 0.5 / (constraint_distance_squared[c] * tol);
     }
+}
 
-    if (nit >= maxnit)
+/*! \brief Reports non-convergence and errors of SHAKE
+ *
+ * \returns \p nit when SHAKE converged without error, 0 otherwise
+ */
+static int checkShakeConvergence(FILE* fplog, int nit, int error, const int* iatom)
+{
+    if (nit >= c_shakeMaxIterations)
     {
         if (fplog)
         {
-            fprintf(fplog, "Shake did not converge in %d steps\n", maxnit);
+            fprintf(fplog, "Shake did not converge in %d steps\n", c_shakeMaxIterations);
         }
-        fprintf(stderr, "Shake did not converge in %d steps\n", maxnit);
+        fprintf(stderr, "Shake did not converge in %d steps\n", c_shakeMaxIterations);
         nit = 0;
     }
     else if (error != 0)
@@ -538,28 +823,47 @@ static int vec_shakef(FILE*                     fplog,
         nit = 0;
     }
 
-    /* Constraint virial and correct the Lagrange multipliers for the length */
+    return nit;
+}
 
-    ia = iatom;
+//! Corrects the velocities, computes the virial and unscales the Lagrange multipliers
+static void finalizeShakeConstraints(const shakedata&          shaked,
+                                     const real                invmass[],
+                                     int                       c0,
+                                     int                       ncon,
+                                     ArrayRef<const t_iparams> ip,
+                                     const int*                iatom,
+                                     bool                      bFEP,
+                                     real                      lambda,
+                                     ArrayRef<real>            scaled_lagrange_multiplier,
+                                     real                      invdt,
+                                     ArrayRef<RVec>            v,
+                                     bool                      bCalcVir,
+                                     tensor                    vir_r_m_dr,
+                                     ConstraintVariable        econq)
+{
+    ArrayRef<const RVec> rij = shaked.rij;
 
-    for (ll = 0; (ll < ncon); ll++, ia += 3)
+    const real L1 = 1.0_real - lambda;
+    const int* ia = iatom;
+    for (int c = c0; c < c0 + ncon; c++, ia += 3)
     {
-        type = ia[0];
-        i    = ia[1];
-        j    = ia[2];
+        const int type = ia[0];
+        const int i    = ia[1];
+        const int j    = ia[2];
 
         if ((econq == ConstraintVariable::Positions) && !v.empty())
         {
             /* Correct the velocities */
-            real mm = scaled_lagrange_multiplier[ll] * invmass[i] * invdt;
-            for (d = 0; d < DIM; d++)
+            real mm = scaled_lagrange_multiplier[c] * invmass[i] * invdt;
+            for (int d = 0; d < DIM; d++)
             {
-                v[ia[1]][d] += mm * rij[ll][d];
+                v[ia[1]][d] += mm * rij[c][d];
             }
-            mm = scaled_lagrange_multiplier[ll] * invmass[j] * invdt;
-            for (d = 0; d < DIM; d++)
+            mm = scaled_lagrange_multiplier[c] * invmass[j] * invdt;
+            for (int d = 0; d < DIM; d++)
             {
-                v[ia[2]][d] -= mm * rij[ll][d];
+                v[ia[2]][d] -= mm * rij[c][d];
             }
             /* 16 flops */
         }
@@ -567,13 +871,13 @@ static int vec_shakef(FILE*                     fplog,
         /* constraint virial */
         if (bCalcVir)
         {
-            const real mm = scaled_lagrange_multiplier[ll];
-            for (d = 0; d < DIM; d++)
+            const real mm = scaled_lagrange_multiplier[c];
+            for (int d = 0; d < DIM; d++)
             {
-                const real tmp = mm * rij[ll][d];
-                for (d2 = 0; d2 < DIM; d2++)
+                const real tmp = mm * rij[c][d];
+                for (int d2 = 0; d2 < DIM; d2++)
                 {
-                    vir_r_m_dr[d][d2] -= tmp * rij[ll][d2];
+                    vir_r_m_dr[d][d2] -= tmp * rij[c][d2];
                 }
             }
             /* 21 flops */
@@ -581,6 +885,7 @@ static int vec_shakef(FILE*                     fplog,
 
         /* cshake and crattle produce Lagrange multipliers scaled by
            the reciprocal of the constraint length, so fix that */
+        real constraint_distance;
         if (bFEP)
         {
             constraint_distance = L1 * ip[type].constr.dA + lambda * ip[type].constr.dB;
@@ -589,9 +894,70 @@ static int vec_shakef(FILE*                     fplog,
         {
             constraint_distance = ip[type].constr.dA;
         }
-        scaled_lagrange_multiplier[ll] *= constraint_distance;
+        scaled_lagrange_multiplier[c] *= constraint_distance;
+    }
+}
+
+/*! \brief Applies SHAKE to a block of \p ncon constraints starting at constraint \p c0
+ *
+ * \returns the number of iterations, 0 when SHAKE failed
+ */
+static int vec_shakef(FILE*                     fplog,
+                      shakedata*                shaked,
+                      const real                invmass[],
+                      int                       c0,
+                      int                       ncon,
+                      ArrayRef<const t_iparams> ip,
+                      const int*                iatom,
+                      real                      tol,
+                      ArrayRef<const RVec>      x,
+                      ArrayRef<RVec>            prime,
+                      const t_pbc*              pbc,
+                      real                      omega,
+                      bool                      bFEP,
+                      real                      lambda,
+                      ArrayRef<real>            scaled_lagrange_multiplier,
+                      real                      invdt,
+                      ArrayRef<RVec>            v,
+                      bool                      bCalcVir,
+                      tensor                    vir_r_m_dr,
+                      ConstraintVariable        econq)
+{
+    int nit   = 0;
+    int error = 0;
+
+    setupShakeConstraints(shaked, invmass, c0, ncon, ip, iatom, tol, x, pbc, bFEP, lambda);
+
+    ArrayRef<const RVec> rij = ArrayRef<const RVec>(shaked->rij).subArray(c0, ncon);
+    ArrayRef<const real> half_of_reduced_mass =
+            ArrayRef<const real>(shaked->half_of_reduced_mass).subArray(c0, ncon);
+    ArrayRef<const real> distance_squared_tolerance =
+            ArrayRef<const real>(shaked->distance_squared_tolerance).subArray(c0, ncon);
+    ArrayRef<const real> constraint_distance_squared =
+            ArrayRef<const real>(shaked->constraint_distance_squared).subArray(c0, ncon);
+    ArrayRef<real> lagrange = scaled_lagrange_multiplier.subArray(c0, ncon);
+
+    switch (econq)
+    {
+        case ConstraintVariable::Positions:
+            cshake(iatom, ncon, &nit, c_shakeMaxIterations, constraint_distance_squared, prime,
+                   pbc, rij, half_of_reduced_mass, omega, invmass, distance_squared_tolerance,
+                   lagrange, &error);
+            break;
+        case ConstraintVariable::Velocities:
+            crattle(iatom, ncon, &nit, c_shakeMaxIterations, constraint_distance_squared, prime,
+                    rij, half_of_reduced_mass, omega, invmass, distance_squared_tolerance,
+                    lagrange, &error, invdt);
+            break;
+        default: gmx_incons("Unknown constraint quantity for SHAKE");
     }
 
+    nit = checkShakeConvergence(fplog, nit, error, iatom);
+
+    /* Constraint virial and correct the Lagrange multipliers for the length */
+    finalizeShakeConstraints(*shaked, invmass, c0, ncon, ip, iatom, bFEP, lambda,
+                             scaled_lagrange_multiplier, invdt, v, bCalcVir, vir_r_m_dr, econq);
+
     return nit;
 }
 
@@ -639,9 +1005,9 @@ static void check_cons(FILE*                     log,
                 break;
             case ConstraintVariable::Velocities:
                 rvec_sub(v[ai], v[aj], dv);
-                d = iprod(dx, dv);
+                d = ::iprod(dx, dv);
                 rvec_sub(prime[ai], prime[aj], dv);
-                dp = iprod(dx, dv);
+                dp = ::iprod(dx, dv);
                 fprintf(log, "%5d  %5.2f  %5d  %5.2f  %10.5f  %10.5f  %10.5f\n", ai + 1,
                         1.0 / invmass[ai], aj + 1, 1.0 / invmass[aj], d, dp, 0.);
                 break;
@@ -650,7 +1016,116 @@ static void check_cons(FILE*                     log,
     }
 }
 
-//! Applies SHAKE.
+/*! \brief Applies SHAKE to the blocks assigned to thread \p th
+ *
+ * Stops at the first block that fails, stores the output in the thread data.
+ */
+static void shakeThreadBlocks(FILE*                         log,
+                              shakedata*                    shaked,
+                              int                           th,
+                              const real                    invmass[],
+                              const InteractionDefinitions& idef,
+                              const t_inputrec&             ir,
+                              ArrayRef<const RVec>          x_s,
+                              ArrayRef<RVec>                prime,
+                              const t_pbc*                  pbc,
+                              real                          lambda,
+                              real                          invdt,
+                              ArrayRef<RVec>                v,
+                              bool                          bCalcVir,
+                              ConstraintVariable            econq)
+{
+    ShakeThreadData& threadData = shaked->threadData[th];
+    clear_mat(threadData.virial);
+    threadData.numIterations = 0;
+    threadData.failedBlock   = -1;
+
+    const int*     iatoms = idef.il[F_CONSTR].iatoms.data();
+    const bool     bFEP   = (ir.efep != efepNO);
+    ArrayRef<real> lam    = shaked->scaled_lagrange_multiplier;
+
+    /* Finalizes the iteration of block b, returns whether it converged */
+    auto blockDone = [&](int b, int nit) {
+        if (nit == 0)
+        {
+            threadData.failedBlock = b;
+            return false;
+        }
+        threadData.numIterations += nit * shakeBlockLength(*shaked, b);
+        return true;
+    };
+
+#if GMX_SIMD_HAVE_REAL
+    const bool          useSimd = (econq == ConstraintVariable::Positions && pbc == nullptr);
+    constexpr int       c_width = GMX_SIMD_REAL_WIDTH;
+    ArrayRef<const int> simdBatchBlocks = threadData.simdBatchBlocks;
+    for (size_t batch = 0; batch < simdBatchBlocks.size(); batch += c_width)
+    {
+        const int* blocks      = simdBatchBlocks.data() + batch;
+        const int  blockLength = shakeBlockLength(*shaked, blocks[0]);
+        int        nit[c_width];
+        int        error[c_width];
+        if (useSimd)
+        {
+            for (int lane = 0; lane < c_width; lane++)
+            {
+                const int c0 = shaked->sblock[blocks[lane]] / 3;
+                setupShakeConstraints(shaked, invmass, c0, blockLength, idef.iparams,
+                                      iatoms + 3 * c0, ir.shake_tol, x_s, pbc, bFEP, lambda);
+            }
+            cshakeSimdBatch(blocks, blockLength, iatoms, *shaked, prime, shaked->omega, invmass,
+                            lam, &threadData, nit, error);
+        }
+        bool batchConverged = true;
+        for (int lane = 0; lane < c_width; lane++)
+        {
+            const int  c0         = shaked->sblock[blocks[lane]] / 3;
+            const int* blockAtoms = iatoms + 3 * c0;
+            int        n0;
+            if (useSimd)
+            {
+                n0 = checkShakeConvergence(log, nit[lane], error[lane], blockAtoms);
+                finalizeShakeConstraints(*shaked, invmass, c0, blockLength, idef.iparams,
+                                         blockAtoms, bFEP, lambda, lam, invdt, v, bCalcVir,
+                                         threadData.virial, econq);
+            }
+            else
+            {
+                n0 = vec_shakef(log, shaked, invmass, c0, blockLength, idef.iparams, blockAtoms,
+                                ir.shake_tol, x_s, prime, pbc, shaked->omega, bFEP, lambda, lam,
+                                invdt, v, bCalcVir, threadData.virial, econq);
+            }
+            if (batchConverged && !blockDone(blocks[lane], n0))
+            {
+                batchConverged = false;
+            }
+        }
+        if (!batchConverged)
+        {
+            return;
+        }
+    }
+#endif
+
+    for (int b : threadData.blocks)
+    {
+        const int c0 = shaked->sblock[b] / 3;
+        const int n0 = vec_shakef(log, shaked, invmass, c0, shakeBlockLength(*shaked, b),
+                                  idef.iparams, iatoms + 3 * c0, ir.shake_tol, x_s, prime, pbc,
+                                  shaked->omega, bFEP, lambda, lam, invdt, v, bCalcVir,
+                                  threadData.virial, econq);
+        if (!blockDone(b, n0))
+        {
+            return;
+        }
+    }
+}
+
+/*! \brief Applies SHAKE.
+ *
+ * The blocks are divided over threads. When blocks share atoms, they
+ * are all processed in order by a single thread.
+ */
 static bool bshakef(FILE*                         log,
                     shakedata*                    shaked,
                     const real                    invmass[],
@@ -670,7 +1145,7 @@ static bool bshakef(FILE*                         log,
                     ConstraintVariable            econq)
 {
     real dt_2, dvdl;
-    int  i, n0, ncon, blen, type, ll;
+    int  ncon, type, ll;
     int  tnit = 0, trij = 0;
 
     ncon = idef.il[F_CONSTR].size() / 3;
@@ -679,36 +1154,50 @@ static bool bshakef(FILE*                         log,
     {
         shaked->scaled_lagrange_multiplier[ll] = 0;
     }
+    shaked->rij.resize(ncon);
+    shaked->half_of_reduced_mass.resize(ncon);
+    shaked->distance_squared_tolerance.resize(ncon);
+    shaked->constraint_distance_squared.resize(ncon);
 
-    // TODO Rewrite this block so that it is obvious that i, iatoms
-    // and lam are all iteration variables. Is this easier if the
-    // sblock data structure is organized differently?
-    const int*     iatoms = &(idef.il[F_CONSTR].iatoms[shaked->sblock[0]]);
-    ArrayRef<real> lam    = shaked->scaled_lagrange_multiplier;
-    for (i = 0; (i < shaked->numShakeBlocks());)
+    GMX_ASSERT(!shaked->threadData.empty(), "The SHAKE blocks should be divided over threads");
+    const int numThreads = shaked->threadData.size();
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int th = 0; th < numThreads; th++)
     {
-        blen = (shaked->sblock[i + 1] - shaked->sblock[i]);
-        blen /= 3;
-        n0 = vec_shakef(log, shaked, invmass, blen, idef.iparams, iatoms, ir.shake_tol, x_s, prime,
-                        pbc, shaked->omega, ir.efep != efepNO, lambda, lam, invdt, v, bCalcVir,
-                        vir_r_m_dr, econq);
+        try
+        {
+            shakeThreadBlocks(log, shaked, th, invmass, idef, ir, x_s, prime, pbc, lambda, invdt,
+                              v, bCalcVir, econq);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
 
-        if (n0 == 0)
+    int failedBlock = -1;
+    for (const ShakeThreadData& threadData : shaked->threadData)
+    {
+        if (threadData.failedBlock >= 0
+            && (failedBlock < 0 || threadData.failedBlock < failedBlock))
         {
-            if (bDumpOnError && log)
-            {
-                {
-                    check_cons(log, blen, x_s, prime, v, pbc, idef.iparams, iatoms, invmass, econq);
-                }
-            }
-            return FALSE;
+            failedBlock = threadData.failedBlock;
         }
-        tnit += n0 * blen;
-        trij += blen;
-        iatoms += 3 * blen; /* Increment pointer! */
-        lam = lam.subArray(blen, lam.ssize() - blen);
-        i++;
+        if (bCalcVir)
+        {
+            m_add(vir_r_m_dr, threadData.virial, vir_r_m_dr);
+        }
+        tnit += threadData.numIterations;
+    }
+    if (failedBlock >= 0)
+    {
+        if (bDumpOnError && log)
+        {
+            const int blen = shakeBlockLength(*shaked, failedBlock);
+            check_cons(log, blen, x_s, prime, v, pbc, idef.iparams,
+                       &(idef.il[F_CONSTR].iatoms[shaked->sblock[failedBlock]]), invmass, econq);
+        }
+        return FALSE;
     }
+    trij = ncon;
+
     /* only for position part? */
     if (econq == ConstraintVariable::Positions)
     {
@@ -45,8 +45,13 @@
 #ifndef GMX_MDLIB_SHAKE_H
 #define GMX_MDLIB_SHAKE_H
 
+#include <cstdint>
+
+#include <vector>
+
 #include "gromacs/math/vec.h"
 #include "gromacs/topology/block.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/real.h"
 
 struct InteractionList;
@@ -62,6 +67,30 @@ class ArrayRef;
 
 enum class ConstraintVariable : int;
 
+/*! \libinternal
+ * \brief The SHAKE blocks assigned to a thread, scratch data and output of the thread
+ */
+struct ShakeThreadData
+{
+    /*! \brief Blocks processed together in SIMD batches
+     *
+     * Consists of consecutive batches of GMX_SIMD_REAL_WIDTH blocks
+     * with equal numbers of constraints. */
+    std::vector<int> simdBatchBlocks;
+    //! The other blocks of this thread, processed one at a time
+    std::vector<int> blocks;
+    //! SIMD scratch data for the constraint parameters and Lagrange multipliers of a batch
+    std::vector<real, AlignedAllocator<real>> simdBuffer;
+    //! SIMD scratch data for the atom indices of a batch
+    std::vector<std::int32_t, AlignedAllocator<std::int32_t>> simdAtomIndices;
+    //! The constraint virial contribution of this thread
+    tensor virial = { { 0 } };
+    //! The sum over blocks of the number of iterations times the number of constraints
+    int numIterations = 0;
+    //! The block that failed to converge, -1 when all blocks converged
+    int failedBlock = -1;
+};
+
 /*! \libinternal
  * \brief Working data for the SHAKE algorithm
  */
@@ -92,6 +121,10 @@ struct shakedata
      * Value is -2 * eta from p. 336 of the paper, divided by the
      * constraint distance. */
     std::vector<real> scaled_lagrange_multiplier;
+    //! Whether no atom occurs in more than one block, so blocks can be processed concurrently
+    bool haveIndependentBlocks = true;
+    //! The division of the blocks over the threads
+    std::vector<ShakeThreadData> threadData;
 };
 
 //! Make SHAKE blocks when not using DD.
@@ -44,6 +44,7 @@
 #include <cstring>
 
 #include <array>
+#include <optional>
 
 #include "gromacs/awh/awh.h"
 #include "gromacs/domdec/dlbtiming.h"
@@ -90,6 +91,7 @@
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/multipletimestepping.h"
 #include "gromacs/mdtypes/simulation_workload.h"
 #include "gromacs/mdtypes/state.h"
 #include "gromacs/mdtypes/state_propagator_data_gpu.h"
@@ -124,6 +126,7 @@ using gmx::AtomLocality;
 using gmx::DomainLifetimeWorkload;
 using gmx::ForceOutputs;
 using gmx::ForceWithShiftForces;
+using gmx::ForceWithVirial;
 using gmx::InteractionLocality;
 using gmx::RVec;
 using gmx::SimulationWorkload;
@@ -390,6 +393,54 @@ static void postProcessForces(const t_commrec*          cr,
     }
 }
 
+/*! \brief Spreads and adds the slow MTS forces to the normal forces and sets the combined forces
+ *
+ * On return \p forceMtsCombined contains the normal force plus \p mtsFactor times the slow
+ * force and the slow force and its virial have been added to \p force and \p vir_force.
+ */
+static void combineMtsForces(t_nrnb*                   nrnb,
+                             gmx_wallcycle_t           wcycle,
+                             const matrix              box,
+                             ArrayRef<const RVec>      x,
+                             ForceWithVirial*          forceWithVirialMtsLevel1,
+                             ArrayRef<RVec>            force,
+                             tensor                    vir_force,
+                             const t_mdatoms&          mdatoms,
+                             const int                 mtsFactor,
+                             ArrayRef<RVec>            forceMtsCombined,
+                             gmx::VirtualSitesHandler* vsite,
+                             const StepWorkload&       stepWork)
+{
+    ArrayRef<RVec> forceMtsLevel1 = forceWithVirialMtsLevel1->force_;
+
+    if (vsite)
+    {
+        const gmx::VirtualSitesHandler::VirialHandling virialHandling =
+                (stepWork.computeVirial ? gmx::VirtualSitesHandler::VirialHandling::NonLinear
+                                        : gmx::VirtualSitesHandler::VirialHandling::None);
+        matrix virial = { { 0 } };
+        vsite->spreadForces(x, forceMtsLevel1, virialHandling, {}, virial, nrnb, box, wcycle);
+        forceWithVirialMtsLevel1->addVirialContribution(virial);
+    }
+
+    if (stepWork.computeVirial)
+    {
+        m_add(vir_force, forceWithVirialMtsLevel1->getVirial(), vir_force);
+    }
+
+    const int  numAtoms  = mdatoms.homenr;
+    const real factorMts = mtsFactor;
+
+    int gmx_unused nt = gmx_omp_nthreads_get(emntDefault);
+#pragma omp parallel for num_threads(nt) schedule(static)
+    for (int i = 0; i < numAtoms; i++)
+    {
+        const RVec forceSlow = forceMtsLevel1[i];
+        forceMtsCombined[i]  = force[i] + factorMts * forceSlow;
+        force[i] += forceSlow;
+    }
+}
+
 static void do_nb_verlet(t_forcerec*                fr,
                          const interaction_const_t* ic,
                          gmx_enerdata_t*            enerd,
@@ -589,6 +640,8 @@ static bool haveSpecialForces(const t_inputrec&          inputrec,
  * \param[in]     lambda           Array of free-energy lambda values
  * \param[in]     stepWork         Step schedule flags
  * \param[in,out] forceWithVirial  Force and virial buffers
+ * \param[in,out] forceWithVirialMtsLevel1  Force and virial buffers for the slow MTS forces,
+ *                                 nullptr when not computing the slow forces with MTS
  * \param[in,out] enerd            Energy buffer
  * \param[in,out] ed               Essential dynamics pointer
  * \param[in]     didNeighborSearch Tells if we did neighbor searching this step, used for ED sampling
@@ -613,6 +666,7 @@ static void computeSpecialForces(FILE*                          fplog,
                                  gmx::ArrayRef<const real>      lambda,
                                  const StepWorkload&            stepWork,
                                  gmx::ForceWithVirial*          forceWithVirial,
+                                 gmx::ForceWithVirial*          forceWithVirialMtsLevel1,
                                  gmx_enerdata_t*                enerd,
                                  gmx_edsam*                     ed,
                                  bool                           didNeighborSearch)
@@ -629,15 +683,24 @@ static void computeSpecialForces(FILE*                          fplog,
         forceProviders->calculateForces(forceProviderInput, &forceProviderOutput);
     }
 
-    if (inputrec->bPull && pull_have_potential(pull_work))
+    /* With MTS, pulling and AWH are only applied on slow steps. Note that
+     * grompp ensures that pulling and AWH are in the same MTS level.
+     */
+    const bool pullIsSlow = (gmx::forceGroupMtsFactor(*inputrec, gmx::MtsForceGroups::Pull) > 1);
+    if (inputrec->bPull && pull_have_potential(pull_work)
+        && (!pullIsSlow || stepWork.computeSlowForces))
     {
-        pull_potential_wrapper(cr, inputrec, box, x, forceWithVirial, mdatoms, enerd, pull_work,
-                               lambda.data(), t, wcycle);
+        gmx::ForceWithVirial* forceWithVirialPull =
+                (pullIsSlow ? forceWithVirialMtsLevel1 : forceWithVirial);
+
+        pull_potential_wrapper(cr, inputrec, box, x, forceWithVirialPull, mdatoms, enerd,
+                               pull_work, lambda.data(), t, wcycle);
 
         if (awh)
         {
-            enerd->term[F_COM_PULL] += awh->applyBiasForcesAndUpdateBias(
-                    inputrec->pbcType, mdatoms->massT, box, forceWithVirial, t, step, wcycle, fplog);
+            enerd->term[F_COM_PULL] +=
+                    awh->applyBiasForcesAndUpdateBias(inputrec->pbcType, mdatoms->massT, box,
+                                                      forceWithVirialPull, t, step, wcycle, fplog);
         }
     }
 
@@ -864,13 +927,17 @@ static DomainLifetimeWorkload setupDomainLifetimeWorkload(const t_inputrec&
  * \param[in]      isNonbondedOn        Global override, if false forces to turn off all nonbonded calculation.
  * \param[in]      simulationWork       Simulation workload description.
  * \param[in]      rankHasPmeDuty       If this rank computes PME.
+ * \param[in]      inputrec             The input record, for the MTS settings.
+ * \param[in]      step                 The current MD step.
  *
  * \returns New Stepworkload description.
  */
 static StepWorkload setupStepWorkload(const int                 legacyFlags,
                                       const bool                isNonbondedOn,
                                       const SimulationWorkload& simulationWork,
-                                      const bool                rankHasPmeDuty)
+                                      const bool                rankHasPmeDuty,
+                                      const t_inputrec&         inputrec,
+                                      const int64_t             step)
 {
     StepWorkload flags;
     flags.stateChanged           = ((legacyFlags & GMX_FORCE_STATECHANGED) != 0);
@@ -882,6 +949,9 @@ static StepWorkload setupStepWorkload(const int                 legacyFlags,
     flags.computeListedForces    = ((legacyFlags & GMX_FORCE_LISTED) != 0);
     flags.computeNonbondedForces = ((legacyFlags & GMX_FORCE_NONBONDED) != 0) && isNonbondedOn;
     flags.computeDhdl            = ((legacyFlags & GMX_FORCE_DHDL) != 0);
+    flags.computeSlowForces =
+            (!inputrec.useMts
+             || step % inputrec.mtsLevels[gmx::c_numMtsLevels - 1].stepFactor == 0);
 
     if (simulationWork.useGpuBufferOps)
     {
@@ -1033,12 +1103,19 @@ void do_force(FILE*                               fplog,
 
 
     runScheduleWork->stepWork    = setupStepWorkload(legacyFlags, fr->bNonbonded, simulationWork,
-                                                  thisRankHasDuty(cr, DUTY_PME));
+                                                  thisRankHasDuty(cr, DUTY_PME), *inputrec, step);
     const StepWorkload& stepWork = runScheduleWork->stepWork;
 
 
     const bool useGpuPmeOnThisRank = simulationWork.useGpuPme && thisRankHasDuty(cr, DUTY_PME);
 
+    /* With MTS and long-range nonbonded interactions in the slow level,
+     * PME is only computed, also on separate PME ranks, on slow steps.
+     */
+    const bool computeLongRangeForces =
+            (stepWork.computeSlowForces
+             || gmx::forceGroupMtsFactor(*inputrec, gmx::MtsForceGroups::LongrangeNonbonded) == 1);
+
     /* At a search step we need to start the first balancing region
      * somewhere early inside the step after communication during domain
      * decomposition (and not during the previous step as usual).
@@ -1061,7 +1138,17 @@ void do_force(FILE*                               fplog,
         }
 
         const bool fillGrid = (stepWork.doNeighborSearch && stepWork.stateChanged);
-        const bool calcCGCM = (fillGrid && !DOMAINDECOMP(cr));
+        /* With incremental grid updates the atoms keep their grid cells,
+         * so we should not put them back in the box. Note that this check
+         * also prepares the grid for an incremental update at this step.
+         */
+        bool updateGridIncrementally = false;
+        if (fillGrid && !DOMAINDECOMP(cr))
+        {
+            updateGridIncrementally = nbv->canUpdateLocalGridIncrementally(
+                    box, x.unpaddedArrayRef().subArray(0, mdatoms->homenr));
+        }
+        const bool calcCGCM = (fillGrid && !DOMAINDECOMP(cr) && !updateGridIncrementally);
         if (calcCGCM)
         {
             put_atoms_in_box_omp(fr->pbcType, box, x.unpaddedArrayRef().subArray(0, mdatoms->homenr),
@@ -1084,7 +1171,8 @@ void do_force(FILE*                               fplog,
 
     // If coordinates are to be sent to PME task from CPU memory, perform that send here.
     // Otherwise the send will occur after H2D coordinate transfer.
-    if (GMX_MPI && !thisRankHasDuty(cr, DUTY_PME) && !pmeSendCoordinatesFromGpu)
+    if (GMX_MPI && !thisRankHasDuty(cr, DUTY_PME) && !pmeSendCoordinatesFromGpu
+        && computeLongRangeForces)
     {
         /* Send particle coordinates to the pme nodes */
         if (!stepWork.doNeighborSearch && simulationWork.useGpuUpdate)
@@ -1162,7 +1250,7 @@ void do_force(FILE*                               fplog,
 
     // If coordinates are to be sent to PME task from GPU memory, perform that send here.
     // Otherwise the send will occur before the H2D coordinate transfer.
-    if (!thisRankHasDuty(cr, DUTY_PME) && pmeSendCoordinatesFromGpu)
+    if (!thisRankHasDuty(cr, DUTY_PME) && pmeSendCoordinatesFromGpu && computeLongRangeForces)
     {
         /* Send particle coordinates to the pme nodes */
         gmx_pme_send_coordinates(fr, cr, box, as_rvec_array(x.unpaddedArrayRef().data()), lambda[efptCOUL],
@@ -1211,6 +1299,12 @@ void do_force(FILE*                               fplog,
             wallcycle_sub_stop(wcycle, ewcsNBS_GRID_NONLOCAL);
         }
 
+        if (fplog != nullptr)
+        {
+            // Only prints at the first search and with the effective grid density
+            nbv->printGridPaddingStatistics(fplog, false);
+        }
+
         nbv->setAtomProperties(gmx::constArrayRefFromArray(mdatoms->typeA, mdatoms->nr),
                                gmx::constArrayRefFromArray(mdatoms->chargeA, mdatoms->nr), fr->cginfo);
 
@@ -1333,6 +1427,16 @@ void do_force(FILE*                               fplog,
         launchPmeGpuFftAndGather(fr->pmedata, wcycle, stepWork);
     }
 
+    const bool useOrEmulateGpuNb = simulationWork.useGpuNonbonded || fr->nbv->emulateGpu();
+
+    /* With CPU non-bonded work, the coordinate halo exchange can be overlapped
+     * with the local non-bonded kernel. The exchange is then finished and the
+     * non-local coordinates are converted after that kernel.
+     */
+    const bool overlapMoveXWithLocalNonbonded =
+            (havePPDomainDecomposition(cr) && !stepWork.doNeighborSearch && !useOrEmulateGpuNb
+             && !ddUsesGpuDirectCommunication && ddUsesNonBlockingMoveX(*cr->dd));
+
     /* Communicate coordinates and sum dipole if necessary +
        do non-local pair search */
     if (havePPDomainDecomposition(cr))
@@ -1377,7 +1481,14 @@ void do_force(FILE*                               fplog,
                 // a waitCoordinatesReadyOnHost() should be issued if it will be.
                 GMX_ASSERT(!simulationWork.useGpuUpdate,
                            "GPU update is not supported with CPU halo exchange");
-                dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                if (overlapMoveXWithLocalNonbonded)
+                {
+                    dd_move_x_start(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
+                else
+                {
+                    dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
             }
 
             if (stepWork.useGpuXBufferOps)
@@ -1390,7 +1501,7 @@ void do_force(FILE*                               fplog,
                                            stateGpu->getCoordinatesReadyOnDeviceEvent(
                                                    AtomLocality::NonLocal, simulationWork, stepWork));
             }
-            else
+            else if (!overlapMoveXWithLocalNonbonded)
             {
                 nbv->convertCoordinates(AtomLocality::NonLocal, false, x.unpaddedArrayRef());
             }
@@ -1502,6 +1613,19 @@ void do_force(FILE*                               fplog,
     ForceOutputs forceOut = setupForceOutputs(fr->forceHelperBuffers.get(), pull_work, *inputrec,
                                               std::move(force), stepWork, wcycle);
 
+    /* With MTS the slow forces are computed, on slow steps only, in a separate buffer */
+    std::optional<ForceWithVirial> forceWithVirialMtsLevel1;
+    if (fr->useMts && stepWork.computeSlowForces)
+    {
+        forceWithVirialMtsLevel1.emplace(fr->forceHelperBuffers->forceBufferMtsLevel1(),
+                                         stepWork.computeVirial);
+        wallcycle_sub_start(wcycle, ewcsCLEAR_FORCE_BUFFER);
+        clearRVecs(forceWithVirialMtsLevel1->force_, true);
+        wallcycle_sub_stop(wcycle, ewcsCLEAR_FORCE_BUFFER);
+    }
+    ForceWithVirial* forceWithVirialMtsLevel1Ptr =
+            (forceWithVirialMtsLevel1 ? &forceWithVirialMtsLevel1.value() : nullptr);
+
     /* We calculate the non-bonded forces, when done on the CPU, here.
      * We do this before calling do_force_lowlevel, because in that
      * function, the listed forces are calculated before PME, which
@@ -1510,13 +1634,19 @@ void do_force(FILE*                               fplog,
      * decomposition load balancing.
      */
 
-    const bool useOrEmulateGpuNb = simulationWork.useGpuNonbonded || fr->nbv->emulateGpu();
-
     if (!useOrEmulateGpuNb)
     {
         do_nb_verlet(fr, ic, enerd, stepWork, InteractionLocality::Local, enbvClearFYes, step, nrnb, wcycle);
     }
 
+    if (overlapMoveXWithLocalNonbonded)
+    {
+        wallcycle_stop(wcycle, ewcFORCE);
+        dd_move_x_finish(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+        nbv->convertCoordinates(AtomLocality::NonLocal, false, x.unpaddedArrayRef());
+        wallcycle_start_nocount(wcycle, ewcFORCE);
+    }
+
     if (fr->efep != efepNO)
     {
         /* Calculate the local and non-local free energy interactions here.
@@ -1573,14 +1703,15 @@ void do_force(FILE*                               fplog,
     }
     /* Compute the bonded and non-bonded energies and optionally forces */
     do_force_lowlevel(fr, inputrec, cr, ms, nrnb, wcycle, mdatoms, x, xWholeMolecules, hist,
-                      &forceOut, enerd, box, lambda.data(), as_rvec_array(dipoleData.muStateAB),
-                      stepWork, ddBalanceRegionHandler);
+                      &forceOut, forceWithVirialMtsLevel1Ptr, enerd, box, lambda.data(),
+                      as_rvec_array(dipoleData.muStateAB), stepWork, ddBalanceRegionHandler);
 
     wallcycle_stop(wcycle, ewcFORCE);
 
     computeSpecialForces(fplog, cr, inputrec, awh, enforcedRotation, imdSession, pull_work, step, t,
                          wcycle, fr->forceProviders, box, x.unpaddedArrayRef(), mdatoms, lambda,
-                         stepWork, &forceOut.forceWithVirial(), enerd, ed, stepWork.doNeighborSearch);
+                         stepWork, &forceOut.forceWithVirial(), forceWithVirialMtsLevel1Ptr, enerd,
+                         ed, stepWork.doNeighborSearch);
 
 
     // Will store the amount of cycles spent waiting for the GPU that
@@ -1735,7 +1866,7 @@ void do_force(FILE*                               fplog,
 
     // If on GPU PME-PP comms or GPU update path, receive forces from PME before GPU buffer ops
     // TODO refactor this and unify with below default-path call to the same function
-    if (PAR(cr) && !thisRankHasDuty(cr, DUTY_PME)
+    if (PAR(cr) && !thisRankHasDuty(cr, DUTY_PME) && computeLongRangeForces
         && (simulationWork.useGpuPmePpCommunication || simulationWork.useGpuUpdate))
     {
         /* In case of node-splitting, the PP nodes receive the long-range
@@ -1865,12 +1996,16 @@ void do_force(FILE*                               fplog,
 
     // TODO refactor this and unify with above GPU PME-PP / GPU update path call to the same function
     if (PAR(cr) && !thisRankHasDuty(cr, DUTY_PME) && !simulationWork.useGpuPmePpCommunication
-        && !simulationWork.useGpuUpdate)
+        && !simulationWork.useGpuUpdate && computeLongRangeForces)
     {
         /* In case of node-splitting, the PP nodes receive the long-range
          * forces, virial and energy from the PME nodes here.
          */
-        pme_receive_force_ener(fr, cr, &forceOut.forceWithVirial(), enerd,
+        const bool longRangeIsSlow =
+                (gmx::forceGroupMtsFactor(*inputrec, gmx::MtsForceGroups::LongrangeNonbonded) > 1);
+        gmx::ForceWithVirial* forceWithVirialPme =
+                longRangeIsSlow ? forceWithVirialMtsLevel1Ptr : &forceOut.forceWithVirial();
+        pme_receive_force_ener(fr, cr, forceWithVirialPme, enerd,
                                simulationWork.useGpuPmePpCommunication, false, wcycle);
     }
 
@@ -1878,6 +2013,15 @@ void do_force(FILE*                               fplog,
     {
         postProcessForces(cr, step, nrnb, wcycle, box, x.unpaddedArrayRef(), &forceOut, vir_force,
                           mdatoms, fr, vsite, stepWork);
+
+        if (forceWithVirialMtsLevel1)
+        {
+            combineMtsForces(nrnb, wcycle, box, x.unpaddedArrayRef(), forceWithVirialMtsLevel1Ptr,
+                             forceOut.forceWithShiftForces().force(), vir_force, *mdatoms,
+                             inputrec->mtsLevels[gmx::c_numMtsLevels - 1].stepFactor,
+                             fr->forceHelperBuffers->forceMtsCombined().unpaddedArrayRef(), vsite,
+                             stepWork);
+        }
     }
 
     if (stepWork.computeEnergy)
@@ -45,6 +45,16 @@
 
 #include <gtest/gtest.h>
 
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/mdlib/constr.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/topology/forcefieldparameters.h"
+#include "gromacs/topology/idef.h"
 #include "gromacs/utility/arrayref.h"
 
 #include "testutils/refdata.h"
@@ -338,5 +348,142 @@ TEST_F(ShakeTest, ConstrainsThreeBondsWithCommonAtoms)
     runTest(numAtoms, numConstraints, iatom, constrainedDistances, inverseMasses, positions);
 }
 
+TEST_F(ShakeTest, ThreadedBlocksGiveSameResultsAsSerialShake)
+{
+    /* Many blocks of equal lengths are needed for using SIMD batches,
+     * the remaining blocks are processed one at a time.
+     */
+    const int  numBlocks       = 200;
+    const real bondLength      = 0.1;
+    const real displacementMax = 0.01;
+
+    gmx_ffparams_t ffparams;
+    ffparams.functype.push_back(F_CONSTR);
+    ffparams.iparams.resize(1);
+    ffparams.iparams[0].constr.dA = bondLength;
+    ffparams.iparams[0].constr.dB = bondLength;
+    InteractionDefinitions idef(ffparams);
+
+    /* Zig-zag chains of four atoms with three constraints and single bonds */
+    std::vector<RVec> xInitial;
+    std::vector<real> inverseMasses;
+    for (int b = 0; b < numBlocks; b++)
+    {
+        const int  numChainAtoms = (b % 3 == 2 ? 2 : 4);
+        const RVec origin(0.5 * (b % 5), 0.5 * ((b / 5) % 5), 0.5 * (b / 25));
+        for (int a = 0; a < numChainAtoms; a++)
+        {
+            const int atom = xInitial.size();
+            if (a > 0)
+            {
+                idef.il[F_CONSTR].push_back(0, std::array<int, 2>{ { atom - 1, atom } });
+            }
+            const real zigZagX = a * std::sqrt(0.75_real) * bondLength;
+            const real zigZagY = (a % 2) * 0.5_real * bondLength;
+            xInitial.push_back(origin + RVec(zigZagX, zigZagY, 0));
+            inverseMasses.push_back(inverseMassesDatabase_[a]);
+        }
+    }
+
+    DefaultRandomEngine           rng(1234);
+    UniformRealDistribution<real> dist(-displacementMax, displacementMax);
+    const int                     numAtoms = xInitial.size();
+    PaddedVector<RVec>            x(numAtoms);
+    PaddedVector<RVec>            xPrime(numAtoms);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        x[a] = xInitial[a];
+        for (int d = 0; d < DIM; d++)
+        {
+            xPrime[a][d] = x[a][d] + dist(rng);
+        }
+    }
+
+    t_inputrec ir;
+    ir.efep      = efepNO;
+    ir.shake_tol = tolerance_;
+
+    shakedata shaked;
+    gmx_omp_nthreads_set(emntLINCS, 3);
+    make_shake_sblock_serial(&shaked, &idef, numAtoms);
+    ASSERT_EQ(numBlocks, shaked.numShakeBlocks());
+
+    /* Reference: serial cshake() on each block */
+    std::vector<RVec> xReference(xPrime.begin(), xPrime.end());
+    std::vector<real> lagrangeReference;
+    double            numIterationsReference = 0;
+    for (int b = 0; b < numBlocks; b++)
+    {
+        const std::vector<int> blockIatoms(
+                idef.il[F_CONSTR].iatoms.begin() + shaked.sblock[b],
+                idef.il[F_CONSTR].iatoms.begin() + shaked.sblock[b + 1]);
+        const int numConstraints = blockIatoms.size() / constraintStride;
+
+        std::vector<RVec> displacements = computeDisplacements(blockIatoms, xInitial);
+        std::vector<real> halfOfReducedMasses =
+                computeHalfOfReducedMasses(blockIatoms, inverseMasses);
+        std::vector<real> distancesSquared(numConstraints, bondLength * bondLength);
+        std::vector<real> distanceSquaredTolerances(
+                numConstraints, 0.5 / (bondLength * bondLength * tolerance_));
+        std::vector<real> lagrange(numConstraints, 0);
+        int               numIterations = 0;
+        int               numErrors     = 0;
+        cshake(blockIatoms.data(), numConstraints, &numIterations, 1000, distancesSquared,
+               xReference, nullptr, displacements, halfOfReducedMasses, omega_,
+               inverseMasses.data(), distanceSquaredTolerances, lagrange, &numErrors);
+        ASSERT_EQ(0, numErrors);
+        numIterationsReference += numIterations * numConstraints;
+        for (real l : lagrange)
+        {
+            lagrangeReference.push_back(l * bondLength);
+        }
+    }
+
+    t_nrnb nrnb;
+    real   dvdlambda = 0;
+    tensor virial    = { { 0 } };
+    bool   success   = constrain_shake(nullptr, &shaked, inverseMasses.data(), idef, ir,
+                                   x.arrayRefWithPadding().unpaddedArrayRef(),
+                                   xPrime.arrayRefWithPadding().unpaddedArrayRef(), {}, nullptr,
+                                   &nrnb, 0, &dvdlambda, 1.0, {}, true, virial, false,
+                                   ConstraintVariable::Positions);
+    gmx_omp_nthreads_set(emntLINCS, 1);
+    ASSERT_TRUE(success);
+
+    /* The number of iterations per block should be identical */
+    EXPECT_EQ(numIterationsReference, nrnb.n[eNR_SHAKE]);
+
+    test::FloatingPointTolerance tolerance = test::absoluteTolerance(1e-6);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(xReference[a][d], xPrime[a][d], tolerance);
+        }
+    }
+    tensor virialReference = { { 0 } };
+    for (int c = 0; c < idef.il[F_CONSTR].size() / 3; c++)
+    {
+        EXPECT_REAL_EQ_TOL(lagrangeReference[c], shaked.scaled_lagrange_multiplier[c], tolerance);
+        const int  i  = idef.il[F_CONSTR].iatoms[3 * c + 1];
+        const int  j  = idef.il[F_CONSTR].iatoms[3 * c + 2];
+        const RVec dx = x[i] - x[j];
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int d2 = 0; d2 < DIM; d2++)
+            {
+                virialReference[d][d2] -= lagrangeReference[c] / bondLength * dx[d] * dx[d2];
+            }
+        }
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_REAL_EQ_TOL(virialReference[d][d2], virial[d][d2], tolerance);
+        }
+    }
+}
+
 } // namespace
 } // namespace gmx
@@ -0,0 +1,208 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the asynchronous trajectory writer thread
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/mdlib/trajectorywriterthread.h"
+
+#include "config.h"
+
+#include <vector>
+
+#if HAVE_SCHED_AFFINITY
+#    include <sched.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/arrayref.h"
+
+namespace gmx
+{
+
+namespace test
+{
+namespace
+{
+
+//! A frame as seen by the write function
+struct WrittenFrame
+{
+    //! The step
+    int64_t step;
+    //! The coordinates
+    std::vector<RVec> x;
+    //! Whether velocities were present
+    bool haveV;
+    //! Whether forces were present
+    bool haveF;
+};
+
+//! Writes \p numFrames frames with coordinates that depend on the step and returns what was written
+std::vector<WrittenFrame> writeFrames(int numFrames, bool waitAfterEachFrame)
+{
+    std::vector<WrittenFrame> writtenFrames;
+
+    {
+        TrajectoryWriterThread writer(
+                [&writtenFrames](const TrajectoryOutputFrame& frame) {
+                    writtenFrames.push_back({ frame.step,
+                                              { frame.x.begin(), frame.x.end() },
+                                              !frame.v.empty(),
+                                              !frame.f.empty() });
+                },
+                nullptr);
+
+        std::vector<RVec> x(3);
+        for (int step = 0; step < numFrames; step++)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                x[i] = { real(step), real(i), real(-step) };
+            }
+            TrajectoryOutputFrame* frame = writer.getFreeFrame();
+            frame->step                  = step;
+            frame->copyToBuffers(x, {}, {});
+            writer.submitFrame(frame);
+            // Changing the source after submission should not affect the written frame
+            x[0] = { -1, -1, -1 };
+
+            if (waitAfterEachFrame)
+            {
+                writer.waitUntilAllFramesWritten();
+                EXPECT_EQ(step + 1, writtenFrames.size());
+            }
+        }
+        // The destructor writes the remaining frames
+    }
+
+    return writtenFrames;
+}
+
+//! Checks that \p writtenFrames contains \p numFrames frames in order with the expected contents
+void checkWrittenFrames(const std::vector<WrittenFrame>& writtenFrames, int numFrames)
+{
+    ASSERT_EQ(numFrames, writtenFrames.size());
+    for (int step = 0; step < numFrames; step++)
+    {
+        const auto& frame = writtenFrames[step];
+        EXPECT_EQ(step, frame.step);
+        ASSERT_EQ(3, frame.x.size());
+        for (int i = 0; i < 3; i++)
+        {
+            EXPECT_EQ(real(step), frame.x[i][XX]);
+            EXPECT_EQ(real(i), frame.x[i][YY]);
+            EXPECT_EQ(real(-step), frame.x[i][ZZ]);
+        }
+        EXPECT_FALSE(frame.haveV);
+        EXPECT_FALSE(frame.haveF);
+    }
+}
+
+TEST(TrajectoryWriterThreadTest, WritesFramesInOrder)
+{
+    const int numFrames = 20;
+
+    checkWrittenFrames(writeFrames(numFrames, false), numFrames);
+}
+
+TEST(TrajectoryWriterThreadTest, WaitsUntilFramesAreWritten)
+{
+    const int numFrames = 5;
+
+    checkWrittenFrames(writeFrames(numFrames, true), numFrames);
+}
+
+TEST(TrajectoryWriterThreadTest, DestructorWithoutFramesWorks)
+{
+    TrajectoryWriterThread writer([](const TrajectoryOutputFrame& /*frame*/) { ADD_FAILURE(); },
+                                  nullptr);
+    writer.waitUntilAllFramesWritten();
+}
+
+#if HAVE_SCHED_AFFINITY
+TEST(TrajectoryWriterThreadTest, WriterThreadIsNotPinnedToTheCoreOfTheMasterThread)
+{
+    cpu_set_t processMask;
+    CPU_ZERO(&processMask);
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpu_set_t), &processMask));
+    if (CPU_COUNT(&processMask) < 2)
+    {
+        // We can not distinguish pinned from unpinned with a single CPU
+        return;
+    }
+
+    // Pin this thread, as mdrun does with the master thread, to the first CPU we can use
+    cpu_set_t pinnedMask;
+    CPU_ZERO(&pinnedMask);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &processMask))
+        {
+            CPU_SET(cpu, &pinnedMask);
+            break;
+        }
+    }
+    ASSERT_EQ(0, sched_setaffinity(0, sizeof(cpu_set_t), &pinnedMask));
+
+    int numCpusOfWriterThread = 0;
+    {
+        TrajectoryWriterThread writer(
+                [&numCpusOfWriterThread](const TrajectoryOutputFrame& /*frame*/) {
+                    cpu_set_t writerMask;
+                    CPU_ZERO(&writerMask);
+                    if (sched_getaffinity(0, sizeof(cpu_set_t), &writerMask) == 0)
+                    {
+                        numCpusOfWriterThread = CPU_COUNT(&writerMask);
+                    }
+                },
+                nullptr);
+        writer.submitFrame(writer.getFreeFrame());
+    }
+
+    ASSERT_EQ(0, sched_setaffinity(0, sizeof(cpu_set_t), &processMask));
+
+    EXPECT_EQ(CPU_COUNT(&processMask), numCpusOfWriterThread);
+}
+#endif
+
+} // namespace
+} // namespace test
+} // namespace gmx
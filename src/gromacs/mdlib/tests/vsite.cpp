@@ -0,0 +1,305 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the SIMD and plain-C virtual site code give the same results
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/mdlib/vsite.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topology.h"
+
+#include "testutils/setenv.h"
+#include "testutils/testasserts.h"
+
+#include "watersystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The number of water molecules, chosen such that the SIMD lists have padded tails
+constexpr int c_numWaters = c_waterPositions.size() / 3;
+//! The number of atoms per molecule: three real atoms and five virtual sites
+constexpr int c_numAtomsPerMolecule = 8;
+//! The box size, the size of the spc216 box the water positions are taken from
+constexpr real c_boxSize = 1.86206;
+//! The time step used for computing the vsite velocities
+constexpr real c_timeStep = 0.002;
+
+/*! \brief A system of water molecules with five virtual sites each
+ *
+ * Each molecule has a 3, 3fd and 3out virtual site constructed from
+ * the real atoms, which use the SIMD kernels, and a 3out and a 3fd
+ * virtual site constructed from the first virtual site, which use
+ * the plain-C kernels.
+ */
+struct VsiteTestSystem
+{
+    //! Constructor, shifts some hydrogens by a box vector when \p pbcType is not PbcType::No
+    VsiteTestSystem(PbcType pbcType);
+
+    //! The topology
+    gmx_mtop_t mtop;
+    //! The particle types
+    std::vector<unsigned short> ptype;
+    //! The atom data for the vsite code
+    t_mdatoms mdatoms;
+    //! The coordinates, the vsites are not constructed
+    std::vector<RVec> x;
+    //! The box
+    matrix box = { { c_boxSize, 0, 0 }, { 0, c_boxSize, 0 }, { 0, 0, c_boxSize } };
+};
+
+VsiteTestSystem::VsiteTestSystem(PbcType pbcType)
+{
+    const std::array<int, 5> vsiteTypes = { F_VSITE3, F_VSITE3FD, F_VSITE3OUT, F_VSITE3OUT,
+                                            F_VSITE3FD };
+    const std::array<std::array<real, 3>, 5> vsiteParams = { { { 0.128, 0.128, 0 },
+                                                               { 0.5, 0.015, 0 },
+                                                               { 0.5, 0.5, -2.0 },
+                                                               { 0.3, 0.2, 1.5 },
+                                                               { 0.4, 0.05, 0 } } };
+    for (size_t t = 0; t < vsiteTypes.size(); t++)
+    {
+        t_iparams iparams;
+        iparams.vsite.a = vsiteParams[t][0];
+        iparams.vsite.b = vsiteParams[t][1];
+        iparams.vsite.c = vsiteParams[t][2];
+        mtop.ffparams.functype.push_back(vsiteTypes[t]);
+        mtop.ffparams.iparams.push_back(iparams);
+    }
+
+    const int numAtoms = c_numWaters * c_numAtomsPerMolecule;
+    mtop.moltype.resize(1);
+    mtop.molblock.resize(1);
+    mtop.molblock[0].type = 0;
+    mtop.molblock[0].nmol = 1;
+    mtop.natoms           = numAtoms;
+
+    InteractionLists& ilist = mtop.moltype[0].ilist;
+    for (int m = 0; m < c_numWaters; m++)
+    {
+        const int o  = m * c_numAtomsPerMolecule;
+        const int h1 = o + 1;
+        const int h2 = o + 2;
+        ilist[F_VSITE3].push_back(0, std::array<int, 4>{ o + 3, o, h1, h2 });
+        ilist[F_VSITE3FD].push_back(1, std::array<int, 4>{ o + 4, o, h1, h2 });
+        ilist[F_VSITE3OUT].push_back(2, std::array<int, 4>{ o + 5, o, h1, h2 });
+        /* Two vsites constructed from the vsite at o + 3, these should have
+         * a higher type, as forces are spread in order of decreasing type.
+         */
+        ilist[F_VSITE3OUT].push_back(3, std::array<int, 4>{ o + 6, o + 3, o, h2 });
+        ilist[F_VSITE3FD].push_back(4, std::array<int, 4>{ o + 7, o + 3, h1, h2 });
+
+        for (int a = 0; a < c_numAtomsPerMolecule; a++)
+        {
+            ptype.push_back(a < 3 ? eptAtom : eptVSite);
+            /* Place the vsites near the oxygen, so they get a velocity on construction */
+            RVec pos = c_waterPositions[3 * m + std::min(a, 2)];
+            if (a >= 3)
+            {
+                pos[a % DIM] += 0.01 * a;
+            }
+            /* Put some hydrogens in a different periodic image */
+            if (pbcType != PbcType::No && a == 2 && m % 3 == 0)
+            {
+                pos[YY] += c_boxSize;
+            }
+            x.push_back(pos);
+        }
+    }
+
+    mdatoms.nr     = numAtoms;
+    mdatoms.homenr = numAtoms;
+    mdatoms.ptype  = ptype.data();
+}
+
+/*! \brief Returns the vsite handler for \p system using \p numThreads threads
+ *
+ * Uses only the plain-C kernels when \p useSimd is false.
+ */
+std::unique_ptr<VirtualSitesHandler> makeHandler(const VsiteTestSystem& system,
+                                                 PbcType                pbcType,
+                                                 int                    numThreads,
+                                                 bool                   useSimd)
+{
+    gmx_omp_nthreads_set(emntVSITE, numThreads);
+    if (!useSimd)
+    {
+        gmxSetenv("GMX_DISABLE_SIMD_KERNELS", "1", 1);
+    }
+    auto vsite = std::make_unique<VirtualSitesHandler>(system.mtop, nullptr, pbcType);
+    if (!useSimd)
+    {
+        gmxUnsetenv("GMX_DISABLE_SIMD_KERNELS");
+    }
+    vsite->setVirtualSites(system.mtop.moltype[0].ilist, system.mdatoms);
+
+    return vsite;
+}
+
+//! The coordinates and velocities after construction and the forces after spreading
+struct VsiteOutput
+{
+    //! The coordinates
+    std::vector<RVec> x;
+    //! The velocities
+    std::vector<RVec> v;
+    //! The forces after spreading
+    std::vector<RVec> f;
+    //! The shift forces
+    std::vector<RVec> fshift;
+    //! The virial
+    matrix virial;
+};
+
+//! Constructs the vsites in \p system and spreads a set of forces with \p virialHandling
+VsiteOutput runVsites(const VsiteTestSystem&              system,
+                      PbcType                             pbcType,
+                      int                                 numThreads,
+                      bool                                useSimd,
+                      VirtualSitesHandler::VirialHandling virialHandling)
+{
+    std::unique_ptr<VirtualSitesHandler> vsite = makeHandler(system, pbcType, numThreads, useSimd);
+
+    VsiteOutput output;
+    output.x = system.x;
+    output.v.resize(system.x.size(), { 0, 0, 0 });
+    vsite->construct(output.x, c_timeStep, output.v, system.box);
+
+    for (size_t a = 0; a < output.x.size(); a++)
+    {
+        const real arg = a;
+        output.f.push_back({ 100 * std::sin(0.7_real * arg), 100 * std::cos(1.3_real * arg),
+                             100 * std::sin(2.1_real * arg + 0.5_real) });
+    }
+    output.fshift.resize(SHIFTS, { 0, 0, 0 });
+    clear_mat(output.virial);
+    t_nrnb nrnb;
+    vsite->spreadForces(output.x, output.f, virialHandling, output.fshift, output.virial, &nrnb,
+                        system.box, nullptr);
+    gmx_omp_nthreads_set(emntVSITE, 1);
+
+    return output;
+}
+
+//! Expects that all elements of \p reference and \p test are equal within \p tolerance
+void expectRVecsEqual(ArrayRef<const RVec>   reference,
+                      ArrayRef<const RVec>   test,
+                      FloatingPointTolerance tolerance,
+                      const char*            what)
+{
+    ASSERT_EQ(reference.size(), test.size());
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(reference[i][d], test[i][d], tolerance)
+                    << what << " of atom " << i << " dim " << d;
+        }
+    }
+}
+
+//! Test fixture, parametrized over PBC type, number of threads and virial handling
+class VirtualSiteSimdTest :
+    public ::testing::TestWithParam<std::tuple<PbcType, int, VirtualSitesHandler::VirialHandling>>
+{
+};
+
+TEST_P(VirtualSiteSimdTest, SimdMatchesPlainC)
+{
+    const PbcType                             pbcType        = std::get<0>(GetParam());
+    const int                                 numThreads     = std::get<1>(GetParam());
+    const VirtualSitesHandler::VirialHandling virialHandling = std::get<2>(GetParam());
+
+    const VsiteTestSystem system(pbcType);
+
+    const VsiteOutput reference = runVsites(system, pbcType, numThreads, false, virialHandling);
+    const VsiteOutput test      = runVsites(system, pbcType, numThreads, true, virialHandling);
+
+    /* The SIMD construction uses a different order of operations */
+    const real tolerance = (GMX_DOUBLE ? 1e-10 : 1e-5);
+    expectRVecsEqual(reference.x, test.x, relativeToleranceAsFloatingPoint(1, tolerance), "x");
+    expectRVecsEqual(reference.v, test.v,
+                     relativeToleranceAsFloatingPoint(1 / c_timeStep, tolerance), "v");
+    expectRVecsEqual(reference.f, test.f, relativeToleranceAsFloatingPoint(100, tolerance), "f");
+    expectRVecsEqual(reference.fshift, test.fshift,
+                     relativeToleranceAsFloatingPoint(100 * system.x.size(), tolerance), "fshift");
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_REAL_EQ_TOL(reference.virial[d1][d2], test.virial[d1][d2],
+                               relativeToleranceAsFloatingPoint(100 * system.x.size(), tolerance));
+        }
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(
+        WithAndWithoutPbc,
+        VirtualSiteSimdTest,
+        ::testing::Combine(::testing::Values(PbcType::No, PbcType::Xyz),
+                           ::testing::Values(1, 3),
+                           ::testing::Values(VirtualSitesHandler::VirialHandling::None,
+                                             VirtualSitesHandler::VirialHandling::Pbc,
+                                             VirtualSitesHandler::VirialHandling::NonLinear)));
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,234 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Implements the thread for asynchronous writing of trajectory frames
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "trajectorywriterthread.h"
+
+#include "config.h"
+
+#include <algorithm>
+
+#if HAVE_SCHED_AFFINITY
+#    include <sched.h>
+#endif
+
+#include "gromacs/timing/wallcycle.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Returns a view of a copy of \p source in \p buffer, or an empty view for empty \p source
+ArrayRef<const RVec> copyToBuffer(ArrayRef<const RVec> source, std::vector<RVec>* buffer)
+{
+    if (source.empty())
+    {
+        return {};
+    }
+
+    buffer->resize(source.size());
+    std::copy(source.begin(), source.end(), buffer->begin());
+
+    return *buffer;
+}
+
+#if HAVE_SCHED_AFFINITY
+//! An affinity mask with a flag whether it could be queried
+struct AffinityMask
+{
+    //! Whether the mask is valid
+    bool isValid;
+    //! The mask
+    cpu_set_t mask;
+};
+
+//! Returns the affinity mask of the calling thread
+AffinityMask getAffinityMask()
+{
+    AffinityMask affinityMask;
+    CPU_ZERO(&affinityMask.mask);
+    affinityMask.isValid = (sched_getaffinity(0, sizeof(cpu_set_t), &affinityMask.mask) == 0);
+
+    return affinityMask;
+}
+
+/*! \brief The affinity mask of the process when the library is loaded
+ *
+ * This is obtained before mdrun sets the thread affinities, so it
+ * contains all CPUs the process is allowed to run on.
+ */
+const AffinityMask g_processAffinityMask = getAffinityMask();
+#endif
+
+/*! \brief Lets the calling thread run on all CPUs the process was started with
+ *
+ * The writer thread is started by the master thread, which mdrun usually
+ * pins to a single core. The writer thread would inherit this affinity
+ * and compete with the master thread for that core. As the writer thread
+ * mostly waits for frames or for I/O, we do not pin it to another core,
+ * which is likely in use by another thread or rank, but leave it unpinned
+ * and let the operating system schedule it.
+ */
+void unpinThisThread()
+{
+#if HAVE_SCHED_AFFINITY
+    if (g_processAffinityMask.isValid)
+    {
+        /* On failure the thread keeps the affinity of the master thread,
+         * which only affects performance.
+         */
+        sched_setaffinity(0, sizeof(cpu_set_t), &g_processAffinityMask.mask);
+    }
+#endif
+}
+
+} // namespace
+
+void TrajectoryOutputFrame::copyToBuffers(ArrayRef<const RVec> xSource,
+                                          ArrayRef<const RVec> vSource,
+                                          ArrayRef<const RVec> fSource)
+{
+    x = copyToBuffer(xSource, &xBuffer_);
+    v = copyToBuffer(vSource, &vBuffer_);
+    f = copyToBuffer(fSource, &fBuffer_);
+}
+
+TrajectoryWriterThread::TrajectoryWriterThread(WriteFunction writeFunction, gmx_wallcycle* wcycle) :
+    writeFunction_(std::move(writeFunction)),
+    wcycle_(wcycle)
+{
+    for (auto& frame : frames_)
+    {
+        freeFrames_.push_back(&frame);
+    }
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+TrajectoryWriterThread::~TrajectoryWriterThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        finish_ = true;
+    }
+    frameSubmitted_.notify_one();
+
+    thread_.join();
+}
+
+TrajectoryOutputFrame* TrajectoryWriterThread::getFreeFrame()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (freeFrames_.empty())
+    {
+        wallcycle_start(wcycle_, ewcTRAJ_WAIT);
+        frameWritten_.wait(lock, [this]() { return !freeFrames_.empty(); });
+        wallcycle_stop(wcycle_, ewcTRAJ_WAIT);
+    }
+
+    TrajectoryOutputFrame* frame = freeFrames_.back();
+    freeFrames_.pop_back();
+
+    return frame;
+}
+
+void TrajectoryWriterThread::submitFrame(TrajectoryOutputFrame* frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        submittedFrames_.push(frame);
+    }
+    frameSubmitted_.notify_one();
+}
+
+void TrajectoryWriterThread::waitUntilAllFramesWritten()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (freeFrames_.size() < frames_.size())
+    {
+        wallcycle_start(wcycle_, ewcTRAJ_WAIT);
+        frameWritten_.wait(lock, [this]() { return freeFrames_.size() == frames_.size(); });
+        wallcycle_stop(wcycle_, ewcTRAJ_WAIT);
+    }
+}
+
+void TrajectoryWriterThread::run()
+{
+    try
+    {
+        unpinThisThread();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (true)
+        {
+            frameSubmitted_.wait(lock, [this]() { return finish_ || !submittedFrames_.empty(); });
+
+            if (submittedFrames_.empty())
+            {
+                // We are finished and all frames have been written
+                break;
+            }
+
+            TrajectoryOutputFrame* frame = submittedFrames_.front();
+
+            // Write without holding the lock, so the master thread can continue
+            lock.unlock();
+            writeFunction_(*frame);
+            lock.lock();
+
+            submittedFrames_.pop();
+            freeFrames_.push_back(frame);
+            frameWritten_.notify_one();
+        }
+    }
+    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+}
+
+} // namespace gmx
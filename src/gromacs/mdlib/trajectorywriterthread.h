@@ -0,0 +1,189 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief Declares a thread for asynchronous writing of trajectory frames
+ *
+ * \ingroup module_mdlib
+ * \inlibraryapi
+ */
+#ifndef GMX_MDLIB_TRAJECTORYWRITERTHREAD_H
+#define GMX_MDLIB_TRAJECTORYWRITERTHREAD_H
+
+#include <cstdint>
+
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/real.h"
+
+struct gmx_wallcycle;
+
+namespace gmx
+{
+
+/*! \libinternal
+ * \brief A trajectory frame for writing to the output files
+ *
+ * The coordinate, velocity and force views either refer to the data
+ * of the simulation, when writing synchronously, or to the buffers
+ * owned by the frame, when the frame is written by a writer thread.
+ */
+struct TrajectoryOutputFrame
+{
+    /*! \brief Copies the contents of \p xSource, \p vSource and \p fSource
+     * to the buffers of this frame and lets \p x, \p v and \p f refer to them
+     */
+    void copyToBuffers(ArrayRef<const RVec> xSource,
+                       ArrayRef<const RVec> vSource,
+                       ArrayRef<const RVec> fSource);
+
+    //! The MDOF flags for what to write
+    int flags = 0;
+    //! The step
+    int64_t step = 0;
+    //! The time
+    double time = 0;
+    //! The FEP lambda value
+    real lambda = 0;
+    //! The box
+    matrix box = { { 0 } };
+    //! The number of atoms
+    int numAtoms = 0;
+    //! The coordinates, empty when not written
+    ArrayRef<const RVec> x;
+    //! The velocities, empty when not written
+    ArrayRef<const RVec> v;
+    //! The forces, empty when not written
+    ArrayRef<const RVec> f;
+
+private:
+    //! Buffer for the coordinates
+    std::vector<RVec> xBuffer_;
+    //! Buffer for the velocities
+    std::vector<RVec> vBuffer_;
+    //! Buffer for the forces
+    std::vector<RVec> fBuffer_;
+};
+
+/*! \libinternal
+ * \brief Writes trajectory frames on a separate thread
+ *
+ * The master rank copies a collected frame into one of two frame
+ * buffers and hands it to the writer thread, which does the compression
+ * and the file output while the simulation continues. Only when both
+ * buffers are in use, does the master rank wait. This waiting time is
+ * counted with wallcycle counter ewcTRAJ_WAIT, which should be called
+ * within the ewcTRAJ counter.
+ *
+ * The writer thread does not inherit the affinity of the thread that
+ * starts it, which is usually pinned to a core, but runs unpinned on
+ * all CPUs the process was started with.
+ *
+ * Errors during writing, such as a full disk, are handled on the writer
+ * thread. Exceptions thrown by the write function and calls to gmx_fatal()
+ * then terminate the program from the writer thread, as they would from
+ * the master thread with synchronous output.
+ */
+class TrajectoryWriterThread
+{
+public:
+    //! Function that writes a frame to the output files, called on the writer thread
+    using WriteFunction = std::function<void(const TrajectoryOutputFrame&)>;
+
+    /*! \brief Constructor, starts the writer thread
+     *
+     * \param[in] writeFunction  Function that writes a frame
+     * \param[in] wcycle         Wallcycle counters, can be nullptr
+     */
+    TrajectoryWriterThread(WriteFunction writeFunction, gmx_wallcycle* wcycle);
+
+    //! Destructor, writes all remaining frames and joins the thread
+    ~TrajectoryWriterThread();
+
+    /*! \brief Returns a frame that is not in use by the writer thread
+     *
+     * Waits for the writer thread when all frame buffers are in use.
+     */
+    TrajectoryOutputFrame* getFreeFrame();
+
+    //! Hands \p frame, which should be obtained with getFreeFrame(), to the writer thread
+    void submitFrame(TrajectoryOutputFrame* frame);
+
+    //! Waits until all submitted frames have been written
+    void waitUntilAllFramesWritten();
+
+private:
+    //! The main loop of the writer thread
+    void run();
+
+    //! The number of frame buffers
+    static constexpr int c_numFrameBuffers = 2;
+
+    //! Function that writes a frame
+    WriteFunction writeFunction_;
+    //! Wallcycle counters
+    gmx_wallcycle* wcycle_;
+    //! The frame buffers
+    std::array<TrajectoryOutputFrame, c_numFrameBuffers> frames_;
+    //! Frames that are not in use by the writer thread
+    std::vector<TrajectoryOutputFrame*> freeFrames_;
+    //! Frames that have been submitted and not yet written, in order of submission
+    std::queue<TrajectoryOutputFrame*> submittedFrames_;
+    //! Whether the writer thread should finish after writing the submitted frames
+    bool finish_ = false;
+    //! Mutex protecting the frame lists and \p finish_
+    std::mutex mutex_;
+    //! Condition variable for notifying of submitted frames and for finishing
+    std::condition_variable frameSubmitted_;
+    //! Condition variable for notifying of written frames
+    std::condition_variable frameWritten_;
+    //! The writer thread
+    std::thread thread_;
+
+    GMX_DISALLOW_COPY_MOVE_AND_ASSIGN(TrajectoryWriterThread);
+};
+
+} // namespace gmx
+
+#endif
@@ -132,6 +132,31 @@ public:
                        const t_commrec*                                 cr,
                        bool                                             haveConstraints);
 
+    bool canFuseUpdateAndConstraints(const t_inputrec&  inputRecord,
+                                     const t_mdatoms*   md,
+                                     const Constraints* constr) const;
+
+    void update_coords_constrain_fused(const t_inputrec&                                inputRecord,
+                                       int64_t                                          step,
+                                       const t_mdatoms*                                 md,
+                                       t_state*                                         state,
+                                       const gmx::ArrayRefWithPadding<const gmx::RVec>& f,
+                                       const t_fcdata&                                  fcdata,
+                                       const gmx_ekindata_t*                            ekind,
+                                       const matrix                                     M,
+                                       Constraints*                                     constr,
+                                       bool                                             do_log,
+                                       bool                                             do_ene,
+                                       real*                                            dvdlambda,
+                                       bool            computeVirial,
+                                       tensor          constraintsVirial,
+                                       gmx_wallcycle_t wcycle);
+
+    void update_for_constraint_virial(const t_inputrec&                                inputRecord,
+                                      const t_mdatoms&                                 md,
+                                      const t_state&                                   state,
+                                      const gmx::ArrayRefWithPadding<const gmx::RVec>& f);
+
     void finish_update(const t_inputrec& inputRecord,
                        const t_mdatoms*  md,
                        t_state*          state,
@@ -167,6 +192,10 @@ private:
     PaddedVector<RVec> xp_;
     //! Box deformation handler (or nullptr if inactive).
     BoxDeformation* deform_ = nullptr;
+    //! Whether the update can be fused with constraining, enabled by an env.var.
+    bool allowFusedUpdate_ = false;
+    //! The SETTLE virial and error output of each thread in the fused update
+    std::vector<FusedSettleOutput> fusedSettleOutput_;
 };
 
 Update::Update(const t_inputrec& inputRecord, BoxDeformation* boxDeformation) :
@@ -210,6 +239,42 @@ void Update::update_coords(const t_inputrec&                                inpu
                                 haveConstraints);
 }
 
+bool Update::canFuseUpdateAndConstraints(const t_inputrec&  inputRecord,
+                                         const t_mdatoms*   md,
+                                         const Constraints* constr) const
+{
+    return impl_->canFuseUpdateAndConstraints(inputRecord, md, constr);
+}
+
+void Update::update_coords_constrain_fused(const t_inputrec& inputRecord,
+                                           int64_t           step,
+                                           const t_mdatoms*  md,
+                                           t_state*          state,
+                                           const gmx::ArrayRefWithPadding<const gmx::RVec>& f,
+                                           const t_fcdata&       fcdata,
+                                           const gmx_ekindata_t* ekind,
+                                           const matrix          M,
+                                           Constraints*          constr,
+                                           const bool            do_log,
+                                           const bool            do_ene,
+                                           real*                 dvdlambda,
+                                           const bool            computeVirial,
+                                           tensor                constraintsVirial,
+                                           gmx_wallcycle_t       wcycle)
+{
+    return impl_->update_coords_constrain_fused(inputRecord, step, md, state, f, fcdata, ekind, M,
+                                                constr, do_log, do_ene, dvdlambda, computeVirial,
+                                                constraintsVirial, wcycle);
+}
+
+void Update::update_for_constraint_virial(const t_inputrec& inputRecord,
+                                          const t_mdatoms&  md,
+                                          const t_state&    state,
+                                          const gmx::ArrayRefWithPadding<const gmx::RVec>& f)
+{
+    return impl_->update_for_constraint_virial(inputRecord, md, state, f);
+}
+
 void Update::finish_update(const t_inputrec& inputRecord,
                            const t_mdatoms*  md,
                            t_state*          state,
@@ -936,7 +1001,8 @@ void Update::Impl::update_temperature_constants(const t_inputrec& inputRecord)
 
 Update::Impl::Impl(const t_inputrec& inputRecord, BoxDeformation* boxDeformation) :
     sd_(inputRecord),
-    deform_(boxDeformation)
+    deform_(boxDeformation),
+    allowFusedUpdate_(getenv("GMX_USE_FUSED_UPDATE") != nullptr)
 {
     update_temperature_constants(inputRecord);
     xp_.resizeWithPadding(0);
@@ -1395,6 +1461,19 @@ void Update::Impl::finish_update(const t_inputrec& inputRecord,
     wallcycle_stop(wcycle, ewcUPDATE);
 }
 
+//! Updates the NMR restraint history, needed when time averaging is used
+static void updateRestraintHistory(const t_fcdata& fcdata, t_state* state)
+{
+    if (state->flags & (1 << estDISRE_RM3TAV))
+    {
+        update_disres_history(*fcdata.disres, &state->hist);
+    }
+    if (state->flags & (1 << estORIRE_DTAV))
+    {
+        update_orires_history(*fcdata.orires, &state->hist);
+    }
+}
+
 void Update::Impl::update_coords(const t_inputrec&                                inputRecord,
                                  int64_t                                          step,
                                  const t_mdatoms*                                 md,
@@ -1418,15 +1497,7 @@ void Update::Impl::update_coords(const t_inputrec&
     /* Cast to real for faster code, no loss in precision (see comment above) */
     real dt = inputRecord.delta_t;
 
-    /* We need to update the NMR restraint history when time averaging is used */
-    if (state->flags & (1 << estDISRE_RM3TAV))
-    {
-        update_disres_history(*fcdata.disres, &state->hist);
-    }
-    if (state->flags & (1 << estORIRE_DTAV))
-    {
-        update_orires_history(*fcdata.orires, &state->hist);
-    }
+    updateRestraintHistory(fcdata, state);
 
     /* ############# START The update of velocities and positions ######### */
     int nth = gmx_omp_nthreads_get(emntUpdate);
@@ -1494,3 +1565,420 @@ void Update::Impl::update_coords(const t_inputrec&
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 }
+
+/*! \brief Sets xprime = x + (v + f/m dt) dt, without updating the velocities
+ *
+ * Used for computing the constraint virial with multiple time stepping.
+ */
+static void doUpdateMDDoNotUpdateVelocities(int         start,
+                                            int         nrend,
+                                            real        dt,
+                                            const rvec* gmx_restrict x,
+                                            rvec* gmx_restrict xprime,
+                                            const rvec* gmx_restrict v,
+                                            const rvec* gmx_restrict f,
+                                            const rvec* gmx_restrict invMassPerDim)
+{
+    for (int a = start; a < nrend; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            xprime[a][d] = x[a][d] + (v[a][d] + f[a][d] * invMassPerDim[a][d] * dt) * dt;
+        }
+    }
+}
+
+void Update::Impl::update_for_constraint_virial(const t_inputrec& inputRecord,
+                                                const t_mdatoms&  md,
+                                                const t_state&    state,
+                                                const gmx::ArrayRefWithPadding<const gmx::RVec>& f)
+{
+    GMX_ASSERT(inputRecord.eI == eiMD, "Only leap-frog is supported here");
+
+    /* Cast to real for faster code, no loss in precision */
+    const real dt = inputRecord.delta_t;
+
+    const int nth = gmx_omp_nthreads_get(emntUpdate);
+
+#pragma omp parallel for num_threads(nth) schedule(static)
+    for (int th = 0; th < nth; th++)
+    {
+        try
+        {
+            int start_th, end_th;
+            getThreadAtomRange(nth, th, md.homenr, &start_th, &end_th);
+
+            doUpdateMDDoNotUpdateVelocities(start_th, end_th, dt, state.x.rvec_array(),
+                                            xp_.rvec_array(), state.v.rvec_array(),
+                                            as_rvec_array(f.unpaddedConstArrayRef().data()),
+                                            md.invMassPerDim);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+}
+
+bool Update::Impl::canFuseUpdateAndConstraints(const t_inputrec&  inputRecord,
+                                               const t_mdatoms*   md,
+                                               const Constraints* constr) const
+{
+    return allowFusedUpdate_ && inputRecord.eI == eiMD && constr != nullptr
+           && !md->havePartiallyFrozenAtoms && constr->fusedSettleLayout().has_value();
+}
+
+/*! \brief The number of atoms a thread updates before settling them in the fused update
+ *
+ * Chosen such that coordinates, updated coordinates, velocities and forces
+ * of a block, 48 bytes per atom in single precision, stay in the L1 cache.
+ */
+static constexpr int c_fusedUpdateBlockSize = 256;
+
+#if GMX_HAVE_SIMD_UPDATE
+static_assert(c_fusedUpdateBlockSize % GMX_SIMD_REAL_WIDTH == 0,
+              "The SIMD update needs blocks that start at a multiple of the SIMD width");
+#endif
+
+/*! \brief Integrate atoms \p start to \p end using the simple leap-frog update
+ *
+ * Gives the same result as do_update_md() when
+ * haveSimpleUpdateWithSingleTempScale() returns true, but, in contrast
+ * to the SIMD update, does not access atoms outside the range.
+ */
+static void updateMDLeapfrogSimpleRange(int                   start,
+                                        int                   end,
+                                        real                  dt,
+                                        const t_mdatoms*      md,
+                                        const gmx_ekindata_t* ekind,
+                                        const rvec* gmx_restrict x,
+                                        rvec* gmx_restrict xprime,
+                                        rvec* gmx_restrict v,
+                                        const rvec* gmx_restrict f)
+{
+    if (md->haveVsites)
+    {
+        clearVsiteVelocities(start, end, md->ptype, v);
+    }
+
+#if GMX_HAVE_SIMD_UPDATE
+    /* Apply the SIMD update to zero-padded copies of the atoms,
+     * so we get exactly the same results as with do_update_md().
+     */
+    constexpr int                    width = GMX_SIMD_REAL_WIDTH;
+    alignas(GMX_SIMD_ALIGNMENT) rvec xBuffer[width];
+    alignas(GMX_SIMD_ALIGNMENT) rvec xprimeBuffer[width];
+    alignas(GMX_SIMD_ALIGNMENT) rvec vBuffer[width];
+    alignas(GMX_SIMD_ALIGNMENT) rvec fBuffer[width];
+    alignas(GMX_SIMD_ALIGNMENT) real invMassBuffer[width];
+
+    for (int chunkStart = (start / width) * width; chunkStart < end; chunkStart += width)
+    {
+        const int atomStart = std::max(start, chunkStart);
+        const int atomEnd   = std::min(end, chunkStart + width);
+        for (int i = 0; i < width; i++)
+        {
+            const int a = chunkStart + i;
+            if (a >= atomStart && a < atomEnd)
+            {
+                copy_rvec(x[a], xBuffer[i]);
+                copy_rvec(v[a], vBuffer[i]);
+                copy_rvec(f[a], fBuffer[i]);
+                invMassBuffer[i] = md->invmass[a];
+            }
+            else
+            {
+                clear_rvec(xBuffer[i]);
+                clear_rvec(vBuffer[i]);
+                clear_rvec(fBuffer[i]);
+                invMassBuffer[i] = 0;
+            }
+        }
+        updateMDLeapfrogSimpleSimd(0, width, dt, invMassBuffer, ekind->tcstat, xBuffer,
+                                   xprimeBuffer, vBuffer, fBuffer);
+        for (int a = atomStart; a < atomEnd; a++)
+        {
+            copy_rvec(vBuffer[a - chunkStart], v[a]);
+            copy_rvec(xprimeBuffer[a - chunkStart], xprime[a]);
+        }
+    }
+#else
+    updateMDLeapfrogSimple<NumTempScaleValues::single, ApplyParrinelloRahmanVScaling::no>(
+            start, end, dt, 0, md->invMassPerDim, ekind->tcstat, md->cTC, nullptr, x, xprime, v, f);
+#endif
+}
+
+/*! \brief Returns whether do_update_md() uses the simple leap-frog update with one T-scaling factor
+ *
+ * In that case the update of the water molecules can be done inside SETTLE.
+ */
+static bool haveSimpleUpdateWithSingleTempScale(const t_inputrec&     inputRecord,
+                                                int64_t               step,
+                                                const t_mdatoms*      md,
+                                                const gmx_ekindata_t* ekind)
+{
+    const bool doTempCouple =
+            (inputRecord.etc != etcNO
+             && do_per_step(step + inputRecord.nsttcouple - 1, inputRecord.nsttcouple));
+    const bool doNoseHoover = (inputRecord.etc == etcNOSEHOOVER && doTempCouple);
+    const bool doParrinelloRahman =
+            (inputRecord.epc == epcPARRINELLORAHMAN
+             && do_per_step(step + inputRecord.nstpcouple - 1, inputRecord.nstpcouple));
+    const bool doAcceleration = (ekind->bNEMD || ekind->cosacc.cos_accel != 0);
+
+    return !doNoseHoover && !doParrinelloRahman && !doAcceleration
+           && (!doTempCouple || ekind->ngtc == 1) && md->nMassPerturbed == 0;
+}
+
+void Update::Impl::update_coords_constrain_fused(const t_inputrec& inputRecord,
+                                                 int64_t           step,
+                                                 const t_mdatoms*  md,
+                                                 t_state*          state,
+                                                 const gmx::ArrayRefWithPadding<const gmx::RVec>& f,
+                                                 const t_fcdata&       fcdata,
+                                                 const gmx_ekindata_t* ekind,
+                                                 const matrix          M,
+                                                 Constraints*          constr,
+                                                 const bool            do_log,
+                                                 const bool            do_ene,
+                                                 real*                 dvdlambda,
+                                                 const bool            computeVirial,
+                                                 tensor                constraintsVirial,
+                                                 gmx_wallcycle_t       wcycle)
+{
+    const std::optional<FusedSettleLayout> layout = constr->fusedSettleLayout();
+    GMX_RELEASE_ASSERT(inputRecord.eI == eiMD && layout,
+                       "The fused update requires leap-frog and a suitable SETTLE layout");
+
+    const int  homenr = md->homenr;
+    const real dt     = inputRecord.delta_t;
+
+    updateRestraintHistory(fcdata, state);
+
+    /* The SETTLEs are processed in packs of layout->packSize water molecules.
+     * A pack belongs to the thread whose atom range contains its first atom.
+     * A thread settles a pack as soon as it has updated all its atoms,
+     * packs extending into the range of the next thread are settled after
+     * a barrier. The coordinates of a water molecule are only copied back
+     * after it has been settled, since SETTLE uses them as reference.
+     */
+    const int firstSettleAtom = layout->firstAtom;
+    const int numSettles      = layout->numSettles;
+    const int endSettleAtom   = firstSettleAtom + numSettles * NRAL(F_SETTLE);
+    const int packSize        = layout->packSize;
+    const int numPacks        = (numSettles + packSize - 1) / packSize;
+    const int packAtoms       = packSize * NRAL(F_SETTLE);
+
+    auto packStartAtom = [=](int pack) { return firstSettleAtom + pack * packAtoms; };
+    auto packEndAtom   = [=](int pack) { return std::min(packStartAtom(pack + 1), endSettleAtom); };
+    /* Returns the first pack that starts at or after atom */
+    auto firstPackFrom = [=](int atom) {
+        return atom <= firstSettleAtom
+                       ? 0
+                       : std::min((atom - firstSettleAtom + packAtoms - 1) / packAtoms, numPacks);
+    };
+
+    /* Without domain decomposition the PBC setup of the constraint code reduces to this */
+    t_pbc  pbc;
+    t_pbc* pbcPtr = nullptr;
+    if (layout->usePbc)
+    {
+        pbcPtr = set_pbc_dd(&pbc, inputRecord.pbcType, nullptr, FALSE, state->box);
+    }
+
+    /* With the simple leap-frog update, the water molecules are updated
+     * inside SETTLE, which stores the results directly in state->x and v.
+     * As this only depends on the water atoms, packs can be processed
+     * without waiting for other atoms or threads.
+     */
+    const bool updateWaterInSettle =
+            layout->haveUniformMasses
+            && haveSimpleUpdateWithSingleTempScale(inputRecord, step, md, ekind);
+#if GMX_HAVE_SIMD_UPDATE
+    constexpr int updateSimdWidth = GMX_SIMD_REAL_WIDTH;
+#else
+    constexpr int updateSimdWidth = 1;
+#endif
+
+    ArrayRefWithPadding<RVec> x  = state->x.arrayRefWithPadding();
+    ArrayRefWithPadding<RVec> xp = xp_.arrayRefWithPadding();
+    ArrayRefWithPadding<RVec> v  = state->v.arrayRefWithPadding();
+
+    const int nth = gmx_omp_nthreads_get(emntUpdate);
+    fusedSettleOutput_.resize(nth);
+
+#pragma omp parallel num_threads(nth)
+    {
+        const int th = gmx_omp_get_thread_num();
+
+        int startPack = 0;
+        int endPack   = 0;
+        try
+        {
+            FusedSettleOutput& settleOutput = fusedSettleOutput_[th];
+            clear_mat(settleOutput.virial);
+            settleOutput.errorHasOccurred = false;
+
+            int start_th, end_th;
+            getThreadAtomRange(nth, th, homenr, &start_th, &end_th);
+
+            const rvec* x_rvec  = state->x.rvec_array();
+            rvec*       xp_rvec = xp_.rvec_array();
+            rvec*       v_rvec  = state->v.rvec_array();
+            const rvec* f_rvec  = as_rvec_array(f.unpaddedConstArrayRef().data());
+
+            startPack = firstPackFrom(start_th);
+            endPack   = firstPackFrom(end_th);
+
+            /* Updates atoms start to end, which should not contain water atoms.
+             * The SIMD update processes whole SIMD registers of atoms, so we
+             * use the plain update at range boundaries next to water atoms.
+             */
+            auto updateNonWaterAtoms = [&](int start, int end) {
+                if (start >= end)
+                {
+                    return;
+                }
+                const int simdStart =
+                        ((start + updateSimdWidth - 1) / updateSimdWidth) * updateSimdWidth;
+                const int simdEnd =
+                        (end == homenr ? end : (end / updateSimdWidth) * updateSimdWidth);
+                if (simdStart >= simdEnd)
+                {
+                    updateMDLeapfrogSimpleRange(start, end, dt, md, ekind, x_rvec, xp_rvec, v_rvec,
+                                                f_rvec);
+                    return;
+                }
+                updateMDLeapfrogSimpleRange(start, simdStart, dt, md, ekind, x_rvec, xp_rvec,
+                                            v_rvec, f_rvec);
+                do_update_md(simdStart, simdEnd, dt, step, x_rvec, xp_rvec, v_rvec, f_rvec,
+                             inputRecord.opts.acc, inputRecord.etc, inputRecord.epc,
+                             inputRecord.nsttcouple, inputRecord.nstpcouple, md, ekind, state->box,
+                             state->nosehoover_vxi.data(), M);
+                updateMDLeapfrogSimpleRange(simdEnd, end, dt, md, ekind, x_rvec, xp_rvec, v_rvec,
+                                            f_rvec);
+            };
+
+            for (int blockStart = start_th; blockStart < end_th;
+                 blockStart += c_fusedUpdateBlockSize)
+            {
+                const int blockEnd = std::min(blockStart + c_fusedUpdateBlockSize, end_th);
+
+                if (updateWaterInSettle)
+                {
+                    updateNonWaterAtoms(blockStart, std::min(blockEnd, firstSettleAtom));
+                    updateNonWaterAtoms(std::max(blockStart, endSettleAtom), blockEnd);
+
+                    /* Update and settle the packs that start in this block */
+                    const int endBlockPack = std::min(firstPackFrom(blockEnd), endPack);
+                    if (endBlockPack > startPack)
+                    {
+                        constr->updateAndSettleForFusedUpdate(
+                                startPack * packSize, std::min(endBlockPack * packSize, numSettles),
+                                pbcPtr, ekind->tcstat[0].lambda, x, v, f, computeVirial,
+                                &settleOutput);
+                        startPack = endBlockPack;
+                    }
+                }
+                else
+                {
+                    do_update_md(blockStart, blockEnd, dt, step, x_rvec, xp_rvec, v_rvec, f_rvec,
+                                 inputRecord.opts.acc, inputRecord.etc, inputRecord.epc,
+                                 inputRecord.nsttcouple, inputRecord.nstpcouple, md, ekind,
+                                 state->box, state->nosehoover_vxi.data(), M);
+
+                    /* Settle the packs that are now completely updated */
+                    int endReadyPack = startPack;
+                    while (endReadyPack < endPack && packEndAtom(endReadyPack) <= blockEnd)
+                    {
+                        endReadyPack++;
+                    }
+                    if (endReadyPack > startPack)
+                    {
+                        constr->settleForFusedUpdate(
+                                startPack * packSize, std::min(endReadyPack * packSize, numSettles),
+                                pbcPtr, x, xp, v, computeVirial, &settleOutput);
+                        for (int a = packStartAtom(startPack); a < packEndAtom(endReadyPack - 1);
+                             a++)
+                        {
+                            state->x[a] = xp_[a];
+                        }
+                        startPack = endReadyPack;
+                    }
+                }
+
+                if (!layout->haveOtherConstraints)
+                {
+                    /* Copy back the atoms in this block that do not belong to a SETTLE */
+                    for (int a = blockStart; a < std::min(blockEnd, firstSettleAtom); a++)
+                    {
+                        state->x[a] = xp_[a];
+                    }
+                    for (int a = std::max(blockStart, endSettleAtom); a < blockEnd; a++)
+                    {
+                        state->x[a] = xp_[a];
+                    }
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+
+        /* Settle the packs that extend into the range of the next thread(s).
+         * All threads take the same branch, as updateWaterInSettle is uniform.
+         */
+        if (!updateWaterInSettle)
+        {
+#pragma omp barrier
+        }
+        if (startPack < endPack)
+        {
+            try
+            {
+                constr->settleForFusedUpdate(startPack * packSize,
+                                             std::min(endPack * packSize, numSettles), pbcPtr, x,
+                                             xp, v, computeVirial, &fusedSettleOutput_[th]);
+                for (int a = packStartAtom(startPack); a < packEndAtom(endPack - 1); a++)
+                {
+                    state->x[a] = xp_[a];
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+    }
+
+    /* Reduce the SETTLE output over the threads */
+    for (int th = 1; th < nth; th++)
+    {
+        m_add(fusedSettleOutput_[0].virial, fusedSettleOutput_[th].virial,
+              fusedSettleOutput_[0].virial);
+        fusedSettleOutput_[0].errorHasOccurred =
+                fusedSettleOutput_[0].errorHasOccurred || fusedSettleOutput_[th].errorHasOccurred;
+    }
+
+    wallcycle_stop(wcycle, ewcUPDATE);
+
+    constr->applyAfterFusedSettle(do_log, do_ene, step, x, xp, state->box,
+                                  state->lambda[efptBONDED], dvdlambda, v, computeVirial,
+                                  constraintsVirial, fusedSettleOutput_[0]);
+
+    if (layout->haveOtherConstraints)
+    {
+        wallcycle_start_nocount(wcycle, ewcUPDATE);
+
+        /* Copy back the atoms that do not belong to a SETTLE */
+        auto xpRef = makeConstArrayRef(xp_);
+        auto xRef  = makeArrayRef(state->x);
+
+#pragma omp parallel for num_threads(nth) schedule(static)
+        for (int i = 0; i < firstSettleAtom; i++)
+        {
+            // Trivial statement, does not throw
+            xRef[i] = xpRef[i];
+        }
+#pragma omp parallel for num_threads(nth) schedule(static)
+        for (int i = endSettleAtom; i < homenr; i++)
+        {
+            // Trivial statement, does not throw
+            xRef[i] = xpRef[i];
+        }
+
+        wallcycle_stop(wcycle, ewcUPDATE);
+    }
+}
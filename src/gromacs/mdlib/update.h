@@ -126,6 +126,77 @@ public:
                        const t_commrec*                                 cr,
                        bool                                             haveConstraints);
 
+    /*! \brief Returns whether update_coords_constrain_fused() can be used this step
+     *
+     * \param[in]  inputRecord      Input record.
+     * \param[in]  md               MD atoms data.
+     * \param[in]  constr           Constraints object, can be nullptr.
+     */
+    bool canFuseUpdateAndConstraints(const t_inputrec&  inputRecord,
+                                     const t_mdatoms*   md,
+                                     const Constraints* constr) const;
+
+    /*! \brief Perform the leap-frog update, constraining and copy-back in a single pass.
+     *
+     * Does the same as update_coords() with etrtPOSITION, constrain_coordinates()
+     * and finish_update(), but each thread updates its atoms in cache sized blocks
+     * and applies SETTLE to, and copies back, the water molecules in a block directly
+     * after updating it. Other constraints are applied afterwards. Can only be called
+     * when canFuseUpdateAndConstraints() returns true. Should be called with the update
+     * wallcycle counter running, which is stopped on return. The time spent in SETTLE
+     * is included in the update counter.
+     *
+     * \param[in]  inputRecord       Input record.
+     * \param[in]  step              Current timestep.
+     * \param[in]  md                MD atoms data.
+     * \param[in]  state             System state object.
+     * \param[in]  f                 Buffer with atomic forces for home particles.
+     * \param[in]  fcdata            Force calculation data to update restraint histories.
+     * \param[in]  ekind             Kinetic energy data (for temperature coupling etc.).
+     * \param[in]  M                 Parrinello-Rahman velocity scaling matrix.
+     * \param[in]  constr            Constraints object.
+     * \param[in]  do_log            If this is logging step.
+     * \param[in]  do_ene            If this is an energy evaluation step.
+     * \param[out] dvdlambda         Free energy derivative contribution of the constraints.
+     * \param[in]  computeVirial     Whether to compute the constraint virial.
+     * \param[out] constraintsVirial The constraint virial.
+     * \param[in]  wcycle            Wall-clock cycle counter.
+     */
+    void update_coords_constrain_fused(const t_inputrec&                                inputRecord,
+                                       int64_t                                          step,
+                                       const t_mdatoms*                                 md,
+                                       t_state*                                         state,
+                                       const gmx::ArrayRefWithPadding<const gmx::RVec>& f,
+                                       const t_fcdata&                                  fcdata,
+                                       const gmx_ekindata_t*                            ekind,
+                                       const matrix                                     M,
+                                       Constraints*                                     constr,
+                                       bool                                             do_log,
+                                       bool                                             do_ene,
+                                       real*                                            dvdlambda,
+                                       bool            computeVirial,
+                                       tensor          constraintsVirial,
+                                       gmx_wallcycle_t wcycle);
+
+    /*! \brief Update the coordinates without coupling, for computing the constraint virial.
+     *
+     * With multiple time stepping the update uses a force where the slow forces
+     * are scaled by the MTS step factor. Constraining the resulting coordinates
+     * would give an incorrect constraint virial. This method sets xp = x + (v + f/m dt) dt
+     * for the home atoms with the normal, unscaled forces and does not modify the state.
+     * Constraining xp then gives the correct constraint virial. Temperature and pressure
+     * coupling and acceleration groups are not applied, as these hardly affect the virial.
+     *
+     * \param[in]  inputRecord      Input record.
+     * \param[in]  md               MD atoms data.
+     * \param[in]  state            System state object.
+     * \param[in]  f                Buffer with atomic forces for home particles.
+     */
+    void update_for_constraint_virial(const t_inputrec&                                inputRecord,
+                                      const t_mdatoms&                                 md,
+                                      const t_state&                                   state,
+                                      const gmx::ArrayRefWithPadding<const gmx::RVec>& f);
+
     /*! \brief Finalize the coordinate update.
      *
      * Copy the updated coordinates to the main coordinates buffer for the atoms that are not frozen.
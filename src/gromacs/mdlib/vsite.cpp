@@ -64,10 +64,14 @@
 #include "gromacs/mdtypes/mdatom.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/pbcutil/pbc_simd.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/ifunc.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
@@ -159,6 +163,33 @@ struct InterdependentTask
     std::vector<int> reduceTask;
 };
 
+//! The virtual site types for which we have SIMD kernels
+static constexpr std::array<int, 3> c_simdVsiteTypes = { F_VSITE3, F_VSITE3FD, F_VSITE3OUT };
+
+/*! \libinternal
+ * \brief Virtual sites of one type stored for processing in SIMD batches
+ *
+ * Only contains virtual sites that are not constructed from other virtual
+ * sites, so all virtual sites in a batch are independent. All arrays are
+ * padded to a multiple of the SIMD width with copies of the last entry.
+ */
+struct VsiteSimdList
+{
+    //! The interaction type of the virtual sites
+    int ftype = -1;
+    //! The number of virtual sites
+    int numVsites = 0;
+    //! The virtual site atom indices
+    std::vector<int, AlignedAllocator<int>> vsite;
+    //! The indices of the three constructing atoms
+    std::array<std::vector<int, AlignedAllocator<int>>, 3> constructing;
+    //! The construction parameters a, b and c
+    std::array<std::vector<real, AlignedAllocator<real>>, 3> param;
+};
+
+//! The SIMD lists of virtual sites of a task, one per type in c_simdVsiteTypes
+using VsiteSimdLists = std::array<VsiteSimdList, c_simdVsiteTypes.size()>;
+
 /*! \libinternal
  * \brief Vsite thread task data structure
  */
@@ -178,6 +209,8 @@ struct VsiteThread
     bool useInterdependentTask;
     //! Data for vsites that involve constructing atoms in the atom range of other threads/tasks
     InterdependentTask idTask;
+    //! Vsites of ilist that are processed in SIMD batches instead
+    VsiteSimdLists simdLists;
 
     /*! \brief Constructor */
     VsiteThread()
@@ -190,6 +223,10 @@ struct VsiteThread
         }
         clear_mat(dxdf);
         useInterdependentTask = false;
+        for (size_t i = 0; i < c_simdVsiteTypes.size(); i++)
+        {
+            simdLists[i].ftype = c_simdVsiteTypes[i];
+        }
     }
 };
 
@@ -218,15 +255,24 @@ public:
     //! Returns the thread data for vsites that depend on non-local vsites
     VsiteThread& threadDataNonLocalDependent() { return *tData_[numThreads_]; }
 
-    //! Set VSites and distribute VSite work over threads, should be called after DD partitioning
+    /*! \brief Set VSites and distribute VSite work over threads
+     *
+     * Should be called after DD partitioning.
+     * Virtual sites that are not constructed from other virtual sites
+     * are moved to SIMD lists when SIMD kernels are in use.
+     * The SIMD kernels do not support screw PBC.
+     */
     void setVirtualSites(ArrayRef<const InteractionList> ilist,
                          ArrayRef<const t_iparams>       iparams,
                          const t_mdatoms&                mdatoms,
-                         bool                            useDomdec);
+                         bool                            useDomdec,
+                         PbcType                         pbcType);
 
 private:
     //! Number of threads used for vsite operations
     const int numThreads_;
+    //! Whether to use the SIMD kernels for virtual sites in the SIMD lists
+    const bool useSimd_;
     //! Thread local vsites and work structs
     std::vector<std::unique_ptr<VsiteThread>> tData_;
     //! Work array for dividing vsites over threads
@@ -621,6 +667,173 @@ static PbcMode getPbcMode(const t_pbc* pbcPtr)
     }
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Computes the PBC corrected distance \p x1 - \p x2, uses PBC when \p pbcSimd!=nullptr
+ *
+ * The plain difference is computed as in pbc_rvec_sub().
+ */
+static inline void gmx_simdcall simdPbcRvecSub(const real*    pbcSimd,
+                                               const SimdReal x1[DIM],
+                                               const SimdReal x2[DIM],
+                                               SimdReal       dx[DIM])
+{
+    if (pbcSimd)
+    {
+        pbc_dx_aiuc(pbcSimd, x1, x2, dx);
+    }
+    else
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            dx[d] = x1[d] - x2[d];
+        }
+    }
+}
+
+/*! \brief Computes the positions of a SIMD batch of virtual sites
+ *
+ * Uses the same operations as the scalar constr_vsite3(), constr_vsite3FD()
+ * and constr_vsite3OUT() functions.
+ */
+static inline void gmx_simdcall constructVsiteBatch(const int      ftype,
+                                                    const SimdReal xi[DIM],
+                                                    const SimdReal xj[DIM],
+                                                    const SimdReal xk[DIM],
+                                                    const SimdReal a,
+                                                    const SimdReal b,
+                                                    const SimdReal c,
+                                                    const real*    pbcSimd,
+                                                    SimdReal       x[DIM])
+{
+    if (ftype == F_VSITE3)
+    {
+        if (pbcSimd)
+        {
+            SimdReal dxj[DIM], dxk[DIM];
+            pbc_dx_aiuc(pbcSimd, xj, xi, dxj);
+            pbc_dx_aiuc(pbcSimd, xk, xi, dxk);
+            for (int d = 0; d < DIM; d++)
+            {
+                x[d] = xi[d] + a * dxj[d] + b * dxk[d];
+            }
+        }
+        else
+        {
+            const SimdReal c3 = SimdReal(1) - a - b;
+            for (int d = 0; d < DIM; d++)
+            {
+                x[d] = c3 * xi[d] + a * xj[d] + b * xk[d];
+            }
+        }
+    }
+    else if (ftype == F_VSITE3FD)
+    {
+        SimdReal xij[DIM], xjk[DIM], temp[DIM];
+        simdPbcRvecSub(pbcSimd, xj, xi, xij);
+        simdPbcRvecSub(pbcSimd, xk, xj, xjk);
+        /* temp goes from i to a point on the line jk */
+        for (int d = 0; d < DIM; d++)
+        {
+            temp[d] = xij[d] + a * xjk[d];
+        }
+        const SimdReal c3 =
+                b * invsqrt(temp[XX] * temp[XX] + temp[YY] * temp[YY] + temp[ZZ] * temp[ZZ]);
+        for (int d = 0; d < DIM; d++)
+        {
+            x[d] = xi[d] + c3 * temp[d];
+        }
+    }
+    else
+    {
+        GMX_ASSERT(ftype == F_VSITE3OUT, "Only vsite types in c_simdVsiteTypes are supported");
+
+        SimdReal xij[DIM], xik[DIM], temp[DIM];
+        simdPbcRvecSub(pbcSimd, xj, xi, xij);
+        simdPbcRvecSub(pbcSimd, xk, xi, xik);
+        temp[XX] = xij[YY] * xik[ZZ] - xij[ZZ] * xik[YY];
+        temp[YY] = xij[ZZ] * xik[XX] - xij[XX] * xik[ZZ];
+        temp[ZZ] = xij[XX] * xik[YY] - xij[YY] * xik[XX];
+        for (int d = 0; d < DIM; d++)
+        {
+            x[d] = xi[d] + a * xij[d] + b * xik[d] + c * temp[d];
+        }
+    }
+}
+
+/*! \brief Constructs the virtual sites in \p simdList using SIMD
+ *
+ * \param[in]     simdList  The virtual sites to construct
+ * \param[in,out] x         The coordinates
+ * \param[in]     invdt     1/dt, used when v is not empty
+ * \param[out]    v         When not empty, the vsite velocities are set
+ * \param[in]     pbcSimd   SIMD PBC data, nullptr when no PBC treatment is needed
+ */
+static void constructVsitesSimd(const VsiteSimdList& simdList,
+                                ArrayRef<RVec>       x,
+                                const real           invdt,
+                                ArrayRef<RVec>       v,
+                                const real*          pbcSimd)
+{
+    real*      xPtr      = as_rvec_array(x.data())[0];
+    real*      vPtr      = v.empty() ? nullptr : as_rvec_array(v.data())[0];
+    const bool needOldX  = (pbcSimd != nullptr || vPtr != nullptr);
+    SimdReal   invdtSimd = SimdReal(invdt);
+
+    for (int i = 0; i < simdList.numVsites; i += GMX_SIMD_REAL_WIDTH)
+    {
+        const int* av = simdList.vsite.data() + i;
+        const int* ai = simdList.constructing[0].data() + i;
+        const int* aj = simdList.constructing[1].data() + i;
+        const int* ak = simdList.constructing[2].data() + i;
+
+        SimdReal xi[DIM], xj[DIM], xk[DIM];
+        gatherLoadUTranspose<3>(xPtr, ai, &xi[XX], &xi[YY], &xi[ZZ]);
+        gatherLoadUTranspose<3>(xPtr, aj, &xj[XX], &xj[YY], &xj[ZZ]);
+        gatherLoadUTranspose<3>(xPtr, ak, &xk[XX], &xk[YY], &xk[ZZ]);
+
+        SimdReal xv[DIM];
+        constructVsiteBatch(simdList.ftype, xi, xj, xk,
+                            load<SimdReal>(simdList.param[0].data() + i),
+                            load<SimdReal>(simdList.param[1].data() + i),
+                            load<SimdReal>(simdList.param[2].data() + i), pbcSimd, xv);
+
+        if (needOldX)
+        {
+            SimdReal xOld[DIM];
+            gatherLoadUTranspose<3>(xPtr, av, &xOld[XX], &xOld[YY], &xOld[ZZ]);
+
+            if (pbcSimd)
+            {
+                /* Keep the vsite in the same periodic image as before */
+                SimdReal dx[DIM];
+                pbc_dx_aiuc(pbcSimd, xv, xOld, dx);
+                const SimdBool isShifted = ((xv[XX] - xOld[XX]) != dx[XX])
+                                           || ((xv[YY] - xOld[YY]) != dx[YY])
+                                           || ((xv[ZZ] - xOld[ZZ]) != dx[ZZ]);
+                for (int d = 0; d < DIM; d++)
+                {
+                    xv[d] = blend(xv[d], xOld[d] + dx[d], isShifted);
+                }
+            }
+            if (vPtr)
+            {
+                /* Calculate velocity of vsite... */
+                SimdReal vv[DIM];
+                for (int d = 0; d < DIM; d++)
+                {
+                    vv[d] = invdtSimd * (xv[d] - xOld[d]);
+                }
+                transposeScatterStoreU<3>(vPtr, av, vv[XX], vv[YY], vv[ZZ]);
+            }
+        }
+
+        transposeScatterStoreU<3>(xPtr, av, xv[XX], xv[YY], xv[ZZ]);
+    }
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 /*! \brief Executes the vsite construction task for a single thread
  *
  * \param[in,out] x   Coordinates to construct vsites for
@@ -628,6 +841,7 @@ static PbcMode getPbcMode(const t_pbc* pbcPtr)
  * \param[in,out] v   When not empty, velocities are generated for virtual sites
  * \param[in]     ip  Interaction parameters for all interaction, only vsite parameters are used
  * \param[in]     ilist  The interaction lists, only vsites are usesd
+ * \param[in]     simdLists  Vsites to construct in SIMD batches, in addition to \p ilist
  * \param[in]     pbc_null  PBC struct, used for PBC distance calculations when !=nullptr
  */
 static void construct_vsites_thread(ArrayRef<RVec>                  x,
@@ -635,6 +849,7 @@ static void construct_vsites_thread(ArrayRef<RVec>                  x,
                                     ArrayRef<RVec>                  v,
                                     ArrayRef<const t_iparams>       ip,
                                     ArrayRef<const InteractionList> ilist,
+                                    ArrayRef<const VsiteSimdList>   simdLists,
                                     const t_pbc*                    pbc_null)
 {
     real inv_dt;
@@ -651,8 +866,32 @@ static void construct_vsites_thread(ArrayRef<RVec>                  x,
     /* We need another pbc pointer, as with charge groups we switch per vsite */
     const t_pbc* pbc_null2 = pbc_null;
 
+#if GMX_SIMD_HAVE_REAL
+    alignas(GMX_SIMD_ALIGNMENT) real pbcSimdBuffer[9 * GMX_SIMD_REAL_WIDTH];
+    const real*                      pbcSimd = nullptr;
+    if (pbc_null != nullptr && !simdLists.empty())
+    {
+        set_pbc_simd(pbc_null, pbcSimdBuffer);
+        pbcSimd = pbcSimdBuffer;
+    }
+#else
+    GMX_ASSERT(simdLists.empty() || simdLists[0].numVsites == 0,
+               "Without SIMD support there should be no SIMD vsite lists");
+#endif
+
     for (int ftype = c_ftypeVsiteStart; ftype < c_ftypeVsiteEnd; ftype++)
     {
+#if GMX_SIMD_HAVE_REAL
+        /* The SIMD vsites do not depend on other vsites, so we construct them first */
+        for (const VsiteSimdList& simdList : simdLists)
+        {
+            if (simdList.ftype == ftype)
+            {
+                constructVsitesSimd(simdList, x, inv_dt, v, pbcSimd);
+            }
+        }
+#endif
+
         if (ilist[ftype].empty())
         {
             continue;
@@ -812,9 +1051,17 @@ static void construct_vsites(const ThreadingInfo*            threadingInfo,
         dd_move_x_vsites(*domainInfo.domdec_, box, as_rvec_array(x.data()));
     }
 
-    if (threadingInfo == nullptr || threadingInfo->numThreads() == 1)
+    if (threadingInfo == nullptr)
+    {
+        construct_vsites_thread(x, dt, v, ip, ilist, {}, pbc_null);
+    }
+    else if (threadingInfo->numThreads() == 1)
     {
-        construct_vsites_thread(x, dt, v, ip, ilist, pbc_null);
+        const VsiteThread& tData = threadingInfo->threadData(0);
+        GMX_ASSERT(tData.rangeStart >= 0,
+                   "The thread data should be initialized before calling construct_vsites");
+
+        construct_vsites_thread(x, dt, v, ip, tData.ilist, tData.simdLists, pbc_null);
     }
     else
     {
@@ -827,20 +1074,21 @@ static void construct_vsites(const ThreadingInfo*            threadingInfo,
                 GMX_ASSERT(tData.rangeStart >= 0,
                            "The thread data should be initialized before calling construct_vsites");
 
-                construct_vsites_thread(x, dt, v, ip, tData.ilist, pbc_null);
+                construct_vsites_thread(x, dt, v, ip, tData.ilist, tData.simdLists, pbc_null);
                 if (tData.useInterdependentTask)
                 {
                     /* Here we don't need a barrier (unlike the spreading),
                      * since both tasks only construct vsites from particles,
                      * or local vsites, not from non-local vsites.
                      */
-                    construct_vsites_thread(x, dt, v, ip, tData.idTask.ilist, pbc_null);
+                    construct_vsites_thread(x, dt, v, ip, tData.idTask.ilist, {}, pbc_null);
                 }
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
         /* Now we can construct the vsites that might depend on other vsites */
-        construct_vsites_thread(x, dt, v, ip, threadingInfo->threadDataNonLocalDependent().ilist, pbc_null);
+        construct_vsites_thread(x, dt, v, ip, threadingInfo->threadDataNonLocalDependent().ilist,
+                                {}, pbc_null);
     }
 }
 
@@ -1731,6 +1979,41 @@ static int vsite_count(ArrayRef<const InteractionList> ilist, int ftype)
     }
 }
 
+/*! \brief Spreads the forces of the virtual sites in \p simdList using the scalar kernels
+ *
+ * The spreading is not done in SIMD, since the scattered additions of
+ * the forces to the constructing atoms dominate the cost.
+ */
+template<VirialHandling virialHandling>
+static void spreadVsiteSimdListScalar(const VsiteSimdList& simdList,
+                                      ArrayRef<const RVec> x,
+                                      ArrayRef<RVec>       f,
+                                      ArrayRef<RVec>       fshift,
+                                      matrix               dxdf,
+                                      const t_pbc*         pbc_null)
+{
+    for (int i = 0; i < simdList.numVsites; i++)
+    {
+        const t_iatom ia[] = { -1, simdList.vsite[i], simdList.constructing[0][i],
+                               simdList.constructing[1][i], simdList.constructing[2][i] };
+        const real    a    = simdList.param[0][i];
+        const real    b    = simdList.param[1][i];
+        switch (simdList.ftype)
+        {
+            case F_VSITE3: spread_vsite3<virialHandling>(ia, a, b, x, f, fshift, pbc_null); break;
+            case F_VSITE3FD:
+                spread_vsite3FD<virialHandling>(ia, a, b, x, f, fshift, dxdf, pbc_null);
+                break;
+            case F_VSITE3OUT:
+                spread_vsite3OUT<virialHandling>(ia, a, b, simdList.param[2][i], x, f, fshift, dxdf,
+                                                 pbc_null);
+                break;
+            default: GMX_ASSERT(false, "Only vsite types in c_simdVsiteTypes are supported");
+        }
+        clear_rvec(f[ia[1]]);
+    }
+}
+
 //! Executes the force spreading task for a single thread
 template<VirialHandling virialHandling>
 static void spreadForceForThread(ArrayRef<const RVec>            x,
@@ -1739,6 +2022,7 @@ static void spreadForceForThread(ArrayRef<const RVec>            x,
                                  matrix                          dxdf,
                                  ArrayRef<const t_iparams>       ip,
                                  ArrayRef<const InteractionList> ilist,
+                                 ArrayRef<const VsiteSimdList>   simdLists,
                                  const t_pbc*                    pbc_null)
 {
     const PbcMode pbcMode = getPbcMode(pbc_null);
@@ -1750,11 +2034,7 @@ static void spreadForceForThread(ArrayRef<const RVec>            x,
      * higher type vsites from lower types         */
     for (int ftype = c_ftypeVsiteEnd - 1; ftype >= c_ftypeVsiteStart; ftype--)
     {
-        if (ilist[ftype].empty())
-        {
-            continue;
-        }
-
+        if (!ilist[ftype].empty())
         { // TODO remove me
             int nra = interaction_function[ftype].nratoms;
             int inc = 1 + nra;
@@ -1824,6 +2104,17 @@ static void spreadForceForThread(ArrayRef<const RVec>            x,
                 ia += inc;
             }
         }
+
+        /* Vsites above can be constructed from the SIMD vsites of this type,
+         * so we spread the forces of the SIMD vsites last.
+         */
+        for (const VsiteSimdList& simdList : simdLists)
+        {
+            if (simdList.ftype == ftype && simdList.numVsites > 0)
+            {
+                spreadVsiteSimdListScalar<virialHandling>(simdList, x, f, fshift, dxdf, pbc_null);
+            }
+        }
     }
 }
 
@@ -1836,6 +2127,7 @@ static void spreadForceWrapper(ArrayRef<const RVec>            x,
                                const bool                      clearDxdf,
                                ArrayRef<const t_iparams>       ip,
                                ArrayRef<const InteractionList> ilist,
+                               ArrayRef<const VsiteSimdList>   simdLists,
                                const t_pbc*                    pbc_null)
 {
     if (virialHandling == VirialHandling::NonLinear && clearDxdf)
@@ -1846,13 +2138,16 @@ static void spreadForceWrapper(ArrayRef<const RVec>            x,
     switch (virialHandling)
     {
         case VirialHandling::None:
-            spreadForceForThread<VirialHandling::None>(x, f, fshift, dxdf, ip, ilist, pbc_null);
+            spreadForceForThread<VirialHandling::None>(x, f, fshift, dxdf, ip, ilist,
+                                                       simdLists, pbc_null);
             break;
         case VirialHandling::Pbc:
-            spreadForceForThread<VirialHandling::Pbc>(x, f, fshift, dxdf, ip, ilist, pbc_null);
+            spreadForceForThread<VirialHandling::Pbc>(x, f, fshift, dxdf, ip, ilist,
+                                                      simdLists, pbc_null);
             break;
         case VirialHandling::NonLinear:
-            spreadForceForThread<VirialHandling::NonLinear>(x, f, fshift, dxdf, ip, ilist, pbc_null);
+            spreadForceForThread<VirialHandling::NonLinear>(x, f, fshift, dxdf, ip, ilist,
+                                                            simdLists, pbc_null);
             break;
     }
 }
@@ -1910,8 +2205,10 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
 
     if (numThreads == 1)
     {
-        matrix dxdf;
-        spreadForceWrapper(x, f, virialHandling, fshift, dxdf, true, iparams_, ilists_, pbc_null);
+        const VsiteThread& tData = threadingInfo_.threadData(0);
+        matrix             dxdf;
+        spreadForceWrapper(x, f, virialHandling, fshift, dxdf, true, iparams_, tData.ilist,
+                           tData.simdLists, pbc_null);
 
         if (virialHandling == VirialHandling::NonLinear)
         {
@@ -1929,7 +2226,7 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
         /* First spread the vsites that might depend on non-local vsites */
         auto& nlDependentVSites = threadingInfo_.threadDataNonLocalDependent();
         spreadForceWrapper(x, f, virialHandling, fshift, nlDependentVSites.dxdf, true, iparams_,
-                           nlDependentVSites.ilist, pbc_null);
+                           nlDependentVSites.ilist, {}, pbc_null);
 
 #pragma omp parallel num_threads(numThreads)
         {
@@ -1975,7 +2272,7 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
                         copy_rvec(f[idTask->vsite[i]], idTask->force[idTask->vsite[i]]);
                     }
                     spreadForceWrapper(x, idTask->force, virialHandling, fshift_t, tData.dxdf, true,
-                                       iparams_, tData.idTask.ilist, pbc_null);
+                                       iparams_, tData.idTask.ilist, {}, pbc_null);
 
                     /* We need a barrier before reducing forces below
                      * that have been produced by a different thread above.
@@ -2012,7 +2309,7 @@ void VirtualSitesHandler::Impl::spreadForces(ArrayRef<const RVec> x,
 
                 /* Spread the vsites that spread locally only */
                 spreadForceWrapper(x, f, virialHandling, fshift_t, tData.dxdf, false, iparams_,
-                                   tData.ilist, pbc_null);
+                                   tData.ilist, tData.simdLists, pbc_null);
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
@@ -2191,7 +2488,9 @@ std::unique_ptr<VirtualSitesHandler> makeVirtualSitesHandler(const gmx_mtop_t& m
     return std::make_unique<VirtualSitesHandler>(mtop, cr->dd, pbcType);
 }
 
-ThreadingInfo::ThreadingInfo() : numThreads_(gmx_omp_nthreads_get(emntVSITE))
+ThreadingInfo::ThreadingInfo() :
+    numThreads_(gmx_omp_nthreads_get(emntVSITE)),
+    useSimd_(GMX_SIMD_HAVE_REAL && getenv("GMX_DISABLE_SIMD_KERNELS") == nullptr)
 {
     if (numThreads_ > 1)
     {
@@ -2215,6 +2514,12 @@ ThreadingInfo::ThreadingInfo() : numThreads_(gmx_omp_nthreads_get(emntVSITE))
             tData_[numThreads_] = std::make_unique<VsiteThread>();
         }
     }
+    else
+    {
+        /* A single task, used for the SIMD lists */
+        tData_.resize(1);
+        tData_[0] = std::make_unique<VsiteThread>();
+    }
 }
 
 //! Returns the number of inter update-group vsites
@@ -2432,14 +2737,109 @@ static void assignVsitesToSingleTask(VsiteThread*                    tData,
     }
 }
 
+/*! \brief Moves the vsites that do not depend on other vsites from \p ilist to \p simdLists
+ *
+ * Only the vsite types in c_simdVsiteTypes are moved, the order of
+ * the remaining entries in \p ilist is preserved.
+ */
+static void moveIndependentVsitesToSimdLists(ArrayRef<InteractionList> ilist,
+                                             VsiteSimdLists*           simdLists,
+                                             ArrayRef<const t_iparams> ip,
+                                             const unsigned short*     ptype)
+{
+    for (VsiteSimdList& simdList : *simdLists)
+    {
+        simdList.vsite.clear();
+        for (int n = 0; n < 3; n++)
+        {
+            simdList.constructing[n].clear();
+            simdList.param[n].clear();
+        }
+
+        const int         ftype        = simdList.ftype;
+        const int         nral1        = 1 + NRAL(ftype);
+        std::vector<int>& iatoms       = ilist[ftype].iatoms;
+        size_t            numRemaining = 0;
+        for (size_t i = 0; i < iatoms.size(); i += nral1)
+        {
+            const int* ia            = iatoms.data() + i;
+            bool       isIndependent = true;
+            for (int j = 2; j < nral1; j++)
+            {
+                isIndependent = isIndependent && (ptype[ia[j]] != eptVSite);
+            }
+
+            if (isIndependent)
+            {
+                simdList.vsite.push_back(ia[1]);
+                for (int n = 0; n < 3; n++)
+                {
+                    simdList.constructing[n].push_back(ia[2 + n]);
+                }
+                simdList.param[0].push_back(ip[ia[0]].vsite.a);
+                simdList.param[1].push_back(ip[ia[0]].vsite.b);
+                simdList.param[2].push_back(ip[ia[0]].vsite.c);
+            }
+            else
+            {
+                std::copy(iatoms.begin() + i, iatoms.begin() + i + nral1,
+                          iatoms.begin() + numRemaining);
+                numRemaining += nral1;
+            }
+        }
+        iatoms.resize(numRemaining);
+
+        simdList.numVsites = simdList.vsite.size();
+#if GMX_SIMD_HAVE_REAL
+        /* Pad the lists to a multiple of the SIMD width with the last vsite */
+        while (simdList.vsite.size() % GMX_SIMD_REAL_WIDTH != 0)
+        {
+            simdList.vsite.push_back(simdList.vsite.back());
+            for (int n = 0; n < 3; n++)
+            {
+                simdList.constructing[n].push_back(simdList.constructing[n].back());
+                simdList.param[n].push_back(simdList.param[n].back());
+            }
+        }
+#endif
+    }
+}
+
+//! Returns the number of vsites in the SIMD lists
+static int vsiteSimdListsCount(const VsiteSimdLists& simdLists)
+{
+    int n = 0;
+    for (const VsiteSimdList& simdList : simdLists)
+    {
+        n += simdList.numVsites;
+    }
+
+    return n;
+}
+
 void ThreadingInfo::setVirtualSites(ArrayRef<const InteractionList> ilists,
                                     ArrayRef<const t_iparams>       iparams,
                                     const t_mdatoms&                mdatoms,
-                                    const bool                      useDomdec)
+                                    const bool                      useDomdec,
+                                    const PbcType                   pbcType)
 {
+    const bool useSimdLists = (useSimd_ && pbcType != PbcType::Screw);
+
     if (numThreads_ <= 1)
     {
-        /* Nothing to do */
+        /* A single task containing all vsites */
+        VsiteThread& tData = *tData_[0];
+        tData.rangeStart   = 0;
+        tData.rangeEnd     = mdatoms.nr;
+        for (int ftype = c_ftypeVsiteStart; ftype < c_ftypeVsiteEnd; ftype++)
+        {
+            tData.ilist[ftype] = ilists[ftype];
+        }
+        if (useSimdLists)
+        {
+            moveIndependentVsitesToSimdLists(tData.ilist, &tData.simdLists, iparams, mdatoms.ptype);
+        }
+
         return;
     }
 
@@ -2613,6 +3013,11 @@ void ThreadingInfo::setVirtualSites(ArrayRef<const InteractionList> ilists,
             }
             assignVsitesToThread(&tData, thread, numThreads_, natperthread, taskIndex_, ilists,
                                  iparams, mdatoms.ptype);
+            if (useSimdLists)
+            {
+                moveIndependentVsitesToSimdLists(tData.ilist, &tData.simdLists, iparams,
+                                                 mdatoms.ptype);
+            }
 
             if (tData.useInterdependentTask)
             {
@@ -2675,6 +3080,13 @@ void ThreadingInfo::setVirtualSites(ArrayRef<const InteractionList> ilists,
                 fprintf(debug, "\n");
             }
         }
+
+        fprintf(debug, "virtual sites in SIMD lists per thread:");
+        for (int th = 0; th < numThreads_; th++)
+        {
+            fprintf(debug, " %4d", vsiteSimdListsCount(tData_[th]->simdLists));
+        }
+        fprintf(debug, "\n");
     }
 
 #ifndef NDEBUG
@@ -2683,6 +3095,10 @@ void ThreadingInfo::setVirtualSites(ArrayRef<const InteractionList> ilists,
     for (int th = 0; th < numThreads_ + 1; th++)
     {
         nrThreaded += vsiteIlistNrCount(tData_[th]->ilist) + vsiteIlistNrCount(tData_[th]->idTask.ilist);
+        for (const VsiteSimdList& simdList : tData_[th]->simdLists)
+        {
+            nrThreaded += simdList.numVsites * (1 + NRAL(simdList.ftype));
+        }
     }
     GMX_ASSERT(nrThreaded == nrOrig,
                "The number of virtual sites assigned to all thread task has to match the total "
@@ -2695,7 +3111,8 @@ void VirtualSitesHandler::Impl::setVirtualSites(ArrayRef<const InteractionList>
 {
     ilists_ = ilists;
 
-    threadingInfo_.setVirtualSites(ilists, iparams_, mdatoms, domainInfo_.useDomdec());
+    threadingInfo_.setVirtualSites(ilists, iparams_, mdatoms, domainInfo_.useDomdec(),
+                                   domainInfo_.pbcType_);
 }
 
 void VirtualSitesHandler::setVirtualSites(ArrayRef<const InteractionList> ilists, const t_mdatoms& mdatoms)
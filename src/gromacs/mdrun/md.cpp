@@ -302,6 +302,11 @@ void gmx::LegacySimulator::do_md()
     /* Check for polarizable models and flexible constraints */
     shellfc = init_shell_flexcon(fplog, top_global, constr ? constr->numFlexibleConstraints() : 0,
                                  ir->nstcalcenergy, DOMAINDECOMP(cr));
+    if (shellfc && ir->useMts)
+    {
+        gmx_fatal(FARGS,
+                  "Multiple time stepping is not supported with shells or flexible constraints");
+    }
 
     {
         double io = compute_io(ir, top_global->natoms, *groups, energyOutput.numEnergyTerms(), 1);
@@ -472,7 +477,7 @@ void gmx::LegacySimulator::do_md()
     if (bPMETune)
     {
         pme_loadbal_init(&pme_loadbal, cr, mdlog, *ir, state->box, *fr->ic, *fr->nbv, fr->pmedata,
-                         fr->nbv->useGpu());
+                         fr->nbv->useGpu(), useGpuForPme);
     }
 
     if (!ir->bContinuation)
@@ -1322,17 +1327,56 @@ void gmx::LegacySimulator::do_md()
         }
         else
         {
-            upd.update_coords(*ir, step, mdatoms, state, f.arrayRefWithPadding(), fcdata, ekind, M,
-                              etrtPOSITION, cr, constr != nullptr);
+            /* With multiple time stepping we need to do an additional normal
+             * update step to obtain the constraint virial, as the actual MTS
+             * update uses forces where the slow forces are scaled by the MTS
+             * factor, which would result in an incorrect constraint virial.
+             */
+            if (fr->useMts && bCalcVir && constr != nullptr)
+            {
+                upd.update_for_constraint_virial(*ir, *mdatoms, *state, f.arrayRefWithPadding());
 
-            wallcycle_stop(wcycle, ewcUPDATE);
+                wallcycle_stop(wcycle, ewcUPDATE);
+                real dvdlConstraintVirialUpdate = 0;
+                constrain_coordinates(constr, false, false, step, state,
+                                      upd.xp()->arrayRefWithPadding(), &dvdlConstraintVirialUpdate,
+                                      bCalcVir, shake_vir);
+                wallcycle_start_nocount(wcycle, ewcUPDATE);
+            }
 
-            constrain_coordinates(constr, do_log, do_ene, step, state,
-                                  upd.xp()->arrayRefWithPadding(), &dvdl_constr, bCalcVir, shake_vir);
+            /* With MTS, on steps where the slow forces are computed, we integrate
+             * with the fast forces plus the slow forces scaled by the MTS factor.
+             */
+            const bool useMtsCombinedForces =
+                    (fr->useMts && step % ir->mtsLevels[gmx::c_numMtsLevels - 1].stepFactor == 0);
+            ArrayRefWithPadding<const RVec> forceForUpdate =
+                    (useMtsCombinedForces ? fr->forceHelperBuffers->forceMtsCombined()
+                                          : f.arrayRefWithPadding());
+            /* With MTS the constraint virial was computed above */
+            const bool computeConstraintVirial = (bCalcVir && !fr->useMts);
+
+            if (upd.canFuseUpdateAndConstraints(*ir, mdatoms, constr))
+            {
+                /* Update, SETTLE and copy back while the atoms are in cache */
+                upd.update_coords_constrain_fused(*ir, step, mdatoms, state, forceForUpdate, fcdata,
+                                                  ekind, M, constr, do_log, do_ene, &dvdl_constr,
+                                                  computeConstraintVirial, shake_vir, wcycle);
+            }
+            else
+            {
+                upd.update_coords(*ir, step, mdatoms, state, forceForUpdate, fcdata, ekind, M,
+                                  etrtPOSITION, cr, constr != nullptr);
 
-            upd.update_sd_second_half(*ir, step, &dvdl_constr, mdatoms, state, cr, nrnb, wcycle,
-                                      constr, do_log, do_ene);
-            upd.finish_update(*ir, mdatoms, state, wcycle, constr != nullptr);
+                wallcycle_stop(wcycle, ewcUPDATE);
+
+                constrain_coordinates(constr, do_log, do_ene, step, state,
+                                      upd.xp()->arrayRefWithPadding(), &dvdl_constr,
+                                      computeConstraintVirial, shake_vir);
+
+                upd.update_sd_second_half(*ir, step, &dvdl_constr, mdatoms, state, cr, nrnb,
+                                          wcycle, constr, do_log, do_ene);
+                upd.finish_update(*ir, mdatoms, state, wcycle, constr != nullptr);
+            }
         }
 
         if (ir->bPull && ir->pull->bSetPbcRefToPrevStepCOM)
@@ -229,6 +229,10 @@ void gmx::LegacySimulator::do_rerun()
     {
         gmx_fatal(FARGS, "AWH not supported by rerun.");
     }
+    if (ir->useMts)
+    {
+        gmx_fatal(FARGS, "Multiple time stepping not supported by rerun.");
+    }
     if (replExParams.exchangeInterval > 0)
     {
         gmx_fatal(FARGS, "Replica exchange not supported by rerun.");
@@ -67,6 +67,7 @@
 #include "gromacs/ewald/pme_gpu_program.h"
 #include "gromacs/ewald/pme_only.h"
 #include "gromacs/ewald/pme_pp_comm_gpu.h"
+#include "gromacs/fft/fft.h"
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/oenv.h"
@@ -658,6 +659,11 @@ static void finish_run(FILE*                     fplog,
         print_dd_statistics(cr, inputrec, fplog);
     }
 
+    if (printReport && fplog != nullptr && nbv != nullptr)
+    {
+        nbv->printGridPaddingStatistics(fplog, true);
+    }
+
     /* TODO Move the responsibility for any scaling by thread counts
      * to the code that handled the thread region, so that there's a
      * mechanism to keep cycle counting working during the transition
@@ -1132,8 +1138,8 @@ int Mdrunner::mdrunner()
     if (useDomainDecomposition)
     {
         ddBuilder = std::make_unique<DomainDecompositionBuilder>(
-                mdlog, cr, domdecOptions, mdrunOptions, prefer1DAnd1PulseDD, mtop, *inputrec, box,
-                positionsFromStatePointer(globalState.get()));
+                mdlog, cr, domdecOptions, mdrunOptions, prefer1DAnd1PulseDD, mtop, *inputrec,
+                *hwinfo->hardwareTopology, box, positionsFromStatePointer(globalState.get()));
     }
     else
     {
@@ -1708,6 +1714,12 @@ int Mdrunner::mdrunner()
         gmx_pme_destroy(pmedata);
         pmedata = nullptr;
     }
+    // Store the FFTW wisdom of the plans measured during this run. Only the master
+    // rank writes, so ranks sharing the wisdom file do not race for it.
+    if (MASTER(cr))
+    {
+        gmx_fft_export_wisdom();
+    }
 
     // FIXME: this is only here to manually unpin mdAtoms->chargeA_ and state->x,
     // before we destroy the GPU context(s) in free_gpu().
@@ -42,6 +42,7 @@
 #include <memory>
 #include <vector>
 
+#include "gromacs/math/paddedvector.h"
 #include "gromacs/math/vectypes.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/pbcutil/pbc.h"
@@ -142,8 +143,10 @@ public:
      * have direct virial contributions, set the parameter to true, so
      * an extra force buffer is available for these forces to enable
      * correct virial computation.
+     * With multiple time stepping, set \p useMts to true to get buffers
+     * for the slow forces and for the combined forces used in the update.
      */
-    ForceHelperBuffers(bool haveDirectVirialContributions);
+    ForceHelperBuffers(bool haveDirectVirialContributions, bool useMts);
 
     //! Returns whether we have a direct virial contribution force buffer
     bool haveDirectVirialContributions() const { return haveDirectVirialContributions_; }
@@ -158,7 +161,25 @@ public:
     //! Returns the buffer for shift forces, size SHIFTS
     gmx::ArrayRef<gmx::RVec> shiftForces() { return shiftForces_; }
 
-    //! Resizes the direct virial contribution buffer, when present
+    //! Returns the buffer for the slow forces with multiple time stepping
+    gmx::ArrayRef<gmx::RVec> forceBufferMtsLevel1()
+    {
+        GMX_ASSERT(useMts_, "Buffer can only be requested with MTS");
+        return forceBufferMtsLevel1_;
+    }
+
+    /*! \brief Returns the buffer for the combined MTS forces
+     *
+     * On steps where the slow forces are computed, this buffer contains
+     * the fast forces plus the step factor times the slow forces.
+     */
+    gmx::ArrayRefWithPadding<gmx::RVec> forceMtsCombined()
+    {
+        GMX_ASSERT(useMts_, "Buffer can only be requested with MTS");
+        return forceMtsCombined_.arrayRefWithPadding();
+    }
+
+    //! Resizes the direct virial contribution and MTS buffers, when present
     void resize(int numAtoms);
 
 private:
@@ -168,6 +189,12 @@ private:
     std::vector<gmx::RVec> forceBufferForDirectVirialContributions_;
     //! Shift force array for computing the virial, size SHIFTS
     std::vector<gmx::RVec> shiftForces_;
+    //! Whether we use multiple time stepping
+    bool useMts_ = false;
+    //! Force buffer for the slow forces with multiple time stepping
+    std::vector<gmx::RVec> forceBufferMtsLevel1_;
+    //! Force buffer for the combined fast and scaled slow forces with multiple time stepping
+    gmx::PaddedVector<gmx::RVec> forceMtsCombined_;
 };
 
 struct t_forcerec
@@ -285,6 +312,9 @@ struct t_forcerec
      */
     int n_tpi = 0;
 
+    //! Whether we use multiple time stepping
+    bool useMts = false;
+
     /* Limit for printing large forces, negative is don't print */
     real print_force = 0;
 
@@ -813,6 +813,17 @@ void pr_inputrec(FILE* fp, int indent, const char* title, const t_inputrec* ir,
         PS("comm-mode", ECOM(ir->comm_mode));
         PI("nstcomm", ir->nstcomm);
 
+        /* Multiple time stepping */
+        PS("mts", EBOOL(ir->useMts));
+        if (ir->useMts)
+        {
+            const gmx::MtsLevel& mtsLevel2 = ir->mtsLevels[1];
+
+            PI("mts-levels", gmx::c_numMtsLevels);
+            PS("mts-level2-forces", gmx::mtsForceGroupsToString(mtsLevel2).c_str());
+            PI("mts-level2-factor", mtsLevel2.stepFactor);
+        }
+
         /* Langevin dynamics */
         PR("bd-fric", ir->bd_fric);
         PSTEP("ld-seed", ir->ld_seed);
@@ -1293,6 +1304,15 @@ void cmp_inputrec(FILE* fp, const t_inputrec* ir1, const t_inputrec* ir2, real f
     cmp_int(fp, "inputrec->nstxout_compressed", -1, ir1->nstxout_compressed, ir2->nstxout_compressed);
     cmp_double(fp, "inputrec->init_t", -1, ir1->init_t, ir2->init_t, ftol, abstol);
     cmp_double(fp, "inputrec->delta_t", -1, ir1->delta_t, ir2->delta_t, ftol, abstol);
+    cmp_bool(fp, "inputrec->useMts", -1, ir1->useMts, ir2->useMts);
+    if (ir1->useMts && ir2->useMts)
+    {
+        cmp_int(fp, "inputrec->mtsLevels[1].forceGroups", -1,
+                static_cast<int>(ir1->mtsLevels[1].forceGroups.to_ulong()),
+                static_cast<int>(ir2->mtsLevels[1].forceGroups.to_ulong()));
+        cmp_int(fp, "inputrec->mtsLevels[1].stepFactor", -1, ir1->mtsLevels[1].stepFactor,
+                ir2->mtsLevels[1].stepFactor);
+    }
     cmp_real(fp, "inputrec->x_compression_precision", -1, ir1->x_compression_precision,
              ir2->x_compression_precision, ftol, abstol);
     cmp_real(fp, "inputrec->fourierspacing", -1, ir1->fourier_spacing, ir2->fourier_spacing, ftol, abstol);
@@ -0,0 +1,168 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements the multiple time stepping helper functions.
+ *
+ * \ingroup module_mdtypes
+ */
+#include "gmxpre.h"
+
+#include "multipletimestepping.h"
+
+#include "gromacs/mdtypes/awh_params.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/pull_params.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+int forceGroupMtsFactor(const t_inputrec& ir, const MtsForceGroups forceGroup)
+{
+    if (!ir.useMts)
+    {
+        return 1;
+    }
+
+    GMX_ASSERT(ir.mtsLevels[0].stepFactor == 1, "The first MTS level should have step factor 1");
+
+    const MtsLevel& slowLevel = ir.mtsLevels[c_numMtsLevels - 1];
+
+    return slowLevel.forceGroups[static_cast<int>(forceGroup)] ? slowLevel.stepFactor : 1;
+}
+
+std::string mtsForceGroupsToString(const MtsLevel& mtsLevel)
+{
+    std::string forceGroupsString;
+    for (const auto forceGroup : keysOf(mtsForceGroupNames))
+    {
+        if (mtsLevel.forceGroups[static_cast<int>(forceGroup)])
+        {
+            if (!forceGroupsString.empty())
+            {
+                forceGroupsString += " ";
+            }
+            forceGroupsString += mtsForceGroupNames[forceGroup];
+        }
+    }
+
+    return forceGroupsString;
+}
+
+namespace
+{
+
+//! Adds an error to \p errors when \p nst is not a multiple of the MTS step factor
+void checkMtsInterval(std::vector<std::string>* errors, const char* name, const int nst,
+                      const int mtsFactor)
+{
+    if (nst % mtsFactor != 0)
+    {
+        errors->push_back(formatString(
+                "With multiple time stepping, %s should be a multiple of mts-level2-factor", name));
+    }
+}
+
+} // namespace
+
+std::vector<std::string> checkMtsRequirements(const t_inputrec& ir)
+{
+    std::vector<std::string> errors;
+
+    if (!ir.useMts)
+    {
+        return errors;
+    }
+
+    if (ir.eI != eiMD)
+    {
+        errors.push_back(formatString("Multiple time stepping is only supported with integrator %s",
+                                      ei_names[eiMD]));
+    }
+
+    const MtsLevel& slowLevel = ir.mtsLevels[c_numMtsLevels - 1];
+    const int       mtsFactor = slowLevel.stepFactor;
+
+    if (mtsFactor <= 1)
+    {
+        errors.push_back("mts-level2-factor should be larger than 1");
+        return errors;
+    }
+    if (slowLevel.forceGroups.none())
+    {
+        errors.push_back("With multiple time stepping, mts-level2-forces should not be empty");
+    }
+
+    /* Energies, the virial and output forces are only complete on steps
+     * where the slow forces are computed.
+     */
+    checkMtsInterval(&errors, "nstcalcenergy", ir.nstcalcenergy, mtsFactor);
+    checkMtsInterval(&errors, "nstenergy", ir.nstenergy, mtsFactor);
+    checkMtsInterval(&errors, "nstlog", ir.nstlog, mtsFactor);
+    checkMtsInterval(&errors, "nstfout", ir.nstfout, mtsFactor);
+    if (ir.epc != epcNO)
+    {
+        checkMtsInterval(&errors, "nstpcouple", ir.nstpcouple, mtsFactor);
+    }
+    if (ir.efep != efepNO)
+    {
+        checkMtsInterval(&errors, "nstdhdl", ir.fepvals->nstdhdl, mtsFactor);
+    }
+
+    const int pullMtsFactor = forceGroupMtsFactor(ir, MtsForceGroups::Pull);
+    if (ir.bPull && pullMtsFactor > 1)
+    {
+        checkMtsInterval(&errors, "pull-nstxout", ir.pull->nstxout, pullMtsFactor);
+        checkMtsInterval(&errors, "pull-nstfout", ir.pull->nstfout, pullMtsFactor);
+    }
+    if (ir.bDoAwh)
+    {
+        if (forceGroupMtsFactor(ir, MtsForceGroups::Awh) != pullMtsFactor)
+        {
+            errors.push_back(
+                    "With multiple time stepping, awh and pull should be in the same MTS level");
+        }
+        else if (pullMtsFactor > 1)
+        {
+            checkMtsInterval(&errors, "awh-nstsample", ir.awhParams->nstSampleCoord, pullMtsFactor);
+        }
+    }
+
+    return errors;
+}
+
+} // namespace gmx
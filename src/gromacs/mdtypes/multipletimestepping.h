@@ -0,0 +1,104 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares the settings and helper functions for multiple time stepping.
+ *
+ * With multiple time stepping (MTS) the slow force components, such as
+ * the PME mesh part, are only computed every stepFactor steps. On those
+ * steps they are applied with a weight of stepFactor in the update,
+ * following the r-RESPA impulse scheme.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdtypes
+ */
+#ifndef GMX_MDTYPES_MULTIPLETIMESTEPPING_H
+#define GMX_MDTYPES_MULTIPLETIMESTEPPING_H
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+#include "gromacs/utility/enumerationhelpers.h"
+
+struct t_inputrec;
+
+namespace gmx
+{
+
+//! Force groups that can be assigned to a multiple time stepping level
+enum class MtsForceGroups : int
+{
+    LongrangeNonbonded, //!< PME-mesh or Ewald reciprocal space, for Coulomb and/or LJ
+    Pull,               //!< COM pulling
+    Awh,                //!< Accelerated weight histogram method
+    Count               //!< The number of groups above
+};
+
+//! Names of the MTS force groups, as used in the mdp file
+static const EnumerationArray<MtsForceGroups, std::string> mtsForceGroupNames = {
+    { "longrange-nonbonded", "pull", "awh" }
+};
+
+//! Settings for a single multiple time stepping level
+struct MtsLevel
+{
+    //! The force groups computed at this level
+    std::bitset<static_cast<int>(MtsForceGroups::Count)> forceGroups;
+    //! The factor between the base, fastest, time step and the time step of this level
+    int stepFactor;
+};
+
+//! The number of MTS levels, currently only a fast and a slow level are supported
+static constexpr int c_numMtsLevels = 2;
+
+/*! \brief Returns the interval in steps at which the forces of \p forceGroup are computed
+ *
+ * Returns 1 when MTS is not active or the group is part of the fast level.
+ */
+int forceGroupMtsFactor(const t_inputrec& ir, MtsForceGroups forceGroup);
+
+//! Returns the names of the force groups of \p mtsLevel separated by spaces
+std::string mtsForceGroupsToString(const MtsLevel& mtsLevel);
+
+/*! \brief Checks whether the input parameters are compatible with the MTS settings
+ *
+ * \returns A list of error messages, empty when the settings are valid
+ */
+std::vector<std::string> checkMtsRequirements(const t_inputrec& ir);
+
+} // namespace gmx
+
+#endif
@@ -114,6 +114,17 @@ typedef struct
  */
 #define MAX_CGCGSIZE 32
 
+/* The maximum number of i-particles in an entry of a free-energy pair list */
+constexpr int c_fepListMaxIClusterSize = 4;
+
+/* Values of excl_fep for the pairs in a free-energy pair list */
+enum
+{
+    efepPairExcluded, /* Excluded pair, only reciprocal space corrections */
+    efepPairIncluded, /* Interacting pair */
+    efepPairAbsent    /* No pair, only in lists with more than one i-particle per entry */
+};
+
 typedef struct t_nblist
 {
     int igeometry; /* The type of list (atom, water, etc.)  */
@@ -125,6 +136,8 @@ typedef struct t_nblist
                       gmx_nblist_interaction_type           */
 
     int     nri, maxnri; /* Current/max number of i particles	   */
+    int     iClusterSize; /* The number of i-particles per entry,
+                             iinr and excl_fep are strided by this */
     int     nrj, maxnrj; /* Current/max number of j particles	   */
     int*    iinr;        /* The i-elements                        */
     int*    iinr_end;    /* The end atom, only with enlistCG      */
@@ -152,6 +165,13 @@ typedef struct t_nblist
 
 } t_nblist;
 
+/* With iClusterSize > 1, as used for free-energy lists without energy
+ * groups, entry N has the i-atoms iinr[N*iClusterSize + I], where
+ * unused slots are -1, which share the j-atom list of the entry.
+ * The state of the pair of i-atom I with j-atom JI is then given by
+ * excl_fep[JI*iClusterSize + I].
+ */
+
 /* For atom I =  nblist->iinr[N] (0 <= N < nblist->nri) there can be
  * several neighborlists (N's), for different energy groups (gid) and
  * different shifts (shift).
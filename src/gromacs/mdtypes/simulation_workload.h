@@ -81,6 +81,8 @@ public:
     bool computeListedForces = false;
     //! Whether this step DHDL needs to be computed
     bool computeDhdl = false;
+    //! Whether the slow forces need to be computed this step, always set without MTS
+    bool computeSlowForces = true;
     /*! \brief Whether coordinate buffer ops are done on the GPU this step
      * \note This technically belongs to DomainLifetimeWorkload but due
      * to needing the flag before DomainLifetimeWorkload is built we keep
@@ -47,6 +47,7 @@
 #include "gromacs/mdlib/mdoutf.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/mdtypes/state.h"
+#include "gromacs/timing/wallcycle.h"
 
 #include "trajectoryelement.h"
 
@@ -126,9 +127,12 @@ void CheckpointHelper::writeCheckpoint(Step step, Time time)
         client->writeCheckpoint(localStateInstance_, state_global_);
     }
 
+    // As in the legacy simulator, checkpoint writing is counted as trajectory writing
+    wallcycle_start(mdoutf_get_wcycle(trajectoryElement_->outf_), ewcTRAJ);
     mdoutf_write_to_trajectory_files(fplog_, cr_, trajectoryElement_->outf_, MDOF_CPT,
                                      globalNumAtoms_, step, time, localStateInstance_,
                                      state_global_, observablesHistory_, ArrayRef<RVec>());
+    wallcycle_stop(mdoutf_get_wcycle(trajectoryElement_->outf_), ewcTRAJ);
 }
 
 SignallerCallbackPtr CheckpointHelper::registerLastStepCallback()
@@ -407,6 +407,10 @@ bool ModularSimulator::isInputCompatible(bool                             exitOn
     isInputCompatible =
             isInputCompatible
             && conditionalAssert(!doRerun, "Rerun is not supported by the modular simulator.");
+    isInputCompatible = isInputCompatible
+                        && conditionalAssert(!inputrec->useMts,
+                                             "Multiple time stepping is not supported by the "
+                                             "modular simulator.");
     isInputCompatible =
             isInputCompatible
             && conditionalAssert(
@@ -71,7 +71,8 @@ PmeLoadBalanceHelper::PmeLoadBalanceHelper(bool                 isVerbose,
                                            const MDLogger&      mdlog,
                                            const t_inputrec*    inputrec,
                                            gmx_wallcycle*       wcycle,
-                                           t_forcerec*          fr) :
+                                           t_forcerec*          fr,
+                                           bool                 useGpuForPme) :
     pme_loadbal_(nullptr),
     nextNSStep_(-1),
     isVerbose_(isVerbose),
@@ -82,7 +83,8 @@ PmeLoadBalanceHelper::PmeLoadBalanceHelper(bool                 isVerbose,
     mdlog_(mdlog),
     inputrec_(inputrec),
     wcycle_(wcycle),
-    fr_(fr)
+    fr_(fr),
+    useGpuForPme_(useGpuForPme)
 {
 }
 
@@ -92,7 +94,7 @@ void PmeLoadBalanceHelper::setup()
     GMX_RELEASE_ASSERT(box[0][0] != 0 && box[1][1] != 0 && box[2][2] != 0,
                        "PmeLoadBalanceHelper cannot be initialized with zero box.");
     pme_loadbal_init(&pme_loadbal_, cr_, mdlog_, *inputrec_, box, *fr_->ic, *fr_->nbv, fr_->pmedata,
-                     fr_->nbv->useGpu());
+                     fr_->nbv->useGpu(), useGpuForPme_);
 }
 
 void PmeLoadBalanceHelper::run(gmx::Step step, gmx::Time gmx_unused time)
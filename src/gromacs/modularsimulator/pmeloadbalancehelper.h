@@ -82,7 +82,8 @@ public:
                          const MDLogger&      mdlog,
                          const t_inputrec*    inputrec,
                          gmx_wallcycle*       wcycle,
-                         t_forcerec*          fr);
+                         t_forcerec*          fr,
+                         bool                 useGpuForPme);
 
     //! Initialize the load balancing object
     void setup();
@@ -132,6 +133,8 @@ private:
     gmx_wallcycle* wcycle_;
     //! Parameters for force calculations.
     t_forcerec* fr_;
+    //! Whether PME runs on a GPU.
+    const bool useGpuForPme_;
 };
 
 } // namespace gmx
@@ -45,6 +45,7 @@
 
 #include "bench_setup.h"
 
+#include <chrono>
 #include <optional>
 
 #include "gromacs/gmxlib/nrnb.h"
@@ -71,6 +72,8 @@
 #include "gromacs/utility/enumerationhelpers.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/logger.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
 
 #include "bench_system.h"
 
@@ -166,6 +169,39 @@ static interaction_const_t setupInteractionConst(const KernelBenchOptions& optio
     return ic;
 }
 
+//! Returns the atom information for the given benchmark options and system
+static gmx::ArrayRef<const int> atomInfoForBenchInstance(const KernelBenchOptions&   options,
+                                                         const gmx::BenchmarkSystem& system)
+{
+    if (options.useHalfLJOptimization)
+    {
+        return system.atomInfoOxygenVdw;
+    }
+    else
+    {
+        return system.atomInfoAllVdw;
+    }
+}
+
+//! Puts the system on the grid and constructs the local pairlist, i.e. performs a pair search
+static void putOnGridAndConstructPairlist(nonbonded_verlet_t*         nbv,
+                                          const KernelBenchOptions&   options,
+                                          const gmx::BenchmarkSystem& system,
+                                          t_nrnb*                     nrnb)
+{
+    GMX_RELEASE_ASSERT(!TRICLINIC(system.box), "Only rectangular unit-cells are supported here");
+    const rvec lowerCorner = { 0, 0, 0 };
+    const rvec upperCorner = { system.box[XX][XX], system.box[YY][YY], system.box[ZZ][ZZ] };
+
+    const real atomDensity = system.coordinates.size() / det(system.box);
+
+    nbnxn_put_on_grid(nbv, system.box, 0, lowerCorner, upperCorner, nullptr,
+                      { 0, int(system.coordinates.size()) }, atomDensity,
+                      atomInfoForBenchInstance(options, system), system.coordinates, 0, nullptr);
+
+    nbv->constructPairlist(gmx::InteractionLocality::Local, system.excls, 0, nrnb);
+}
+
 //! Sets up and returns a Nbnxm object for the given benchmark options and system
 static std::unique_ptr<nonbonded_verlet_t> setupNbnxmForBenchInstance(const KernelBenchOptions& options,
                                                                       const gmx::BenchmarkSystem& system)
@@ -205,29 +241,9 @@ static std::unique_ptr<nonbonded_verlet_t> setupNbnxmForBenchInstance(const Kern
 
     t_nrnb nrnb;
 
-    GMX_RELEASE_ASSERT(!TRICLINIC(system.box), "Only rectangular unit-cells are supported here");
-    const rvec lowerCorner = { 0, 0, 0 };
-    const rvec upperCorner = { system.box[XX][XX], system.box[YY][YY], system.box[ZZ][ZZ] };
+    putOnGridAndConstructPairlist(nbv.get(), options, system, &nrnb);
 
-    gmx::ArrayRef<const int> atomInfo;
-    if (options.useHalfLJOptimization)
-    {
-        atomInfo = system.atomInfoOxygenVdw;
-    }
-    else
-    {
-        atomInfo = system.atomInfoAllVdw;
-    }
-
-    const real atomDensity = system.coordinates.size() / det(system.box);
-
-    nbnxn_put_on_grid(nbv.get(), system.box, 0, lowerCorner, upperCorner, nullptr,
-                      { 0, int(system.coordinates.size()) }, atomDensity, atomInfo,
-                      system.coordinates, 0, nullptr);
-
-    nbv->constructPairlist(gmx::InteractionLocality::Local, system.excls, 0, &nrnb);
-
-    nbv->setAtomProperties(system.atomTypes, system.charges, atomInfo);
+    nbv->setAtomProperties(system.atomTypes, system.charges, atomInfoForBenchInstance(options, system));
 
     return nbv;
 }
@@ -261,13 +277,52 @@ static void expandSimdOptionAndPushBack(const KernelBenchOptions&        options
     }
 }
 
-//! Sets up and runs the requested benchmark instance and prints the results
+/*! \brief Expands each entry in \p optionsList into all kernel flavors
+ *
+ * The flavors are with and without energy computation and, for SIMD kernels
+ * with Ewald electrostatics, tabulated and analytical Ewald correction.
+ */
+static std::vector<KernelBenchOptions> expandFlavorOptions(const std::vector<KernelBenchOptions>& optionsList)
+{
+    std::vector<KernelBenchOptions> expandedList;
+    for (const auto& options : optionsList)
+    {
+        const bool hasEwaldCorrChoice = (options.coulombType == BenchMarkCoulomb::Pme
+                                         && options.nbnxmSimd != BenchMarkKernels::SimdNo);
+        for (int energy = 0; energy <= 1; energy++)
+        {
+            for (int table = 0; table <= (hasEwaldCorrChoice ? 1 : 0); table++)
+            {
+                expandedList.push_back(options);
+                expandedList.back().computeVirialAndEnergy = (energy == 1);
+                expandedList.back().useTabulatedEwaldCorr =
+                        (hasEwaldCorrChoice ? table == 1 : options.useTabulatedEwaldCorr);
+            }
+        }
+    }
+
+    return expandedList;
+}
+
+//! Returns the number of cluster pairs in the CPU pairlists of \p pairlistSet
+static gmx::index countClusterPairs(const PairlistSet& pairlistSet)
+{
+    gmx::index numClusterPairs = 0;
+    for (const auto& pairlist : pairlistSet.cpuLists())
+    {
+        numClusterPairs += pairlist.ncjInUse;
+    }
+
+    return numClusterPairs;
+}
+
+//! Sets up and runs the requested benchmark instance, prints and returns the results
 //
 // When \p doWarmup is true runs the warmup iterations instead
 // of the normal ones and does not print any results
-static void setupAndRunInstance(const gmx::BenchmarkSystem& system,
-                                const KernelBenchOptions&   options,
-                                const bool                  doWarmup)
+static KernelBenchResult setupAndRunInstance(const gmx::BenchmarkSystem& system,
+                                             const KernelBenchOptions&   options,
+                                             const bool                  doWarmup)
 {
     // Generate an, accurate, estimate of the number of non-zero pair interactions
     const real atomDensity = system.coordinates.size() / det(system.box);
@@ -298,12 +353,24 @@ static void setupAndRunInstance(const gmx::BenchmarkSystem& system,
     const gmx::EnumerationArray<BenchMarkCombRule, std::string> combruleNames = { "geom.", "LB",
                                                                                   "none" };
 
+    const KernelSetup kernelSetup = getKernelSetup(options);
+    const bool        useTabulatedEwaldCorr =
+            (kernelSetup.ewaldExclusionType == EwaldExclusionType::Table);
+
     if (!doWarmup)
     {
         fprintf(stdout, "%-7s %-4s %-5s %-4s ",
                 options.coulombType == BenchMarkCoulomb::Pme ? "Ewald" : "RF",
                 options.useHalfLJOptimization ? "half" : "all",
                 combruleNames[options.ljCombinationRule].c_str(), kernelNames[options.nbnxmSimd].c_str());
+        if (options.doAllFlavors)
+        {
+            fprintf(stdout, "%-5s %-3s ",
+                    options.coulombType == BenchMarkCoulomb::Pme
+                            ? (useTabulatedEwaldCorr ? "table" : "ana.")
+                            : "-",
+                    options.computeVirialAndEnergy ? "yes" : "no");
+        }
     }
 
     // Run pre-iteration to avoid cache misses
@@ -316,7 +383,8 @@ static void setupAndRunInstance(const gmx::BenchmarkSystem& system,
     const int numIterations = (doWarmup ? options.numWarmupIterations : options.numIterations);
     const PairlistSet& pairlistSet = nbv->pairlistSets().pairlistSet(gmx::InteractionLocality::Local);
     const gmx::index numPairs = pairlistSet.natpair_ljq_ + pairlistSet.natpair_lj_ + pairlistSet.natpair_q_;
-    gmx_cycles_t cycles = gmx_cycles_read();
+    const auto   startTime = std::chrono::steady_clock::now();
+    gmx_cycles_t cycles    = gmx_cycles_read();
     for (int iter = 0; iter < numIterations; iter++)
     {
         // Run the kernel without force clearing
@@ -324,25 +392,69 @@ static void setupAndRunInstance(const gmx::BenchmarkSystem& system,
                                      system.forceRec, &enerd, &nrnb);
     }
     cycles = gmx_cycles_read() - cycles;
-    if (!doWarmup)
+    const double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    gmx_cycles_t pairSearchCycles = 0;
+    if (options.benchmarkPairSearch)
+    {
+        pairSearchCycles = gmx_cycles_read();
+        for (int iter = 0; iter < numIterations; iter++)
+        {
+            putOnGridAndConstructPairlist(nbv.get(), options, system, &nrnb);
+        }
+        pairSearchCycles = gmx_cycles_read() - pairSearchCycles;
+    }
+
+    KernelBenchResult result;
+    if (doWarmup)
+    {
+        return result;
+    }
+
+    result.numAtoms               = system.coordinates.size();
+    result.cutoff                 = options.pairlistCutoff;
+    result.numThreads             = options.numThreads;
+    result.numIterations          = options.numIterations;
+    result.coulombType            = options.coulombType;
+    result.useHalfLJOptimization  = options.useHalfLJOptimization;
+    result.ljCombinationRule      = options.ljCombinationRule;
+    result.nbnxmSimd              = options.nbnxmSimd;
+    result.useTabulatedEwaldCorr  = useTabulatedEwaldCorr;
+    result.computeVirialAndEnergy = options.computeVirialAndEnergy;
+    result.numClusterPairs        = countClusterPairs(pairlistSet);
+    result.numPairs               = numPairs;
+    result.numUsefulPairs         = numUsefulPairs;
+    result.cycles                 = static_cast<double>(cycles);
+    result.seconds                = seconds;
+    result.pairSearchCycles       = static_cast<double>(pairSearchCycles);
+
+    // Print the results to stdout
     {
         const double dCycles = static_cast<double>(cycles);
         if (options.cyclesPerPair)
         {
-            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f\n", cycles * 1e-6,
+            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f", cycles * 1e-6,
                     dCycles / options.numIterations * 1e-6, dCycles / (options.numIterations * numPairs),
                     dCycles / (options.numIterations * numUsefulPairs));
         }
         else
         {
-            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f\n", dCycles * 1e-6,
+            fprintf(stdout, "%10.3f %10.4f %8.4f %8.4f", dCycles * 1e-6,
                     dCycles / options.numIterations * 1e-6, options.numIterations * numPairs / dCycles,
                     options.numIterations * numUsefulPairs / dCycles);
         }
+        if (options.benchmarkPairSearch)
+        {
+            fprintf(stdout, " %10.4f", result.pairSearchCycles / options.numIterations * 1e-6);
+        }
+        fprintf(stdout, "\n");
     }
+
+    return result;
 }
 
-void bench(const int sizeFactor, const KernelBenchOptions& options)
+std::vector<KernelBenchResult> bench(const int sizeFactor, const KernelBenchOptions& options)
 {
     // We don't want to call gmx_omp_nthreads_init(), so we init what we need
     gmx_omp_nthreads_set(emntPairsearch, options.numThreads);
@@ -386,6 +498,10 @@ void bench(const int sizeFactor, const KernelBenchOptions& options)
     {
         expandSimdOptionAndPushBack(options, &optionsList);
     }
+    if (options.doAllFlavors)
+    {
+        optionsList = expandFlavorOptions(optionsList);
+    }
     GMX_RELEASE_ASSERT(!optionsList.empty(), "Expect at least on benchmark setup");
 
 #if GMX_SIMD
@@ -398,8 +514,11 @@ void bench(const int sizeFactor, const KernelBenchOptions& options)
     fprintf(stdout, "Cut-off radius:       %g nm\n", options.pairlistCutoff);
     fprintf(stdout, "Number of threads:    %d\n", options.numThreads);
     fprintf(stdout, "Number of iterations: %d\n", options.numIterations);
-    fprintf(stdout, "Compute energies:     %s\n", options.computeVirialAndEnergy ? "yes" : "no");
-    if (options.coulombType != BenchMarkCoulomb::ReactionField)
+    if (!options.doAllFlavors)
+    {
+        fprintf(stdout, "Compute energies:     %s\n", options.computeVirialAndEnergy ? "yes" : "no");
+    }
+    if (options.coulombType != BenchMarkCoulomb::ReactionField && !options.doAllFlavors)
     {
         fprintf(stdout, "Ewald excl. corr.:    %s\n",
                 options.nbnxmSimd == BenchMarkKernels::SimdNo || options.useTabulatedEwaldCorr
@@ -413,14 +532,110 @@ void bench(const int sizeFactor, const KernelBenchOptions& options)
         setupAndRunInstance(system, optionsList[0], true);
     }
 
-    fprintf(stdout, "Coulomb LJ   comb. SIMD    Mcycles  Mcycles/it.   %s\n",
-            options.cyclesPerPair ? "cycles/pair" : "pairs/cycle");
-    fprintf(stdout, "                                                total    useful\n");
+    fprintf(stdout, "Coulomb LJ   comb. SIMD %s   Mcycles  Mcycles/it.   %s%s\n",
+            options.doAllFlavors ? "corr. ener." : "", options.cyclesPerPair ? "cycles/pair" : "pairs/cycle",
+            options.benchmarkPairSearch ? "      search" : "");
+    fprintf(stdout, "                        %s                         total    useful%s\n",
+            options.doAllFlavors ? "           " : "", options.benchmarkPairSearch ? " Mcycles/it." : "");
 
+    std::vector<KernelBenchResult> results;
     for (const auto& optionsInstance : optionsList)
     {
-        setupAndRunInstance(system, optionsInstance, false);
+        results.push_back(setupAndRunInstance(system, optionsInstance, false));
+    }
+
+    return results;
+}
+
+void writeBenchResults(const std::string&                     fileName,
+                       const BenchMarkOutputFormat            format,
+                       gmx::ArrayRef<const KernelBenchResult> results)
+{
+    const gmx::EnumerationArray<BenchMarkKernels, const char*> kernelNames = { "auto", "no", "4xM",
+                                                                               "2xMM" };
+
+    const gmx::EnumerationArray<BenchMarkCombRule, const char*> combruleNames = { "geometric", "lb",
+                                                                                  "none" };
+
+    gmx::TextWriter writer(fileName);
+
+    if (format == BenchMarkOutputFormat::Csv)
+    {
+        writer.writeLine(
+                "atoms,cutoff,threads,iterations,coulomb,ewald_correction,lj,comb_rule,simd,energy,"
+                "cluster_pairs,pairs,useful_pairs,mcycles,seconds,pairs_per_second,"
+                "useful_pairs_per_second,cycles_per_cluster_pair,pairlist_efficiency,"
+                "search_mcycles_per_iteration");
+    }
+    else
+    {
+        writer.writeLine("[");
     }
+
+    for (gmx::index i = 0; i < results.ssize(); i++)
+    {
+        const KernelBenchResult& result     = results[i];
+        const bool               isEwald    = (result.coulombType == BenchMarkCoulomb::Pme);
+        const double             numIter    = result.numIterations;
+        const double             pairRate   = numIter * result.numPairs / result.seconds;
+        const double             usefulRate = numIter * result.numUsefulPairs / result.seconds;
+        const double cyclesPerClusterPair   = result.cycles / (numIter * result.numClusterPairs);
+        const double efficiency             = result.numUsefulPairs / result.numPairs;
+        const double searchMcyclesPerIter   = result.pairSearchCycles / numIter * 1e-6;
+        const char*  coulombName            = (isEwald ? "ewald" : "reaction-field");
+        const char*  ewaldCorrName =
+                (isEwald ? (result.useTabulatedEwaldCorr ? "table" : "analytical") : "none");
+        const char* ljName = (result.useHalfLJOptimization ? "half" : "all");
+
+        if (format == BenchMarkOutputFormat::Csv)
+        {
+            writer.writeLine(gmx::formatString(
+                    "%d,%g,%d,%d,%s,%s,%s,%s,%s,%s,%ld,%ld,%.0f,%.6f,%.6e,%.6e,%.6e,%.4f,%.4f,%.6f",
+                    result.numAtoms, result.cutoff, result.numThreads, result.numIterations,
+                    coulombName, ewaldCorrName, ljName, combruleNames[result.ljCombinationRule],
+                    kernelNames[result.nbnxmSimd], result.computeVirialAndEnergy ? "yes" : "no",
+                    static_cast<long>(result.numClusterPairs), static_cast<long>(result.numPairs),
+                    result.numUsefulPairs, result.cycles * 1e-6, result.seconds, pairRate,
+                    usefulRate, cyclesPerClusterPair, efficiency, searchMcyclesPerIter));
+        }
+        else
+        {
+            writer.writeLine("  {");
+            writer.writeLine(gmx::formatString("    \"atoms\": %d,", result.numAtoms));
+            writer.writeLine(gmx::formatString("    \"cutoff\": %g,", result.cutoff));
+            writer.writeLine(gmx::formatString("    \"threads\": %d,", result.numThreads));
+            writer.writeLine(gmx::formatString("    \"iterations\": %d,", result.numIterations));
+            writer.writeLine(gmx::formatString("    \"coulomb\": \"%s\",", coulombName));
+            writer.writeLine(gmx::formatString("    \"ewald_correction\": \"%s\",", ewaldCorrName));
+            writer.writeLine(gmx::formatString("    \"lj\": \"%s\",", ljName));
+            writer.writeLine(gmx::formatString("    \"comb_rule\": \"%s\",",
+                                               combruleNames[result.ljCombinationRule]));
+            writer.writeLine(gmx::formatString("    \"simd\": \"%s\",", kernelNames[result.nbnxmSimd]));
+            writer.writeLine(gmx::formatString("    \"energy\": %s,",
+                                               result.computeVirialAndEnergy ? "true" : "false"));
+            writer.writeLine(gmx::formatString("    \"cluster_pairs\": %ld,",
+                                               static_cast<long>(result.numClusterPairs)));
+            writer.writeLine(gmx::formatString("    \"pairs\": %ld,", static_cast<long>(result.numPairs)));
+            writer.writeLine(gmx::formatString("    \"useful_pairs\": %.0f,", result.numUsefulPairs));
+            writer.writeLine(gmx::formatString("    \"mcycles\": %.6f,", result.cycles * 1e-6));
+            writer.writeLine(gmx::formatString("    \"seconds\": %.6e,", result.seconds));
+            writer.writeLine(gmx::formatString("    \"pairs_per_second\": %.6e,", pairRate));
+            writer.writeLine(gmx::formatString("    \"useful_pairs_per_second\": %.6e,", usefulRate));
+            writer.writeLine(gmx::formatString("    \"cycles_per_cluster_pair\": %.4f,",
+                                               cyclesPerClusterPair));
+            writer.writeLine(gmx::formatString("    \"pairlist_efficiency\": %.4f,", efficiency));
+            writer.writeLine(gmx::formatString("    \"search_mcycles_per_iteration\": %.6f",
+                                               searchMcyclesPerIter));
+            writer.writeLine(i + 1 < results.ssize() ? "  }," : "  }");
+        }
+    }
+
+    if (format == BenchMarkOutputFormat::Json)
+    {
+        writer.writeLine("]");
+    }
+
+    writer.close();
 }
 
 } // namespace Nbnxm
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2019, by the GROMACS development team, led by
+ * Copyright (c) 2019,2020, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -46,6 +46,11 @@
 #ifndef GMX_NBNXN_BENCH_SETUP_H
 #define GMX_NBNXN_BENCH_SETUP_H
 
+#include <string>
+#include <vector>
+
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/real.h"
 
 namespace Nbnxm
@@ -78,6 +83,14 @@ enum class BenchMarkCoulomb : int
     Count
 };
 
+//! Enum for selecting the format of the machine-readable benchmark output
+enum class BenchMarkOutputFormat : int
+{
+    Csv,
+    Json,
+    Count
+};
+
 /*! \internal \brief
  * The options for the kernel benchmarks
  */
@@ -105,6 +118,8 @@ struct KernelBenchOptions
     bool useTabulatedEwaldCorr = false;
     //! Whether to run all combinations of Coulomb type, combination rule and SIMD
     bool doAll = false;
+    //! Whether to run all kernel flavors: energy/no-energy and, with Ewald, table/analytical correction
+    bool doAllFlavors = false;
     //! Number of iterations to run before running each kernel benchmark, currently always 1
     int numPreIterations = 1;
     //! The number of iterations for each kernel
@@ -113,6 +128,47 @@ struct KernelBenchOptions
     int numWarmupIterations = 0;
     //! Print cycles/pair instead of pairs/cycle
     bool cyclesPerPair = false;
+    //! Whether to also time the pair search, i.e. gridding and pairlist construction
+    bool benchmarkPairSearch = false;
+};
+
+/*! \internal \brief
+ * The settings and measured performance of one kernel benchmark instance
+ */
+struct KernelBenchResult
+{
+    //! The number of atoms in the system
+    int numAtoms = 0;
+    //! The pairlist and interaction cut-off
+    real cutoff = 0;
+    //! The number of OpenMP threads used
+    int numThreads = 0;
+    //! The number of timed iterations
+    int numIterations = 0;
+    //! The Coulomb interaction function
+    BenchMarkCoulomb coulombType = BenchMarkCoulomb::Pme;
+    //! Whether the i-cluster half-LJ optimization was used
+    bool useHalfLJOptimization = false;
+    //! The LJ combination rule
+    BenchMarkCombRule ljCombinationRule = BenchMarkCombRule::RuleGeom;
+    //! The SIMD kernel type, never SimdAuto
+    BenchMarkKernels nbnxmSimd = BenchMarkKernels::SimdNo;
+    //! Whether the tabulated Ewald correction was used, only relevant with Ewald
+    bool useTabulatedEwaldCorr = false;
+    //! Whether energies were computed
+    bool computeVirialAndEnergy = false;
+    //! The number of cluster pairs in the pairlist
+    gmx::index numClusterPairs = 0;
+    //! The number of atom pairs in the pairlist, including pairs beyond the cut-off
+    gmx::index numPairs = 0;
+    //! The estimated number of atom pairs within the cut-off
+    double numUsefulPairs = 0;
+    //! The total number of cycles spent in the timed iterations
+    double cycles = 0;
+    //! The total wall-clock time in seconds spent in the timed iterations
+    double seconds = 0;
+    //! The total number of cycles spent in pair search iterations, 0 when not benchmarked
+    double pairSearchCycles = 0;
 };
 
 /*! \brief
@@ -125,8 +181,25 @@ struct KernelBenchOptions
  *
  * \param[in] sizeFactor How much should the system size be increased.
  * \param[in] options How the benchmark will be run.
+ * \returns The results of all benchmark instances that were run.
+ */
+std::vector<KernelBenchResult> bench(int sizeFactor, const KernelBenchOptions& options);
+
+/*! \brief
+ * Writes benchmark results to file in a machine-readable format
+ *
+ * Next to the settings and raw timings, the derived quantities pair
+ * interactions per second, cycles per cluster pair and the pairlist
+ * efficiency, i.e. the fraction of pairs in the list within the cut-off,
+ * are written for each benchmark instance.
+ *
+ * \param[in] fileName The name of the file to write to.
+ * \param[in] format   The output format.
+ * \param[in] results  The results to write.
  */
-void bench(int sizeFactor, const KernelBenchOptions& options);
+void writeBenchResults(const std::string&                     fileName,
+                       BenchMarkOutputFormat                  format,
+                       gmx::ArrayRef<const KernelBenchResult> results);
 
 } // namespace Nbnxm
 
@@ -106,6 +106,17 @@ static constexpr inline int packedBoundingBoxesIndex(int clusterIndex)
 
 #    endif /* NBNXN_SEARCH_BB_SIMD4 */
 
+/*! \brief With wide float SIMD we compute the distances between an i-cluster
+ * bounding box and batches of GMX_SIMD_FLOAT_WIDTH consecutive j-cluster
+ * bounding boxes at once. With 4-wide SIMD this is not faster than
+ * the Simd4 code for single bounding box pairs.
+ */
+#    if GMX_SIMD_HAVE_FLOAT && GMX_SIMD_FLOAT_WIDTH >= 8
+#        define NBNXN_SEARCH_BB_SIMD_BATCH 1
+#    else
+#        define NBNXN_SEARCH_BB_SIMD_BATCH 0
+#    endif
+
 #endif // !DOXYGEN
 
 #endif
@@ -135,8 +135,9 @@ void Grid::setDimensions(const int          ddZone,
         atomDensity = gridAtomDensity(numAtoms, lowerCorner, upperCorner);
     }
 
-    dimensions_.atomDensity        = atomDensity;
-    dimensions_.maxAtomGroupRadius = maxAtomGroupRadius;
+    dimensions_.atomDensity         = atomDensity;
+    dimensions_.maxAtomGroupRadius  = maxAtomGroupRadius;
+    dimensions_.maxAtomDisplacement = 0;
 
     rvec size;
     rvec_sub(upperCorner, lowerCorner, size);
@@ -991,12 +992,13 @@ void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
                                   gmx::ArrayRef<const gmx::RVec> x,
                                   nbnxn_atomdata_t*              nbat,
                                   const gmx::Range<int>          columnRange,
-                                  gmx::ArrayRef<int>             sort_work)
+                                  gmx::ArrayRef<int>             sort_work,
+                                  const bool                     sortAtoms)
 {
     if (debug)
     {
-        fprintf(debug, "cell_offset %d sorting columns %d - %d\n", cellOffset_,
-                *columnRange.begin(), *columnRange.end());
+        fprintf(debug, "cell_offset %d %s columns %d - %d\n", cellOffset_,
+                sortAtoms ? "sorting" : "updating", *columnRange.begin(), *columnRange.end());
     }
 
     const bool relevantAtomsAreWithinGridBounds = (dimensions_.maxAtomGroupRadius == 0);
@@ -1011,9 +1013,13 @@ void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
         const int atomOffset = firstAtomInColumn(cxy);
 
         /* Sort the atoms within each x,y column on z coordinate */
-        sort_atoms(ZZ, FALSE, dd_zone, relevantAtomsAreWithinGridBounds,
-                   gridSetData->atomIndices.data() + atomOffset, numAtoms, x, dimensions_.lowerCorner[ZZ],
-                   1.0 / dimensions_.gridSize[ZZ], numCellsZ * numAtomsPerCell, sort_work);
+        if (sortAtoms)
+        {
+            sort_atoms(ZZ, FALSE, dd_zone, relevantAtomsAreWithinGridBounds,
+                       gridSetData->atomIndices.data() + atomOffset, numAtoms, x,
+                       dimensions_.lowerCorner[ZZ], 1.0 / dimensions_.gridSize[ZZ],
+                       numCellsZ * numAtomsPerCell, sort_work);
+        }
 
         /* Fill the ncz cells in this column */
         const int firstCell  = firstCellInColumn(cxy);
@@ -1047,6 +1053,36 @@ void Grid::sortColumnsCpuGeometry(GridSetData*                   gridSetData,
     }
 }
 
+void Grid::updateCoordinates(GridSetData*                   gridSetData,
+                             const int*                     atinfo,
+                             gmx::ArrayRef<const gmx::RVec> x,
+                             const real                     maxAtomDisplacement,
+                             nbnxn_atomdata_t*              nbat)
+{
+    GMX_RELEASE_ASSERT(geometry_.isSimple, "Coordinate updates are only supported for CPU grids");
+
+    dimensions_.maxAtomDisplacement = maxAtomDisplacement;
+
+    const int nthread = gmx_omp_nthreads_get(emntPairsearch);
+
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        try
+        {
+            gmx::Range<int> columnRange(((thread + 0) * numColumns()) / nthread,
+                                        ((thread + 1) * numColumns()) / nthread);
+            sortColumnsCpuGeometry(gridSetData, 0, atinfo, x, nbat, columnRange, {}, false);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    if (nbat->XFormat == nbatX8)
+    {
+        combine_bounding_box_pairs(*this, bb_, bbj_);
+    }
+}
+
 /* Spatially sort the atoms within one grid column */
 void Grid::sortColumnsGpuGeometry(GridSetData*                   gridSetData,
                                   int                            dd_zone,
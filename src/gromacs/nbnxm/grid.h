@@ -215,6 +215,8 @@ public:
         real atomDensity;
         //! The maximum distance an atom can be outside of a cell and outside of the grid
         real maxAtomGroupRadius;
+        //! The maximum displacement of atoms since they were sorted, non-zero only after updateCoordinates()
+        real maxAtomDisplacement;
         //! Size of cell along dimension x and y
         real cellSize[DIM - 1];
         //! 1/size of a cell along dimensions x and y
@@ -356,6 +358,20 @@ public:
                         int                            numAtomsMoved,
                         nbnxn_atomdata_t*              nbat);
 
+    /*! \brief Updates the coordinates and bounding boxes without re-sorting the atoms
+     *
+     * The atoms keep their grid cells, only the coordinates in \p nbat
+     * and the bounding boxes are updated. Atoms are allowed to have moved
+     * by at most \p maxAtomDisplacement since the last call to setCellIndices(),
+     * which is accounted for in the search through the grid.
+     * Only supported with CPU geometry.
+     */
+    void updateCoordinates(GridSetData*                   gridSetData,
+                           const int*                     atinfo,
+                           gmx::ArrayRef<const gmx::RVec> x,
+                           real                           maxAtomDisplacement,
+                           nbnxn_atomdata_t*              nbat);
+
     //! Determine in which grid columns atoms should go, store cells and atom counts in \p cell and \p cxy_na
     static void calcColumnIndices(const Grid::Dimensions&        gridDims,
                                   const gmx::UpdateGroupsCog*    updateGroupsCog,
@@ -381,14 +397,19 @@ private:
                   gmx::ArrayRef<const gmx::RVec> x,
                   BoundingBox gmx_unused* bb_work_aligned);
 
-    //! Spatially sort the atoms within the given column range, for CPU geometry
+    /*! \brief Spatially sort the atoms within the given column range, for CPU geometry
+     *
+     * When \p sortAtoms is false, the atom order is kept and only
+     * the coordinates and bounding boxes are updated.
+     */
     void sortColumnsCpuGeometry(GridSetData*                   gridSetData,
                                 int                            dd_zone,
                                 const int*                     atinfo,
                                 gmx::ArrayRef<const gmx::RVec> x,
                                 nbnxn_atomdata_t*              nbat,
                                 gmx::Range<int>                columnRange,
-                                gmx::ArrayRef<int>             sort_work);
+                                gmx::ArrayRef<int>             sort_work,
+                                bool                           sortAtoms = true);
 
     //! Spatially sort the atoms within the given column range, for GPU geometry
     void sortColumnsGpuGeometry(GridSetData*                   gridSetData,
@@ -46,11 +46,18 @@
 
 #include "gridset.h"
 
+#include <cinttypes>
+#include <cmath>
+#include <cstdlib>
+
+#include "gromacs/math/vec.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/updategroupscog.h"
 #include "gromacs/nbnxm/atomdata.h"
 #include "gromacs/utility/fatalerror.h"
 
+#include "pairlistparams.h"
+
 namespace Nbnxm
 {
 
@@ -101,11 +108,17 @@ GridSet::GridSet(const PbcType             pbcType,
                  const int                 numThreads,
                  gmx::PinningPolicy        pinningPolicy) :
     domainSetup_(pbcType, doTestParticleInsertion, numDDCells, ddZones),
+    pairlistType_(pairlistType),
     grids_(numGrids(domainSetup_), Grid(pairlistType, haveFep_)),
     haveFep_(haveFep),
     numRealAtomsLocal_(0),
     numRealAtomsTotal_(0),
-    gridWork_(numThreads)
+    gridWork_(numThreads),
+    useEffectiveAtomDensity_(getenv("GMX_NBNXN_EFFECTIVE_DENSITY") != nullptr && !doTestParticleInsertion),
+    havePrintedSetupPaddingStatistics_(false),
+    useIncrementalUpdates_(getenv("GMX_NBNXN_INCREMENTAL_GRID") != nullptr && !doTestParticleInsertion
+                           && numDDCells == nullptr && pairlistType != PairlistType::HierarchicalNxN),
+    incrementalMaxDisplacement_(-1)
 {
     clear_mat(box_);
     changePinningPolicy(&gridSetData_.cells, pinningPolicy);
@@ -132,6 +145,220 @@ void GridSet::setLocalAtomOrder()
     }
 }
 
+/*! \brief The maximum atom displacement, relative to the grid cell size, for incremental grid updates
+ *
+ * The search range through the grid increases with twice the displacement,
+ * which increases the search cost. The cost of the pair search is dominated
+ * by the cluster pair distance checks, which are not affected, so we can
+ * allow for displacements of a significant fraction of the cell size.
+ */
+static constexpr real c_maxIncrementalDisplacementOverCellSize = 0.5;
+
+bool GridSet::canUpdateLocalGridIncrementally(const matrix box, gmx::ArrayRef<const gmx::RVec> x)
+{
+    incrementalMaxDisplacement_ = -1;
+
+    if (!useIncrementalUpdates_ || x.ssize() != gmx::ssize(referenceCoordinates_))
+    {
+        return false;
+    }
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            if (box[d1][d2] != box_[d1][d2])
+            {
+                return false;
+            }
+        }
+    }
+
+    const Grid::Dimensions& dims = grids_[0].dimensions();
+    const real              maxDisplacement =
+            c_maxIncrementalDisplacementOverCellSize * std::min(dims.cellSize[XX], dims.cellSize[YY]);
+
+    const int numAtoms = x.ssize();
+    const int nthread  = gmx_omp_nthreads_get(emntPairsearch);
+    real      maxDisplacement2 = 0;
+#pragma omp parallel for num_threads(nthread) schedule(static) reduction(max : maxDisplacement2)
+    for (int i = 0; i < numAtoms; i++)
+    {
+        maxDisplacement2 = std::max(maxDisplacement2, distance2(x[i], referenceCoordinates_[i]));
+    }
+
+    if (maxDisplacement2 >= gmx::square(maxDisplacement))
+    {
+        return false;
+    }
+
+    incrementalMaxDisplacement_ = std::sqrt(maxDisplacement2);
+
+    return true;
+}
+
+/*! \brief Returns the effective atom density of the home atoms in \p atomRange
+ *
+ * The effective density is the density as seen by an average atom.
+ * The atoms are binned into cells containing on average
+ * \p c_numAtomsPerDensityCell atoms and the density is the atom count
+ * weighted average of the cell densities. For homogeneous systems this
+ * equals the average density, for systems with empty or sparse regions,
+ * such as vacuum slabs or membrane interfaces, this is the density of
+ * the occupied part of the volume. We use n*(n-1) instead of n^2 as
+ * weight to avoid a bias due to fluctuations in the atom counts.
+ * The binning is done in thread-local count buffers in \p gridWork_,
+ * which are reused at subsequent calls.
+ */
+real GridSet::computeEffectiveAtomDensity(gmx::ArrayRef<const gmx::RVec> x,
+                                          const gmx::Range<int>          atomRange,
+                                          const int*                     move,
+                                          const rvec                     lowerCorner,
+                                          const rvec                     upperCorner,
+                                          const real                     averageDensity)
+{
+    constexpr real c_numAtomsPerDensityCell = 32;
+
+    const real cellSize = std::cbrt(c_numAtomsPerDensityCell / averageDensity);
+
+    ivec numCells;
+    rvec invCellSize;
+    for (int d = 0; d < DIM; d++)
+    {
+        const real size = upperCorner[d] - lowerCorner[d];
+        numCells[d]     = std::max(1, static_cast<int>(size / cellSize));
+        invCellSize[d]  = numCells[d] / size;
+    }
+    const int numCellsTotal = numCells[XX] * numCells[YY] * numCells[ZZ];
+
+    const int nthread = gmx_omp_nthreads_get(emntPairsearch);
+    GMX_ASSERT(nthread <= gmx::ssize(gridWork_), "We need a work buffer for each thread");
+
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        try
+        {
+            std::vector<int>& cellCounts = gridWork_[thread].densityCellCounts;
+            cellCounts.assign(numCellsTotal, 0);
+
+            const int atomStart = *atomRange.begin() + (thread * atomRange.size()) / nthread;
+            const int atomEnd   = *atomRange.begin() + ((thread + 1) * atomRange.size()) / nthread;
+            for (int i = atomStart; i < atomEnd; i++)
+            {
+                if (move != nullptr && move[i] < 0)
+                {
+                    continue;
+                }
+                ivec cellIndex;
+                for (int d = 0; d < DIM; d++)
+                {
+                    /* Atoms can be slightly outside the grid bounds */
+                    cellIndex[d] = static_cast<int>((x[i][d] - lowerCorner[d]) * invCellSize[d]);
+                    cellIndex[d] = std::min(std::max(cellIndex[d], 0), numCells[d] - 1);
+                }
+                cellCounts[(cellIndex[XX] * numCells[YY] + cellIndex[YY]) * numCells[ZZ]
+                           + cellIndex[ZZ]]++;
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    /* Reduce the counts over the threads, the sums are exact in double precision */
+    double sumCounts        = 0;
+    double sumCountsSquared = 0;
+#pragma omp parallel for num_threads(nthread) schedule(static) \
+        reduction(+ : sumCounts, sumCountsSquared)
+    for (int c = 0; c < numCellsTotal; c++)
+    {
+        int count = 0;
+        for (int thread = 0; thread < nthread; thread++)
+        {
+            count += gridWork_[thread].densityCellCounts[c];
+        }
+        sumCounts += count;
+        sumCountsSquared += count * (count - 1.0);
+    }
+
+    const double cellVolume = 1.0 / (invCellSize[XX] * invCellSize[YY] * invCellSize[ZZ]);
+
+    /* With very few atoms the estimate can end up below the average */
+    return std::max(averageDensity, static_cast<real>(sumCountsSquared / (sumCounts * cellVolume)));
+}
+
+/*! \brief Returns the number of filler atoms on \p grid for the column atom counts \p numAtomsPerColumn
+ *
+ * This repeats the cell count computation of Grid::setCellIndices().
+ */
+static int numFillerAtoms(const Grid& grid, gmx::ArrayRef<const int> numAtomsPerColumn, const nbnxn_atomdata_t& nbat)
+{
+    const int numAtomsPerCell = grid.geometry().numAtomsPerCell;
+
+    int numFillerAtoms = 0;
+    for (int cxy = 0; cxy < grid.numColumns(); cxy++)
+    {
+        int numCells = (numAtomsPerColumn[cxy] + numAtomsPerCell - 1) / numAtomsPerCell;
+        if (nbat.XFormat == nbatX8)
+        {
+            numCells = (numCells + 1) & ~1;
+        }
+        numFillerAtoms += numCells * numAtomsPerCell - numAtomsPerColumn[cxy];
+    }
+
+    return numFillerAtoms;
+}
+
+/*! \brief Returns the fraction of cluster-pair interactions involving at least one filler atom
+ *
+ * This is estimated from the filler atom fraction f as 1 - (1 - f)^2.
+ */
+static real paddedPairFraction(const real fillerAtomFraction)
+{
+    return 1 - gmx::square(1 - fillerAtomFraction);
+}
+
+void GridSet::printPaddingStatistics(FILE* fp, const bool printFinal)
+{
+    const PaddingStatistics& stats = paddingStatistics_;
+    if (stats.numGriddings == 0)
+    {
+        return;
+    }
+
+    if (!printFinal)
+    {
+        if (havePrintedSetupPaddingStatistics_)
+        {
+            return;
+        }
+        havePrintedSetupPaddingStatistics_ = true;
+
+        const real fillerFractionAverage =
+                stats.numFillerAtomsAverageDensity
+                / static_cast<real>(stats.numRealAtoms + stats.numFillerAtomsAverageDensity);
+        const real fillerFraction =
+                stats.numFillerAtoms / static_cast<real>(stats.numRealAtoms + stats.numFillerAtoms);
+
+        fprintf(fp,
+                "\nThe pair search grid of the home atoms is sized using the effective atom\n"
+                "density of %.1f nm^-3 instead of the average density of %.1f nm^-3.\n"
+                "This gives %.1f%% instead of %.1f%% filler atoms and %.1f%% instead of %.1f%%\n"
+                "padded pairs.\n\n",
+                stats.effectiveDensity, stats.averageDensity, 100 * fillerFraction,
+                100 * fillerFractionAverage, 100 * paddedPairFraction(fillerFraction),
+                100 * paddedPairFraction(fillerFractionAverage));
+    }
+    else
+    {
+        const real fillerFraction =
+                stats.sumNumFillerAtoms / (stats.sumNumRealAtoms + stats.sumNumFillerAtoms);
+
+        fprintf(fp,
+                "\nPair search grid of the home atoms using the effective atom density,\n"
+                "average over %" PRId64 " griddings: %.1f%% filler atoms, %.1f%% padded pairs\n",
+                stats.numGriddings, 100 * fillerFraction, 100 * paddedPairFraction(fillerFraction));
+    }
+}
+
 void GridSet::putOnGrid(const matrix                   box,
                         const int                      gridIndex,
                         const rvec                     lowerCorner,
@@ -147,6 +374,20 @@ void GridSet::putOnGrid(const matrix                   box,
 {
     Nbnxm::Grid& grid = grids_[gridIndex];
 
+    if (gridIndex == 0 && incrementalMaxDisplacement_ >= 0)
+    {
+        GMX_RELEASE_ASSERT(*atomRange.begin() == 0 && atomRange.size() == gmx::ssize(referenceCoordinates_)
+                                   && numAtomsMoved == 0,
+                           "Incremental grid updates require the same atoms as at the last gridding");
+
+        /* Keep the atom order on the grid, only update coordinates and bounding boxes */
+        grid.updateCoordinates(&gridSetData_, atomInfo.data(), x, incrementalMaxDisplacement_, nbat);
+
+        incrementalMaxDisplacement_ = -1;
+
+        return;
+    }
+
     int cellOffset;
     if (gridIndex == 0)
     {
@@ -191,6 +432,49 @@ void GridSet::putOnGrid(const matrix                   box,
      * since determining densities for non-local zones is difficult.
      */
     const int ddZone = (domainSetup_.doTestParticleInsertion ? 0 : gridIndex);
+
+    /* For inhomogeneous systems the average density leads to flat
+     * clusters in the dense regions, as the column cross section is too
+     * large. The effective density gives approximately cubic clusters
+     * in the regions where most atoms reside.
+     */
+    real averageDensity = atomDensity;
+    if (gridIndex == 0 && useEffectiveAtomDensity_ && n - numAtomsMoved > 0)
+    {
+        if (averageDensity <= 0)
+        {
+            real volume = 1;
+            for (int d = 0; d < DIM; d++)
+            {
+                volume *= upperCorner[d] - lowerCorner[d];
+            }
+            averageDensity = (n - numAtomsMoved) / volume;
+        }
+        if (std::isfinite(averageDensity) && averageDensity > 0)
+        {
+            atomDensity = computeEffectiveAtomDensity(x, atomRange, move, lowerCorner, upperCorner,
+                                                      averageDensity);
+        }
+    }
+
+    const bool collectPaddingStatistics =
+            (gridIndex == 0 && useEffectiveAtomDensity_ && atomDensity > 0);
+    int numFillerAtomsAverage = 0;
+    if (collectPaddingStatistics && paddingStatistics_.numGriddings == 0)
+    {
+        /* Determine the column occupancy for the average density grid,
+         * using a temporary grid with the same geometry. This is only
+         * done once, for reporting the effect of the effective density.
+         */
+        Grid averageGrid(pairlistType_, haveFep_);
+        averageGrid.setDimensions(ddZone, n - numAtomsMoved, lowerCorner, upperCorner,
+                                  averageDensity, 0, false, gmx::PinningPolicy::CannotBePinned);
+        std::vector<int> cells(*atomRange.end());
+        std::vector<int> numAtomsPerColumn(averageGrid.numColumns() + 1);
+        Grid::calcColumnIndices(averageGrid.dimensions(), updateGroupsCog, atomRange, x, ddZone,
+                                move, 0, 1, cells, numAtomsPerColumn);
+        numFillerAtomsAverage = numFillerAtoms(averageGrid, numAtomsPerColumn, *nbat);
+    }
     // grid data used in GPU transfers inherits the gridset pinning policy
     auto pinPolicy = gridSetData_.cells.get_allocator().pinningPolicy();
     grid.setDimensions(ddZone, n - numAtomsMoved, lowerCorner, upperCorner, atomDensity,
@@ -222,9 +506,33 @@ void GridSet::putOnGrid(const matrix                   box,
     grid.setCellIndices(ddZone, cellOffset, &gridSetData_, gridWork_, atomRange, atomInfo.data(), x,
                         numAtomsMoved, nbat);
 
+    if (collectPaddingStatistics)
+    {
+        PaddingStatistics& stats = paddingStatistics_;
+
+        const int numRealAtoms   = n - numAtomsMoved;
+        const int numFillerAtoms = grid.numCells() * grid.geometry().numAtomsPerCell - numRealAtoms;
+        if (stats.numGriddings == 0)
+        {
+            stats.averageDensity               = averageDensity;
+            stats.effectiveDensity             = atomDensity;
+            stats.numRealAtoms                 = numRealAtoms;
+            stats.numFillerAtomsAverageDensity = numFillerAtomsAverage;
+            stats.numFillerAtoms               = numFillerAtoms;
+        }
+        stats.numGriddings++;
+        stats.sumNumRealAtoms += numRealAtoms;
+        stats.sumNumFillerAtoms += numFillerAtoms;
+    }
+
     if (gridIndex == 0)
     {
         nbat->natoms_local = nbat->numAtoms();
+
+        if (useIncrementalUpdates_)
+        {
+            referenceCoordinates_.assign(x.begin() + *atomRange.begin(), x.begin() + *atomRange.end());
+        }
     }
     if (gridIndex == gmx::ssize(grids_) - 1)
     {
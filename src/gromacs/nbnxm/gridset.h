@@ -48,6 +48,9 @@
 #ifndef GMX_NBNXM_GRIDSET_H
 #define GMX_NBNXM_GRIDSET_H
 
+#include <cstdint>
+#include <cstdio>
+
 #include <memory>
 #include <vector>
 
@@ -108,6 +111,31 @@ public:
         const gmx_domdec_zones_t* zones;
     };
 
+    /*! \internal
+     * \brief Statistics of the padding of the home grid with filler atoms
+     *
+     * Only collected when the grid is sized using the effective atom density.
+     */
+    struct PaddingStatistics
+    {
+        //! The number of full griddings of the home grid
+        int64_t numGriddings = 0;
+        //! The average atom density at the first gridding
+        real averageDensity = 0;
+        //! The effective atom density at the first gridding
+        real effectiveDensity = 0;
+        //! The number of real atoms at the first gridding
+        int numRealAtoms = 0;
+        //! The number of filler atoms at the first gridding with a grid for the average density
+        int numFillerAtomsAverageDensity = 0;
+        //! The number of filler atoms at the first gridding
+        int numFillerAtoms = 0;
+        //! The number of real atoms summed over all griddings
+        double sumNumRealAtoms = 0;
+        //! The number of filler atoms summed over all griddings
+        double sumNumFillerAtoms = 0;
+    };
+
     //! Constructs a grid set for 1 or multiple DD zones, when numDDCells!=nullptr
     GridSet(PbcType                   pbcType,
             bool                      doTestParticleInsertion,
@@ -132,6 +160,33 @@ public:
                    const int*                     move,
                    nbnxn_atomdata_t*              nbat);
 
+    /*! \brief Returns whether the home grid can be updated without re-sorting at the next search
+     *
+     * This is only possible when incremental grid updates are enabled,
+     * without domain decomposition, when the unit-cell is unchanged and
+     * when all atoms moved less than a fraction of the grid cell size
+     * since the last full gridding. When true is returned, the next call
+     * to putOnGrid() for the home grid will only update the coordinates
+     * and bounding boxes. Note that atoms should then not be put back
+     * in the unit-cell, as that would invalidate the grid sort.
+     *
+     * \param[in] box  The current unit-cell
+     * \param[in] x    The current coordinates of the home atoms
+     */
+    bool canUpdateLocalGridIncrementally(const matrix box, gmx::ArrayRef<const gmx::RVec> x);
+
+    //! Returns the padding statistics of the home grid, only collected with the effective density
+    const PaddingStatistics& paddingStatistics() const { return paddingStatistics_; }
+
+    /*! \brief Prints the padding statistics of the home grid to \p fp
+     *
+     * With \p printFinal false, prints the statistics for the first gridding,
+     * only the first time this is called after that gridding. With
+     * \p printFinal true, prints the averages over all griddings.
+     * Does nothing when the statistics are not collected.
+     */
+    void printPaddingStatistics(FILE* fp, bool printFinal);
+
     //! Returns the domain setup
     DomainSetup domainSetup() const { return domainSetup_; }
 
@@ -178,9 +233,19 @@ public:
     void setNumColumnsMax(int numColumnsMax) { numColumnsMax_ = numColumnsMax; }
 
 private:
+    //! Returns the effective atom density of the home atoms, see the implementation
+    real computeEffectiveAtomDensity(gmx::ArrayRef<const gmx::RVec> x,
+                                     gmx::Range<int>                atomRange,
+                                     const int*                     move,
+                                     const rvec                     lowerCorner,
+                                     const rvec                     upperCorner,
+                                     real                           averageDensity);
+
     /* Data members */
     //! The domain setup
     DomainSetup domainSetup_;
+    //! The type of pairlist the grids are set up for
+    PairlistType pairlistType_;
     //! The search grids
     std::vector<Grid> grids_;
     //! The cell and atom index data which runs over all grids
@@ -197,6 +262,18 @@ private:
     std::vector<GridWork> gridWork_;
     //! Maximum number of columns across all grids
     int numColumnsMax_;
+    //! Whether to size the home grid cells using the effective instead of the average atom density
+    bool useEffectiveAtomDensity_;
+    //! The padding statistics of the home grid
+    PaddingStatistics paddingStatistics_;
+    //! Whether the padding statistics of the first gridding have been printed
+    bool havePrintedSetupPaddingStatistics_;
+    //! Whether the home grid may be updated without re-sorting at search steps
+    bool useIncrementalUpdates_;
+    //! The home atom coordinates at the last full gridding, only used with incremental updates
+    std::vector<gmx::RVec> referenceCoordinates_;
+    //! The maximum atom displacement for the next incremental update, < 0 when not possible
+    real incrementalMaxDisplacement_;
 };
 
 } // namespace Nbnxm
@@ -77,6 +77,8 @@ struct GridWork
     std::vector<int> numAtomsPerColumn;
     //! Buffer for sorting integers
     std::vector<int> sortBuffer;
+    //! Atom counts of the cells used for determining the effective atom density
+    std::vector<int> densityCellCounts;
 };
 
 } // namespace Nbnxm
@@ -64,6 +64,7 @@
 #include "nbnxm_simd.h"
 #include "pairlistset.h"
 #include "pairlistsets.h"
+#include "pairsearch.h"
 #include "kernels_reference/kernel_gpu_ref.h"
 #define INCLUDE_KERNELFUNCTION_TABLES
 #include "kernels_reference/kernel_ref.h"
@@ -503,6 +504,7 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality   iLo
                "Number of lists should be same as number of NB threads");
 
     wallcycle_sub_start(wcycle_, ewcsNONBONDED_FEP);
+    pairSearch_->cycleCounting_.start(enbsCCfep);
 #pragma omp parallel for schedule(static) num_threads(nbl_fep.ssize())
     for (gmx::index th = 0; th < nbl_fep.ssize(); th++)
     {
@@ -513,6 +515,7 @@ void nonbonded_verlet_t::dispatchFreeEnergyKernel(gmx::InteractionLocality   iLo
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
+    pairSearch_->cycleCounting_.stop(enbsCCfep);
 
     if (fepvals->sc_alpha != 0)
     {
@@ -114,6 +114,16 @@ gmx::ArrayRef<const int> nonbonded_verlet_t::getLocalAtomOrder() const
     return gmx::constArrayRefFromArray(pairSearch_->gridSet().atomIndices().data(), numIndices);
 }
 
+bool nonbonded_verlet_t::canUpdateLocalGridIncrementally(const matrix box, gmx::ArrayRef<const gmx::RVec> x)
+{
+    return pairSearch_->canUpdateLocalGridIncrementally(box, x);
+}
+
+void nonbonded_verlet_t::printGridPaddingStatistics(FILE* fplog, const bool printFinal)
+{
+    pairSearch_->printGridPaddingStatistics(fplog, printFinal);
+}
+
 void nonbonded_verlet_t::setLocalAtomOrder()
 {
     pairSearch_->setLocalAtomOrder();
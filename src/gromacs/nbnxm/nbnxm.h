@@ -111,6 +111,8 @@
 #ifndef GMX_NBNXM_NBNXM_H
 #define GMX_NBNXM_NBNXM_H
 
+#include <cstdio>
+
 #include <memory>
 
 #include "gromacs/gpu_utils/devicebuffer_datatype.h"
@@ -248,6 +250,28 @@ public:
     //! Returns the index position of the atoms on the search grid
     gmx::ArrayRef<const int> getGridIndices() const;
 
+    /*! \brief Returns whether the local grid can be updated without re-sorting at the next search
+     *
+     * Incremental grid updates are enabled with the environment variable
+     * GMX_NBNXN_INCREMENTAL_GRID and only possible without domain decomposition
+     * and with CPU pairlists. When true is returned, the next call to
+     * nbnxn_put_on_grid() for the local atoms keeps the atom order on
+     * the grid. The atoms should then not be put in the unit-cell.
+     *
+     * \param[in] box  The current unit-cell
+     * \param[in] x    The current coordinates of the local atoms
+     */
+    bool canUpdateLocalGridIncrementally(const matrix box, gmx::ArrayRef<const gmx::RVec> x);
+
+    /*! \brief Prints the padding statistics of the local search grid to \p fplog
+     *
+     * The statistics are only collected when the grid is sized using the
+     * effective atom density, set by GMX_NBNXN_EFFECTIVE_DENSITY.
+     * With \p printFinal false, prints the statistics of the first search,
+     * only once. With \p printFinal true, prints the averages over the run.
+     */
+    void printGridPaddingStatistics(FILE* fplog, bool printFinal);
+
     /*! \brief Constructs the pairlist for the given locality
      *
      * When there are no non-self exclusions, \p exclusions can be empty.
@@ -42,6 +42,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 
 #include <algorithm>
@@ -228,10 +229,11 @@ void nbnxn_init_pairlist_fep(t_nblist* nl)
     nl->ielec    = -1;
     nl->ielecmod = -1;
 
-    nl->maxnri   = 0;
-    nl->maxnrj   = 0;
-    nl->nri      = 0;
-    nl->nrj      = 0;
+    nl->maxnri       = 0;
+    nl->maxnrj       = 0;
+    nl->nri          = 0;
+    nl->nrj          = 0;
+    nl->iClusterSize = 1;
     nl->iinr     = nullptr;
     nl->gid      = nullptr;
     nl->shift    = nullptr;
@@ -259,11 +261,12 @@ static void resizeAndZeroBufferFlags(std::vector<gmx_bitmask_t>* flags, const in
  * distance2 between a bounding box of a group of atoms and a grid cell.
  * Since atoms can be geometrically outside of the cell they have been
  * assigned to (when atom groups instead of individual atoms are assigned
- * to cells), this distance returned can be larger than the input.
+ * to cells or when atoms moved after sorting), this distance returned
+ * can be larger than the input.
  */
 static real listRangeForBoundingBoxToGridCell(real rlist, const Grid::Dimensions& gridDims)
 {
-    return rlist + gridDims.maxAtomGroupRadius;
+    return rlist + gridDims.maxAtomGroupRadius + gridDims.maxAtomDisplacement;
 }
 /* Returns the pair-list cutoff between a grid cells given an atom-to-atom pair-list cutoff
  *
@@ -277,7 +280,20 @@ static real listRangeForGridCellToGridCell(real                    rlist,
                                            const Grid::Dimensions& iGridDims,
                                            const Grid::Dimensions& jGridDims)
 {
-    return rlist + iGridDims.maxAtomGroupRadius + jGridDims.maxAtomGroupRadius;
+    return rlist + iGridDims.maxAtomGroupRadius + iGridDims.maxAtomDisplacement
+           + jGridDims.maxAtomGroupRadius + jGridDims.maxAtomDisplacement;
+}
+
+/* Returns the squared cutoff for searching along z in a column of a grid given an atom-to-atom pair-list cutoff
+ *
+ * When atoms moved after sorting, the z-order of the cells in a column is
+ * only approximately preserved: the bounds of a cell can be beyond those
+ * of the next cell by twice the maximum displacement. When searching up
+ * or down a column we therefore need to continue up to this extra distance.
+ */
+static real listRangeForGridColumnZ2(real rlist, const Grid::Dimensions& jGridDims)
+{
+    return gmx::square(rlist + 2 * jGridDims.maxAtomDisplacement);
 }
 
 /* Determines the cell range along one dimension that
@@ -474,6 +490,137 @@ static void clusterBoundingBoxDistance2_xxxx_simd4(const float* bb_j, const int
 
 #endif /* NBNXN_SEARCH_BB_SIMD4 */
 
+#if NBNXN_SEARCH_BB_SIMD_BATCH
+
+//! The number of j-cluster bounding box distances computed in one batch
+static constexpr int c_boundingBoxDistanceBatchSize = GMX_SIMD_FLOAT_WIDTH;
+
+/*! \brief Wide SIMD code calculating the distance^2 between bounding box \p bb_i
+ * and the j-cluster bounding boxes \p bb_j[jBegin] up to \p bb_j[jEnd]
+ *
+ * Requires jEnd - jBegin <= c_boundingBoxDistanceBatchSize.
+ * The distances are stored in \p d2, which should be aligned for SIMD.
+ */
+static void clusterBoundingBoxDistance2Batch(const BoundingBox& bb_i,
+                                             const BoundingBox* bb_j,
+                                             const int          jBegin,
+                                             const int          jEnd,
+                                             float*             d2)
+{
+    // TODO: During SIMDv2 transition only some archs use namespace (remove when done)
+    using namespace gmx;
+
+    constexpr int c_boundingBoxStride = sizeof(BoundingBox) / sizeof(float);
+
+    /* For a partial batch we repeat the last bounding box to avoid
+     * reading beyond the end of the bounding box list.
+     */
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t offset[c_boundingBoxDistanceBatchSize];
+    for (int k = 0; k < c_boundingBoxDistanceBatchSize; k++)
+    {
+        offset[k] = std::min(jBegin + k, jEnd - 1);
+    }
+
+    SimdFloat jxLower, jyLower, jzLower;
+    SimdFloat jxUpper, jyUpper, jzUpper;
+    gatherLoadUTranspose<c_boundingBoxStride>(bb_j[0].lower.ptr(), offset, &jxLower, &jyLower, &jzLower);
+    gatherLoadUTranspose<c_boundingBoxStride>(bb_j[0].upper.ptr(), offset, &jxUpper, &jyUpper, &jzUpper);
+
+    const SimdFloat zero = setZero();
+
+    const SimdFloat dx = max(max(SimdFloat(bb_i.lower.x) - jxUpper, jxLower - SimdFloat(bb_i.upper.x)), zero);
+    const SimdFloat dy = max(max(SimdFloat(bb_i.lower.y) - jyUpper, jyLower - SimdFloat(bb_i.upper.y)), zero);
+    const SimdFloat dz = max(max(SimdFloat(bb_i.lower.z) - jzUpper, jzLower - SimdFloat(bb_i.upper.z)), zero);
+
+    store(d2, dx * dx + dy * dy + dz * dz);
+}
+
+#endif /* NBNXN_SEARCH_BB_SIMD_BATCH */
+
+/*! \brief Provides bounding box distances between one i-cluster and a range of j-clusters
+ *
+ * The cluster pair list construction scans the j-cluster range from the front
+ * and from the back until it finds a j-cluster in range. With wide SIMD
+ * we compute the distances for a batch of j-clusters in the scan direction
+ * at once and return cached values for the following j-clusters.
+ */
+class JClusterBoundingBoxDistances
+{
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] bb_i           The i-cluster bounding box
+     * \param[in] bb_j           The j-cluster bounding boxes
+     * \param[in] jclusterFirst  The first cluster in the j-range
+     * \param[in] jclusterLast   The last cluster in the j-range
+     * \param[in] useBatches     Whether to use batches, when supported
+     */
+    JClusterBoundingBoxDistances(const BoundingBox& bb_i,
+                                 const BoundingBox* bb_j,
+                                 int                jclusterFirst,
+                                 int                jclusterLast,
+                                 bool               useBatches) :
+        bb_i_(bb_i),
+        bb_j_(bb_j),
+        jclusterFirst_(jclusterFirst),
+        jclusterLast_(jclusterLast),
+        useBatches_(useBatches)
+    {
+    }
+
+    //! Returns the distance^2 to j-cluster \p jcluster, scanning from the front when \p scanForward
+    float distance2(int jcluster, bool scanForward)
+    {
+#if NBNXN_SEARCH_BB_SIMD_BATCH
+        if (jcluster >= batchBegin_ && jcluster < batchEnd_)
+        {
+            return d2_[jcluster - batchBegin_];
+        }
+        if (useBatches_ && jclusterLast_ > jclusterFirst_)
+        {
+            if (scanForward)
+            {
+                batchBegin_ = jcluster;
+                batchEnd_   = std::min(jcluster + c_boundingBoxDistanceBatchSize, jclusterLast_ + 1);
+            }
+            else
+            {
+                batchBegin_ = std::max(jcluster + 1 - c_boundingBoxDistanceBatchSize, jclusterFirst_);
+                batchEnd_   = jcluster + 1;
+            }
+            clusterBoundingBoxDistance2Batch(bb_i_, bb_j_, batchBegin_, batchEnd_, d2_);
+
+            return d2_[jcluster - batchBegin_];
+        }
+#else
+        GMX_UNUSED_VALUE(scanForward);
+        GMX_UNUSED_VALUE(useBatches_);
+#endif
+
+        return clusterBoundingBoxDistance2(bb_i_, bb_j_[jcluster]);
+    }
+
+private:
+    //! The i-cluster bounding box
+    const BoundingBox& bb_i_;
+    //! The j-cluster bounding boxes
+    const BoundingBox* bb_j_;
+    //! The first cluster in the j-range
+    int jclusterFirst_;
+    //! The last cluster in the j-range
+    int jclusterLast_;
+    //! Whether to use batches
+    bool useBatches_;
+#if NBNXN_SEARCH_BB_SIMD_BATCH
+    //! The first j-cluster with a distance in d2_
+    int batchBegin_ = 0;
+    //! The end of the j-cluster range with distances in d2_
+    int batchEnd_ = 0;
+    //! Distances^2 for the current batch
+    alignas(GMX_SIMD_ALIGNMENT) float d2_[c_boundingBoxDistanceBatchSize];
+#endif
+};
+
 
 /* Returns if any atom pair from two clusters is within distance sqrt(rlist2) */
 static inline gmx_bool
@@ -649,6 +796,7 @@ NbnxnPairlistCpu::NbnxnPairlistCpu() :
     nci_tot(0),
     work(std::make_unique<NbnxnPairlistCpuWork>())
 {
+    work->useBoundingBoxBatches = (getenv("GMX_NBNXN_NO_BB_BATCHES") == nullptr);
 }
 
 NbnxnPairlistGpu::NbnxnPairlistGpu(gmx::PinningPolicy pinningPolicy) :
@@ -974,12 +1122,15 @@ static void makeClusterListSimple(const Grid&       jGrid,
     const BoundingBox* gmx_restrict bb_ci = nbl->work->iClusterData.bb.data();
     const real* gmx_restrict x_ci         = nbl->work->iClusterData.x.data();
 
+    JClusterBoundingBoxDistances bbDistances(bb_ci[0], jGrid.jBoundingBoxes().data(), jclusterFirst,
+                                             jclusterLast, nbl->work->useBoundingBoxBatches);
+
     gmx_bool InRange;
 
     InRange = FALSE;
     while (!InRange && jclusterFirst <= jclusterLast)
     {
-        real d2 = clusterBoundingBoxDistance2(bb_ci[0], jGrid.jBoundingBoxes()[jclusterFirst]);
+        real d2 = bbDistances.distance2(jclusterFirst, true);
         *numDistanceChecks += 2;
 
         /* Check if the distance is within the distance where
@@ -1024,7 +1175,7 @@ static void makeClusterListSimple(const Grid&       jGrid,
     InRange = FALSE;
     while (!InRange && jclusterLast > jclusterFirst)
     {
-        real d2 = clusterBoundingBoxDistance2(bb_ci[0], jGrid.jBoundingBoxes()[jclusterLast]);
+        real d2 = bbDistances.distance2(jclusterLast, false);
         *numDistanceChecks += 2;
 
         /* Check if the distance is within the distance where
@@ -1443,7 +1594,11 @@ static inline void fep_list_new_nri_copy(t_nblist* nlist)
     assert(nlist->nri < nlist->maxnri);
 
     /* Duplicate the last i-entry, except for jindex, which continues */
-    nlist->iinr[nlist->nri]   = nlist->iinr[nlist->nri - 1];
+    for (int i = 0; i < nlist->iClusterSize; i++)
+    {
+        nlist->iinr[nlist->nri * nlist->iClusterSize + i] =
+                nlist->iinr[(nlist->nri - 1) * nlist->iClusterSize + i];
+    }
     nlist->shift[nlist->nri]  = nlist->shift[nlist->nri - 1];
     nlist->gid[nlist->nri]    = nlist->gid[nlist->nri - 1];
     nlist->jindex[nlist->nri] = nlist->nrj;
@@ -1458,12 +1613,38 @@ static void reallocate_nblist(t_nblist* nl)
                 "reallocating neigborlist (ielec=%d, ivdw=%d, igeometry=%d, type=%d), maxnri=%d\n",
                 nl->ielec, nl->ivdw, nl->igeometry, nl->type, nl->maxnri);
     }
-    srenew(nl->iinr, nl->maxnri);
+    srenew(nl->iinr, nl->maxnri * nl->iClusterSize);
     srenew(nl->gid, nl->maxnri);
     srenew(nl->shift, nl->maxnri);
     srenew(nl->jindex, nl->maxnri + 1);
 }
 
+/* Rellocate the j-atom arrays of FEP list for size nl->maxnrj */
+static void reallocate_nblist_j(t_nblist* nl)
+{
+    srenew(nl->jjnr, nl->maxnrj);
+    srenew(nl->excl_fep, nl->maxnrj * nl->iClusterSize);
+}
+
+/* Sets the number of i-atoms per entry of the FEP list,
+ * this can only be changed when the list is empty.
+ */
+static void setFepListIClusterSize(t_nblist* nl, int iClusterSize)
+{
+    if (nl->iClusterSize != iClusterSize)
+    {
+        GMX_RELEASE_ASSERT(nl->nri == 0,
+                           "The i-cluster size of a FEP list can only change when it is empty");
+        GMX_RELEASE_ASSERT(iClusterSize <= c_fepListMaxIClusterSize,
+                           "The i-cluster size of a FEP list should not exceed the maximum");
+
+        nl->iClusterSize = iClusterSize;
+        /* Trigger reallocation of the arrays that are strided by the cluster size */
+        nl->maxnri = 0;
+        nl->maxnrj = 0;
+    }
+}
+
 /* For load balancing of the free-energy lists over threads, we set
  * the maximum nrj size of an i-entry to 40. This leads to good
  * load balancing in the worst case scenario of a single perturbed
@@ -1473,10 +1654,175 @@ static void reallocate_nblist(t_nblist* nl)
  */
 const int max_nrj_fep = 40;
 
+/* Returns the bit mask of perturbed atoms for j-cluster cja */
+static inline unsigned int jClusterFepBits(const Grid& jGrid, int cja)
+{
+    const int numAtomsICluster = jGrid.geometry().numAtomsICluster;
+    const int numAtomsJCluster = jGrid.geometry().numAtomsJCluster;
+
+    if (numAtomsJCluster == numAtomsICluster)
+    {
+        return jGrid.fepBits(cja - jGrid.cellOffset());
+    }
+    else if (2 * numAtomsJCluster == numAtomsICluster)
+    {
+        const int cjr = cja - jGrid.cellOffset() * 2;
+        /* Extract half of the ci fep mask */
+        return (jGrid.fepBits(cjr >> 1) >> ((cjr & 1) * numAtomsJCluster)) & ((1 << numAtomsJCluster) - 1);
+    }
+    else
+    {
+        const int cjr = cja - (jGrid.cellOffset() >> 1);
+        /* Combine two ci fep masks */
+        return jGrid.fepBits(cjr * 2) + (jGrid.fepBits(cjr * 2 + 1) << numAtomsICluster);
+    }
+}
+
+static_assert(c_nbnxnCpuIClusterSize <= c_fepListMaxIClusterSize,
+              "The FEP lists should support entries with a whole CPU i-cluster");
+
+/* As make_fep_list below, but makes entries for the whole i-cluster,
+ * with all i-atoms sharing one j-atom list. This lets the free-energy
+ * kernel load the j-atom data and reduce the j-atom forces once for
+ * the whole cluster instead of once per i-atom. Pairs that are not
+ * perturbed, or which are not present in the cluster pair list, are
+ * marked as absent. Since all pairs in an entry share the energy group
+ * pair index, this can only be used without energy groups.
+ */
+static void make_fep_list_icluster(gmx::ArrayRef<const int> atomIndices,
+                                   NbnxnPairlistCpu*        nbl,
+                                   gmx_bool                 bDiagRemoved,
+                                   nbnxn_ci_t*              nbl_ci,
+                                   const Grid&              iGrid,
+                                   const Grid&              jGrid,
+                                   t_nblist*                nlist)
+{
+    const int iClusterSize = nbl->na_ci;
+
+    setFepListIClusterSize(nlist, iClusterSize);
+
+    const int ci           = nbl_ci->ci;
+    const int cj_ind_start = nbl_ci->cj_ind_start;
+    const int cj_ind_end   = nbl_ci->cj_ind_end;
+
+    /* We need max one entry for each max_nrj_fep j-atoms */
+    const int nrj_max = (cj_ind_end - cj_ind_start) * nbl->na_cj;
+    const int nri_max = 1 + nrj_max / max_nrj_fep;
+    if (nlist->nri + nri_max > nlist->maxnri)
+    {
+        nlist->maxnri = over_alloc_large(nlist->nri + nri_max);
+        reallocate_nblist(nlist);
+    }
+    if (nlist->nrj + nrj_max > nlist->maxnrj)
+    {
+        nlist->maxnrj = over_alloc_small(nlist->nrj + nrj_max);
+        reallocate_nblist_j(nlist);
+    }
+
+    int nri                = nlist->nri;
+    nlist->jindex[nri + 1] = nlist->jindex[nri];
+    nlist->gid[nri]        = 0;
+    nlist->shift[nri]      = nbl_ci->shift & NBNXN_CI_SHIFT;
+
+    gmx_bool bFEP_i[c_fepListMaxIClusterSize];
+    gmx_bool bFEP_i_any = FALSE;
+    gmx_bool bFEP_i_all = TRUE;
+    for (int i = 0; i < iClusterSize; i++)
+    {
+        const int ai                        = atomIndices[ci * iClusterSize + i];
+        nlist->iinr[nri * iClusterSize + i] = ai;
+        bFEP_i[i]                           = FALSE;
+        if (ai >= 0)
+        {
+            bFEP_i[i]  = iGrid.atomIsPerturbed(ci - iGrid.cellOffset(), i);
+            bFEP_i_any = bFEP_i_any || bFEP_i[i];
+            bFEP_i_all = bFEP_i_all && bFEP_i[i];
+        }
+    }
+
+    for (int cj_ind = cj_ind_start; cj_ind < cj_ind_end; cj_ind++)
+    {
+        const int          cja    = nbl->cj[cj_ind].cj;
+        const unsigned int fep_cj = jClusterFepBits(jGrid, cja);
+
+        if (!bFEP_i_any && fep_cj == 0)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < nbl->na_cj; j++)
+        {
+            const int ind_j = cja * nbl->na_cj + j;
+            const int aj    = atomIndices[ind_j];
+            if (aj < 0)
+            {
+                continue;
+            }
+
+            char     pairState[c_fepListMaxIClusterSize];
+            gmx_bool bHavePair = FALSE;
+            for (int i = 0; i < iClusterSize; i++)
+            {
+                const int ind_i = ci * iClusterSize + i;
+
+                /* Is this interaction perturbed and present in the cluster list? */
+                if (atomIndices[ind_i] >= 0 && (bFEP_i[i] || (fep_cj & (1U << j)))
+                    && (!bDiagRemoved || ind_j >= ind_i))
+                {
+                    const unsigned int pairBit = 1U << (i * nbl->na_cj + j);
+
+                    pairState[i] = (nbl->cj[cj_ind].excl & pairBit) ? efepPairIncluded : efepPairExcluded;
+                    bHavePair    = TRUE;
+
+                    /* Exclude it from the normal list, see make_fep_list */
+                    nbl->cj[cj_ind].excl &= ~pairBit;
+                }
+                else
+                {
+                    pairState[i] = efepPairAbsent;
+                }
+            }
+
+            if (bHavePair)
+            {
+                if (nlist->nrj - nlist->jindex[nri] >= max_nrj_fep)
+                {
+                    fep_list_new_nri_copy(nlist);
+                    nri = nlist->nri;
+                }
+
+                /* Add it to the FEP list */
+                nlist->jjnr[nlist->nrj] = aj;
+                for (int i = 0; i < iClusterSize; i++)
+                {
+                    nlist->excl_fep[nlist->nrj * iClusterSize + i] = pairState[i];
+                }
+                nlist->nrj++;
+            }
+        }
+    }
+
+    if (nlist->nrj > nlist->jindex[nri])
+    {
+        /* Actually add this new, non-empty, list */
+        nlist->nri++;
+        nlist->jindex[nlist->nri] = nlist->nrj;
+    }
+
+    if (bFEP_i_all)
+    {
+        /* All interactions are perturbed, we can skip this entry */
+        nbl_ci->cj_ind_end = cj_ind_start;
+        nbl->ncjInUse -= cj_ind_end - cj_ind_start;
+    }
+}
+
 /* Exclude the perturbed pairs from the Verlet list. This is only done to avoid
  * singularities for overlapping particles (0/0), since the charges and
  * LJ parameters have been zeroed in the nbnxn data structure.
  * Simultaneously make a group pair list for the perturbed pairs.
+ * Without energy groups, the list entries contain whole i-clusters,
+ * see make_fep_list_icluster.
  */
 static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
                           const nbnxn_atomdata_t*  nbat,
@@ -1506,6 +1852,18 @@ static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
         return;
     }
 
+    const nbnxn_atomdata_t::Params& nbatParams = nbat->params();
+
+    const int ngid = nbatParams.nenergrp;
+
+    if (ngid == 1)
+    {
+        make_fep_list_icluster(atomIndices, nbl, bDiagRemoved, nbl_ci, iGrid, jGrid, nlist);
+        return;
+    }
+
+    setFepListIClusterSize(nlist, 1);
+
     ci = nbl_ci->ci;
 
     cj_ind_start = nbl_ci->cj_ind_start;
@@ -1524,10 +1882,6 @@ static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
 
     const int numAtomsJCluster = jGrid.geometry().numAtomsJCluster;
 
-    const nbnxn_atomdata_t::Params& nbatParams = nbat->params();
-
-    const int ngid = nbatParams.nenergrp;
-
     /* TODO: Consider adding a check in grompp and changing this to an assert */
     const int numBitsInEnergyGroupIdsForAtomsInJCluster = sizeof(gid_cj) * 8;
     if (ngid * numAtomsJCluster > numBitsInEnergyGroupIdsForAtomsInJCluster)
@@ -1564,8 +1918,7 @@ static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
             if (nlist->nrj + (cj_ind_end - cj_ind_start) * nbl->na_cj > nlist->maxnrj)
             {
                 nlist->maxnrj = over_alloc_small(nlist->nrj + (cj_ind_end - cj_ind_start) * nbl->na_cj);
-                srenew(nlist->jjnr, nlist->maxnrj);
-                srenew(nlist->excl_fep, nlist->maxnrj);
+                reallocate_nblist_j(nlist);
             }
 
             if (ngid > 1)
@@ -1771,8 +2124,7 @@ static void make_fep_list(gmx::ArrayRef<const int> atomIndices,
                 if (nrjMax > nlist->maxnrj)
                 {
                     nlist->maxnrj = over_alloc_small(nrjMax);
-                    srenew(nlist->jjnr, nlist->maxnrj);
-                    srenew(nlist->excl_fep, nlist->maxnrj);
+                    reallocate_nblist_j(nlist);
                 }
 
                 for (int cj4_ind = cj4_ind_start; cj4_ind < cj4_ind_end; cj4_ind++)
@@ -2723,6 +3075,9 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
 
     const int nrj_target = (nrj_tot + numLists - 1) / numLists;
 
+    /* All lists of a set use the same number of i-atoms per entry */
+    const int iClusterSize = fepLists[0]->iClusterSize;
+
     GMX_ASSERT(gmx_omp_nthreads_get(emntNonbonded) == numLists,
                "We should have as many work objects as FEP lists");
 
@@ -2733,6 +3088,9 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
         {
             t_nblist* nbl = work[th].nbl_fep.get();
 
+            clear_pairlist_fep(nbl);
+            setFepListIClusterSize(nbl, iClusterSize);
+
             /* Note that here we allocate for the total size, instead of
              * a per-thread esimate (which is hard to obtain).
              */
@@ -2744,11 +3102,8 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
             if (nri_tot > nbl->maxnri || nrj_tot > nbl->maxnrj)
             {
                 nbl->maxnrj = over_alloc_small(nrj_tot);
-                srenew(nbl->jjnr, nbl->maxnrj);
-                srenew(nbl->excl_fep, nbl->maxnrj);
+                reallocate_nblist_j(nbl);
             }
-
-            clear_pairlist_fep(nbl);
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
@@ -2777,14 +3132,20 @@ static void balance_fep_lists(gmx::ArrayRef<std::unique_ptr<t_nblist>> fepLists,
                 nbld = work[th_dest].nbl_fep.get();
             }
 
-            nbld->iinr[nbld->nri]  = nbls->iinr[i];
+            for (int c = 0; c < iClusterSize; c++)
+            {
+                nbld->iinr[nbld->nri * iClusterSize + c] = nbls->iinr[i * iClusterSize + c];
+            }
             nbld->gid[nbld->nri]   = nbls->gid[i];
             nbld->shift[nbld->nri] = nbls->shift[i];
 
             for (int j = nbls->jindex[i]; j < nbls->jindex[i + 1]; j++)
             {
-                nbld->jjnr[nbld->nrj]     = nbls->jjnr[j];
-                nbld->excl_fep[nbld->nrj] = nbls->excl_fep[j];
+                nbld->jjnr[nbld->nrj] = nbls->jjnr[j];
+                for (int c = 0; c < iClusterSize; c++)
+                {
+                    nbld->excl_fep[nbld->nrj * iClusterSize + c] = nbls->excl_fep[j * iClusterSize + c];
+                }
                 nbld->nrj++;
             }
             nbld->nri++;
@@ -3223,6 +3584,7 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
 
     const real listRangeBBToJCell2 =
             gmx::square(listRangeForBoundingBoxToGridCell(rlist, jGrid.dimensions()));
+    const real listRangeColumnZ2 = listRangeForGridColumnZ2(rlist, jGrid.dimensions());
 
     /* Initially ci_b and ci to 1 before where we want them to start,
      * as they will both be incremented in next_ci.
@@ -3286,7 +3648,7 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
 
             d2z_cx = d2z + d2cx;
 
-            if (d2z_cx >= rlist2)
+            if (d2z_cx >= listRangeColumnZ2)
             {
                 continue;
             }
@@ -3459,7 +3821,8 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
                                 int downTestCell = midCell;
                                 while (downTestCell >= columnStart
                                        && (bbcz_j[downTestCell].upper >= bz0
-                                           || d2xy + gmx::square(bbcz_j[downTestCell].upper - bz0) < rlist2))
+                                           || d2xy + gmx::square(bbcz_j[downTestCell].upper - bz0)
+                                                      < listRangeColumnZ2))
                                 {
                                     downTestCell--;
                                 }
@@ -3474,7 +3837,8 @@ static void nbnxn_make_pairlist_part(const Nbnxm::GridSet&   gridSet,
                                 int upTestCell = midCell + 1;
                                 while (upTestCell < columnEnd
                                        && (bbcz_j[upTestCell].lower <= bz1
-                                           || d2xy + gmx::square(bbcz_j[upTestCell].lower - bz1) < rlist2))
+                                           || d2xy + gmx::square(bbcz_j[upTestCell].lower - bz1)
+                                                      < listRangeColumnZ2))
                                 {
                                     upTestCell++;
                                 }
@@ -3918,6 +4282,24 @@ static Range<int> getJZoneRange(const gmx_domdec_zones_t& ddZones,
 //! Prepares CPU lists produced by the search for dynamic pruning
 static void prepareListsForDynamicPruning(gmx::ArrayRef<NbnxnPairlistCpu> lists);
 
+//! Returns the number of perturbed atom pairs in a set of FEP lists
+static int64_t countFepPairs(gmx::ArrayRef<const std::unique_ptr<t_nblist>> fepLists)
+{
+    int64_t numPairs = 0;
+    for (const auto& list : fepLists)
+    {
+        for (int k = 0; k < list->nrj * list->iClusterSize; k++)
+        {
+            if (list->excl_fep[k] != efepPairAbsent)
+            {
+                numPairs++;
+            }
+        }
+    }
+
+    return numPairs;
+}
+
 void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
                                      gmx::ArrayRef<PairsearchWork> searchWork,
                                      nbnxn_atomdata_t*             nbat,
@@ -4086,6 +4468,8 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
             natpair_lj_  = np_noq * nap;
             natpair_q_   = np_hlj * nap / 2;
 
+            searchCycleCounting->numAtomPairs_ += static_cast<int64_t>(np_tot) * nap;
+
             if (combineLists_ && numLists > 1)
             {
                 GMX_ASSERT(!isCpuType_, "Can only combine GPU lists");
@@ -4139,6 +4523,11 @@ void PairlistSet::constructPairlists(const Nbnxm::GridSet&         gridSet,
     {
         /* Balance the free-energy lists over all the threads */
         balance_fep_lists(fepLists_, searchWork);
+
+        if (searchCycleCounting->recordCycles_)
+        {
+            searchCycleCounting->numFepPairs_ += countFepPairs(fepLists_);
+        }
     }
 
     if (isCpuType_)
@@ -133,10 +133,13 @@ static inline void makeClusterListSimd2xnn(const Grid&       jGrid,
 
     rc2_S = SimdReal(rlist2);
 
+    JClusterBoundingBoxDistances bbDistances(bb_ci[0], jGrid.jBoundingBoxes().data(), jclusterFirst,
+                                             jclusterLast, nbl->work->useBoundingBoxBatches);
+
     InRange = FALSE;
     while (!InRange && jclusterFirst <= jclusterLast)
     {
-        d2 = clusterBoundingBoxDistance2(bb_ci[0], jGrid.jBoundingBoxes()[jclusterFirst]);
+        d2 = bbDistances.distance2(jclusterFirst, true);
         *numDistanceChecks += 2;
 
         /* Check if the distance is within the distance where
@@ -191,7 +194,7 @@ static inline void makeClusterListSimd2xnn(const Grid&       jGrid,
     InRange = FALSE;
     while (!InRange && jclusterLast > jclusterFirst)
     {
-        d2 = clusterBoundingBoxDistance2(bb_ci[0], jGrid.jBoundingBoxes()[jclusterLast]);
+        d2 = bbDistances.distance2(jclusterLast, false);
         *numDistanceChecks += 2;
 
         /* Check if the distance is within the distance where
@@ -90,6 +90,9 @@ struct NbnxnPairlistCpuWork
     //! Nr. of cluster pairs with 1/2 LJ for flop count
     int ncj_hlj;
 
+    //! Whether to compute bounding box distances in SIMD batches, when supported
+    bool useBoundingBoxBatches;
+
     //! Protect data from cache pollution between threads
     gmx_cache_protect_t cp1;
 };
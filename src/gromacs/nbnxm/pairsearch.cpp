@@ -69,6 +69,15 @@ void SearchCycleCounting::printCycles(FILE* fp, gmx::ArrayRef<const PairsearchWo
             fprintf(fp, " %4.1f", workEntry.cycleCounter.averageMCycles());
         }
     }
+    if (cc_[enbsCCfep].count() > 0 && numAtomPairs_ > 0)
+    {
+        /* Report the perturbed pairs separately, as their cost per pair is
+         * an order of magnitude higher than that of the cluster pair kernels.
+         */
+        fprintf(fp, " fep pairs %4.1f%% fep kernel %5.2f",
+                100.0 * static_cast<double>(numFepPairs_) / static_cast<double>(numAtomPairs_),
+                cc_[enbsCCfep].averageMCycles());
+    }
     fprintf(fp, "\n");
 }
 
@@ -51,6 +51,7 @@
 #ifndef GMX_NBNXM_PAIRSEARCH_H
 #define GMX_NBNXM_PAIRSEARCH_H
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -111,12 +112,13 @@ private:
     gmx_cycles_t start_ = 0;
 };
 
-//! Local cycle count enum for profiling different parts of search
+//! Local cycle count enum for profiling different parts of search and the free-energy kernel
 enum
 {
     enbsCCgrid,
     enbsCCsearch,
     enbsCCcombine,
+    enbsCCfep,
     enbsCCnr
 };
 
@@ -138,6 +140,10 @@ struct SearchCycleCounting
     bool recordCycles_ = false;
     //! The number of times pairsearching has been performed, local+non-local count as 1
     int searchCount_ = 0;
+    //! The number of atom pairs in the cluster pair lists, summed over all searches
+    int64_t numAtomPairs_ = 0;
+    //! The number of perturbed atom pairs in the free-energy lists, summed over all searches
+    int64_t numFepPairs_ = 0;
     //! The set of cycle counters
     nbnxn_cycle_t cc_[enbsCCnr];
 };
@@ -223,9 +229,21 @@ public:
     //! Sets the order of the local atoms to the order grid atom ordering
     void setLocalAtomOrder() { gridSet_.setLocalAtomOrder(); }
 
+    //! Returns whether the local grid can be updated without re-sorting, see GridSet
+    bool canUpdateLocalGridIncrementally(const matrix box, gmx::ArrayRef<const gmx::RVec> x)
+    {
+        return gridSet_.canUpdateLocalGridIncrementally(box, x);
+    }
+
     //! Returns the set of search grids
     const Nbnxm::GridSet& gridSet() const { return gridSet_; }
 
+    //! Prints the padding statistics of the home grid to \p fp, see GridSet
+    void printGridPaddingStatistics(FILE* fp, bool printFinal)
+    {
+        gridSet_.printPaddingStatistics(fp, printFinal);
+    }
+
     //! Returns the list of thread-local work objects
     gmx::ArrayRef<const PairsearchWork> work() const { return work_; }
 
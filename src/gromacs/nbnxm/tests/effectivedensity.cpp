@@ -0,0 +1,158 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for sizing the pair-search grid using the effective atom density
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/gridset.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairlist.h"
+#include "gromacs/nbnxm/pairlistset.h"
+#include "gromacs/nbnxm/pairlistsets.h"
+#include "gromacs/nbnxm/pairsearch.h"
+
+#include "testutils/setenv.h"
+
+#include "testsystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The pairlist cut-off
+constexpr real c_pairlistCutoff = 0.9;
+
+/*! \brief Puts the atoms of \p system in \p box on the grid and constructs the local pairlist
+ *
+ * Returns the number of cluster pairs in the pairlist.
+ */
+int searchPairsInBox(nonbonded_verlet_t* nbv, const BenchmarkSystem& system, const matrix box)
+{
+    const rvec lowerCorner = { 0, 0, 0 };
+    const rvec upperCorner = { box[XX][XX], box[YY][YY], box[ZZ][ZZ] };
+    const real atomDensity = system.coordinates.size() / det(box);
+
+    nbnxn_put_on_grid(nbv, box, 0, lowerCorner, upperCorner, nullptr,
+                      { 0, int(system.coordinates.size()) }, atomDensity, system.atomInfoAllVdw,
+                      system.coordinates, 0, nullptr);
+
+    t_nrnb nrnb;
+    nbv->constructPairlist(InteractionLocality::Local, system.excls, 0, &nrnb);
+
+    int numClusterPairs = 0;
+    for (const NbnxnPairlistCpu& list :
+         nbv->pairlistSets().pairlistSet(InteractionLocality::Local).cpuLists())
+    {
+        numClusterPairs += list.cj.size();
+    }
+
+    return numClusterPairs;
+}
+
+/* With a vacuum slab, the effective density grid should contain every
+ * atom once and give the same pairs within the cut-off, while fewer of
+ * the atom pairs in the cluster pairs are padding, i.e. involve a filler
+ * atom or are beyond the cut-off.
+ */
+TEST(EffectiveDensityGridTest, ReducesPaddingWithVacuumSlab)
+{
+    const BenchmarkSystem system(1);
+
+    /* Add twice the height of the water box as vacuum along z */
+    matrix box;
+    copy_mat(system.box, box);
+    box[ZZ][ZZ] *= 3;
+
+    gmxSetenv("GMX_NBNXN_EFFECTIVE_DENSITY", "1", 1);
+    auto nbvEffective = makeNbnxmSetup(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_pairlistCutoff);
+    gmxUnsetenv("GMX_NBNXN_EFFECTIVE_DENSITY");
+    auto nbvAverage = makeNbnxmSetup(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_pairlistCutoff);
+
+    const int numClusterPairsEffective = searchPairsInBox(nbvEffective.get(), system, box);
+    const int numClusterPairsAverage   = searchPairsInBox(nbvAverage.get(), system, box);
+
+    const Nbnxm::GridSet& gridSetEffective = nbvEffective->pairSearch_->gridSet();
+
+    /* The effective density should be close to the density of the water box */
+    const Nbnxm::GridSet::PaddingStatistics& stats = gridSetEffective.paddingStatistics();
+    EXPECT_EQ(1, stats.numGriddings);
+    EXPECT_EQ(int(system.coordinates.size()), stats.numRealAtoms);
+    EXPECT_GT(stats.effectiveDensity, 2.5_real * stats.averageDensity);
+    /* The grid with the average density does not collect statistics */
+    EXPECT_EQ(0, nbvAverage->pairSearch_->gridSet().paddingStatistics().numGriddings);
+
+    for (const Nbnxm::GridSet* gridSet : { &gridSetEffective, &nbvAverage->pairSearch_->gridSet() })
+    {
+        std::vector<int> atomCount(system.coordinates.size(), 0);
+        for (int atomIndex : gridSet->atomIndices())
+        {
+            if (atomIndex >= 0)
+            {
+                atomCount[atomIndex]++;
+            }
+        }
+        EXPECT_EQ(std::vector<int>(system.coordinates.size(), 1), atomCount);
+    }
+
+    const std::vector<AtomPair> pairsEffective =
+            pairsInPairlist(*nbvEffective, box, system.coordinates, c_pairlistCutoff);
+    const std::vector<AtomPair> pairsAverage =
+            pairsInPairlist(*nbvAverage, box, system.coordinates, c_pairlistCutoff);
+    EXPECT_EQ(pairsAverage, pairsEffective);
+
+    /* Each cluster pair contains 4x4 atom pairs */
+    const real paddedFractionEffective =
+            1 - pairsEffective.size() / (16.0 * numClusterPairsEffective);
+    const real paddedFractionAverage = 1 - pairsAverage.size() / (16.0 * numClusterPairsAverage);
+    EXPECT_LT(paddedFractionEffective, paddedFractionAverage - 0.02_real);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,259 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the free-energy pairlists generated by the CPU pair search
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/nblist.h"
+#include "gromacs/nbnxm/atomdata.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/nbnxm_simd.h"
+#include "gromacs/nbnxm/pairlist.h"
+#include "gromacs/nbnxm/pairlistset.h"
+#include "gromacs/nbnxm/pairlistsets.h"
+#include "gromacs/nbnxm/pairsearch.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/logger.h"
+
+#include "testsystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The pairlist cut-off
+constexpr real c_pairlistCutoff = 0.9;
+
+//! A perturbed pair in a free-energy pairlist, the first two elements are the sorted atom indices
+using FepListPair = std::tuple<int, int, bool>;
+
+/*! \brief Returns a CPU non-bonded setup with perturbed atoms and \p numEnergyGroups energy groups
+ *
+ * The atoms are put on the grid and the pairlist is constructed.
+ */
+std::unique_ptr<nonbonded_verlet_t> makeFepSearchSetup(const BenchmarkSystem& system,
+                                                       Nbnxm::KernelType      kernelType,
+                                                       ArrayRef<const int>    atomInfo,
+                                                       int                    numEnergyGroups)
+{
+    // We don't want to call gmx_omp_nthreads_init(), so we init what we need
+    gmx_omp_nthreads_set(emntPairsearch, 1);
+    gmx_omp_nthreads_set(emntNonbonded, 1);
+
+    const PairlistParams pairlistParams(kernelType, true, c_pairlistCutoff, false);
+
+    auto pairlistSets = std::make_unique<PairlistSets>(pairlistParams, false, 0);
+    auto pairSearch   = std::make_unique<PairSearch>(PbcType::Xyz, false, nullptr, nullptr,
+                                                   pairlistParams.pairlistType, true, 1,
+                                                   PinningPolicy::CannotBePinned);
+    auto atomData     = std::make_unique<nbnxn_atomdata_t>(PinningPolicy::CannotBePinned);
+
+    Nbnxm::KernelSetup kernelSetup;
+    kernelSetup.kernelType         = kernelType;
+    kernelSetup.ewaldExclusionType = Nbnxm::EwaldExclusionType::Table;
+
+    auto nbv = std::make_unique<nonbonded_verlet_t>(std::move(pairlistSets), std::move(pairSearch),
+                                                    std::move(atomData), kernelSetup, nullptr,
+                                                    nullptr);
+
+    nbnxn_atomdata_init(MDLogger(), nbv->nbat.get(), kernelType, ljcrGEOM, system.numAtomTypes,
+                        system.nonbondedParameters, numEnergyGroups, 1);
+
+    const rvec lowerCorner = { 0, 0, 0 };
+    const rvec upperCorner = { system.box[XX][XX], system.box[YY][YY], system.box[ZZ][ZZ] };
+    const int  numAtoms    = system.coordinates.size();
+    nbnxn_put_on_grid(nbv.get(), system.box, 0, lowerCorner, upperCorner, nullptr, { 0, numAtoms },
+                      numAtoms / det(system.box), atomInfo, system.coordinates, 0, nullptr);
+    nbv->setAtomProperties(system.atomTypes, system.charges, atomInfo);
+
+    t_nrnb nrnb;
+    nbv->constructPairlist(InteractionLocality::Local, system.excls, 0, &nrnb);
+
+    return nbv;
+}
+
+/*! \brief Returns the sorted pairs in the local free-energy lists with their exclusion state
+ *
+ * Also returns the perturbed, non-excluded pairs within \p cutoff in \p pairsWithinCutoff
+ * and the number of absent pairs in \p numAbsentPairs.
+ */
+std::vector<FepListPair> pairsInFepLists(const nonbonded_verlet_t& nbv,
+                                         const BenchmarkSystem&    system,
+                                         real                      cutoff,
+                                         std::vector<AtomPair>*    pairsWithinCutoff,
+                                         int*                      numAbsentPairs)
+{
+    rvec shiftVec[SHIFTS];
+    calc_shifts(system.box, shiftVec);
+
+    std::vector<FepListPair> pairs;
+    *numAbsentPairs = 0;
+    for (const auto& list : nbv.pairlistSets().pairlistSet(InteractionLocality::Local).fepLists())
+    {
+        const int iClusterSize = list->iClusterSize;
+        for (int n = 0; n < list->nri; n++)
+        {
+            for (int c = 0; c < iClusterSize; c++)
+            {
+                const int ai = list->iinr[n * iClusterSize + c];
+                if (ai < 0)
+                {
+                    continue;
+                }
+                for (int k = list->jindex[n]; k < list->jindex[n + 1]; k++)
+                {
+                    const int  aj        = list->jjnr[k];
+                    const char pairState = list->excl_fep[k * iClusterSize + c];
+                    if (pairState == efepPairAbsent)
+                    {
+                        (*numAbsentPairs)++;
+                        continue;
+                    }
+                    const bool isIncluded = (pairState == efepPairIncluded);
+                    pairs.emplace_back(std::min(ai, aj), std::max(ai, aj), isIncluded);
+
+                    rvec dx;
+                    rvec_add(system.coordinates[ai], shiftVec[list->shift[n]], dx);
+                    rvec_dec(dx, system.coordinates[aj]);
+                    if (isIncluded && norm2(dx) < cutoff * cutoff)
+                    {
+                        pairsWithinCutoff->emplace_back(std::min(ai, aj), std::max(ai, aj));
+                    }
+                }
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    return pairs;
+}
+
+TEST(FepPairlistTest, IClusterEntriesHaveTheSamePairsAsAtomEntries)
+{
+    const BenchmarkSystem        system(1);
+    const PairsWithinCutoffRange reference(system, system.coordinates, c_pairlistCutoff);
+
+    /* Perturb every fifth atom and put the atoms alternatingly in two energy groups */
+    std::vector<int> atomInfo = system.atomInfoAllVdw;
+    for (size_t a = 0; a < atomInfo.size(); a++)
+    {
+        if (a % 5 == 0)
+        {
+            SET_CGINFO_FEP(atomInfo[a]);
+        }
+    }
+    std::vector<int> atomInfoEnergyGroups = atomInfo;
+    for (size_t a = 0; a < atomInfo.size(); a++)
+    {
+        SET_CGINFO_GID(atomInfoEnergyGroups[a], a % 2);
+    }
+
+    std::vector<Nbnxm::KernelType> kernelTypes = { Nbnxm::KernelType::Cpu4x4_PlainC };
+#ifdef GMX_NBNXN_SIMD_4XN
+    kernelTypes.push_back(Nbnxm::KernelType::Cpu4xN_Simd_4xN);
+#endif
+#ifdef GMX_NBNXN_SIMD_2XNN
+    kernelTypes.push_back(Nbnxm::KernelType::Cpu4xN_Simd_2xNN);
+#endif
+    for (const Nbnxm::KernelType kernelType : kernelTypes)
+    {
+        SCOPED_TRACE("Kernel type " + std::string(Nbnxm::lookup_kernel_name(kernelType)));
+
+        /* Without energy groups the entries contain whole i-clusters,
+         * with energy groups the entries contain single i-atoms.
+         */
+        auto nbvCluster = makeFepSearchSetup(system, kernelType, atomInfo, 1);
+        auto nbvAtom    = makeFepSearchSetup(system, kernelType, atomInfoEnergyGroups, 2);
+        for (const auto* nbv : { nbvCluster.get(), nbvAtom.get() })
+        {
+            const auto& fepLists =
+                    nbv->pairlistSets().pairlistSet(InteractionLocality::Local).fepLists();
+            EXPECT_EQ(nbv == nbvCluster.get() ? c_nbnxnCpuIClusterSize : 1,
+                      fepLists[0]->iClusterSize);
+        }
+
+        std::vector<AtomPair>          fepPairsCluster;
+        std::vector<AtomPair>          fepPairsAtom;
+        int                            numAbsentCluster;
+        int                            numAbsentAtom;
+        const std::vector<FepListPair> pairsCluster = pairsInFepLists(
+                *nbvCluster, system, c_pairlistCutoff, &fepPairsCluster, &numAbsentCluster);
+        const std::vector<FepListPair> pairsAtom =
+                pairsInFepLists(*nbvAtom, system, c_pairlistCutoff, &fepPairsAtom, &numAbsentAtom);
+
+        EXPECT_FALSE(pairsCluster.empty());
+        EXPECT_EQ(pairsAtom, pairsCluster);
+        EXPECT_GT(numAbsentCluster, 0);
+        EXPECT_EQ(0, numAbsentAtom);
+
+        /* The perturbed pairs should be removed from the cluster pairlist,
+         * together the two lists should contain all pairs once.
+         */
+        for (const auto& nbvAndFepPairs : { std::make_pair(nbvCluster.get(), &fepPairsCluster),
+                                            std::make_pair(nbvAtom.get(), &fepPairsAtom) })
+        {
+            std::vector<AtomPair> pairs = pairsInPairlist(*nbvAndFepPairs.first, system.box,
+                                                          system.coordinates, c_pairlistCutoff);
+            pairs.insert(pairs.end(), nbvAndFepPairs.second->begin(), nbvAndFepPairs.second->end());
+            std::sort(pairs.begin(), pairs.end());
+            reference.checkPairs(pairs);
+        }
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,145 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for incremental updates of the local pair-search grid
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/grid.h"
+#include "gromacs/nbnxm/gridset.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairsearch.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+
+#include "testutils/setenv.h"
+
+#include "testsystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The pairlist cut-off
+constexpr real c_pairlistCutoff = 0.9;
+
+//! Returns \p x with all atoms displaced randomly by at most \p maxDisplacement per dimension
+std::vector<RVec> displacedCoordinates(ArrayRef<const RVec> x, real maxDisplacement)
+{
+    DefaultRandomEngine           rng(123456);
+    UniformRealDistribution<real> dist(-maxDisplacement, maxDisplacement);
+
+    std::vector<RVec> xDisplaced(x.begin(), x.end());
+    for (RVec& xAtom : xDisplaced)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            xAtom[d] += dist(rng);
+        }
+    }
+
+    return xDisplaced;
+}
+
+TEST(IncrementalGridUpdateTest, GivesTheSameGridAndPairlistAsRebuild)
+{
+    const BenchmarkSystem system(1);
+
+    gmxSetenv("GMX_NBNXN_INCREMENTAL_GRID", "1", 1);
+    auto nbvIncremental =
+            makeNbnxmSetup(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_pairlistCutoff);
+    gmxUnsetenv("GMX_NBNXN_INCREMENTAL_GRID");
+    auto nbvRebuild = makeNbnxmSetup(system, Nbnxm::KernelType::Cpu4x4_PlainC, c_pairlistCutoff);
+
+    searchPairs(nbvIncremental.get(), system, system.coordinates);
+    searchPairs(nbvRebuild.get(), system, system.coordinates);
+
+    /* Displacements that are too large for an incremental update should be rejected */
+    EXPECT_FALSE(nbvIncremental->canUpdateLocalGridIncrementally(
+            system.box, displacedCoordinates(system.coordinates, 1.0)));
+
+    /* Atoms close to the box edges will move out of the unit-cell */
+    const std::vector<RVec> x = displacedCoordinates(system.coordinates, 0.05);
+    ASSERT_TRUE(nbvIncremental->canUpdateLocalGridIncrementally(system.box, x));
+    searchPairs(nbvIncremental.get(), system, x);
+
+    /* Without incremental updates the atoms are put in the unit-cell before gridding */
+    std::vector<RVec> xInBox = x;
+    put_atoms_in_box(PbcType::Xyz, system.box, xInBox);
+    EXPECT_FALSE(nbvRebuild->canUpdateLocalGridIncrementally(system.box, xInBox));
+    searchPairs(nbvRebuild.get(), system, xInBox);
+
+    /* The grids should have the same dimensions and contain all atoms once */
+    const Nbnxm::GridSet& gridSetIncremental = nbvIncremental->pairSearch_->gridSet();
+    const Nbnxm::GridSet& gridSetRebuild     = nbvRebuild->pairSearch_->gridSet();
+    for (int d = 0; d < DIM - 1; d++)
+    {
+        EXPECT_EQ(gridSetRebuild.grids()[0].dimensions().numCells[d],
+                  gridSetIncremental.grids()[0].dimensions().numCells[d]);
+    }
+    for (const Nbnxm::GridSet* gridSet : { &gridSetIncremental, &gridSetRebuild })
+    {
+        std::vector<int> atomCount(x.size(), 0);
+        for (int atomIndex : gridSet->atomIndices())
+        {
+            if (atomIndex >= 0)
+            {
+                atomCount[atomIndex]++;
+            }
+        }
+        EXPECT_EQ(std::vector<int>(x.size(), 1), atomCount);
+    }
+
+    /* All pairs within the cut-off should be present exactly once in both lists */
+    const PairsWithinCutoffRange reference(system, xInBox, c_pairlistCutoff);
+    reference.checkPairs(pairsInPairlist(*nbvIncremental, system.box, x, c_pairlistCutoff));
+    reference.checkPairs(pairsInPairlist(*nbvRebuild, system.box, xInBox, c_pairlistCutoff));
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
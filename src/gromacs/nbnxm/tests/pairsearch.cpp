@@ -0,0 +1,134 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the CPU cluster pair search
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/nbnxm_simd.h"
+#include "gromacs/nbnxm/pairlist.h"
+#include "gromacs/nbnxm/pairlistset.h"
+#include "gromacs/nbnxm/pairlistsets.h"
+
+#include "testutils/setenv.h"
+
+#include "testsystem.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The pairlist cut-off
+constexpr real c_pairlistCutoff = 0.9;
+
+//! Returns the CPU kernel types supported by this build
+std::vector<Nbnxm::KernelType> cpuKernelTypes()
+{
+    std::vector<Nbnxm::KernelType> kernelTypes = { Nbnxm::KernelType::Cpu4x4_PlainC };
+#ifdef GMX_NBNXN_SIMD_4XN
+    kernelTypes.push_back(Nbnxm::KernelType::Cpu4xN_Simd_4xN);
+#endif
+#ifdef GMX_NBNXN_SIMD_2XNN
+    kernelTypes.push_back(Nbnxm::KernelType::Cpu4xN_Simd_2xNN);
+#endif
+    return kernelTypes;
+}
+
+//! Expects that the local CPU pairlists of \p nbv and \p nbvRef are identical
+void expectIdenticalPairlists(const nonbonded_verlet_t& nbvRef, const nonbonded_verlet_t& nbv)
+{
+    const auto listsRef = nbvRef.pairlistSets().pairlistSet(InteractionLocality::Local).cpuLists();
+    const auto lists    = nbv.pairlistSets().pairlistSet(InteractionLocality::Local).cpuLists();
+    ASSERT_EQ(listsRef.size(), lists.size());
+    for (size_t l = 0; l < lists.size(); l++)
+    {
+        const NbnxnPairlistCpu& listRef = listsRef[l];
+        const NbnxnPairlistCpu& list    = lists[l];
+        ASSERT_EQ(listRef.ci.size(), list.ci.size());
+        for (size_t i = 0; i < list.ci.size(); i++)
+        {
+            EXPECT_EQ(listRef.ci[i].ci, list.ci[i].ci);
+            EXPECT_EQ(listRef.ci[i].shift, list.ci[i].shift);
+            EXPECT_EQ(listRef.ci[i].cj_ind_start, list.ci[i].cj_ind_start);
+            ASSERT_EQ(listRef.ci[i].cj_ind_end, list.ci[i].cj_ind_end);
+        }
+        ASSERT_EQ(listRef.ncjInUse, list.ncjInUse);
+        for (int j = 0; j < list.ncjInUse; j++)
+        {
+            EXPECT_EQ(listRef.cj[j].cj, list.cj[j].cj);
+            EXPECT_EQ(listRef.cj[j].excl, list.cj[j].excl);
+        }
+    }
+}
+
+TEST(PairSearchTest, BoundingBoxBatchesGiveTheSamePairlist)
+{
+    const BenchmarkSystem        system(1);
+    const PairsWithinCutoffRange reference(system, system.coordinates, c_pairlistCutoff);
+
+    for (const Nbnxm::KernelType kernelType : cpuKernelTypes())
+    {
+        SCOPED_TRACE("Kernel type " + std::string(Nbnxm::lookup_kernel_name(kernelType)));
+
+        auto nbvBatches = makeNbnxmSetup(system, kernelType, c_pairlistCutoff);
+        gmxSetenv("GMX_NBNXN_NO_BB_BATCHES", "1", 1);
+        auto nbvSingle = makeNbnxmSetup(system, kernelType, c_pairlistCutoff);
+        gmxUnsetenv("GMX_NBNXN_NO_BB_BATCHES");
+
+        searchPairs(nbvBatches.get(), system, system.coordinates);
+        searchPairs(nbvSingle.get(), system, system.coordinates);
+
+        expectIdenticalPairlists(*nbvSingle, *nbvBatches);
+        reference.checkPairs(pairsInPairlist(*nbvBatches, system.box, system.coordinates,
+                                             c_pairlistCutoff));
+    }
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
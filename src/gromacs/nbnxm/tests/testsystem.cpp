@@ -0,0 +1,205 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements helper functions for setting up pair searches in nbnxm tests
+ *
+ * \ingroup module_nbnxm
+ */
+#include "gmxpre.h"
+
+#include "testsystem.h"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/nbnxm/atomdata.h"
+#include "gromacs/nbnxm/benchmark/bench_system.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/nbnxm/pairlist.h"
+#include "gromacs/nbnxm/pairlistset.h"
+#include "gromacs/nbnxm/pairlistsets.h"
+#include "gromacs/nbnxm/pairsearch.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/logger.h"
+
+namespace gmx
+{
+namespace test
+{
+
+std::unique_ptr<nonbonded_verlet_t> makeNbnxmSetup(const BenchmarkSystem& system,
+                                                   Nbnxm::KernelType      kernelType,
+                                                   real                   pairlistCutoff)
+{
+    // We don't want to call gmx_omp_nthreads_init(), so we init what we need
+    gmx_omp_nthreads_set(emntPairsearch, 1);
+    gmx_omp_nthreads_set(emntNonbonded, 1);
+
+    const PairlistParams pairlistParams(kernelType, false, pairlistCutoff, false);
+
+    auto pairlistSets = std::make_unique<PairlistSets>(pairlistParams, false, 0);
+    auto pairSearch   = std::make_unique<PairSearch>(PbcType::Xyz, false, nullptr, nullptr,
+                                                   pairlistParams.pairlistType, false, 1,
+                                                   PinningPolicy::CannotBePinned);
+    auto atomData     = std::make_unique<nbnxn_atomdata_t>(PinningPolicy::CannotBePinned);
+
+    Nbnxm::KernelSetup kernelSetup;
+    kernelSetup.kernelType         = kernelType;
+    kernelSetup.ewaldExclusionType = (kernelType == Nbnxm::KernelType::Cpu4x4_PlainC
+                                              ? Nbnxm::EwaldExclusionType::Table
+                                              : Nbnxm::EwaldExclusionType::Analytical);
+
+    auto nbv = std::make_unique<nonbonded_verlet_t>(std::move(pairlistSets), std::move(pairSearch),
+                                                    std::move(atomData), kernelSetup, nullptr,
+                                                    nullptr);
+
+    nbnxn_atomdata_init(MDLogger(), nbv->nbat.get(), kernelType, ljcrGEOM, system.numAtomTypes,
+                        system.nonbondedParameters, 1, 1);
+
+    return nbv;
+}
+
+void searchPairs(nonbonded_verlet_t* nbv, const BenchmarkSystem& system, ArrayRef<const RVec> x)
+{
+    const rvec lowerCorner = { 0, 0, 0 };
+    const rvec upperCorner = { system.box[XX][XX], system.box[YY][YY], system.box[ZZ][ZZ] };
+    const real atomDensity = x.size() / det(system.box);
+
+    nbnxn_put_on_grid(nbv, system.box, 0, lowerCorner, upperCorner, nullptr, { 0, int(x.size()) },
+                      atomDensity, system.atomInfoAllVdw, x, 0, nullptr);
+
+    t_nrnb nrnb;
+    nbv->constructPairlist(InteractionLocality::Local, system.excls, 0, &nrnb);
+}
+
+std::vector<AtomPair> pairsInPairlist(const nonbonded_verlet_t& nbv,
+                                      const matrix              box,
+                                      ArrayRef<const RVec>      x,
+                                      real                      cutoff)
+{
+    rvec shiftVec[SHIFTS];
+    calc_shifts(box, shiftVec);
+
+    const ArrayRef<const int> atomIndices = nbv.pairSearch_->gridSet().atomIndices();
+
+    std::vector<AtomPair> pairs;
+    for (const NbnxnPairlistCpu& list :
+         nbv.pairlistSets().pairlistSet(InteractionLocality::Local).cpuLists())
+    {
+        for (const nbnxn_ci_t& ciEntry : list.ci)
+        {
+            const int shift = ciEntry.shift & NBNXN_CI_SHIFT;
+            for (int cjIndex = ciEntry.cj_ind_start; cjIndex < ciEntry.cj_ind_end; cjIndex++)
+            {
+                const nbnxn_cj_t& cjEntry = list.cj[cjIndex];
+                for (int i = 0; i < list.na_ci; i++)
+                {
+                    const int ai = atomIndices[ciEntry.ci * list.na_ci + i];
+                    for (int j = 0; j < list.na_cj; j++)
+                    {
+                        const int aj = atomIndices[cjEntry.cj * list.na_cj + j];
+                        if (ai < 0 || aj < 0 || ((cjEntry.excl >> (i * list.na_cj + j)) & 1U) == 0)
+                        {
+                            continue;
+                        }
+                        rvec dx;
+                        rvec_add(x[ai], shiftVec[shift], dx);
+                        rvec_dec(dx, x[aj]);
+                        if (norm2(dx) < cutoff * cutoff)
+                        {
+                            pairs.emplace_back(std::min(ai, aj), std::max(ai, aj));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    return pairs;
+}
+
+std::vector<AtomPair> pairsWithinCutoff(const BenchmarkSystem& system,
+                                        ArrayRef<const RVec>   x,
+                                        real                   cutoff)
+{
+    t_pbc pbc;
+    set_pbc(&pbc, PbcType::Xyz, system.box);
+
+    std::vector<AtomPair> pairs;
+    for (int i = 0; i < x.ssize(); i++)
+    {
+        const ArrayRef<const int> excludedAtoms = system.excls[i];
+        for (int j = i + 1; j < x.ssize(); j++)
+        {
+            rvec dx;
+            pbc_dx_aiuc(&pbc, x[i], x[j], dx);
+            if (norm2(dx) < cutoff * cutoff
+                && std::find(excludedAtoms.begin(), excludedAtoms.end(), j) == excludedAtoms.end())
+            {
+                pairs.emplace_back(i, j);
+            }
+        }
+    }
+
+    return pairs;
+}
+
+PairsWithinCutoffRange::PairsWithinCutoffRange(const BenchmarkSystem& system,
+                                               ArrayRef<const RVec>   x,
+                                               real                   cutoff) :
+    innerPairs_(pairsWithinCutoff(system, x, 0.99_real * cutoff)),
+    outerPairs_(pairsWithinCutoff(system, x, 1.01_real * cutoff))
+{
+}
+
+void PairsWithinCutoffRange::checkPairs(const std::vector<AtomPair>& pairs) const
+{
+    ASSERT_TRUE(std::is_sorted(pairs.begin(), pairs.end()));
+    EXPECT_TRUE(std::includes(pairs.begin(), pairs.end(), innerPairs_.begin(), innerPairs_.end()))
+            << "Pairs within the cut-off are missing";
+    EXPECT_TRUE(std::includes(outerPairs_.begin(), outerPairs_.end(), pairs.begin(), pairs.end()))
+            << "Pairs are duplicated or beyond the cut-off";
+    EXPECT_FALSE(pairs.empty());
+}
+
+} // namespace test
+} // namespace gmx
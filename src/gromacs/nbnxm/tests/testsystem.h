@@ -0,0 +1,140 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares helper functions for setting up pair searches in nbnxm tests
+ *
+ * \ingroup module_nbnxm
+ */
+#ifndef GMX_NBNXM_TESTS_TESTSYSTEM_H
+#define GMX_NBNXM_TESTS_TESTSYSTEM_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/real.h"
+
+struct nonbonded_verlet_t;
+
+namespace Nbnxm
+{
+enum class KernelType;
+} // namespace Nbnxm
+
+namespace gmx
+{
+struct BenchmarkSystem;
+
+namespace test
+{
+
+//! A pair of atom indices, the first index is the smallest
+using AtomPair = std::pair<int, int>;
+
+/*! \brief Returns a CPU non-bonded setup for \p system with a single thread
+ *
+ * \param[in] system          The system, only the topology is used
+ * \param[in] kernelType      The kernel type, sets the cluster sizes of the pairlist
+ * \param[in] pairlistCutoff  The cut-off for constructing the pairlist
+ */
+std::unique_ptr<nonbonded_verlet_t> makeNbnxmSetup(const BenchmarkSystem& system,
+                                                   Nbnxm::KernelType      kernelType,
+                                                   real                   pairlistCutoff);
+
+/*! \brief Puts the atoms on the grid and constructs the local pairlist
+ *
+ * \param[in,out] nbv     The non-bonded setup
+ * \param[in]     system  The system, only the topology and box are used
+ * \param[in]     x       The coordinates to use instead of those in \p system
+ */
+void searchPairs(nonbonded_verlet_t* nbv, const BenchmarkSystem& system, ArrayRef<const RVec> x);
+
+/*! \brief Returns the sorted atom pairs in the local CPU pairlist with distance below \p cutoff
+ *
+ * The distance is computed with the shift vector of the list entry. Pairs that occur
+ * multiple times in the list are returned multiple times.
+ *
+ * \param[in] nbv     The non-bonded setup with a constructed pairlist
+ * \param[in] box     The unit-cell
+ * \param[in] x       The coordinates that were put on the grid
+ * \param[in] cutoff  Only pairs within this distance are returned
+ */
+std::vector<AtomPair> pairsInPairlist(const nonbonded_verlet_t& nbv,
+                                      const matrix              box,
+                                      ArrayRef<const RVec>      x,
+                                      real                      cutoff);
+
+/*! \brief Returns the sorted non-excluded atom pairs within \p cutoff, using an all-pair search
+ *
+ * \param[in] system  The system, only the exclusions and box are used
+ * \param[in] x       The coordinates
+ * \param[in] cutoff  Only pairs within this distance are returned
+ */
+std::vector<AtomPair> pairsWithinCutoff(const BenchmarkSystem& system,
+                                        ArrayRef<const RVec>   x,
+                                        real                   cutoff);
+
+/*! \brief Checks that atom pairs match an all-pair search up to a cut-off
+ *
+ * Because the coordinates used for the pair search and for the all-pair search
+ * can differ by rounding, e.g. due to shifts by box vectors, pairs within
+ * a narrow range around the cut-off are allowed to be either present or not.
+ */
+class PairsWithinCutoffRange
+{
+public:
+    //! Generates the reference pairs for \p x with a range of one percent around \p cutoff
+    PairsWithinCutoffRange(const BenchmarkSystem& system, ArrayRef<const RVec> x, real cutoff);
+
+    /*! \brief Checks that \p pairs contains all pairs within the range and no other pairs
+     *
+     * \p pairs should be sorted, duplicates are reported as failures.
+     */
+    void checkPairs(const std::vector<AtomPair>& pairs) const;
+
+private:
+    //! The pairs within the lower end of the cut-off range
+    std::vector<AtomPair> innerPairs_;
+    //! The pairs within the upper end of the cut-off range
+    std::vector<AtomPair> outerPairs_;
+};
+
+} // namespace test
+} // namespace gmx
+
+#endif
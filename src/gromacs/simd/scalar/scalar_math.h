@@ -169,6 +169,20 @@ static inline float sqrt(float x)
     return std::sqrt(x);
 }
 
+/*! \brief Float cbrt(x). This is the cubic root.
+ *
+ * \param x Argument.
+ * \result The cubic root of x.
+ *
+ * \note This function might be superficially meaningless, but it helps us to
+ *       write templated SIMD/non-SIMD code. For clarity it should not be used
+ *       outside such code.
+ */
+static inline float cbrt(float x)
+{
+    return std::cbrt(x);
+}
+
 /*! \brief Float log(x). This is the natural logarithm.
  *
  * \param x Argument, should be >0.
@@ -557,6 +571,20 @@ static inline double sqrt(double x)
     return std::sqrt(x);
 }
 
+/*! \brief Double cbrt(x). This is the cubic root.
+ *
+ * \param x Argument.
+ * \result The cubic root of x.
+ *
+ * \note This function might be superficially meaningless, but it helps us to
+ *       write templated SIMD/non-SIMD code. For clarity it should not be used
+ *       outside such code.
+ */
+static inline double cbrt(double x)
+{
+    return std::cbrt(x);
+}
+
 /*! \brief Double log(x). This is the natural logarithm.
  *
  * \param x Argument, should be >0.
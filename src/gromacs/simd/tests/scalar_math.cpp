@@ -101,6 +101,13 @@ TEST(SimdScalarMathTest, maskzInvsqrt)
     EXPECT_EQ(real(0), maskzInvsqrt(x0, false));
 }
 
+TEST(SimdScalarMathTest, cbrt)
+{
+    real x0 = c0;
+
+    EXPECT_EQ(std::cbrt(x0), cbrt(x0));
+}
+
 TEST(SimdScalarMathTest, log)
 {
     real x0 = c0;
@@ -139,6 +139,7 @@ static const char* wcn[ewcNR] = { "Run",
                                   "COM pull force",
                                   "AWH",
                                   "Write traj.",
+                                  "Wait traj. I/O",
                                   "Update",
                                   "Constraints",
                                   "Comm. energies",
@@ -574,6 +575,8 @@ WallcycleCounts wallcycle_sum(const t_commrec* cr, gmx_wallcycle_t wc)
 
     subtract_cycles(wcc, ewcPME_FFT, ewcPME_FFTCOMM);
 
+    subtract_cycles(wcc, ewcTRAJ, ewcTRAJ_WAIT);
+
     if (cr->npmenodes == 0)
     {
         /* All nodes do PME (or no PME at all) */
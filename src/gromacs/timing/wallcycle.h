@@ -88,6 +88,7 @@ enum
     ewcPULLPOT,
     ewcAWH,
     ewcTRAJ,
+    ewcTRAJ_WAIT,
     ewcUPDATE,
     ewcCONSTR,
     ewcMoveE,
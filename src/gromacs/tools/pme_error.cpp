@@ -179,82 +179,8 @@ static real estimate_direct(t_inputinfo* info)
     return ONE_4PI_EPS0 * e_dir;
 }
 
-#define SUMORDER 6
-
-/* the following 4 functions determine polynomials required for the reciprocal error estimate */
-
-static inline real eps_poly1(real m, /* grid coordinate in certain direction */
-                             real K, /* grid size in corresponding direction */
-                             real n) /* spline interpolation order of the SPME */
-{
-    int  i;
-    real nom   = 0; /* nominator */
-    real denom = 0; /* denominator */
-    real tmp   = 0;
-
-    if (m == 0.0)
-    {
-        return 0.0;
-    }
-
-    for (i = -SUMORDER; i < 0; i++)
-    {
-        tmp = m / K + i;
-        tmp *= 2.0 * M_PI;
-        nom += std::pow(tmp, -n);
-    }
-
-    for (i = SUMORDER; i > 0; i--)
-    {
-        tmp = m / K + i;
-        tmp *= 2.0 * M_PI;
-        nom += std::pow(tmp, -n);
-    }
-
-    tmp = m / K;
-    tmp *= 2.0 * M_PI;
-    denom = std::pow(tmp, -n) + nom;
-
-    return -nom / denom;
-}
-
-static inline real eps_poly2(real m, /* grid coordinate in certain direction */
-                             real K, /* grid size in corresponding direction */
-                             real n) /* spline interpolation order of the SPME */
-{
-    int  i;
-    real nom   = 0; /* nominator */
-    real denom = 0; /* denominator */
-    real tmp   = 0;
-
-    if (m == 0.0)
-    {
-        return 0.0;
-    }
-
-    for (i = -SUMORDER; i < 0; i++)
-    {
-        tmp = m / K + i;
-        tmp *= 2.0 * M_PI;
-        nom += std::pow(tmp, -2 * n);
-    }
-
-    for (i = SUMORDER; i > 0; i--)
-    {
-        tmp = m / K + i;
-        tmp *= 2.0 * M_PI;
-        nom += std::pow(tmp, -2 * n);
-    }
-
-    for (i = -SUMORDER; i < SUMORDER + 1; i++)
-    {
-        tmp = m / K + i;
-        tmp *= 2.0 * M_PI;
-        denom += std::pow(tmp, -n);
-    }
-    tmp = eps_poly1(m, K, n);
-    return nom / denom / denom + tmp * tmp;
-}
+/* The following 2 functions, together with pmeErrorEstimatePoly1/2, determine polynomials
+ * required for the reciprocal error estimate */
 
 static inline real eps_poly3(real m, /* grid coordinate in certain direction */
                              real K, /* grid size in corresponding direction */
@@ -270,21 +196,21 @@ static inline real eps_poly3(real m, /* grid coordinate in certain direction */
         return 0.0;
     }
 
-    for (i = -SUMORDER; i < 0; i++)
+    for (i = -c_pmeErrorSumOrder; i < 0; i++)
     {
         tmp = m / K + i;
         tmp *= 2.0 * M_PI;
         nom += i * std::pow(tmp, -2 * n);
     }
 
-    for (i = SUMORDER; i > 0; i--)
+    for (i = c_pmeErrorSumOrder; i > 0; i--)
     {
         tmp = m / K + i;
         tmp *= 2.0 * M_PI;
         nom += i * std::pow(tmp, -2 * n);
     }
 
-    for (i = -SUMORDER; i < SUMORDER + 1; i++)
+    for (i = -c_pmeErrorSumOrder; i < c_pmeErrorSumOrder + 1; i++)
     {
         tmp = m / K + i;
         tmp *= 2.0 * M_PI;
@@ -308,21 +234,21 @@ static inline real eps_poly4(real m, /* grid coordinate in certain direction */
         return 0.0;
     }
 
-    for (i = -SUMORDER; i < 0; i++)
+    for (i = -c_pmeErrorSumOrder; i < 0; i++)
     {
         tmp = m / K + i;
         tmp *= 2.0 * M_PI;
         nom += i * i * std::pow(tmp, -2 * n);
     }
 
-    for (i = SUMORDER; i > 0; i--)
+    for (i = c_pmeErrorSumOrder; i > 0; i--)
     {
         tmp = m / K + i;
         tmp *= 2.0 * M_PI;
         nom += i * i * std::pow(tmp, -2 * n);
     }
 
-    for (i = -SUMORDER; i < SUMORDER + 1; i++)
+    for (i = -c_pmeErrorSumOrder; i < c_pmeErrorSumOrder + 1; i++)
     {
         tmp = m / K + i;
         tmp *= 2.0 * M_PI;
@@ -355,7 +281,7 @@ static inline real eps_self(real m,     /* grid coordinate in certain direction
     rcoord = iprod(rboxv, x);
 
 
-    for (i = -SUMORDER; i < 0; i++)
+    for (i = -c_pmeErrorSumOrder; i < 0; i++)
     {
         tmp  = -std::sin(2.0 * M_PI * i * K * rcoord);
         tmp1 = 2.0 * M_PI * m / K + 2.0 * M_PI * i;
@@ -364,7 +290,7 @@ static inline real eps_self(real m,     /* grid coordinate in certain direction
         denom += tmp2;
     }
 
-    for (i = SUMORDER; i > 0; i--)
+    for (i = c_pmeErrorSumOrder; i > 0; i--)
     {
         tmp  = -std::sin(2.0 * M_PI * i * K * rcoord);
         tmp1 = 2.0 * M_PI * m / K + 2.0 * M_PI * i;
@@ -381,7 +307,6 @@ static inline real eps_self(real m,     /* grid coordinate in certain direction
     return 2.0 * M_PI * nom / denom * K;
 }
 
-#undef SUMORDER
 
 /* The following routine is just a copy from pme.c */
 
@@ -529,28 +454,28 @@ static real estimate_reciprocal(t_inputinfo* info,
                 coeff2 = tmp;
 
 
-                tmp = eps_poly2(nx, info->nkx[0], info->pme_order[0]);
-                tmp += eps_poly2(ny, info->nkx[0], info->pme_order[0]);
-                tmp += eps_poly2(nz, info->nkx[0], info->pme_order[0]);
+                tmp = pmeErrorEstimatePoly2(nx, info->nkx[0], info->pme_order[0]);
+                tmp += pmeErrorEstimatePoly2(ny, info->nkx[0], info->pme_order[0]);
+                tmp += pmeErrorEstimatePoly2(nz, info->nkx[0], info->pme_order[0]);
 
-                tmp1 = eps_poly1(nx, info->nkx[0], info->pme_order[0]);
-                tmp2 = eps_poly1(ny, info->nky[0], info->pme_order[0]);
+                tmp1 = pmeErrorEstimatePoly1(nx, info->nkx[0], info->pme_order[0]);
+                tmp2 = pmeErrorEstimatePoly1(ny, info->nky[0], info->pme_order[0]);
 
                 tmp += 2.0 * tmp1 * tmp2;
 
-                tmp1 = eps_poly1(nz, info->nkz[0], info->pme_order[0]);
-                tmp2 = eps_poly1(ny, info->nky[0], info->pme_order[0]);
+                tmp1 = pmeErrorEstimatePoly1(nz, info->nkz[0], info->pme_order[0]);
+                tmp2 = pmeErrorEstimatePoly1(ny, info->nky[0], info->pme_order[0]);
 
                 tmp += 2.0 * tmp1 * tmp2;
 
-                tmp1 = eps_poly1(nz, info->nkz[0], info->pme_order[0]);
-                tmp2 = eps_poly1(nx, info->nkx[0], info->pme_order[0]);
+                tmp1 = pmeErrorEstimatePoly1(nz, info->nkz[0], info->pme_order[0]);
+                tmp2 = pmeErrorEstimatePoly1(nx, info->nkx[0], info->pme_order[0]);
 
                 tmp += 2.0 * tmp1 * tmp2;
 
-                tmp1 = eps_poly1(nx, info->nkx[0], info->pme_order[0]);
-                tmp1 += eps_poly1(ny, info->nky[0], info->pme_order[0]);
-                tmp1 += eps_poly1(nz, info->nkz[0], info->pme_order[0]);
+                tmp1 = pmeErrorEstimatePoly1(nx, info->nkx[0], info->pme_order[0]);
+                tmp1 += pmeErrorEstimatePoly1(ny, info->nky[0], info->pme_order[0]);
+                tmp1 += pmeErrorEstimatePoly1(nz, info->nkz[0], info->pme_order[0]);
 
                 tmp += tmp1 * tmp1;
 
@@ -69,8 +69,12 @@
 #include "gromacs/tools/trjconv.h"
 #include "gromacs/tools/tune_pme.h"
 
+#include "mdrun/bonded_bench.h"
+#include "mdrun/constraint_bench.h"
 #include "mdrun/mdrun_main.h"
 #include "mdrun/nonbonded_bench.h"
+#include "mdrun/pme_spread_bench.h"
+#include "mdrun/xtc_bench.h"
 #include "view/view.h"
 
 namespace
@@ -190,6 +194,22 @@ void registerLegacyModules(gmx::CommandLineModuleManager* manager)
             manager, gmx::NonbondedBenchmarkInfo::name,
             gmx::NonbondedBenchmarkInfo::shortDescription, &gmx::NonbondedBenchmarkInfo::create);
 
+    gmx::ICommandLineOptionsModule::registerModuleFactory(
+            manager, gmx::BondedBenchmarkInfo::name, gmx::BondedBenchmarkInfo::shortDescription,
+            &gmx::BondedBenchmarkInfo::create);
+
+    gmx::ICommandLineOptionsModule::registerModuleFactory(
+            manager, gmx::ConstraintBenchmarkInfo::name,
+            gmx::ConstraintBenchmarkInfo::shortDescription, &gmx::ConstraintBenchmarkInfo::create);
+
+    gmx::ICommandLineOptionsModule::registerModuleFactory(
+            manager, gmx::XtcBenchmarkInfo::name, gmx::XtcBenchmarkInfo::shortDescription,
+            &gmx::XtcBenchmarkInfo::create);
+
+    gmx::ICommandLineOptionsModule::registerModuleFactory(
+            manager, gmx::PmeSpreadBenchmarkInfo::name,
+            gmx::PmeSpreadBenchmarkInfo::shortDescription, &gmx::PmeSpreadBenchmarkInfo::create);
+
     gmx::ICommandLineOptionsModule::registerModuleFactory(manager, gmx::InsertMoleculesInfo::name(),
                                                           gmx::InsertMoleculesInfo::shortDescription(),
                                                           &gmx::InsertMoleculesInfo::create);
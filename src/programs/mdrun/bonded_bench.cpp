@@ -0,0 +1,536 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file contains the main function for the bonded kernel benchmark
+ *
+ * The benchmark times the listed-interaction kernels on a synthetic
+ * chain molecule, with one interaction of each type per atom, and reports
+ * the time per interaction for each interaction type and kernel flavor.
+ */
+
+#include "gmxpre.h"
+
+#include "bonded_bench.h"
+
+#include <chrono>
+#include <cmath>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/listed_forces/bonded.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The interaction types that are benchmarked
+const std::array<int, 12> c_benchmarkFtypes = { F_BONDS,         F_G96BONDS,     F_MORSE,
+                                                F_ANGLES,        F_G96ANGLES,    F_RESTRANGLES,
+                                                F_LINEAR_ANGLES, F_UREY_BRADLEY, F_PDIHS,
+                                                F_RBDIHS,        F_IDIHS,        F_CMAP };
+
+//! The number of different parameter sets used for each interaction type
+constexpr int c_numParameterTypes = 4;
+
+//! The CMAP grid spacing, as used by the CHARMM force fields
+constexpr int c_cmapGridSpacing = 24;
+
+//! The kernel flavors that are benchmarked, with the names we print
+const std::array<std::pair<BondedKernelFlavor, const char*>, 3> c_benchmarkFlavors = {
+    { { BondedKernelFlavor::ForcesSimdWhenAvailable, "simd" },
+      { BondedKernelFlavor::ForcesNoSimd, "nosimd" },
+      { BondedKernelFlavor::ForcesAndVirialAndEnergy, "energy" } }
+};
+
+//! Returns physically reasonable, unperturbed, parameters for \p ftype, varied by \p typeIndex
+t_iparams benchmarkParameters(const int ftype, const int typeIndex)
+{
+    // Vary the parameters slightly between the types
+    const real fac = 1 + 0.05 * typeIndex;
+
+    t_iparams iparams = { { 0 } };
+    switch (ftype)
+    {
+        case F_BONDS:
+        case F_G96BONDS:
+            iparams.harmonic.rA  = 0.15 * fac;
+            iparams.harmonic.krA = 3.0e5 * fac;
+            iparams.harmonic.rB  = iparams.harmonic.rA;
+            iparams.harmonic.krB = iparams.harmonic.krA;
+            break;
+        case F_MORSE:
+            iparams.morse.b0A   = 0.15 * fac;
+            iparams.morse.cbA   = 400 * fac;
+            iparams.morse.betaA = 20;
+            iparams.morse.b0B   = iparams.morse.b0A;
+            iparams.morse.cbB   = iparams.morse.cbA;
+            iparams.morse.betaB = iparams.morse.betaA;
+            break;
+        case F_ANGLES:
+        case F_G96ANGLES:
+            iparams.harmonic.rA  = 109.5 * fac;
+            iparams.harmonic.krA = 400 * fac;
+            iparams.harmonic.rB  = iparams.harmonic.rA;
+            iparams.harmonic.krB = iparams.harmonic.krA;
+            break;
+        case F_RESTRANGLES:
+            iparams.harmonic.rA  = 130 / fac;
+            iparams.harmonic.krA = 25 * fac;
+            iparams.harmonic.rB  = iparams.harmonic.rA;
+            iparams.harmonic.krB = iparams.harmonic.krA;
+            break;
+        case F_LINEAR_ANGLES:
+            iparams.linangle.klinA = 1000 * fac;
+            iparams.linangle.aA    = 0.5 / fac;
+            iparams.linangle.klinB = iparams.linangle.klinA;
+            iparams.linangle.aB    = iparams.linangle.aA;
+            break;
+        case F_UREY_BRADLEY:
+            iparams.u_b.thetaA  = 109.5 * fac;
+            iparams.u_b.kthetaA = 400 * fac;
+            iparams.u_b.r13A    = 0.25 * fac;
+            iparams.u_b.kUBA    = 2.0e4 * fac;
+            iparams.u_b.thetaB  = iparams.u_b.thetaA;
+            iparams.u_b.kthetaB = iparams.u_b.kthetaA;
+            iparams.u_b.r13B    = iparams.u_b.r13A;
+            iparams.u_b.kUBB    = iparams.u_b.kUBA;
+            break;
+        case F_PDIHS:
+            iparams.pdihs.phiA = 180 / fac;
+            iparams.pdihs.cpA  = 5 * fac;
+            iparams.pdihs.mult = 1 + typeIndex % 3;
+            iparams.pdihs.phiB = iparams.pdihs.phiA;
+            iparams.pdihs.cpB  = iparams.pdihs.cpA;
+            break;
+        case F_RBDIHS:
+        {
+            const std::array<real, NR_RBDIHS> rbc = { 9.28, 12.16, -13.12, -3.06, 26.24, -31.5 };
+            for (int i = 0; i < NR_RBDIHS; i++)
+            {
+                iparams.rbdihs.rbcA[i] = rbc[i] * fac;
+                iparams.rbdihs.rbcB[i] = iparams.rbdihs.rbcA[i];
+            }
+            break;
+        }
+        case F_IDIHS:
+            iparams.harmonic.rA  = 35 * typeIndex;
+            iparams.harmonic.krA = 200 * fac;
+            iparams.harmonic.rB  = iparams.harmonic.rA;
+            iparams.harmonic.krB = iparams.harmonic.krA;
+            break;
+        case F_CMAP:
+            iparams.cmap.cmapA = typeIndex;
+            iparams.cmap.cmapB = typeIndex;
+            break;
+        default: GMX_THROW(InternalError("Interaction type not supported by the benchmark"));
+    }
+
+    return iparams;
+}
+
+/*! \brief Returns CMAP grids with smooth, periodic data
+ *
+ * The data are not meant to be physically meaningful, only to give
+ * the same work and memory access pattern as real CMAP grids.
+ */
+gmx_cmap_t benchmarkCmapGrid()
+{
+    gmx_cmap_t cmapGrid;
+    cmapGrid.grid_spacing = c_cmapGridSpacing;
+    cmapGrid.cmapdata.resize(c_numParameterTypes);
+    const real dx = 2 * M_PI / c_cmapGridSpacing;
+    for (int t = 0; t < c_numParameterTypes; t++)
+    {
+        std::vector<real>& cmap = cmapGrid.cmapdata[t].cmap;
+        cmap.resize(4 * c_cmapGridSpacing * c_cmapGridSpacing);
+        for (int i = 0; i < c_cmapGridSpacing; i++)
+        {
+            for (int j = 0; j < c_cmapGridSpacing; j++)
+            {
+                const real phi = i * dx;
+                const real psi = j * dx + t;
+                const int  pos = 4 * (i * c_cmapGridSpacing + j);
+                cmap[pos + 0]  = 4 * std::cos(phi) * std::sin(psi);
+                cmap[pos + 1]  = -4 * std::sin(phi) * std::sin(psi);
+                cmap[pos + 2]  = 4 * std::cos(phi) * std::cos(psi);
+                cmap[pos + 3]  = -4 * std::sin(phi) * std::cos(psi);
+            }
+        }
+    }
+
+    return cmapGrid;
+}
+
+/*! \brief Generates the coordinates of a chain molecule in a periodic box
+ *
+ * The chain has fixed bond lengths and angles and random dihedral angles.
+ * The box has the atom density of liquid water. With \p putInBox, the chain
+ * is put in the box and thus folds back through the periodic boundaries.
+ */
+PaddedVector<RVec> generateChainCoordinates(const int            numAtoms,
+                                            const bool           putInBox,
+                                            matrix               box,
+                                            DefaultRandomEngine* rng)
+{
+    const real bondLength = 0.15;
+    const real bondAngle  = 111 * DEG2RAD;
+    // 100 atoms/nm^3, but the box should be large enough for the interactions
+    const real boxSize = std::max(std::cbrt(numAtoms / 100.0), 2.0);
+
+    UniformRealDistribution<real> dist(-M_PI, M_PI);
+
+    PaddedVector<RVec> x(numAtoms);
+    RVec               u = { 0, 1, 0 };
+    RVec               v = { 1, 0, 0 };
+    x[0]                 = { 0, 0, 0 };
+    for (int a = 1; a < numAtoms; a++)
+    {
+        // Construct the new bond w from the previous two bonds u and v
+        // using the bond angle and a random dihedral angle
+        const RVec vUnit = v.unitVector();
+        RVec       n1    = u - vUnit * u.dot(vUnit);
+        n1               = n1.unitVector();
+        const RVec n2    = cross(vUnit, n1);
+        const real phi   = dist(*rng);
+        const RVec w     = bondLength
+                       * (-std::cos(bondAngle) * vUnit
+                          + std::sin(bondAngle) * (std::cos(phi) * n1 + std::sin(phi) * n2));
+        x[a] = x[a - 1] + w;
+        u    = v;
+        v    = w;
+    }
+
+    clear_mat(box);
+    box[XX][XX] = boxSize;
+    box[YY][YY] = boxSize;
+    box[ZZ][ZZ] = boxSize;
+    if (putInBox)
+    {
+        put_atoms_in_box(PbcType::Xyz, box, x);
+    }
+
+    return x;
+}
+
+//! The timing result for one interaction type and kernel flavor
+struct BondedBenchResult
+{
+    //! The interaction type
+    int ftype;
+    //! The name of the kernel flavor
+    const char* flavorName;
+    //! The number of interactions
+    int numInteractions;
+    //! The number of timed iterations
+    int numIterations;
+    //! The total wall time in seconds
+    double seconds;
+
+    //! Returns the time per interaction in nanoseconds
+    double nsPerInteraction() const { return 1e9 * seconds / (numIterations * numInteractions); }
+};
+
+class BondedBenchmark : public ICommandLineOptionsModule
+{
+public:
+    BondedBenchmark() {}
+
+    // From ICommandLineOptionsModule
+    void init(CommandLineModuleSettings* /*settings*/) override {}
+    void initOptions(IOptionsContainer* options, ICommandLineOptionsModuleSettings* settings) override;
+    void optionsFinished() override;
+    int  run() override;
+
+private:
+    //! Times one interaction type with one kernel flavor
+    BondedBenchResult benchmarkKernel(int                           ftype,
+                                      BondedKernelFlavor            flavor,
+                                      const char*                   flavorName,
+                                      const std::vector<t_iatom>&   iatoms,
+                                      const std::vector<t_iparams>& iparams,
+                                      const rvec*                   x,
+                                      const t_pbc*                  pbc);
+
+    int                      numInteractions_     = 20000;
+    int                      numIterations_       = 100;
+    int                      numWarmupIterations_ = 10;
+    bool                     usePbc_              = true;
+    std::vector<std::string> typeNames_;
+    std::string              outputFileName_;
+
+    //! The selected interaction types
+    std::vector<int> ftypes_;
+    //! The CMAP grids
+    gmx_cmap_t cmapGrid_;
+    //! The force buffer
+    std::vector<real, AlignedAllocator<real>> forceBuffer_;
+};
+
+void BondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOptionsModuleSettings* settings)
+{
+    std::vector<const char*> desc = {
+        "[THISMODULE] runs benchmarks for the kernels that compute the",
+        "bonded, or listed, interactions. The interactions are set up for",
+        "a synthetic chain molecule with fixed bond lengths and angles",
+        "and random dihedral angles, at the atom density of liquid water",
+        "in a periodic box. For each interaction type there is one",
+        "interaction per atom and the interactions are ordered along",
+        "the chain, as they would be in a topology. Four different",
+        "parameter sets are used per type.[PAR]",
+        "Each kernel is called repeatedly for a number of iterations",
+        "set by [TT]-iter[tt], after [TT]-warmup[tt] untimed iterations.",
+        "The tool reports the wall time per interaction in nanoseconds",
+        "for each interaction type and for each kernel flavor:",
+        "[TT]simd[tt] computes only forces and uses SIMD for the types",
+        "that have a SIMD kernel, [TT]nosimd[tt] computes only forces",
+        "without SIMD and [TT]energy[tt] also computes the energy and",
+        "the virial. The [TT]simd[tt] flavor is what mdrun uses at steps",
+        "where energies and the virial are not needed. Note that CMAP",
+        "always computes energies and the virial, so only the",
+        "[TT]energy[tt] flavor is reported for CMAP.[PAR]",
+        "The interaction types can be selected with [TT]-type[tt], using",
+        "the names from the topology functions, e.g. BONDS, ANGLES, PDIHS",
+        "or CMAP. By default all supported types are run.",
+        "With [TT]-o[tt], the results are also written to file in CSV format."
+    };
+
+    settings->setHelpText(desc);
+
+    std::string typeList;
+    for (const int ftype : c_benchmarkFtypes)
+    {
+        typeList += std::string(typeList.empty() ? "" : ", ") + interaction_function[ftype].name;
+    }
+
+    options->addOption(IntegerOption("n").store(&numInteractions_).description(
+            "The number of interactions of each type"));
+    const std::string typeDescription =
+            formatString("Interaction types to run, by default all of: %s", typeList.c_str());
+    options->addOption(StringOption("type").storeVector(&typeNames_).multiValue().description(
+            typeDescription.c_str()));
+    options->addOption(
+            BooleanOption("pbc").store(&usePbc_).description("Use periodic boundary conditions"));
+    options->addOption(IntegerOption("iter").store(&numIterations_).description(
+            "The number of iterations for each kernel"));
+    options->addOption(IntegerOption("warmup")
+                               .store(&numWarmupIterations_)
+                               .description("The number of iterations for initial warmup"));
+    options->addOption(StringOption("o")
+                               .store(&outputFileName_)
+                               .description("Write the results also to this file, in CSV format"));
+}
+
+void BondedBenchmark::optionsFinished()
+{
+    if (numInteractions_ < 1 || numIterations_ < 1 || numWarmupIterations_ < 0)
+    {
+        GMX_THROW(InconsistentInputError(
+                "The number of interactions and iterations should be positive"));
+    }
+
+    ftypes_.clear();
+    if (typeNames_.empty())
+    {
+        ftypes_.assign(c_benchmarkFtypes.begin(), c_benchmarkFtypes.end());
+    }
+    for (const std::string& typeName : typeNames_)
+    {
+        bool found = false;
+        for (const int ftype : c_benchmarkFtypes)
+        {
+            if (gmx::equalCaseInsensitive(typeName, interaction_function[ftype].name))
+            {
+                ftypes_.push_back(ftype);
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            GMX_THROW(InvalidInputError(formatString(
+                    "Interaction type '%s' is not supported by the benchmark", typeName.c_str())));
+        }
+    }
+}
+
+BondedBenchResult BondedBenchmark::benchmarkKernel(int                           ftype,
+                                                   BondedKernelFlavor            flavor,
+                                                   const char*                   flavorName,
+                                                   const std::vector<t_iatom>&   iatoms,
+                                                   const std::vector<t_iparams>& iparams,
+                                                   const rvec*                   x,
+                                                   const t_pbc*                  pbc)
+{
+    rvec4* f = reinterpret_cast<rvec4*>(forceBuffer_.data());
+    rvec   fshift[SHIFTS];
+    real   dvdlambda = 0;
+
+    auto runKernel = [&]() {
+        if (ftype == F_CMAP)
+        {
+            cmap_dihs(iatoms.size(), iatoms.data(), iparams.data(), &cmapGrid_, x, f, fshift, pbc,
+                      0, &dvdlambda, nullptr, nullptr, nullptr);
+        }
+        else
+        {
+            calculateSimpleBond(ftype, iatoms.size(), iatoms.data(), iparams.data(), x, f, fshift,
+                                pbc, 0, &dvdlambda, nullptr, nullptr, nullptr, flavor);
+        }
+    };
+
+    std::fill(forceBuffer_.begin(), forceBuffer_.end(), 0);
+    clear_rvecs(SHIFTS, fshift);
+
+    for (int iter = 0; iter < numWarmupIterations_; iter++)
+    {
+        runKernel();
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < numIterations_; iter++)
+    {
+        runKernel();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    return { ftype, flavorName, numInteractions_, numIterations_, elapsed.count() };
+}
+
+int BondedBenchmark::run()
+{
+    // Leave room for the interaction with most atoms at the end of the chain
+    const int numAtoms = numInteractions_ + NRAL(F_CMAP) - 1;
+
+    DefaultRandomEngine rng(1993);
+    matrix              box;
+    PaddedVector<RVec>  x = generateChainCoordinates(numAtoms, usePbc_, box, &rng);
+    t_pbc               pbc;
+    set_pbc(&pbc, PbcType::Xyz, box);
+
+    cmapGrid_ = benchmarkCmapGrid();
+    forceBuffer_.resize(4 * numAtoms);
+
+    fprintf(stdout, "Running %d interactions per type, %d iterations, %s PBC\n", numInteractions_,
+            numIterations_, usePbc_ ? "with" : "without");
+    if (!GMX_SIMD_HAVE_REAL)
+    {
+        fprintf(stdout, "SIMD is not supported in this build, the simd flavor uses plain C\n");
+    }
+    fprintf(stdout, "\n%-16s %-8s %14s\n", "Type", "Flavor", "ns/interaction");
+
+    std::vector<BondedBenchResult> results;
+    for (const int ftype : ftypes_)
+    {
+        const int              nral = NRAL(ftype);
+        std::vector<t_iparams> iparams;
+        for (int t = 0; t < c_numParameterTypes; t++)
+        {
+            iparams.push_back(benchmarkParameters(ftype, t));
+        }
+        std::vector<t_iatom> iatoms;
+        for (int i = 0; i < numInteractions_; i++)
+        {
+            iatoms.push_back(i % c_numParameterTypes);
+            for (int a = 0; a < nral; a++)
+            {
+                iatoms.push_back(i + a);
+            }
+        }
+
+        for (const auto& flavor : c_benchmarkFlavors)
+        {
+            if (ftype == F_CMAP && flavor.first != BondedKernelFlavor::ForcesAndVirialAndEnergy)
+            {
+                continue;
+            }
+
+            results.push_back(benchmarkKernel(ftype, flavor.first, flavor.second, iatoms, iparams,
+                                              as_rvec_array(x.data()), usePbc_ ? &pbc : nullptr));
+            fprintf(stdout, "%-16s %-8s %14.3f\n", interaction_function[ftype].name, flavor.second,
+                    results.back().nsPerInteraction());
+        }
+    }
+
+    if (!outputFileName_.empty())
+    {
+        TextWriter writer(outputFileName_);
+        writer.writeLine("type,flavor,interactions,iterations,seconds,ns_per_interaction");
+        for (const BondedBenchResult& result : results)
+        {
+            writer.writeLine(formatString("%s,%s,%d,%d,%g,%g",
+                                          interaction_function[result.ftype].name, result.flavorName,
+                                          result.numInteractions, result.numIterations,
+                                          result.seconds, result.nsPerInteraction()));
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+const char BondedBenchmarkInfo::name[] = "bonded-benchmark";
+const char BondedBenchmarkInfo::shortDescription[] =
+        "Benchmarking tool for the bonded interaction kernels.";
+
+ICommandLineOptionsModulePointer BondedBenchmarkInfo::create()
+{
+    return ICommandLineOptionsModulePointer(std::make_unique<BondedBenchmark>());
+}
+
+} // namespace gmx
@@ -0,0 +1,651 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file contains the main function for the constraint benchmark
+ *
+ * The benchmark times the constraint algorithms on a synthetic system
+ * of branched chain molecules with all bonds constrained, for different
+ * numbers of OpenMP threads.
+ */
+
+#include "gmxpre.h"
+
+#include "constraint_bench.h"
+
+#include "config.h"
+
+#include <chrono>
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdlib/constr.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/lincs.h"
+#include "gromacs/mdlib/shake.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/utility/enumerationhelpers.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/listoflists.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The constraint algorithms that can be benchmarked
+enum class ConstraintAlgorithm : int
+{
+    Lincs,
+    Shake,
+    Count
+};
+
+//! Strings corresponding to ConstraintAlgorithm, used for the option values and the output
+const EnumerationArray<ConstraintAlgorithm, const char*> c_constraintAlgorithmNames = {
+    { "LINCS", "SHAKE" }
+};
+
+//! The mass of the heavy atoms in the chains
+constexpr real c_heavyAtomMass = 12.011;
+//! The mass of the hydrogen atoms in the chains
+constexpr real c_hydrogenMass = 1.008;
+
+/*! \brief A synthetic system of chain molecules with constraints
+ *
+ * Each molecule is a chain of heavy atoms, each with one hydrogen,
+ * with all bonds constrained. With triangles, a constraint between
+ * each hydrogen and the next heavy atom is added, which gives
+ * a network of coupled constraint triangles.
+ */
+struct ConstraintSystem
+{
+    //! The topology, used for the setup of the constraint algorithms
+    gmx_mtop_t mtop;
+    //! The local interaction definitions, all molecules are global
+    std::unique_ptr<InteractionDefinitions> idef;
+    //! The inverse masses
+    std::vector<real> invmass;
+    //! The constrained reference coordinates
+    PaddedVector<RVec> x;
+    //! The unconstrained coordinates, as after an update
+    PaddedVector<RVec> xprime;
+    //! The box
+    matrix box;
+    //! The number of constraints
+    int numConstraints;
+};
+
+/*! \brief Generates the chain molecules, randomly placed in a periodic box
+ *
+ * The box has the atom density of liquid water. The heavy atom chains
+ * have fixed bond lengths and angles and random dihedral angles.
+ * The unconstrained coordinates are generated by random displacements
+ * of the atoms, which are of the order of the displacements in a time step.
+ * The result is stored in \p systemPtr.
+ */
+void generateConstraintSystem(const int         numMolecules,
+                              const int         chainLength,
+                              const bool        useTriangles,
+                              ConstraintSystem* systemPtr)
+{
+    ConstraintSystem& system = *systemPtr;
+
+    const int  numAtomsPerMolecule = 2 * chainLength;
+    const int  numAtoms            = numMolecules * numAtomsPerMolecule;
+    const real bondLength          = 0.153;
+    const real hydrogenBondLength  = 0.109;
+    const real bondAngle           = 111 * DEG2RAD;
+    const real boxSize             = std::cbrt(numAtoms / 100.0);
+    const real maxDisplacement     = 0.004;
+
+    DefaultRandomEngine           rng(1993);
+    UniformRealDistribution<real> uniformDist(0, 1);
+
+    clear_mat(system.box);
+    for (int d = 0; d < DIM; d++)
+    {
+        system.box[d][d] = boxSize;
+    }
+
+    /* Generate the atoms of each molecule in the order heavy atom,
+     * hydrogen, heavy atom, hydrogen, ...
+     */
+    system.x.resizeWithPadding(numAtoms);
+    system.invmass.resize(numAtoms);
+    for (int m = 0; m < numMolecules; m++)
+    {
+        RVec* xMol = system.x.data() + m * numAtomsPerMolecule;
+
+        RVec u = { 0, 1, 0 };
+        RVec v = { 1, 0, 0 };
+        xMol[0] = { uniformDist(rng) * boxSize, uniformDist(rng) * boxSize,
+                    uniformDist(rng) * boxSize };
+        for (int i = 1; i < chainLength; i++)
+        {
+            // Construct the new bond w from the previous two bonds u and v
+            // using the bond angle and a random dihedral angle
+            const RVec vUnit = v.unitVector();
+            RVec       n1    = u - vUnit * u.dot(vUnit);
+            n1               = n1.unitVector();
+            const RVec n2    = cross(vUnit, n1);
+            const real phi   = 2 * M_PI * uniformDist(rng);
+            const RVec w     = bondLength
+                           * (-std::cos(bondAngle) * vUnit
+                              + std::sin(bondAngle) * (std::cos(phi) * n1 + std::sin(phi) * n2));
+            xMol[2 * i] = xMol[2 * (i - 1)] + w;
+            u           = v;
+            v           = w;
+        }
+        for (int i = 0; i < chainLength; i++)
+        {
+            // Put the hydrogen along the bisector, pointing outwards.
+            // At the chain ends, tilt it away from the bond, so the
+            // constraint triangles are not degenerate.
+            RVec dir = { 0, 0, 1 };
+            if (chainLength > 1)
+            {
+                const RVec prev = xMol[2 * std::max(i - 1, 0)];
+                const RVec next = xMol[2 * std::min(i + 1, chainLength - 1)];
+                dir             = xMol[2 * i] + xMol[2 * i] - prev - next;
+                if (i == 0 || i == chainLength - 1)
+                {
+                    RVec perpendicular = cross(dir, RVec({ 0, 0, 1 }));
+                    if (perpendicular.norm2() == 0)
+                    {
+                        perpendicular = cross(dir, RVec({ 0, 1, 0 }));
+                    }
+                    dir = dir.unitVector() + perpendicular.unitVector();
+                }
+                else if (dir.norm2() == 0)
+                {
+                    dir = cross(next - prev, RVec({ 0, 0, 1 }));
+                }
+            }
+            xMol[2 * i + 1] = xMol[2 * i] + hydrogenBondLength * dir.unitVector();
+
+            system.invmass[m * numAtomsPerMolecule + 2 * i]     = 1 / c_heavyAtomMass;
+            system.invmass[m * numAtomsPerMolecule + 2 * i + 1] = 1 / c_hydrogenMass;
+        }
+    }
+
+    /* Generate the constraints of the first molecule. All molecules have
+     * the same constraint lengths, as we use the geometry of the first.
+     */
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < chainLength; i++)
+    {
+        pairs.emplace_back(2 * i, 2 * i + 1);
+        if (i + 1 < chainLength)
+        {
+            pairs.emplace_back(2 * i, 2 * i + 2);
+            if (useTriangles)
+            {
+                pairs.emplace_back(2 * i + 1, 2 * i + 2);
+            }
+        }
+    }
+
+    gmx_moltype_t molType;
+    molType.atoms.nr = numAtomsPerMolecule;
+    for (size_t c = 0; c < pairs.size(); c++)
+    {
+        const real length =
+                std::sqrt(distance2(system.x[pairs[c].first], system.x[pairs[c].second]));
+
+        t_iparams iparams = { { 0 } };
+        iparams.constr.dA = length;
+        iparams.constr.dB = length;
+        system.mtop.ffparams.iparams.push_back(iparams);
+        system.mtop.ffparams.functype.push_back(F_CONSTR);
+
+        molType.ilist[F_CONSTR].push_back(c, std::array<int, 2>{ pairs[c].first, pairs[c].second });
+    }
+    system.mtop.moltype.push_back(molType);
+
+    gmx_molblock_t molBlock;
+    molBlock.type = 0;
+    molBlock.nmol = numMolecules;
+    system.mtop.molblock.push_back(molBlock);
+    system.mtop.natoms = numAtoms;
+    system.mtop.finalize();
+
+    system.idef = std::make_unique<InteractionDefinitions>(system.mtop.ffparams);
+    for (int m = 0; m < numMolecules; m++)
+    {
+        for (size_t c = 0; c < pairs.size(); c++)
+        {
+            system.idef->il[F_CONSTR].push_back(
+                    c, std::array<int, 2>{ m * numAtomsPerMolecule + pairs[c].first,
+                                           m * numAtomsPerMolecule + pairs[c].second });
+        }
+    }
+    system.numConstraints = numMolecules * pairs.size();
+
+    system.xprime.resizeWithPadding(numAtoms);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            system.xprime[a][d] = system.x[a][d] + (2 * uniformDist(rng) - 1) * maxDisplacement;
+        }
+    }
+}
+
+//! The timing result for one number of threads
+struct ConstraintBenchResult
+{
+    //! The number of OpenMP threads
+    int numThreads;
+    //! The number of constraints
+    int numConstraints;
+    //! The number of timed iterations
+    int numIterations;
+    //! The total wall time in seconds
+    double seconds;
+    //! The maximum coordinate difference with the result of the first thread count
+    real maxDifference;
+
+    //! Returns the time per call in microseconds
+    double usPerCall() const { return 1e6 * seconds / numIterations; }
+};
+
+/*! \brief Returns the maximum difference of \p x with \p *xReference
+ *
+ * When \p xReference is empty, \p x is stored there and 0 is returned.
+ */
+real maxDifferenceWithReference(const PaddedVector<RVec>& x, PaddedVector<RVec>* xReference)
+{
+    real maxDifference = 0;
+    if (xReference->empty())
+    {
+        *xReference = x;
+    }
+    else
+    {
+        for (index a = 0; a < x.size(); a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                maxDifference = std::max(maxDifference, std::abs(x[a][d] - (*xReference)[a][d]));
+            }
+        }
+    }
+
+    return maxDifference;
+}
+
+class ConstraintBenchmark : public ICommandLineOptionsModule
+{
+public:
+    ConstraintBenchmark() {}
+
+    // From ICommandLineOptionsModule
+    void init(CommandLineModuleSettings* /*settings*/) override {}
+    void initOptions(IOptionsContainer*                 options,
+                     ICommandLineOptionsModuleSettings* settings) override;
+    void optionsFinished() override;
+    int  run() override;
+
+private:
+    /*! \brief Times LINCS with \p numThreads threads
+     *
+     * Returns the timings and the constrained coordinates in \p xResult.
+     */
+    ConstraintBenchResult benchmarkLincs(const ConstraintSystem& system,
+                                         int                     numThreads,
+                                         PaddedVector<RVec>*     xResult);
+    /*! \brief Times SHAKE with \p numThreads threads
+     *
+     * Returns the timings and the constrained coordinates in \p xResult.
+     */
+    ConstraintBenchResult benchmarkShake(const ConstraintSystem& system,
+                                         int                     numThreads,
+                                         PaddedVector<RVec>*     xResult);
+
+    ConstraintAlgorithm algorithm_ = ConstraintAlgorithm::Lincs;
+
+    int              numAtoms_            = 100000;
+    int              chainLength_         = 50;
+    bool             useTriangles_        = false;
+    bool             usePbc_              = false;
+    std::vector<int> numThreads_          = {};
+    int              lincsOrder_          = 4;
+    int              lincsIter_           = 1;
+    real             shakeTolerance_      = 0.0001;
+    int              numIterations_       = 100;
+    int              numWarmupIterations_ = 10;
+    std::string      outputFileName_;
+};
+
+void ConstraintBenchmark::initOptions(IOptionsContainer*                 options,
+                                      ICommandLineOptionsModuleSettings* settings)
+{
+    std::vector<const char*> desc = {
+        "[THISMODULE] runs benchmarks for the constraint algorithms on a",
+        "synthetic system of chain molecules with all bonds constrained,",
+        "as with [TT]constraints = all-bonds[tt] for a protein or lipids.",
+        "Each molecule is a chain of [TT]-len[tt] heavy atoms, with fixed bond",
+        "lengths and angles and random dihedral angles, with one hydrogen",
+        "on each heavy atom. The molecules are placed randomly in a box at",
+        "the atom density of liquid water. With [TT]-triangles[tt], each",
+        "hydrogen is also constrained to the next heavy atom, which gives",
+        "coupled constraint triangles as with angle constraints.[PAR]",
+        "The coordinates to constrain are generated with random displacements",
+        "of the order of those in an MD step. The constraint algorithm, LINCS",
+        "or SHAKE, is selected with [TT]-alg[tt]. It is",
+        "run [TT]-iter[tt] times, after [TT]-warmup[tt] untimed calls,",
+        "on the same input, for each number of OpenMP threads given with",
+        "[TT]-nt[tt]. The tool reports the wall time per call and per",
+        "constraint and the maximum coordinate difference with the result",
+        "for the first thread count, which should be at the level of the",
+        "floating point precision.",
+        "With [TT]-o[tt], the results are also written to file in CSV format."
+    };
+
+    settings->setHelpText(desc);
+
+    options->addOption(EnumOption<ConstraintAlgorithm>("alg")
+                               .store(&algorithm_)
+                               .enumValue(c_constraintAlgorithmNames)
+                               .description("The constraint algorithm"));
+    options->addOption(IntegerOption("n").store(&numAtoms_).description(
+            "The approximate number of atoms, rounded to whole molecules"));
+    options->addOption(IntegerOption("len").store(&chainLength_).description(
+            "The number of heavy atoms per chain molecule"));
+    options->addOption(BooleanOption("triangles")
+                               .store(&useTriangles_)
+                               .description("Add constraints that form triangles"));
+    options->addOption(BooleanOption("pbc").store(&usePbc_).description(
+            "Use periodic boundary conditions for the distances"));
+    options->addOption(IntegerOption("nt").storeVector(&numThreads_).multiValue().description(
+            "The numbers of OpenMP threads to run with, by default 1 and the maximum"));
+    options->addOption(IntegerOption("lincs-order")
+                               .store(&lincsOrder_)
+                               .description("The LINCS matrix expansion order"));
+    options->addOption(IntegerOption("lincs-iter")
+                               .store(&lincsIter_)
+                               .description("The number of LINCS iterations"));
+    options->addOption(RealOption("shake-tol")
+                               .store(&shakeTolerance_)
+                               .description("The relative SHAKE tolerance"));
+    options->addOption(IntegerOption("iter").store(&numIterations_).description(
+            "The number of timed calls for each thread count"));
+    options->addOption(IntegerOption("warmup")
+                               .store(&numWarmupIterations_)
+                               .description("The number of calls for initial warmup"));
+    options->addOption(StringOption("o")
+                               .store(&outputFileName_)
+                               .description("Write the results also to this file, in CSV format"));
+}
+
+void ConstraintBenchmark::optionsFinished()
+{
+    if (numAtoms_ < 1 || chainLength_ < 1 || numIterations_ < 1 || numWarmupIterations_ < 0)
+    {
+        GMX_THROW(InconsistentInputError(
+                "The number of atoms, the chain length and the iterations should be positive"));
+    }
+    if (lincsOrder_ < 1 || lincsIter_ < 1)
+    {
+        GMX_THROW(InconsistentInputError(
+                "The LINCS expansion order and number of iterations should be positive"));
+    }
+    if (shakeTolerance_ <= 0)
+    {
+        GMX_THROW(InconsistentInputError("The SHAKE tolerance should be positive"));
+    }
+    if (numThreads_.empty())
+    {
+        numThreads_.push_back(1);
+        if (gmx_omp_get_max_threads() > 1)
+        {
+            numThreads_.push_back(gmx_omp_get_max_threads());
+        }
+    }
+    for (const int numThreads : numThreads_)
+    {
+        if (numThreads < 1 || numThreads > GMX_OPENMP_MAX_THREADS)
+        {
+            GMX_THROW(InconsistentInputError(formatString(
+                    "The number of threads should be between 1 and %d", GMX_OPENMP_MAX_THREADS)));
+        }
+    }
+}
+
+ConstraintBenchResult ConstraintBenchmark::benchmarkLincs(const ConstraintSystem& system,
+                                                          const int               numThreads,
+                                                          PaddedVector<RVec>*     xResult)
+{
+    t_inputrec ir;
+    ir.eI             = eiMD;
+    ir.efep           = efepNO;
+    ir.nLincsIter     = lincsIter_;
+    ir.nProjOrder     = lincsOrder_;
+    ir.LincsWarnAngle = 30;
+
+    t_commrec cr;
+    cr.nnodes = 1;
+    cr.dd     = nullptr;
+
+    t_pbc pbc;
+    set_pbc(&pbc, PbcType::Xyz, system.box);
+
+    std::vector<ListOfLists<int>> at2conPerMolType;
+    for (const gmx_moltype_t& molType : system.mtop.moltype)
+    {
+        at2conPerMolType.push_back(make_at2con(molType, system.mtop.ffparams.iparams,
+                                               FlexibleConstraintTreatment::Include));
+    }
+
+    gmx_omp_nthreads_set(emntLINCS, numThreads);
+    Lincs* lincsd = init_lincs(nullptr, system.mtop, 0, at2conPerMolType, false, ir.nLincsIter,
+                               ir.nProjOrder);
+    set_lincs(*system.idef, system.mtop.natoms, system.invmass.data(), 0, true, &cr, lincsd);
+
+    t_nrnb             nrnb;
+    PaddedVector<RVec> xprime = system.xprime;
+    tensor             vir    = { { 0 } };
+    real               dvdlambda;
+    int                warnCount = 0;
+    double             seconds   = 0;
+    for (int iter = 0; iter < numWarmupIterations_ + numIterations_; iter++)
+    {
+        std::copy(system.xprime.begin(), system.xprime.end(), xprime.begin());
+
+        const auto startTime = std::chrono::steady_clock::now();
+        const bool success   = constrain_lincs(
+                false, ir, iter, lincsd, system.invmass.data(), &cr, nullptr,
+                system.x.constArrayRefWithPadding(), xprime.arrayRefWithPadding(), {}, system.box,
+                usePbc_ ? &pbc : nullptr, false, 0, &dvdlambda, 0, {}, false, vir,
+                ConstraintVariable::Positions, &nrnb, 0, &warnCount);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (iter >= numWarmupIterations_)
+        {
+            seconds += elapsed.count();
+        }
+        if (!success)
+        {
+            GMX_THROW(InternalError("LINCS failed on the benchmark system"));
+        }
+    }
+    done_lincs(lincsd);
+
+    return { numThreads, system.numConstraints, numIterations_, seconds,
+             maxDifferenceWithReference(xprime, xResult) };
+}
+
+ConstraintBenchResult ConstraintBenchmark::benchmarkShake(const ConstraintSystem& system,
+                                                          const int               numThreads,
+                                                          PaddedVector<RVec>*     xResult)
+{
+    t_inputrec ir;
+    ir.eI        = eiMD;
+    ir.efep      = efepNO;
+    ir.shake_tol = shakeTolerance_;
+
+    t_pbc pbc;
+    set_pbc(&pbc, PbcType::Xyz, system.box);
+
+    gmx_omp_nthreads_set(emntLINCS, numThreads);
+    shakedata shaked;
+    make_shake_sblock_serial(&shaked, system.idef.get(), system.mtop.natoms);
+
+    t_nrnb             nrnb;
+    PaddedVector<RVec> xprime = system.xprime;
+    tensor             vir    = { { 0 } };
+    real               dvdlambda;
+    double             seconds = 0;
+    for (int iter = 0; iter < numWarmupIterations_ + numIterations_; iter++)
+    {
+        std::copy(system.xprime.begin(), system.xprime.end(), xprime.begin());
+
+        const auto startTime = std::chrono::steady_clock::now();
+        const bool success   = constrain_shake(
+                nullptr, &shaked, system.invmass.data(), *system.idef, ir,
+                system.x.constArrayRefWithPadding().unpaddedConstArrayRef(),
+                xprime.arrayRefWithPadding().unpaddedArrayRef(), {}, usePbc_ ? &pbc : nullptr,
+                &nrnb, 0, &dvdlambda, 0, {}, false, vir, false, ConstraintVariable::Positions);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (iter >= numWarmupIterations_)
+        {
+            seconds += elapsed.count();
+        }
+        if (!success)
+        {
+            GMX_THROW(InternalError("SHAKE failed on the benchmark system"));
+        }
+    }
+
+    return { numThreads, system.numConstraints, numIterations_, seconds,
+             maxDifferenceWithReference(xprime, xResult) };
+}
+
+int ConstraintBenchmark::run()
+{
+    const int numMolecules = std::max(numAtoms_ / (2 * chainLength_), 1);
+
+    ConstraintSystem system;
+    generateConstraintSystem(numMolecules, chainLength_, useTriangles_, &system);
+
+    const char* algorithmName = c_constraintAlgorithmNames[algorithm_];
+    fprintf(stdout, "Running %s on %d molecules with %d atoms and %d constraints in total\n",
+            algorithmName, numMolecules, system.mtop.natoms, system.numConstraints);
+    if (algorithm_ == ConstraintAlgorithm::Lincs)
+    {
+        fprintf(stdout, "Expansion order %d, %d iteration%s, %s PBC, %d calls\n", lincsOrder_,
+                lincsIter_, lincsIter_ == 1 ? "" : "s", usePbc_ ? "with" : "without",
+                numIterations_);
+    }
+    else
+    {
+        fprintf(stdout, "Relative tolerance %g, %s PBC, %d calls\n", shakeTolerance_,
+                usePbc_ ? "with" : "without", numIterations_);
+    }
+    fprintf(stdout, "\n%8s %12s %14s %10s %14s\n", "Threads", "us/call", "ns/constraint",
+            "Speedup", "Max diff (nm)");
+
+    std::vector<ConstraintBenchResult> results;
+    PaddedVector<RVec>                 xReference;
+    for (const int numThreads : numThreads_)
+    {
+        if (algorithm_ == ConstraintAlgorithm::Lincs)
+        {
+            results.push_back(benchmarkLincs(system, numThreads, &xReference));
+        }
+        else
+        {
+            results.push_back(benchmarkShake(system, numThreads, &xReference));
+        }
+
+        const ConstraintBenchResult& result = results.back();
+        fprintf(stdout, "%8d %12.2f %14.3f %10.2f %14.2e\n", numThreads, result.usPerCall(),
+                1e3 * result.usPerCall() / result.numConstraints,
+                results.front().seconds / result.seconds, result.maxDifference);
+    }
+
+    if (!outputFileName_.empty())
+    {
+        TextWriter writer(outputFileName_);
+        writer.writeLine("algorithm,threads,constraints,iterations,seconds,us_per_call,max_diff");
+        for (const ConstraintBenchResult& result : results)
+        {
+            writer.writeLine(formatString("%s,%d,%d,%d,%g,%g,%g", algorithmName,
+                                          result.numThreads, result.numConstraints,
+                                          result.numIterations, result.seconds,
+                                          result.usPerCall(), result.maxDifference));
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+const char ConstraintBenchmarkInfo::name[] = "constraint-benchmark";
+const char ConstraintBenchmarkInfo::shortDescription[] =
+        "Benchmarking tool for the constraint algorithms.";
+
+ICommandLineOptionsModulePointer ConstraintBenchmarkInfo::create()
+{
+    return ICommandLineOptionsModulePointer(std::make_unique<ConstraintBenchmark>());
+}
+
+} // namespace gmx
@@ -43,6 +43,7 @@
 
 #include "nonbonded_bench.h"
 
+#include <string>
 #include <vector>
 
 #include "gromacs/commandline/cmdlineoptionsmodule.h"
@@ -54,6 +55,7 @@
 #include "gromacs/selection/selectionoptionbehavior.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/enumerationhelpers.h"
+#include "gromacs/utility/exceptions.h"
 
 namespace gmx
 {
@@ -74,8 +76,11 @@ public:
     int  run() override;
 
 private:
-    int                       sizeFactor_ = 1;
-    Nbnxm::KernelBenchOptions benchmarkOptions_;
+    std::vector<int>             sizeFactors_ = { 1 };
+    std::vector<real>            cutoffs_     = { 1.0 };
+    Nbnxm::KernelBenchOptions    benchmarkOptions_;
+    std::string                  outputFileName_;
+    Nbnxm::BenchMarkOutputFormat outputFormat_ = Nbnxm::BenchMarkOutputFormat::Csv;
 };
 
 void NonbondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOptionsModuleSettings* settings)
@@ -152,7 +157,24 @@ void NonbondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOpt
         "In the MD engine, any clusters where at most half of the atoms",
         "have LJ interactions will automatically use this kernel.",
         "And finally, the [TT]-energy[tt] option selects the computation",
-        "of energies, which are usually only needed infrequently."
+        "of energies, which are usually only needed infrequently.[PAR]",
+        "For tracking kernel performance across hardware and releases,",
+        "a suite of benchmarks can be run with a single invocation.",
+        "Multiple values can be passed to [TT]-size[tt] and [TT]-cutoff[tt],",
+        "in which case all combinations of system size and cut-off are run.",
+        "The [TT]-allflavors[tt] option additionally runs each kernel with",
+        "and without energy computation and, for SIMD kernels with Ewald,",
+        "with both tabulated and analytical Ewald correction. Together with",
+        "[TT]-all[tt] this covers all kernel flavors available in the build.",
+        "With [TT]-o[tt], the results are also written to file in the",
+        "format selected with [TT]-format[tt], either CSV or JSON.",
+        "Apart from the settings and timings, the file contains the total and",
+        "useful pair interactions per second, the cycles per cluster pair",
+        "and the pairlist efficiency, which is the fraction of the atom pairs",
+        "in the cluster pair list that are within the cut-off distance.[PAR]",
+        "With [TT]-search[tt], the pair search, i.e. putting the atoms on",
+        "the grid and constructing the pairlist, is also timed for the same",
+        "number of iterations and reported in Mcycles per iteration."
     };
 
     settings->setHelpText(desc);
@@ -166,9 +188,12 @@ void NonbondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOpt
     static const EnumerationArray<Nbnxm::BenchMarkCoulomb, const char*> c_coulombTypeStrings = {
         { "ewald", "reaction-field" }
     };
+    static const EnumerationArray<Nbnxm::BenchMarkOutputFormat, const char*> c_outputFormatStrings = {
+        { "csv", "json" }
+    };
 
-    options->addOption(
-            IntegerOption("size").store(&sizeFactor_).description("The system size is 3000 atoms times this value"));
+    options->addOption(IntegerOption("size").storeVector(&sizeFactors_).multiValue().description(
+            "The system size is 3000 atoms times this value, multiple values run a sweep"));
     options->addOption(
             IntegerOption("nt").store(&benchmarkOptions_.numThreads).description("The number of OpenMP threads to use"));
     options->addOption(EnumOption<Nbnxm::BenchMarkKernels>("simd")
@@ -196,9 +221,13 @@ void NonbondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOpt
                                .description("Compute energies in addition to forces"));
     options->addOption(
             BooleanOption("all").store(&benchmarkOptions_.doAll).description("Run all 12 combinations of options for coulomb, halflj, combrule"));
-    options->addOption(RealOption("cutoff")
-                               .store(&benchmarkOptions_.pairlistCutoff)
-                               .description("Pair-list and interaction cut-off distance"));
+    options->addOption(
+            BooleanOption("allflavors")
+                    .store(&benchmarkOptions_.doAllFlavors)
+                    .description("Run each kernel with and without energies and, with Ewald, "
+                                 "with tabulated and analytical correction"));
+    options->addOption(RealOption("cutoff").storeVector(&cutoffs_).multiValue().description(
+            "Pair-list and interaction cut-off distance, multiple values run a sweep"));
     options->addOption(IntegerOption("iter")
                                .store(&benchmarkOptions_.numIterations)
                                .description("The number of iterations for each kernel"));
@@ -208,18 +237,53 @@ void NonbondedBenchmark::initOptions(IOptionsContainer* options, ICommandLineOpt
     options->addOption(BooleanOption("cycles")
                                .store(&benchmarkOptions_.cyclesPerPair)
                                .description("Report cycles/pair instead of pairs/cycle"));
+    options->addOption(BooleanOption("search")
+                               .store(&benchmarkOptions_.benchmarkPairSearch)
+                               .description("Also time the pair search"));
+    options->addOption(StringOption("o")
+                               .store(&outputFileName_)
+                               .description("Write the results also to this file"));
+    options->addOption(EnumOption<Nbnxm::BenchMarkOutputFormat>("format")
+                               .store(&outputFormat_)
+                               .enumValue(c_outputFormatStrings)
+                               .description("The format of the output file"));
 }
 
 void NonbondedBenchmark::optionsFinished()
 {
-    // We compute the Ewald coefficient here to avoid a dependency of the Nbnxm on the Ewald module
-    const real ewald_rtol          = 1e-5;
-    benchmarkOptions_.ewaldcoeff_q = calc_ewaldcoeff_q(benchmarkOptions_.pairlistCutoff, ewald_rtol);
+    if (sizeFactors_.empty() || cutoffs_.empty())
+    {
+        GMX_THROW(InconsistentInputError("At least one size and one cut-off value are required"));
+    }
 }
 
 int NonbondedBenchmark::run()
 {
-    Nbnxm::bench(sizeFactor_, benchmarkOptions_);
+    std::vector<Nbnxm::KernelBenchResult> results;
+
+    for (const int sizeFactor : sizeFactors_)
+    {
+        for (const real cutoff : cutoffs_)
+        {
+            Nbnxm::KernelBenchOptions options = benchmarkOptions_;
+            options.pairlistCutoff            = cutoff;
+            // We compute the Ewald coefficient here to avoid a dependency of the Nbnxm on the Ewald module
+            const real ewald_rtol = 1e-5;
+            options.ewaldcoeff_q  = calc_ewaldcoeff_q(options.pairlistCutoff, ewald_rtol);
+
+            if (!results.empty())
+            {
+                fprintf(stdout, "\n");
+            }
+            const auto instanceResults = Nbnxm::bench(sizeFactor, options);
+            results.insert(results.end(), instanceResults.begin(), instanceResults.end());
+        }
+    }
+
+    if (!outputFileName_.empty())
+    {
+        Nbnxm::writeBenchResults(outputFileName_, outputFormat_, results);
+    }
 
     return 0;
 }
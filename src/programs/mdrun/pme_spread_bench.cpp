@@ -0,0 +1,413 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file contains the main function for the PME spreading benchmark
+ *
+ * The benchmark times the spline computation and spreading of charges
+ * on the PME grid for a synthetic system, with the default scheme of
+ * thread-local grids and with colored spreading on the full grid.
+ */
+
+#include "gmxpre.h"
+
+#include "pme_spread_bench.h"
+
+#include "config.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/domdec/domdec.h"
+#include "gromacs/ewald/ewald_utils.h"
+#include "gromacs/ewald/pme.h"
+#include "gromacs/ewald/pme_grid.h"
+#include "gromacs/ewald/pme_internal.h"
+#include "gromacs/ewald/pme_spread.h"
+#include "gromacs/fft/calcgrid.h"
+#include "gromacs/fft/parallel_3dfft.h"
+#include "gromacs/math/invertmatrix.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/logger.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+#include "gromacs/utility/unique_cptr.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! The PME spreading schemes that can be benchmarked
+enum class PmeSpreadScheme
+{
+    Default,
+    Colored
+};
+
+//! Returns the name of \p scheme
+const char* spreadSchemeName(PmeSpreadScheme scheme)
+{
+    return scheme == PmeSpreadScheme::Default ? "default" : "colored";
+}
+
+//! The timing result for one spreading scheme and number of threads
+struct PmeSpreadBenchResult
+{
+    //! The spreading scheme
+    PmeSpreadScheme scheme;
+    //! The number of OpenMP threads
+    int numThreads;
+    //! The number of timed iterations
+    int numIterations;
+    //! The total wall time in seconds
+    double seconds;
+    //! The maximum difference with the grid of the first run, relative to the maximum grid value
+    real maxRelativeDifference;
+
+    //! Returns the time per spreading call in milliseconds
+    double millisecondsPerCall() const { return 1e3 * seconds / numIterations; }
+};
+
+class PmeSpreadBenchmark : public ICommandLineOptionsModule
+{
+public:
+    PmeSpreadBenchmark() {}
+
+    // From ICommandLineOptionsModule
+    void init(CommandLineModuleSettings* /*settings*/) override {}
+    void initOptions(IOptionsContainer*                 options,
+                     ICommandLineOptionsModuleSettings* settings) override;
+    void optionsFinished() override;
+    int  run() override;
+
+private:
+    /*! \brief Times spreading \p charges at \p coordinates with \p numThreads threads
+     *
+     * Returns false when \p scheme is not supported for this number of threads
+     * and grid. The wrapped grid of the first successful call is stored in
+     * \p referenceGrid and later grids are compared to it.
+     */
+    bool benchmarkSpread(PmeSpreadScheme       scheme,
+                         int                   numThreads,
+                         const matrix          box,
+                         const ivec            gridSize,
+                         std::vector<RVec>*    coordinates,
+                         std::vector<real>*    charges,
+                         std::vector<real>*    referenceGrid,
+                         PmeSpreadBenchResult* result);
+
+    int              numAtoms_            = 100000;
+    real             gridSpacing_         = 0.12;
+    int              pmeOrder_            = 4;
+    std::vector<int> numThreads_          = {};
+    int              numIterations_       = 100;
+    int              numWarmupIterations_ = 10;
+    std::string      outputFileName_;
+};
+
+void PmeSpreadBenchmark::initOptions(IOptionsContainer*                 options,
+                                     ICommandLineOptionsModuleSettings* settings)
+{
+    std::vector<const char*> desc = {
+        "[THISMODULE] runs benchmarks for the spline computation and spreading",
+        "of charges on the PME grid, which is the part of PME on CPUs that",
+        "scales least with the number of OpenMP threads. The system consists",
+        "of [TT]-n[tt] atoms with random positions and charges in a cubic box",
+        "at the atom density of water. The grid has spacing [TT]-spacing[tt]",
+        "and the PME order is [TT]-order[tt].[PAR]",
+        "For each number of threads given with [TT]-nt[tt], spreading is timed",
+        "over [TT]-iter[tt] calls, after [TT]-warmup[tt] untimed calls, with the",
+        "default scheme of thread-local grids with reduction of the overlap,",
+        "and, with more than one thread, with colored spreading directly on",
+        "the full grid, as selected in [TT]mdrun[tt] with the environment",
+        "variable [TT]GMX_PME_COLORED_SPREAD[tt], which should not be set here.",
+        "Colored spreading is skipped",
+        "when the thread-local domains are too small for it.",
+        "The tool reports the time per call and the maximum difference of the",
+        "grid with that of the first run, relative to the maximum grid value.",
+        "With [TT]-o[tt], the results are also written to file in CSV format."
+    };
+
+    settings->setHelpText(desc);
+
+    options->addOption(IntegerOption("n").store(&numAtoms_).description("The number of atoms"));
+    options->addOption(
+            RealOption("spacing").store(&gridSpacing_).description("The PME grid spacing (nm)"));
+    options->addOption(
+            IntegerOption("order").store(&pmeOrder_).description("The PME interpolation order"));
+    options->addOption(IntegerOption("nt").storeVector(&numThreads_).multiValue().description(
+            "The numbers of OpenMP threads to spread with, by default 1 and 4"));
+    options->addOption(IntegerOption("iter").store(&numIterations_).description(
+            "The number of timed spreading calls"));
+    options->addOption(IntegerOption("warmup")
+                               .store(&numWarmupIterations_)
+                               .description("The number of calls for initial warmup"));
+    options->addOption(StringOption("o")
+                               .store(&outputFileName_)
+                               .description("Write the results also to this file, in CSV format"));
+}
+
+void PmeSpreadBenchmark::optionsFinished()
+{
+    if (numAtoms_ < 1 || numIterations_ < 1 || numWarmupIterations_ < 0)
+    {
+        GMX_THROW(InconsistentInputError("The number of atoms and iterations should be positive"));
+    }
+    if (gridSpacing_ <= 0)
+    {
+        GMX_THROW(InconsistentInputError("The grid spacing should be positive"));
+    }
+    if (pmeOrder_ < 3 || pmeOrder_ > PME_ORDER_MAX)
+    {
+        GMX_THROW(InconsistentInputError(
+                formatString("The PME order should be between 3 and %d", PME_ORDER_MAX)));
+    }
+    if (std::getenv("GMX_PME_COLORED_SPREAD") != nullptr)
+    {
+        /* gmx_pme_init() would then free the thread-local grids of the default scheme */
+        GMX_THROW(InconsistentInputError(
+                "GMX_PME_COLORED_SPREAD should not be set, both spreading schemes are timed"));
+    }
+    if (numThreads_.empty())
+    {
+        numThreads_ = { 1, 4 };
+    }
+    for (const int numThreads : numThreads_)
+    {
+        if (numThreads < 1 || numThreads > GMX_OPENMP_MAX_THREADS)
+        {
+            GMX_THROW(InconsistentInputError(formatString(
+                    "The number of threads should be between 1 and %d", GMX_OPENMP_MAX_THREADS)));
+        }
+    }
+}
+
+bool PmeSpreadBenchmark::benchmarkSpread(const PmeSpreadScheme scheme,
+                                         const int             numThreads,
+                                         const matrix          box,
+                                         const ivec            gridSize,
+                                         std::vector<RVec>*    coordinates,
+                                         std::vector<real>*    charges,
+                                         std::vector<real>*    referenceGrid,
+                                         PmeSpreadBenchResult* result)
+{
+    t_inputrec inputRec;
+    inputRec.nkx         = gridSize[XX];
+    inputRec.nky         = gridSize[YY];
+    inputRec.nkz         = gridSize[ZZ];
+    inputRec.pme_order   = pmeOrder_;
+    inputRec.coulombtype = eelPME;
+    inputRec.epsilon_r   = 1.0;
+
+    const MDLogger dummyLogger;
+    t_commrec      dummyCommrec  = { 0 };
+    NumPmeDomains  numPmeDomains = { 1, 1 };
+    const real     ewaldCoeff    = calc_ewaldcoeff_q(1.0, 1e-5);
+    unique_cptr<gmx_pme_t, gmx_pme_destroy> pme(
+            gmx_pme_init(&dummyCommrec, numPmeDomains, &inputRec, false, false, false, ewaldCoeff,
+                         0, numThreads, PmeRunMode::CPU, nullptr, nullptr, nullptr, nullptr,
+                         dummyLogger));
+
+    /* Select the scheme here, as gmx_pme_init() does with GMX_PME_COLORED_SPREAD */
+    if (scheme == PmeSpreadScheme::Colored
+        && !(pme->nthread > 1 && pmeGridsSupportColoredSpread(pme->pmegrid[0])))
+    {
+        return false;
+    }
+    pme->useColoredSpread = (scheme == PmeSpreadScheme::Colored);
+
+    PmeAtomComm* atc = &pme->atc[0];
+    gmx_pme_reinit_atoms(pme.get(), coordinates->size(), charges->data());
+    atc->x           = *coordinates;
+    atc->coefficient = *charges;
+    invertBoxMatrix(box, pme->recipbox);
+
+    real*  fftgrid = pme->fftgrid[0];
+    real*  pmegrid = pme->pmegrid[0].grid.grid;
+    double seconds = 0;
+    for (int iter = 0; iter < numWarmupIterations_ + numIterations_; iter++)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        spread_on_grid(pme.get(), atc, &pme->pmegrid[0], TRUE, TRUE, fftgrid, FALSE, 0);
+        if (!pme->bUseThreads)
+        {
+            wrap_periodic_pmegrid(pme.get(), pmegrid);
+            copy_pmegrid_to_fftgrid(pme.get(), pmegrid, fftgrid, 0);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (iter >= numWarmupIterations_)
+        {
+            seconds += elapsed.count();
+        }
+    }
+
+    // Compare the grid with the reference, outside the timed region
+    ivec localNData, localOffset, localSize;
+    gmx_parallel_3dfft_real_limits(pme->pfft_setup[0], localNData, localOffset, localSize);
+    std::vector<real> grid;
+    for (int x = 0; x < localNData[XX]; x++)
+    {
+        for (int y = 0; y < localNData[YY]; y++)
+        {
+            const real* gridLine = fftgrid + (x * localSize[YY] + y) * localSize[ZZ];
+            grid.insert(grid.end(), gridLine, gridLine + localNData[ZZ]);
+        }
+    }
+    if (referenceGrid->empty())
+    {
+        *referenceGrid = grid;
+    }
+    real maxValue      = 0;
+    real maxDifference = 0;
+    for (size_t i = 0; i < grid.size(); i++)
+    {
+        maxValue      = std::max(maxValue, std::abs((*referenceGrid)[i]));
+        maxDifference = std::max(maxDifference, std::abs(grid[i] - (*referenceGrid)[i]));
+    }
+
+    *result = { scheme, numThreads, numIterations_, seconds,
+                maxValue > 0 ? maxDifference / maxValue : maxDifference };
+
+    return true;
+}
+
+int PmeSpreadBenchmark::run()
+{
+    // The number of atoms per nm^3 in water
+    const real atomDensity = 100;
+    const real boxSize     = std::cbrt(numAtoms_ / atomDensity);
+
+    matrix box;
+    clear_mat(box);
+    for (int d = 0; d < DIM; d++)
+    {
+        box[d][d] = boxSize;
+    }
+    /* calcFftGrid() only determines the grid size in dimensions that are not set */
+    ivec gridSize = { 0, 0, 0 };
+    calcFftGrid(nullptr, box, gridSpacing_, minimalPmeGridSize(pmeOrder_), &gridSize[XX],
+                &gridSize[YY], &gridSize[ZZ]);
+
+    DefaultRandomEngine           rng(2021);
+    UniformRealDistribution<real> uniformDist(0, 1);
+    std::vector<RVec>             coordinates(numAtoms_);
+    std::vector<real>             charges(numAtoms_);
+    for (int a = 0; a < numAtoms_; a++)
+    {
+        coordinates[a] = { uniformDist(rng) * boxSize, uniformDist(rng) * boxSize,
+                           uniformDist(rng) * boxSize };
+        charges[a]     = 2 * uniformDist(rng) - 1;
+    }
+
+    fprintf(stdout, "Spreading %d charges with PME order %d on a %d x %d x %d grid\n", numAtoms_,
+            pmeOrder_, gridSize[XX], gridSize[YY], gridSize[ZZ]);
+    fprintf(stdout, "\n%-8s %8s %12s %14s\n", "Scheme", "Threads", "ms/call", "Max rel diff");
+
+    std::vector<PmeSpreadBenchResult> results;
+    std::vector<real>                 referenceGrid;
+    for (const int numThreads : numThreads_)
+    {
+        for (const PmeSpreadScheme scheme : { PmeSpreadScheme::Default, PmeSpreadScheme::Colored })
+        {
+            if (scheme == PmeSpreadScheme::Colored && numThreads == 1)
+            {
+                continue;
+            }
+            PmeSpreadBenchResult result;
+            if (benchmarkSpread(scheme, numThreads, box, gridSize, &coordinates, &charges,
+                                &referenceGrid, &result))
+            {
+                fprintf(stdout, "%-8s %8d %12.3f %14.2e\n", spreadSchemeName(scheme),
+                        result.numThreads, result.millisecondsPerCall(),
+                        result.maxRelativeDifference);
+                results.push_back(result);
+            }
+            else
+            {
+                fprintf(stdout, "%-8s %8d   the thread-local domains are too small\n",
+                        spreadSchemeName(scheme), numThreads);
+            }
+        }
+    }
+
+    if (!outputFileName_.empty())
+    {
+        TextWriter writer(outputFileName_);
+        writer.writeLine("scheme,threads,atoms,order,nkx,nky,nkz,iterations,seconds,ms_per_call,"
+                         "max_rel_diff");
+        for (const PmeSpreadBenchResult& result : results)
+        {
+            writer.writeLine(formatString(
+                    "%s,%d,%d,%d,%d,%d,%d,%d,%g,%g,%g", spreadSchemeName(result.scheme),
+                    result.numThreads, numAtoms_, pmeOrder_, gridSize[XX], gridSize[YY],
+                    gridSize[ZZ], result.numIterations, result.seconds,
+                    result.millisecondsPerCall(), result.maxRelativeDifference));
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+const char PmeSpreadBenchmarkInfo::name[] = "pme-spread-benchmark";
+const char PmeSpreadBenchmarkInfo::shortDescription[] =
+        "Benchmarking tool for PME charge spreading on CPUs.";
+
+ICommandLineOptionsModulePointer PmeSpreadBenchmarkInfo::create()
+{
+    return ICommandLineOptionsModulePointer(std::make_unique<PmeSpreadBenchmark>());
+}
+
+} // namespace gmx
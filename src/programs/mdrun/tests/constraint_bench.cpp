@@ -0,0 +1,136 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * This implements basic constraint benchmark tests.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include "programs/mdrun/constraint_bench.h"
+
+#include <cstdlib>
+
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+TEST(ConstraintBenchTest, BasicEndToEndTest)
+{
+    const char* const command[] = { "constraint-benchmark" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-n", 1000);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-warmup", 0);
+    EXPECT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::ConstraintBenchmarkInfo::create, &cmdline));
+}
+
+TEST(ConstraintBenchTest, ThreadedResultsMatchWithTriangles)
+{
+    gmx::test::TestFileManager fileManager;
+    const std::string          outputFile = fileManager.getTemporaryFilePath("bench.csv");
+
+    const char* const command[] = { "constraint-benchmark", "-nt", "1", "3", "-triangles", "-pbc" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-n", 4000);
+    cmdline.addOption("-len", 20);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-warmup", 0);
+    cmdline.addOption("-o", outputFile);
+    ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::ConstraintBenchmarkInfo::create, &cmdline));
+
+    const auto lines = splitDelimitedString(TextReader::readFileToString(outputFile), '\n');
+    // Header and one line per thread count
+    ASSERT_GE(lines.size(), 1 + 2);
+    EXPECT_EQ(0, lines[0].find("algorithm,threads,"));
+    EXPECT_EQ(0, lines[1].find("LINCS,1,"));
+    EXPECT_EQ(0, lines[2].find("LINCS,3,"));
+    // The threaded result should only differ by rounding from the serial one
+    const auto fields = splitDelimitedString(lines[2], ',');
+    ASSERT_EQ(7, fields.size());
+    EXPECT_LT(std::strtod(fields[6].c_str(), nullptr), 1e-5);
+}
+
+TEST(ConstraintBenchTest, ThreadedShakeResultsMatch)
+{
+    gmx::test::TestFileManager fileManager;
+    const std::string          outputFile = fileManager.getTemporaryFilePath("bench.csv");
+
+    const char* const command[] = { "constraint-benchmark", "-alg", "SHAKE", "-nt", "1", "3" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-n", 4000);
+    cmdline.addOption("-len", 5);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-warmup", 0);
+    cmdline.addOption("-o", outputFile);
+    ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::ConstraintBenchmarkInfo::create, &cmdline));
+
+    const auto lines = splitDelimitedString(TextReader::readFileToString(outputFile), '\n');
+    ASSERT_GE(lines.size(), 1 + 2);
+    EXPECT_EQ(0, lines[1].find("SHAKE,1,"));
+    EXPECT_EQ(0, lines[2].find("SHAKE,3,"));
+    // Blocks can be processed with or without SIMD depending on the thread
+    // count, so the results should only differ by rounding
+    const auto fields = splitDelimitedString(lines[2], ',');
+    ASSERT_EQ(7, fields.size());
+    EXPECT_LT(std::strtod(fields[6].c_str(), nullptr), 1e-5);
+}
+
+TEST(ConstraintBenchTest, InvalidThreadCountThrows)
+{
+    const char* const command[] = { "constraint-benchmark", "-nt", "0" };
+    CommandLine       cmdline(command);
+    EXPECT_THROW_GMX(gmx::test::CommandLineTestHelper::runModuleFactory(
+                             &gmx::ConstraintBenchmarkInfo::create, &cmdline),
+                     InconsistentInputError);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
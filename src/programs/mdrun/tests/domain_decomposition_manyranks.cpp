@@ -0,0 +1,216 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests domain decomposition setups that need more than two ranks
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/mpitest.h"
+#include "testutils/setenv.h"
+#include "testutils/simulationdatabase.h"
+
+#include "moduletest.h"
+#include "simulatorcomparison.h"
+
+namespace
+{
+
+//! Test fixture for domain decomposition with more than two ranks
+class DomainDecompositionManyRanksTest : public gmx::test::MdrunTestFixture
+{
+};
+
+/*! \brief Checks that the non-blocking halo coordinate communication gives the same simulation
+ *
+ * All ranks are placed along x, so the cells are narrower than the
+ * cut-off and the halo is communicated in multiple pulses. The
+ * non-blocking communication overlaps with the local non-bonded
+ * kernel, which only changes the order of the force summation.
+ */
+TEST_F(DomainDecompositionManyRanksTest, NonBlockingMoveXWithMultiplePulsesMatchesBlocking)
+{
+    using namespace gmx::test;
+
+    const std::string simulationName = "spc216";
+    const int         numRanks       = getNumberOfTestMpiRanks();
+    /* With two cells along a dimension, only a single pulse can be used */
+    if (numRanks < 3 || !isNumberOfPpRanksSupported(simulationName, numRanks))
+    {
+        return;
+    }
+
+    auto mdpFieldValues = prepareMdpFieldValues(simulationName.c_str(), "md", "no", "no");
+
+    EnergyTermsToCompare energyTermsToCompare{ {
+            { interaction_function[F_EPOT].longname, relativeToleranceAsPrecisionDependentUlp(10.0, 100, 80) },
+            { interaction_function[F_EKIN].longname, relativeToleranceAsPrecisionDependentUlp(60.0, 100, 80) },
+    } };
+    TrajectoryFrameMatchSettings trajectoryMatchSettings{ true,
+                                                          true,
+                                                          true,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare };
+    TrajectoryComparison         trajectoryComparison{
+        trajectoryMatchSettings, TrajectoryComparison::s_defaultTrajectoryTolerances
+    };
+
+    auto blockingTrajectoryFileName    = fileManager_.getTemporaryFilePath("blocking.trr");
+    auto blockingEdrFileName           = fileManager_.getTemporaryFilePath("blocking.edr");
+    auto nonBlockingTrajectoryFileName = fileManager_.getTemporaryFilePath("nonblocking.trr");
+    auto nonBlockingEdrFileName        = fileManager_.getTemporaryFilePath("nonblocking.edr");
+
+    runner_.useTopGroAndNdxFromDatabase(simulationName);
+    runner_.useStringAsMdpFile(prepareMdpFileContents(mdpFieldValues));
+    runGrompp(&runner_);
+
+    CommandLine mdrunCaller;
+    mdrunCaller.append("mdrun");
+    mdrunCaller.append("-dd");
+    mdrunCaller.append(std::to_string(numRanks));
+    mdrunCaller.append("1");
+    mdrunCaller.append("1");
+    mdrunCaller.addOption("-npme", 0);
+    mdrunCaller.addOption("-nb", "cpu");
+
+    gmxUnsetenv("GMX_DD_NONBLOCKING_MOVEX");
+    runner_.fullPrecisionTrajectoryFileName_ = blockingTrajectoryFileName;
+    runner_.edrFileName_                     = blockingEdrFileName;
+    ASSERT_EQ(0, runner_.callMdrun(mdrunCaller));
+
+    gmxSetenv("GMX_DD_NONBLOCKING_MOVEX", "1", 1);
+    runner_.fullPrecisionTrajectoryFileName_ = nonBlockingTrajectoryFileName;
+    runner_.edrFileName_                     = nonBlockingEdrFileName;
+    ASSERT_EQ(0, runner_.callMdrun(mdrunCaller));
+    gmxUnsetenv("GMX_DD_NONBLOCKING_MOVEX");
+
+    /* Check that the halo was communicated in multiple pulses */
+    const std::string log           = gmx::TextReader::readFileToString(runner_.logFileName_);
+    const std::string pulsesMessage = "The initial number of communication pulses is: X ";
+    const size_t      pulsesPos     = log.find(pulsesMessage);
+    ASSERT_NE(std::string::npos, pulsesPos);
+    EXPECT_GT(std::stoi(log.substr(pulsesPos + pulsesMessage.size())), 1);
+
+    compareEnergies(blockingEdrFileName, nonBlockingEdrFileName, energyTermsToCompare);
+    compareTrajectories(blockingTrajectoryFileName, nonBlockingTrajectoryFileName,
+                        trajectoryComparison);
+}
+
+/*! \brief Checks that topology-aware placement of the DD cells gives the same simulation
+ *
+ * The ranks are assigned round-robin to two fake physical nodes, so
+ * the placement, which puts neighboring cells on the same node, gives
+ * a DD cell order that differs from the rank order. The placement only
+ * changes the order of the ranks in the DD communicator, so the energies
+ * and trajectories should match those with the default order.
+ */
+TEST_F(DomainDecompositionManyRanksTest, TopologyAwarePlacementWorks)
+{
+    using namespace gmx::test;
+
+    const std::string simulationName = "spc216";
+    const int         numRanks       = getNumberOfTestMpiRanks();
+    /* With fewer than two ranks per fake node, the placement keeps the rank order */
+    if (numRanks < 4 || numRanks % 2 != 0 || !isNumberOfPpRanksSupported(simulationName, numRanks))
+    {
+        return;
+    }
+
+    auto mdpFieldValues = prepareMdpFieldValues(simulationName.c_str(), "md", "no", "no");
+
+    EnergyTermsToCompare energyTermsToCompare{ {
+            { interaction_function[F_EPOT].longname, relativeToleranceAsPrecisionDependentUlp(10.0, 100, 80) },
+            { interaction_function[F_EKIN].longname, relativeToleranceAsPrecisionDependentUlp(60.0, 100, 80) },
+    } };
+    TrajectoryFrameMatchSettings trajectoryMatchSettings{ true,
+                                                          true,
+                                                          true,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare };
+    TrajectoryComparison         trajectoryComparison{
+        trajectoryMatchSettings, TrajectoryComparison::s_defaultTrajectoryTolerances
+    };
+
+    auto referenceTrajectoryFileName = fileManager_.getTemporaryFilePath("default.trr");
+    auto referenceEdrFileName        = fileManager_.getTemporaryFilePath("default.edr");
+    auto placedTrajectoryFileName    = fileManager_.getTemporaryFilePath("placed.trr");
+    auto placedEdrFileName           = fileManager_.getTemporaryFilePath("placed.edr");
+
+    runner_.useTopGroAndNdxFromDatabase(simulationName);
+    runner_.useStringAsMdpFile(prepareMdpFileContents(mdpFieldValues));
+    runGrompp(&runner_);
+
+    /* Placement is not supported with separate PME ranks */
+    CommandLine mdrunCaller;
+    mdrunCaller.append("mdrun");
+    mdrunCaller.addOption("-npme", 0);
+
+    gmxSetenv("GMX_DD_FAKE_PHYSICAL_NODES", "2", 1);
+
+    gmxUnsetenv("GMX_DD_TOPOLOGY_PLACEMENT");
+    runner_.fullPrecisionTrajectoryFileName_ = referenceTrajectoryFileName;
+    runner_.edrFileName_                     = referenceEdrFileName;
+    ASSERT_EQ(0, runner_.callMdrun(mdrunCaller));
+
+    gmxSetenv("GMX_DD_TOPOLOGY_PLACEMENT", "1", 1);
+    runner_.fullPrecisionTrajectoryFileName_ = placedTrajectoryFileName;
+    runner_.edrFileName_                     = placedEdrFileName;
+    ASSERT_EQ(0, runner_.callMdrun(mdrunCaller));
+    gmxUnsetenv("GMX_DD_TOPOLOGY_PLACEMENT");
+
+    gmxUnsetenv("GMX_DD_FAKE_PHYSICAL_NODES");
+
+    /* Check that the placement was applied */
+    const std::string log = gmx::TextReader::readFileToString(runner_.logFileName_);
+    EXPECT_NE(std::string::npos, log.find("Placed blocks of neighboring DD cells"));
+
+    compareEnergies(referenceEdrFileName, placedEdrFileName, energyTermsToCompare);
+    compareTrajectories(referenceTrajectoryFileName, placedTrajectoryFileName,
+                        trajectoryComparison);
+}
+
+} // namespace
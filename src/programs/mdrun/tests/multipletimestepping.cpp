@@ -0,0 +1,162 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that multiple time-stepping produces the same energies and forces
+ * as single time-stepping at steps where all force groups are computed.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include <string>
+#include <tuple>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/mpitest.h"
+#include "testutils/simulationdatabase.h"
+
+#include "moduletest.h"
+#include "simulatorcomparison.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+/*! \brief Test fixture for comparing simulations with and without multiple time-stepping
+ *
+ * The parameters are the simulation system name and the MTS level-2 step factor.
+ * Only step 0 is simulated, at which all forces are computed, so the energies
+ * and the total forces should agree within summation-order tolerances.
+ */
+class MtsComparisonTest :
+    public MdrunTestFixture,
+    public ::testing::WithParamInterface<std::tuple<std::string, int>>
+{
+};
+
+TEST_P(MtsComparisonTest, WithinTolerances)
+{
+    const auto& params         = GetParam();
+    const auto& simulationName = std::get<0>(params);
+    const int   mtsFactor      = std::get<1>(params);
+
+    int numRanksAvailable = getNumberOfTestMpiRanks();
+    if (!isNumberOfPpRanksSupported(simulationName, numRanksAvailable))
+    {
+        fprintf(stdout,
+                "Test system '%s' cannot run with %d ranks.\n"
+                "The supported numbers are: %s\n",
+                simulationName.c_str(), numRanksAvailable,
+                reportNumbersOfPpRanksSupported(simulationName).c_str());
+        return;
+    }
+
+    SCOPED_TRACE(formatString(
+            "Comparing simulations of '%s' with and without multiple time-stepping with factor %d",
+            simulationName.c_str(), mtsFactor));
+
+    auto mdpFieldValues = prepareMdpFieldValues(simulationName.c_str(), "md", "no", "no");
+    mdpFieldValues["nsteps"]        = "0";
+    mdpFieldValues["coulombtype"]   = "PME";
+    mdpFieldValues["nstcalcenergy"] = "4";
+
+    const std::string mtsMdpOptions = formatString(
+            "mts                = yes\n"
+            "mts-levels         = 2\n"
+            "mts-level2-forces  = longrange-nonbonded\n"
+            "mts-level2-factor  = %d\n",
+            mtsFactor);
+
+    EnergyTermsToCompare energyTermsToCompare{ {
+            { interaction_function[F_EPOT].longname, relativeToleranceAsPrecisionDependentUlp(10.0, 100, 80) },
+            { interaction_function[F_COUL_RECIP].longname,
+              relativeToleranceAsPrecisionDependentUlp(10.0, 100, 80) },
+            { interaction_function[F_PRES].longname,
+              relativeToleranceAsPrecisionDependentFloatingPoint(10.0, 0.01, 0.001) },
+    } };
+
+    TrajectoryFrameMatchSettings trajectoryMatchSettings{ true,
+                                                          true,
+                                                          true,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare,
+                                                          ComparisonConditions::MustCompare };
+    TrajectoryComparison trajectoryComparison{ trajectoryMatchSettings,
+                                               TrajectoryComparison::s_defaultTrajectoryTolerances };
+
+    auto simulator1TrajectoryFileName = fileManager_.getTemporaryFilePath("sim1.trr");
+    auto simulator1EdrFileName        = fileManager_.getTemporaryFilePath("sim1.edr");
+    auto simulator2TrajectoryFileName = fileManager_.getTemporaryFilePath("sim2.trr");
+    auto simulator2EdrFileName        = fileManager_.getTemporaryFilePath("sim2.edr");
+
+    runner_.useTopGroAndNdxFromDatabase(simulationName);
+
+    // Do the reference simulation without multiple time-stepping
+    runner_.tprFileName_ = fileManager_.getTemporaryFilePath("sim1.tpr");
+    runner_.useStringAsMdpFile(prepareMdpFileContents(mdpFieldValues));
+    runGrompp(&runner_);
+    runner_.fullPrecisionTrajectoryFileName_ = simulator1TrajectoryFileName;
+    runner_.edrFileName_                     = simulator1EdrFileName;
+    runMdrun(&runner_);
+
+    // Do the same simulation with multiple time-stepping
+    mdpFieldValues["other"] += mtsMdpOptions;
+    runner_.tprFileName_ = fileManager_.getTemporaryFilePath("sim2.tpr");
+    runner_.useStringAsMdpFile(prepareMdpFileContents(mdpFieldValues));
+    runGrompp(&runner_);
+    runner_.fullPrecisionTrajectoryFileName_ = simulator2TrajectoryFileName;
+    runner_.edrFileName_                     = simulator2EdrFileName;
+    runMdrun(&runner_);
+
+    compareEnergies(simulator1EdrFileName, simulator2EdrFileName, energyTermsToCompare);
+    compareTrajectories(simulator1TrajectoryFileName, simulator2TrajectoryFileName, trajectoryComparison);
+}
+
+INSTANTIATE_TEST_CASE_P(MultipleTimeSteppingIsEquivalentAtSlowSteps,
+                        MtsComparisonTest,
+                        ::testing::Combine(::testing::Values("alanine_vsite_solvated"),
+                                           ::testing::Values(2, 4)));
+
+} // namespace
+} // namespace test
+} // namespace gmx
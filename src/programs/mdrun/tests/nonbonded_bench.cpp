@@ -48,6 +48,7 @@
 
 #include "testutils/refdata.h"
 #include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
 
 #include "moduletest.h"
 
@@ -67,6 +68,40 @@ TEST(NonbondedBenchTest, BasicEndToEndTest)
                          &gmx::NonbondedBenchmarkInfo::create, &cmdline));
 }
 
+TEST(NonbondedBenchTest, SweepWritesCsvOutput)
+{
+    gmx::test::TestFileManager fileManager;
+    const std::string          outputFile = fileManager.getTemporaryFilePath("bench.csv");
+
+    const char* const command[] = { "nonbonded-benchmark", "-cutoff", "0.9", "1.0", "-allflavors" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-o", outputFile);
+    ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::NonbondedBenchmarkInfo::create, &cmdline));
+
+    const auto lines = splitDelimitedString(TextReader::readFileToString(outputFile), '\n');
+    // Header plus, for each of the two cut-offs, at least the four Ewald flavors
+    EXPECT_GE(lines.size(), 1 + 2 * 4);
+    EXPECT_EQ(0, lines[0].find("atoms,cutoff,"));
+}
+
+TEST(NonbondedBenchTest, PairSearchWritesJsonOutput)
+{
+    gmx::test::TestFileManager fileManager;
+    const std::string          outputFile = fileManager.getTemporaryFilePath("bench.json");
+
+    const char* const command[] = { "nonbonded-benchmark", "-search", "-format", "json" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-o", outputFile);
+    ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::NonbondedBenchmarkInfo::create, &cmdline));
+
+    const std::string output = TextReader::readFileToString(outputFile);
+    EXPECT_NE(std::string::npos, output.find("\"search_mcycles_per_iteration\""));
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
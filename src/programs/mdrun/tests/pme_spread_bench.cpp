@@ -0,0 +1,102 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * This implements basic PME spreading benchmark tests.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include "programs/mdrun/pme_spread_bench.h"
+
+#include <cstdlib>
+
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+TEST(PmeSpreadBenchTest, ColoredSpreadGivesTheSameGrid)
+{
+    gmx::test::TestFileManager fileManager;
+    const std::string          outputFile = fileManager.getTemporaryFilePath("bench.csv");
+
+    const char* const command[] = { "pme-spread-benchmark", "-nt", "1", "2" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-n", 2000);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-warmup", 0);
+    cmdline.addOption("-o", outputFile);
+    ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::PmeSpreadBenchmarkInfo::create, &cmdline));
+
+    const auto lines = splitDelimitedString(TextReader::readFileToString(outputFile), '\n');
+    // Header, one line for one thread and two lines, for both schemes, for two threads
+    ASSERT_GE(lines.size(), 1 + 1 + 2);
+    EXPECT_EQ(0, lines[0].find("scheme,threads,"));
+    EXPECT_EQ(0, lines[1].find("default,1,2000,4,"));
+    EXPECT_EQ(0, lines[2].find("default,2,2000,4,"));
+    EXPECT_EQ(0, lines[3].find("colored,2,2000,4,"));
+    // The grids should only differ by rounding from the different summation order
+    for (int line = 1; line < 4; line++)
+    {
+        const auto fields = splitDelimitedString(lines[line], ',');
+        ASSERT_EQ(11, fields.size());
+        EXPECT_LE(std::strtod(fields[10].c_str(), nullptr), 1e-4);
+    }
+}
+
+TEST(PmeSpreadBenchTest, InvalidOrderThrows)
+{
+    const char* const command[] = { "pme-spread-benchmark", "-order", "2" };
+    CommandLine       cmdline(command);
+    EXPECT_THROW_GMX(gmx::test::CommandLineTestHelper::runModuleFactory(
+                             &gmx::PmeSpreadBenchmarkInfo::create, &cmdline),
+                     InconsistentInputError);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
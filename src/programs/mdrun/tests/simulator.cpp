@@ -241,6 +241,29 @@ INSTANTIATE_TEST_CASE_P(
                            ::testing::Values("GMX_USE_MODULAR_SIMULATOR")));
 #endif
 
+// The fused leap-frog update with SETTLE gives the same trajectories as the separate
+// update and constraint passes, only the SETTLE virial is summed in a different order,
+// so these tests can also run in mixed precision.
+#if GMX_GPU != GMX_GPU_OPENCL
+INSTANTIATE_TEST_CASE_P(
+        FusedUpdateIsEquivalent,
+        SimulatorComparisonTest,
+        ::testing::Combine(::testing::Combine(::testing::Values("tip3p5", "alanine_vsite_solvated"),
+                                              ::testing::Values("md"),
+                                              ::testing::Values("no", "v-rescale", "nose-hoover"),
+                                              ::testing::Values("no", "Parrinello-Rahman")),
+                           ::testing::Values("GMX_USE_FUSED_UPDATE")));
+#else
+INSTANTIATE_TEST_CASE_P(
+        DISABLED_FusedUpdateIsEquivalent,
+        SimulatorComparisonTest,
+        ::testing::Combine(::testing::Combine(::testing::Values("tip3p5", "alanine_vsite_solvated"),
+                                              ::testing::Values("md"),
+                                              ::testing::Values("no", "v-rescale", "nose-hoover"),
+                                              ::testing::Values("no", "Parrinello-Rahman")),
+                           ::testing::Values("GMX_USE_FUSED_UPDATE")));
+#endif
+
 } // namespace
 } // namespace test
 } // namespace gmx
@@ -0,0 +1,105 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * This implements basic XTC benchmark tests.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include "programs/mdrun/xtc_bench.h"
+
+#include <cstdlib>
+
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+TEST(XtcBenchTest, ThreadedReadingGivesCorrectPositions)
+{
+    gmx::test::TestFileManager fileManager;
+    const std::string          xtcFile    = fileManager.getTemporaryFilePath("bench.xtc");
+    const std::string          outputFile = fileManager.getTemporaryFilePath("bench.csv");
+
+    const char* const command[] = { "xtc-benchmark", "-nt", "1", "3" };
+    CommandLine       cmdline(command);
+    cmdline.addOption("-n", 3000);
+    cmdline.addOption("-frames", 7);
+    cmdline.addOption("-iter", 1);
+    cmdline.addOption("-warmup", 0);
+    cmdline.addOption("-xtc", xtcFile);
+    cmdline.addOption("-o", outputFile);
+    ASSERT_EQ(0, gmx::test::CommandLineTestHelper::runModuleFactory(
+                         &gmx::XtcBenchmarkInfo::create, &cmdline));
+
+    const auto lines = splitDelimitedString(TextReader::readFileToString(outputFile), '\n');
+    // Header, one line for writing and one line per thread count for reading
+    ASSERT_GE(lines.size(), 1 + 1 + 2);
+    EXPECT_EQ(0, lines[0].find("operation,threads,"));
+    EXPECT_EQ(0, lines[1].find("write,1,3000,7,"));
+    EXPECT_EQ(0, lines[2].find("read,1,3000,7,"));
+    EXPECT_EQ(0, lines[3].find("read,3,3000,7,"));
+    // The positions should be within half the inverse precision
+    for (int line = 2; line < 4; line++)
+    {
+        const auto fields = splitDelimitedString(lines[line], ',');
+        ASSERT_EQ(9, fields.size());
+        EXPECT_LE(std::strtod(fields[8].c_str(), nullptr), 0.5e-3 + 1e-6);
+    }
+}
+
+TEST(XtcBenchTest, InvalidPrecisionThrows)
+{
+    const char* const command[] = { "xtc-benchmark", "-prec", "0" };
+    CommandLine       cmdline(command);
+    EXPECT_THROW_GMX(gmx::test::CommandLineTestHelper::runModuleFactory(
+                             &gmx::XtcBenchmarkInfo::create, &cmdline),
+                     InconsistentInputError);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
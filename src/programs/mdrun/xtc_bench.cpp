@@ -0,0 +1,442 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file contains the main function for the XTC benchmark
+ *
+ * The benchmark times writing and reading XTC files with a synthetic
+ * system of water molecules, reading with different numbers of
+ * decoding threads.
+ */
+
+#include "gmxpre.h"
+
+#include "xtc_bench.h"
+
+#include "config.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/xtcframereader.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+/*! \brief Generates \p numFrames frames of water molecules in a periodic box
+ *
+ * The box has the density of liquid water. The molecules have random
+ * orientations and move randomly between frames by the order of the
+ * displacements in a picosecond, so consecutive frames are similar
+ * as in a simulation. The frames are returned in \p frames.
+ */
+void generateWaterFrames(const int                       numMolecules,
+                         const int                       numFrames,
+                         matrix                          box,
+                         std::vector<std::vector<RVec>>* frames)
+{
+    const int  numAtoms        = 3 * numMolecules;
+    const real boxSize         = std::cbrt(numMolecules / 33.4);
+    const real bondLength      = 0.09572;
+    const real halfAngle       = 0.5 * 104.52 * M_PI / 180;
+    const real maxDisplacement = 0.1;
+
+    DefaultRandomEngine           rng(2021);
+    UniformRealDistribution<real> uniformDist(0, 1);
+
+    clear_mat(box);
+    for (int d = 0; d < DIM; d++)
+    {
+        box[d][d] = boxSize;
+    }
+
+    frames->resize(numFrames);
+    std::vector<RVec>& x = (*frames)[0];
+    x.resize(numAtoms);
+    for (int m = 0; m < numMolecules; m++)
+    {
+        // Two random orthonormal vectors give the orientation of the molecule
+        RVec u = { 2 * uniformDist(rng) - 1, 2 * uniformDist(rng) - 1, 2 * uniformDist(rng) - 1 };
+        RVec v = { 2 * uniformDist(rng) - 1, 2 * uniformDist(rng) - 1, 2 * uniformDist(rng) - 1 };
+        u      = u.unitVector();
+        v      = cross(u, v).unitVector();
+
+        x[3 * m] = { uniformDist(rng) * boxSize, uniformDist(rng) * boxSize,
+                     uniformDist(rng) * boxSize };
+        x[3 * m + 1] = x[3 * m] + bondLength * (std::cos(halfAngle) * u + std::sin(halfAngle) * v);
+        x[3 * m + 2] = x[3 * m] + bondLength * (std::cos(halfAngle) * u - std::sin(halfAngle) * v);
+    }
+    for (int f = 1; f < numFrames; f++)
+    {
+        (*frames)[f] = (*frames)[f - 1];
+        for (int m = 0; m < numMolecules; m++)
+        {
+            const RVec displacement = { (2 * uniformDist(rng) - 1) * maxDisplacement,
+                                        (2 * uniformDist(rng) - 1) * maxDisplacement,
+                                        (2 * uniformDist(rng) - 1) * maxDisplacement };
+            for (int a = 3 * m; a < 3 * m + 3; a++)
+            {
+                (*frames)[f][a] += displacement;
+            }
+        }
+    }
+}
+
+//! The timing result for writing or for reading with one number of threads
+struct XtcBenchResult
+{
+    //! The operation, write or read
+    const char* operation;
+    //! The number of decoding threads, 1 for writing
+    int numThreads;
+    //! The number of frames written or read per iteration
+    int numFrames;
+    //! The number of timed iterations
+    int numIterations;
+    //! The total wall time in seconds
+    double seconds;
+    //! The file size in bytes
+    double fileSize;
+    //! The maximum difference between the positions read and those written
+    real maxDifference;
+
+    //! Returns the number of frames processed per second
+    double framesPerSecond() const { return numFrames * numIterations / seconds; }
+    //! Returns the number of megabytes of compressed data processed per second
+    double megabytesPerSecond() const { return 1e-6 * fileSize * numIterations / seconds; }
+};
+
+class XtcBenchmark : public ICommandLineOptionsModule
+{
+public:
+    XtcBenchmark() {}
+
+    // From ICommandLineOptionsModule
+    void init(CommandLineModuleSettings* /*settings*/) override {}
+    void initOptions(IOptionsContainer*                 options,
+                     ICommandLineOptionsModuleSettings* settings) override;
+    void optionsFinished() override;
+    int  run() override;
+
+private:
+    //! Times writing \p frames to the benchmark file
+    XtcBenchResult benchmarkWrite(const std::vector<std::vector<RVec>>& frames, const matrix box);
+    /*! \brief Times reading the benchmark file with \p numThreads decoding threads
+     *
+     * Returns the timings and the maximum difference with \p frames.
+     */
+    XtcBenchResult benchmarkRead(const std::vector<std::vector<RVec>>& frames,
+                                 int                                   numThreads,
+                                 double                                fileSize);
+
+    int              numAtoms_            = 100000;
+    int              numFrames_           = 20;
+    real             precision_           = 1000;
+    std::vector<int> numThreads_          = {};
+    int              numIterations_       = 3;
+    int              numWarmupIterations_ = 1;
+    std::string      xtcFileName_         = "xtc-benchmark.xtc";
+    std::string      outputFileName_;
+};
+
+void XtcBenchmark::initOptions(IOptionsContainer*                 options,
+                               ICommandLineOptionsModuleSettings* settings)
+{
+    std::vector<const char*> desc = {
+        "[THISMODULE] runs benchmarks for writing and reading XTC files with",
+        "a synthetic system of water molecules at the density of liquid water.",
+        "Between the [TT]-frames[tt] frames, the molecules move randomly",
+        "by distances as over a picosecond, so consecutive frames are similar",
+        "as in a simulation.[PAR]",
+        "The frames are written [TT]-iter[tt] times, after [TT]-warmup[tt]",
+        "untimed passes, to the temporary file given by [TT]-xtc[tt] with",
+        "precision [TT]-prec[tt]. The file is then read the same number of",
+        "times for each number of decoding threads given with [TT]-nt[tt].",
+        "With one thread, frames are decoded on the reading thread as",
+        "[TT]read_next_xtc()[tt] does, with more threads, consecutive",
+        "frames are decoded in parallel as analysis tools do, see the",
+        "environment variable [TT]GMX_XTC_DECODING_THREADS[tt].",
+        "The tool reports the frames and megabytes of compressed data",
+        "processed per second and, for reading, the maximum difference",
+        "between the positions read and written, which should be half the",
+        "inverse precision, up to rounding. The temporary file is removed at the end.",
+        "With [TT]-o[tt], the results are also written to file in CSV format."
+    };
+
+    settings->setHelpText(desc);
+
+    options->addOption(IntegerOption("n").store(&numAtoms_).description(
+            "The approximate number of atoms, rounded to whole molecules"));
+    options->addOption(
+            IntegerOption("frames").store(&numFrames_).description("The number of frames"));
+    options->addOption(
+            RealOption("prec").store(&precision_).description("The precision of the XTC file"));
+    options->addOption(IntegerOption("nt").storeVector(&numThreads_).multiValue().description(
+            "The numbers of decoding threads to read with, by default 1 and 4"));
+    options->addOption(IntegerOption("iter").store(&numIterations_).description(
+            "The number of timed passes over the file"));
+    options->addOption(IntegerOption("warmup")
+                               .store(&numWarmupIterations_)
+                               .description("The number of passes for initial warmup"));
+    options->addOption(StringOption("xtc").store(&xtcFileName_).description(
+            "The temporary XTC file to write and read"));
+    options->addOption(StringOption("o")
+                               .store(&outputFileName_)
+                               .description("Write the results also to this file, in CSV format"));
+}
+
+void XtcBenchmark::optionsFinished()
+{
+    if (numAtoms_ < 3 || numFrames_ < 1 || numIterations_ < 1 || numWarmupIterations_ < 0)
+    {
+        GMX_THROW(InconsistentInputError(
+                "The number of atoms, frames and iterations should be positive"));
+    }
+    if (precision_ <= 0)
+    {
+        GMX_THROW(InconsistentInputError("The precision should be positive"));
+    }
+    if (numThreads_.empty())
+    {
+        numThreads_ = { 1, 4 };
+    }
+    for (const int numThreads : numThreads_)
+    {
+        if (numThreads < 1 || numThreads > GMX_OPENMP_MAX_THREADS)
+        {
+            GMX_THROW(InconsistentInputError(formatString(
+                    "The number of threads should be between 1 and %d", GMX_OPENMP_MAX_THREADS)));
+        }
+    }
+}
+
+XtcBenchResult XtcBenchmark::benchmarkWrite(const std::vector<std::vector<RVec>>& frames,
+                                            const matrix                          box)
+{
+    const int numAtoms = frames[0].size();
+
+    double    seconds  = 0;
+    gmx_off_t fileSize = 0;
+    for (int iter = 0; iter < numWarmupIterations_ + numIterations_; iter++)
+    {
+        if (iter > 0)
+        {
+            // Avoid making backups of the file written in the previous pass
+            std::remove(xtcFileName_.c_str());
+        }
+        const auto startTime = std::chrono::steady_clock::now();
+        t_fileio*  fio       = open_xtc(xtcFileName_.c_str(), "w");
+        for (size_t f = 0; f < frames.size(); f++)
+        {
+            if (write_xtc(fio, numAtoms, f, f, box, as_rvec_array(frames[f].data()), precision_)
+                == 0)
+            {
+                GMX_THROW(FileIOError("Could not write to " + xtcFileName_));
+            }
+        }
+        fileSize = gmx_fio_ftell(fio);
+        close_xtc(fio);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (iter >= numWarmupIterations_)
+        {
+            seconds += elapsed.count();
+        }
+    }
+
+    return { "write", 1, numFrames_, numIterations_, seconds, static_cast<double>(fileSize), 0 };
+}
+
+XtcBenchResult XtcBenchmark::benchmarkRead(const std::vector<std::vector<RVec>>& frames,
+                                           const int                             numThreads,
+                                           const double                          fileSize)
+{
+    double seconds       = 0;
+    real   maxDifference = 0;
+    for (int iter = 0; iter < numWarmupIterations_ + numIterations_; iter++)
+    {
+        int      natoms;
+        int64_t  step;
+        real     time;
+        matrix   box;
+        rvec*    x;
+        real     prec;
+        gmx_bool bOK;
+
+        int                             numFramesRead = 0;
+        std::vector<std::vector<RVec>>* framesRead    = nullptr;
+        std::vector<std::vector<RVec>>  framesToCheck;
+        if (iter == 0)
+        {
+            // Check the positions read in the first pass, outside the timed region
+            framesRead = &framesToCheck;
+        }
+
+        const auto startTime = std::chrono::steady_clock::now();
+        t_fileio*  fio       = open_xtc(xtcFileName_.c_str(), "r");
+        bool haveFrame = (read_first_xtc(fio, &natoms, &step, &time, box, &x, &prec, &bOK) != 0);
+        std::unique_ptr<XtcFrameReader> reader;
+        if (numThreads > 1)
+        {
+            reader = std::make_unique<XtcFrameReader>(fio, natoms, numThreads);
+        }
+        while (haveFrame)
+        {
+            if (framesRead)
+            {
+                framesRead->emplace_back(x, x + natoms);
+            }
+            numFramesRead++;
+            if (reader)
+            {
+                haveFrame = (reader->readNextFrame(&step, &time, box, x, &prec, &bOK) != 0);
+            }
+            else
+            {
+                haveFrame = (read_next_xtc(fio, natoms, &step, &time, box, x, &prec, &bOK) != 0);
+            }
+        }
+        reader.reset();
+        close_xtc(fio);
+        sfree(x);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+        if (iter >= numWarmupIterations_)
+        {
+            seconds += elapsed.count();
+        }
+
+        if (!bOK || numFramesRead != numFrames_)
+        {
+            GMX_THROW(InternalError(formatString("Read %d frames from %s instead of %d",
+                                                 numFramesRead, xtcFileName_.c_str(), numFrames_)));
+        }
+        for (size_t f = 0; f < framesToCheck.size(); f++)
+        {
+            for (size_t a = 0; a < frames[f].size(); a++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    maxDifference = std::max(maxDifference,
+                                             std::abs(framesToCheck[f][a][d] - frames[f][a][d]));
+                }
+            }
+        }
+    }
+
+    return { "read", numThreads, numFrames_, numIterations_, seconds, fileSize, maxDifference };
+}
+
+int XtcBenchmark::run()
+{
+    const int numMolecules = std::max(numAtoms_ / 3, 1);
+
+    matrix                         box;
+    std::vector<std::vector<RVec>> frames;
+    generateWaterFrames(numMolecules, numFrames_, box, &frames);
+
+    fprintf(stdout, "Writing and reading %d frames of %d water molecules with precision %g\n",
+            numFrames_, numMolecules, precision_);
+    fprintf(stdout, "\n%-6s %8s %12s %10s %14s\n", "", "Threads", "Frames/s", "MB/s",
+            "Max diff (nm)");
+
+    std::vector<XtcBenchResult> results;
+    results.push_back(benchmarkWrite(frames, box));
+    const double fileSize = results.back().fileSize;
+    for (const int numThreads : numThreads_)
+    {
+        results.push_back(benchmarkRead(frames, numThreads, fileSize));
+    }
+    std::remove(xtcFileName_.c_str());
+
+    for (const XtcBenchResult& result : results)
+    {
+        fprintf(stdout, "%-6s %8d %12.2f %10.2f %14.2e\n", result.operation, result.numThreads,
+                result.framesPerSecond(), result.megabytesPerSecond(), result.maxDifference);
+    }
+    fprintf(stdout, "\nThe file size is %.2f MB, %.2f bytes per atom per frame\n",
+            1e-6 * fileSize, fileSize / (3.0 * numMolecules * numFrames_));
+
+    if (!outputFileName_.empty())
+    {
+        TextWriter writer(outputFileName_);
+        writer.writeLine(
+                "operation,threads,atoms,frames,iterations,seconds,frames_per_s,mb_per_s,max_diff");
+        for (const XtcBenchResult& result : results)
+        {
+            writer.writeLine(formatString("%s,%d,%d,%d,%d,%g,%g,%g,%g", result.operation,
+                                          result.numThreads, 3 * numMolecules, result.numFrames,
+                                          result.numIterations, result.seconds,
+                                          result.framesPerSecond(), result.megabytesPerSecond(),
+                                          result.maxDifference));
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+const char XtcBenchmarkInfo::name[] = "xtc-benchmark";
+const char XtcBenchmarkInfo::shortDescription[] =
+        "Benchmarking tool for writing and reading XTC files.";
+
+ICommandLineOptionsModulePointer XtcBenchmarkInfo::create()
+{
+    return ICommandLineOptionsModulePointer(std::make_unique<XtcBenchmark>());
+}
+
+} // namespace gmx